@@ -2,8 +2,9 @@
 //
 // One city tile: turns the pure data from citygen.js into GPU-friendly visuals.
 // Buildings are drawn as instanced #Cube models bucketed by color (one draw
-// call per color/accent bucket), roads as glowing LineBatch3D polylines, and
-// the occasional hero building as a StaticVoxelMap tower.
+// call per color/accent bucket) - or, for comparison, as one Box3D per box or
+// a single Box3DBatch (see buildingMode) - roads as glowing LineBatch3D
+// polylines, and the occasional hero building as a StaticVoxelMap tower.
 
 import QtQuick
 import QtQuick3D
@@ -30,6 +31,9 @@ Node {
     property int carsPerTile: 8
     property real carSpeedFactor: 0.4   // global traffic-speed multiplier
     property var connectorLayer: null   // shared ConnectorLayer3D (scene root)
+    // How buildings are drawn (B): "buckets" (#Cube InstanceLists per color),
+    // "box3d" (one Box3D per body/accent) or "batch" (one Box3DBatch per tile).
+    property string buildingMode: "buckets"
     property var manager: null          // TileManager (transmitter registry)
 
     // Exposed so the selection / lidar path can query this tile's traffic.
@@ -38,6 +42,7 @@ Node {
     // ---- readouts ----
     readonly property int buildingCount: _buildingCount
     property int _buildingCount: 0
+    property var _buildingObjects: []   // everything buildBuildings created
     readonly property int laneLineCount: _laneLineCount
     readonly property int lanePointCount: _lanePointCount
     property int _laneLineCount: 0
@@ -67,12 +72,35 @@ Node {
     readonly property var bodyColors: ["#eef2f6", "#dde6ee", "#e7ecf1", "#d6e2df", "#e8e2ee"]
     // Soft, NON-emissive pastel facade accents (pale teal / green / blue / sand).
     readonly property var accentColors: ["#9fc6c2", "#b7d3ac", "#c3d2df", "#e0d6a8"]
+    // Accent caps: a half-footprint slab this tall on accented roofs.
+    readonly property real accentCapHeight: 5
     readonly property color groundColor: "#c6cad0"
     readonly property color parkColor: "#bcd9ad"
 
     // ---- reusable factories ----
     Component { id: entryComp; InstanceListEntry {} }
 
+    // Building comparison modes. Both use the Box3D material (edges + toon),
+    // so "box3d" vs. "batch" is the same picture at very different cost.
+    Component {
+        id: buildingBoxComp
+        Box3D {
+            castsShadows: true
+            receivesShadows: true
+            useToonShading: true
+            edgeColorFactor: 0.8
+        }
+    }
+    Component {
+        id: buildingBatchComp
+        Box3DBatch {
+            castsShadows: true
+            receivesShadows: true
+            useToonShading: true
+            edgeColorFactor: 0.8
+        }
+    }
+
     Component {
         id: bodyBucketComp
         Model {
@@ -343,6 +371,12 @@ Node {
 
     Component.onCompleted: build()
 
+    onBuildingModeChanged: {
+        if (!tile.cityData) return
+        clearBuildings()
+        buildBuildings(tile.cityData)
+    }
+
     function build() {
         var data = CityGen.generateTile(tile.globalSeed, tile.tileX, tile.tileZ, tile.tileSize)
         tile.cityData = data
@@ -423,31 +457,102 @@ Node {
     }
 
     function buildBuildings(data) {
+        if (tile.buildingMode === "box3d") buildBuildingBoxes(data)
+        else if (tile.buildingMode === "batch") buildBuildingBatch(data)
+        else buildBuildingBuckets(data)
+    }
+
+    function clearBuildings() {
+        for (var i = 0; i < tile._buildingObjects.length; ++i)
+            tile._buildingObjects[i].destroy()
+        tile._buildingObjects = []
+    }
+
+    function buildBuildingBuckets(data) {
         var bodyBuckets = [[], [], [], [], []]
         var accentBuckets = [[], [], [], []]
+        var created = []
 
         for (var i = 0; i < data.buildings.length; ++i) {
             var b = data.buildings[i]
-            bodyBuckets[b.colorIndex].push(entryComp.createObject(tile, {
+            var body = entryComp.createObject(tile, {
                 position: Qt.vector3d(b.x, b.height / 2, b.z),
                 scale: Qt.vector3d(b.w / 100, b.height / 100, b.d / 100)
-            }))
+            })
+            bodyBuckets[b.colorIndex].push(body)
+            created.push(body)
             if (b.accent) {
-                var capH = 5
-                accentBuckets[b.accentIndex].push(entryComp.createObject(tile, {
-                    position: Qt.vector3d(b.x, b.height + capH / 2, b.z),
-                    scale: Qt.vector3d(b.w * 0.5 / 100, capH / 100, b.d * 0.5 / 100)
-                }))
+                var cap = entryComp.createObject(tile, {
+                    position: Qt.vector3d(b.x, b.height + tile.accentCapHeight / 2, b.z),
+                    scale: Qt.vector3d(b.w * 0.5 / 100, tile.accentCapHeight / 100, b.d * 0.5 / 100)
+                })
+                accentBuckets[b.accentIndex].push(cap)
+                created.push(cap)
             }
         }
 
         for (i = 0; i < bodyBuckets.length; ++i)
             if (bodyBuckets[i].length > 0)
-                bodyBucketComp.createObject(tile, { bodyColor: tile.bodyColors[i], entries: bodyBuckets[i] })
+                created.push(bodyBucketComp.createObject(tile, { bodyColor: tile.bodyColors[i], entries: bodyBuckets[i] }))
 
         for (i = 0; i < accentBuckets.length; ++i)
             if (accentBuckets[i].length > 0)
-                accentBucketComp.createObject(tile, { accentColor: tile.accentColors[i], entries: accentBuckets[i] })
+                created.push(accentBucketComp.createObject(tile, { accentColor: tile.accentColors[i], entries: accentBuckets[i] }))
+        tile._buildingObjects = created
+    }
+
+    // One Box3D per body and cap: a Model (draw call, scene-graph node) each.
+    // The geometries share their vertex buffers through the Box3DGeometry
+    // shape cache, so this measures per-object cost, not mesh generation.
+    function buildBuildingBoxes(data) {
+        var created = []
+        for (var i = 0; i < data.buildings.length; ++i) {
+            var b = data.buildings[i]
+            created.push(buildingBoxComp.createObject(tile, {
+                position: Qt.vector3d(b.x, 0, b.z),
+                width: b.w, height: b.height, depth: b.d,
+                color: tile.bodyColors[b.colorIndex]
+            }))
+            if (b.accent) {
+                created.push(buildingBoxComp.createObject(tile, {
+                    position: Qt.vector3d(b.x, b.height, b.z),
+                    width: b.w * 0.5, height: tile.accentCapHeight, depth: b.d * 0.5,
+                    color: tile.accentColors[b.accentIndex]
+                }))
+            }
+        }
+        tile._buildingObjects = created
+    }
+
+    // The same boxes as ONE instanced draw call for the whole tile.
+    function buildBuildingBatch(data) {
+        var bs = data.buildings
+        var n = 0
+        for (var i = 0; i < bs.length; ++i)
+            n += bs[i].accent ? 2 : 1
+        var pos = new Float32Array(n * 3)
+        var size = new Float32Array(n * 3)
+        var rgba = new Uint8Array(n * 4)
+        var k = 0
+        function put(x, y, z, w, h, d, c) {
+            pos[3 * k] = x; pos[3 * k + 1] = y; pos[3 * k + 2] = z
+            size[3 * k] = w; size[3 * k + 1] = h; size[3 * k + 2] = d
+            rgba[4 * k] = Math.round(c.r * 255)
+            rgba[4 * k + 1] = Math.round(c.g * 255)
+            rgba[4 * k + 2] = Math.round(c.b * 255)
+            rgba[4 * k + 3] = 255
+            ++k
+        }
+        for (i = 0; i < bs.length; ++i) {
+            var b = bs[i]
+            put(b.x, 0, b.z, b.w, b.height, b.d, Qt.color(tile.bodyColors[b.colorIndex]))
+            if (b.accent)
+                put(b.x, b.height, b.z, b.w * 0.5, tile.accentCapHeight, b.d * 0.5,
+                    Qt.color(tile.accentColors[b.accentIndex]))
+        }
+        var batch = buildingBatchComp.createObject(tile)
+        batch.setBulk(pos.buffer, size.buffer, rgba.buffer)
+        tile._buildingObjects = [batch]
     }
 
     function buildRoads(data) {
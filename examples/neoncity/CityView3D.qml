@@ -94,6 +94,16 @@ Item {
     property bool overview: false
     property bool benchmark: false
 
+    // How tiles draw their buildings (B cycles): "buckets" = #Cube instance
+    // lists per color, "box3d" = one Box3D per box, "batch" = one Box3DBatch
+    // per tile. Compare perfDraws / perfFrameMs across the three.
+    readonly property var buildingModes: ["buckets", "box3d", "batch"]
+    property string buildingMode: "buckets"
+    function cycleBuildingMode() {
+        var i = buildingModes.indexOf(buildingMode)
+        buildingMode = buildingModes[(i + 1) % buildingModes.length]
+    }
+
     // Fly-camera pose, exposed so the Sandbox can capture/restore it across a
     // dojo reload (traffic is not deterministic - camera + toggles is the point).
     property alias cameraPosition: camera.position
@@ -230,6 +240,7 @@ Item {
         else if (e.key === Qt.Key_E) { root.exportLanes(); e.accepted = true }
         else if (e.key === Qt.Key_I) { root.toggleLidar(); e.accepted = true }
         else if (e.key === Qt.Key_F) { root.flowLanes = !root.flowLanes; e.accepted = true }
+        else if (e.key === Qt.Key_B) { root.cycleBuildingMode(); e.accepted = true }
     }
 
     // Drives the lane chevrons' flow. Runs ONLY while flowLanes is on, so the
@@ -764,6 +775,7 @@ Item {
             laneFlowTime: root.laneFlowTime
             carsPerTile: root.carsPerTile
             carSpeedFactor: root.carSpeedFactor
+            buildingMode: root.buildingMode
             connectorLayer: connectorLayer
             viewportSize: Qt.vector2d(view.width, view.height)
         }
@@ -889,7 +901,8 @@ Item {
             }
             Text {
                 text: "tiles " + tileManager.loadedCount +
-                      "   buildings " + tileManager.buildingCount
+                      "   buildings " + tileManager.buildingCount +
+                      " (" + root.buildingMode + ")   draws " + root.perfDraws
                 color: "#ffd93d"
                 font.family: root.monoFont
                 font.pixelSize: 12
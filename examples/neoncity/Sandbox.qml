@@ -31,6 +31,7 @@ Item {
             tile: { x: cityView.currentTileX, z: cityView.currentTileZ },
             loadedTiles: cityView.loadedCount,
             buildings: cityView.buildingCount,
+            buildingMode: cityView.buildingMode,
             labels: cityView.showLabels,
             links: cityView.showConnections,
             linkTags: cityView.linkTagCount,
@@ -51,7 +52,8 @@ Item {
             showLanes: cityView.showLanes,
             showCars: cityView.showCars,
             showConnections: cityView.showConnections,
-            showLabels: cityView.showLabels
+            showLabels: cityView.showLabels,
+            buildingMode: cityView.buildingMode
         }
     }
     function applyViewState(s) {
@@ -61,6 +63,7 @@ Item {
         if (s.showCars !== undefined) cityView.showCars = s.showCars
         if (s.showConnections !== undefined) cityView.showConnections = s.showConnections
         if (s.showLabels !== undefined) cityView.showLabels = s.showLabels
+        if (s.buildingMode !== undefined) cityView.buildingMode = s.buildingMode
         if (s.camPos) cityView.cameraPosition = Qt.vector3d(s.camPos.x, s.camPos.y, s.camPos.z)
         if (s.camRot) cityView.cameraRotation = Qt.vector3d(s.camRot.x, s.camRot.y, s.camRot.z)
     }
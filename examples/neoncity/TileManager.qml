@@ -25,6 +25,7 @@ Node {
     property real laneFlowTime: 0        // shared chevron-flow clock (see CityView3D)
     property int carsPerTile: 8
     property real carSpeedFactor: 0.4
+    property string buildingMode: "buckets"   // see CityTile.buildingMode
     property var connectorLayer: null
     property vector2d viewportSize: Qt.vector2d(1920, 1080)
 
@@ -126,7 +127,8 @@ Node {
         if (_tiles[kk] !== undefined || _incubators[kk] !== undefined) return
 
         var inc = tileComp.incubateObject(mgr, {
-            tileX: x, tileZ: z, tileSize: mgr.tileSize, globalSeed: mgr.globalSeed
+            tileX: x, tileZ: z, tileSize: mgr.tileSize, globalSeed: mgr.globalSeed,
+            buildingMode: mgr.buildingMode
         }, Qt.Asynchronous)
 
         function onReady() {
@@ -141,6 +143,7 @@ Node {
             t.showLabels = Qt.binding(function () { return mgr.showLabels })
             t.carsPerTile = Qt.binding(function () { return mgr.carsPerTile })
             t.carSpeedFactor = Qt.binding(function () { return mgr.carSpeedFactor })
+            t.buildingMode = Qt.binding(function () { return mgr.buildingMode })
             t.viewportSize = Qt.binding(function () { return mgr.viewportSize })
             _tiles[kk] = t
             delete _incubators[kk]
@@ -0,0 +1,185 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+import QtQuick
+import QtQuick3D
+import QtQuick.Window // For Screen
+
+import Clayground.Canvas3D
+
+/*!
+    \qmltype Box3DBatch
+    \inqmlmodule Clayground.Canvas3D
+    \brief Draws many Box3D-style boxes in a single instanced draw call.
+
+    Box3DBatch renders any number of boxes, each with its own position, size,
+    color and edge mask, as one instanced draw of a shared unit box. It uses
+    the same edge and toon shading as Box3D, so a scene of static boxes
+    (buildings, crates, voxel-ish props) can switch from one Box3D per object
+    to one batch without a visual change while cutting the draw calls and
+    scene-graph nodes to one.
+
+    There are two ways to feed data:
+
+    \list
+    \li The convenience \l boxes path, a declarative JS list.
+    \li The fast \l setBulk path for generators, using packed binary buffers.
+    \endlist
+
+    Like Box3D, each box has its origin at the bottom center. The edge
+    settings apply to the whole batch; a box's own \c edgeMask overrides
+    \l edgeMask. Boxes are not individually rotated - use Box3D (or
+    DynamicInstances3D) for that.
+
+    Example usage:
+    \qml
+    import QtQuick3D
+    import Clayground.Canvas3D
+
+    Box3DBatch {
+        useToonShading: true
+        boxes: [
+            { position: Qt.vector3d(0, 0, 0), size: Qt.vector3d(10, 30, 10), color: "#4a6fa5" },
+            { position: Qt.vector3d(20, 0, 0), size: Qt.vector3d(8, 12, 8), color: "#ff3366",
+              edgeMask: Box3DGeometry.TopEdges }
+        ]
+    }
+    \endqml
+
+    \sa Box3D, Box3DGeometry
+*/
+Model {
+    id: root
+
+    /*!
+        \qmlproperty list Box3DBatch::boxes
+        \brief Declarative list of boxes (convenience path).
+
+        Each element is an object
+        \c{{ position: Qt.vector3d, size: Qt.vector3d, color: <color>, edgeMask: <int> }}.
+        \c size defaults to (1, 1, 1), \c color to white and \c edgeMask to
+        \l edgeMask. For large generated data sets prefer \l setBulk.
+    */
+    property alias boxes: _inst.boxes
+
+    /*!
+        \qmlproperty int Box3DBatch::count
+        \readonly
+        \brief The number of boxes currently in the batch.
+    */
+    property alias count: _inst.count
+
+    /*!
+        \qmlproperty enumeration Box3DBatch::scaledFace
+        \brief Which face of every box is scaled (see Box3D::scaledFace).
+    */
+    property alias scaledFace: _geometry.scaledFace
+
+    /*!
+        \qmlproperty vector2d Box3DBatch::faceScale
+        \brief Scale factor for the selected face of every box.
+    */
+    property alias faceScale: _geometry.faceScale
+
+    /*!
+        \qmlproperty bool Box3DBatch::showEdges
+        \brief Whether to render dark edge lines. Defaults to true.
+    */
+    property alias showEdges: _geometry.showEdges
+
+    /*!
+        \qmlproperty real Box3DBatch::edgeThickness
+        \brief Thickness of edge lines.
+    */
+    property alias edgeThickness: _geometry.edgeThickness
+
+    /*!
+        \qmlproperty real Box3DBatch::edgeColorFactor
+        \brief Darkening factor for edges (0-1).
+    */
+    property alias edgeColorFactor: _geometry.edgeColorFactor
+
+    /*!
+        \qmlproperty int Box3DBatch::edgeMask
+        \brief Edge mask for boxes that do not set their own.
+
+        Defaults to Box3DGeometry.AllEdges.
+    */
+    property alias edgeMask: _geometry.edgeMask
+
+    property alias lighting: _material.lighting
+
+    /*!
+        \qmlproperty bool Box3DBatch::useToonShading
+        \brief Enables cartoon-style rendering (see Box3D::useToonShading).
+    */
+    property alias useToonShading: _material.useToonShading
+
+    /*!
+        \qmlmethod void Box3DBatch::setBulk(ArrayBuffer positions, ArrayBuffer sizes, ArrayBuffer colors, ArrayBuffer edgeMasks)
+        \brief Replaces all boxes from packed typed-array buffers.
+
+        \list
+        \li \a positions - float32 xyz (bottom center) per box.
+        \li \a sizes - float32 width, height, depth per box.
+        \li \a colors - rgba8 (4 bytes) per box.
+        \li \a edgeMasks - optional uint8 edge mask per box; omit it to use
+            \l edgeMask for every box.
+        \endlist
+    */
+    function setBulk(positions, sizes, colors, edgeMasks) {
+        if (edgeMasks === undefined)
+            _inst.setBulk(positions, sizes, colors)
+        else
+            _inst.setBulk(positions, sizes, colors, edgeMasks)
+    }
+
+    /*!
+        \qmlmethod void Box3DBatch::setBoxColor(int index, color color)
+        \brief Recolors box \a index in place (e.g. for a highlight).
+    */
+    function setBoxColor(index, color) {
+        _inst.setBoxColor(index, color)
+    }
+
+    /*!
+        \qmlmethod void Box3DBatch::setBoxEdgeMask(int index, int edgeMask)
+        \brief Sets the edge mask of box \a index; a negative value reverts to
+        \l edgeMask.
+    */
+    function setBoxEdgeMask(index, edgeMask) {
+        _inst.setBoxEdgeMask(index, edgeMask)
+    }
+
+    // Unit box; every instance scales it to its own size, so all batches
+    // with the same face scaling share one cached vertex buffer.
+    geometry: Box3DGeometry {
+        id: _geometry
+        size: Qt.vector3d(1, 1, 1)
+        edgeColorFactor: 0.4
+        edgeMask: Box3DGeometry.AllEdges
+    }
+
+    instancing: Box3DBatchInstancing {
+        id: _inst
+    }
+
+    materials: [
+        CustomMaterial {
+            id: _material
+
+            vertexShader: "box3d_batch.vert"
+            fragmentShader: "box3d.frag"
+            shadingMode: CustomMaterial.Shaded
+
+            property real lighting: 1.0
+            property bool useToonShading: false
+
+            property bool showEdges: _geometry.showEdges
+            property real edgeThickness: _geometry.edgeThickness
+            property real edgeColorFactor: _geometry.edgeColorFactor
+            property int edgeMask: _geometry.edgeMask
+
+            property real viewportHeight: Screen.desktopAvailableHeight
+        }
+    ]
+}
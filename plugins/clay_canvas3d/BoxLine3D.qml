@@ -11,7 +11,10 @@ import Clayground.World
     between consecutive positions. This approach produces lines that look
     good from any viewing angle, unlike screen-space line rendering.
 
-    Uses GPU instancing for efficient rendering.
+    Uses GPU instancing for efficient rendering. Scenes with many lines
+    should attach them to a shared \l LineLayer3D (declare them inside it or
+    set \l layer): all attached lines then draw from one instance table in
+    which a moved line only patches its own segments.
 
     Example usage:
     \qml
@@ -28,7 +31,7 @@ import Clayground.World
     }
     \endqml
 
-    \sa Line3D, LineInstancing
+    \sa Line3D, LineLayer3D, LineInstancing
 */
 Node {
     id: _boxLine
@@ -61,16 +64,67 @@ Node {
 
         Defaults to a DefaultMaterial with diffuseColor set to color.
     */
-    property Material material: DefaultMaterial {
+    property Material material: _defaultMaterial
+
+    /*!
+        \qmlproperty LineLayer3D BoxLine3D::layer
+        \brief The shared batch this line draws into.
+
+        When null, the line auto-discovers an enclosing LineLayer3D up the
+        parent chain; without one it renders on its own. A line with a custom
+        \l material always renders on its own.
+    */
+    property var layer: null
+
+    property real _particleSize: 100
+
+    property Material _defaultMaterial: DefaultMaterial {
         diffuseColor: _boxLine.color
     }
 
-    property real _particleSize: 100
+    // --- layer attachment --------------------------------------------------
+
+    property var _attached: null
+    property int _handle: -1
+    readonly property bool _batched: _attached !== null
+
+    function _findLayer() {
+        var p = parent
+        while (p) {
+            if (p.isLineLayer3D === true)
+                return p
+            p = p.parent
+        }
+        return null
+    }
+
+    function _attach() {
+        var target = null
+        if (_boxLine.material === _defaultMaterial && _boxLine.visible)
+            target = layer ? layer : _findLayer()
+        if (target === _attached)
+            return
+        if (_attached)
+            _attached.removeBoxLine(_handle)
+        _handle = target ? target.addBoxLine(positions, width, color) : -1
+        _attached = target
+    }
+
+    onLayerChanged: _attach()
+    onMaterialChanged: _attach()
+    onVisibleChanged: _attach()
+    onPositionsChanged: if (_attached) _attached.updateBoxLine(_handle, positions)
+    onWidthChanged: if (_attached) _attached.restyleBoxLine(_handle, width, color)
+    onColorChanged: if (_attached) _attached.restyleBoxLine(_handle, width, color)
+
+    Component.onCompleted: _attach()
+    Component.onDestruction: if (_attached) _attached.removeBoxLine(_handle)
 
     Model {
+        visible: !_boxLine._batched
         source: "#Cube"
         instancing: LineInstancing {
-            positions: _boxLine.positions
+            positions: _boxLine._batched ? [] : _boxLine.positions
             width: _boxLine.width
             color: _boxLine.color
         }
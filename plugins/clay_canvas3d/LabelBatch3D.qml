@@ -337,6 +337,65 @@ Node {
         _inst.setCurvedLabels(labels)
     }
 
+    /*!
+        \qmlmethod var LabelBatch3D::pick(vector3d origin, vector3d direction, real tolerance)
+        \brief Returns the label a ray hits first.
+
+        The ray and \a tolerance are in the batch's coordinates. A label counts
+        as hit when the ray passes through its text box grown by \a tolerance,
+        oriented per \l orientation (World \l sizeMode only; use \l pickAt for
+        Screen-sized labels). Returns \c{{ labelIndex, distance, position }}
+        with \c labelIndex -1 on a miss. Like LineBatch3D's queries this runs
+        against a bounding volume hierarchy over the anchors, refitted after
+        \l updatePositionsBulk.
+    */
+    function pick(origin, direction, tolerance) {
+        return _inst.pick(origin, direction, tolerance === undefined ? 0 : tolerance,
+                          Qt.vector2d(0, 0), false, root.orientation === LabelBatch3D.Flat)
+    }
+
+    /*!
+        \qmlmethod var LabelBatch3D::pickAt(View3D view3D, real x, real y, real tolerance)
+        \brief Returns the label under view position \a x, \a y.
+
+        Casts the view's ray through the point; \a tolerance is in pixels
+        (default 2) and Screen-sized labels are measured in pixels as drawn.
+        The result is the map \l pick returns.
+    */
+    function pickAt(view3D, x, y, tolerance) {
+        const depth = 100
+        const near = view3D.mapTo3DScene(Qt.vector3d(x, y, 0))
+        const far = view3D.mapTo3DScene(Qt.vector3d(x, y, depth))
+        const nearPx = view3D.mapTo3DScene(Qt.vector3d(x + 1, y, 0)).minus(near).length()
+        const farPx = view3D.mapTo3DScene(Qt.vector3d(x + 1, y, depth)).minus(far).length()
+        const span = far.minus(near)
+        return _inst.pick(root.mapPositionFromScene(near), root.mapDirectionFromScene(span),
+                          tolerance === undefined ? 2 : tolerance,
+                          Qt.vector2d(nearPx, (farPx - nearPx) / Math.max(span.length(), 1e-6)),
+                          root.sizeMode === LabelBatch3D.Screen,
+                          root.orientation === LabelBatch3D.Flat)
+    }
+
+    /*!
+        \qmlmethod list LabelBatch3D::queryBox(vector3d min, vector3d max)
+        \brief Returns the sorted indices of labels anchored inside the
+        axis-aligned box \a min .. \a max.
+    */
+    function queryBox(min, max) {
+        return _inst.queryBox(min, max)
+    }
+
+    /*!
+        \qmlmethod var LabelBatch3D::nearest(vector3d point, real maxDistance)
+        \brief Returns the label anchored closest to \a point.
+
+        Returns \c{{ labelIndex, distance, position }}; \c labelIndex is -1
+        when no anchor lies within \a maxDistance (unlimited when omitted).
+    */
+    function nearest(point, maxDistance) {
+        return _inst.nearest(point, maxDistance === undefined ? -1 : maxDistance)
+    }
+
     // Shared SDF glyph atlas: handed to both the shaper and the glyph material's
     // texture, so the shaper's UVs always match the committed atlas.
     LabelGlyphAtlas {
@@ -12,7 +12,10 @@ import Clayground.Canvas3D
     Line3D provides an easy way to draw a single connected line through
     a series of 3D points. It wraps \l MultiLine3D for convenience when
     only a single line path is needed, and therefore renders through the
-    instanced \l LineBatch3D backend.
+    instanced \l LineBatch3D backend. Attached to a \l LineLayer3D (declared
+    inside it or via \l layer), the line instead becomes one entry of the
+    layer's shared batch, so many lines cost one draw call and moving one
+    patches only its own segments.
 
     Example usage:
     \qml
@@ -29,7 +32,7 @@ import Clayground.Canvas3D
     }
     \endqml
 
-    \sa MultiLine3D, BoxLine3D, LineBatch3D
+    \sa MultiLine3D, BoxLine3D, LineLayer3D, LineBatch3D
 */
 Node {
     id: _line
@@ -56,8 +59,52 @@ Node {
     */
     property real width: 1
 
+    /*!
+        \qmlproperty LineLayer3D Line3D::layer
+        \brief The shared batch this line draws into.
+
+        When null, the line auto-discovers an enclosing LineLayer3D up the
+        parent chain; without one it renders on its own.
+    */
+    property var layer: null
+
+    // --- layer attachment --------------------------------------------------
+
+    property var _attached: null
+
+    function _findLayer() {
+        var p = parent
+        while (p) {
+            if (p.isLineLayer3D === true)
+                return p
+            p = p.parent
+        }
+        return null
+    }
+
+    function _attach() {
+        var target = _line.visible ? (layer ? layer : _findLayer()) : null
+        if (target === _attached)
+            return
+        if (_attached)
+            _attached.unregisterLine(_line)
+        _attached = target
+        if (_attached)
+            _attached.registerLine(_line)
+    }
+
+    onLayerChanged: _attach()
+    onVisibleChanged: _attach()
+    onCoordsChanged: if (_attached) _attached.updateLine(_line)
+    onColorChanged: if (_attached) _attached.restyleLine(_line)
+    onWidthChanged: if (_attached) _attached.restyleLine(_line)
+
+    Component.onCompleted: _attach()
+    Component.onDestruction: if (_attached) _attached.unregisterLine(_line)
+
     MultiLine3D {
-        coords: [_line.coords]
+        visible: _line._attached === null
+        coords: _line._attached === null ? [_line.coords] : []
         color: _line.color
         width: _line.width
     }
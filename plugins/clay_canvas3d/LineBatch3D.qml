@@ -27,6 +27,13 @@ import Clayground.Canvas3D
     Individual lines can be moved cheaply with \l updateLinePoints, which
     patches only that line's region of the instance table.
 
+    Animated line fields do not need per-frame updates at all: in
+    \l{animation}{Keyframes} mode a set of point sets is uploaded once with
+    \l setKeyframes and the vertex shader morphs between them, and in
+    \l{animation}{Procedural} mode a travelling sine \l{swayAmplitude}{sway}
+    and a \l{trailLength}{trail} that flows along each path are computed on
+    the GPU. Both run off \l flowTime, offset per line by \l setLinePhases.
+
     Example usage:
     \qml
     import QtQuick3D
@@ -83,6 +90,25 @@ Model {
     */
     enum Orientation { Billboard, Flat }
 
+    /*!
+        \qmlproperty enumeration LineBatch3D::Animation
+        \brief GPU-side animation of the line geometry.
+
+        \value LineBatch3D.Static Lines render at their points; per-frame
+               motion needs updatePolylinesBulk or similar (default).
+        \value LineBatch3D.Keyframes The vertex shader interpolates each line
+               between the point sets uploaded with \l setKeyframes, at time
+               \c{(flowTime + phase) * keyframeRate} (in keyframes). Until
+               matching keyframes exist this behaves like Procedural.
+        \value LineBatch3D.Procedural Lines render at their points, moved by
+               the procedural \l swayAmplitude and \l trailLength motions.
+               These also apply on top of Keyframes.
+
+        Switching modes rewrites the instance table once; afterwards animating
+        only changes material uniforms.
+    */
+    enum Animation { Static, Keyframes, Procedural }
+
     /*!
         \qmlproperty list LineBatch3D::lines
         \brief Declarative list of styled polylines (convenience path).
@@ -90,7 +116,8 @@ Model {
         Each element is an object
         \c{{ points: [Qt.vector3d, ...], color: <color>, width: <real>, styleId: <int> }}.
         A polyline with N points produces N-1 segment instances sharing that
-        line's style. For large generated data sets prefer \l setBulk.
+        line's style. An optional \c phase (seconds) offsets the line's time in
+        the \l animation modes. For large generated data sets prefer \l setBulk.
     */
     property alias lines: _inst.lines
 
@@ -193,6 +220,8 @@ Model {
         \li \c glow - soft edge falloff across the ribbon instead of a hard edge
             (0 = hard, the default; ~0.3-1.0 for a neon look).
         \li \c pulse - opacity oscillation driven by \l flowTime (0 = none).
+        \li \c key - optional name for \l styleId, \l setStyle and
+            \l setStyleValue, e.g. a road class or traffic level.
         \li \c head - \c{[length, width]} arrowhead at the line's flagged end(s),
             in multiples of line width; absent = no head. Drawn as a classic
             triangle with a real shoulder. The proportions are regulated so the
@@ -210,7 +239,9 @@ Model {
         The table is baked into a small RGBA32F texture the shader samples per
         fragment; the pattern phase runs continuously along each polyline. Style
         index 0 always defaults to solid, round-capped and fully opaque, so
-        lines work unchanged when \c styles is left empty.
+        lines work unchanged when \c styles is left empty. The table holds up
+        to 65536 styles. Reassigning it re-encodes every entry; to animate or
+        edit single styles use \l setStyle and \l setStyleValue.
 
         Example:
         \code
@@ -232,7 +263,8 @@ Model {
         \brief Animation clock (seconds) driving every flowing/pulsing style.
 
         A single value shared by the whole batch: each style's \c flow scales it
-        to march its pattern, and \c pulse oscillates its opacity from it. The
+        to march its pattern, \c pulse oscillates its opacity from it, and the
+        \l animation modes morph, sway and trail the lines from it. The
         batch never ticks itself (rendering stays on-demand); bind this to your
         own clock (typically a \c FrameAnimation's \c elapsedTime) or set
         \l flowAutoPlay to true for the built-in one. Set it explicitly for
@@ -252,6 +284,89 @@ Model {
     */
     property bool flowAutoPlay: false
 
+    /*!
+        \qmlproperty int LineBatch3D::animation
+        \brief The active Animation mode. Defaults to LineBatch3D.Static.
+    */
+    property int animation: LineBatch3D.Static
+
+    /*!
+        \qmlproperty int LineBatch3D::keyframeCount
+        \readonly
+        \brief The number of uploaded keyframes (0 when none match the lines).
+
+        Keyframes are dropped when the batch is rebuilt with a different number
+        of points.
+    */
+    property alias keyframeCount: _inst.keyframeCount
+
+    /*!
+        \qmlproperty real LineBatch3D::keyframeRate
+        \brief Keyframes advanced per second of \l flowTime. Defaults to 1.
+    */
+    property real keyframeRate: 1
+
+    /*!
+        \qmlproperty bool LineBatch3D::keyframeLoop
+        \brief Whether the morph wraps from the last keyframe to the first.
+
+        When false the lines hold the last keyframe once reached. Defaults to
+        true.
+    */
+    property bool keyframeLoop: true
+
+    /*!
+        \qmlproperty real LineBatch3D::swayAmplitude
+        \brief Peak displacement (world units) of the procedural sway; 0 = off.
+
+        The sway is a sine wave travelling along each line: a point at path
+        distance \c d moves by
+        \c{swayAxis * swayAmplitude * sin(2pi * (swayFrequency * t - d / swayWavelength))}
+        with \c t the line's time. Only applies in the animated modes. The
+        batch bounds grow by the amplitude so the lines are never culled early.
+    */
+    property real swayAmplitude: 0
+
+    /*!
+        \qmlproperty vector3d LineBatch3D::swayAxis
+        \brief World direction of the sway displacement. Defaults to +Y.
+    */
+    property vector3d swayAxis: Qt.vector3d(0, 1, 0)
+
+    /*!
+        \qmlproperty real LineBatch3D::swayFrequency
+        \brief Sway oscillations per second. Defaults to 0.5.
+    */
+    property real swayFrequency: 0.5
+
+    /*!
+        \qmlproperty real LineBatch3D::swayWavelength
+        \brief Path distance (world units) of one sway wave. Defaults to 200.
+    */
+    property real swayWavelength: 200
+
+    /*!
+        \qmlproperty real LineBatch3D::trailLength
+        \brief Length (world units) of the trail flowing along each line; 0 = off.
+
+        With a trail, only the stretch up to \c trailLength behind each head
+        is drawn, fading towards its tail; heads move at \l trailSpeed and
+        repeat every \l trailPeriod. Only applies in the animated modes.
+    */
+    property real trailLength: 0
+
+    /*!
+        \qmlproperty real LineBatch3D::trailSpeed
+        \brief Trail head speed in world units per second. Defaults to 100.
+    */
+    property real trailSpeed: 100
+
+    /*!
+        \qmlproperty real LineBatch3D::trailPeriod
+        \brief Path distance between successive trail heads. Defaults to 300.
+    */
+    property real trailPeriod: 300
+
     FrameAnimation {
         running: root.flowAutoPlay
         onTriggered: root.flowTime = elapsedTime
@@ -327,6 +442,82 @@ Model {
         _inst.updatePolylinesBulk(positions, pointsPerLine)
     }
 
+    /*!
+        \qmlmethod bool LineBatch3D::setKeyframes(ByteArray positions, int keyframeCount)
+        \brief Uploads point sets for the Keyframes animation mode.
+
+        \a positions holds \a keyframeCount complete point sets, keyframe
+        after keyframe; each set is laid out exactly like the positions buffer
+        of \l setBulk (float32 xyz for every point of every line). The upload
+        happens once; the morph itself runs in the vertex shader. Returns false
+        if the buffer does not match the current lines.
+
+        \sa animation, keyframeRate, clearKeyframes
+    */
+    function setKeyframes(positions, keyframeCount) {
+        return _inst.setKeyframes(positions, keyframeCount)
+    }
+
+    /*!
+        \qmlmethod void LineBatch3D::clearKeyframes()
+        \brief Drops the uploaded keyframes.
+    */
+    function clearKeyframes() {
+        _inst.clearKeyframes()
+    }
+
+    /*!
+        \qmlmethod void LineBatch3D::setLinePhases(ByteArray phases)
+        \brief Sets each line's time offset for the animated modes.
+
+        \a phases holds one float32 (seconds, added to \l flowTime) per line
+        in batch order, so lines of one field can run out of step. The
+        declarative \l lines path takes an optional \c phase key instead.
+    */
+    function setLinePhases(phases) {
+        _inst.setLinePhases(phases)
+    }
+
+    /*!
+        \qmlmethod int LineBatch3D::styleId(string key)
+        \brief Returns the index of the style with the given \c key, or -1.
+
+        Use it to fill \c styleId for lines styled by data category.
+    */
+    function styleId(key) {
+        return _styleData.styleId(key)
+    }
+
+    /*!
+        \qmlmethod int LineBatch3D::setStyle(var idOrKey, object style)
+        \brief Replaces or appends one entry of the style table.
+
+        \a idOrKey is a style index or \c key; the next free index or an
+        unknown key appends. Only that style's texels are rewritten, so this is
+        much cheaper than reassigning \l styles. Returns the style index, or
+        -1 for an invalid index.
+    */
+    function setStyle(idOrKey, style) {
+        return _styleData.setStyle(idOrKey, style)
+    }
+
+    /*!
+        \qmlmethod bool LineBatch3D::setStyleValue(var idOrKey, string name, var value)
+        \brief Changes a single key of one style (e.g. \c pulse or \c glow).
+
+        The cheap path for animating a style every frame:
+        \code
+        FrameAnimation {
+            running: true
+            onTriggered: lines.setStyleValue("congested", "glow",
+                                             0.5 + 0.5 * Math.sin(elapsedTime * 4))
+        }
+        \endcode
+    */
+    function setStyleValue(idOrKey, name, value) {
+        return _styleData.setStyleValue(idOrKey, name, value)
+    }
+
     /*!
         \qmlmethod real LineBatch3D::pathLength(int lineId)
         \brief Returns the total length of line \a lineId in world units.
@@ -351,6 +542,78 @@ Model {
         return _inst.positionAt(lineId, distance)
     }
 
+    /*!
+        \qmlmethod var LineBatch3D::pick(vector3d origin, vector3d direction, real tolerance)
+        \brief Returns the line segment a ray hits first.
+
+        The ray and \a tolerance are in the batch's coordinates, like
+        \l positionAt. A segment counts as hit when the ray passes within
+        \a tolerance plus half the line's width (World \l widthUnits only; use
+        \l pickAt for pixel widths). Returns
+        \c{{ lineIndex, segmentIndex, distance, point, offset }} with
+        \c lineIndex -1 on a miss.
+
+        Queries run against a bounding volume hierarchy over all segments that
+        is rebuilt on the first query after a topology change and refitted
+        after the point-update paths, so they stay in the microsecond range at
+        100k segments. The animated modes' shader motion is not reflected.
+    */
+    function pick(origin, direction, tolerance) {
+        return _inst.pick(origin, direction, tolerance === undefined ? 0 : tolerance)
+    }
+
+    /*!
+        \qmlmethod var LineBatch3D::pickAt(View3D view3D, real x, real y, real tolerance)
+        \brief Returns the line segment under view position \a x, \a y.
+
+        Casts the view's ray through the point and picks with \a tolerance in
+        pixels (default 4); Pixel \l widthUnits widths count in pixels too.
+        The result is the map \l pick returns, in batch coordinates.
+    */
+    function pickAt(view3D, x, y, tolerance) {
+        const ray = _pickRay(view3D, x, y)
+        return _inst.pick(ray.origin, ray.direction, tolerance === undefined ? 4 : tolerance,
+                          ray.pixelScale, root.widthUnits === LineBatch3D.Pixel)
+    }
+
+    /*!
+        \qmlmethod list LineBatch3D::queryBox(vector3d min, vector3d max)
+        \brief Returns the sorted indices of lines with a segment inside the
+        axis-aligned box \a min .. \a max (batch coordinates).
+    */
+    function queryBox(min, max) {
+        return _inst.queryBox(min, max)
+    }
+
+    /*!
+        \qmlmethod var LineBatch3D::nearest(vector3d point, real maxDistance)
+        \brief Returns the segment closest to \a point (batch coordinates).
+
+        Returns \c{{ lineIndex, segmentIndex, distance, point }} with the
+        closest point on the segment; \c lineIndex is -1 when nothing lies
+        within \a maxDistance (unlimited when omitted).
+    */
+    function nearest(point, maxDistance) {
+        return _inst.nearest(point, maxDistance === undefined ? -1 : maxDistance)
+    }
+
+    // The view ray through (x, y) in batch coordinates, with the world size of
+    // one pixel at its origin and that size's growth per unit distance (0 for
+    // orthographic cameras). Assumes an unscaled batch.
+    function _pickRay(view3D, x, y) {
+        const depth = 100
+        const near = view3D.mapTo3DScene(Qt.vector3d(x, y, 0))
+        const far = view3D.mapTo3DScene(Qt.vector3d(x, y, depth))
+        const nearPx = view3D.mapTo3DScene(Qt.vector3d(x + 1, y, 0)).minus(near).length()
+        const farPx = view3D.mapTo3DScene(Qt.vector3d(x + 1, y, depth)).minus(far).length()
+        const span = far.minus(near)
+        return {
+            origin: root.mapPositionFromScene(near),
+            direction: root.mapDirectionFromScene(span),
+            pixelScale: Qt.vector2d(nearPx, (farPx - nearPx) / Math.max(span.length(), 1e-6))
+        }
+    }
+
     // Shadows are off and cannot meaningfully be turned on: the lines are
     // camera-facing ribbons expanded in an unshaded custom material's vertex
     // shader, and the shadow pass skips unshaded custom materials - setting
@@ -367,6 +630,9 @@ Model {
 
     instancing: LineBatchInstancing {
         id: _inst
+        animation: root.animation
+        keyframeData: _keyframeData
+        boundsPadding: root.animation !== LineBatch3D.Static ? Math.abs(root.swayAmplitude) : 0
     }
 
     materials: [
@@ -392,7 +658,7 @@ Model {
             // 1.0 in opaque mode enables the deterministic per-instance depth
             // tie-break in the vertex shader; 0.0 disables it when blending.
             property real depthJitter: root.opaque ? 1.0 : 0.0
-            property real styleCount: _styleData.styleCount
+            property vector2d styleTableSize: _styleData.textureSize
             property TextureInput styleTable: TextureInput {
                 texture: Texture {
                     minFilter: Texture.Nearest
@@ -405,6 +671,33 @@ Model {
                     }
                 }
             }
+            // Animation (see LineBatch3D.Animation); the mode uniform follows
+            // the table layout actually written, not the requested mode.
+            property real animMode: _inst.activeAnimation
+            property real keyframeCount: _keyframeData.keyframeCount
+            property real keyframePointCount: _keyframeData.pointCount
+            property vector2d keyframeTexSize: _keyframeData.textureSize
+            property real keyframeRate: root.keyframeRate
+            property real keyframeLoop: root.keyframeLoop ? 1.0 : 0.0
+            property real swayAmplitude: root.swayAmplitude
+            property vector3d swayAxis: root.swayAxis
+            property real swayFrequency: root.swayFrequency
+            property real swayWavelength: root.swayWavelength
+            property real trailLength: root.trailLength
+            property real trailSpeed: root.trailSpeed
+            property real trailPeriod: root.trailPeriod
+            property TextureInput keyframeTable: TextureInput {
+                texture: Texture {
+                    minFilter: Texture.Nearest
+                    magFilter: Texture.Nearest
+                    mipFilter: Texture.None
+                    tilingModeHorizontal: Texture.ClampToEdge
+                    tilingModeVertical: Texture.ClampToEdge
+                    textureData: LineKeyframeTextureData {
+                        id: _keyframeData
+                    }
+                }
+            }
             vertexShader: "line_batch.vert"
             fragmentShader: "line_batch.frag"
         }
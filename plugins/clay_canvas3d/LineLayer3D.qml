@@ -0,0 +1,182 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+import QtQuick
+import QtQuick3D
+import Clayground.Canvas3D
+
+/*!
+    \qmltype LineLayer3D
+    \inqmlmodule Clayground.Canvas3D
+    \brief Draws many \l Line3D and \l BoxLine3D items as two shared batches.
+
+    On their own, every Line3D and BoxLine3D is a Model with its own instance
+    table, rebuilt in full whenever its points change. A scene with hundreds
+    of small animated lines therefore pays a draw call and a table rebuild
+    per line. Lines attached to a LineLayer3D instead register into the
+    layer's shared batches: one \l LineBatch3D for the Line3D ribbons and one
+    box-segment table for the BoxLine3D items. A point update then patches
+    only that line's slice of the table in place, and membership or
+    segment-count changes recompact the table once per frame.
+
+    Lines attach by being declared inside the layer (auto-discovered up the
+    parent chain) or through their \c layer property - the robust choice for
+    Repeater3D delegates. Their QML API is otherwise unchanged. Put one layer
+    at the root of a View3D's scene to share it across the whole view.
+
+    \note Attached lines are drawn in the layer's coordinate space: the
+    transforms of nodes between the layer and a line are not applied. A
+    BoxLine3D with a custom \c material keeps rendering on its own, since a
+    batch has one material.
+
+    Example usage:
+    \qml
+    import QtQuick3D
+    import Clayground.Canvas3D
+
+    View3D {
+        LineLayer3D {
+            id: lines
+        }
+
+        Repeater3D {
+            model: 300
+            BoxLine3D {
+                layer: lines
+                positions: [Qt.vector3d(index, 0, 0), Qt.vector3d(index, 10, 0)]
+                width: 0.5
+                color: "orange"
+            }
+        }
+    }
+    \endqml
+
+    \sa Line3D, BoxLine3D, LineBatch3D, ConnectorLayer3D
+*/
+Node {
+    id: root
+
+    // Marker used by Line3D / BoxLine3D to auto-discover an enclosing layer.
+    readonly property bool isLineLayer3D: true
+
+    /*!
+        \qmlproperty Material LineLayer3D::boxMaterial
+        \brief The material of the shared BoxLine3D batch.
+
+        The per-line color is carried by the instance table and multiplied
+        with this material's color, so it defaults to a white DefaultMaterial.
+    */
+    property Material boxMaterial: DefaultMaterial {
+        diffuseColor: "white"
+    }
+
+    /*!
+        \qmlproperty int LineLayer3D::lineCount
+        \readonly
+        \brief The number of Line3D items drawn by the ribbon batch.
+    */
+    readonly property int lineCount: _ribbons.count
+
+    /*!
+        \qmlproperty int LineLayer3D::boxLineCount
+        \readonly
+        \brief The number of BoxLine3D items drawn by the box batch.
+    */
+    readonly property int boxLineCount: _boxes.lineCount
+
+    // --- registration API (called by Line3D) -------------------------------
+
+    /*! \internal */
+    function registerLine(l) {
+        if (_lines.indexOf(l) < 0) {
+            _lines.push(l)
+            _scheduleRebuild()
+        }
+    }
+
+    /*! \internal */
+    function unregisterLine(l) {
+        var i = _lines.indexOf(l)
+        if (i >= 0) {
+            _lines.splice(i, 1)
+            _scheduleRebuild()
+        }
+    }
+
+    /*! \internal Points changed: patch the line's slice in place. */
+    function updateLine(l) {
+        if (_rebuildPending)
+            return
+        var i = _lineIndex.get(l)
+        if (i !== undefined)
+            _ribbons.updateLinePoints(i, l.coords ? l.coords : [])
+    }
+
+    /*! \internal Color or width changed. */
+    function restyleLine(l) {
+        _scheduleRebuild()
+    }
+
+    // --- registration API (called by BoxLine3D) ----------------------------
+
+    /*! \internal Returns the handle to pass to the other box-line calls. */
+    function addBoxLine(positions, width, color) {
+        return _boxes.addLine(positions, width, color)
+    }
+
+    /*! \internal */
+    function removeBoxLine(handle) {
+        _boxes.removeLine(handle)
+    }
+
+    /*! \internal */
+    function updateBoxLine(handle, positions) {
+        _boxes.setLinePoints(handle, positions)
+    }
+
+    /*! \internal */
+    function restyleBoxLine(handle, width, color) {
+        _boxes.setLineStyle(handle, width, color)
+    }
+
+    // --- internals ---------------------------------------------------------
+
+    property var _lines: []
+    property var _lineIndex: new Map()   // Line3D -> line index in _ribbons
+    property bool _rebuildPending: false
+
+    function _scheduleRebuild() {
+        if (_rebuildPending)
+            return
+        _rebuildPending = true
+        Qt.callLater(_rebuild)
+    }
+
+    function _rebuild() {
+        _rebuildPending = false
+        var arr = new Array(_lines.length)
+        _lineIndex = new Map()
+        for (var i = 0; i < _lines.length; ++i) {
+            var l = _lines[i]
+            _lineIndex.set(l, i)
+            arr[i] = { points: l.coords ? l.coords : [], color: l.color,
+                       width: l.width, styleId: 0 }
+        }
+        _ribbons.lines = arr
+    }
+
+    // Line3D look: constant-world-width, camera-facing ribbons.
+    LineBatch3D {
+        id: _ribbons
+        widthUnits: LineBatch3D.World
+    }
+
+    // BoxLine3D look: unit-cube segments (#Cube is 100 units wide).
+    Model {
+        source: "#Cube"
+        scale: Qt.vector3d(0.01, 0.01, 0.01)
+        instancing: BoxLineBatchInstancing {
+            id: _boxes
+        }
+        materials: root.boxMaterial
+    }
+}
@@ -17,8 +17,8 @@ View3D {
     // --- fixed scenario parameters ---
     readonly property int seed: 1337
     readonly property var steps: [100, 500, 1000, 5000, 10000]
-    readonly property real warmupMs: 2000
-    readonly property real stepDurationMs: 8000
+    property real warmupMs: 2000
+    property real stepDurationMs: 8000
     readonly property real minFps: 5
 
     // --- driver state ---
@@ -23,8 +23,8 @@ View3D {
     readonly property int seed: 1337
     readonly property var steps: [1000, 5000, 20000]
     readonly property var backends: ["instancelist", "dynamic"]
-    readonly property real warmupMs: 2000
-    readonly property real stepDurationMs: 8000
+    property real warmupMs: 2000
+    property real stepDurationMs: 8000
     readonly property real extent: 400
     readonly property real heightExtent: 120
     readonly property real minFps: 5
@@ -0,0 +1,256 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+// Benchmark: an animated field of N uniform-topology polylines in one
+// LineBatch3D, driven three ways per N:
+//   cpu        - the host rewrites every point each frame (updatePolylinesBulk)
+//   keyframes  - 4 point sets uploaded once, morphed in the vertex shader
+//   procedural - static points, travelling sine sway + trail in the shaders
+// All three show comparable motion; update_ms is the per-frame host cost
+// (JS + table patch), which the GPU modes should keep near zero. Prints
+// "BENCH DONE lines-animated" when finished.
+
+import QtQuick
+import QtQuick3D
+import QtQuick3D.Helpers
+import Clayground.Canvas3D
+
+View3D {
+    id: view3D
+    anchors.fill: parent
+    width: parent ? parent.width : 1280
+    height: parent ? parent.height : 720
+
+    // --- fixed scenario parameters ---
+    readonly property int seed: 1337
+    readonly property var modes: ["cpu", "keyframes", "procedural"]
+    readonly property var counts: [1000, 10000, 50000]
+    readonly property int pointsPerLine: 8
+    readonly property int keyframes: 4
+    property real warmupMs: 2000
+    property real stepDurationMs: 6000
+    readonly property real extent: 500
+    readonly property real heightExtent: 300
+    readonly property real minFps: 5
+
+    // --- driver state ---
+    property int stepIndex: -1
+    property int currentN: 0
+    property string currentMode: ""
+    property real lastUpdateMs: 0
+    property real stepStartMs: 0
+    property bool measureMarked: false
+    property bool benchDone: false
+    property var basePositions: null   // Float32Array, pointsPerLine * 3 per line
+
+    environment: SceneEnvironment {
+        clearColor: "#101018"
+        backgroundMode: SceneEnvironment.Color
+    }
+
+    // Fixed camera - keep identical across runs.
+    PerspectiveCamera {
+        id: camera
+        position: Qt.vector3d(0, 600, 1200)
+        eulerRotation.x: -22
+    }
+
+    DirectionalLight {
+        eulerRotation.x: -35
+        eulerRotation.y: -70
+    }
+
+    LineBatch3D {
+        id: batch
+        widthUnits: LineBatch3D.Pixel
+        viewportSize: Qt.vector2d(view3D.width, view3D.height)
+        flowAutoPlay: true
+        keyframeRate: 0.5
+        swayAmplitude: view3D.currentMode === "procedural" ? 30 : 0
+        swayWavelength: 150
+        trailLength: view3D.currentMode === "procedural" ? 120 : 0
+        trailPeriod: 240
+    }
+
+    PerfHud {
+        view3D: view3D
+        anchors.top: parent.top
+        anchors.right: parent.right
+        anchors.margins: 12
+    }
+
+    BenchLogger {
+        id: bench
+        view3D: view3D
+        // Written out-of-tree; copy to results/ after the run.
+        outputPath: "file:///tmp/clay_bench/lines-animated.csv"
+        intervalMs: 250
+        extra: ({
+            "line_count": function() { return view3D.currentN },
+            "mode": function() { return view3D.currentMode },
+            "update_ms": function() { return view3D.lastUpdateMs.toFixed(2) }
+        })
+        running: false
+    }
+
+    Component.onCompleted: bench.running = true
+
+    function makeRng(s) {
+        var state = s >>> 0
+        return function() {
+            state = (state * 1664525 + 1013904223) >>> 0
+            return state / 4294967296
+        }
+    }
+
+    // Random-walk polylines with a fixed point count, so the cpu mode can use
+    // the uniform-topology bulk update.
+    function buildBatch(n) {
+        var rng = makeRng(view3D.seed)
+        var ppl = view3D.pointsPerLine
+        var pos = new Float32Array(n * ppl * 3)
+        var starts = new Uint32Array(n + 1)
+        var colors = new Uint8Array(n * 4)
+        var widths = new Float32Array(n)
+        var phases = new Float32Array(n)
+        for (var i = 0; i < n; i++) {
+            starts[i] = i * ppl
+            var px = (rng() * 2 - 1) * view3D.extent
+            var py = rng() * view3D.heightExtent
+            var pz = (rng() * 2 - 1) * view3D.extent
+            for (var p = 0; p < ppl; p++) {
+                var o = (i * ppl + p) * 3
+                pos[o] = px; pos[o + 1] = py; pos[o + 2] = pz
+                px += (rng() * 2 - 1) * 40
+                py += (rng() * 2 - 1) * 30
+                pz += (rng() * 2 - 1) * 40
+            }
+            colors[i * 4 + 0] = Math.floor(rng() * 255)
+            colors[i * 4 + 1] = Math.floor(rng() * 255)
+            colors[i * 4 + 2] = Math.floor(rng() * 255)
+            colors[i * 4 + 3] = 255
+            widths[i] = 2.0
+            phases[i] = rng() * 4.0
+        }
+        starts[n] = n * ppl
+        basePositions = pos
+        batch.setBulk(pos.buffer, starts.buffer, colors.buffer, widths.buffer)
+        batch.setLinePhases(phases.buffer)
+    }
+
+    // The cpu mode's per-frame motion, also used to bake the keyframes: a
+    // vertical sine sway of every point (so all three modes move similarly).
+    function swayed(t) {
+        var src = basePositions
+        var out = new Float32Array(src.length)
+        var ppl = view3D.pointsPerLine
+        var n = src.length / (ppl * 3)
+        for (var i = 0; i < n; i++) {
+            for (var p = 0; p < ppl; p++) {
+                var o = (i * ppl + p) * 3
+                out[o] = src[o]
+                out[o + 1] = src[o + 1] + 30 * Math.sin(t * 3.1 + i * 0.13 + p * 0.4)
+                out[o + 2] = src[o + 2]
+            }
+        }
+        return out
+    }
+
+    function uploadKeyframes() {
+        var frames = view3D.keyframes
+        var one = basePositions.length
+        var all = new Float32Array(one * frames)
+        for (var k = 0; k < frames; k++)
+            all.set(swayed(k * 2.0 * Math.PI / (3.1 * frames)), k * one)
+        batch.setKeyframes(all.buffer, frames)
+    }
+
+    function startStep(i) {
+        stepIndex = i
+        currentMode = modes[Math.floor(i / counts.length)]
+        currentN = counts[i % counts.length]
+        measureMarked = false
+        lastUpdateMs = 0
+        buildBatch(currentN)
+        if (currentMode === "keyframes") {
+            batch.animation = LineBatch3D.Keyframes
+            uploadKeyframes()
+        } else if (currentMode === "procedural") {
+            batch.animation = LineBatch3D.Procedural
+        } else {
+            batch.animation = LineBatch3D.Static
+        }
+        bench.annotate("step_start", currentMode + "@" + currentN)
+        stepStartMs = Date.now()
+        console.log("BENCH STEP lines-animated " + currentMode + " N=" + currentN)
+    }
+
+    function finish() {
+        if (benchDone)
+            return
+        benchDone = true
+        bench.running = false
+        driveTimer.stop()
+        frameDriver.running = false
+        console.log("BENCH DONE lines-animated")
+    }
+
+    function flagInfo() {
+        return { scenario: "lines-animated", step: stepIndex, mode: currentMode,
+                 lineCount: currentN, updateMs: lastUpdateMs,
+                 fps: (renderStats ? renderStats.fps : -1), done: benchDone }
+    }
+
+    // Only the cpu mode does per-frame work; the GPU modes run off flowTime.
+    FrameAnimation {
+        id: frameDriver
+        running: true
+        onTriggered: {
+            if (view3D.currentMode !== "cpu" || !view3D.basePositions)
+                return
+            var t0 = Date.now()
+            batch.updatePolylinesBulk(view3D.swayed(batch.flowTime).buffer,
+                                      view3D.pointsPerLine)
+            view3D.lastUpdateMs = Date.now() - t0
+        }
+    }
+
+    Timer {
+        id: driveTimer
+        interval: 100
+        repeat: true
+        running: true
+        onTriggered: {
+            if (view3D.stepIndex < 0) {
+                view3D.startStep(0)
+                return
+            }
+            var el = Date.now() - view3D.stepStartMs
+            if (!view3D.measureMarked && el >= view3D.warmupMs) {
+                bench.annotate("measure_start", view3D.currentMode + "@" + view3D.currentN)
+                view3D.measureMarked = true
+            }
+            if (view3D.measureMarked && view3D.renderStats
+                    && view3D.renderStats.fps > 0
+                    && view3D.renderStats.fps < view3D.minFps) {
+                bench.annotate("early_stop", "fps<" + view3D.minFps + "@" + view3D.currentMode
+                               + "@N=" + view3D.currentN)
+                console.log("BENCH EARLY-STOP lines-animated at " + view3D.currentMode
+                            + " N=" + view3D.currentN + " fps=" + view3D.renderStats.fps)
+                // Larger N of this mode would be slower still; move on to the
+                // next mode so the GPU paths are still measured.
+                var next = (Math.floor(view3D.stepIndex / view3D.counts.length) + 1)
+                           * view3D.counts.length
+                if (next < view3D.modes.length * view3D.counts.length)
+                    view3D.startStep(next)
+                else
+                    view3D.finish()
+                return
+            }
+            if (el >= view3D.stepDurationMs) {
+                if (view3D.stepIndex + 1 < view3D.modes.length * view3D.counts.length)
+                    view3D.startStep(view3D.stepIndex + 1)
+                else
+                    view3D.finish()
+            }
+        }
+    }
+}
@@ -34,8 +34,8 @@ View3D {
     // --- fixed scenario parameters (keep identical across all configs) ---
     readonly property int seed: 1337
     readonly property var steps: [10000, 50000, 100000, 200000]
-    readonly property real warmupMs: 2000
-    readonly property real stepDurationMs: 8000
+    property real warmupMs: 2000
+    property real stepDurationMs: 8000
     readonly property real extent: 500
     readonly property real heightExtent: 300
 
@@ -16,8 +16,8 @@ View3D {
     // --- fixed scenario parameters (keep identical for the optimized re-run) ---
     readonly property int seed: 1337
     readonly property var steps: [100, 500, 1000, 5000, 10000]
-    readonly property real warmupMs: 2000
-    readonly property real stepDurationMs: 8000
+    property real warmupMs: 2000
+    property real stepDurationMs: 8000
     readonly property real extent: 500
     readonly property real heightExtent: 300
     readonly property real minFps: 5
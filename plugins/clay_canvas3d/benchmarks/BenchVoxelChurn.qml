@@ -19,8 +19,8 @@ View3D {
     readonly property int vcy: 15
     readonly property int vcz: 30
     readonly property int cycleMs: 30
-    readonly property real warmupMs: 2000
-    readonly property real durationMs: 10000
+    property real warmupMs: 2000
+    property real durationMs: 10000
 
     // --- driver state ---
     property real time: 0
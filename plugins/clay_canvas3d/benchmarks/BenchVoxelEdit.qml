@@ -20,8 +20,8 @@ View3D {
     readonly property int vcx: 128
     readonly property int vcy: 64
     readonly property int vcz: 128
-    readonly property real warmupMs: 2000
-    readonly property real phaseDurationMs: 8000
+    property real warmupMs: 2000
+    property real phaseDurationMs: 8000
     readonly property var editColors: ["#ff3366", "#00d9ff", "#ffd93d", "#0f9d9a"]
 
     // --- driver state ---
@@ -7,6 +7,8 @@
 // scenario, logs a CSV into benchmarks/results/ via BenchLogger, and prints
 // "BENCH DONE <name>" to the console when finished. Selecting a page (re)starts
 // it. Pages can also be run standalone: claydojo --sbx <page>.qml
+// or headless through tools/bench (clay_bench), which redirects each page's
+// BenchLogger output and may shorten its writable warmupMs/step timing.
 
 import QtQuick
 import QtQuick.Layouts
@@ -51,6 +53,7 @@ Rectangle {
                         { name: "Lines - Static", component: "BenchLinesStatic.qml" },
                         { name: "Lines - Dynamic", component: "BenchLinesDynamic.qml" },
                         { name: "Lines - Batch Overdraw", component: "BenchLinesBatch.qml" },
+                        { name: "Lines - Animated (CPU/GPU)", component: "BenchLinesAnimated.qml" },
                         { name: "Connectors - Moving", component: "BenchConnectors.qml" },
                         { name: "Instances - Orbiting", component: "BenchInstances.qml" },
                         { name: "Voxel - Edit Storm", component: "BenchVoxelEdit.qml" },
@@ -7,6 +7,7 @@ VARYING vec2 vUV;
 VARYING vec3 vOrigPosition;
 VARYING vec3 vWorldPosition;
 VARYING float vFaceID;
+VARYING float vEdgeMask;     // per-box mask from Box3DBatch, < 0 = use edgeMask
 
 // Uniforms exposed from the CustomMaterial
 // - bool showEdges
@@ -78,7 +79,8 @@ bool shouldShowEdge(float faceId, vec2 uv) {
     }
 
     // Check if the edge's bit is set in the mask
-    return (edgeMask & edgeBit) != 0;
+    int mask = vEdgeMask < 0.0 ? edgeMask : int(vEdgeMask + 0.5);
+    return (mask & edgeBit) != 0;
 }
 
 void MAIN()
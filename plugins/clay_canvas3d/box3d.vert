@@ -6,6 +6,7 @@ VARYING vec2 vUV;
 VARYING vec3 vOrigPosition;
 VARYING vec3 vWorldPosition;
 VARYING float vFaceID;
+VARYING float vEdgeMask;
 
 void MAIN()
 {
@@ -15,6 +16,9 @@ void MAIN()
     // Pass through texture coordinates for edge detection
     vUV = UV0;
 
+    // Single boxes always use the material's edgeMask
+    vEdgeMask = -1.0;
+
     // Store original position for edge calculations
     vOrigPosition = VERTEX;
 
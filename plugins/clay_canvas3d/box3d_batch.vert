@@ -0,0 +1,34 @@
+// Box3DBatch vertex shader: box3d.vert for an instanced unit box. The
+// transform, color and edge mask come from the Box3DBatchInstancing table.
+VARYING vec3 vNormal;
+VARYING vec3 vViewVec;
+VARYING vec4 colorOut;
+VARYING vec2 vUV;
+VARYING vec3 vOrigPosition;
+VARYING vec3 vWorldPosition;
+VARYING float vFaceID;
+VARYING float vEdgeMask;
+
+void MAIN()
+{
+    colorOut = INSTANCE_COLOR;
+    vUV = UV0;
+
+    // Per-box edge mask (instanceData.x), -1 selects the material's edgeMask
+    vEdgeMask = INSTANCE_DATA.x;
+
+    vOrigPosition = VERTEX;
+    vWorldPosition = (INSTANCE_MODEL_MATRIX * vec4(VERTEX, 1.0)).xyz;
+    vViewVec = VIEW_MATRIX[3].xyz - vWorldPosition;
+    vNormal = normalize(mat3(INSTANCE_MODEL_MATRIX) * NORMAL);
+
+    // Face from the unscaled normal, as in box3d.vert
+    vec3 absNormal = abs(NORMAL);
+    if (absNormal.x > 0.9) {
+        vFaceID = NORMAL.x > 0.0 ? 1.0 : 2.0; // Right or Left face
+    } else if (absNormal.y > 0.9) {
+        vFaceID = NORMAL.y > 0.0 ? 3.0 : 4.0; // Top or Bottom face
+    } else {
+        vFaceID = NORMAL.z > 0.0 ? 5.0 : 6.0; // Front or Back face
+    }
+}
@@ -4,12 +4,17 @@
 // styles (dash/gap/cap/opacity only) take a verbatim hard-edged path; styles
 // that use any of the extended keys (dot/chevron pattern, flow, glow, pulse)
 // take the resolution-independent SDF path below.
-//   styleTable is styleCount columns wide and 3 rows tall (see
-//   LineStyleTextureData::kTableRows). Row 0: dash, gap, capRound, opacity.
+//   styleTable holds one column of 3 texels per style (see
+//   LineStyleTextureData::kTableRows), wrapped into bands of styleTableSize.x
+//   styles for large tables. Row 0: dash, gap, capRound, opacity.
 //   Row 1: patternId (glyph enum | screen-units bit 8), param0 (triangle
 //   base-width fraction, 0 = full width), param1 (reserved), flow.
 //   Row 2: glow, pulse, headLength, headWidth (heads are handled in the
 //   vertex/fragment arrow path).
+// In the animated modes (animMode > 0) a procedural trail can reveal each
+// line only near heads travelling along it: trailLength (world units, 0 =
+// off), trailSpeed (world units per second) and trailPeriod (spacing between
+// heads), offset per line by vPhase.
 
 VARYING vec4 vColor;
 VARYING vec2 vUV;   // x = along-axis coordinate, y = across coordinate
@@ -19,6 +24,7 @@ VARYING float vStyleId;   // constant per segment (same for all 4 quad vertices)
 VARYING float vCapFlags;  // constant per segment: bit0 = start cap, bit1 = end cap
 VARYING float vScreenScale; // screen pixels per world unit for this segment
 VARYING vec2 vHead; // x = arrowhead length (segment-space), y = head half width
+VARYING float vPhase; // per-line time offset (0 in Static mode)
 
 const int PATTERN_DASH = 0;
 const int PATTERN_DOT = 1;
@@ -26,6 +32,18 @@ const int PATTERN_CHEVRON = 2;
 const int PATTERN_TRIANGLE = 3;
 const int SCREEN_UNITS_BIT = 8;
 
+// Row r of style id in the style-table texture: columns of 3 texels, wrapped
+// into bands of styleTableSize.x styles (see LineStyleTextureData).
+vec4 styleRow(float id, int r)
+{
+    float perBand = max(styleTableSize.x, 1.0);
+    float band = floor((id + 0.5) / perBand);
+    float col = id - band * perBand;
+    vec2 uv = vec2((col + 0.5) / perBand,
+                   (band * 3.0 + float(r) + 0.5) / max(styleTableSize.y, 3.0));
+    return texture(styleTable, uv);
+}
+
 // Coverage from a signed distance (dist < 0 is inside). aa <= 0 gives a hard
 // edge (reproduces the legacy discard); aa > 0 gives a soft falloff of that
 // width centred on the boundary (the glow look).
@@ -44,11 +62,22 @@ void MAIN()
     float v = vUV.y;
     float uc = clamp(u, 0.0, segLen);
 
+    // Procedural trail: keep the stretch up to trailLength behind each head,
+    // fading towards its tail.
+    float trailMul = 1.0;
+    if (animMode > 0.5 && trailLength > 0.0) {
+        float trailDist = vDash.x + (segLen > 1e-6 ? uc / segLen : 0.0) * vDash.y;
+        float trailHead = (flowTime + vPhase) * trailSpeed;
+        float behind = mod(trailHead - trailDist, max(trailPeriod, trailLength));
+        if (behind > trailLength)
+            discard;
+        trailMul = 1.0 - behind / trailLength;
+    }
+
     // Look up this line's style (column selected by styleId, three rows tall).
-    float col = (vStyleId + 0.5) / max(styleCount, 1.0);
-    vec4 row0 = texture(styleTable, vec2(col, 0.5 / 3.0));
-    vec4 row1 = texture(styleTable, vec2(col, 1.5 / 3.0));
-    vec4 row2 = texture(styleTable, vec2(col, 2.5 / 3.0));
+    vec4 row0 = styleRow(vStyleId, 0);
+    vec4 row1 = styleRow(vStyleId, 1);
+    vec4 row2 = styleRow(vStyleId, 2);
 
     float dashLen = row0.r;
     float gapLen = row0.g;
@@ -96,7 +125,7 @@ void MAIN()
                 discard;
         }
 
-        FRAGCOLOR = vec4(vColor.rgb, vColor.a * opacity);
+        FRAGCOLOR = vec4(vColor.rgb, vColor.a * opacity * trailMul);
         return;
     }
 
@@ -148,7 +177,7 @@ void MAIN()
             float oscH = 0.5 + 0.5 * sin(flowTime * 3.0);
             pulseMulH = mix(1.0, oscH, pulse);
         }
-        float alphaHead = vColor.a * opacity * pulseMulH * cov;
+        float alphaHead = vColor.a * opacity * pulseMulH * cov * trailMul;
         if (alphaHead < 0.003)
             discard;
         FRAGCOLOR = vec4(vColor.rgb, alphaHead);
@@ -259,7 +288,7 @@ void MAIN()
         pulseMul = mix(1.0, osc, pulse);
     }
 
-    float alpha = vColor.a * opacity * pulseMul * bodyCov * patCov;
+    float alpha = vColor.a * opacity * pulseMul * bodyCov * patCov * trailMul;
     if (alpha < 0.003)
         discard;
     FRAGCOLOR = vec4(vColor.rgb, alpha);
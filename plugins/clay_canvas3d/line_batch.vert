@@ -7,6 +7,13 @@
 //   INSTANCE_DATA.x     = line width (pixels in Pixel mode, world in World mode)
 //   INSTANCE_DATA.y     = styleId (row in the style-table texture)
 //   INSTANCE_DATA.z     = accumulated path distance at this segment's start
+//   INSTANCE_DATA.w     = cap flags (bit0 = start cap, bit1 = end cap)
+// The animated modes (animMode > 0) repack the instance data:
+//   INSTANCE_DATA.y     = styleId + capFlags * 65536
+//   INSTANCE_DATA.z     = path distance (Procedural) or the segment's first
+//                         point index into keyframeTable (Keyframes)
+//   INSTANCE_DATA.w     = per-line time offset (seconds)
+// and in Keyframes mode the instance transform is the identity.
 // Material uniforms (bound from LineBatch3D):
 //   viewportSize        = View3D pixel size (vec2)
 //   widthMode           = 0.0 -> Pixel width, 1.0 -> World width
@@ -16,6 +23,16 @@
 //   depthJitter         = 1.0 in opaque mode -> tiny per-instance depth offset
 //                         (deterministic table-order tie-break for coplanar
 //                          lines), 0.0 otherwise
+//   animMode            = 0 Static, 1 Keyframes, 2 Procedural
+//   flowTime            = shared animation clock (seconds)
+//   styleTable          = style table, 3 texels per style (see line_batch.frag)
+//   styleTableSize      = styleTable size in texels
+//   keyframeTable       = RGBA32F points (xyz + path distance), keyframe-major
+//   keyframeTexSize     = keyframeTable size in texels
+//   keyframeCount, keyframePointCount, keyframeRate (keyframes per second),
+//   keyframeLoop        = 1.0 wraps last -> first, 0.0 holds the last keyframe
+//   swayAmplitude, swayAxis, swayFrequency (Hz), swayWavelength (world units)
+//                       = procedural travelling sine displacement
 
 VARYING vec4 vColor;
 VARYING vec2 vUV;   // x = coordinate along segment axis, y = coordinate across
@@ -27,6 +44,36 @@ VARYING float vScreenScale; // screen pixels per world unit for this segment
                             // (used by screen-space pattern periods)
 VARYING vec2 vHead; // x = arrowhead length (segment-space), y = head half width;
                     // (0, 0) when this segment has no arrowhead
+VARYING float vPhase; // per-line time offset (0 in Static mode)
+
+// Point p of keyframe k, as (xyz, accumulated path distance).
+vec4 keyframePoint(int k, int p)
+{
+    int idx = k * int(keyframePointCount + 0.5) + p;
+    int w = int(keyframeTexSize.x + 0.5);
+    vec2 uv = (vec2(float(idx % w), float(idx / w)) + 0.5) / keyframeTexSize;
+    return texture(keyframeTable, uv);
+}
+
+// Row r of style id in the style-table texture: columns of 3 texels, wrapped
+// into bands of styleTableSize.x styles (see LineStyleTextureData).
+vec4 styleRow(float id, int r)
+{
+    float perBand = max(styleTableSize.x, 1.0);
+    float band = floor((id + 0.5) / perBand);
+    float col = id - band * perBand;
+    vec2 uv = vec2((col + 0.5) / perBand,
+                   (band * 3.0 + float(r) + 0.5) / max(styleTableSize.y, 3.0));
+    return texture(styleTable, uv);
+}
+
+// Travelling sine along the path: dist in world units, time in seconds.
+vec3 sway(float dist, float time)
+{
+    float phase = 6.2831853 * (swayFrequency * time
+                               - dist / max(swayWavelength, 1e-3));
+    return swayAxis * (swayAmplitude * sin(phase));
+}
 
 void MAIN()
 {
@@ -39,10 +86,23 @@ void MAIN()
     float width = INSTANCE_DATA.x;
     float halfW = 0.5 * width;
 
+    bool animated = animMode > 0.5;
+    float styleId;
+    int capFlagsI;
+    float linePhase = 0.0;
+    if (animated) {
+        float packedStyle = INSTANCE_DATA.y + 0.5;
+        capFlagsI = int(packedStyle / 65536.0);
+        styleId = floor(packedStyle - float(capFlagsI) * 65536.0);
+        linePhase = INSTANCE_DATA.w;
+    } else {
+        styleId = INSTANCE_DATA.y;
+        capFlagsI = int(INSTANCE_DATA.w + 0.5);
+    }
+
     // Cap flags decide which ends grow a longitudinal cap extension. Interior
     // (non-flagged) ends stay flush at the segment endpoint so joints are not
     // shaded twice; the neighbouring segment's end cap fills the joint.
-    int capFlagsI = int(INSTANCE_DATA.w + 0.5);
     bool startCap = (capFlagsI & 1) != 0;
     bool endCap = (capFlagsI & 2) != 0;
     bool endFlagged = (t < 0.5) ? startCap : endCap;
@@ -51,8 +111,7 @@ void MAIN()
     // as raw line-width multiples straight from the style). Heads are a
     // single-segment feature (capFlags == 3), so a widened quad only appears
     // where it is a real end.
-    float styleCol = (INSTANCE_DATA.y + 0.5) / max(styleCount, 1.0);
-    vec4 headRow = texture(styleTable, vec2(styleCol, 2.5 / 3.0));
+    vec4 headRow = styleRow(styleId, 2);
     float headWidM = headRow.a;   // requested head base width (shaft-width mult)
     float headLenM = headRow.b;   // requested head length (shaft-width mult)
     bool headActive = (headWidM > 0.0) && (capFlagsI == 3);
@@ -78,16 +137,59 @@ void MAIN()
     // Base-space segment endpoints.
     vec4 base0 = vec4(0.0, 0.0, 0.0, 1.0);
     vec4 base1 = vec4(1.0, 0.0, 0.0, 1.0);
+    float dist0 = INSTANCE_DATA.z;
+
+    // Keyframes: the endpoints are interpolated from the keyframe table at
+    // this line's time (the instance transform is the identity).
+    float keyframeSegDist = -1.0;
+    if (animMode > 0.5 && animMode < 1.5) {
+        int kCount = max(int(keyframeCount + 0.5), 1);
+        float f = (flowTime + linePhase) * keyframeRate;
+        int k0;
+        int k1;
+        if (keyframeLoop > 0.5) {
+            f = mod(f, float(kCount));
+            k0 = min(int(floor(f)), kCount - 1);
+            k1 = (k0 + 1) % kCount;
+        } else {
+            f = clamp(f, 0.0, float(kCount - 1));
+            k0 = int(floor(f));
+            k1 = min(k0 + 1, kCount - 1);
+        }
+        float a = clamp(f - float(k0), 0.0, 1.0);
+        int p = int(INSTANCE_DATA.z + 0.5);
+        vec4 kp0 = mix(keyframePoint(k0, p), keyframePoint(k1, p), a);
+        vec4 kp1 = mix(keyframePoint(k0, p + 1), keyframePoint(k1, p + 1), a);
+        base0 = vec4(kp0.xyz, 1.0);
+        base1 = vec4(kp1.xyz, 1.0);
+        dist0 = kp0.w;
+        keyframeSegDist = kp1.w - kp0.w;
+    }
 
     // World-space endpoints. Dash distance is measured in world units in both
     // width modes so the pattern stays consistent when zooming.
     vec3 wP0 = (INSTANCE_MODEL_MATRIX * base0).xyz;
     vec3 wP1 = (INSTANCE_MODEL_MATRIX * base1).xyz;
-    float worldSegLen = length(wP1 - wP0);
+    // Path distance covered by this segment before any procedural motion, so
+    // neighbouring segments agree on the distance (and sway) at their joint.
+    float segDist = keyframeSegDist >= 0.0 ? keyframeSegDist : length(wP1 - wP0);
 
     // Clip-space endpoints of the segment.
-    vec4 clip0 = INSTANCE_MODELVIEWPROJECTION_MATRIX * base0;
-    vec4 clip1 = INSTANCE_MODELVIEWPROJECTION_MATRIX * base1;
+    vec4 clip0;
+    vec4 clip1;
+    if (animated) {
+        if (swayAmplitude != 0.0) {
+            float time = flowTime + linePhase;
+            wP0 += sway(dist0, time);
+            wP1 += sway(dist0 + segDist, time);
+        }
+        clip0 = VIEWPROJECTION_MATRIX * vec4(wP0, 1.0);
+        clip1 = VIEWPROJECTION_MATRIX * vec4(wP1, 1.0);
+    } else {
+        clip0 = INSTANCE_MODELVIEWPROJECTION_MATRIX * base0;
+        clip1 = INSTANCE_MODELVIEWPROJECTION_MATRIX * base1;
+    }
+    float worldSegLen = length(wP1 - wP0);
 
     vec4 clipPos = mix(clip0, clip1, t);
     float segLen;
@@ -144,9 +246,12 @@ void MAIN()
     // just discard headroom on flagged ends and zero on flush joint ends.
     vUV = vec2(t * segLen + capDir * capExt, side * drawHalfW);
     vCap = vec2(segLen, halfW);
-    vDash = vec2(INSTANCE_DATA.z, worldSegLen);
-    vStyleId = INSTANCE_DATA.y;
-    vCapFlags = INSTANCE_DATA.w;
+    // Animated modes measure patterns along the undisplaced path so they stay
+    // continuous across joints while the lines move.
+    vDash = animated ? vec2(dist0, segDist) : vec2(INSTANCE_DATA.z, worldSegLen);
+    vStyleId = styleId;
+    vCapFlags = float(capFlagsI);
+    vPhase = linePhase;
     // Head length is min(proportion-capped request, segment length); on segments
     // shorter than the head the WHOLE head scales down (proportions preserved),
     // so a short tip segment still yields a well-formed arrow rather than one
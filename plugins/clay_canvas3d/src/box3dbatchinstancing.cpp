@@ -0,0 +1,194 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+#include "box3dbatchinstancing.h"
+#include "perftrace.h"
+#include <cstring>
+
+/*!
+    \qmltype Box3DBatchInstancing
+    \nativetype Box3DBatchInstancing
+    \inqmlmodule Clayground.Canvas3D
+    \brief Instance table for Box3DBatch.
+
+    Holds one entry per box (position, size, color, edge mask) over the unit
+    Box3DGeometry. It is used internally by Box3DBatch, which pairs it with
+    the matching material; use that type instead of this one directly.
+
+    \sa Box3DBatch
+*/
+
+using Entry = QQuick3DInstancing::InstanceTableEntry;
+static constexpr int kEntrySize = sizeof(Entry); // 80 bytes: 5 x vec4
+
+// instanceData.x value meaning "use the material's edgeMask".
+static constexpr float kMaterialEdgeMask = -1.0f;
+
+static QVector3D toVector3D(const QVariant &v, const QVector3D &fallback)
+{
+    if (v.canConvert<QVector3D>())
+        return v.value<QVector3D>();
+    const QVariantList l = v.toList();
+    if (l.size() >= 3)
+        return QVector3D(l.at(0).toFloat(), l.at(1).toFloat(), l.at(2).toFloat());
+    return fallback;
+}
+
+Box3DBatchInstancing::Box3DBatchInstancing(QQuick3DObject *parent)
+    : QQuick3DInstancing(parent)
+{
+}
+
+/*!
+    \qmlproperty list Box3DBatchInstancing::boxes
+    \brief Declarative list of boxes (convenience path).
+
+    Each element is an object
+    \c{{ position: Qt.vector3d, size: Qt.vector3d, color: <color>, edgeMask: <int> }}.
+    \c size defaults to (1, 1, 1), \c color to white and \c edgeMask to the
+    material's. Reset to an empty list by \l setBulk.
+*/
+QVariantList Box3DBatchInstancing::boxes() const
+{
+    return m_boxes;
+}
+
+void Box3DBatchInstancing::setBoxes(const QVariantList &boxes)
+{
+    CLAY_PERF_ZONE("boxes.setBoxes");
+    m_boxes = boxes;
+    const int n = static_cast<int>(boxes.size());
+    m_data.resize(static_cast<qsizetype>(n) * kEntrySize);
+    char *dst = m_data.data();
+    for (int i = 0; i < n; ++i) {
+        const QVariantMap box = boxes.at(i).toMap();
+        const QColor c = box.value(QStringLiteral("color")).value<QColor>();
+        const QVector4D color = c.isValid() ? QVector4D(c.redF(), c.greenF(), c.blueF(), c.alphaF())
+                                            : QVector4D(1.0f, 1.0f, 1.0f, 1.0f);
+        const QVariant mask = box.value(QStringLiteral("edgeMask"));
+        writeEntry(dst + static_cast<qsizetype>(i) * kEntrySize,
+                   toVector3D(box.value(QStringLiteral("position")), QVector3D()),
+                   toVector3D(box.value(QStringLiteral("size")), QVector3D(1.0f, 1.0f, 1.0f)),
+                   color, mask.isValid() ? float(mask.toInt() & 0xFF) : kMaterialEdgeMask);
+    }
+    setCount(n);
+    markDirty();
+    emit boxesChanged();
+}
+
+/*!
+    \qmlproperty int Box3DBatchInstancing::count
+    \readonly
+    \brief The number of boxes in the table.
+*/
+int Box3DBatchInstancing::count() const
+{
+    return m_count;
+}
+
+/*!
+    \qmlmethod void Box3DBatchInstancing::setBulk(ByteArray positions, ByteArray sizes, ByteArray colors, ByteArray edgeMasks)
+    \brief Replaces all boxes from packed buffers.
+
+    \a positions and \a sizes hold three float32 per box, \a colors four
+    uint8 (rgba) per box and the optional \a edgeMasks one uint8 per box.
+    The box count is taken from \a positions; boxes beyond the end of a
+    shorter buffer get size (1, 1, 1), white and the material's edge mask.
+*/
+void Box3DBatchInstancing::setBulk(const QByteArray &positions,
+                                   const QByteArray &sizes,
+                                   const QByteArray &colors,
+                                   const QByteArray &edgeMasks)
+{
+    CLAY_PERF_ZONE("boxes.setBulk");
+    const int n = static_cast<int>(positions.size() / (3 * sizeof(float)));
+    const int numSizes = static_cast<int>(sizes.size() / (3 * sizeof(float)));
+    const int numColors = static_cast<int>(colors.size() / 4);
+    const int numMasks = static_cast<int>(edgeMasks.size());
+
+    const auto *pos = reinterpret_cast<const float *>(positions.constData());
+    const auto *siz = reinterpret_cast<const float *>(sizes.constData());
+    const auto *col = reinterpret_cast<const quint8 *>(colors.constData());
+    const auto *msk = reinterpret_cast<const quint8 *>(edgeMasks.constData());
+
+    m_data.resize(static_cast<qsizetype>(n) * kEntrySize);
+    char *dst = m_data.data();
+    for (int i = 0; i < n; ++i) {
+        const float *p = pos + 3 * i;
+        const QVector3D size = i < numSizes ? QVector3D(siz[3 * i], siz[3 * i + 1], siz[3 * i + 2])
+                                            : QVector3D(1.0f, 1.0f, 1.0f);
+        const QVector4D color = i < numColors
+            ? QVector4D(col[4 * i], col[4 * i + 1], col[4 * i + 2], col[4 * i + 3]) / 255.0f
+            : QVector4D(1.0f, 1.0f, 1.0f, 1.0f);
+        writeEntry(dst + static_cast<qsizetype>(i) * kEntrySize, QVector3D(p[0], p[1], p[2]),
+                   size, color, i < numMasks ? float(msk[i]) : kMaterialEdgeMask);
+    }
+
+    const bool hadBoxes = !m_boxes.isEmpty();
+    m_boxes.clear();
+    setCount(n);
+    markDirty();
+    if (hadBoxes)
+        emit boxesChanged();
+}
+
+/*!
+    \qmlmethod void Box3DBatchInstancing::setBoxColor(int index, color color)
+    \brief Recolors one box in place.
+*/
+void Box3DBatchInstancing::setBoxColor(int index, const QColor &color)
+{
+    Entry *e = entryAt(index);
+    if (!e)
+        return;
+    e->color = QVector4D(color.redF(), color.greenF(), color.blueF(), color.alphaF());
+    markDirty();
+}
+
+/*!
+    \qmlmethod void Box3DBatchInstancing::setBoxEdgeMask(int index, int edgeMask)
+    \brief Sets one box's edge mask in place; a negative \a edgeMask reverts
+    to the material's.
+*/
+void Box3DBatchInstancing::setBoxEdgeMask(int index, int edgeMask)
+{
+    Entry *e = entryAt(index);
+    if (!e)
+        return;
+    e->instanceData.setX(edgeMask < 0 ? kMaterialEdgeMask : float(edgeMask & 0xFF));
+    markDirty();
+}
+
+void Box3DBatchInstancing::writeEntry(char *dst, const QVector3D &position, const QVector3D &size,
+                                      const QVector4D &color, float edgeMask)
+{
+    // translate(position) * scale(size), stored as three row vectors with the
+    // translation in w - no rotation, so no calculateTableEntry round trip.
+    Entry e;
+    e.row0 = QVector4D(size.x(), 0.0f, 0.0f, position.x());
+    e.row1 = QVector4D(0.0f, size.y(), 0.0f, position.y());
+    e.row2 = QVector4D(0.0f, 0.0f, size.z(), position.z());
+    e.color = color;
+    e.instanceData = QVector4D(edgeMask, 0.0f, 0.0f, 0.0f);
+    std::memcpy(dst, &e, kEntrySize);
+}
+
+void Box3DBatchInstancing::setCount(int count)
+{
+    if (m_count == count)
+        return;
+    m_count = count;
+    emit countChanged();
+}
+
+Entry *Box3DBatchInstancing::entryAt(int index)
+{
+    if (index < 0 || index >= m_count)
+        return nullptr;
+    return reinterpret_cast<Entry *>(m_data.data() + static_cast<qsizetype>(index) * kEntrySize);
+}
+
+QByteArray Box3DBatchInstancing::getInstanceBuffer(int *instanceCount)
+{
+    if (instanceCount)
+        *instanceCount = m_count;
+    return m_data;
+}
@@ -0,0 +1,62 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+#ifndef BOX3DBATCHINSTANCING_H
+#define BOX3DBATCHINSTANCING_H
+
+#include <QQuick3DInstancing>
+#include <QVector3D>
+#include <QVector4D>
+#include <QVariantList>
+#include <QByteArray>
+#include <QColor>
+
+// Instance table behind Box3DBatch: one 80-byte entry per box over the unit
+// Box3DGeometry, so any number of boxes draw in one call with the Box3D
+// look. The transform is translate(position) * scale(size) (the unit box has
+// its origin at the bottom center), the entry color is the box color and
+// instanceData.x carries the per-box edge mask, or -1 to use the material's.
+class Box3DBatchInstancing : public QQuick3DInstancing
+{
+    Q_OBJECT
+    QML_NAMED_ELEMENT(Box3DBatchInstancing)
+
+    Q_PROPERTY(QVariantList boxes READ boxes WRITE setBoxes NOTIFY boxesChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    explicit Box3DBatchInstancing(QQuick3DObject *parent = nullptr);
+
+    QVariantList boxes() const;
+    void setBoxes(const QVariantList &boxes);
+
+    int count() const;
+
+    // Packed path: float32 xyz positions and sizes, rgba8 colors and an
+    // optional uint8 edge mask per box. Missing masks use the material's.
+    Q_INVOKABLE void setBulk(const QByteArray &positions,
+                             const QByteArray &sizes,
+                             const QByteArray &colors,
+                             const QByteArray &edgeMasks = QByteArray());
+
+    // Occasional per-box edits, patched in place (e.g. selection highlight).
+    Q_INVOKABLE void setBoxColor(int index, const QColor &color);
+    Q_INVOKABLE void setBoxEdgeMask(int index, int edgeMask);
+
+signals:
+    void boxesChanged();
+    void countChanged();
+
+protected:
+    QByteArray getInstanceBuffer(int *instanceCount) override;
+
+private:
+    static void writeEntry(char *dst, const QVector3D &position, const QVector3D &size,
+                           const QVector4D &color, float edgeMask);
+    void setCount(int count);
+    InstanceTableEntry *entryAt(int index);
+
+    QVariantList m_boxes;
+    QByteArray m_data; // count * 80 bytes
+    int m_count = 0;
+};
+
+#endif // BOX3DBATCHINSTANCING_H
@@ -1,4 +1,6 @@
 #include "box3dgeometry.h"
+#include "perftrace.h"
+#include <QHash>
 
 /*!
     \qmltype Box3DGeometry
@@ -102,6 +104,48 @@
     \value Box3DGeometry.RightEdges Show only right face edges
 */
 
+namespace {
+
+// Everything the vertex buffer depends on. The edge properties are material
+// uniforms and never touch the buffer, so they are not part of the key.
+struct BoxShapeKey
+{
+    QVector3D size;
+    QVector2D faceScale; // (1, 1) whenever scaledFace is NoFace
+    int scaledFace = 0;
+
+    bool operator==(const BoxShapeKey &o) const
+    {
+        return size == o.size && faceScale == o.faceScale && scaledFace == o.scaledFace;
+    }
+};
+
+size_t qHash(const BoxShapeKey &k, size_t seed = 0)
+{
+    return qHashMulti(seed, k.size.x(), k.size.y(), k.size.z(),
+                      k.faceScale.x(), k.faceScale.y(), k.scaledFace);
+}
+
+struct BoxShape
+{
+    QByteArray vertexData;
+    QVector3D maxBounds;
+};
+
+// Process-wide buffer cache (GUI thread only, like the geometries using it).
+// QByteArray is implicitly shared, so every Box3DGeometry with the same shape
+// holds the same allocation. Animated sizes would grow the cache without
+// bound, so it is simply dropped when full; live geometries keep their data.
+constexpr int kMaxCachedShapes = 4096;
+
+QHash<BoxShapeKey, BoxShape> &shapeCache()
+{
+    static QHash<BoxShapeKey, BoxShape> cache;
+    return cache;
+}
+
+} // namespace
+
 Box3dGeometry::Box3dGeometry() : m_size(1, 1, 1), m_faceScale(1, 1), m_scaledFace(NoFace),
     m_showEdges(true), m_edgeThickness(0.03f), m_edgeColorFactor(0.4f), m_edgeMask(AllEdges)
 {
@@ -150,22 +194,25 @@ void Box3dGeometry::setScaledFace(ScaledFace newScaledFace)
     updateData();
 }
 
-void Box3dGeometry::updateData()
+namespace {
+
+BoxShape buildShape(const BoxShapeKey &key)
 {
+    CLAY_PERF_ZONE("box3d.buildShape");
     // Define the 8 vertices of the box
     QVector3D v0, v1, v2, v3, v4, v5, v6, v7;
 
     // Define base vertex positions
-    float halfX = m_size.x() / 2;
-    float height = m_size.y();
-    float halfZ = m_size.z() / 2;
+    float halfX = key.size.x() / 2;
+    float height = key.size.y();
+    float halfZ = key.size.z() / 2;
 
     // Apply scaling to specific face if specified
     float scaledHalfX = halfX;
     float scaledHalfZ = halfZ;
-    if (m_scaledFace != NoFace) {
-        scaledHalfX = halfX * m_faceScale.x();
-        scaledHalfZ = halfZ * m_faceScale.y();
+    if (key.scaledFace != Box3dGeometry::NoFace) {
+        scaledHalfX = halfX * key.faceScale.x();
+        scaledHalfZ = halfZ * key.faceScale.y();
     }
 
     // Default vertex positions (unmodified)
@@ -186,43 +233,43 @@ void Box3dGeometry::updateData()
     v7 = QVector3D(-halfX, height, halfZ);   // Left top front
 
     // Apply face scaling if needed
-    switch (m_scaledFace) {
-    case TopFace:
+    switch (key.scaledFace) {
+    case Box3dGeometry::TopFace:
         // Scale top face (v3, v2, v6, v7)
         v3 = QVector3D(-scaledHalfX, height, -scaledHalfZ);
         v2 = QVector3D(scaledHalfX, height, -scaledHalfZ);
         v6 = QVector3D(scaledHalfX, height, scaledHalfZ);
         v7 = QVector3D(-scaledHalfX, height, scaledHalfZ);
         break;
-    case BottomFace:
+    case Box3dGeometry::BottomFace:
         // Scale bottom face (v0, v1, v5, v4)
         v0 = QVector3D(-scaledHalfX, 0, -scaledHalfZ);
         v1 = QVector3D(scaledHalfX, 0, -scaledHalfZ);
         v5 = QVector3D(scaledHalfX, 0, scaledHalfZ);
         v4 = QVector3D(-scaledHalfX, 0, scaledHalfZ);
         break;
-    case FrontFace:
+    case Box3dGeometry::FrontFace:
         // Scale front face (v4, v5, v6, v7)
         v4 = QVector3D(-scaledHalfX, 0, halfZ);
         v5 = QVector3D(scaledHalfX, 0, halfZ);
         v6 = QVector3D(scaledHalfX, height, halfZ);
         v7 = QVector3D(-scaledHalfX, height, halfZ);
         break;
-    case BackFace:
+    case Box3dGeometry::BackFace:
         // Scale back face (v0, v1, v2, v3)
         v0 = QVector3D(-scaledHalfX, 0, -halfZ);
         v1 = QVector3D(scaledHalfX, 0, -halfZ);
         v2 = QVector3D(scaledHalfX, height, -halfZ);
         v3 = QVector3D(-scaledHalfX, height, -halfZ);
         break;
-    case LeftFace:
+    case Box3dGeometry::LeftFace:
         // Scale left face (v0, v3, v7, v4)
         v0 = QVector3D(-halfX, 0, -scaledHalfZ);
         v3 = QVector3D(-halfX, height, -scaledHalfZ);
         v7 = QVector3D(-halfX, height, scaledHalfZ);
         v4 = QVector3D(-halfX, 0, scaledHalfZ);
         break;
-    case RightFace:
+    case Box3dGeometry::RightFace:
         // Scale right face (v1, v2, v6, v5)
         v1 = QVector3D(halfX, 0, -scaledHalfZ);
         v2 = QVector3D(halfX, height, -scaledHalfZ);
@@ -251,6 +298,7 @@ void Box3dGeometry::updateData()
 
     // Create a QByteArray to store interleaved vertex, normal, and UV data
     QByteArray vertexData;
+    vertexData.reserve(36 * (sizeof(QVector3D) + sizeof(QVector3D) + sizeof(QVector2D)));
 
     // Lambda function to append vertex, normal, and UV data to vertexData
     auto appendVertexData = [&](const QVector3D& vertex, const QVector3D& normal, const QVector2D& uv) {
@@ -314,29 +362,23 @@ void Box3dGeometry::updateData()
     appendVertexData(v1, nBottom, uvBR);
     appendVertexData(v5, nBottom, uvTR);
 
-    // Set the vertex data
-    setVertexData(vertexData);
-
-    // Set up attribute information for vertices, normals, and UV coordinates
-    setStride(sizeof(QVector3D) + sizeof(QVector3D) + sizeof(QVector2D));  // Position + Normal + UV data
-
     // Update the bounds to account for the scaled face
     QVector3D maxBounds(halfX, height, halfZ);
 
     // Adjust bounds based on which face is scaled (if any)
-    if (m_scaledFace != NoFace) {
-        switch (m_scaledFace) {
-        case TopFace:
-        case BottomFace:
+    if (key.scaledFace != Box3dGeometry::NoFace) {
+        switch (key.scaledFace) {
+        case Box3dGeometry::TopFace:
+        case Box3dGeometry::BottomFace:
             maxBounds.setX(qMax(halfX, scaledHalfX));
             maxBounds.setZ(qMax(halfZ, scaledHalfZ));
             break;
-        case FrontFace:
-        case BackFace:
+        case Box3dGeometry::FrontFace:
+        case Box3dGeometry::BackFace:
             maxBounds.setX(qMax(halfX, scaledHalfX));
             break;
-        case LeftFace:
-        case RightFace:
+        case Box3dGeometry::LeftFace:
+        case Box3dGeometry::RightFace:
             maxBounds.setZ(qMax(halfZ, scaledHalfZ));
             break;
         default:
@@ -344,7 +386,33 @@ void Box3dGeometry::updateData()
         }
     }
 
-    setBounds(-maxBounds, maxBounds);
+    return {vertexData, maxBounds};
+}
+
+} // namespace
+
+void Box3dGeometry::updateData()
+{
+    BoxShapeKey key;
+    key.size = m_size;
+    key.scaledFace = m_scaledFace;
+    key.faceScale = m_scaledFace == NoFace ? QVector2D(1, 1) : m_faceScale;
+
+    QHash<BoxShapeKey, BoxShape> &cache = shapeCache();
+    auto it = cache.constFind(key);
+    if (it == cache.constEnd()) {
+        if (cache.size() >= kMaxCachedShapes)
+            cache.clear();
+        it = cache.insert(key, buildShape(key));
+    }
+    CLAY_PERF_COUNTER("box3d.cachedShapes", cache.size());
+
+    clear();
+    setVertexData(it->vertexData);
+
+    // Set up attribute information for vertices, normals, and UV coordinates
+    setStride(sizeof(QVector3D) + sizeof(QVector3D) + sizeof(QVector2D));  // Position + Normal + UV data
+    setBounds(-it->maxBounds, it->maxBounds);
 
     // Add position attribute (offset 0)
     addAttribute(QQuick3DGeometry::Attribute::PositionSemantic,
@@ -366,7 +434,18 @@ void Box3dGeometry::updateData()
     update();
 }
 
-// Edge rendering property implementations
+int Box3dGeometry::cachedShapeCount()
+{
+    return static_cast<int>(shapeCache().size());
+}
+
+void Box3dGeometry::clearShapeCache()
+{
+    shapeCache().clear();
+}
+
+// Edge rendering property implementations. These only feed material
+// uniforms (see Box3D.qml), so changing them never re-uploads the buffer.
 bool Box3dGeometry::showEdges() const
 {
     return m_showEdges;
@@ -378,7 +457,6 @@ void Box3dGeometry::setShowEdges(bool show)
         return;
     m_showEdges = show;
     emit showEdgesChanged();
-    update();
 }
 
 float Box3dGeometry::edgeThickness() const
@@ -392,7 +470,6 @@ void Box3dGeometry::setEdgeThickness(float thickness)
         return;
     m_edgeThickness = thickness;
     emit edgeThicknessChanged();
-    update();
 }
 
 float Box3dGeometry::edgeColorFactor() const
@@ -406,7 +483,6 @@ void Box3dGeometry::setEdgeColorFactor(float factor)
         return;
     m_edgeColorFactor = factor;
     emit edgeColorFactorChanged();
-    update();
 }
 
 int Box3dGeometry::edgeMask() const
@@ -420,5 +496,4 @@ void Box3dGeometry::setEdgeMask(int mask)
         return;
     m_edgeMask = mask;
     emit edgeMaskChanged();
-    update();
 }
@@ -79,6 +79,11 @@ public:
     int edgeMask() const;
     void setEdgeMask(int mask);
 
+    // Vertex buffers are shared process-wide between geometries of the same
+    // shape (size, faceScale, scaledFace).
+    static int cachedShapeCount();
+    static void clearShapeCache();
+
 signals:
     void sizeChanged();
     void faceScaleChanged();
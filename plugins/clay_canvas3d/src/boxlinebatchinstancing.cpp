@@ -0,0 +1,206 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+#include "boxlinebatchinstancing.h"
+#include "line3dinstancing.h"
+#include "perftrace.h"
+#include <cstring>
+
+/*!
+    \qmltype BoxLineBatchInstancing
+    \nativetype BoxLineBatchInstancing
+    \inqmlmodule Clayground.Canvas3D
+    \brief Shared instance table for many box-segment lines.
+
+    Holds the segments of any number of lines in one table over a unit cube,
+    each line in its own slice addressed by the handle \l addLine returns.
+    Moving a line with an unchanged segment count rewrites only its slice;
+    layout changes are compacted once before the next upload. Used by
+    LineLayer3D to draw the BoxLine3D items attached to it in one call.
+
+    \sa LineLayer3D, BoxLine3D, LineInstancing
+*/
+
+using Entry = QQuick3DInstancing::InstanceTableEntry;
+
+BoxLineBatchInstancing::BoxLineBatchInstancing(QQuick3DObject *parent)
+    : QQuick3DInstancing(parent)
+{
+}
+
+/*!
+    \qmlproperty int BoxLineBatchInstancing::lineCount
+    \readonly
+    \brief The number of registered lines.
+*/
+
+/*!
+    \qmlproperty int BoxLineBatchInstancing::count
+    \readonly
+    \brief The number of segment instances across all lines.
+*/
+
+/*!
+    \qmlmethod int BoxLineBatchInstancing::addLine(list<vector3d> points, real width, color color)
+    \brief Adds a line and returns its handle.
+*/
+int BoxLineBatchInstancing::addLine(const QList<QVector3D> &points, float width, const QColor &color)
+{
+    int handle;
+    if (!m_freeHandles.isEmpty()) {
+        handle = m_freeHandles.takeLast();
+    } else {
+        handle = static_cast<int>(m_lines.size());
+        m_lines.append(Line());
+    }
+    Line &line = m_lines[handle];
+    line = Line();
+    line.points = points;
+    line.width = width;
+    line.color = color;
+    line.alive = true;
+    m_layoutDirty = true;
+    adjustCounts(1, segmentsOf(line));
+    markDirty();
+    return handle;
+}
+
+/*!
+    \qmlmethod void BoxLineBatchInstancing::removeLine(int handle)
+    \brief Removes a line; its handle may be reused by a later addLine.
+*/
+void BoxLineBatchInstancing::removeLine(int handle)
+{
+    Line *line = lineAt(handle);
+    if (!line)
+        return;
+    adjustCounts(-1, -segmentsOf(*line));
+    *line = Line();
+    m_freeHandles.append(handle);
+    m_layoutDirty = true;
+    markDirty();
+}
+
+/*!
+    \qmlmethod void BoxLineBatchInstancing::setLinePoints(int handle, list<vector3d> points)
+    \brief Replaces a line's points, patching its slice in place when the
+    segment count is unchanged.
+*/
+void BoxLineBatchInstancing::setLinePoints(int handle, const QList<QVector3D> &points)
+{
+    CLAY_PERF_ZONE("boxlines.setLinePoints");
+    Line *line = lineAt(handle);
+    if (!line)
+        return;
+    const int oldSegments = segmentsOf(*line);
+    line->points = points;
+    const int segments = segmentsOf(*line);
+    if (!m_layoutDirty && !line->stale && segments == line->instanceCount) {
+        auto *dst = reinterpret_cast<Entry *>(m_data.data()) + line->instanceStart;
+        writeSlice(dst, *line);
+    } else {
+        line->stale = true;
+        if (segments != oldSegments) {
+            m_layoutDirty = true;
+            adjustCounts(0, segments - oldSegments);
+        }
+    }
+    markDirty();
+}
+
+/*!
+    \qmlmethod void BoxLineBatchInstancing::setLineStyle(int handle, real width, color color)
+    \brief Changes a line's width and color in place.
+*/
+void BoxLineBatchInstancing::setLineStyle(int handle, float width, const QColor &color)
+{
+    Line *line = lineAt(handle);
+    if (!line)
+        return;
+    line->width = width;
+    line->color = color;
+    if (!m_layoutDirty && !line->stale) {
+        auto *dst = reinterpret_cast<Entry *>(m_data.data()) + line->instanceStart;
+        writeSlice(dst, *line);
+    } else {
+        line->stale = true;
+    }
+    markDirty();
+}
+
+/*!
+    \qmlmethod void BoxLineBatchInstancing::clear()
+    \brief Removes all lines and invalidates every handle.
+*/
+void BoxLineBatchInstancing::clear()
+{
+    m_lines.clear();
+    m_freeHandles.clear();
+    m_data.clear();
+    m_layoutDirty = false;
+    adjustCounts(-m_lineCount, -m_instanceCount);
+    markDirty();
+}
+
+int BoxLineBatchInstancing::segmentsOf(const Line &line)
+{
+    return line.points.size() > 1 ? static_cast<int>(line.points.size()) - 1 : 0;
+}
+
+BoxLineBatchInstancing::Line *BoxLineBatchInstancing::lineAt(int handle)
+{
+    if (handle < 0 || handle >= m_lines.size() || !m_lines[handle].alive)
+        return nullptr;
+    return &m_lines[handle];
+}
+
+void BoxLineBatchInstancing::writeSlice(Entry *dst, const Line &line) const
+{
+    const int segments = segmentsOf(line);
+    for (int s = 0; s < segments; ++s)
+        dst[s] = LineInstancing::segmentEntry(line.points[s], line.points[s + 1],
+                                              line.width, line.color);
+}
+
+// Compacts the live lines into a fresh table in handle order. Slices that
+// did not change are copied from the old table; only stale ones are
+// recomputed.
+void BoxLineBatchInstancing::relayout()
+{
+    CLAY_PERF_ZONE("boxlines.relayout");
+    QByteArray data(static_cast<qsizetype>(m_instanceCount) * sizeof(Entry), Qt::Uninitialized);
+    auto *dst = reinterpret_cast<Entry *>(data.data());
+    const auto *old = reinterpret_cast<const Entry *>(m_data.constData());
+    int next = 0;
+    for (Line &line : m_lines) {
+        if (!line.alive)
+            continue;
+        const int segments = segmentsOf(line);
+        if (line.stale)
+            writeSlice(dst + next, line);
+        else if (segments > 0)
+            std::memcpy(dst + next, old + line.instanceStart, segments * sizeof(Entry));
+        line.instanceStart = next;
+        line.instanceCount = segments;
+        line.stale = false;
+        next += segments;
+    }
+    m_data = data;
+    m_layoutDirty = false;
+}
+
+void BoxLineBatchInstancing::adjustCounts(int lines, int instances)
+{
+    if (lines == 0 && instances == 0)
+        return;
+    m_lineCount += lines;
+    m_instanceCount += instances;
+    emit countChanged();
+}
+
+QByteArray BoxLineBatchInstancing::getInstanceBuffer(int *instanceCount)
+{
+    if (m_layoutDirty)
+        relayout();
+    if (instanceCount)
+        *instanceCount = m_instanceCount;
+    return m_data;
+}
@@ -0,0 +1,68 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+#ifndef BOXLINEBATCHINSTANCING_H
+#define BOXLINEBATCHINSTANCING_H
+
+#include <QQuick3DInstancing>
+#include <QVector3D>
+#include <QColor>
+#include <QByteArray>
+#include <QList>
+
+// One instance table shared by many box-segment lines (the BoxLine3D look),
+// used by LineLayer3D. Lines are slots addressed by the handle addLine()
+// returns. Each occupies a contiguous slice of the table; a point update that
+// keeps the segment count rewrites only that slice, anything that changes the
+// layout (add, remove, segment count) is compacted once per upload, copying
+// the untouched slices instead of recomputing them.
+class BoxLineBatchInstancing : public QQuick3DInstancing
+{
+    Q_OBJECT
+    QML_NAMED_ELEMENT(BoxLineBatchInstancing)
+
+    Q_PROPERTY(int lineCount READ lineCount NOTIFY countChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    explicit BoxLineBatchInstancing(QQuick3DObject *parent = nullptr);
+
+    int lineCount() const { return m_lineCount; }
+    int count() const { return m_instanceCount; }
+
+    Q_INVOKABLE int addLine(const QList<QVector3D> &points, float width, const QColor &color);
+    Q_INVOKABLE void removeLine(int handle);
+    Q_INVOKABLE void setLinePoints(int handle, const QList<QVector3D> &points);
+    Q_INVOKABLE void setLineStyle(int handle, float width, const QColor &color);
+    Q_INVOKABLE void clear();
+
+signals:
+    void countChanged();
+
+protected:
+    QByteArray getInstanceBuffer(int *instanceCount) override;
+
+private:
+    struct Line {
+        QList<QVector3D> points;
+        float width = 1.0f;
+        QColor color;
+        int instanceStart = 0;  // slice in m_data (valid unless m_layoutDirty)
+        int instanceCount = 0;
+        bool alive = false;
+        bool stale = true;      // slice must be recomputed at the next relayout
+    };
+
+    static int segmentsOf(const Line &line);
+    Line *lineAt(int handle);
+    void writeSlice(InstanceTableEntry *dst, const Line &line) const;
+    void relayout();
+    void adjustCounts(int lines, int instances);
+
+    QList<Line> m_lines;        // indexed by handle
+    QList<int> m_freeHandles;
+    QByteArray m_data;          // m_instanceCount entries
+    int m_lineCount = 0;
+    int m_instanceCount = 0;
+    bool m_layoutDirty = false;
+};
+
+#endif // BOXLINEBATCHINSTANCING_H
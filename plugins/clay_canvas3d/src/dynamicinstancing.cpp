@@ -1,5 +1,6 @@
 // (c) Clayground Contributors - MIT License, see "LICENSE" file
 #include "dynamicinstancing.h"
+#include "perftrace.h"
 #include <QElapsedTimer>
 #include <QDateTime>
 #include <cstring>
@@ -216,6 +217,7 @@ void DynamicInstancing::setBulk(const QVariantList &scales,
 */
 void DynamicInstancing::updatePoses(int first, const QByteArray &poses)
 {
+    CLAY_PERF_ZONE("instances.updatePoses");
     if (first < 0 || m_data.isEmpty())
         return;
 
@@ -1,9 +1,12 @@
 // (c) Clayground Contributors - MIT License, see "LICENSE" file
 #include "labelbatchinstancing.h"
+#include "perftrace.h"
 
 #include <QColor>
 #include <QVariantMap>
 #include <QElapsedTimer>
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <limits>
 
@@ -167,6 +170,8 @@ QVariantList LabelBatchInstancing::priorities() const
 
 void LabelBatchInstancing::reshape()
 {
+    CLAY_PERF_ZONE("labels.reshape");
+    m_indexState = IndexStale;
     if (!m_atlas) {
         m_glyphData.clear();
         m_pillData.clear();
@@ -258,6 +263,7 @@ void LabelBatchInstancing::reshape()
             lminY = vShift - m_atlas->descent();
             lmaxY = vShift + m_atlas->ascent();
         }
+        l.textBox = QVector4D(lminX, lminY, lmaxX, lmaxY);
         const float pcx = 0.5f * (lminX + lmaxX);
         const float pcy = 0.5f * (lminY + lmaxY);
         const float pw = (lmaxX - lminX) + 2.0f * pad;
@@ -306,6 +312,7 @@ void LabelBatchInstancing::reshape()
 // per-glyph angle. No pill table is built.
 void LabelBatchInstancing::reshapeCurved()
 {
+    CLAY_PERF_ZONE("labels.reshapeCurved");
     QElapsedTimer timer;
     timer.start();
 
@@ -332,7 +339,8 @@ void LabelBatchInstancing::reshapeCurved()
 
     char *gdst = m_glyphData.data();
     int gi = 0;
-    for (const CurvedLabel &l : m_curvedLabels) {
+    for (CurvedLabel &l : m_curvedLabels) {
+        l.glyphRadius = 0.0f;
         const QVector<uint> ucs = l.text.toUcs4();
         for (int ci = 0; ci < ucs.size(); ++ci) {
             const LabelGlyphAtlas::GlyphInfo &info = m_atlas->glyph(ucs[ci]);
@@ -363,6 +371,7 @@ void LabelBatchInstancing::reshapeCurved()
             bmax.setZ(qMax(bmax.z(), pos.z()));
             const float worldExtent = qMax(info.w, info.h) * l.size / qMax(base, 1.0f);
             maxWorldExtent = qMax(maxWorldExtent, worldExtent);
+            l.glyphRadius = qMax(l.glyphRadius, worldExtent);
         }
     }
 
@@ -421,11 +430,249 @@ void LabelBatchInstancing::updatePositionsBulk(const QByteArray &positions, int
             writeAnchor(gbase + static_cast<qsizetype>(l.glyphStart + g) * kEntrySize, pos);
         writeAnchor(pbase + static_cast<qsizetype>(li) * kEntrySize, pos);
     }
+    if (m_indexState == IndexCurrent)
+        m_indexState = IndexMoved;
     m_dirty = true;
     markDirty();
     emit pillDataChanged();
 }
 
+float LabelBatchInstancing::sizeScale(float size) const
+{
+    return size / qMax(m_atlas ? m_atlas->baseSizeF() : 1.0f, 1.0f);
+}
+
+/*!
+    \qmlmethod map LabelBatchInstancing::pick(vector3d origin, vector3d direction, real tolerance, vector2d pixelScale, bool screenSized, bool flat)
+    \brief Returns the label hit by a ray, nearest along the ray.
+
+    A label is hit when the ray passes through its text box grown by
+    \a tolerance. The box is oriented the way the glyph shader draws it:
+    facing the ray (billboard), or lying in the \c XZ plane when \a flat is
+    set. With a non-zero \a pixelScale (see LineBatchInstancing::pick)
+    \a tolerance is in pixels, and \a screenSized treats label sizes as pixels
+    too, matching the Screen size mode. Curved labels are tested glyph by
+    glyph against a sphere of the glyph's extent.
+
+    The result is a map \c{{ labelIndex, distance, position }}: the distance
+    along the ray and the anchor of the hit label (curved labels: of the hit
+    glyph). \c labelIndex is -1 on a miss.
+*/
+QVariantMap LabelBatchInstancing::pick(const QVector3D &origin, const QVector3D &direction,
+                                       qreal tolerance, const QVector2D &pixelScale,
+                                       bool screenSized, bool flat) const
+{
+    CLAY_PERF_ZONE("labels.pick");
+    QVariantMap result{{QStringLiteral("labelIndex"), -1}};
+    const SpatialIndex::Ray ray(origin, direction, pixelScale);
+    if (!ray.isValid())
+        return result;
+    ensureIndex();
+
+    const bool inPixels = !pixelScale.isNull();
+    screenSized = screenSized && inPixels;
+    flat = flat && !screenSized;
+    const float tol = static_cast<float>(tolerance);
+    auto toleranceAt = [&](float t) { return inPixels ? tol * ray.pixelSize(t) : tol; };
+    // World units per size unit at ray distance t.
+    auto unitsAt = [&](float t) { return screenSized ? ray.pixelSize(t) : 1.0f; };
+
+    // Billboard basis as label_batch.vert builds it, with the ray standing in
+    // for the camera direction.
+    const QVector3D toCam = -ray.dir;
+    QVector3D right = QVector3D::crossProduct(QVector3D(0.0f, 1.0f, 0.0f), toCam);
+    right = right.length() > 1e-5f ? right.normalized() : QVector3D(1.0f, 0.0f, 0.0f);
+    const QVector3D up = QVector3D::crossProduct(toCam, right);
+
+    float bestT = std::numeric_limits<float>::max();
+    int best = -1;
+    QVector3D bestPos;
+    m_index.traverse(
+        [&](const SpatialIndex::Box &box) {
+            const float t = ray.farT(box);
+            return ray.reaches(box, toleranceAt(t) + m_indexMaxRadius * unitsAt(t), bestT);
+        },
+        [&](int item) {
+            if (m_curvedMode) {
+                const CurvedLabel &l = m_curvedLabels[item];
+                for (const QVector3D &p : l.positions) {
+                    const float t = QVector3D::dotProduct(p - ray.origin, ray.dir);
+                    if (t < 0.0f || t >= bestT)
+                        continue;
+                    if ((ray.at(t) - p).length() <= toleranceAt(t) + l.glyphRadius * unitsAt(t)) {
+                        bestT = t;
+                        best = item;
+                        bestPos = p;
+                    }
+                }
+                return;
+            }
+
+            const Label &l = m_labels[item];
+            float t = 0.0f;
+            float lx = 0.0f;
+            float ly = 0.0f;
+            if (flat) {
+                if (qFuzzyIsNull(ray.dir.y()))
+                    return;
+                t = (l.position.y() - ray.origin.y()) / ray.dir.y();
+                const QVector3D offset = ray.at(t) - l.position;
+                lx = offset.x();
+                ly = -offset.z();
+            } else {
+                t = QVector3D::dotProduct(l.position - ray.origin, ray.dir);
+                const QVector3D offset = ray.at(t) - l.position;
+                lx = QVector3D::dotProduct(offset, right);
+                ly = QVector3D::dotProduct(offset, up);
+            }
+            if (t < 0.0f || t >= bestT)
+                return;
+            const float k = sizeScale(l.size) * unitsAt(t);
+            const float pad = toleranceAt(t);
+            if (lx >= l.textBox.x() * k - pad && lx <= l.textBox.z() * k + pad
+                && ly >= l.textBox.y() * k - pad && ly <= l.textBox.w() * k + pad) {
+                bestT = t;
+                best = item;
+                bestPos = l.position;
+            }
+        });
+
+    if (best >= 0) {
+        result[QStringLiteral("labelIndex")] = best;
+        result[QStringLiteral("distance")] = bestT;
+        result[QStringLiteral("position")] = QVariant::fromValue(bestPos);
+    }
+    return result;
+}
+
+/*!
+    \qmlmethod list LabelBatchInstancing::queryBox(vector3d min, vector3d max)
+    \brief Returns the sorted indices of labels anchored inside a box.
+
+    Curved labels match when any of their glyph anchors lies inside.
+*/
+QVariantList LabelBatchInstancing::queryBox(const QVector3D &min, const QVector3D &max) const
+{
+    CLAY_PERF_ZONE("labels.queryBox");
+    ensureIndex();
+    const SpatialIndex::Box query{min, max};
+    auto inside = [&query](const QVector3D &p) {
+        SpatialIndex::Box b;
+        b.expand(p);
+        return b.overlaps(query);
+    };
+
+    QList<int> hits;
+    m_index.traverse(
+        [&](const SpatialIndex::Box &box) { return box.overlaps(query); },
+        [&](int item) {
+            if (!m_curvedMode) {
+                if (inside(m_labels[item].position))
+                    hits.append(item);
+                return;
+            }
+            const QVector<QVector3D> &positions = m_curvedLabels[item].positions;
+            if (std::any_of(positions.cbegin(), positions.cend(), inside))
+                hits.append(item);
+        });
+
+    std::sort(hits.begin(), hits.end());
+    QVariantList out;
+    out.reserve(hits.size());
+    for (int labelIndex : hits)
+        out.append(labelIndex);
+    return out;
+}
+
+/*!
+    \qmlmethod map LabelBatchInstancing::nearest(vector3d point, real maxDistance)
+    \brief Returns the label whose anchor is closest to \a point.
+
+    The result is a map \c{{ labelIndex, distance, position }}; \c labelIndex
+    is -1 when no anchor lies within \a maxDistance (a negative
+    \a maxDistance means unlimited).
+*/
+QVariantMap LabelBatchInstancing::nearest(const QVector3D &point, qreal maxDistance) const
+{
+    CLAY_PERF_ZONE("labels.nearest");
+    QVariantMap result{{QStringLiteral("labelIndex"), -1}};
+    ensureIndex();
+    const float limit = maxDistance < 0.0 ? std::numeric_limits<float>::max()
+                                          : static_cast<float>(maxDistance);
+    QVector3D closest;
+    auto closestAnchor = [&](int item, QVector3D *at) {
+        if (!m_curvedMode) {
+            *at = m_labels[item].position;
+            return (*at - point).length();
+        }
+        float d = std::numeric_limits<float>::max();
+        for (const QVector3D &p : m_curvedLabels[item].positions) {
+            const float pd = (p - point).length();
+            if (pd < d) {
+                d = pd;
+                *at = p;
+            }
+        }
+        return d;
+    };
+
+    float distance = 0.0f;
+    const int item = m_index.nearest(
+        [&](const SpatialIndex::Box &box) { return box.distanceTo(point); },
+        [&](int i) {
+            QVector3D at;
+            return closestAnchor(i, &at);
+        },
+        limit, &distance);
+
+    if (item >= 0) {
+        closestAnchor(item, &closest);
+        result[QStringLiteral("labelIndex")] = item;
+        result[QStringLiteral("distance")] = distance;
+        result[QStringLiteral("position")] = QVariant::fromValue(closest);
+    }
+    return result;
+}
+
+// Builds the label index after a reshape, refits it after updatePositionsBulk.
+void LabelBatchInstancing::ensureIndex() const
+{
+    if (m_indexState == IndexCurrent)
+        return;
+
+    QList<SpatialIndex::Box> items;
+    m_indexMaxRadius = 0.0f;
+    if (m_curvedMode) {
+        items.reserve(m_curvedLabels.size());
+        for (const CurvedLabel &l : m_curvedLabels) {
+            SpatialIndex::Box box;
+            for (const QVector3D &p : l.positions)
+                box.expand(p);
+            if (!box.isValid())
+                box.expand(QVector3D());
+            items.append(box);
+            m_indexMaxRadius = qMax(m_indexMaxRadius, l.glyphRadius);
+        }
+    } else {
+        items.reserve(m_labels.size());
+        for (const Label &l : m_labels) {
+            SpatialIndex::Box box;
+            box.expand(l.position);
+            items.append(box);
+            // Farthest text-box corner from the anchor, in size units.
+            const float cx = qMax(qAbs(l.textBox.x()), qAbs(l.textBox.z()));
+            const float cy = qMax(qAbs(l.textBox.y()), qAbs(l.textBox.w()));
+            m_indexMaxRadius = qMax(m_indexMaxRadius, std::hypot(cx, cy) * sizeScale(l.size));
+        }
+    }
+
+    if (m_indexState == IndexStale)
+        m_index.build(items);
+    else
+        m_index.update(items);
+    m_indexState = IndexCurrent;
+}
+
 QByteArray LabelBatchInstancing::getInstanceBuffer(int *instanceCount)
 {
     m_dirty = false;
@@ -3,14 +3,17 @@
 #define LABELBATCHINSTANCING_H
 
 #include <QQuick3DInstancing>
+#include <QVector2D>
 #include <QVector3D>
 #include <QVector4D>
 #include <QVariantList>
+#include <QVariantMap>
 #include <QByteArray>
 #include <QList>
 #include <QPointer>
 
 #include "labelglyphatlas.h"
+#include "spatialindex.h"
 
 // Per-glyph instance table for LabelBatch3D. Shapes each label (single line,
 // QFontMetricsF advances) against a shared LabelGlyphAtlas and emits one
@@ -92,6 +95,17 @@ public:
     // switches it back. No pill table is produced in curved mode.
     Q_INVOKABLE void setCurvedLabels(const QVariantList &labels);
 
+    // Spatial queries over the label anchors (curved labels: their glyph
+    // anchors), in batch coordinates, mirroring LineBatchInstancing's. pick()
+    // tests the ray against each label's text box as the shader orients it:
+    // screenSized labels are sized in pixels (requires pixelScale) and face the
+    // camera, flat labels lie in the XZ plane, the rest face the ray.
+    Q_INVOKABLE QVariantMap pick(const QVector3D &origin, const QVector3D &direction,
+                                 qreal tolerance, const QVector2D &pixelScale = QVector2D(),
+                                 bool screenSized = false, bool flat = false) const;
+    Q_INVOKABLE QVariantList queryBox(const QVector3D &min, const QVector3D &max) const;
+    Q_INVOKABLE QVariantMap nearest(const QVector3D &point, qreal maxDistance = -1.0) const;
+
     // Pill instance buffer accessors (consumed by LabelPillInstancing).
     const QByteArray &pillData() const { return m_pillData; }
     int pillCount() const { return static_cast<int>(m_labels.size()); }
@@ -116,6 +130,7 @@ private:
         QString text;
         int glyphStart = 0;
         int glyphCount = 0;
+        QVector4D textBox; // glyph-union (minX, minY, maxX, maxY), label-local base px
     };
 
     struct CurvedLabel {
@@ -125,11 +140,14 @@ private:
         float opacity = 1.0f;
         QVector<QVector3D> positions; // per code point
         QVector<float> angles;        // per code point (radians)
+        float glyphRadius = 0.0f;     // largest glyph extent in size units
     };
 
     void reshape();
     void reshapeCurved();
     void writeAnchor(char *entry, const QVector3D &p) const;
+    float sizeScale(float size) const;
+    void ensureIndex() const;
 
     QPointer<LabelGlyphAtlas> m_atlas;
     QList<Label> m_labels;
@@ -143,6 +161,12 @@ private:
     QVector3D m_boundsMax;
     double m_shapeMsLast = 0.0;
     bool m_dirty = false;
+
+    // Label index for the spatial queries; item i is label (or curved label) i.
+    enum IndexState { IndexCurrent, IndexMoved, IndexStale };
+    mutable SpatialIndex m_index;
+    mutable float m_indexMaxRadius = 0.0f; // in size units (px or world)
+    mutable int m_indexState = IndexStale;
 };
 
 // Companion instancing that renders the per-label pill backgrounds from the
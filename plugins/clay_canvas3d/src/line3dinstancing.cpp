@@ -124,36 +124,30 @@ QByteArray LineInstancing::getInstanceBuffer(int *instanceCount)
     return m_instanceData;
 }
 
-void LineInstancing::updateInstanceData()
+LineInstancing::InstanceTableEntry LineInstancing::segmentEntry(const QVector3D &p0,
+                                                                const QVector3D &p1,
+                                                                float width, const QColor &color)
 {
-    m_instanceData.clear();
-    if (m_positions.size() < 2) {
-        m_dirty = false;
-        return;
-    }
-
-    for (int i = 0; i < m_positions.size() - 1; ++i) {
-        const QVector3D &pos1 = m_positions[i];
-        const QVector3D &pos2 = m_positions[i + 1];
-        QVector3D midPoint = (pos1 + pos2) * 0.5f;
-        QVector3D direction = pos2 - pos1;
-        float length = direction.length();
-        direction.normalize();
-
-
-        QVector3D defaultForward(0, 0, 1);  // Default forward direction (z-axis)
-        QQuaternion rotationQuat = QQuaternion::rotationTo(defaultForward, direction);
-        QVector3D scale(m_width, m_width, length);
-
-        auto entry = calculateTableEntryFromQuaternion(
-            midPoint,
-            scale,
-            rotationQuat,
-            m_color
-        );
+    const QVector3D midPoint = (p0 + p1) * 0.5f;
+    QVector3D direction = p1 - p0;
+    const float length = direction.length();
+    if (length <= 0.0f)
+        return calculateTableEntry(midPoint, QVector3D(0, 0, 0), QVector3D(), color);
+    direction /= length;
+
+    const QVector3D defaultForward(0, 0, 1);  // Default forward direction (z-axis)
+    const QQuaternion rotationQuat = QQuaternion::rotationTo(defaultForward, direction);
+    return calculateTableEntryFromQuaternion(midPoint, QVector3D(width, width, length),
+                                             rotationQuat, color);
+}
 
-        m_instanceData.append(reinterpret_cast<const char*>(&entry), sizeof(entry));
-    }
+void LineInstancing::updateInstanceData()
+{
+    const int segments = m_positions.size() > 1 ? int(m_positions.size()) - 1 : 0;
+    m_instanceData.resize(qsizetype(segments) * sizeof(InstanceTableEntry));
+    auto *dst = reinterpret_cast<InstanceTableEntry *>(m_instanceData.data());
+    for (int i = 0; i < segments; ++i)
+        dst[i] = segmentEntry(m_positions[i], m_positions[i + 1], m_width, m_color);
 
     m_dirty = false;
 }
@@ -25,6 +25,12 @@ public:
     QColor color() const;
     void setColor(const QColor &color);
 
+    // The box-segment transform shared with BoxLineBatchInstancing: a unit
+    // cube stretched to width x width x |p1 - p0| and rotated from +Z onto
+    // the segment. Degenerate segments collapse to a zero-scale entry.
+    static InstanceTableEntry segmentEntry(const QVector3D &p0, const QVector3D &p1,
+                                           float width, const QColor &color);
+
 signals:
     void positionsChanged();
     void widthChanged();
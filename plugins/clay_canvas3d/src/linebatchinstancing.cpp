@@ -1,6 +1,8 @@
 #include "linebatchinstancing.h"
+#include "perftrace.h"
 #include <QColor>
 #include <QVariantMap>
+#include <algorithm>
 #include <cstring>
 #include <limits>
 
@@ -22,14 +24,31 @@
     \c{P1 = INSTANCE_MODEL_MATRIX * vec4(1,0,0,1)} and expands the quad
     into a camera-facing ribbon.
 
+    In the animated modes (see \l animation) the entry layout changes so the
+    shader can move the lines without any per-frame table writes: customData
+    carries the styleId and cap flags packed into one float and a per-line
+    time offset (\c phase) in the slot the static layout uses for the cap
+    flags. In Keyframes mode the transform is the identity and customData.z
+    holds the segment's first point index into the LineKeyframeTextureData,
+    from which the vertex shader fetches and interpolates both endpoints.
+
     This type is used internally by LineBatch3D.
 
-    \sa LineBatch3D, LineBatchGeometry
+    \sa LineBatch3D, LineBatchGeometry, LineKeyframeTextureData
 */
 
 using Entry = QQuick3DInstancing::InstanceTableEntry;
 static constexpr int kEntrySize = sizeof(Entry); // 80 bytes: 5 x vec4
 
+// Animated layouts pack styleId (uint16) and the two cap-flag bits into one
+// float, exact below 2^24; line_batch.vert unpacks with the same constant.
+static constexpr int kCapFlagsShift = 16;
+
+static float packStyleAndCaps(int styleId, int capFlags)
+{
+    return static_cast<float>(qBound(0, styleId, 0xffff) | (capFlags << kCapFlagsShift));
+}
+
 LineBatchInstancing::LineBatchInstancing(QQuick3DObject *parent)
     : QQuick3DInstancing(parent)
 {
@@ -40,9 +59,10 @@ LineBatchInstancing::LineBatchInstancing(QQuick3DObject *parent)
     \brief Declarative list of styled polylines.
 
     Each element is an object of the form
-    \c{{ points: [Qt.vector3d, ...], color: <color>, width: <real>, styleId: <int> }}.
-    A polyline with N points produces N-1 line-segment instances that share
-    the line's color, width and styleId.
+    \c{{ points: [Qt.vector3d, ...], color: <color>, width: <real>, styleId: <int>,
+    phase: <real> }}. A polyline with N points produces N-1 line-segment
+    instances that share the line's color, width and styleId. \c phase is
+    optional and only used by the animated modes.
 */
 QVariantList LineBatchInstancing::lines() const
 {
@@ -59,6 +79,7 @@ QVariantList LineBatchInstancing::lines() const
             QColor::fromRgbF(line.color.x(), line.color.y(), line.color.z(), line.color.w())));
         m.insert(QStringLiteral("width"), line.width);
         m.insert(QStringLiteral("styleId"), line.styleId);
+        m.insert(QStringLiteral("phase"), line.phase);
         result.append(m);
     }
     return result;
@@ -81,6 +102,7 @@ void LineBatchInstancing::setLines(const QVariantList &lines)
         line.color = QVector4D(c.redF(), c.greenF(), c.blueF(), c.alphaF());
         line.width = m.value(QStringLiteral("width"), 1.0).toFloat();
         line.styleId = m.value(QStringLiteral("styleId"), 0).toInt();
+        line.phase = m.value(QStringLiteral("phase"), 0.0).toFloat();
         m_lines.append(line);
     }
     rebuild();
@@ -132,6 +154,7 @@ void LineBatchInstancing::setBulk(const QByteArray &positions,
                                   const QByteArray &widths,
                                   const QByteArray &styleIds)
 {
+    CLAY_PERF_ZONE("lines.setBulk");
     m_lines.clear();
 
     const int numStarts = static_cast<int>(startIndices.size() / sizeof(quint32));
@@ -215,6 +238,7 @@ void LineBatchInstancing::updateLinePoints(int lineIndex, const QVariantList &po
         char *dst = m_data.data() + static_cast<qsizetype>(line.instanceStart) * kEntrySize;
         writeLineEntries(dst, line);
     }
+    markIndexMoved();
     updateBounds();
     markDirty();
 }
@@ -222,6 +246,7 @@ void LineBatchInstancing::updateLinePoints(int lineIndex, const QVariantList &po
 void LineBatchInstancing::writeLineEntries(char *dst, const Line &line) const
 {
     const int segments = line.points.size() > 1 ? line.points.size() - 1 : 0;
+    const bool animated = m_activeAnimation != Static;
     // Accumulated path distance at each segment start, packed into
     // INSTANCE_DATA.z so the fragment shader can flow a dash pattern
     // continuously across the segments of one polyline.
@@ -239,16 +264,28 @@ void LineBatchInstancing::writeLineEntries(char *dst, const Line &line) const
         // line (segments == 1, s == 0) therefore gets both caps (flags == 3).
         const int capFlags = (s == 0 ? 1 : 0) | 2;
 
-        // Affine transform mapping base-space (0,0,0)->P0 and (1,0,0)->P1.
-        // Columns 1 and 2 are zero; translation is P0. Stored row-major as
-        // three vec4 rows (row.xyz = matrix row, row.w = translation).
         Entry e;
-        e.row0 = QVector4D(p1.x() - p0.x(), 0.0f, 0.0f, p0.x());
-        e.row1 = QVector4D(p1.y() - p0.y(), 0.0f, 0.0f, p0.y());
-        e.row2 = QVector4D(p1.z() - p0.z(), 0.0f, 0.0f, p0.z());
         e.color = line.color;
-        e.instanceData = QVector4D(line.width, static_cast<float>(line.styleId),
-                                   pathDist, static_cast<float>(capFlags));
+        if (m_activeAnimation == Keyframes) {
+            // Endpoints come from the keyframe texture; the identity keeps the
+            // model's own transform in INSTANCE_MODEL_MATRIX.
+            e.row0 = QVector4D(1.0f, 0.0f, 0.0f, 0.0f);
+            e.row1 = QVector4D(0.0f, 1.0f, 0.0f, 0.0f);
+            e.row2 = QVector4D(0.0f, 0.0f, 1.0f, 0.0f);
+            e.instanceData = QVector4D(line.width, packStyleAndCaps(line.styleId, capFlags),
+                                       static_cast<float>(line.pointStart + s), line.phase);
+        } else {
+            // Affine transform mapping base-space (0,0,0)->P0 and (1,0,0)->P1.
+            // Columns 1 and 2 are zero; translation is P0. Stored row-major as
+            // three vec4 rows (row.xyz = matrix row, row.w = translation).
+            e.row0 = QVector4D(p1.x() - p0.x(), 0.0f, 0.0f, p0.x());
+            e.row1 = QVector4D(p1.y() - p0.y(), 0.0f, 0.0f, p0.y());
+            e.row2 = QVector4D(p1.z() - p0.z(), 0.0f, 0.0f, p0.z());
+            e.instanceData = animated
+                ? QVector4D(line.width, packStyleAndCaps(line.styleId, capFlags), pathDist, line.phase)
+                : QVector4D(line.width, static_cast<float>(line.styleId),
+                            pathDist, static_cast<float>(capFlags));
+        }
 
         std::memcpy(dst + static_cast<qsizetype>(s) * kEntrySize, &e, kEntrySize);
         pathDist += (p1 - p0).length();
@@ -287,6 +324,7 @@ void LineBatchInstancing::updateEndpointsBulk(const QByteArray &positions)
         writeLineEntries(base + static_cast<qsizetype>(line.instanceStart) * kEntrySize, line);
     }
 
+    markIndexMoved();
     updateBounds();
     markDirty();
 }
@@ -307,6 +345,7 @@ void LineBatchInstancing::updateEndpointsBulk(const QByteArray &positions)
 */
 void LineBatchInstancing::updatePolylinesBulk(const QByteArray &positions, int pointsPerLine)
 {
+    CLAY_PERF_ZONE("lines.updatePolylinesBulk");
     if (m_data.isEmpty() || m_lines.isEmpty() || pointsPerLine < 2)
         return;
 
@@ -328,6 +367,7 @@ void LineBatchInstancing::updatePolylinesBulk(const QByteArray &positions, int p
         writeLineEntries(base + static_cast<qsizetype>(line.instanceStart) * kEntrySize, line);
     }
 
+    markIndexMoved();
     updateBounds();
     markDirty();
 }
@@ -383,16 +423,423 @@ QVector3D LineBatchInstancing::positionAt(int lineIndex, qreal distance) const
     return line.points.last();
 }
 
+/*!
+    \qmlmethod map LineBatchInstancing::pick(vector3d origin, vector3d direction, real tolerance, vector2d pixelScale, bool pixelWidths)
+    \brief Returns the line segment hit by a ray, nearest along the ray.
+
+    A segment is hit when the ray passes within \a tolerance of it, plus half
+    the line's width. With a non-zero \a pixelScale (the world size of one
+    pixel at the ray origin and its growth per unit distance, as
+    LineBatch3D::pickAt computes it) \a tolerance is in pixels, and so are the
+    widths when \a pixelWidths is set; otherwise both are world units.
+
+    The result is a map \c{{ lineIndex, segmentIndex, distance, point, offset }}:
+    \c distance is measured along the ray, \c point is the closest point on the
+    segment and \c offset its distance from the ray. \c lineIndex is -1 on a
+    miss. Queries run against the static points; the animated modes' GPU-side
+    motion is not reflected.
+*/
+QVariantMap LineBatchInstancing::pick(const QVector3D &origin, const QVector3D &direction,
+                                      qreal tolerance, const QVector2D &pixelScale,
+                                      bool pixelWidths) const
+{
+    CLAY_PERF_ZONE("lines.pick");
+    QVariantMap result{{QStringLiteral("lineIndex"), -1}};
+    const SpatialIndex::Ray ray(origin, direction, pixelScale);
+    if (!ray.isValid())
+        return result;
+    ensureIndex();
+
+    const bool inPixels = !pixelScale.isNull();
+    const float tol = static_cast<float>(tolerance);
+    const bool countWidths = !pixelWidths || inPixels;
+    auto radiusAt = [&](float t, float width) {
+        const float px = inPixels ? ray.pixelSize(t) : 1.0f;
+        return tol * px + (countWidths ? 0.5f * width * (pixelWidths ? px : 1.0f) : 0.0f);
+    };
+
+    float bestT = std::numeric_limits<float>::max();
+    int best = -1;
+    float bestU = 0.0f;
+    float bestOffset = 0.0f;
+    m_index.traverse(
+        [&](const SpatialIndex::Box &box) {
+            return ray.reaches(box, radiusAt(ray.farT(box), m_indexMaxWidth), bestT);
+        },
+        [&](int seg) {
+            const Line &line = m_lines[m_segmentLine[seg]];
+            const int s = seg - line.instanceStart;
+            float t = 0.0f;
+            float u = 0.0f;
+            const float d = SpatialIndex::raySegmentDistance(ray, line.points[s],
+                                                             line.points[s + 1], &t, &u);
+            if (t < bestT && d <= radiusAt(t, line.width)) {
+                bestT = t;
+                best = seg;
+                bestU = u;
+                bestOffset = d;
+            }
+        });
+
+    if (best >= 0) {
+        const int lineIndex = m_segmentLine[best];
+        const Line &line = m_lines[lineIndex];
+        const int s = best - line.instanceStart;
+        result[QStringLiteral("lineIndex")] = lineIndex;
+        result[QStringLiteral("segmentIndex")] = s;
+        result[QStringLiteral("distance")] = bestT;
+        result[QStringLiteral("point")] = QVariant::fromValue(
+            line.points[s] + (line.points[s + 1] - line.points[s]) * bestU);
+        result[QStringLiteral("offset")] = bestOffset;
+    }
+    return result;
+}
+
+/*!
+    \qmlmethod list LineBatchInstancing::queryBox(vector3d min, vector3d max)
+    \brief Returns the sorted indices of lines with a segment inside a box.
+
+    A line matches when any of its segments intersects the axis-aligned box
+    \a min .. \a max (batch coordinates); widths are not considered.
+*/
+QVariantList LineBatchInstancing::queryBox(const QVector3D &min, const QVector3D &max) const
+{
+    CLAY_PERF_ZONE("lines.queryBox");
+    ensureIndex();
+    const SpatialIndex::Box query{min, max};
+    QList<int> hits;
+    m_index.traverse(
+        [&](const SpatialIndex::Box &box) { return box.overlaps(query); },
+        [&](int seg) {
+            const int lineIndex = m_segmentLine[seg];
+            const Line &line = m_lines[lineIndex];
+            const int s = seg - line.instanceStart;
+            if (SpatialIndex::segmentIntersectsBox(line.points[s], line.points[s + 1], query))
+                hits.append(lineIndex);
+        });
+
+    std::sort(hits.begin(), hits.end());
+    hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+    QVariantList out;
+    out.reserve(hits.size());
+    for (int lineIndex : hits)
+        out.append(lineIndex);
+    return out;
+}
+
+/*!
+    \qmlmethod map LineBatchInstancing::nearest(vector3d point, real maxDistance)
+    \brief Returns the segment closest to \a point.
+
+    The result is a map \c{{ lineIndex, segmentIndex, distance, point }} with
+    the closest point on that segment; \c lineIndex is -1 when no segment lies
+    within \a maxDistance (a negative \a maxDistance means unlimited).
+*/
+QVariantMap LineBatchInstancing::nearest(const QVector3D &point, qreal maxDistance) const
+{
+    CLAY_PERF_ZONE("lines.nearest");
+    QVariantMap result{{QStringLiteral("lineIndex"), -1}};
+    ensureIndex();
+    const float limit = maxDistance < 0.0 ? std::numeric_limits<float>::max()
+                                          : static_cast<float>(maxDistance);
+    float distance = 0.0f;
+    const int seg = m_index.nearest(
+        [&](const SpatialIndex::Box &box) { return box.distanceTo(point); },
+        [&](int item) {
+            const Line &line = m_lines[m_segmentLine[item]];
+            const int s = item - line.instanceStart;
+            return SpatialIndex::pointSegmentDistance(point, line.points[s], line.points[s + 1],
+                                                      nullptr);
+        },
+        limit, &distance);
+
+    if (seg >= 0) {
+        const int lineIndex = m_segmentLine[seg];
+        const Line &line = m_lines[lineIndex];
+        const int s = seg - line.instanceStart;
+        float u = 0.0f;
+        SpatialIndex::pointSegmentDistance(point, line.points[s], line.points[s + 1], &u);
+        result[QStringLiteral("lineIndex")] = lineIndex;
+        result[QStringLiteral("segmentIndex")] = s;
+        result[QStringLiteral("distance")] = distance;
+        result[QStringLiteral("point")] = QVariant::fromValue(
+            line.points[s] + (line.points[s + 1] - line.points[s]) * u);
+    }
+    return result;
+}
+
+void LineBatchInstancing::markIndexMoved()
+{
+    if (m_indexState == IndexCurrent)
+        m_indexState = IndexMoved;
+}
+
+// Brings the segment index up to date: a full build after rebuild(), a refit
+// after in-place point updates (SpatialIndex rebuilds if the refit degrades).
+void LineBatchInstancing::ensureIndex() const
+{
+    if (m_indexState == IndexCurrent)
+        return;
+
+    QList<SpatialIndex::Box> items;
+    items.reserve(m_instanceCount);
+    m_segmentLine.resize(m_instanceCount);
+    m_indexMaxWidth = 0.0f;
+    for (int li = 0; li < m_lines.size(); ++li) {
+        const Line &line = m_lines[li];
+        m_indexMaxWidth = qMax(m_indexMaxWidth, line.width);
+        for (int s = 0; s < line.instanceCount; ++s) {
+            SpatialIndex::Box box;
+            box.expand(line.points[s]);
+            box.expand(line.points[s + 1]);
+            items.append(box);
+            m_segmentLine[line.instanceStart + s] = li;
+        }
+    }
+
+    if (m_indexState == IndexStale)
+        m_index.build(items);
+    else
+        m_index.update(items);
+    m_indexState = IndexCurrent;
+}
+
+/*!
+    \qmlproperty int LineBatchInstancing::animation
+    \brief Requested animation mode: 0 Static, 1 Keyframes, 2 Procedural.
+
+    Selects the instance-table layout (see the type description). Changing the
+    effective layout rewrites the table once; animating afterwards only moves
+    material uniforms.
+
+    \sa activeAnimation
+*/
+void LineBatchInstancing::setAnimation(int mode)
+{
+    mode = qBound(static_cast<int>(Static), mode, static_cast<int>(Procedural));
+    if (m_animation == mode)
+        return;
+    m_animation = mode;
+    emit animationChanged();
+    if (activeAnimation() != m_activeAnimation)
+        rebuild();
+}
+
+/*!
+    \qmlproperty int LineBatchInstancing::activeAnimation
+    \readonly
+    \brief The layout the instance table is currently written in.
+
+    Equals \l animation, except that Keyframes without keyframes matching the
+    current lines falls back to Procedural (lines render at their static
+    points; procedural motion still applies).
+*/
+int LineBatchInstancing::activeAnimation() const
+{
+    if (m_animation == Keyframes && m_keyframeCount == 0)
+        return Procedural;
+    return m_animation;
+}
+
+void LineBatchInstancing::setActiveAnimation(int mode)
+{
+    if (m_activeAnimation == mode)
+        return;
+    m_activeAnimation = mode;
+    emit activeAnimationChanged();
+}
+
+/*!
+    \qmlproperty int LineBatchInstancing::keyframeCount
+    \readonly
+    \brief The number of uploaded keyframes (0 when none match the lines).
+*/
+
+/*!
+    \qmlproperty LineKeyframeTextureData LineBatchInstancing::keyframeData
+    \brief The texture the keyframe point sets are uploaded into.
+*/
+void LineBatchInstancing::setKeyframeData(LineKeyframeTextureData *data)
+{
+    if (m_keyframeData == data)
+        return;
+    m_keyframeData = data;
+    emit keyframeDataChanged();
+    pushKeyframes();
+}
+
+/*!
+    \qmlproperty real LineBatchInstancing::boundsPadding
+    \brief Extra margin added to the bounds for shader-side displacement.
+
+    LineBatch3D binds the procedural sway amplitude here so culling bounds
+    cover the lines wherever the vertex shader moves them.
+*/
+void LineBatchInstancing::setBoundsPadding(float padding)
+{
+    padding = qMax(0.0f, padding);
+    if (qFuzzyCompare(m_boundsPadding, padding))
+        return;
+    m_boundsPadding = padding;
+    emit boundsPaddingChanged();
+    updateBounds();
+}
+
+/*!
+    \qmlmethod bool LineBatchInstancing::setKeyframes(ByteArray positions, int keyframeCount)
+    \brief Uploads point sets the shader morphs between (Keyframes mode).
+
+    \a positions holds \a keyframeCount complete point sets of float32 xyz
+    triples, keyframe-major; each set lists every point of every line in batch
+    order, exactly like the positions buffer of setBulk. Per-keyframe path
+    distances are computed here once, so dash patterns stay continuous while
+    lines morph. Returns false (leaving the previous keyframes in place) when
+    the buffer does not match the current topology or exceeds the texture
+    limit.
+*/
+bool LineBatchInstancing::setKeyframes(const QByteArray &positions, int keyframeCount)
+{
+    CLAY_PERF_ZONE("lines.setKeyframes");
+    const qsizetype texelCount = static_cast<qsizetype>(m_pointCount) * keyframeCount;
+    const int rows = LineKeyframeTextureData::rowsFor(texelCount);
+    if (keyframeCount < 1 || m_pointCount == 0 || rows == 0
+        || positions.size() != texelCount * 3 * static_cast<qsizetype>(sizeof(float))) {
+        qWarning("LineBatchInstancing::setKeyframes: expected %d keyframes x %d points "
+                 "(float32 xyz), got %lld bytes",
+                 keyframeCount, m_pointCount, static_cast<long long>(positions.size()));
+        return false;
+    }
+
+    const auto *src = reinterpret_cast<const float *>(positions.constData());
+    QByteArray texels(static_cast<qsizetype>(rows) * LineKeyframeTextureData::kTextureWidth
+                          * 4 * sizeof(float), Qt::Uninitialized);
+    auto *dst = reinterpret_cast<float *>(texels.data());
+    std::memset(dst + texelCount * 4, 0, texels.size() - texelCount * 4 * sizeof(float));
+
+    const float maxF = std::numeric_limits<float>::max();
+    QVector3D mn(maxF, maxF, maxF);
+    QVector3D mx(-maxF, -maxF, -maxF);
+    for (int k = 0; k < keyframeCount; ++k) {
+        const qsizetype base = static_cast<qsizetype>(k) * m_pointCount;
+        for (const Line &line : std::as_const(m_lines)) {
+            float pathDist = 0.0f;
+            QVector3D prev;
+            for (int p = 0; p < line.points.size(); ++p) {
+                const qsizetype i = base + line.pointStart + p;
+                const QVector3D pt(src[i * 3 + 0], src[i * 3 + 1], src[i * 3 + 2]);
+                if (p > 0)
+                    pathDist += (pt - prev).length();
+                prev = pt;
+                dst[i * 4 + 0] = pt.x();
+                dst[i * 4 + 1] = pt.y();
+                dst[i * 4 + 2] = pt.z();
+                dst[i * 4 + 3] = pathDist;
+                mn = QVector3D(qMin(mn.x(), pt.x()), qMin(mn.y(), pt.y()), qMin(mn.z(), pt.z()));
+                mx = QVector3D(qMax(mx.x(), pt.x()), qMax(mx.y(), pt.y()), qMax(mx.z(), pt.z()));
+            }
+        }
+    }
+
+    m_keyframeTexels = texels;
+    m_keyframeCount = keyframeCount;
+    m_keyframeLayout.resize(m_lines.size());
+    for (int i = 0; i < m_lines.size(); ++i)
+        m_keyframeLayout[i] = static_cast<int>(m_lines[i].points.size());
+    m_keyframeMin = mn;
+    m_keyframeMax = mx;
+    pushKeyframes();
+    emit keyframesChanged();
+
+    // Same point indices in every layout generation, so only a layout switch
+    // needs the table rewritten.
+    if (activeAnimation() != m_activeAnimation)
+        rebuild();
+    else
+        updateBounds();
+    return true;
+}
+
+/*!
+    \qmlmethod void LineBatchInstancing::clearKeyframes()
+    \brief Drops the uploaded keyframes (Keyframes mode falls back to Procedural).
+*/
+void LineBatchInstancing::clearKeyframes()
+{
+    if (m_keyframeCount == 0)
+        return;
+    m_keyframeCount = 0;
+    m_keyframeTexels.clear();
+    m_keyframeLayout.clear();
+    pushKeyframes();
+    emit keyframesChanged();
+    if (activeAnimation() != m_activeAnimation)
+        rebuild();
+    else
+        updateBounds();
+}
+
+void LineBatchInstancing::pushKeyframes()
+{
+    if (m_keyframeData)
+        m_keyframeData->setKeyframes(m_keyframeTexels, m_pointCount, m_keyframeCount);
+}
+
+/*!
+    \qmlmethod void LineBatchInstancing::setLinePhases(ByteArray phases)
+    \brief Sets every line's animation time offset from a float32 buffer.
+
+    One float (seconds) per line in batch order; lines past the end of the
+    buffer keep their phase. Only the animated layouts read the phase, so in
+    Static mode this just stores the values for a later switch.
+*/
+void LineBatchInstancing::setLinePhases(const QByteArray &phases)
+{
+    const auto *src = reinterpret_cast<const float *>(phases.constData());
+    const int n = qMin(static_cast<int>(phases.size() / sizeof(float)),
+                       static_cast<int>(m_lines.size()));
+    for (int i = 0; i < n; ++i)
+        m_lines[i].phase = src[i];
+
+    if (m_activeAnimation == Static || m_data.isEmpty())
+        return;
+    char *base = m_data.data();
+    for (int i = 0; i < n; ++i) {
+        const Line &line = m_lines[i];
+        if (line.instanceCount > 0)
+            writeLineEntries(base + static_cast<qsizetype>(line.instanceStart) * kEntrySize, line);
+    }
+    markDirty();
+}
+
 void LineBatchInstancing::rebuild()
 {
-    // Assign instance ranges and total segment count.
+    CLAY_PERF_ZONE("lines.rebuild");
+    // Assign instance ranges, point ranges and total segment count.
     m_instanceCount = 0;
+    m_pointCount = 0;
     for (Line &line : m_lines) {
+        line.pointStart = m_pointCount;
         line.instanceStart = m_instanceCount;
         line.instanceCount = line.points.size() > 1 ? line.points.size() - 1 : 0;
+        m_pointCount += static_cast<int>(line.points.size());
         m_instanceCount += line.instanceCount;
     }
 
+    // Keyframes address points by index from each line's pointStart; any
+    // change in how many points each line has (not just in the total) means
+    // they no longer describe these lines.
+    bool layoutChanged = m_keyframeLayout.size() != m_lines.size();
+    for (int i = 0; !layoutChanged && i < m_lines.size(); ++i)
+        layoutChanged = m_keyframeLayout[i] != m_lines[i].points.size();
+    if (m_keyframeCount > 0 && layoutChanged) {
+        m_keyframeCount = 0;
+        m_keyframeTexels.clear();
+        m_keyframeLayout.clear();
+        pushKeyframes();
+        emit keyframesChanged();
+    }
+    setActiveAnimation(activeAnimation());
+
     m_data.resize(static_cast<qsizetype>(m_instanceCount) * kEntrySize);
     char *base = m_data.data();
     for (const Line &line : m_lines) {
@@ -400,6 +847,7 @@ void LineBatchInstancing::rebuild()
             writeLineEntries(base + static_cast<qsizetype>(line.instanceStart) * kEntrySize, line);
     }
 
+    m_indexState = IndexStale;
     updateBounds();
     m_dirty = false;
     markDirty();
@@ -431,9 +879,20 @@ void LineBatchInstancing::updateBounds()
         }
     }
 
+    // Keyframed lines render from the keyframe sets; the static points stay in
+    // so switching modes never leaves the bounds short.
+    if (m_activeAnimation == Keyframes) {
+        mn = QVector3D(qMin(mn.x(), m_keyframeMin.x()), qMin(mn.y(), m_keyframeMin.y()),
+                       qMin(mn.z(), m_keyframeMin.z()));
+        mx = QVector3D(qMax(mx.x(), m_keyframeMax.x()), qMax(mx.y(), m_keyframeMax.y()),
+                       qMax(mx.z(), m_keyframeMax.z()));
+    }
+
     // Expand by a margin so ribbon/cap expansion never falls outside the
-    // culling bounds. Width is a loose upper bound for the world-space growth.
-    const QVector3D margin(maxWidth, maxWidth, maxWidth);
+    // culling bounds. Width is a loose upper bound for the world-space growth;
+    // procedural sway moves points by up to boundsPadding on top.
+    const float pad = maxWidth + m_boundsPadding;
+    const QVector3D margin(pad, pad, pad);
     m_boundsMin = mn - margin;
     m_boundsMax = mx + margin;
     emit boundsChanged();
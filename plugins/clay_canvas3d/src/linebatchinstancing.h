@@ -2,11 +2,17 @@
 #define LINEBATCHINSTANCING_H
 
 #include <QQuick3DInstancing>
+#include <QVector2D>
 #include <QVector3D>
 #include <QVector4D>
 #include <QVariantList>
+#include <QVariantMap>
 #include <QByteArray>
 #include <QList>
+#include <QPointer>
+
+#include "linekeyframetexturedata.h"
+#include "spatialindex.h"
 
 class LineBatchInstancing : public QQuick3DInstancing
 {
@@ -17,8 +23,17 @@ class LineBatchInstancing : public QQuick3DInstancing
     Q_PROPERTY(int count READ count NOTIFY countChanged)
     Q_PROPERTY(QVector3D boundsMin READ boundsMin NOTIFY boundsChanged)
     Q_PROPERTY(QVector3D boundsMax READ boundsMax NOTIFY boundsChanged)
+    Q_PROPERTY(int animation READ animation WRITE setAnimation NOTIFY animationChanged)
+    Q_PROPERTY(int activeAnimation READ activeAnimation NOTIFY activeAnimationChanged)
+    Q_PROPERTY(int keyframeCount READ keyframeCount NOTIFY keyframesChanged)
+    Q_PROPERTY(LineKeyframeTextureData *keyframeData READ keyframeData WRITE setKeyframeData NOTIFY keyframeDataChanged)
+    Q_PROPERTY(float boundsPadding READ boundsPadding WRITE setBoundsPadding NOTIFY boundsPaddingChanged)
 
 public:
+    // Animation modes, in lockstep with LineBatch3D.Animation and the
+    // animMode uniform in line_batch.vert / line_batch.frag.
+    enum Animation { Static = 0, Keyframes = 1, Procedural = 2 };
+
     explicit LineBatchInstancing(QQuick3DObject *parent = nullptr);
 
     QVariantList lines() const;
@@ -28,6 +43,17 @@ public:
     QVector3D boundsMin() const;
     QVector3D boundsMax() const;
 
+    int animation() const { return m_animation; }
+    void setAnimation(int mode);
+    // The layout the instance table is written in: animation, except that
+    // Keyframes without matching keyframes falls back to Procedural.
+    int activeAnimation() const;
+    int keyframeCount() const { return m_keyframeCount; }
+    LineKeyframeTextureData *keyframeData() const { return m_keyframeData; }
+    void setKeyframeData(LineKeyframeTextureData *data);
+    float boundsPadding() const { return m_boundsPadding; }
+    void setBoundsPadding(float padding);
+
     // Fast bulk path for generators. See LineBatch3D::setBulk documentation.
     // styleIds is optional (uint16 per line); when empty every line is solid
     // (styleId 0), so the four-argument call behaves exactly as before.
@@ -59,10 +85,38 @@ public:
     Q_INVOKABLE qreal pathLength(int lineIndex) const;
     Q_INVOKABLE QVector3D positionAt(int lineIndex, qreal distance) const;
 
+    // Spatial queries over the static points, in batch coordinates, served
+    // from a segment BVH that is rebuilt lazily after topology changes and
+    // refitted after the point-update paths. pick() returns the segment
+    // nearest along the ray within tolerance (pixels when pixelScale is set,
+    // see SpatialIndex::Ray); queryBox() the sorted indices of lines with a
+    // segment inside the box; nearest() the closest segment to a point.
+    Q_INVOKABLE QVariantMap pick(const QVector3D &origin, const QVector3D &direction,
+                                 qreal tolerance, const QVector2D &pixelScale = QVector2D(),
+                                 bool pixelWidths = false) const;
+    Q_INVOKABLE QVariantList queryBox(const QVector3D &min, const QVector3D &max) const;
+    Q_INVOKABLE QVariantMap nearest(const QVector3D &point, qreal maxDistance = -1.0) const;
+
+    // Uploads keyframeCount point sets for GPU morphing (Keyframes mode):
+    // keyframeCount * pointCount float32 xyz triples, keyframe-major, each set
+    // in the batch's point order. The topology must match the current lines;
+    // a later rebuild that changes the point count drops the keyframes.
+    Q_INVOKABLE bool setKeyframes(const QByteArray &positions, int keyframeCount);
+    Q_INVOKABLE void clearKeyframes();
+
+    // Per-line time offsets (float32 seconds, one per line) for the animated
+    // modes; patches the table in place.
+    Q_INVOKABLE void setLinePhases(const QByteArray &phases);
+
 signals:
     void linesChanged();
     void countChanged();
     void boundsChanged();
+    void animationChanged();
+    void activeAnimationChanged();
+    void keyframesChanged();
+    void keyframeDataChanged();
+    void boundsPaddingChanged();
 
 protected:
     QByteArray getInstanceBuffer(int *instanceCount) override;
@@ -73,6 +127,8 @@ private:
         QVector4D color;
         float width = 1.0f;
         int styleId = 0;
+        float phase = 0.0f;    // time offset in the animated modes (seconds)
+        int pointStart = 0;    // first point index (keyframe texture addressing)
         int instanceStart = 0; // first instance (segment) index of this line
         int instanceCount = 0; // number of segments in this line
     };
@@ -80,6 +136,10 @@ private:
     void rebuild();
     void writeLineEntries(char *dst, const Line &line) const;
     void updateBounds();
+    void setActiveAnimation(int mode);
+    void pushKeyframes();
+    void markIndexMoved();
+    void ensureIndex() const;
 
     QList<Line> m_lines;
     QByteArray m_data;
@@ -87,6 +147,24 @@ private:
     QVector3D m_boundsMin;
     QVector3D m_boundsMax;
     bool m_dirty = true;
+
+    int m_animation = Static;
+    int m_activeAnimation = Static;
+    int m_pointCount = 0;
+    int m_keyframeCount = 0;
+    QByteArray m_keyframeTexels; // padded texture rows, see LineKeyframeTextureData
+    QList<int> m_keyframeLayout; // points per line the keyframes were made for
+    QVector3D m_keyframeMin;
+    QVector3D m_keyframeMax;
+    QPointer<LineKeyframeTextureData> m_keyframeData;
+    float m_boundsPadding = 0.0f;
+
+    // Segment index for the spatial queries; item i is instance (segment) i.
+    enum IndexState { IndexCurrent, IndexMoved, IndexStale };
+    mutable SpatialIndex m_index;
+    mutable QList<int> m_segmentLine; // owning line of each segment
+    mutable float m_indexMaxWidth = 0.0f;
+    mutable int m_indexState = IndexStale;
 };
 
 #endif // LINEBATCHINSTANCING_H
@@ -0,0 +1,87 @@
+#include "linekeyframetexturedata.h"
+#include <QSize>
+
+/*!
+    \qmltype LineKeyframeTextureData
+    \nativetype LineKeyframeTextureData
+    \inqmlmodule Clayground.Canvas3D
+    \brief RGBA32F texture holding LineBatch3D's animation keyframes.
+
+    Each texel stores one polyline point of one keyframe: \c RGB the position,
+    \c A the accumulated path distance from the line's first point in that
+    keyframe (so dash patterns stay continuous while a line morphs). Texels are
+    keyframe-major - all points of keyframe 0 in batch order, then keyframe 1 -
+    and wrap into rows of a fixed width; the vertex shader addresses point
+    \c p of keyframe \c k at linear index \c{k * pointCount + p}.
+
+    There is always a texture: without keyframes it is a single zero texel, so
+    the material binding stays valid in every animation mode.
+
+    This type is used internally by LineBatch3D.
+
+    \sa LineBatch3D, LineBatchInstancing
+*/
+LineKeyframeTextureData::LineKeyframeTextureData(QQuick3DObject *parent)
+    : QQuick3DTextureData(parent)
+{
+    setFormat(QQuick3DTextureData::RGBA32F);
+    setHasTransparency(false);
+    setPlaceholder();
+}
+
+/*!
+    \qmlproperty int LineKeyframeTextureData::keyframeCount
+    \readonly
+    \brief The number of keyframes in the texture (0 when empty).
+*/
+
+/*!
+    \qmlproperty int LineKeyframeTextureData::pointCount
+    \readonly
+    \brief The number of points per keyframe (0 when empty).
+*/
+
+/*!
+    \qmlproperty vector2d LineKeyframeTextureData::textureSize
+    \readonly
+    \brief The texture size in texels, for addressing from the shader.
+*/
+QVector2D LineKeyframeTextureData::textureSize() const
+{
+    const QSize s = size();
+    return QVector2D(s.width(), s.height());
+}
+
+int LineKeyframeTextureData::rowsFor(qsizetype texelCount)
+{
+    const qsizetype rows = (texelCount + kTextureWidth - 1) / kTextureWidth;
+    return rows > kMaxTextureHeight ? 0 : static_cast<int>(qMax<qsizetype>(rows, 1));
+}
+
+void LineKeyframeTextureData::setKeyframes(const QByteArray &texels, int pointCount, int keyframeCount)
+{
+    const int rows = rowsFor(static_cast<qsizetype>(pointCount) * keyframeCount);
+    const qsizetype expected = static_cast<qsizetype>(rows) * kTextureWidth * 4 * sizeof(float);
+    if (texels.isEmpty() || pointCount <= 0 || keyframeCount <= 0 || rows == 0
+        || texels.size() != expected) {
+        setPlaceholder();
+        return;
+    }
+
+    m_pointCount = pointCount;
+    m_keyframeCount = keyframeCount;
+    setSize(QSize(kTextureWidth, rows));
+    setTextureData(texels);
+    emit layoutChanged();
+}
+
+void LineKeyframeTextureData::setPlaceholder()
+{
+    const bool changed = m_keyframeCount != 0 || m_pointCount != 0;
+    m_keyframeCount = 0;
+    m_pointCount = 0;
+    setSize(QSize(1, 1));
+    setTextureData(QByteArray(4 * sizeof(float), '\0'));
+    if (changed)
+        emit layoutChanged();
+}
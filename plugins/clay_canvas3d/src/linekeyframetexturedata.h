@@ -0,0 +1,50 @@
+#ifndef LINEKEYFRAMETEXTUREDATA_H
+#define LINEKEYFRAMETEXTUREDATA_H
+
+#include <QQuick3DTextureData>
+#include <QVector2D>
+
+// GPU-resident point sets for LineBatch3D's Keyframes animation mode. Holds
+// keyframeCount x pointCount RGBA32F texels (xyz + accumulated path distance),
+// keyframe-major, wrapped into rows of kTextureWidth texels. The texel buffer
+// is laid out by LineBatchInstancing::setKeyframes; this type only owns the
+// texture and publishes the layout the vertex shader needs to address it.
+class LineKeyframeTextureData : public QQuick3DTextureData
+{
+    Q_OBJECT
+    QML_NAMED_ELEMENT(LineKeyframeTextureData)
+
+    Q_PROPERTY(int keyframeCount READ keyframeCount NOTIFY layoutChanged)
+    Q_PROPERTY(int pointCount READ pointCount NOTIFY layoutChanged)
+    Q_PROPERTY(QVector2D textureSize READ textureSize NOTIFY layoutChanged)
+
+public:
+    // Row width in texels. 2048 is the smallest MAX_TEXTURE_SIZE WebGL 2
+    // guarantees; the shader reads the actual size from textureSize.
+    static constexpr int kTextureWidth = 2048;
+    static constexpr int kMaxTextureHeight = 8192;
+
+    explicit LineKeyframeTextureData(QQuick3DObject *parent = nullptr);
+
+    int keyframeCount() const { return m_keyframeCount; }
+    int pointCount() const { return m_pointCount; }
+    QVector2D textureSize() const;
+
+    // Number of rows needed for texelCount texels (0 if it exceeds the limit).
+    static int rowsFor(qsizetype texelCount);
+
+    // Takes a buffer of kTextureWidth * rowsFor(keyframeCount * pointCount)
+    // RGBA32F texels. An empty buffer resets to the 1x1 placeholder.
+    void setKeyframes(const QByteArray &texels, int pointCount, int keyframeCount);
+
+signals:
+    void layoutChanged();
+
+private:
+    void setPlaceholder();
+
+    int m_keyframeCount = 0;
+    int m_pointCount = 0;
+};
+
+#endif // LINEKEYFRAMETEXTUREDATA_H
@@ -1,7 +1,7 @@
 #include "linestyletexturedata.h"
-#include <QVariantMap>
-#include <QVector>
+#include "perftrace.h"
 #include <QSize>
+#include <cstring>
 
 /*!
     \qmltype LineStyleTextureData
@@ -10,11 +10,14 @@
     \brief Bakes a list of line styles into a small RGBA32F lookup texture.
 
     LineStyleTextureData turns the declarative \l{LineBatch3D::styles}{styles}
-    list into a one-pixel-tall RGBA32F texture, one texel column per style.
-    LineBatch3D's fragment shader samples the column selected by a line's
-    \c styleId (carried in the instance table) and decodes it. The texture is
-    \c kTableRows RGBA32F rows tall (a versioned constant, so adding a row is a
-    non-breaking format bump); the rows are:
+    list into a small RGBA32F texture. Every style is a column of
+    \c kTableRows texels (a versioned constant, so adding a row is a
+    non-breaking format bump); LineBatch3D's shaders fetch the column selected
+    by a line's \c styleId (carried in the instance table) and decode it. Up
+    to 1024 styles sit side by side in one band, exactly the v1 layout; larger
+    tables wrap into further bands below, up to 65536 styles (the range of a
+    uint16 styleId). The shaders address a style through \l textureSize. The
+    rows of a style column are:
 
     \list
     \li \b{row 0} - \c R dash length (0 = solid), \c G gap length,
@@ -33,6 +36,13 @@
     round-capped, fully opaque line, so \c styleId 0 works without configuring
     any styles.
 
+    Assigning \l styles re-encodes the whole table. To animate or restyle
+    individual entries use \l setStyle and \l setStyleValue instead: they
+    re-encode only the touched style and patch its texels in the resident
+    buffer. Styles carrying a \c key string can be addressed by that key
+    (see \l styleId), so data-driven styling (one style per road class or
+    traffic level) does not need to track indices.
+
     This type is used internally by LineBatch3D.
 
     \sa LineBatch3D
@@ -50,8 +60,11 @@ LineStyleTextureData::LineStyleTextureData(QQuick3DObject *parent)
     Each element is an object
     \c{{ dash: [dashLen, gapLen], capRound: <bool>, opacity: <real>,
     pattern: <string>, patternUnits: <string>, flow: <real>, glow: <real>,
-    pulse: <real>, head: [length, width] }}. All keys past \c opacity are
-    optional and default to the plain solid/dashed v1 behaviour.
+    pulse: <real>, head: [length, width], key: <string> }}. All keys past
+    \c opacity are optional and default to the plain solid/dashed v1
+    behaviour. Lists longer than 65536 entries are truncated.
+
+    Reassigning the list drops any style added through \l setStyle.
 */
 QVariantList LineStyleTextureData::styles() const
 {
@@ -61,6 +74,11 @@ QVariantList LineStyleTextureData::styles() const
 void LineStyleTextureData::setStyles(const QVariantList &styles)
 {
     m_styles = styles;
+    if (m_styles.size() > kMaxStyles) {
+        qWarning("LineStyleTextureData: %d styles exceed the limit of %d, truncating",
+                 static_cast<int>(m_styles.size()), kMaxStyles);
+        m_styles.resize(kMaxStyles);
+    }
     rebuild();
     emit stylesChanged();
 }
@@ -68,20 +86,122 @@ void LineStyleTextureData::setStyles(const QVariantList &styles)
 /*!
     \qmlproperty int LineStyleTextureData::styleCount
     \readonly
-    \brief The number of style columns in the texture (always at least 1).
+    \brief The number of styles in the texture (always at least 1).
 */
 int LineStyleTextureData::styleCount() const
 {
-    return m_styleCount;
+    return static_cast<int>(m_encoded.size());
 }
 
-void LineStyleTextureData::rebuild()
+/*!
+    \qmlproperty vector2d LineStyleTextureData::textureSize
+    \readonly
+    \brief The texture size in texels, for addressing from the shader.
+
+    The width is the number of styles per band, the height \c kTableRows
+    times the number of bands.
+*/
+QVector2D LineStyleTextureData::textureSize() const
 {
-    // Always emit at least one column so that styleId 0 resolves to a sane
-    // default (solid, round cap, opaque) even when no styles were configured.
-    const int count = qMax(1, static_cast<int>(m_styles.size()));
-    m_styleCount = count;
+    return QVector2D(m_width, m_bands * kTableRows);
+}
+
+/*!
+    \qmlmethod int LineStyleTextureData::styleId(string key)
+    \brief Returns the index of the style whose \c key is \a key, or -1.
+*/
+int LineStyleTextureData::styleId(const QString &key) const
+{
+    return m_keys.value(key, -1);
+}
+
+/*!
+    \qmlmethod int LineStyleTextureData::setStyle(var idOrKey, object style)
+    \brief Replaces one style and returns its index.
+
+    \a idOrKey is a style index or a \c key. An index equal to
+    \l styleCount, or a key not in the table yet, appends the style (a new
+    key is stored in the style). Only the affected texels are rewritten,
+    unless the append grows the texture. Returns -1 for an out-of-range index
+    or when the table is full.
+*/
+int LineStyleTextureData::setStyle(const QVariant &idOrKey, const QVariantMap &style)
+{
+    int index = resolve(idOrKey);
+    QVariantMap entry = style;
+    if (index < 0) {
+        const bool byKey = idOrKey.typeId() == QMetaType::QString;
+        const int next = static_cast<int>(m_styles.size());
+        if ((!byKey && idOrKey.toInt() != next) || next >= kMaxStyles)
+            return -1;
+        index = next;
+        if (byKey)
+            entry.insert(QStringLiteral("key"), idOrKey.toString());
+        m_styles.append(entry);
+    } else {
+        // Index 0 without a configured list is the implicit default style.
+        if (index >= m_styles.size())
+            m_styles.resize(index + 1);
+        const QString oldKey = m_styles.at(index).toMap().value(QStringLiteral("key")).toString();
+        if (!oldKey.isEmpty() && !entry.contains(QStringLiteral("key")))
+            entry.insert(QStringLiteral("key"), oldKey);
+        else if (!oldKey.isEmpty())
+            m_keys.remove(oldKey);
+        m_styles[index] = entry;
+    }
+
+    const QString key = entry.value(QStringLiteral("key")).toString();
+    if (!key.isEmpty())
+        m_keys.insert(key, index);
+
+    const Texels texels = encode(entry);
+    if (index < m_encoded.size()) {
+        m_encoded[index] = texels;
+        patch(index);
+    } else {
+        m_encoded.append(texels);
+        // The texture only grows while the first band widens or when a new
+        // band starts; otherwise the new column already exists.
+        if (index < kBandWidth || index % kBandWidth == 0) {
+            relayout();
+        } else {
+            patch(index);
+            emit layoutChanged();
+        }
+    }
+    return index;
+}
+
+/*!
+    \qmlmethod bool LineStyleTextureData::setStyleValue(var idOrKey, string name, var value)
+    \brief Changes a single key of one style, e.g. its \c pulse or \c glow.
+
+    The cheap path for per-frame style animation: only that style's texels are
+    re-encoded and patched. Returns false when \a idOrKey does not name an
+    existing style.
+*/
+bool LineStyleTextureData::setStyleValue(const QVariant &idOrKey, const QString &name,
+                                         const QVariant &value)
+{
+    const int index = resolve(idOrKey);
+    if (index < 0)
+        return false;
+    QVariantMap entry = index < m_styles.size() ? m_styles.at(index).toMap() : QVariantMap();
+    entry.insert(name, value);
+    return setStyle(index, entry) >= 0;
+}
+
+int LineStyleTextureData::resolve(const QVariant &idOrKey) const
+{
+    if (idOrKey.typeId() == QMetaType::QString)
+        return styleId(idOrKey.toString());
+    bool ok = false;
+    const int index = idOrKey.toInt(&ok);
+    return ok && index >= 0 && index < m_encoded.size() ? index : -1;
+}
 
+LineStyleTextureData::Texels LineStyleTextureData::encode(const QVariantMap &m)
+{
     // Glyph enum, kept in lockstep with line_batch.frag. The screen-units flag
     // rides as bit 8 of the stored id so the glyph itself stays a plain enum.
     constexpr int kGlyphDash = 0;
@@ -90,89 +210,112 @@ void LineStyleTextureData::rebuild()
     constexpr int kGlyphTriangle = 3;
     constexpr int kScreenUnitsBit = 8;
 
-    // Row-major RGBA32F: all columns of row 0, then row 1, then row 2.
-    QVector<float> pixels(count * 4 * LineStyleTextureData::kTableRows, 0.0f);
-    const int rowStride = count * 4;
-    for (int i = 0; i < count; ++i) {
-        float dashLen = 0.0f;
-        float gapLen = 0.0f;
-        float capRound = 1.0f;
-        float opacity = 1.0f;
-
-        int glyph = kGlyphDash;
-        bool screenUnits = false;
-        float glyphWidth = 0.0f; // triangle base-width fraction (0 = full width)
-        float flow = 0.0f;
-        float glow = 0.0f;
-        float pulse = 0.0f;
-        float headLen = 0.0f;
-        float headWid = 0.0f;
-
-        if (i < m_styles.size()) {
-            const QVariantMap m = m_styles.at(i).toMap();
-            const QVariantList dash = m.value(QStringLiteral("dash")).toList();
-            if (dash.size() >= 2) {
-                dashLen = dash.at(0).toFloat();
-                gapLen = dash.at(1).toFloat();
-            }
-            capRound = m.value(QStringLiteral("capRound"), true).toBool() ? 1.0f : 0.0f;
-            opacity = m.value(QStringLiteral("opacity"), 1.0).toFloat();
-
-            const QString pattern = m.value(QStringLiteral("pattern")).toString().toLower();
-            if (pattern == QStringLiteral("dot"))
-                glyph = kGlyphDot;
-            else if (pattern == QStringLiteral("chevron"))
-                glyph = kGlyphChevron;
-            else if (pattern == QStringLiteral("triangle"))
-                glyph = kGlyphTriangle;
-            // "solid", "dash" and absent all keep the dash glyph (period 0 = solid).
-
-            // Triangle base-width as a fraction of the ribbon width, clamped to
-            // (0, 1]; 0 (or absent) means the shader default of the full width.
-            glyphWidth = m.value(QStringLiteral("glyphWidth"), 0.0).toFloat();
-            if (glyphWidth < 0.0f)
-                glyphWidth = 0.0f;
-            if (glyphWidth > 1.0f)
-                glyphWidth = 1.0f;
-
-            screenUnits = m.value(QStringLiteral("patternUnits")).toString().toLower()
-                          == QStringLiteral("screen");
-            flow = m.value(QStringLiteral("flow"), 0.0).toFloat();
-            glow = m.value(QStringLiteral("glow"), 0.0).toFloat();
-            pulse = m.value(QStringLiteral("pulse"), 0.0).toFloat();
-
-            const QVariantList head = m.value(QStringLiteral("head")).toList();
-            if (head.size() >= 2) {
-                headLen = head.at(0).toFloat();
-                headWid = head.at(1).toFloat();
-            }
-        }
+    float dashLen = 0.0f;
+    float gapLen = 0.0f;
+    const QVariantList dash = m.value(QStringLiteral("dash")).toList();
+    if (dash.size() >= 2) {
+        dashLen = dash.at(0).toFloat();
+        gapLen = dash.at(1).toFloat();
+    }
+    const float capRound = m.value(QStringLiteral("capRound"), true).toBool() ? 1.0f : 0.0f;
+    const float opacity = m.value(QStringLiteral("opacity"), 1.0).toFloat();
+
+    int glyph = kGlyphDash;
+    const QString pattern = m.value(QStringLiteral("pattern")).toString().toLower();
+    if (pattern == QStringLiteral("dot"))
+        glyph = kGlyphDot;
+    else if (pattern == QStringLiteral("chevron"))
+        glyph = kGlyphChevron;
+    else if (pattern == QStringLiteral("triangle"))
+        glyph = kGlyphTriangle;
+    // "solid", "dash" and absent all keep the dash glyph (period 0 = solid).
+
+    // Triangle base-width as a fraction of the ribbon width, clamped to
+    // (0, 1]; 0 (or absent) means the shader default of the full width.
+    const float glyphWidth = qBound(0.0f, m.value(QStringLiteral("glyphWidth"), 0.0).toFloat(), 1.0f);
+
+    const bool screenUnits = m.value(QStringLiteral("patternUnits")).toString().toLower()
+                             == QStringLiteral("screen");
+    const float flow = m.value(QStringLiteral("flow"), 0.0).toFloat();
+    const float glow = m.value(QStringLiteral("glow"), 0.0).toFloat();
+    const float pulse = m.value(QStringLiteral("pulse"), 0.0).toFloat();
 
-        const float patternId = static_cast<float>(
-            glyph | (screenUnits ? kScreenUnitsBit : 0));
+    float headLen = 0.0f;
+    float headWid = 0.0f;
+    const QVariantList head = m.value(QStringLiteral("head")).toList();
+    if (head.size() >= 2) {
+        headLen = head.at(0).toFloat();
+        headWid = head.at(1).toFloat();
+    }
+
+    const float patternId = static_cast<float>(glyph | (screenUnits ? kScreenUnitsBit : 0));
 
+    return Texels{
         // row 0
-        pixels[0 * rowStride + i * 4 + 0] = dashLen;
-        pixels[0 * rowStride + i * 4 + 1] = gapLen;
-        pixels[0 * rowStride + i * 4 + 2] = capRound;
-        pixels[0 * rowStride + i * 4 + 3] = opacity;
-        // row 1
-        pixels[1 * rowStride + i * 4 + 0] = patternId;
-        pixels[1 * rowStride + i * 4 + 1] = glyphWidth; // param0: triangle base-width fraction
-        pixels[1 * rowStride + i * 4 + 2] = 0.0f; // param1 (reserved)
-        pixels[1 * rowStride + i * 4 + 3] = flow;
+        dashLen, gapLen, capRound, opacity,
+        // row 1: patternId, param0 (triangle base-width fraction),
+        // param1 (reserved), flow
+        patternId, glyphWidth, 0.0f, flow,
         // row 2
-        pixels[2 * rowStride + i * 4 + 0] = glow;
-        pixels[2 * rowStride + i * 4 + 1] = pulse;
-        pixels[2 * rowStride + i * 4 + 2] = headLen;
-        pixels[2 * rowStride + i * 4 + 3] = headWid;
+        glow, pulse, headLen, headWid,
+    };
+}
+
+void LineStyleTextureData::rebuild()
+{
+    CLAY_PERF_ZONE("lines.styleRebuild");
+    // Always keep at least one style so that styleId 0 resolves to a sane
+    // default (solid, round cap, opaque) even when no styles were configured.
+    const int count = qMax(1, static_cast<int>(m_styles.size()));
+    m_encoded.resize(count);
+    m_keys.clear();
+    for (int i = 0; i < count; ++i) {
+        const QVariantMap m = i < m_styles.size() ? m_styles.at(i).toMap() : QVariantMap();
+        m_encoded[i] = encode(m);
+        const QString key = m.value(QStringLiteral("key")).toString();
+        if (!key.isEmpty())
+            m_keys.insert(key, i);
     }
+    relayout();
+}
+
+// Lays the encoded styles out into the texture: style i is column
+// i % kBandWidth of band i / kBandWidth, its rows stacked inside the band.
+void LineStyleTextureData::relayout()
+{
+    const int count = static_cast<int>(m_encoded.size());
+    const int width = qMin(count, kBandWidth);
+    const int bands = (count + kBandWidth - 1) / kBandWidth;
+    m_width = width;
+    m_bands = bands;
 
-    QByteArray data(reinterpret_cast<const char *>(pixels.constData()),
-                    pixels.size() * static_cast<int>(sizeof(float)));
+    m_data = QByteArray(static_cast<qsizetype>(width) * bands * kTableRows * 4 * sizeof(float),
+                        '\0');
+    for (int i = 0; i < count; ++i)
+        patchTexels(i);
 
-    setSize(QSize(count, LineStyleTextureData::kTableRows));
+    setSize(QSize(width, bands * kTableRows));
     setFormat(QQuick3DTextureData::RGBA32F);
     setHasTransparency(true);
-    setTextureData(data);
+    setTextureData(m_data);
+    emit layoutChanged();
+}
+
+void LineStyleTextureData::patchTexels(int index)
+{
+    const int col = index % kBandWidth;
+    const int band = index / kBandWidth;
+    auto *pixels = reinterpret_cast<float *>(m_data.data());
+    const float *src = m_encoded.at(index).data();
+    for (int row = 0; row < kTableRows; ++row) {
+        const qsizetype texel = static_cast<qsizetype>(band * kTableRows + row) * m_width + col;
+        std::memcpy(pixels + texel * 4, src + row * 4, 4 * sizeof(float));
+    }
+}
+
+void LineStyleTextureData::patch(int index)
+{
+    CLAY_PERF_ZONE("lines.stylePatch");
+    patchTexels(index);
+    setTextureData(m_data);
 }
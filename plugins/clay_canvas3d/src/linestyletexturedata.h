@@ -3,6 +3,11 @@
 
 #include <QQuick3DTextureData>
 #include <QVariantList>
+#include <QVariantMap>
+#include <QVector2D>
+#include <QHash>
+#include <QVector>
+#include <array>
 
 class LineStyleTextureData : public QQuick3DTextureData
 {
@@ -10,17 +15,25 @@ class LineStyleTextureData : public QQuick3DTextureData
     QML_NAMED_ELEMENT(LineStyleTextureData)
 
     Q_PROPERTY(QVariantList styles READ styles WRITE setStyles NOTIFY stylesChanged)
-    Q_PROPERTY(int styleCount READ styleCount NOTIFY stylesChanged)
+    Q_PROPERTY(int styleCount READ styleCount NOTIFY layoutChanged)
+    Q_PROPERTY(QVector2D textureSize READ textureSize NOTIFY layoutChanged)
 
 public:
-    // Style-table format version. The texture is kTableRows RGBA32F rows tall;
-    // the fragment shader hard-codes the same height, so bumping the format
-    // means bumping this constant and the matching literal in line_batch.frag.
+    // Style-table format version. Every style is kTableRows RGBA32F texels
+    // stacked vertically; the shaders hard-code the same count, so bumping the
+    // format means bumping this constant and the matching literal in
+    // line_batch.vert / line_batch.frag.
     //   row 0: dashLen, gapLen, capRound, opacity        (v1 layout, frozen)
     //   row 1: patternId (glyph enum | screen-units bit), param0 (triangle
     //          base-width fraction), param1, flow
     //   row 2: glow, pulse, headLength, headWidth
     static constexpr int kTableRows = 3;
+    // Styles per band. Tables up to this size are one band (kTableRows texels
+    // tall, one column per style, the v1 layout); larger ones wrap into further
+    // bands below. 1024 x 64 bands covers every uint16 styleId.
+    static constexpr int kBandWidth = 1024;
+    static constexpr int kMaxBands = 64;
+    static constexpr int kMaxStyles = kBandWidth * kMaxBands;
 
     explicit LineStyleTextureData(QQuick3DObject *parent = nullptr);
 
@@ -28,15 +41,33 @@ public:
     void setStyles(const QVariantList &styles);
 
     int styleCount() const;
+    QVector2D textureSize() const;
+
+    Q_INVOKABLE int styleId(const QString &key) const;
+    Q_INVOKABLE int setStyle(const QVariant &idOrKey, const QVariantMap &style);
+    Q_INVOKABLE bool setStyleValue(const QVariant &idOrKey, const QString &name,
+                                   const QVariant &value);
 
 signals:
     void stylesChanged();
+    void layoutChanged();
 
 private:
+    using Texels = std::array<float, kTableRows * 4>;
+
+    static Texels encode(const QVariantMap &style);
+    int resolve(const QVariant &idOrKey) const;
     void rebuild();
+    void relayout();
+    void patchTexels(int index);
+    void patch(int index);
 
     QVariantList m_styles;
-    int m_styleCount = 1;
+    QHash<QString, int> m_keys;   // style "key" -> index
+    QVector<Texels> m_encoded;    // style-major, always at least one entry
+    QByteArray m_data;            // laid-out texture (see textureSize)
+    int m_width = 1;
+    int m_bands = 1;
 };
 
 #endif // LINESTYLETEXTUREDATA_H
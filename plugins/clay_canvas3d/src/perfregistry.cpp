@@ -1,6 +1,8 @@
 // (c) Clayground Contributors - MIT License, see "LICENSE" file
 #include "perfregistry.h"
+#include "perftrace.h"
 #include <QDateTime>
+#include <QUrl>
 #include <QVariantMap>
 
 /*!
@@ -24,6 +26,12 @@
     touched. \l PerfHud appends a \l snapshot of these readings beneath its
     render stats automatically.
 
+    Setting \l tracing to \c true additionally records every section as a
+    timestamped zone (nested zones and zones from worker threads included, e.g.
+    voxel meshing and line rebuilds instrumented in C++) plus \l counter values.
+    \l exportTrace writes them as Chrome trace-event JSON, which can be opened
+    in \l{https://ui.perfetto.dev}{Perfetto} or \c{chrome://tracing}.
+
     \qml
     import Clayground.Canvas3D
 
@@ -35,6 +43,11 @@
     PerfRegistry.begin("carPack")
     packAndUpload()
     PerfRegistry.end("carPack")
+
+    // record a trace of the next frames, then write it out
+    PerfRegistry.tracing = true
+    ...
+    PerfRegistry.exportTrace("file:///tmp/frame.trace.json")
     \endqml
 
     \sa PerfHud, DynamicInstances3D
@@ -46,16 +59,52 @@ PerfRegistry::PerfRegistry(QObject *parent)
     m_clock.start();
 }
 
+/*!
+    \qmlproperty bool PerfRegistry::tracing
+    \brief Records sections and counters as trace events while \c true.
+
+    Tracing is process-wide: it also enables the zones compiled into the C++
+    side of Canvas3D. Defaults to \c false.
+*/
+bool PerfRegistry::tracing() const
+{
+    return PerfTrace::isEnabled();
+}
+
+void PerfRegistry::setTracing(bool tracing)
+{
+    if (PerfTrace::isEnabled() == tracing)
+        return;
+    if (tracing)
+        PerfTrace::setThreadName(QStringLiteral("main"));
+    PerfTrace::setEnabled(tracing);
+    emit tracingChanged();
+}
+
+std::uint32_t PerfRegistry::traceId(const QString &name)
+{
+    auto it = m_traceIds.constFind(name);
+    if (it != m_traceIds.constEnd())
+        return *it;
+    const std::uint32_t id = PerfTrace::intern(name);
+    m_traceIds.insert(name, id);
+    return id;
+}
+
 /*!
     \qmlmethod void PerfRegistry::begin(string name)
     \brief Starts timing the section \a name.
 */
 void PerfRegistry::begin(const QString &name)
 {
-    Section &s = m_sections[name];
-    if (s.startNs < 0 && !m_sectionOrder.contains(name))
+    auto it = m_sections.find(name);
+    if (it == m_sections.end()) {
+        it = m_sections.insert(name, Section());
+        it->traceId = traceId(name);
         m_sectionOrder.append(name);
-    s.startNs = m_clock.nsecsElapsed();
+    }
+    it->traced = PerfTrace::beginZone(it->traceId);
+    it->startNs = m_clock.nsecsElapsed();
 }
 
 /*!
@@ -69,14 +118,17 @@ void PerfRegistry::end(const QString &name)
         return;
     Section &s = *it;
     const double ms = (m_clock.nsecsElapsed() - s.startNs) / 1.0e6;
+    PerfTrace::endZone(s.traceId, s.traced);
     s.startNs = -1;
-    s.samples.append(ms);
-    while (s.samples.size() > kWindow)
-        s.samples.removeFirst();
-    double sum = 0.0;
-    for (double v : s.samples)
-        sum += v;
-    s.avgMs = s.samples.isEmpty() ? 0.0 : sum / s.samples.size();
+    // Running sum over a fixed ring: O(1) per sample.
+    if (s.sampleCount == kWindow)
+        s.sum -= s.samples[s.nextSample];
+    else
+        ++s.sampleCount;
+    s.samples[s.nextSample] = ms;
+    s.nextSample = (s.nextSample + 1) % kWindow;
+    s.sum += ms;
+    s.avgMs = s.sum / s.sampleCount;
 }
 
 /*!
@@ -93,6 +145,37 @@ void PerfRegistry::tick(const QString &name)
     while (!c.stamps.isEmpty() && now - c.stamps.first() > 1000)
         c.stamps.removeFirst();
     c.rate = c.stamps.size();
+    if (PerfTrace::isEnabled())
+        PerfTrace::counter(traceId(name), c.rate);
+}
+
+/*!
+    \qmlmethod void PerfRegistry::counter(string name, real value)
+    \brief Records \a value on the trace counter track \a name.
+
+    Counter tracks appear as graphs in an exported trace (e.g. live voice or
+    instance counts). Only recorded while \l tracing is enabled.
+*/
+void PerfRegistry::counter(const QString &name, double value)
+{
+    if (PerfTrace::isEnabled())
+        PerfTrace::counter(traceId(name), value);
+}
+
+/*!
+    \qmlmethod bool PerfRegistry::exportTrace(string path)
+    \brief Writes all trace events recorded so far to \a path.
+
+    The file uses the Chrome trace-event JSON format. Exported events are
+    consumed, so consecutive exports produce consecutive slices of the run.
+    Returns \c false if the file cannot be written.
+*/
+bool PerfRegistry::exportTrace(const QString &path)
+{
+    QString localPath = path;
+    if (localPath.startsWith(QLatin1String("file:")))
+        localPath = QUrl(localPath).toLocalFile();
+    return PerfTrace::exportChromeTrace(localPath);
 }
 
 /*!
@@ -106,7 +189,7 @@ QVariantList PerfRegistry::snapshot() const
 {
     QVariantList out;
     for (const QString &name : m_sectionOrder) {
-        const Section &s = m_sections.value(name);
+        const Section &s = *m_sections.constFind(name);
         QVariantMap m;
         m.insert(QStringLiteral("name"), name);
         m.insert(QStringLiteral("kind"), QStringLiteral("section"));
@@ -115,7 +198,7 @@ QVariantList PerfRegistry::snapshot() const
         out.append(m);
     }
     for (const QString &name : m_counterOrder) {
-        const Counter &c = m_counters.value(name);
+        const Counter &c = *m_counters.constFind(name);
         QVariantMap m;
         m.insert(QStringLiteral("name"), name);
         m.insert(QStringLiteral("kind"), QStringLiteral("counter"));
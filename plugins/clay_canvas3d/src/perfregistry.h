@@ -9,23 +9,32 @@
 #include <QList>
 #include <QString>
 #include <QVariantList>
+#include <cstdint>
 
 // Dependency-free, app-wide performance registry. begin()/end() measure named
 // code sections (rolling average over ~60 samples); tick() counts named events
 // (per-second rate). snapshot() returns the current readings for a HUD. Cheap
 // when unused - nothing runs until a section or counter is first touched.
-// Exposed to QML as the singleton PerfRegistry.
+// With tracing enabled, sections and counters are also recorded as nested zones
+// into the PerfTrace backend (see perftrace.h) and can be exported for
+// Perfetto. Exposed to QML as the singleton PerfRegistry.
 class PerfRegistry : public QObject
 {
     Q_OBJECT
     QML_NAMED_ELEMENT(PerfRegistry)
     QML_SINGLETON
 
+    Q_PROPERTY(bool tracing READ tracing WRITE setTracing NOTIFY tracingChanged)
+
 public:
     explicit PerfRegistry(QObject *parent = nullptr);
 
-    // Start timing the named section. Nesting the same name is not supported;
-    // the most recent begin() wins.
+    bool tracing() const;
+    void setTracing(bool tracing);
+
+    // Start timing the named section. Nesting the same name is not supported
+    // for the rolling average (the most recent begin() wins); distinct names
+    // nest freely and show up nested in an exported trace.
     Q_INVOKABLE void begin(const QString &name);
 
     // Stop timing the named section and fold the elapsed time into its rolling
@@ -35,6 +44,13 @@ public:
     // Record one occurrence of the named counter (rate averaged over 1 s).
     Q_INVOKABLE void tick(const QString &name);
 
+    // Record a sampled value for the named counter track (trace only).
+    Q_INVOKABLE void counter(const QString &name, double value);
+
+    // Write everything traced so far as Chrome trace-event JSON (loadable in
+    // Perfetto). Accepts file:// URLs and plain paths.
+    Q_INVOKABLE bool exportTrace(const QString &path);
+
     // Current readings: a list of { name, kind, avgMs, rate } maps. Section rows
     // carry avgMs (rate 0); counter rows carry rate (avgMs 0).
     Q_INVOKABLE QVariantList snapshot() const;
@@ -42,24 +58,35 @@ public:
     // Drop all sections and counters.
     Q_INVOKABLE void reset();
 
+signals:
+    void tracingChanged();
+
 private:
+    static constexpr int kWindow = 60;
+
     struct Section {
         qint64 startNs = -1;
-        QList<double> samples;  // rolling window of durations (ms)
+        double samples[kWindow] = {};  // ring of durations (ms)
+        int sampleCount = 0;
+        int nextSample = 0;
+        double sum = 0.0;
         double avgMs = 0.0;
+        std::uint32_t traceId = 0;
+        bool traced = false;    // begin recorded a trace zone
     };
     struct Counter {
         QList<qint64> stamps;   // event timestamps (ms), last 1 s
         double rate = 0.0;
     };
 
-    static constexpr int kWindow = 60;
+    std::uint32_t traceId(const QString &name);
 
     QElapsedTimer m_clock;
     QHash<QString, Section> m_sections;
     QList<QString> m_sectionOrder;
     QHash<QString, Counter> m_counters;
     QList<QString> m_counterOrder;
+    QHash<QString, std::uint32_t> m_traceIds;
 };
 
 #endif // PERFREGISTRY_H
@@ -0,0 +1,252 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+#include "perftrace.h"
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QHash>
+#include <QSaveFile>
+#include <QThread>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace PerfTrace {
+
+namespace detail {
+std::atomic<bool> g_enabled{false};
+}
+
+namespace {
+
+// Single-producer ring owned by one thread. head is only advanced by the
+// owning thread, tail only by the exporter (under the registry mutex).
+struct ThreadRing {
+    std::unique_ptr<Event[]> events{new Event[kRingCapacity]};
+    std::atomic<std::uint64_t> head{0};
+    std::atomic<std::uint64_t> tail{0};
+    std::atomic<std::uint64_t> dropped{0};
+    std::uint32_t tid = 0;
+    QByteArray name;        // guarded by Registry::mutex
+};
+
+struct Registry {
+    std::mutex mutex;
+    // Rings outlive their threads so late exports still see their events;
+    // the ring of a thread that exited goes to the next new thread, so
+    // respawning pool workers don't add rings.
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+    std::vector<ThreadRing *> freeRings;
+    // Events from threads that found all kMaxThreadRings rings taken
+    std::atomic<std::uint64_t> ringless{0};
+    std::vector<QByteArray> names;
+    QHash<QByteArray, std::uint32_t> ids;
+    const std::int64_t originNs = detail::nowNs();
+};
+
+Registry &registry()
+{
+    static Registry r;
+    return r;
+}
+
+// Hands the calling thread's ring back to the registry when it exits.
+struct RingLease {
+    ThreadRing *ring = nullptr;
+    ~RingLease()
+    {
+        if (!ring)
+            return;
+        Registry &r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.freeRings.push_back(ring);
+    }
+};
+
+// The plain pointer keeps the recording path free of thread_local
+// destructor bookkeeping; the lease is only touched when claiming.
+thread_local ThreadRing *t_ring = nullptr;
+thread_local bool t_ringless = false;
+thread_local RingLease t_lease;
+
+// The calling thread's ring, or nullptr once all rings are taken.
+ThreadRing *threadRing()
+{
+    if (t_ring || t_ringless)
+        return t_ring;
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    ThreadRing *ring = nullptr;
+    if (!r.freeRings.empty()) {
+        // Keeps its tid; events its last owner left undrained export under
+        // the new owner's name.
+        ring = r.freeRings.back();
+        r.freeRings.pop_back();
+    } else if (r.rings.size() < kMaxThreadRings) {
+        r.rings.push_back(std::make_unique<ThreadRing>());
+        ring = r.rings.back().get();
+        ring->tid = std::uint32_t(r.rings.size());
+    } else {
+        t_ringless = true;
+        return nullptr;
+    }
+    // Pooled QtConcurrent workers carry a thread object name; fall back to
+    // a numbered label for unnamed threads.
+    const QString objectName = QThread::currentThread()->objectName();
+    ring->name = objectName.isEmpty()
+        ? QByteArray("thread ") + QByteArray::number(ring->tid)
+        : objectName.toUtf8();
+    t_ring = ring;
+    t_lease.ring = ring;
+    return ring;
+}
+
+// Moves everything recorded in ring into out. Caller holds Registry::mutex.
+void drain(ThreadRing &ring, std::vector<Event> &out)
+{
+    const std::uint64_t head = ring.head.load(std::memory_order_acquire);
+    std::uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+    for (; tail < head; ++tail)
+        out.push_back(ring.events[tail & (kRingCapacity - 1)]);
+    ring.tail.store(tail, std::memory_order_release);
+}
+
+void appendJsonString(QByteArray &out, const QByteArray &s)
+{
+    out += '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        if (uchar(c) >= 0x20)
+            out += c;
+    }
+    out += '"';
+}
+
+} // namespace
+
+void detail::record(EventKind kind, std::uint32_t id, double value)
+{
+    ThreadRing *ring = threadRing();
+    if (!ring) {
+        registry().ringless.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    const std::uint64_t head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= kRingCapacity) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Event &e = ring->events[head & (kRingCapacity - 1)];
+    e.tsNs = nowNs();
+    e.value = value;
+    e.id = id;
+    e.kind = kind;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void setEnabled(bool enabled)
+{
+    detail::g_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+std::uint32_t intern(const char *name)
+{
+    return intern(QString::fromUtf8(name));
+}
+
+std::uint32_t intern(const QString &name)
+{
+    const QByteArray key = name.toUtf8();
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    auto it = r.ids.constFind(key);
+    if (it != r.ids.constEnd())
+        return *it;
+    const auto id = std::uint32_t(r.names.size());
+    r.names.push_back(key);
+    r.ids.insert(key, id);
+    return id;
+}
+
+void setThreadName(const QString &name)
+{
+    ThreadRing *ring = threadRing();
+    if (!ring)
+        return;
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    ring->name = name.toUtf8();
+}
+
+std::uint64_t droppedEvents()
+{
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::uint64_t total = r.ringless.load(std::memory_order_relaxed);
+    for (const auto &ring : r.rings)
+        total += ring->dropped.load(std::memory_order_relaxed);
+    return total;
+}
+
+bool exportChromeTrace(const QString &path)
+{
+    Registry &r = registry();
+    const QByteArray pid = QByteArray::number(QCoreApplication::applicationPid());
+
+    QByteArray json;
+    json += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&]() {
+        if (!first)
+            json += ",\n";
+        first = false;
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(r.mutex);
+        std::vector<Event> events;
+        for (const auto &ring : r.rings) {
+            const QByteArray tid = QByteArray::number(ring->tid);
+            separator();
+            json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid +
+                    ",\"tid\":" + tid + ",\"args\":{\"name\":";
+            appendJsonString(json, ring->name);
+            json += "}}";
+
+            events.clear();
+            drain(*ring, events);
+            json.reserve(json.size() + qsizetype(events.size()) * 80);
+            for (const Event &e : events) {
+                separator();
+                json += "{\"name\":";
+                appendJsonString(json, e.id < r.names.size() ? r.names[e.id] : QByteArray("?"));
+                json += ",\"ph\":\"";
+                json += e.kind == EventKind::Begin ? 'B' : e.kind == EventKind::End ? 'E' : 'C';
+                json += "\",\"ts\":";
+                json += QByteArray::number((e.tsNs - r.originNs) / 1000.0, 'f', 3);
+                json += ",\"pid\":" + pid + ",\"tid\":" + tid;
+                if (e.kind == EventKind::Counter)
+                    json += ",\"args\":{\"value\":" + QByteArray::number(e.value, 'g', 9) + "}";
+                json += '}';
+            }
+        }
+    }
+    json += "]}\n";
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+    file.write(json);
+    return file.commit();
+}
+
+void clear()
+{
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    std::vector<Event> discard;
+    for (const auto &ring : r.rings) {
+        discard.clear();
+        drain(*ring, discard);
+    }
+}
+
+}
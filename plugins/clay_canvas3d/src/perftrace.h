@@ -0,0 +1,136 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+#pragma once
+
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Low-overhead frame-time tracing, the C++ backend behind PerfRegistry's
+// tracing mode. Zones and counters are recorded as fixed-size events into a
+// per-thread single-producer ring (the owning thread writes, the exporter
+// drains), so recording never takes a lock and works the same on the GUI
+// thread, the render thread and QtConcurrent workers. Names are interned once
+// per call site into small integer ids; nothing is formatted until export.
+//
+//     void VoxelChunk::buildMesh(...)
+//     {
+//         CLAY_PERF_ZONE("voxel.buildMesh");
+//         ...
+//     }
+//
+// When tracing is disabled a zone costs one relaxed atomic load. Traces are
+// written in the Chrome trace-event JSON format, which Perfetto
+// (ui.perfetto.dev) and chrome://tracing load directly.
+namespace PerfTrace {
+
+enum class EventKind : std::uint8_t { Begin, End, Counter };
+
+// One recorded event (24 bytes).
+struct Event {
+    std::int64_t tsNs = 0;
+    double value = 0.0;     // counter value (unused for zones)
+    std::uint32_t id = 0;   // interned name
+    EventKind kind = EventKind::Begin;
+};
+
+// Per-thread ring capacity in events (power of two). Events that arrive while
+// a ring is full are dropped and counted, never blocking the producer.
+constexpr std::uint32_t kRingCapacity = 1u << 16;
+
+// Upper bound on rings (about 1.5 MB each). A thread's ring is reused by
+// later threads once it exits; events from threads beyond this many live
+// ones are dropped and counted.
+constexpr std::size_t kMaxThreadRings = 64;
+
+namespace detail {
+extern std::atomic<bool> g_enabled;
+void record(EventKind kind, std::uint32_t id, double value);
+inline std::int64_t nowNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+}
+
+// True while events are being recorded.
+inline bool isEnabled() { return detail::g_enabled.load(std::memory_order_relaxed); }
+
+// Start/stop recording. Enabling does not clear previously recorded events.
+void setEnabled(bool enabled);
+
+// Returns a stable id for name; the same string always yields the same id.
+// Takes a lock, so call sites cache the result (CLAY_PERF_ZONE does).
+std::uint32_t intern(const char *name);
+std::uint32_t intern(const QString &name);
+
+// Labels the calling thread in exported traces (e.g. "voxel-mesh").
+void setThreadName(const QString &name);
+
+// Returns whether a begin event was recorded; pass that on to endZone so
+// toggling tracing in between never produces an unmatched end event.
+inline bool beginZone(std::uint32_t id)
+{
+    if (!isEnabled())
+        return false;
+    detail::record(EventKind::Begin, id, 0.0);
+    return true;
+}
+inline void endZone(std::uint32_t id, bool begun)
+{
+    if (begun) detail::record(EventKind::End, id, 0.0);
+}
+inline void counter(std::uint32_t id, double value)
+{
+    if (isEnabled()) detail::record(EventKind::Counter, id, value);
+}
+
+// RAII zone. The begin state is latched so toggling tracing mid-zone never
+// produces an unmatched end event.
+class Zone
+{
+public:
+    explicit Zone(std::uint32_t id) : m_id(id), m_active(isEnabled())
+    {
+        if (m_active) detail::record(EventKind::Begin, m_id, 0.0);
+    }
+    ~Zone()
+    {
+        if (m_active) detail::record(EventKind::End, m_id, 0.0);
+    }
+    Zone(const Zone &) = delete;
+    Zone &operator=(const Zone &) = delete;
+
+private:
+    std::uint32_t m_id;
+    bool m_active;
+};
+
+// Number of events dropped because a thread's ring was full (or it had none).
+std::uint64_t droppedEvents();
+
+// Drains every thread's ring and writes all events recorded so far as a
+// Chrome trace-event JSON file. Returns false if the file cannot be written.
+// Events are consumed; a second call only writes what was recorded since.
+bool exportChromeTrace(const QString &path);
+
+// Discards all recorded events (names and thread labels are kept).
+void clear();
+
+}
+
+#define CLAY_PERF_CONCAT_INNER(a, b) a##b
+#define CLAY_PERF_CONCAT(a, b) CLAY_PERF_CONCAT_INNER(a, b)
+
+// Times the enclosing scope as a zone named by the string literal NAME.
+#define CLAY_PERF_ZONE(NAME) \
+    static const std::uint32_t CLAY_PERF_CONCAT(clayPerfId_, __LINE__) = PerfTrace::intern(NAME); \
+    PerfTrace::Zone CLAY_PERF_CONCAT(clayPerfZone_, __LINE__)(CLAY_PERF_CONCAT(clayPerfId_, __LINE__))
+
+// Records VALUE for the counter named by the string literal NAME.
+#define CLAY_PERF_COUNTER(NAME, VALUE) \
+    do { \
+        static const std::uint32_t clayPerfCounterId = PerfTrace::intern(NAME); \
+        PerfTrace::counter(clayPerfCounterId, double(VALUE)); \
+    } while (0)
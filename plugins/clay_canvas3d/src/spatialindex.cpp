@@ -0,0 +1,257 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+#include "spatialindex.h"
+#include "perftrace.h"
+#include <cmath>
+
+namespace {
+
+constexpr int kLeafSize = 4;
+// Rebuild once refitting has grown the summed node area by this factor.
+constexpr float kRefitSlack = 1.5f;
+
+float axisOf(const QVector3D &v, int axis)
+{
+    return axis == 0 ? v.x() : axis == 1 ? v.y() : v.z();
+}
+
+} // namespace
+
+float SpatialIndex::Box::area() const
+{
+    if (!isValid())
+        return 0.0f;
+    const QVector3D e = max - min;
+    return 2.0f * (e.x() * e.y() + e.y() * e.z() + e.z() * e.x());
+}
+
+bool SpatialIndex::Box::overlaps(const Box &b) const
+{
+    return min.x() <= b.max.x() && max.x() >= b.min.x()
+        && min.y() <= b.max.y() && max.y() >= b.min.y()
+        && min.z() <= b.max.z() && max.z() >= b.min.z();
+}
+
+float SpatialIndex::Box::distanceTo(const QVector3D &p) const
+{
+    const float dx = std::max({min.x() - p.x(), 0.0f, p.x() - max.x()});
+    const float dy = std::max({min.y() - p.y(), 0.0f, p.y() - max.y()});
+    const float dz = std::max({min.z() - p.z(), 0.0f, p.z() - max.z()});
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+bool SpatialIndex::Box::intersectsRay(const QVector3D &origin, const QVector3D &invDir,
+                                      float *tEnter) const
+{
+    float t0 = 0.0f;
+    float t1 = std::numeric_limits<float>::max();
+    for (int a = 0; a < 3; ++a) {
+        const float o = axisOf(origin, a);
+        const float inv = axisOf(invDir, a);
+        float tn = (axisOf(min, a) - o) * inv;
+        float tf = (axisOf(max, a) - o) * inv;
+        // 0 * inf for a ray lying in a slab plane: treat as inside.
+        if (std::isnan(tn) || std::isnan(tf)) {
+            if (o < axisOf(min, a) || o > axisOf(max, a))
+                return false;
+            continue;
+        }
+        if (tn > tf)
+            std::swap(tn, tf);
+        t0 = std::max(t0, tn);
+        t1 = std::min(t1, tf);
+        if (t0 > t1)
+            return false;
+    }
+    if (tEnter)
+        *tEnter = t0;
+    return true;
+}
+
+SpatialIndex::Ray::Ray(const QVector3D &o, const QVector3D &direction, const QVector2D &scale)
+    : origin(o), pixelScale(scale)
+{
+    const float len = direction.length();
+    valid = len > 0.0f && std::isfinite(len);
+    dir = valid ? direction / len : QVector3D(0.0f, 0.0f, -1.0f);
+    invDir = QVector3D(1.0f / dir.x(), 1.0f / dir.y(), 1.0f / dir.z());
+}
+
+float SpatialIndex::Ray::farT(const Box &b) const
+{
+    const QVector3D half = 0.5f * (b.max - b.min);
+    const float t = QVector3D::dotProduct(b.center() - origin, dir)
+                  + half.x() * std::abs(dir.x()) + half.y() * std::abs(dir.y())
+                  + half.z() * std::abs(dir.z());
+    return std::max(t, 0.0f);
+}
+
+bool SpatialIndex::Ray::reaches(const Box &b, float radius, float maxT) const
+{
+    float tEnter = 0.0f;
+    return b.inflated(radius).intersectsRay(origin, invDir, &tEnter) && tEnter <= maxT;
+}
+
+float SpatialIndex::raySegmentDistance(const Ray &ray, const QVector3D &a, const QVector3D &b,
+                                       float *tOut, float *uOut)
+{
+    // Minimize |o + t d - (a + u e)| with |d| = 1, clamping u then t.
+    const QVector3D e = b - a;
+    const QVector3D w = ray.origin - a;
+    const float ee = QVector3D::dotProduct(e, e);
+    const float de = QVector3D::dotProduct(ray.dir, e);
+    const float dw = QVector3D::dotProduct(ray.dir, w);
+    const float ew = QVector3D::dotProduct(e, w);
+    const float denom = ee - de * de;
+
+    float u = 0.0f;
+    if (ee > 0.0f && denom > 1e-6f * ee)
+        u = std::clamp((ew - dw * de) / denom, 0.0f, 1.0f);
+    float t = u * de - dw;
+    if (t < 0.0f) {
+        t = 0.0f;
+        u = ee > 0.0f ? std::clamp(ew / ee, 0.0f, 1.0f) : 0.0f;
+    }
+    if (tOut)
+        *tOut = t;
+    if (uOut)
+        *uOut = u;
+    return (ray.at(t) - (a + e * u)).length();
+}
+
+float SpatialIndex::pointSegmentDistance(const QVector3D &p, const QVector3D &a,
+                                         const QVector3D &b, float *uOut)
+{
+    const QVector3D e = b - a;
+    const float ee = QVector3D::dotProduct(e, e);
+    const float u = ee > 0.0f ? std::clamp(QVector3D::dotProduct(p - a, e) / ee, 0.0f, 1.0f) : 0.0f;
+    if (uOut)
+        *uOut = u;
+    return (p - (a + e * u)).length();
+}
+
+bool SpatialIndex::segmentIntersectsBox(const QVector3D &a, const QVector3D &b, const Box &box)
+{
+    // Slab clip of the segment's parameter range [0, 1].
+    float t0 = 0.0f;
+    float t1 = 1.0f;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float o = axisOf(a, axis);
+        const float d = axisOf(b, axis) - o;
+        const float lo = axisOf(box.min, axis);
+        const float hi = axisOf(box.max, axis);
+        if (d == 0.0f) {
+            if (o < lo || o > hi)
+                return false;
+            continue;
+        }
+        float tn = (lo - o) / d;
+        float tf = (hi - o) / d;
+        if (tn > tf)
+            std::swap(tn, tf);
+        t0 = std::max(t0, tn);
+        t1 = std::min(t1, tf);
+        if (t0 > t1)
+            return false;
+    }
+    return true;
+}
+
+void SpatialIndex::build(const QList<Box> &items)
+{
+    CLAY_PERF_ZONE("spatial.build");
+    clear();
+    if (items.isEmpty())
+        return;
+
+    const int n = static_cast<int>(items.size());
+    std::vector<QVector3D> centers(n);
+    m_order.resize(n);
+    for (int i = 0; i < n; ++i) {
+        centers[i] = items[i].center();
+        m_order[i] = i;
+    }
+
+    m_nodes.reserve(2 * (n / kLeafSize + 1));
+    m_nodes.emplace_back();
+    buildRange(0, 0, n, centers);
+    // Boxes come from the items, not the centers.
+    update(items);
+    m_buildCost = cost();
+}
+
+void SpatialIndex::buildRange(int node, int begin, int end, const std::vector<QVector3D> &centers)
+{
+    if (end - begin <= kLeafSize) {
+        m_nodes[node].first = begin;
+        m_nodes[node].count = end - begin;
+        return;
+    }
+
+    // Median split along the widest axis of the item centers.
+    Box centerBox;
+    for (int i = begin; i < end; ++i)
+        centerBox.expand(centers[m_order[i]]);
+    const QVector3D ext = centerBox.max - centerBox.min;
+    const int axis = (ext.x() >= ext.y() && ext.x() >= ext.z()) ? 0 : (ext.y() >= ext.z() ? 1 : 2);
+    const int mid = begin + (end - begin) / 2;
+    std::nth_element(m_order.begin() + begin, m_order.begin() + mid, m_order.begin() + end,
+                     [&centers, axis](int a, int b) {
+                         return axisOf(centers[a], axis) < axisOf(centers[b], axis);
+                     });
+
+    const int left = static_cast<int>(m_nodes.size());
+    m_nodes.emplace_back();
+    m_nodes.emplace_back();
+    m_nodes[node].first = left;
+    m_nodes[node].count = 0;
+    buildRange(left, begin, mid, centers);
+    buildRange(left + 1, mid, end, centers);
+}
+
+void SpatialIndex::update(const QList<Box> &items)
+{
+    if (items.size() != static_cast<qsizetype>(m_order.size()) || m_nodes.empty()) {
+        if (!items.isEmpty() || !m_nodes.empty())
+            build(items);
+        return;
+    }
+
+    CLAY_PERF_ZONE("spatial.refit");
+    // Children always follow their parent, so a reverse sweep is bottom-up.
+    for (int i = static_cast<int>(m_nodes.size()) - 1; i >= 0; --i) {
+        Node &node = m_nodes[i];
+        Box box;
+        if (node.count > 0) {
+            for (int k = node.first; k < node.first + node.count; ++k)
+                box.expand(items[m_order[k]]);
+        } else {
+            box = m_nodes[node.first].box;
+            box.expand(m_nodes[node.first + 1].box);
+        }
+        node.box = box;
+    }
+
+    if (m_buildCost > 0.0f && cost() > kRefitSlack * m_buildCost)
+        build(items);
+}
+
+void SpatialIndex::clear()
+{
+    m_nodes.clear();
+    m_order.clear();
+    m_buildCost = 0.0f;
+}
+
+// Summed internal-node area relative to the root: the SAH-style traversal cost.
+float SpatialIndex::cost() const
+{
+    if (m_nodes.empty())
+        return 0.0f;
+    double sum = 0.0;
+    for (const Node &node : m_nodes) {
+        if (node.count == 0)
+            sum += node.box.area();
+    }
+    const float root = m_nodes.front().box.area();
+    return root > 0.0f ? static_cast<float>(sum / root) : 0.0f;
+}
@@ -0,0 +1,179 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+#pragma once
+
+#include <QList>
+#include <QVarLengthArray>
+#include <QVector2D>
+#include <QVector3D>
+#include <algorithm>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// Bounding volume hierarchy over item AABBs, shared by the picking queries of
+// LineBatchInstancing (one item per segment) and LabelBatchInstancing (one
+// item per label). Items are identified by their index in the list passed to
+// build(); the tree only stores boxes, so callers do their exact per-item
+// tests in the traversal callbacks.
+//
+// Maintenance is cheap for the common edit patterns: build() is a median
+// split (O(n log n), ~50 ms for 100k items); update() refits the existing
+// topology to moved items in O(n) and only rebuilds once refitting has
+// inflated the tree noticeably (points that moved far apart).
+class SpatialIndex
+{
+public:
+    struct Box {
+        QVector3D min{std::numeric_limits<float>::max(), std::numeric_limits<float>::max(),
+                      std::numeric_limits<float>::max()};
+        QVector3D max{-std::numeric_limits<float>::max(), -std::numeric_limits<float>::max(),
+                      -std::numeric_limits<float>::max()};
+
+        void expand(const QVector3D &p)
+        {
+            min = QVector3D(std::min(min.x(), p.x()), std::min(min.y(), p.y()), std::min(min.z(), p.z()));
+            max = QVector3D(std::max(max.x(), p.x()), std::max(max.y(), p.y()), std::max(max.z(), p.z()));
+        }
+        void expand(const Box &b)
+        {
+            expand(b.min);
+            expand(b.max);
+        }
+        Box inflated(float r) const { return {min - QVector3D(r, r, r), max + QVector3D(r, r, r)}; }
+        QVector3D center() const { return 0.5f * (min + max); }
+        bool isValid() const { return min.x() <= max.x(); }
+        float area() const;
+        bool overlaps(const Box &b) const;
+        float distanceTo(const QVector3D &p) const;
+        // Ray slab test; on a hit tEnter is the entry distance (>= 0).
+        bool intersectsRay(const QVector3D &origin, const QVector3D &invDir, float *tEnter) const;
+    };
+
+    // A pick ray plus the world size of one pixel along it: pixelScale.x at
+    // the origin, growing by pixelScale.y per unit distance (0 for an
+    // orthographic camera). A zero pixelScale means world units throughout.
+    struct Ray {
+        Ray(const QVector3D &origin, const QVector3D &direction,
+            const QVector2D &pixelScale = QVector2D());
+
+        bool isValid() const { return valid; }
+        QVector3D at(float t) const { return origin + dir * t; }
+        float pixelSize(float t) const { return pixelScale.x() + pixelScale.y() * t; }
+        // Largest ray distance at which any point of b projects onto the ray.
+        float farT(const Box &b) const;
+        // Whether the ray passes within radius of b, entering before maxT.
+        bool reaches(const Box &b, float radius, float maxT) const;
+
+        QVector3D origin;
+        QVector3D dir;    // normalized
+        QVector3D invDir;
+        QVector2D pixelScale;
+        bool valid = false;
+    };
+
+    // Closest approach of ray and segment [a, b]: returns the distance and the
+    // ray / segment parameters (t >= 0, u in [0, 1]).
+    static float raySegmentDistance(const Ray &ray, const QVector3D &a, const QVector3D &b,
+                                    float *t, float *u);
+    static float pointSegmentDistance(const QVector3D &p, const QVector3D &a, const QVector3D &b,
+                                      float *u);
+    static bool segmentIntersectsBox(const QVector3D &a, const QVector3D &b, const Box &box);
+
+    void build(const QList<Box> &items);
+    // Refits to moved items (same count as the last build); rebuilds when the
+    // refitted tree has grown too loose or the count changed.
+    void update(const QList<Box> &items);
+    void clear();
+
+    bool isEmpty() const { return m_nodes.empty(); }
+    int itemCount() const { return static_cast<int>(m_order.size()); }
+    Box bounds() const { return m_nodes.empty() ? Box() : m_nodes.front().box; }
+
+    // Depth-first traversal: descends into nodes whose box passes
+    // nodeTest(const Box &) and calls visit(int item) for every item in an
+    // accepted leaf. nodeTest may depend on state visit() updates (e.g. the
+    // best hit so far), which prunes the rest of the walk.
+    template <typename NodeTest, typename Visit>
+    void traverse(NodeTest nodeTest, Visit visit) const;
+
+    // Best-first nearest search. nodeDist(const Box &) must be a lower bound
+    // of itemDist(int item) for every item below that node. Returns the best
+    // item within maxDist (or -1) and stores its distance in *outDist.
+    template <typename NodeDist, typename ItemDist>
+    int nearest(NodeDist nodeDist, ItemDist itemDist, float maxDist, float *outDist) const;
+
+private:
+    // Internal nodes have count == 0 and children at first, first + 1;
+    // leaves reference m_order[first, first + count).
+    struct Node {
+        Box box;
+        int first = 0;
+        int count = 0;
+    };
+
+    void buildRange(int node, int begin, int end, const std::vector<QVector3D> &centers);
+    float cost() const;
+
+    std::vector<Node> m_nodes;
+    std::vector<int> m_order;
+    float m_buildCost = 0.0f;
+};
+
+template <typename NodeTest, typename Visit>
+void SpatialIndex::traverse(NodeTest nodeTest, Visit visit) const
+{
+    if (m_nodes.empty())
+        return;
+    QVarLengthArray<int, 64> stack;
+    stack.append(0);
+    while (!stack.isEmpty()) {
+        const Node &node = m_nodes[stack.takeLast()];
+        if (!nodeTest(node.box))
+            continue;
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; ++i)
+                visit(m_order[i]);
+        } else {
+            stack.append(node.first + 1);
+            stack.append(node.first);
+        }
+    }
+}
+
+template <typename NodeDist, typename ItemDist>
+int SpatialIndex::nearest(NodeDist nodeDist, ItemDist itemDist, float maxDist, float *outDist) const
+{
+    int best = -1;
+    float bestDist = maxDist;
+    if (!m_nodes.empty()) {
+        using Entry = std::pair<float, int>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+        open.push({nodeDist(m_nodes.front().box), 0});
+        while (!open.empty()) {
+            const Entry top = open.top();
+            open.pop();
+            if (top.first > bestDist)
+                break;
+            const Node &node = m_nodes[top.second];
+            if (node.count > 0) {
+                for (int i = node.first; i < node.first + node.count; ++i) {
+                    const float d = itemDist(m_order[i]);
+                    if (d <= bestDist) {
+                        bestDist = d;
+                        best = m_order[i];
+                    }
+                }
+            } else {
+                for (int c = node.first; c < node.first + 2; ++c) {
+                    const float d = nodeDist(m_nodes[c].box);
+                    if (d <= bestDist)
+                        open.push({d, c});
+                }
+            }
+        }
+    }
+    if (outDist)
+        *outDist = bestDist;
+    return best;
+}
@@ -1,4 +1,5 @@
 #include "voxelchunk.h"
+#include "perftrace.h"
 #include <QVector3D>
 
 namespace VoxelChunk {
@@ -134,6 +135,7 @@ QVector<GreedyQuad> generateGreedyQuads(const MeshInput &in)
 
 MeshResult buildMesh(const MeshInput &in)
 {
+    CLAY_PERF_ZONE("voxel.buildMesh");
     MeshResult result;
     result.chunkId = in.chunkId;
 
@@ -2,6 +2,7 @@
 #include <QVector3D>
 #include <QLoggingCategory>
 #include <QtConcurrent>
+#include "perftrace.h"
 
 // Temporary performance instrumentation. Silent by default; enable with
 //   QT_LOGGING_RULES="clay.voxel.perf=true"
@@ -386,6 +387,7 @@ void VoxelMapGeometry::onMeshBatchFinished()
 
 void VoxelMapGeometry::concatenateAndUpload()
 {
+    CLAY_PERF_ZONE("voxel.concatUpload");
     clear();
 
     const float voxelStep = m_data.voxelSize() + m_data.spacing();
@@ -0,0 +1,719 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// CPU-only micro-benchmarks for Canvas3D data paths (QBENCHMARK).
+// Covers, each at several sizes:
+//   * VoxelChunk::buildMesh on terrain-like and noisy chunks
+//   * VoxelMapData fills and save/load
+//   * LineBatchInstancing::setBulk (incl. table rebuild) and updatePolylinesBulk
+//   * LineBatchInstancing spatial queries (index build, pick, nearest, queryBox)
+//   * DynamicInstancing::updatePoses
+//   * Box3DGeometry creation (shared shape cache) and Box3DBatchInstancing::setBulk
+//   * BoxLineBatchInstancing per-line point updates (LineLayer3D box lines)
+//   * LineStyleTextureData full rebuild vs. single-style patch
+//   * LabelGlyphAtlas glyph baking (via ensureString on a fresh atlas)
+//   * LabelBatchInstancing reshape (setLabels on a pre-baked atlas)
+//
+// All inputs come from the same LCG and seed (1337) as the QML benchmark
+// pages, so numbers are comparable across runs and independent of GPU and
+// vsync. Run with e.g. -tickcounter or -csv for machine-readable output.
+
+#include "box3dbatchinstancing.h"
+#include "box3dgeometry.h"
+#include "boxlinebatchinstancing.h"
+#include "dynamicinstancing.h"
+#include "labelbatchinstancing.h"
+#include "labelglyphatlas.h"
+#include "linebatchinstancing.h"
+#include "linestyletexturedata.h"
+#include "voxelchunk.h"
+#include "voxelmapdata.h"
+
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include <QVector2D>
+#include <QVector3D>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+constexpr std::uint32_t kSeed = 1337;
+
+// Same generator as makeRng() in benchmarks/Bench*.qml.
+class Lcg
+{
+public:
+    explicit Lcg(std::uint32_t seed) : state_(seed) {}
+    float next()
+    {
+        state_ = state_ * 1664525u + 1013904223u;
+        return float(state_ / 4294967296.0);
+    }
+    float range(float lo, float hi) { return lo + (hi - lo) * next(); }
+
+private:
+    std::uint32_t state_;
+};
+
+const QRgb kPalette[] = { 0xff3a7d44, 0xff6b4f2a, 0xff8d8d8d, 0xffe0e0e0 };
+
+// A chunk of rolling terrain (height field plus strata colours): the common
+// case where greedy merging pays off.
+VoxelChunk::MeshInput terrainChunk(int size)
+{
+    VoxelChunk::MeshInput in;
+    in.chunkId = 0;
+    in.sizeX = in.sizeY = in.sizeZ = size;
+    const int s = size + 2;
+    in.colors.resize(s * s * s);
+    Lcg rng(kSeed);
+    const float phase = rng.range(0.0f, 6.28f);
+    for (int z = 0; z < s; ++z) {
+        for (int x = 0; x < s; ++x) {
+            const float h = size * (0.5f + 0.25f * std::sin(x * 0.21f + phase)
+                                         * std::cos(z * 0.17f));
+            for (int y = 0; y < s; ++y) {
+                QRgb c = 0;
+                if (y < h)
+                    c = kPalette[y + 2 >= h ? 0 : y + 6 >= h ? 1 : 2];
+                in.colors[x + y * s + z * s * s] = c;
+            }
+        }
+    }
+    return in;
+}
+
+// Half-filled random chunk: the worst case for greedy meshing.
+VoxelChunk::MeshInput noiseChunk(int size)
+{
+    VoxelChunk::MeshInput in;
+    in.chunkId = 0;
+    in.sizeX = in.sizeY = in.sizeZ = size;
+    const int s = size + 2;
+    in.colors.resize(s * s * s);
+    Lcg rng(kSeed);
+    for (QRgb &c : in.colors)
+        c = rng.next() < 0.5f ? kPalette[int(rng.next() * 4) & 3] : 0;
+    return in;
+}
+
+QVariantList singleColor()
+{
+    QVariantMap entry;
+    entry.insert(QStringLiteral("color"), QStringLiteral("#3a7d44"));
+    entry.insert(QStringLiteral("weight"), 1.0);
+    return { entry };
+}
+
+// N polylines of 3-6 segments, laid out like BenchLinesStatic.qml.
+struct LineBulk {
+    QByteArray positions, starts, colors, widths;
+};
+
+LineBulk randomLines(int n)
+{
+    LineBulk b;
+    Lcg rng(kSeed);
+    QList<float> pos;
+    QList<quint32> starts;
+    starts.append(0);
+    for (int i = 0; i < n; ++i) {
+        const int segs = 3 + int(rng.next() * 4);
+        float x = rng.range(-500, 500), y = rng.range(0, 300), z = rng.range(-500, 500);
+        pos << x << y << z;
+        for (int s = 0; s < segs; ++s) {
+            x += rng.range(-40, 40);
+            y += rng.range(-30, 30);
+            z += rng.range(-40, 40);
+            pos << x << y << z;
+        }
+        starts.append(quint32(pos.size() / 3));
+    }
+    b.positions = QByteArray(reinterpret_cast<const char *>(pos.constData()), pos.size() * sizeof(float));
+    b.starts = QByteArray(reinterpret_cast<const char *>(starts.constData()), starts.size() * sizeof(quint32));
+    b.colors = QByteArray(n * 4, char(0xff));
+    const QList<float> widths(n, 2.0f);
+    b.widths = QByteArray(reinterpret_cast<const char *>(widths.constData()), n * sizeof(float));
+    return b;
+}
+
+// Uniform-topology polylines for the per-frame updatePolylinesBulk path.
+LineBulk uniformLines(int n, int pointsPerLine)
+{
+    LineBulk b;
+    Lcg rng(kSeed);
+    QList<float> pos;
+    QList<quint32> starts;
+    for (int i = 0; i <= n; ++i)
+        starts.append(quint32(i * pointsPerLine));
+    for (int i = 0; i < n * pointsPerLine * 3; ++i)
+        pos << rng.range(-500, 500);
+    b.positions = QByteArray(reinterpret_cast<const char *>(pos.constData()), pos.size() * sizeof(float));
+    b.starts = QByteArray(reinterpret_cast<const char *>(starts.constData()), starts.size() * sizeof(quint32));
+    b.colors = QByteArray(n * 4, char(0xff));
+    const QList<float> widths(n, 2.0f);
+    b.widths = QByteArray(reinterpret_cast<const char *>(widths.constData()), n * sizeof(float));
+    return b;
+}
+
+QString randomWord(Lcg &rng)
+{
+    static const QString alphabet = QStringLiteral("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 -");
+    const int len = 4 + int(rng.next() * 12);
+    QString s;
+    s.reserve(len);
+    for (int i = 0; i < len; ++i)
+        s.append(alphabet.at(int(rng.next() * alphabet.size()) % alphabet.size()));
+    return s;
+}
+
+} // namespace
+
+class TestCanvas3DCpuBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void voxelBuildMesh_data();
+    void voxelBuildMesh();
+    void voxelFillSphere_data();
+    void voxelFillSphere();
+    void voxelFillBox_data();
+    void voxelFillBox();
+    void voxelSave_data();
+    void voxelSave();
+    void voxelLoad_data();
+    void voxelLoad();
+    void lineSetBulk_data();
+    void lineSetBulk();
+    void lineUpdatePolylinesBulk_data();
+    void lineUpdatePolylinesBulk();
+    void lineIndexBuild_data();
+    void lineIndexBuild();
+    void linePick_data();
+    void linePick();
+    void lineNearest_data();
+    void lineNearest();
+    void lineQueryBox_data();
+    void lineQueryBox();
+    void dynamicUpdatePoses_data();
+    void dynamicUpdatePoses();
+    void box3dGeometryCreate_data();
+    void box3dGeometryCreate();
+    void box3dBatchSetBulk_data();
+    void box3dBatchSetBulk();
+    void boxLineSetPoints_data();
+    void boxLineSetPoints();
+    void styleTableUpdate_data();
+    void styleTableUpdate();
+    void glyphAtlasBake_data();
+    void glyphAtlasBake();
+    void labelReshape_data();
+    void labelReshape();
+
+private:
+    QTemporaryDir tmp_;
+};
+
+// --- voxels -----------------------------------------------------------
+
+void TestCanvas3DCpuBench::voxelBuildMesh_data()
+{
+    QTest::addColumn<int>("size");
+    QTest::addColumn<bool>("noise");
+    QTest::newRow("terrain-16") << 16 << false;
+    QTest::newRow("terrain-32") << 32 << false;
+    QTest::newRow("terrain-64") << 64 << false;
+    QTest::newRow("noise-16") << 16 << true;
+    QTest::newRow("noise-32") << 32 << true;
+}
+
+void TestCanvas3DCpuBench::voxelBuildMesh()
+{
+    QFETCH(int, size);
+    QFETCH(bool, noise);
+    const VoxelChunk::MeshInput in = noise ? noiseChunk(size) : terrainChunk(size);
+    VoxelChunk::MeshResult result;
+    QBENCHMARK {
+        result = VoxelChunk::buildMesh(in);
+    }
+    QVERIFY(result.vertexCount > 0);
+}
+
+static void addVolumeRows()
+{
+    QTest::addColumn<int>("size");
+    QTest::newRow("64") << 64;
+    QTest::newRow("128") << 128;
+    QTest::newRow("256") << 256;
+}
+
+void TestCanvas3DCpuBench::voxelFillSphere_data() { addVolumeRows(); }
+
+void TestCanvas3DCpuBench::voxelFillSphere()
+{
+    QFETCH(int, size);
+    VoxelMapData data;
+    data.setVoxelCountX(size);
+    data.setVoxelCountY(size);
+    data.setVoxelCountZ(size);
+    const QVariantList colors = singleColor();
+    const int c = size / 2;
+    QBENCHMARK {
+        data.fillSphere(c, c, c, size / 3, colors);
+    }
+    QVERIFY(data.solidCount() > 0);
+}
+
+void TestCanvas3DCpuBench::voxelFillBox_data() { addVolumeRows(); }
+
+void TestCanvas3DCpuBench::voxelFillBox()
+{
+    QFETCH(int, size);
+    VoxelMapData data;
+    data.setVoxelCountX(size);
+    data.setVoxelCountY(size);
+    data.setVoxelCountZ(size);
+    const QVariantList colors = singleColor();
+    QBENCHMARK {
+        data.fillBox(0, 0, 0, size, size / 4, size, colors);
+    }
+    QCOMPARE(data.solidCount(), size * (size / 4) * size);
+}
+
+static void addIoRows()
+{
+    QTest::addColumn<int>("size");
+    QTest::newRow("32") << 32;
+    QTest::newRow("64") << 64;
+    QTest::newRow("128") << 128;
+}
+
+void TestCanvas3DCpuBench::voxelSave_data() { addIoRows(); }
+
+void TestCanvas3DCpuBench::voxelSave()
+{
+    QFETCH(int, size);
+    VoxelMapData data;
+    data.setVoxelCountX(size);
+    data.setVoxelCountY(size / 2);
+    data.setVoxelCountZ(size);
+    data.fillBox(0, 0, 0, size, size / 4, size, singleColor());
+    const QString path = tmp_.filePath(QStringLiteral("save-%1.txt").arg(size));
+    bool ok = false;
+    QBENCHMARK {
+        ok = data.saveToFile(path);
+    }
+    QVERIFY(ok);
+}
+
+void TestCanvas3DCpuBench::voxelLoad_data() { addIoRows(); }
+
+void TestCanvas3DCpuBench::voxelLoad()
+{
+    QFETCH(int, size);
+    const QString path = tmp_.filePath(QStringLiteral("load-%1.txt").arg(size));
+    {
+        VoxelMapData src;
+        src.setVoxelCountX(size);
+        src.setVoxelCountY(size / 2);
+        src.setVoxelCountZ(size);
+        src.fillBox(0, 0, 0, size, size / 4, size, singleColor());
+        QVERIFY(src.saveToFile(path));
+    }
+    VoxelMapData data;
+    bool ok = false;
+    QBENCHMARK {
+        ok = data.loadFromFile(path);
+    }
+    QVERIFY(ok);
+    QCOMPARE(data.solidCount(), size * (size / 4) * size);
+}
+
+// --- lines ------------------------------------------------------------
+
+void TestCanvas3DCpuBench::lineSetBulk_data()
+{
+    QTest::addColumn<int>("lines");
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+    QTest::newRow("100k") << 100000;
+}
+
+void TestCanvas3DCpuBench::lineSetBulk()
+{
+    QFETCH(int, lines);
+    const LineBulk b = randomLines(lines);
+    LineBatchInstancing batch;
+    QBENCHMARK {
+        batch.setBulk(b.positions, b.starts, b.colors, b.widths);
+    }
+    QCOMPARE(batch.count(), lines);
+}
+
+void TestCanvas3DCpuBench::lineUpdatePolylinesBulk_data()
+{
+    QTest::addColumn<int>("lines");
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+    QTest::newRow("50k") << 50000;
+}
+
+void TestCanvas3DCpuBench::lineUpdatePolylinesBulk()
+{
+    QFETCH(int, lines);
+    constexpr int kPoints = 8;
+    const LineBulk b = uniformLines(lines, kPoints);
+    LineBatchInstancing batch;
+    batch.setBulk(b.positions, b.starts, b.colors, b.widths);
+    QBENCHMARK {
+        batch.updatePolylinesBulk(b.positions, kPoints);
+    }
+    QCOMPARE(batch.count(), lines);
+}
+
+// randomLines() averages 4.5 segments per line: 25k lines ~ 112k segments.
+static void addQueryRows()
+{
+    QTest::addColumn<int>("lines");
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("25k") << 25000;
+}
+
+void TestCanvas3DCpuBench::lineIndexBuild_data() { addQueryRows(); }
+
+void TestCanvas3DCpuBench::lineIndexBuild()
+{
+    QFETCH(int, lines);
+    const LineBulk b = randomLines(lines);
+    LineBatchInstancing batch;
+    QBENCHMARK {
+        // setBulk marks the index stale; the first query builds it.
+        batch.setBulk(b.positions, b.starts, b.colors, b.widths);
+        batch.nearest(QVector3D(0, 150, 0));
+    }
+}
+
+void TestCanvas3DCpuBench::linePick_data() { addQueryRows(); }
+
+// 64 rays from a camera-like origin into the field, 4 px tolerance at a
+// perspective pixel footprint.
+void TestCanvas3DCpuBench::linePick()
+{
+    QFETCH(int, lines);
+    const LineBulk b = randomLines(lines);
+    LineBatchInstancing batch;
+    batch.setBulk(b.positions, b.starts, b.colors, b.widths);
+    batch.nearest(QVector3D());
+    Lcg rng(kSeed);
+    QList<QVector3D> targets;
+    for (int i = 0; i < 64; ++i)
+        targets << QVector3D(rng.range(-500, 500), rng.range(0, 300), rng.range(-500, 500));
+    const QVector3D eye(0, 600, 1200);
+    int hits = 0;
+    QBENCHMARK {
+        hits = 0;
+        for (const QVector3D &t : targets)
+            hits += batch.pick(eye, t - eye, 4.0, QVector2D(0.0015f, 0.0012f), true)
+                        .value(QStringLiteral("lineIndex")).toInt() >= 0;
+    }
+    QVERIFY(hits >= 0);
+}
+
+void TestCanvas3DCpuBench::lineNearest_data() { addQueryRows(); }
+
+void TestCanvas3DCpuBench::lineNearest()
+{
+    QFETCH(int, lines);
+    const LineBulk b = randomLines(lines);
+    LineBatchInstancing batch;
+    batch.setBulk(b.positions, b.starts, b.colors, b.widths);
+    Lcg rng(kSeed);
+    QList<QVector3D> points;
+    for (int i = 0; i < 64; ++i)
+        points << QVector3D(rng.range(-500, 500), rng.range(0, 300), rng.range(-500, 500));
+    batch.nearest(points.first());
+    QBENCHMARK {
+        for (const QVector3D &p : points)
+            batch.nearest(p);
+    }
+    QVERIFY(batch.nearest(points.first()).value(QStringLiteral("lineIndex")).toInt() >= 0);
+}
+
+void TestCanvas3DCpuBench::lineQueryBox_data() { addQueryRows(); }
+
+void TestCanvas3DCpuBench::lineQueryBox()
+{
+    QFETCH(int, lines);
+    const LineBulk b = randomLines(lines);
+    LineBatchInstancing batch;
+    batch.setBulk(b.positions, b.starts, b.colors, b.widths);
+    batch.nearest(QVector3D());
+    QVariantList found;
+    QBENCHMARK {
+        found = batch.queryBox(QVector3D(-50, 100, -50), QVector3D(50, 200, 50));
+    }
+    QVERIFY(found.size() <= lines);
+}
+
+// --- instances --------------------------------------------------------
+
+void TestCanvas3DCpuBench::dynamicUpdatePoses_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("5k") << 5000;
+    QTest::newRow("20k") << 20000;
+}
+
+void TestCanvas3DCpuBench::dynamicUpdatePoses()
+{
+    QFETCH(int, count);
+    DynamicInstancing inst;
+    QVariantList scales, colors;
+    for (int i = 0; i < count; ++i) {
+        scales.append(QVariant::fromValue(QVector3D(1, 1, 2)));
+        colors.append(QColor(Qt::cyan));
+    }
+    inst.setBulk(scales, colors);
+
+    Lcg rng(kSeed);
+    QList<float> poses;
+    for (int i = 0; i < count; ++i)
+        poses << rng.range(-400, 400) << 0.0f << rng.range(-400, 400) << rng.range(0, 6.28f);
+    const QByteArray packed(reinterpret_cast<const char *>(poses.constData()), poses.size() * sizeof(float));
+
+    QBENCHMARK {
+        inst.updatePoses(0, packed);
+    }
+    QCOMPARE(inst.count(), count);
+}
+
+// One Box3DGeometry per building, as a scene of individual Box3D items
+// creates them; the sizes repeat, so all but the first few hit the cache.
+void TestCanvas3DCpuBench::box3dGeometryCreate_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+}
+
+void TestCanvas3DCpuBench::box3dGeometryCreate()
+{
+    QFETCH(int, count);
+    Lcg rng(kSeed);
+    QList<QVector3D> sizes;
+    for (int i = 0; i < count; ++i)
+        sizes.append(QVector3D(4 + int(rng.next() * 4), 10 + int(rng.next() * 8) * 5, 4 + int(rng.next() * 4)));
+
+    QBENCHMARK {
+        Box3dGeometry::clearShapeCache();
+        for (const QVector3D &size : sizes) {
+            Box3dGeometry geometry;
+            geometry.setSize(size);
+        }
+    }
+    QVERIFY(Box3dGeometry::cachedShapeCount() <= 4 * 8 * 4 + 1);
+}
+
+void TestCanvas3DCpuBench::box3dBatchSetBulk_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+    QTest::newRow("100k") << 100000;
+}
+
+void TestCanvas3DCpuBench::box3dBatchSetBulk()
+{
+    QFETCH(int, count);
+    Lcg rng(kSeed);
+    QList<float> pos, sizes;
+    for (int i = 0; i < count; ++i) {
+        pos << rng.range(-500, 500) << 0.0f << rng.range(-500, 500);
+        sizes << rng.range(4, 8) << rng.range(10, 50) << rng.range(4, 8);
+    }
+    const QByteArray packedPos(reinterpret_cast<const char *>(pos.constData()), pos.size() * sizeof(float));
+    const QByteArray packedSizes(reinterpret_cast<const char *>(sizes.constData()), sizes.size() * sizeof(float));
+    const QByteArray colors(count * 4, char(0xff));
+
+    Box3DBatchInstancing batch;
+    QBENCHMARK {
+        batch.setBulk(packedPos, packedSizes, colors);
+    }
+    QCOMPARE(batch.count(), count);
+}
+
+// Exposes the upload the renderer would trigger once per frame.
+class BoxLineBatchProbe : public BoxLineBatchInstancing
+{
+public:
+    QByteArray upload()
+    {
+        int n = 0;
+        return getInstanceBuffer(&n);
+    }
+};
+
+// Every line of a LineLayer3D moving once per frame: each update patches its
+// own slice of the shared table in place, then the table is uploaded.
+void TestCanvas3DCpuBench::boxLineSetPoints_data()
+{
+    QTest::addColumn<int>("lines");
+    QTest::newRow("100") << 100;
+    QTest::newRow("1k") << 1000;
+}
+
+void TestCanvas3DCpuBench::boxLineSetPoints()
+{
+    QFETCH(int, lines);
+    constexpr int kPoints = 8;
+    Lcg rng(kSeed);
+    QList<QList<QVector3D>> paths;
+    for (int i = 0; i < lines; ++i) {
+        QList<QVector3D> path;
+        for (int p = 0; p < kPoints; ++p)
+            path.append(QVector3D(rng.range(-100, 100), rng.range(0, 50), rng.range(-100, 100)));
+        paths.append(path);
+    }
+
+    BoxLineBatchProbe batch;
+    QList<int> handles;
+    for (const QList<QVector3D> &path : paths)
+        handles.append(batch.addLine(path, 0.5f, QColor(Qt::cyan)));
+    // First upload compacts the table; afterwards updates patch in place.
+    QCOMPARE(batch.upload().size(), qsizetype(lines * (kPoints - 1) * sizeof(QQuick3DInstancing::InstanceTableEntry)));
+
+    float t = 0.0f;
+    QBENCHMARK {
+        t += 0.1f;
+        for (int i = 0; i < lines; ++i) {
+            QList<QVector3D> path = paths[i];
+            for (QVector3D &p : path)
+                p.setY(p.y() + t);
+            batch.setLinePoints(handles[i], path);
+        }
+        batch.upload();
+    }
+    QCOMPARE(batch.count(), lines * (kPoints - 1));
+}
+
+// Animating one style of a large keyed table: reassigning the whole list
+// versus patching the one style through setStyleValue.
+void TestCanvas3DCpuBench::styleTableUpdate_data()
+{
+    QTest::addColumn<int>("styles");
+    QTest::addColumn<bool>("patch");
+    QTest::newRow("100/rebuild") << 100 << false;
+    QTest::newRow("100/patch") << 100 << true;
+    QTest::newRow("4k/rebuild") << 4000 << false;
+    QTest::newRow("4k/patch") << 4000 << true;
+}
+
+void TestCanvas3DCpuBench::styleTableUpdate()
+{
+    QFETCH(int, styles);
+    QFETCH(bool, patch);
+    Lcg rng(kSeed);
+    QVariantList list;
+    for (int i = 0; i < styles; ++i) {
+        list.append(QVariantMap{
+            { QStringLiteral("key"), QStringLiteral("s%1").arg(i) },
+            { QStringLiteral("dash"), QVariantList{ rng.range(1, 20), rng.range(1, 20) } },
+            { QStringLiteral("pattern"), QStringLiteral("chevron") },
+            { QStringLiteral("flow"), rng.range(0, 40) },
+            { QStringLiteral("glow"), 0.5 },
+        });
+    }
+
+    LineStyleTextureData table;
+    table.setStyles(list);
+    QCOMPARE(table.styleCount(), styles);
+    QCOMPARE(table.textureSize().y(), float(((styles + LineStyleTextureData::kBandWidth - 1)
+                                             / LineStyleTextureData::kBandWidth)
+                                            * LineStyleTextureData::kTableRows));
+    const QString key = QStringLiteral("s%1").arg(styles / 2);
+    const int index = table.styleId(key);
+    QCOMPARE(index, styles / 2);
+
+    float t = 0.0f;
+    QBENCHMARK {
+        t += 0.1f;
+        const float glow = 0.5f + 0.5f * std::sin(t);
+        if (patch) {
+            table.setStyleValue(key, QStringLiteral("glow"), glow);
+        } else {
+            QVariantMap m = list.at(index).toMap();
+            m.insert(QStringLiteral("glow"), glow);
+            list[index] = m;
+            table.setStyles(list);
+        }
+    }
+}
+
+// --- labels -----------------------------------------------------------
+
+void TestCanvas3DCpuBench::glyphAtlasBake_data()
+{
+    QTest::addColumn<QString>("glyphs");
+    QString ascii;
+    for (char16_t c = 0x21; c < 0x7f; ++c)
+        ascii.append(QChar(c));
+    QString latin1 = ascii;
+    for (char16_t c = 0xc0; c <= 0xff; ++c)
+        latin1.append(QChar(c));
+    QTest::newRow("digits") << QStringLiteral("0123456789");
+    QTest::newRow("ascii") << ascii;
+    QTest::newRow("latin1") << latin1;
+}
+
+void TestCanvas3DCpuBench::glyphAtlasBake()
+{
+    QFETCH(QString, glyphs);
+    int baked = 0;
+    QBENCHMARK {
+        // A fresh atlas per iteration so every glyph is rasterized and
+        // distance-transformed again.
+        LabelGlyphAtlas atlas;
+        atlas.ensureString(glyphs);
+        baked = atlas.glyphCount();
+    }
+    QVERIFY(baked > 0);
+}
+
+void TestCanvas3DCpuBench::labelReshape_data()
+{
+    QTest::addColumn<int>("labels");
+    QTest::newRow("100") << 100;
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+}
+
+void TestCanvas3DCpuBench::labelReshape()
+{
+    QFETCH(int, labels);
+    Lcg rng(kSeed);
+    QVariantList list;
+    list.reserve(labels);
+    for (int i = 0; i < labels; ++i) {
+        QVariantMap m;
+        m.insert(QStringLiteral("position"), QVariant::fromValue(
+            QVector3D(rng.range(-500, 500), rng.range(0, 300), rng.range(-500, 500))));
+        m.insert(QStringLiteral("text"), randomWord(rng));
+        m.insert(QStringLiteral("size"), 24.0);
+        list.append(m);
+    }
+
+    LabelGlyphAtlas atlas;
+    LabelBatchInstancing batch;
+    batch.setAtlas(&atlas);
+    batch.setLabels(list); // bakes every glyph once; the loop measures shaping
+    QBENCHMARK {
+        batch.setLabels(list);
+    }
+    QCOMPARE(batch.count(), labels);
+    QVERIFY(batch.glyphCount() > 0);
+}
+
+QTEST_MAIN(TestCanvas3DCpuBench)
+#include "tst_cpu_bench.moc"
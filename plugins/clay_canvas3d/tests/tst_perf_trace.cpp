@@ -0,0 +1,209 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// Tests for the PerfTrace backend behind PerfRegistry's tracing mode.
+// Covers:
+//   * interned ids are stable per name
+//   * nothing is recorded while tracing is disabled
+//   * nested zones export as balanced B/E pairs in order
+//   * zones from QtConcurrent workers are recorded, balanced per thread track
+//   * threads that exited hand their ring to the next thread
+//   * counters export with their value
+//   * per-zone overhead stays within budget when enabled
+
+#include "perftrace.h"
+
+#include <QtTest/QtTest>
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QtConcurrent>
+#include <numeric>
+#include <thread>
+
+class TestPerfTrace : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+    void internIsStable();
+    void disabledRecordsNothing();
+    void nestedZonesExportBalanced();
+    void workerThreadsGetOwnTracks();
+    void exitedThreadRingsAreReused();
+    void countersCarryValue();
+    void zoneOverhead();
+
+private:
+    QJsonArray exportEvents();
+    QTemporaryDir tmp_;
+};
+
+void TestPerfTrace::init()
+{
+    PerfTrace::setEnabled(false);
+    PerfTrace::clear();
+}
+
+void TestPerfTrace::cleanup()
+{
+    PerfTrace::setEnabled(false);
+    PerfTrace::clear();
+}
+
+QJsonArray TestPerfTrace::exportEvents()
+{
+    const QString path = tmp_.filePath(QStringLiteral("trace.json"));
+    if (!PerfTrace::exportChromeTrace(path))
+        return {};
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly))
+        return {};
+    const QJsonDocument doc = QJsonDocument::fromJson(f.readAll());
+    QJsonArray events;
+    // Drop the thread_name metadata rows; tests look at recorded events only.
+    for (const QJsonValue &v : doc.object().value(QStringLiteral("traceEvents")).toArray()) {
+        if (v.toObject().value(QStringLiteral("ph")).toString() != QLatin1String("M"))
+            events.append(v);
+    }
+    return events;
+}
+
+void TestPerfTrace::internIsStable()
+{
+    const auto a = PerfTrace::intern("test.a");
+    const auto b = PerfTrace::intern("test.b");
+    QVERIFY(a != b);
+    QCOMPARE(PerfTrace::intern("test.a"), a);
+    QCOMPARE(PerfTrace::intern(QStringLiteral("test.b")), b);
+}
+
+void TestPerfTrace::disabledRecordsNothing()
+{
+    {
+        CLAY_PERF_ZONE("test.disabled");
+    }
+    QCOMPARE(exportEvents().size(), 0);
+}
+
+void TestPerfTrace::nestedZonesExportBalanced()
+{
+    PerfTrace::setEnabled(true);
+    {
+        CLAY_PERF_ZONE("test.outer");
+        {
+            CLAY_PERF_ZONE("test.inner");
+        }
+    }
+    PerfTrace::setEnabled(false);
+
+    const QJsonArray events = exportEvents();
+    QCOMPARE(events.size(), 4);
+    const QStringList expected = { "B:test.outer", "B:test.inner", "E:test.inner", "E:test.outer" };
+    double lastTs = -1.0;
+    for (int i = 0; i < events.size(); ++i) {
+        const QJsonObject e = events[i].toObject();
+        QCOMPARE(e.value("ph").toString() + ":" + e.value("name").toString(), expected[i]);
+        QVERIFY(e.value("ts").toDouble() >= lastTs);
+        lastTs = e.value("ts").toDouble();
+    }
+
+    // Exported events are consumed.
+    QCOMPARE(exportEvents().size(), 0);
+}
+
+void TestPerfTrace::workerThreadsGetOwnTracks()
+{
+    PerfTrace::setEnabled(true);
+    {
+        CLAY_PERF_ZONE("test.mainThread");
+    }
+    QList<int> work(64);
+    std::iota(work.begin(), work.end(), 0);
+    QtConcurrent::blockingMap(work, [](int &v) {
+        CLAY_PERF_ZONE("test.worker");
+        v *= 2;
+    });
+    PerfTrace::setEnabled(false);
+
+    const QJsonArray events = exportEvents();
+    int workerBegins = 0;
+    int mainBegins = 0;
+    QHash<int, int> depth;
+    for (const QJsonValue &v : events) {
+        const QJsonObject e = v.toObject();
+        const int tid = e.value("tid").toInt();
+        const QString ph = e.value("ph").toString();
+        depth[tid] += ph == "B" ? 1 : ph == "E" ? -1 : 0;
+        QVERIFY(depth[tid] >= 0);
+        if (ph == "B" && e.value("name").toString() == "test.mainThread")
+            ++mainBegins;
+        if (ph == "B" && e.value("name").toString() == "test.worker")
+            ++workerBegins;
+    }
+    QCOMPARE(mainBegins, 1);
+    QCOMPARE(workerBegins, 64);
+    for (int d : std::as_const(depth))
+        QCOMPARE(d, 0);
+}
+
+void TestPerfTrace::exitedThreadRingsAreReused()
+{
+    // More short-lived threads than there are rings; joining one runs its
+    // thread_local cleanup, so each successor takes over the same ring.
+    PerfTrace::setEnabled(true);
+    for (std::size_t i = 0; i < PerfTrace::kMaxThreadRings + 16; ++i) {
+        std::thread([] { CLAY_PERF_ZONE("test.shortLived"); }).join();
+    }
+    PerfTrace::setEnabled(false);
+
+    QSet<int> tids;
+    int begins = 0;
+    for (const QJsonValue &v : exportEvents()) {
+        const QJsonObject e = v.toObject();
+        if (e.value("name").toString() != QLatin1String("test.shortLived"))
+            continue;
+        tids.insert(e.value("tid").toInt());
+        begins += e.value("ph").toString() == QLatin1String("B");
+    }
+    QCOMPARE(begins, int(PerfTrace::kMaxThreadRings) + 16);
+    QCOMPARE(tids.size(), 1);
+    QCOMPARE(PerfTrace::droppedEvents(), quint64(0));
+}
+
+void TestPerfTrace::countersCarryValue()
+{
+    PerfTrace::setEnabled(true);
+    CLAY_PERF_COUNTER("test.voices", 12);
+    PerfTrace::setEnabled(false);
+
+    const QJsonArray events = exportEvents();
+    QCOMPARE(events.size(), 1);
+    const QJsonObject e = events[0].toObject();
+    QCOMPARE(e.value("ph").toString(), QStringLiteral("C"));
+    QCOMPARE(e.value("args").toObject().value("value").toDouble(), 12.0);
+}
+
+void TestPerfTrace::zoneOverhead()
+{
+    // Stay below ring capacity so every event is recorded, not dropped.
+    constexpr int kZones = int(PerfTrace::kRingCapacity / 2) - 1;
+    const auto id = PerfTrace::intern("test.overhead");
+    PerfTrace::setEnabled(true);
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < kZones; ++i)
+        PerfTrace::Zone zone(id);
+    const double nsPerZone = double(timer.nsecsElapsed()) / kZones;
+    PerfTrace::setEnabled(false);
+    QCOMPARE(PerfTrace::droppedEvents(), quint64(0));
+    qInfo("PerfTrace: %.1f ns per zone", nsPerZone);
+    // Target is < 50 ns; the bound is loose so shared CI runners don't flake.
+    QVERIFY2(nsPerZone < 500.0, qPrintable(QString::number(nsPerZone)));
+}
+
+QTEST_MAIN(TestPerfTrace)
+#include "tst_perf_trace.moc"
@@ -0,0 +1,232 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// SpatialIndex (the BVH behind the LineBatch3D / LabelBatch3D picking queries)
+// checked against brute force: box overlap, nearest and ray traversal on
+// random segment soups, before and after refits, plus the geometry helpers.
+
+#include "spatialindex.h"
+
+#include <QtTest/QtTest>
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+class Lcg
+{
+public:
+    explicit Lcg(std::uint32_t seed) : state_(seed) {}
+    float range(float lo, float hi)
+    {
+        state_ = state_ * 1664525u + 1013904223u;
+        return lo + (hi - lo) * float(state_ / 4294967296.0);
+    }
+
+private:
+    std::uint32_t state_;
+};
+
+struct Segment {
+    QVector3D a, b;
+};
+
+QList<Segment> randomSegments(int n, std::uint32_t seed)
+{
+    Lcg rng(seed);
+    QList<Segment> segs;
+    for (int i = 0; i < n; ++i) {
+        const QVector3D a(rng.range(-100, 100), rng.range(-100, 100), rng.range(-100, 100));
+        segs.append({a, a + QVector3D(rng.range(-10, 10), rng.range(-10, 10), rng.range(-10, 10))});
+    }
+    return segs;
+}
+
+QList<SpatialIndex::Box> boxesOf(const QList<Segment> &segs)
+{
+    QList<SpatialIndex::Box> boxes;
+    for (const Segment &s : segs) {
+        SpatialIndex::Box b;
+        b.expand(s.a);
+        b.expand(s.b);
+        boxes.append(b);
+    }
+    return boxes;
+}
+
+QList<int> boxQuery(const SpatialIndex &index, const QList<Segment> &segs,
+                    const SpatialIndex::Box &query)
+{
+    QList<int> hits;
+    index.traverse([&](const SpatialIndex::Box &b) { return b.overlaps(query); },
+                   [&](int i) {
+                       if (SpatialIndex::segmentIntersectsBox(segs[i].a, segs[i].b, query))
+                           hits.append(i);
+                   });
+    std::sort(hits.begin(), hits.end());
+    return hits;
+}
+
+QList<int> bruteBoxQuery(const QList<Segment> &segs, const SpatialIndex::Box &query)
+{
+    QList<int> hits;
+    for (int i = 0; i < segs.size(); ++i) {
+        if (SpatialIndex::segmentIntersectsBox(segs[i].a, segs[i].b, query))
+            hits.append(i);
+    }
+    return hits;
+}
+
+} // namespace
+
+class TestSpatialIndex : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void emptyIndex();
+    void helpers();
+    void boxQueryMatchesBruteForce();
+    void nearestMatchesBruteForce();
+    void rayPickMatchesBruteForce();
+    void refitTracksMovedItems();
+};
+
+void TestSpatialIndex::emptyIndex()
+{
+    SpatialIndex index;
+    index.build({});
+    QVERIFY(index.isEmpty());
+    int visited = 0;
+    index.traverse([](const SpatialIndex::Box &) { return true; }, [&](int) { ++visited; });
+    QCOMPARE(visited, 0);
+    float d = 0.0f;
+    QCOMPARE(index.nearest([](const SpatialIndex::Box &) { return 0.0f; },
+                           [](int) { return 0.0f; }, 1.0f, &d), -1);
+}
+
+void TestSpatialIndex::helpers()
+{
+    const SpatialIndex::Ray ray(QVector3D(0, 0, 10), QVector3D(0, 0, -2));
+    QVERIFY(ray.isValid());
+    QVERIFY(!SpatialIndex::Ray(QVector3D(), QVector3D()).isValid());
+
+    // Segment along x at z = 0, offset 1 in y: closest approach at t = 10.
+    float t = 0.0f, u = 0.0f;
+    const float d = SpatialIndex::raySegmentDistance(ray, QVector3D(-1, 1, 0), QVector3D(1, 1, 0),
+                                                     &t, &u);
+    QCOMPARE(d, 1.0f);
+    QCOMPARE(t, 10.0f);
+    QCOMPARE(u, 0.5f);
+
+    // Behind the origin: clamped to t = 0.
+    SpatialIndex::raySegmentDistance(ray, QVector3D(-1, 0, 20), QVector3D(1, 0, 20), &t, &u);
+    QCOMPARE(t, 0.0f);
+
+    QCOMPARE(SpatialIndex::pointSegmentDistance(QVector3D(3, 0, 0), QVector3D(0, 0, 0),
+                                                QVector3D(1, 0, 0), &u), 2.0f);
+    QCOMPARE(u, 1.0f);
+
+    const SpatialIndex::Box box{QVector3D(0, 0, 0), QVector3D(1, 1, 1)};
+    QVERIFY(SpatialIndex::segmentIntersectsBox(QVector3D(-1, 0.5f, 0.5f), QVector3D(2, 0.5f, 0.5f), box));
+    QVERIFY(!SpatialIndex::segmentIntersectsBox(QVector3D(-2, 0.5f, 0.5f), QVector3D(-1, 0.5f, 0.5f), box));
+    QVERIFY(!SpatialIndex::segmentIntersectsBox(QVector3D(-1, 2, 0.5f), QVector3D(2, 2, 0.5f), box));
+}
+
+void TestSpatialIndex::boxQueryMatchesBruteForce()
+{
+    const QList<Segment> segs = randomSegments(5000, 1337);
+    SpatialIndex index;
+    index.build(boxesOf(segs));
+    QCOMPARE(index.itemCount(), 5000);
+
+    Lcg rng(7);
+    for (int q = 0; q < 50; ++q) {
+        const QVector3D c(rng.range(-100, 100), rng.range(-100, 100), rng.range(-100, 100));
+        const QVector3D h(rng.range(1, 30), rng.range(1, 30), rng.range(1, 30));
+        const SpatialIndex::Box query{c - h, c + h};
+        QCOMPARE(boxQuery(index, segs, query), bruteBoxQuery(segs, query));
+    }
+}
+
+void TestSpatialIndex::nearestMatchesBruteForce()
+{
+    const QList<Segment> segs = randomSegments(5000, 1337);
+    SpatialIndex index;
+    index.build(boxesOf(segs));
+
+    Lcg rng(11);
+    for (int q = 0; q < 50; ++q) {
+        const QVector3D p(rng.range(-120, 120), rng.range(-120, 120), rng.range(-120, 120));
+        float bestBrute = std::numeric_limits<float>::max();
+        for (const Segment &s : segs)
+            bestBrute = std::min(bestBrute, SpatialIndex::pointSegmentDistance(p, s.a, s.b, nullptr));
+
+        float best = 0.0f;
+        const int item = index.nearest(
+            [&](const SpatialIndex::Box &b) { return b.distanceTo(p); },
+            [&](int i) { return SpatialIndex::pointSegmentDistance(p, segs[i].a, segs[i].b, nullptr); },
+            std::numeric_limits<float>::max(), &best);
+        QVERIFY(item >= 0);
+        QCOMPARE(best, bestBrute);
+    }
+}
+
+void TestSpatialIndex::rayPickMatchesBruteForce()
+{
+    const QList<Segment> segs = randomSegments(5000, 1337);
+    SpatialIndex index;
+    index.build(boxesOf(segs));
+    const float radius = 0.75f;
+
+    Lcg rng(23);
+    for (int q = 0; q < 50; ++q) {
+        const QVector3D origin(rng.range(-150, 150), 150, rng.range(-150, 150));
+        const QVector3D target(rng.range(-100, 100), rng.range(-100, 100), rng.range(-100, 100));
+        const SpatialIndex::Ray ray(origin, target - origin);
+
+        float bruteT = std::numeric_limits<float>::max();
+        for (const Segment &s : segs) {
+            float t = 0.0f;
+            if (SpatialIndex::raySegmentDistance(ray, s.a, s.b, &t, nullptr) <= radius)
+                bruteT = std::min(bruteT, t);
+        }
+
+        float bestT = std::numeric_limits<float>::max();
+        index.traverse([&](const SpatialIndex::Box &b) { return ray.reaches(b, radius, bestT); },
+                       [&](int i) {
+                           float t = 0.0f;
+                           if (SpatialIndex::raySegmentDistance(ray, segs[i].a, segs[i].b, &t, nullptr) <= radius)
+                               bestT = std::min(bestT, t);
+                       });
+        QCOMPARE(bestT, bruteT);
+    }
+}
+
+void TestSpatialIndex::refitTracksMovedItems()
+{
+    QList<Segment> segs = randomSegments(2000, 1337);
+    SpatialIndex index;
+    index.build(boxesOf(segs));
+
+    // Small moves refit in place; a large shuffle degrades the tree enough to
+    // trigger a rebuild. Either way queries must stay exact.
+    for (float shift : {0.5f, 80.0f}) {
+        Lcg rng(std::uint32_t(shift * 10));
+        for (Segment &s : segs) {
+            const QVector3D d(rng.range(-shift, shift), rng.range(-shift, shift), rng.range(-shift, shift));
+            s.a += d;
+            s.b += d;
+        }
+        index.update(boxesOf(segs));
+        const SpatialIndex::Box query{QVector3D(-40, -40, -40), QVector3D(40, 40, 40)};
+        QCOMPARE(boxQuery(index, segs, query), bruteBoxQuery(segs, query));
+    }
+
+    // A different count rebuilds.
+    segs.resize(100);
+    index.update(boxesOf(segs));
+    QCOMPARE(index.itemCount(), 100);
+}
+
+QTEST_MAIN(TestSpatialIndex)
+#include "tst_spatial_index.moc"
@@ -1,5 +1,6 @@
 // (c) Clayground Contributors - MIT License, see "LICENSE" file
 #include "speech.h"
+#include "viseme_cache.h"
 
 #include <QAudioBuffer>
 #include <QAudioDecoder>
@@ -75,6 +76,16 @@ LetterShape shapeForLetter(QChar c)
     }
 }
 
+// Path VisemeCache can hash; empty for remote sources.
+QString audioPath(const QUrl &source)
+{
+    if (source.isLocalFile())
+        return source.toLocalFile();
+    if (source.scheme() == u"qrc")
+        return QStringLiteral(":") + source.path();
+    return {};
+}
+
 } // namespace
 
 Speech::Speech(QObject *parent)
@@ -324,19 +335,21 @@ void Speech::startAudio(const QUrl &source)
         });
     }
 
-    rmsWindows_.clear();
-    zcrWindows_.clear();
-    maxRms_ = 0.f;
-    winSumSquares_ = 0.0;
-    winSampleCount_ = 0;
-    winZeroCrossings_ = 0;
-    lastSample_ = 0.f;
-    samplesPerWindow_ = 0;
+    analyzer_.reset();
     analysisReady_ = false;
     babbleMode_ = false;
+    audioPath_ = audioPath(source);
 
     beginSpeaking(Mode::Audio);
     player_->setSource(source);
+
+    // Analyzed before, or baked by clay_visemes: no decoding at all.
+    if (!audioPath_.isEmpty() && VisemeCache::lookup(audioPath_, &timeline_)) {
+        analysisReady_ = true;
+        player_->play();
+        return;
+    }
+
     decoder_->setSource(source);
     decoder_->start();
 }
@@ -351,78 +364,7 @@ void Speech::sayAudio(const QUrl &source)
 
 void Speech::onDecoderBufferReady()
 {
-    const QAudioBuffer buffer = decoder_->read();
-    if (!buffer.isValid())
-        return;
-
-    const QAudioFormat fmt = buffer.format();
-    if (samplesPerWindow_ == 0)
-        samplesPerWindow_ = qMax(1, fmt.sampleRate() * windowMs_ / 1000);
-
-    const int channels = qMax(1, fmt.channelCount());
-    const int frames = buffer.frameCount();
-
-    auto processSample = [this](float mono) {
-        winSumSquares_ += double(mono) * mono;
-        if ((lastSample_ < 0.f) != (mono < 0.f))
-            ++winZeroCrossings_;
-        lastSample_ = mono;
-        if (++winSampleCount_ >= samplesPerWindow_) {
-            const float rms = float(qSqrt(winSumSquares_ / winSampleCount_));
-            const float zcr = float(winZeroCrossings_) / winSampleCount_;
-            rmsWindows_.append(rms);
-            zcrWindows_.append(zcr);
-            maxRms_ = qMax(maxRms_, rms);
-            winSumSquares_ = 0.0;
-            winSampleCount_ = 0;
-            winZeroCrossings_ = 0;
-        }
-    };
-
-    switch (fmt.sampleFormat()) {
-    case QAudioFormat::Int16: {
-        const qint16 *data = buffer.constData<qint16>();
-        for (int f = 0; f < frames; ++f) {
-            qint32 acc = 0;
-            for (int ch = 0; ch < channels; ++ch)
-                acc += data[f * channels + ch];
-            processSample(float(acc) / (channels * 32768.f));
-        }
-        break;
-    }
-    case QAudioFormat::Int32: {
-        const qint32 *data = buffer.constData<qint32>();
-        for (int f = 0; f < frames; ++f) {
-            double acc = 0;
-            for (int ch = 0; ch < channels; ++ch)
-                acc += data[f * channels + ch];
-            processSample(float(acc / (double(channels) * 2147483648.0)));
-        }
-        break;
-    }
-    case QAudioFormat::Float: {
-        const float *data = buffer.constData<float>();
-        for (int f = 0; f < frames; ++f) {
-            float acc = 0.f;
-            for (int ch = 0; ch < channels; ++ch)
-                acc += data[f * channels + ch];
-            processSample(acc / channels);
-        }
-        break;
-    }
-    case QAudioFormat::UInt8: {
-        const quint8 *data = buffer.constData<quint8>();
-        for (int f = 0; f < frames; ++f) {
-            int acc = 0;
-            for (int ch = 0; ch < channels; ++ch)
-                acc += int(data[f * channels + ch]) - 128;
-            processSample(float(acc) / (channels * 128.f));
-        }
-        break;
-    }
-    default:
-        break;
-    }
+    analyzer_.addBuffer(decoder_->read());
 }
 
 void Speech::onDecoderFinished()
@@ -433,30 +375,14 @@ void Speech::onDecoderFinished()
     timeline_.keys.clear();
     timeline_.wordMarks.clear();
 
-    if (maxRms_ > 0.f && !rmsWindows_.isEmpty()) {
-        const float gate = 0.06f * maxRms_;
-        for (int i = 0; i < rmsWindows_.size(); ++i) {
-            const float rms = rmsWindows_.at(i);
-            float open = 0.f, wide = 0.f, round = 0.f;
-            if (rms > gate) {
-                open = qPow(rms / maxRms_, 0.6f);
-                // High zero-crossing rate hints at sibilants/fricatives:
-                // narrow the mouth instead of opening it wide.
-                const float zcrNorm = qBound(0.f, (zcrWindows_.at(i) - 0.05f) / 0.25f, 1.f);
-                wide = 0.55f * zcrNorm;
-                open *= (1.f - 0.45f * zcrNorm);
-                round = 0.25f * (1.f - zcrNorm) * open;
-            }
-            timeline_.keys.append({qint64(i) * windowMs_, open, wide, round});
-        }
-        timeline_.durationMs = qint64(rmsWindows_.size()) * windowMs_;
-        analysisReady_ = true;
-        player_->play();
+    if (analyzer_.finish(&timeline_)) {
+        if (!audioPath_.isEmpty())
+            VisemeCache::insert(audioPath_, timeline_);
     } else {
         babbleMode_ = true;
-        analysisReady_ = true;
-        player_->play();
     }
+    analysisReady_ = true;
+    player_->play();
 }
 
 void Speech::buildBabbleTimeline(qint64 durationMs)
@@ -12,10 +12,14 @@
 //    mouth and audio stay aligned. Without TTS the same timeline plays
 //    silently at an estimated pace.
 //
-//  * sayAudio(): plays a wav/mp3 via QMediaPlayer while QAudioDecoder
-//    analyzes the samples (RMS envelope for openness, zero-crossing rate
-//    as a crude sibilance hint for wideness). If decoding fails, a
-//    synthetic babble envelope keeps the mouth moving during playback.
+//  * sayAudio(): plays a wav/mp3 via QMediaPlayer. The timeline comes
+//    from VisemeCache when the clip was analyzed before (or baked into a
+//    sidecar by clay_visemes), so the mouth moves from the first frame;
+//    otherwise QAudioDecoder feeds a VisemeAnalyzer first (RMS envelope
+//    for openness, zero-crossing rate as a crude sibilance hint for
+//    wideness) and the result is cached for the next time. If decoding
+//    fails, a synthetic babble envelope keeps the mouth moving during
+//    playback.
 //
 // A ~60 Hz ticker smooths the raw viseme targets with asymmetric
 // attack/release so the mouth snaps open and relaxes closed.
@@ -31,6 +35,9 @@
 #include <QUrl>
 #include <QVector>
 
+#include "viseme_analyzer.h"
+#include "viseme_timeline.h"
+
 QT_BEGIN_NAMESPACE
 class QAudioDecoder;
 class QAudioOutput;
@@ -43,24 +50,6 @@ class QTextToSpeech;
 QT_END_NAMESPACE
 #endif
 
-// One step on the mouth-shape timeline; values are targets in [0,1].
-struct VisemeKey
-{
-    qint64 ms = 0;
-    float  open = 0.f;
-    float  wide = 0.f;
-    float  round = 0.f;
-};
-
-// Timeline plus the mapping from character offsets in the source text to
-// timeline positions (used to re-sync on TTS word callbacks).
-struct VisemeTimeline
-{
-    QVector<VisemeKey> keys;
-    QVector<QPair<qsizetype, qint64>> wordMarks; // (char offset, ms)
-    qint64 durationMs = 0;
-};
-
 class Speech : public QObject
 {
     Q_OBJECT
@@ -164,16 +153,8 @@ private:
     QMediaPlayer  *player_ = nullptr;
     QAudioOutput  *audioOut_ = nullptr;
     QAudioDecoder *decoder_ = nullptr;
-    QVector<float> rmsWindows_;
-    QVector<float> zcrWindows_;
-    float  maxRms_ = 0.f;
-    int    windowMs_ = 33;
-    // carry state between decoder buffers
-    double winSumSquares_ = 0.0;
-    int    winSampleCount_ = 0;
-    int    winZeroCrossings_ = 0;
-    float  lastSample_ = 0.f;
-    int    samplesPerWindow_ = 0;
+    VisemeAnalyzer analyzer_;
+    QString audioPath_;         // local/qrc path of the clip, for VisemeCache
     bool   analysisReady_ = false;
     bool   babbleMode_ = false;
 };
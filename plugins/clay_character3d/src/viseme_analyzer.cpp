@@ -0,0 +1,159 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+#include "viseme_analyzer.h"
+
+#include <QAudioBuffer>
+#include <QAudioDecoder>
+#include <QEventLoop>
+#include <QUrl>
+#include <QtMath>
+
+void VisemeAnalyzer::reset()
+{
+    *this = VisemeAnalyzer();
+}
+
+void VisemeAnalyzer::addSample(float mono)
+{
+    winSumSquares_ += double(mono) * mono;
+    if ((lastSample_ < 0.f) != (mono < 0.f))
+        ++winZeroCrossings_;
+    lastSample_ = mono;
+    if (++winSampleCount_ >= samplesPerWindow_) {
+        const float rms = float(qSqrt(winSumSquares_ / winSampleCount_));
+        const float zcr = float(winZeroCrossings_) / winSampleCount_;
+        rmsWindows_.append(rms);
+        zcrWindows_.append(zcr);
+        maxRms_ = qMax(maxRms_, rms);
+        winSumSquares_ = 0.0;
+        winSampleCount_ = 0;
+        winZeroCrossings_ = 0;
+    }
+}
+
+void VisemeAnalyzer::addSamples(const float *mono, int count, int sampleRate)
+{
+    if (samplesPerWindow_ == 0)
+        samplesPerWindow_ = qMax(1, sampleRate * kWindowMs / 1000);
+    for (int i = 0; i < count; ++i)
+        addSample(mono[i]);
+}
+
+void VisemeAnalyzer::addBuffer(const QAudioBuffer &buffer)
+{
+    if (!buffer.isValid())
+        return;
+
+    const QAudioFormat fmt = buffer.format();
+    if (samplesPerWindow_ == 0)
+        samplesPerWindow_ = qMax(1, fmt.sampleRate() * kWindowMs / 1000);
+
+    const int channels = qMax(1, fmt.channelCount());
+    const int frames = buffer.frameCount();
+
+    switch (fmt.sampleFormat()) {
+    case QAudioFormat::Int16: {
+        const qint16 *data = buffer.constData<qint16>();
+        for (int f = 0; f < frames; ++f) {
+            qint32 acc = 0;
+            for (int ch = 0; ch < channels; ++ch)
+                acc += data[f * channels + ch];
+            addSample(float(acc) / (channels * 32768.f));
+        }
+        break;
+    }
+    case QAudioFormat::Int32: {
+        const qint32 *data = buffer.constData<qint32>();
+        for (int f = 0; f < frames; ++f) {
+            double acc = 0;
+            for (int ch = 0; ch < channels; ++ch)
+                acc += data[f * channels + ch];
+            addSample(float(acc / (double(channels) * 2147483648.0)));
+        }
+        break;
+    }
+    case QAudioFormat::Float: {
+        const float *data = buffer.constData<float>();
+        for (int f = 0; f < frames; ++f) {
+            float acc = 0.f;
+            for (int ch = 0; ch < channels; ++ch)
+                acc += data[f * channels + ch];
+            addSample(acc / channels);
+        }
+        break;
+    }
+    case QAudioFormat::UInt8: {
+        const quint8 *data = buffer.constData<quint8>();
+        for (int f = 0; f < frames; ++f) {
+            int acc = 0;
+            for (int ch = 0; ch < channels; ++ch)
+                acc += int(data[f * channels + ch]) - 128;
+            addSample(float(acc) / (channels * 128.f));
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+bool VisemeAnalyzer::finish(VisemeTimeline *out) const
+{
+    if (maxRms_ <= 0.f || rmsWindows_.isEmpty())
+        return false;
+
+    VisemeTimeline tl;
+    tl.keys.reserve(rmsWindows_.size());
+    const float gate = 0.06f * maxRms_;
+    for (int i = 0; i < rmsWindows_.size(); ++i) {
+        const float rms = rmsWindows_.at(i);
+        float open = 0.f, wide = 0.f, round = 0.f;
+        if (rms > gate) {
+            open = qPow(rms / maxRms_, 0.6f);
+            // High zero-crossing rate hints at sibilants/fricatives:
+            // narrow the mouth instead of opening it wide.
+            const float zcrNorm = qBound(0.f, (zcrWindows_.at(i) - 0.05f) / 0.25f, 1.f);
+            wide = 0.55f * zcrNorm;
+            open *= (1.f - 0.45f * zcrNorm);
+            round = 0.25f * (1.f - zcrNorm) * open;
+        }
+        tl.keys.append({qint64(i) * kWindowMs, open, wide, round});
+    }
+    tl.durationMs = qint64(rmsWindows_.size()) * kWindowMs;
+    *out = std::move(tl);
+    return true;
+}
+
+bool VisemeAnalyzer::analyzeFile(const QString &path, VisemeTimeline *out, QString *error)
+{
+    VisemeAnalyzer analyzer;
+    QAudioDecoder decoder;
+    QEventLoop loop;
+    bool done = false;
+    QString failure;
+
+    QObject::connect(&decoder, &QAudioDecoder::bufferReady, &loop, [&] {
+        analyzer.addBuffer(decoder.read());
+    });
+    QObject::connect(&decoder, &QAudioDecoder::finished, &loop, [&] {
+        done = true;
+        loop.quit();
+    });
+    QObject::connect(&decoder, qOverload<QAudioDecoder::Error>(&QAudioDecoder::error),
+                     &loop, [&] {
+        failure = decoder.errorString();
+        done = true;
+        loop.quit();
+    });
+
+    decoder.setSource(path.startsWith(u':') ? QUrl(QStringLiteral("qrc") + path)
+                                            : QUrl::fromLocalFile(path));
+    decoder.start();
+    if (!done)
+        loop.exec();
+
+    if (failure.isEmpty() && !analyzer.finish(out))
+        failure = QStringLiteral("no audible signal");
+    if (error)
+        *error = failure;
+    return failure.isEmpty();
+}
@@ -0,0 +1,60 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// VisemeAnalyzer — derives a viseme timeline from recorded speech. The
+// decoded samples are mixed to mono and cut into ~33 ms windows; each
+// window's RMS drives mouth openness, its zero-crossing rate (a crude
+// sibilance hint) narrows the mouth towards wide.
+//
+// Feed it incrementally (addBuffer() from a QAudioDecoder, as Speech
+// does while the clip starts), or analyze a whole file at once with
+// analyzeFile(), which decodes on the calling thread and so can run on
+// worker threads, one file each.
+
+#ifndef CLAY_CHARACTER3D_VISEME_ANALYZER_H
+#define CLAY_CHARACTER3D_VISEME_ANALYZER_H
+
+#include "viseme_timeline.h"
+
+#include <QString>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QAudioBuffer;
+QT_END_NAMESPACE
+
+class VisemeAnalyzer
+{
+public:
+    static constexpr int kWindowMs = 33;
+
+    void reset();
+
+    // Decoded audio, any of QAudioDecoder's sample formats.
+    void addBuffer(const QAudioBuffer &buffer);
+    // Mono samples in [-1, 1].
+    void addSamples(const float *mono, int count, int sampleRate);
+
+    // The timeline for everything fed so far; false for silence (or no
+    // input), which leaves `out` untouched.
+    bool finish(VisemeTimeline *out) const;
+
+    // Decode `path` (local file or qrc) and analyze it. Blocks until the
+    // decoder is done; `error` explains a false return.
+    static bool analyzeFile(const QString &path, VisemeTimeline *out,
+                            QString *error = nullptr);
+
+private:
+    void addSample(float mono);
+
+    QVector<float> rmsWindows_;
+    QVector<float> zcrWindows_;
+    float  maxRms_ = 0.f;
+    // carry state between buffers
+    double winSumSquares_ = 0.0;
+    int    winSampleCount_ = 0;
+    int    winZeroCrossings_ = 0;
+    float  lastSample_ = 0.f;
+    int    samplesPerWindow_ = 0;
+};
+
+#endif // CLAY_CHARACTER3D_VISEME_ANALYZER_H
@@ -0,0 +1,256 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+#include "viseme_cache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+#include <QtEndian>
+
+#include <cstring>
+
+namespace {
+
+constexpr char MAGIC[4] = {'C', 'L', 'V', 'S'};
+constexpr quint8 VERSION = 1;
+constexpr int KEY_BYTES = 5;
+constexpr int MARK_BYTES = 8;
+
+struct HashEntry
+{
+    qint64 size = -1;
+    QDateTime modified;
+    QByteArray hash;
+};
+
+struct State
+{
+    QMutex mutex;
+    QHash<QString, HashEntry> hashes;            // path -> content hash
+    QHash<QByteArray, VisemeTimeline> timelines; // content hash -> timeline
+};
+
+State &state()
+{
+    static State s;
+    return s;
+}
+
+template <typename T>
+void append(QByteArray &out, T value)
+{
+    char buf[sizeof(T)];
+    qToLittleEndian(value, buf);
+    out.append(buf, sizeof(T));
+}
+
+template <typename T>
+T read(const char *p)
+{
+    return qFromLittleEndian<T>(p);
+}
+
+quint8 quantize(float v)
+{
+    return quint8(qRound(qBound(0.f, v, 1.f) * 255.f));
+}
+
+QByteArray readFile(const QString &path)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly))
+        return {};
+    return f.readAll();
+}
+
+} // namespace
+
+namespace VisemeCache {
+
+QString sidecarPath(const QString &audioPath)
+{
+    return audioPath + QStringLiteral(".visemes");
+}
+
+QByteArray fileHash(const QString &path)
+{
+    const QFileInfo info(path);
+    if (!info.exists())
+        return {};
+    const qint64 size = info.size();
+    const QDateTime modified = info.lastModified();
+
+    State &s = state();
+    {
+        QMutexLocker lock(&s.mutex);
+        const auto it = s.hashes.constFind(path);
+        if (it != s.hashes.constEnd() && it->size == size && it->modified == modified)
+            return it->hash;
+    }
+
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly))
+        return {};
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (!hash.addData(&f))
+        return {};
+    const QByteArray result = hash.result();
+
+    QMutexLocker lock(&s.mutex);
+    s.hashes.insert(path, {size, modified, result});
+    return result;
+}
+
+QByteArray encode(const VisemeTimeline &timeline, const QByteArray &audioHash)
+{
+    if (audioHash.size() > 255)
+        return {};
+
+    QByteArray out;
+    out.reserve(int(sizeof(MAGIC)) + 2 + audioHash.size() + 12
+                + timeline.keys.size() * KEY_BYTES + timeline.wordMarks.size() * MARK_BYTES);
+    out.append(MAGIC, sizeof(MAGIC));
+    append<quint8>(out, VERSION);
+    append<quint8>(out, quint8(audioHash.size()));
+    out.append(audioHash);
+    append<quint32>(out, quint32(qBound<qint64>(0, timeline.durationMs, 0xffffffff)));
+    append<quint32>(out, quint32(timeline.keys.size()));
+    append<quint32>(out, quint32(timeline.wordMarks.size()));
+
+    qint64 prev = 0;
+    for (const VisemeKey &k : timeline.keys) {
+        const qint64 delta = k.ms - prev;
+        if (delta < 0 || delta > 0xffff)
+            return {};
+        prev = k.ms;
+        append<quint16>(out, quint16(delta));
+        append<quint8>(out, quantize(k.open));
+        append<quint8>(out, quantize(k.wide));
+        append<quint8>(out, quantize(k.round));
+    }
+    for (const auto &mark : timeline.wordMarks) {
+        append<quint32>(out, quint32(mark.first));
+        append<quint32>(out, quint32(mark.second));
+    }
+    return out;
+}
+
+bool decode(const QByteArray &data, VisemeTimeline *timeline, QByteArray *audioHash)
+{
+    const char *p = data.constData();
+    const qsizetype size = data.size();
+    qsizetype pos = sizeof(MAGIC) + 2;
+    if (size < pos || std::memcmp(p, MAGIC, sizeof(MAGIC)) != 0 || quint8(p[4]) != VERSION)
+        return false;
+    const int hashLen = quint8(p[5]);
+    if (size < pos + hashLen + 12)
+        return false;
+    const QByteArray hash(p + pos, hashLen);
+    pos += hashLen;
+    const quint32 durationMs = read<quint32>(p + pos);
+    const quint32 keyCount = read<quint32>(p + pos + 4);
+    const quint32 markCount = read<quint32>(p + pos + 8);
+    pos += 12;
+    if (size != pos + qint64(keyCount) * KEY_BYTES + qint64(markCount) * MARK_BYTES)
+        return false;
+
+    VisemeTimeline tl;
+    tl.durationMs = durationMs;
+    tl.keys.reserve(keyCount);
+    qint64 ms = 0;
+    for (quint32 i = 0; i < keyCount; ++i, pos += KEY_BYTES) {
+        ms += read<quint16>(p + pos);
+        tl.keys.append({ms, quint8(p[pos + 2]) / 255.f, quint8(p[pos + 3]) / 255.f,
+                        quint8(p[pos + 4]) / 255.f});
+    }
+    tl.wordMarks.reserve(markCount);
+    for (quint32 i = 0; i < markCount; ++i, pos += MARK_BYTES)
+        tl.wordMarks.append({qsizetype(read<quint32>(p + pos)), qint64(read<quint32>(p + pos + 4))});
+
+    *timeline = std::move(tl);
+    if (audioHash)
+        *audioHash = hash;
+    return true;
+}
+
+bool lookup(const QString &audioPath, VisemeTimeline *timeline)
+{
+    const QByteArray hash = fileHash(audioPath);
+    if (hash.isEmpty())
+        return false;
+
+    State &s = state();
+    {
+        QMutexLocker lock(&s.mutex);
+        const auto it = s.timelines.constFind(hash);
+        if (it != s.timelines.constEnd()) {
+            *timeline = *it;
+            return true;
+        }
+    }
+
+    VisemeTimeline tl;
+    QByteArray sidecarHash;
+    if (!decode(readFile(sidecarPath(audioPath)), &tl, &sidecarHash) || sidecarHash != hash)
+        return false;
+
+    QMutexLocker lock(&s.mutex);
+    s.timelines.insert(hash, tl);
+    *timeline = std::move(tl);
+    return true;
+}
+
+void insert(const QString &audioPath, const VisemeTimeline &timeline)
+{
+    const QByteArray hash = fileHash(audioPath);
+    if (hash.isEmpty())
+        return;
+    State &s = state();
+    QMutexLocker lock(&s.mutex);
+    s.timelines.insert(hash, timeline);
+}
+
+bool sidecarUpToDate(const QString &audioPath)
+{
+    const QByteArray data = readFile(sidecarPath(audioPath));
+    VisemeTimeline tl;
+    QByteArray hash;
+    return decode(data, &tl, &hash) && hash == fileHash(audioPath);
+}
+
+bool writeSidecar(const QString &audioPath, const VisemeTimeline &timeline, QString *error)
+{
+    auto fail = [error](const QString &message) {
+        if (error)
+            *error = message;
+        return false;
+    };
+
+    const QByteArray hash = fileHash(audioPath);
+    if (hash.isEmpty())
+        return fail(QStringLiteral("cannot read %1").arg(audioPath));
+    const QByteArray data = encode(timeline, hash);
+    if (data.isEmpty())
+        return fail(QStringLiteral("timeline cannot be encoded"));
+
+    QSaveFile f(sidecarPath(audioPath));
+    if (!f.open(QIODevice::WriteOnly) || f.write(data) != data.size() || !f.commit())
+        return fail(f.errorString());
+
+    insert(audioPath, timeline);
+    return true;
+}
+
+void clear()
+{
+    State &s = state();
+    QMutexLocker lock(&s.mutex);
+    s.hashes.clear();
+    s.timelines.clear();
+}
+
+} // namespace VisemeCache
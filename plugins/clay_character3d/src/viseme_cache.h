@@ -0,0 +1,64 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// VisemeCache — precomputed viseme timelines for recorded speech, so
+// Speech::sayAudio() can start lip-sync at once instead of decoding the
+// clip first. Timelines are keyed by a hash of the audio file's content:
+// a line shipped twice under different names is analyzed once, and an
+// edited recording never picks up a stale timeline.
+//
+// Two levels: an in-process table filled by lookups and by Speech after
+// it analyzed a clip itself, and binary sidecars next to the audio
+// ("intro.wav" -> "intro.wav.visemes") written ahead of time by the
+// clay_visemes batch tool. Sidecars work from qrc too.
+//
+// Sidecar layout (little endian): "CLVS", u8 version, u8 hash length,
+// the hash, u32 duration ms, u32 key count, u32 word-mark count, then per
+// key u16 ms since the previous key and open/wide/round as u8 (x/255),
+// then per word mark u32 char offset and u32 ms. About 5 bytes per 33 ms
+// window, so a minute of dialogue takes under 10 KB.
+//
+// All functions are thread-safe.
+
+#ifndef CLAY_CHARACTER3D_VISEME_CACHE_H
+#define CLAY_CHARACTER3D_VISEME_CACHE_H
+
+#include "viseme_timeline.h"
+
+#include <QByteArray>
+#include <QString>
+
+namespace VisemeCache {
+
+// "<audioPath>.visemes".
+QString sidecarPath(const QString &audioPath);
+
+// SHA-1 of the file's content; empty if it cannot be read. Remembered
+// per path until the file's size or modification time changes.
+QByteArray fileHash(const QString &path);
+
+// Sidecar (de)serialization. encode() returns an empty array for
+// timelines it cannot represent (keys out of order or more than 65 s
+// apart); decode() rejects anything malformed or of another version.
+QByteArray encode(const VisemeTimeline &timeline, const QByteArray &audioHash);
+bool decode(const QByteArray &data, VisemeTimeline *timeline,
+            QByteArray *audioHash = nullptr);
+
+// Timeline for the audio at `audioPath`: from memory, else from a
+// sidecar whose hash matches the file (then kept in memory).
+bool lookup(const QString &audioPath, VisemeTimeline *timeline);
+
+// Remember a timeline for this file's content.
+void insert(const QString &audioPath, const VisemeTimeline &timeline);
+
+// Whether the sidecar exists and was made from the file as it is now.
+bool sidecarUpToDate(const QString &audioPath);
+
+bool writeSidecar(const QString &audioPath, const VisemeTimeline &timeline,
+                  QString *error = nullptr);
+
+// Forget all in-memory timelines and hashes (sidecars stay).
+void clear();
+
+} // namespace VisemeCache
+
+#endif // CLAY_CHARACTER3D_VISEME_CACHE_H
@@ -0,0 +1,32 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// VisemeTimeline — the mouth-shape track Speech plays back. Built from
+// text (Speech::timelineForText), from recorded audio (VisemeAnalyzer)
+// or loaded precomputed from a sidecar (VisemeCache).
+
+#ifndef CLAY_CHARACTER3D_VISEME_TIMELINE_H
+#define CLAY_CHARACTER3D_VISEME_TIMELINE_H
+
+#include <QPair>
+#include <QVector>
+#include <QtGlobal>
+
+// One step on the mouth-shape timeline; values are targets in [0,1].
+struct VisemeKey
+{
+    qint64 ms = 0;
+    float  open = 0.f;
+    float  wide = 0.f;
+    float  round = 0.f;
+};
+
+// Timeline plus the mapping from character offsets in the source text to
+// timeline positions (used to re-sync on TTS word callbacks).
+struct VisemeTimeline
+{
+    QVector<VisemeKey> keys;
+    QVector<QPair<qsizetype, qint64>> wordMarks; // (char offset, ms)
+    qint64 durationMs = 0;
+};
+
+#endif // CLAY_CHARACTER3D_VISEME_TIMELINE_H
@@ -1,10 +1,15 @@
 // (c) Clayground Contributors - MIT License, see "LICENSE" file
 //
 // Unit tests for Speech::timelineForText - the pure text -> viseme
-// timeline builder used for lip-sync.
+// timeline builder used for lip-sync - and for the audio side's
+// VisemeAnalyzer and VisemeCache sidecars.
 
 #include <QtTest>
 #include "speech.h"
+#include "viseme_analyzer.h"
+#include "viseme_cache.h"
+
+#include <cmath>
 
 class TestSpeechTimeline : public QObject
 {
@@ -19,6 +24,10 @@ private slots:
     void punctuationAddsPauses();
     void wordMarksMatchWordStarts();
     void paceScaleStretchesTimeline();
+    void sidecarRoundTrip();
+    void sidecarRejectsMalformedData();
+    void analyzerFollowsLoudness();
+    void cacheIsKeyedByContent();
 };
 
 void TestSpeechTimeline::emptyTextYieldsClosedMouth()
@@ -96,5 +105,121 @@ void TestSpeechTimeline::paceScaleStretchesTimeline()
     QVERIFY(slow.durationMs > fast.durationMs);
 }
 
+void TestSpeechTimeline::sidecarRoundTrip()
+{
+    const VisemeTimeline tl = Speech::timelineForText("Hello there, friend!");
+    const QByteArray hash = QByteArray(20, 'x');
+    const QByteArray data = VisemeCache::encode(tl, hash);
+    QVERIFY(!data.isEmpty());
+    QVERIFY(data.size() < 40 + tl.keys.size() * 5 + tl.wordMarks.size() * 8);
+
+    VisemeTimeline back;
+    QByteArray backHash;
+    QVERIFY(VisemeCache::decode(data, &back, &backHash));
+    QCOMPARE(backHash, hash);
+    QCOMPARE(back.durationMs, tl.durationMs);
+    QCOMPARE(back.keys.size(), tl.keys.size());
+    for (qsizetype i = 0; i < tl.keys.size(); ++i) {
+        QCOMPARE(back.keys.at(i).ms, tl.keys.at(i).ms);
+        // Shapes are stored as bytes.
+        QVERIFY(qAbs(back.keys.at(i).open - tl.keys.at(i).open) <= 0.5f / 255.f);
+        QVERIFY(qAbs(back.keys.at(i).wide - tl.keys.at(i).wide) <= 0.5f / 255.f);
+        QVERIFY(qAbs(back.keys.at(i).round - tl.keys.at(i).round) <= 0.5f / 255.f);
+    }
+    QCOMPARE(back.wordMarks, tl.wordMarks);
+
+    // Keys further apart than a u16 of milliseconds cannot be stored.
+    VisemeTimeline gap;
+    gap.keys = {{0, 0.5f, 0.f, 0.f}, {70000, 0.f, 0.f, 0.f}};
+    QVERIFY(VisemeCache::encode(gap, hash).isEmpty());
+}
+
+void TestSpeechTimeline::sidecarRejectsMalformedData()
+{
+    const QByteArray data =
+        VisemeCache::encode(Speech::timelineForText("ha ha"), QByteArray(20, 'x'));
+    VisemeTimeline tl;
+    QVERIFY(VisemeCache::decode(data, &tl));
+
+    QVERIFY(!VisemeCache::decode(QByteArray(), &tl));
+    QVERIFY(!VisemeCache::decode(data.left(data.size() - 1), &tl));
+    QVERIFY(!VisemeCache::decode(data + '\0', &tl));
+
+    QByteArray badMagic = data;
+    badMagic[0] = 'X';
+    QVERIFY(!VisemeCache::decode(badMagic, &tl));
+
+    QByteArray newerVersion = data;
+    newerVersion[4] = char(2);
+    QVERIFY(!VisemeCache::decode(newerVersion, &tl));
+}
+
+void TestSpeechTimeline::analyzerFollowsLoudness()
+{
+    // 0.33 s of silence, then 0.33 s of a 200 Hz tone.
+    constexpr int rate = 48000;
+    QVector<float> samples(rate * 2 / 3, 0.f);
+    for (int i = rate / 3; i < samples.size(); ++i)
+        samples[i] = 0.5f * std::sin(2.0 * M_PI * 200.0 * i / rate);
+
+    VisemeAnalyzer analyzer;
+    // Fed in odd-sized chunks: windows carry over between buffers.
+    for (int i = 0; i < samples.size(); i += 1000)
+        analyzer.addSamples(samples.constData() + i, qMin(1000, int(samples.size()) - i), rate);
+
+    VisemeTimeline tl;
+    QVERIFY(analyzer.finish(&tl));
+    QCOMPARE(tl.keys.size(), qsizetype(samples.size() / (rate * VisemeAnalyzer::kWindowMs / 1000)));
+    QCOMPARE(tl.durationMs, qint64(tl.keys.size()) * VisemeAnalyzer::kWindowMs);
+    QCOMPARE(tl.keys.at(2).open, 0.f);
+    QVERIFY(tl.keys.last().open > 0.5f);
+    QVERIFY(tl.keys.last().wide < 0.1f); // a low tone is not sibilant
+
+    VisemeAnalyzer silent;
+    const QVector<float> zeros(rate / 2, 0.f);
+    silent.addSamples(zeros.constData(), int(zeros.size()), rate);
+    QVERIFY(!silent.finish(&tl));
+}
+
+void TestSpeechTimeline::cacheIsKeyedByContent()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    auto writeFile = [](const QString &path, const QByteArray &data) {
+        QFile f(path);
+        return f.open(QIODevice::WriteOnly) && f.write(data) == data.size();
+    };
+    // The cache only hashes the audio; it need not decode.
+    const QString line = dir.filePath("line.wav");
+    const QString copy = dir.filePath("copy.wav");
+    QVERIFY(writeFile(line, "RIFF one recording"));
+    QVERIFY(writeFile(copy, "RIFF one recording"));
+
+    VisemeCache::clear();
+    const VisemeTimeline tl = Speech::timelineForText("oh");
+    VisemeTimeline out;
+    QVERIFY(!VisemeCache::lookup(line, &out));
+    QVERIFY(!VisemeCache::sidecarUpToDate(line));
+
+    QVERIFY(VisemeCache::writeSidecar(line, tl));
+    QVERIFY(QFile::exists(VisemeCache::sidecarPath(line)));
+    QVERIFY(VisemeCache::sidecarUpToDate(line));
+
+    // Same content under another name: served from memory.
+    QVERIFY(VisemeCache::lookup(copy, &out));
+    QCOMPARE(out.keys.size(), tl.keys.size());
+
+    // Fresh process: the sidecar alone is enough.
+    VisemeCache::clear();
+    QVERIFY(VisemeCache::lookup(line, &out));
+    QCOMPARE(out.durationMs, tl.durationMs);
+
+    // A re-recorded line no longer matches its sidecar.
+    VisemeCache::clear();
+    QVERIFY(writeFile(line, "RIFF another recording"));
+    QVERIFY(!VisemeCache::sidecarUpToDate(line));
+    QVERIFY(!VisemeCache::lookup(line, &out));
+}
+
 QTEST_GUILESS_MAIN(TestSpeechTimeline)
 #include "tst_speech_timeline.moc"
@@ -183,6 +183,49 @@ Item {
     */
     property int connectionTimeout: 15000
 
+    /*!
+        \qmlproperty var Network::stateSchema
+        \brief Optional layout of broadcastState() data for delta compression.
+
+        A list of fields in a fixed order, each with a \c name, a \c type
+        (\c "float", \c "int", \c "bool" or \c "string") and for numbers
+        an optional \c min / \c max range; ranged floats are quantized to
+        \c bits (default 16). Peers that registered the same schema then
+        send only the fields that changed since the receiver's last
+        acknowledged state, bit-packed, with a full keyframe every second;
+        keys not in the schema are sent unchanged with every update.
+
+        \qml
+        stateSchema: [
+            { name: "x", type: "float", min: 0, max: 4096, bits: 16 },
+            { name: "y", type: "float", min: 0, max: 4096, bits: 16 },
+            { name: "angle", type: "float", min: -180, max: 180, bits: 10 },
+            { name: "hp", type: "int", min: 0, max: 100 },
+            { name: "anim", type: "string" }
+        ]
+        \endqml
+
+        Received values come back quantized (e.g. x in steps of 4096/65535).
+        Set it on every node, ideally before host() or join(); peers with
+        another or no schema (and browser builds) keep getting full state.
+    */
+    property var stateSchema: []
+
+    /*!
+        \qmlproperty bool Network::batching
+        \brief Coalesce outgoing messages per tick instead of sending each at once.
+
+        When enabled, everything sent until control returns to the event
+        loop - typically one frame or one Timer tick - is queued per peer
+        and channel and then goes out as few datagrams as possible, each
+        small enough for a single packet. Of several broadcastState() calls
+        (or relayed states from the same node) only the newest is sent.
+        Call flush() to send early. Pings are never delayed. Only used
+        between desktop/mobile peers; see \c msgsPerPacket in \l peerStats.
+        Default: false.
+    */
+    property bool batching: false
+
     // ========== Read-only State ==========
 
     /*!
@@ -266,10 +309,17 @@ Item {
         \brief Per-peer transport statistics, always on.
 
         Format: { nodeId: { latency, msgSent, msgRecv, bytesSent, bytesRecv,
-        stateSent, stateRecv, stateChannel, stateBacklog } }.
+        stateSent, stateRecv, stateChannel, stateBacklog, wire, packetsSent,
+        packetsRecv, msgsPerPacket, coalesced, batched } }.
         \c stateChannel is \c "unreliable" once the lossy state channel is
         negotiated and \c "fallback" while state still travels over the
-        reliable channel.
+        reliable channel. \c wire is \c "binary" once both ends agreed on
+        the compact binary encoding and \c "json" otherwise (browser peers,
+        older builds). \c msgsPerPacket is the average number of messages
+        per sent datagram and \c coalesced counts states replaced by a newer
+        one before sending (see \l batching); \c batched tells whether
+        sends to the peer are currently batched. Not reported by the browser
+        backend.
     */
     readonly property var peerStats: _backend ? _backend.peerStats : ({})
 
@@ -279,9 +329,13 @@ Item {
 
         Unlike \l peerStats this also covers nodes whose state arrives
         relayed through the host. Format:
-        { nodeId: { seq, recv, dropped, ageMs } } - \c dropped counts stale
-        updates discarded by sequence checks, \c ageMs is the time since the
-        newest accepted state.
+        { nodeId: { seq, recv, dropped, ageMs, bytesPerState, baselineHitRate,
+        baselineMisses } } - \c dropped counts stale updates discarded by
+        sequence checks, \c ageMs is the time since the newest accepted
+        state. \c bytesPerState is the average wire size of accepted
+        states; with a \l stateSchema, \c baselineHitRate is the share of
+        them that arrived as deltas and \c baselineMisses counts deltas
+        dropped because their baseline was lost (desktop/mobile only).
     */
     readonly property var syncStats: _backend ? _backend.syncStats : ({})
 
@@ -438,6 +492,19 @@ Item {
         }
     }
 
+    /*!
+        \qmlmethod void Network::flush()
+        \brief Send messages queued by \l batching right away.
+
+        Useful at the end of a game tick that is followed by slow work in
+        the same event loop pass. Does nothing without batching.
+    */
+    function flush() {
+        if (_backend) {
+            _backend.flush()
+        }
+    }
+
     /*!
         \qmlmethod int Network::stateAgeMs(string nodeId)
         \brief Milliseconds since the newest accepted state from \a nodeId,
@@ -477,6 +544,8 @@ Item {
     ClayNetworkBackend {
         id: _backend
         verbose: root.verbose
+        stateSchema: root.stateSchema
+        batching: root.batching
 
         onRoomCreated: (roomId) => root.networkCreated(roomId)
         onPlayerJoined: (playerId) => root.nodeJoined(playerId)
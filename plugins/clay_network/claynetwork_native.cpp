@@ -4,15 +4,38 @@
 #include "signaling_peerjs.h"
 #include "signaling_local.h"
 #include <rtc/rtc.hpp>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
 #include <QUuid>
 #include <QDebug>
 #include <QRandomGenerator>
 #include <QNetworkInterface>
 #include <QDateTime>
-#include <cstring>
+#include <QTimer>
+
+namespace {
+
+// Schema-compressed state: a keyframe at least this often per receiver,
+// so one that lost its baselines recovers...
+constexpr qint64 kStateKeyframeMs = 1000;
+// ...and acknowledgements of deltas at most this often (keyframes are
+// always acknowledged, so senders can start sending deltas right away).
+constexpr qint64 kStateAckMs = 50;
+
+// A batched datagram's messages, decoded on the channel's thread.
+struct Received
+{
+    WireEnvelope env;
+    qsizetype size = 0;     // wire size of this message alone
+};
+
+WireMessage systemMessage(const QVariantMap &fields)
+{
+    WireEnvelope env;
+    env.type = 'y';
+    env.payload = fields;
+    return WireMessage(std::move(env));
+}
+
+} // namespace
 
 ClayNetwork::ClayNetwork(QObject *parent)
     : QObject(parent)
@@ -113,6 +136,13 @@ QVariantMap ClayNetwork::peerStats() const {
         ps["stateSent"] = it->stateSent;
         ps["stateRecv"] = it->stateRecv;
         ps["stateChannel"] = it->stateReady ? "unreliable" : "fallback";
+        ps["wire"] = it->binaryWire ? "binary" : "json";
+        ps["packetsSent"] = it->packetsSent;
+        ps["packetsRecv"] = it->packetsRecv;
+        ps["msgsPerPacket"] = it->packetsSent > 0
+            ? double(it->msgSent + it->stateSent) / it->packetsSent : 0.0;
+        ps["coalesced"] = it->coalesced;
+        ps["batched"] = batching_ && it->batchWire;
         ps["stateBacklog"] = it->dcState && it->dcState->isOpen()
             ? static_cast<qint64>(it->dcState->bufferedAmount()) : 0;
         stats[it.key()] = ps;
@@ -130,11 +160,45 @@ QVariantMap ClayNetwork::syncStats() const {
         ss["recv"] = stateRecvCount_.value(it.key(), 0);
         ss["dropped"] = stateDropCount_.value(it.key(), 0);
         ss["ageMs"] = static_cast<qint64>(now - it.value());
+        // Wire cost and delta compression (schema-compressed state only)
+        const qint64 recv = stateRecvCount_.value(it.key(), 0);
+        ss["bytesPerState"] = recv > 0 ? double(stateBytesIn_.value(it.key(), 0)) / recv : 0.0;
+        ss["baselineHitRate"] = recv > 0 ? double(stateDeltaCount_.value(it.key(), 0)) / recv : 0.0;
+        ss["baselineMisses"] = stateBaselineMiss_.value(it.key(), 0);
         stats[it.key()] = ss;
     }
     return stats;
 }
 
+QVariantList ClayNetwork::stateSchema() const { return stateSchemaSpec_; }
+void ClayNetwork::setStateSchema(const QVariantList &schema) {
+    if (stateSchemaSpec_ == schema)
+        return;
+    stateSchemaSpec_ = schema;
+    QString error;
+    stateSchema_ = StateSchema::fromVariant(schema, &error);
+    if (!error.isEmpty())
+        qWarning() << "ClayNetwork:" << error;
+
+    // Baselines quantized with the old schema are meaningless now
+    for (auto it = peers_.begin(); it != peers_.end(); ++it) {
+        it->deltaOut.clear();
+        it->deltaIn.clear();
+        announceSchema(it.key());
+    }
+    emit stateSchemaChanged();
+}
+
+bool ClayNetwork::batching() const { return batching_; }
+void ClayNetwork::setBatching(bool batching) {
+    if (batching_ != batching) {
+        batching_ = batching;
+        if (!batching_)
+            flush();
+        emit batchingChanged();
+    }
+}
+
 int ClayNetwork::stateAgeMs(const QString &nodeId) const {
     if (!stateLastMs_.contains(nodeId))
         return -1;
@@ -294,6 +358,9 @@ void ClayNetwork::leave()
     stateLastMs_.clear();
     stateRecvCount_.clear();
     stateDropCount_.clear();
+    stateBytesIn_.clear();
+    stateDeltaCount_.clear();
+    stateBaselineMiss_.clear();
 
     emit networkIdChanged();
     emit nodeIdChanged();
@@ -310,26 +377,38 @@ void ClayNetwork::leave()
 
 void ClayNetwork::broadcast(const QVariant &data)
 {
-    QJsonObject msg;
-    msg["t"] = "m";  // message
-    msg["d"] = QJsonObject::fromVariantMap(data.toMap());
-    QString json = QString::fromUtf8(QJsonDocument(msg).toJson(QJsonDocument::Compact));
+    WireEnvelope env;
+    env.type = 'm';  // message
+    env.payload = data.toMap();
+    const WireMessage msg(std::move(env));
 
-    for (const QString &peerId : peers_.keys()) {
-        sendToPeer(peerId, json);
+    for (auto it = peers_.constBegin(); it != peers_.constEnd(); ++it) {
+        sendToPeer(it.key(), msg);
     }
 }
 
 void ClayNetwork::broadcastState(const QVariant &data)
 {
-    QJsonObject msg;
-    msg["t"] = "s";  // state
-    msg["q"] = static_cast<qint64>(++stateSeqOut_);
-    msg["d"] = QJsonObject::fromVariantMap(data.toMap());
-    QString json = QString::fromUtf8(QJsonDocument(msg).toJson(QJsonDocument::Compact));
-
-    for (const QString &peerId : peers_.keys()) {
-        sendStateToPeer(peerId, json);
+    WireEnvelope env;
+    env.type = 's';  // state
+    env.hasSeq = true;
+    env.seq = ++stateSeqOut_;
+    env.payload = data.toMap();
+    const WireMessage msg(std::move(env));
+
+    // Peers sharing our state schema get deltas, everyone else full state
+    StateSchema::Snapshot snapshot;
+    bool quantized = false;
+    for (auto it = peers_.constBegin(); it != peers_.constEnd(); ++it) {
+        if (deltaCapable(*it)) {
+            if (!quantized) {
+                snapshot = stateSchema_.quantize(msg.envelope().payload);
+                quantized = true;
+            }
+            sendDeltaState(it.key(), QString(), stateSeqOut_, snapshot);
+        } else {
+            sendStateToPeer(it.key(), msg);
+        }
     }
 }
 
@@ -340,11 +419,10 @@ void ClayNetwork::sendTo(const QString &nodeId, const QVariant &data)
         return;
     }
 
-    QJsonObject msg;
-    msg["t"] = "m";
-    msg["d"] = QJsonObject::fromVariantMap(data.toMap());
-    QString json = QString::fromUtf8(QJsonDocument(msg).toJson(QJsonDocument::Compact));
-    sendToPeer(nodeId, json);
+    WireEnvelope env;
+    env.type = 'm';
+    env.payload = data.toMap();
+    sendToPeer(nodeId, WireMessage(std::move(env)));
 }
 
 void ClayNetwork::onSignalingConnected(const QString &peerId)
@@ -499,11 +577,7 @@ void ClayNetwork::setupPeerConnection(const QString &peerId, bool isOfferer)
                     emit nodesChanged();
                     emit playerLeft(peerId);
                     if (isHost_ && topology_ == Star) {
-                        QJsonObject left;
-                        left["t"] = "y";
-                        left["sys"] = "node_left";
-                        left["nodeId"] = peerId;
-                        hostBroadcastSystem(left);
+                        hostBroadcastSystem({{"sys", "node_left"}, {"nodeId", peerId}});
                     }
                 }
             }
@@ -600,16 +674,21 @@ void ClayNetwork::setupDataChannel(const QString &peerId, std::shared_ptr<rtc::D
                 emit nodesChanged();
                 emit playerJoined(peerId);
 
+                // Offer the binary envelope and batches of it; PeerJS
+                // peers ignore this and keep getting JSON.
+                sendToPeer(peerId, systemMessage({
+                    {"sys", "wire"},
+                    {"formats", QStringList{WireFormat::kBinaryName,
+                                            WireFormat::kBatchName}}}));
+                if (!stateSchema_.isEmpty())
+                    announceSchema(peerId);
+
                 // Star topology: the host owns the roster - tell the new
                 // node about everyone and everyone about the new node, so
                 // joiners can see each other despite only connecting to us.
                 if (isHost_ && topology_ == Star) {
                     sendRosterTo(peerId);
-                    QJsonObject joined;
-                    joined["t"] = "y";
-                    joined["sys"] = "node_joined";
-                    joined["nodeId"] = peerId;
-                    hostBroadcastSystem(joined, peerId);
+                    hostBroadcastSystem({{"sys", "node_joined"}, {"nodeId", peerId}}, peerId);
                 }
 
                 if (!isHost_ && !connected_) {
@@ -635,12 +714,13 @@ void ClayNetwork::setupDataChannel(const QString &peerId, std::shared_ptr<rtc::D
 
     dc->onMessage([this, peerId](auto message) {
         if (std::holds_alternative<std::string>(message)) {
-            handleDataChannelMessage(peerId, std::get<std::string>(message));
+            const auto& str = std::get<std::string>(message);
+            handleDataChannelMessage(peerId, str.data(), str.size());
         } else if (std::holds_alternative<rtc::binary>(message)) {
-            // Handle binary messages (from PeerJS JSON mode)
+            // Binary frames: PeerJS JSON mode text or our binary envelope
             const auto& bytes = std::get<rtc::binary>(message);
-            std::string str(reinterpret_cast<const char*>(bytes.data()), bytes.size());
-            handleDataChannelMessage(peerId, str);
+            handleDataChannelMessage(peerId, reinterpret_cast<const char*>(bytes.data()),
+                                     bytes.size());
         }
     });
 
@@ -666,11 +746,12 @@ void ClayNetwork::setupStateChannel(const QString &peerId, std::shared_ptr<rtc::
 
     dc->onMessage([this, peerId](auto message) {
         if (std::holds_alternative<std::string>(message)) {
-            handleDataChannelMessage(peerId, std::get<std::string>(message));
+            const auto& str = std::get<std::string>(message);
+            handleDataChannelMessage(peerId, str.data(), str.size());
         } else if (std::holds_alternative<rtc::binary>(message)) {
             const auto& bytes = std::get<rtc::binary>(message);
-            std::string str(reinterpret_cast<const char*>(bytes.data()), bytes.size());
-            handleDataChannelMessage(peerId, str);
+            handleDataChannelMessage(peerId, reinterpret_cast<const char*>(bytes.data()),
+                                     bytes.size());
         }
     });
 
@@ -682,165 +763,388 @@ void ClayNetwork::setupStateChannel(const QString &peerId, std::shared_ptr<rtc::
     });
 }
 
-void ClayNetwork::sendToPeer(const QString &peerId, const QString &message)
+void ClayNetwork::sendToPeer(const QString &peerId, const WireMessage &message)
 {
-    if (peers_.contains(peerId) && peers_[peerId].dc && peers_[peerId].dc->isOpen()) {
-        // Send as binary (bytes) for PeerJS JSON mode compatibility
-        QByteArray utf8 = message.toUtf8();
-        std::vector<std::byte> bytes(utf8.size());
-        std::memcpy(bytes.data(), utf8.constData(), utf8.size());
-        peers_[peerId].dc->send(bytes);
-
-        peers_[peerId].msgSent++;
-        peers_[peerId].bytesSent += utf8.size();
+    auto it = peers_.find(peerId);
+    if (it != peers_.end() && it->dc && it->dc->isOpen()) {
+        if (batched(*it, message))
+            enqueue(*it, it->outbox, message, false);
+        else
+            transmit(*it, false, message.bytes(it->binaryWire ? WireFormat::Binary
+                                                              : WireFormat::Json), 1);
     }
 }
 
-void ClayNetwork::sendStateToPeer(const QString &peerId, const QString &message)
+void ClayNetwork::sendStateToPeer(const QString &peerId, const WireMessage &message)
 {
-    if (!peers_.contains(peerId))
+    auto it = peers_.find(peerId);
+    if (it == peers_.end())
         return;
-    PeerConn &peer = peers_[peerId];
+    PeerConn &peer = *it;
     // Prefer the lossy state channel; fall back to the reliable one while the
     // state channel is still negotiating (or when a peer doesn't offer one).
     if (peer.stateReady && peer.dcState && peer.dcState->isOpen()) {
-        QByteArray utf8 = message.toUtf8();
-        std::vector<std::byte> bytes(utf8.size());
-        std::memcpy(bytes.data(), utf8.constData(), utf8.size());
-        peer.dcState->send(bytes);
-        peer.stateSent++;
-        peer.bytesSent += utf8.size();
+        if (batched(peer, message)) {
+            // Per origin only the newest state of a tick is worth sending
+            const char type = message.envelope().type;
+            enqueue(peer, peer.stateOutbox, message, type == 's' || type == 'd');
+        } else {
+            transmit(peer, true, message.bytes(peer.binaryWire ? WireFormat::Binary
+                                                               : WireFormat::Json), 1);
+        }
     } else {
         sendToPeer(peerId, message);
     }
 }
 
-void ClayNetwork::handleDataChannelMessage(const QString &fromId, const std::string &message)
+bool ClayNetwork::batched(const PeerConn &peer, const WireMessage &message) const
 {
-    QMetaObject::invokeMethod(this, [this, fromId, message]() {
-        if (peers_.contains(fromId)) {
-            peers_[fromId].msgRecv++;
-            peers_[fromId].bytesRecv += message.size();
-        }
+    // Pings skip the queue, so latency keeps measuring the network alone
+    const char type = message.envelope().type;
+    return batching_ && peer.batchWire && type != 'p' && type != 'P';
+}
 
-        QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromStdString(message));
-        if (!doc.isObject()) {
+void ClayNetwork::enqueue(PeerConn &peer, Outbox &box, const WireMessage &message, bool coalesce)
+{
+    const QByteArray &bytes = message.bytes(WireFormat::Binary);
+    if (coalesce) {
+        const WireEnvelope &env = message.envelope();
+        const bool keyframe = env.type == 'd' && env.baseline == 0;
+        auto at = box.stateAt.find(env.from);
+        // A queued keyframe stays: it resyncs the peer, and the next one is
+        // a whole keyframe interval away. Later states queue behind it.
+        if (at != box.stateAt.end() && !at->keyframe) {
+            box.messages[at->index] = bytes;
+            at->keyframe = keyframe;
+            peer.coalesced++;
             return;
         }
+        box.stateAt.insert(env.from, {box.messages.size(), keyframe});
+    }
+    box.messages.append(bytes);
+
+    // Everything sent until control returns to the event loop (one frame,
+    // one timer tick) shares the flush
+    if (!flushPending_) {
+        flushPending_ = true;
+        QTimer::singleShot(0, this, &ClayNetwork::flush);
+    }
+}
+
+void ClayNetwork::flush()
+{
+    flushPending_ = false;
+    for (auto it = peers_.begin(); it != peers_.end(); ++it) {
+        flushOutbox(*it, it->outbox, false);
+        flushOutbox(*it, it->stateOutbox, true);
+    }
+}
+
+void ClayNetwork::flushOutbox(PeerConn &peer, Outbox &box, bool stateChannel)
+{
+    if (box.messages.isEmpty())
+        return;
+    // States fall back to the reliable channel when the state channel went
+    // away since they were queued, as in sendStateToPeer()
+    const bool onState = stateChannel && peer.stateReady && peer.dcState
+                         && peer.dcState->isOpen();
+    const auto &dc = onState ? peer.dcState : peer.dc;
+    if (dc && dc->isOpen()) {
+        for (const WireFormat::Datagram &datagram : WireFormat::packBatches(box.messages))
+            transmit(peer, onState, datagram.bytes, datagram.messages);
+    }
+    box.messages.clear();
+    box.stateAt.clear();
+}
+
+void ClayNetwork::transmit(PeerConn &peer, bool stateChannel, const QByteArray &bytes, int messages)
+{
+    // Always sent as binary frames: PeerJS JSON mode expects its text
+    // that way, and the binary envelope is bytes anyway.
+    const auto &dc = stateChannel ? peer.dcState : peer.dc;
+    dc->send(reinterpret_cast<const std::byte*>(bytes.constData()),
+             static_cast<size_t>(bytes.size()));
+    (stateChannel ? peer.stateSent : peer.msgSent) += messages;
+    peer.bytesSent += bytes.size();
+    peer.packetsSent++;
+}
+
+bool ClayNetwork::deltaCapable(const PeerConn &peer) const
+{
+    return peer.binaryWire && !stateSchema_.isEmpty()
+        && peer.schemaHash == stateSchema_.hash();
+}
+
+void ClayNetwork::sendDeltaState(const QString &peerId, const QString &origin, quint32 seq,
+                                 const StateSchema::Snapshot &snapshot)
+{
+    auto it = peers_.find(peerId);
+    if (it == peers_.end())
+        return;
+    DeltaOut &out = it->deltaOut[origin];
+    const qint64 now = clock_.elapsed();
+
+    // Relative to the newest state the peer acknowledged, while it is
+    // still in the history and no keyframe is due
+    const StateSchema::Snapshot *baseline = nullptr;
+    if (out.keyframeMs >= 0 && now - out.keyframeMs < kStateKeyframeMs)
+        baseline = out.sent.find(out.acked);
+    if (!baseline)
+        out.keyframeMs = now;
+
+    WireEnvelope env;
+    env.type = 'd';
+    env.hasSeq = true;
+    env.seq = seq;
+    env.from = origin;
+    env.baseline = baseline ? out.acked : 0;
+    env.packed = stateSchema_.pack(snapshot, baseline);
+    env.payload = snapshot.extra;
+    out.sent.put(seq, snapshot);
+    sendStateToPeer(peerId, WireMessage(std::move(env)));
+}
 
-        QJsonObject obj = doc.object();
-        QString type = obj["t"].toString();
-
-        // Handle ping/pong (not relayed)
-        if (type == "p") {
-            // Respond with pong, echo timestamp
-            QJsonObject pong;
-            pong["t"] = "P";
-            pong["ts"] = obj["ts"];
-            QString json = QString::fromUtf8(QJsonDocument(pong).toJson(QJsonDocument::Compact));
-            sendToPeer(fromId, json);
+void ClayNetwork::announceSchema(const QString &peerId)
+{
+    sendToPeer(peerId, systemMessage({
+        {"sys", "schema"},
+        {"hash", static_cast<qint64>(stateSchema_.hash())}}));
+}
+
+void ClayNetwork::handleDataChannelMessage(const QString &fromId, const char *data, size_t size)
+{
+    // Decode on the channel's thread; only dispatch runs on ours.
+    QVector<Received> received;
+    const auto bytes = static_cast<qsizetype>(size);
+    if (WireFormat::isBatch(data, bytes)) {
+        QVector<QByteArrayView> messages;
+        if (!WireFormat::splitBatch(data, bytes, messages))
             return;
+        for (QByteArrayView message : messages) {
+            Received r;
+            r.size = message.size();
+            if (WireFormat::decode(message.data(), r.size, r.env))
+                received.append(std::move(r));
         }
-        if (type == "P") {
-            // Pong received, calculate RTT
-            qint64 sentTs = obj["ts"].toDouble();
-            qint64 now = QDateTime::currentMSecsSinceEpoch();
-            int rtt = static_cast<int>(now - sentTs);
-            if (peers_.contains(fromId)) {
-                int prev = peers_[fromId].latency;
-                // Exponential moving average (70/30)
-                peers_[fromId].latency = (prev < 0) ? rtt : static_cast<int>(prev * 0.7 + rtt * 0.3);
-
-                // Update best latency across all peers
-                int best = -1;
-                for (auto it = peers_.constBegin(); it != peers_.constEnd(); ++it) {
-                    if (it->latency >= 0 && (best < 0 || it->latency < best))
-                        best = it->latency;
-                }
-                if (latency_ != best) {
-                    latency_ = best;
-                    emit latencyChanged();
-                }
-                emit peerStatsChanged();
-                emit syncStatsChanged();
-            }
-            return;
+    } else {
+        Received r;
+        r.size = bytes;
+        if (WireFormat::decode(data, bytes, r.env))
+            received.append(std::move(r));
+    }
+    if (received.isEmpty())
+        return;
+
+    QMetaObject::invokeMethod(this, [this, fromId, bytes, received = std::move(received)]() {
+        if (peers_.contains(fromId)) {
+            PeerConn &peer = peers_[fromId];
+            peer.msgRecv += received.size();
+            peer.bytesRecv += bytes;
+            peer.packetsRecv++;
         }
+        for (const Received &r : received)
+            dispatchEnvelope(fromId, r.env, r.size);
+    }, Qt::QueuedConnection);
+}
 
-        // Handle rejection from host
-        if (type == "R") {
-            QString reason = obj["r"].toString();
-            emit errorOccurred(reason.isEmpty() ? "Connection rejected" : reason);
-            return;
+void ClayNetwork::dispatchEnvelope(const QString &fromId, const WireEnvelope &env, qsizetype size)
+{
+    const char type = env.type;
+
+    // Handle ping/pong (not relayed)
+    if (type == 'p') {
+        // Respond with pong, echo timestamp
+        WireEnvelope pong;
+        pong.type = 'P';
+        pong.payload["ts"] = env.payload.value("ts");
+        sendToPeer(fromId, WireMessage(std::move(pong)));
+        return;
+    }
+    if (type == 'P') {
+        // Pong received, calculate RTT
+        qint64 sentTs = env.payload.value("ts").toDouble();
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        int rtt = static_cast<int>(now - sentTs);
+        if (peers_.contains(fromId)) {
+            int prev = peers_[fromId].latency;
+            // Exponential moving average (70/30)
+            peers_[fromId].latency = (prev < 0) ? rtt : static_cast<int>(prev * 0.7 + rtt * 0.3);
+
+            // Update best latency across all peers
+            int best = -1;
+            for (auto it = peers_.constBegin(); it != peers_.constEnd(); ++it) {
+                if (it->latency >= 0 && (best < 0 || it->latency < best))
+                    best = it->latency;
+            }
+            if (latency_ != best) {
+                latency_ = best;
+                emit latencyChanged();
+            }
+            emit peerStatsChanged();
+            emit syncStatsChanged();
         }
+        return;
+    }
 
-        // Roster updates from the host (Star topology)
-        if (type == "y") {
-            handleSystemMessage(obj);
-            return;
+    // Handle rejection from host
+    if (type == 'R') {
+        QString reason = env.payload.value("r").toString();
+        emit errorOccurred(reason.isEmpty() ? "Connection rejected" : reason);
+        return;
+    }
+
+    // Roster updates from the host (Star topology), wire negotiation
+    if (type == 'y') {
+        handleSystemMessage(fromId, env.payload);
+        return;
+    }
+
+    // A peer acknowledged schema-compressed state; newer baselines win
+    if (type == 'a') {
+        auto peer = peers_.find(fromId);
+        if (peer != peers_.end()) {
+            auto out = peer->deltaOut.find(env.from);
+            if (out != peer->deltaOut.end() && env.seq > out->acked)
+                out->acked = env.seq;
         }
+        return;
+    }
 
-        QJsonObject dataObj = obj["d"].toObject();
-        QVariant data = dataObj.toVariantMap();
+    // Determine actual sender: use "from" field if present (relayed), else connection peer
+    QString actualFromId = env.from.isEmpty() ? fromId : env.from;
+    const bool isState = type == 's' || type == 'd';
 
-        // Determine actual sender: use "from" field if present (relayed), else connection peer
-        QString actualFromId = obj.contains("from") ? obj["from"].toString() : fromId;
+    // State updates carry a per-sender sequence number; the state channel
+    // is unordered, so anything at or behind the newest accepted seq is
+    // stale and gets dropped instead of rewinding the entity.
+    if (isState && env.hasSeq && stateSeqIn_.contains(actualFromId)
+        && env.seq <= stateSeqIn_.value(actualFromId)) {
+        stateDropCount_[actualFromId]++;
+        return;
+    }
 
-        // State updates carry a per-sender sequence number; the state channel
-        // is unordered, so anything at or behind the newest accepted seq is
-        // stale and gets dropped instead of rewinding the entity.
-        if (type == "s" && obj.contains("q")) {
-            auto seq = static_cast<quint32>(obj["q"].toDouble());
-            if (stateSeqIn_.contains(actualFromId)
-                && seq <= stateSeqIn_.value(actualFromId)) {
-                stateDropCount_[actualFromId]++;
+    QVariantMap data = env.payload;
+    StateSchema::Snapshot snapshot;
+    bool haveSnapshot = false;
+    if (type == 'd') {
+        // Only decodable with the schema the sender announced
+        auto peer = peers_.find(fromId);
+        if (peer == peers_.end() || stateSchema_.isEmpty()
+            || peer->schemaHash != stateSchema_.hash())
+            return;
+        DeltaIn &in = peer->deltaIn[actualFromId];
+        const StateSchema::Snapshot *baseline = nullptr;
+        if (env.baseline != 0) {
+            baseline = in.received.find(env.baseline);
+            if (!baseline) {
+                stateBaselineMiss_[actualFromId]++;
                 return;
             }
-            stateSeqIn_[actualFromId] = seq;
         }
-        if (type == "s") {
-            stateRecvCount_[actualFromId]++;
-            stateLastMs_[actualFromId] = clock_.elapsed();
-            if (peers_.contains(fromId))
-                peers_[fromId].stateRecv++;
+        if (!stateSchema_.unpack(env.packed, baseline, snapshot))
+            return;
+        snapshot.extra = env.payload;
+        haveSnapshot = true;
+        if (baseline)
+            stateDeltaCount_[actualFromId]++;
+
+        const qint64 now = clock_.elapsed();
+        if (!baseline || in.ackMs < 0 || now - in.ackMs >= kStateAckMs) {
+            in.ackMs = now;
+            WireEnvelope ack;
+            ack.type = 'a';
+            ack.hasSeq = true;
+            ack.seq = env.seq;
+            ack.from = env.from;
+            sendStateToPeer(fromId, WireMessage(std::move(ack)));
         }
+        in.received.put(env.seq, snapshot);
+        data = stateSchema_.toVariantMap(snapshot);
+    }
 
-        // Host in Star topology: relay to other peers
-        if (isHost_ && autoRelay_ && topology_ == Star) {
-            // Add "from" field and relay to all OTHER peers; state goes over
-            // the lossy channel, messages stay reliable
-            obj["from"] = fromId;
-            QString relayJson = QString::fromUtf8(QJsonDocument(obj).toJson(QJsonDocument::Compact));
-            for (const QString &peerId : peers_.keys()) {
-                if (peerId != fromId) {
-                    if (type == "s")
-                        sendStateToPeer(peerId, relayJson);
-                    else
-                        sendToPeer(peerId, relayJson);
+    if (isState) {
+        if (env.hasSeq)
+            stateSeqIn_[actualFromId] = env.seq;
+        stateRecvCount_[actualFromId]++;
+        stateLastMs_[actualFromId] = clock_.elapsed();
+        stateBytesIn_[actualFromId] += size;
+        if (peers_.contains(fromId))
+            peers_[fromId].stateRecv++;
+    }
+
+    // Host in Star topology: relay to other peers
+    if (isHost_ && autoRelay_ && topology_ == Star) {
+        // Add "from" field and relay to all OTHER peers; state goes over
+        // the lossy channel, messages stay reliable. Each target gets
+        // the encoding it negotiated, state as deltas where possible.
+        WireEnvelope relayed = env;
+        relayed.type = isState ? 's' : type;
+        relayed.from = fromId;
+        relayed.payload = data;
+        relayed.baseline = 0;
+        relayed.packed.clear();
+        const WireMessage relay(std::move(relayed));
+        for (auto it = peers_.constBegin(); it != peers_.constEnd(); ++it) {
+            if (it.key() == fromId)
+                continue;
+            if (isState && env.hasSeq && deltaCapable(*it)) {
+                if (!haveSnapshot) {
+                    snapshot = stateSchema_.quantize(data);
+                    haveSnapshot = true;
                 }
+                sendDeltaState(it.key(), fromId, env.seq, snapshot);
+            } else if (isState) {
+                sendStateToPeer(it.key(), relay);
+            } else {
+                sendToPeer(it.key(), relay);
             }
         }
+    }
 
-        // Emit signal to application
-        if (type == "m") {
-            emit messageReceived(actualFromId, data);
-        } else if (type == "s") {
-            emit stateReceived(actualFromId, data);
-        }
-    }, Qt::QueuedConnection);
+    // Emit signal to application
+    if (type == 'm') {
+        emit messageReceived(actualFromId, data);
+    } else if (isState) {
+        emit stateReceived(actualFromId, data);
+    }
 }
 
-void ClayNetwork::handleSystemMessage(const QJsonObject &obj)
+void ClayNetwork::handleSystemMessage(const QString &fromId, const QVariantMap &msg)
 {
+    QString sys = msg.value("sys").toString();
+
+    // Per-connection negotiation, so hosts handle these too
+    if (sys == "schema") {
+        auto peer = peers_.find(fromId);
+        if (peer != peers_.end()) {
+            peer->schemaHash = static_cast<quint32>(msg.value("hash").toLongLong());
+            peer->deltaOut.clear();
+            peer->deltaIn.clear();
+        }
+        return;
+    }
+    if (sys == "wire") {
+        auto peer = peers_.find(fromId);
+        const QStringList formats = msg.value("formats").toStringList();
+        if (peer != peers_.end() && formats.contains(WireFormat::kBinaryName)
+            && !peer->binaryWire) {
+            peer->binaryWire = true;
+            peer->batchWire = formats.contains(WireFormat::kBatchName);
+            emitDiag("datachannel", QString("Binary wire format with %1%2")
+                                        .arg(fromId.left(8), peer->batchWire ? ", batched" : ""));
+            emit peerStatsChanged();
+        }
+        return;
+    }
+
     if (isHost_)
         return;  // The host is the roster authority; nothing to apply
 
-    QString sys = obj["sys"].toString();
     if (sys == "roster") {
         // Authoritative list of all OTHER joiners (host connection is
         // already in nodes_ via the data channel open)
         QStringList updated = nodes_;
-        for (const auto &v : obj["nodes"].toArray()) {
+        for (const auto &v : msg.value("nodes").toList()) {
             QString id = v.toString();
             if (id != nodeId_ && !updated.contains(id))
                 updated.append(id);
@@ -857,7 +1161,7 @@ void ClayNetwork::handleSystemMessage(const QJsonObject &obj)
                 emit playerJoined(id);
         }
     } else if (sys == "node_joined") {
-        QString id = obj["nodeId"].toString();
+        QString id = msg.value("nodeId").toString();
         if (!id.isEmpty() && id != nodeId_ && !nodes_.contains(id)) {
             nodes_.append(id);
             emit nodeCountChanged();
@@ -865,7 +1169,7 @@ void ClayNetwork::handleSystemMessage(const QJsonObject &obj)
             emit playerJoined(id);
         }
     } else if (sys == "node_left") {
-        QString id = obj["nodeId"].toString();
+        QString id = msg.value("nodeId").toString();
         if (nodes_.removeAll(id) > 0) {
             forgetSender(id);
             emit nodeCountChanged();
@@ -877,23 +1181,19 @@ void ClayNetwork::handleSystemMessage(const QJsonObject &obj)
 
 void ClayNetwork::sendRosterTo(const QString &peerId)
 {
-    QJsonObject msg;
-    msg["t"] = "y";
-    msg["sys"] = "roster";
-    QJsonArray arr;
+    QStringList others;
     for (const QString &id : nodes_)
         if (id != peerId)
-            arr.append(id);
-    msg["nodes"] = arr;
-    sendToPeer(peerId, QString::fromUtf8(QJsonDocument(msg).toJson(QJsonDocument::Compact)));
+            others.append(id);
+    sendToPeer(peerId, systemMessage({{"sys", "roster"}, {"nodes", others}}));
 }
 
-void ClayNetwork::hostBroadcastSystem(const QJsonObject &msg, const QString &exceptPeer)
+void ClayNetwork::hostBroadcastSystem(const QVariantMap &msg, const QString &exceptPeer)
 {
-    QString json = QString::fromUtf8(QJsonDocument(msg).toJson(QJsonDocument::Compact));
-    for (const QString &peerId : peers_.keys())
-        if (peerId != exceptPeer)
-            sendToPeer(peerId, json);
+    const WireMessage wire = systemMessage(msg);
+    for (auto it = peers_.constBegin(); it != peers_.constEnd(); ++it)
+        if (it.key() != exceptPeer)
+            sendToPeer(it.key(), wire);
 }
 
 void ClayNetwork::forgetSender(const QString &nodeId)
@@ -902,20 +1202,26 @@ void ClayNetwork::forgetSender(const QString &nodeId)
     stateLastMs_.remove(nodeId);
     stateRecvCount_.remove(nodeId);
     stateDropCount_.remove(nodeId);
+    stateBytesIn_.remove(nodeId);
+    stateDeltaCount_.remove(nodeId);
+    stateBaselineMiss_.remove(nodeId);
+    for (auto it = peers_.begin(); it != peers_.end(); ++it) {
+        it->deltaOut.remove(nodeId);
+        it->deltaIn.remove(nodeId);
+    }
 }
 
 void ClayNetwork::ping()
 {
     if (!connected_) return;
 
-    qint64 now = QDateTime::currentMSecsSinceEpoch();
-    QJsonObject msg;
-    msg["t"] = "p";
-    msg["ts"] = static_cast<double>(now);
-    QString json = QString::fromUtf8(QJsonDocument(msg).toJson(QJsonDocument::Compact));
+    WireEnvelope env;
+    env.type = 'p';
+    env.payload["ts"] = static_cast<double>(QDateTime::currentMSecsSinceEpoch());
+    const WireMessage msg(std::move(env));
 
-    for (const QString &peerId : peers_.keys()) {
-        sendToPeer(peerId, json);
+    for (auto it = peers_.constBegin(); it != peers_.constEnd(); ++it) {
+        sendToPeer(it.key(), msg);
     }
 }
 
@@ -1,6 +1,8 @@
 // (c) Clayground Contributors - MIT License, see "LICENSE" file
 #pragma once
 
+#include "state_schema.h"
+#include "wire_format.h"
 #include <QObject>
 #include <QString>
 #include <QVariant>
@@ -55,6 +57,8 @@ class ClayNetwork : public QObject
     Q_PROPERTY(int latency READ latency NOTIFY latencyChanged)
     Q_PROPERTY(QVariantMap peerStats READ peerStats NOTIFY peerStatsChanged)
     Q_PROPERTY(QVariantMap syncStats READ syncStats NOTIFY syncStatsChanged)
+    Q_PROPERTY(QVariantList stateSchema READ stateSchema WRITE setStateSchema NOTIFY stateSchemaChanged)
+    Q_PROPERTY(bool batching READ batching WRITE setBatching NOTIFY batchingChanged)
 
 public:
     enum Topology {
@@ -106,6 +110,10 @@ public:
     int latency() const;
     QVariantMap peerStats() const;
     QVariantMap syncStats() const;
+    QVariantList stateSchema() const;
+    void setStateSchema(const QVariantList &schema);
+    bool batching() const;
+    void setBatching(bool batching);
 
 public slots:
     void createRoom();
@@ -115,6 +123,7 @@ public slots:
     void broadcastState(const QVariant &data);
     void sendTo(const QString &nodeId, const QVariant &data);
     void ping();
+    void flush();
     int stateAgeMs(const QString &nodeId) const;
 
 signals:
@@ -145,6 +154,8 @@ signals:
     void latencyChanged();
     void peerStatsChanged();
     void syncStatsChanged();
+    void stateSchemaChanged();
+    void batchingChanged();
 
 private slots:
     void onSignalingConnected(const QString &peerId);
@@ -154,6 +165,28 @@ private slots:
     void onSignalingError(const QString &error);
 
 private:
+    // Schema-compressed state towards one peer, per origin node.
+    struct DeltaOut {
+        StateHistory sent;
+        quint32 acked = 0;          // newest state the peer acknowledged
+        qint64 keyframeMs = -1;
+    };
+    // ...and from one peer, per origin node.
+    struct DeltaIn {
+        StateHistory received;
+        qint64 ackMs = -1;
+    };
+
+    // Messages waiting for the next flush() towards one peer, per channel.
+    struct Outbox {
+        struct State {
+            qsizetype index = 0;            // into messages
+            bool keyframe = false;          // never coalesced away
+        };
+        QVector<QByteArray> messages;       // encoded, in send order
+        QHash<QString, State> stateAt;      // origin -> its newest state
+    };
+
     struct PeerConn {
         std::shared_ptr<rtc::PeerConnection> pc;
         std::shared_ptr<rtc::DataChannel> dc;
@@ -163,6 +196,18 @@ private:
         QString connectionId;  // PeerJS connection ID (for ANSWER matching)
         bool ready = false;
         bool stateReady = false;
+        // Both ends announced the binary envelope (see wire_format.h);
+        // until then, and for PeerJS peers always, messages go as JSON.
+        bool binaryWire = false;
+        // ...and accepts batches of them (see WireFormat::packBatches)
+        bool batchWire = false;
+        Outbox outbox;
+        Outbox stateOutbox;
+        // Hash of the state schema the peer registered (0: none). Delta
+        // compression needs it to match ours.
+        quint32 schemaHash = 0;
+        QHash<QString, DeltaOut> deltaOut;   // "" = our own state
+        QHash<QString, DeltaIn> deltaIn;
         // Per-peer stats (always on - the counters are cheap)
         int latency = -1;
         qint64 msgSent = 0;
@@ -171,17 +216,29 @@ private:
         qint64 bytesRecv = 0;
         qint64 stateSent = 0;
         qint64 stateRecv = 0;
+        qint64 packetsSent = 0;
+        qint64 packetsRecv = 0;
+        qint64 coalesced = 0;      // states replaced by a newer one before sending
     };
 
     void setupPeerConnection(const QString &peerId, bool isOfferer);
     void setupDataChannel(const QString &peerId, std::shared_ptr<rtc::DataChannel> dc);
     void setupStateChannel(const QString &peerId, std::shared_ptr<rtc::DataChannel> dc);
-    void sendToPeer(const QString &peerId, const QString &message);
-    void sendStateToPeer(const QString &peerId, const QString &message);
-    void handleDataChannelMessage(const QString &fromId, const std::string &message);
-    void handleSystemMessage(const QJsonObject &obj);
+    void sendToPeer(const QString &peerId, const WireMessage &message);
+    void sendStateToPeer(const QString &peerId, const WireMessage &message);
+    bool batched(const PeerConn &peer, const WireMessage &message) const;
+    void enqueue(PeerConn &peer, Outbox &box, const WireMessage &message, bool coalesce);
+    void flushOutbox(PeerConn &peer, Outbox &box, bool stateChannel);
+    void transmit(PeerConn &peer, bool stateChannel, const QByteArray &bytes, int messages);
+    bool deltaCapable(const PeerConn &peer) const;
+    void sendDeltaState(const QString &peerId, const QString &origin, quint32 seq,
+                        const StateSchema::Snapshot &snapshot);
+    void announceSchema(const QString &peerId);
+    void handleDataChannelMessage(const QString &fromId, const char *data, size_t size);
+    void dispatchEnvelope(const QString &fromId, const WireEnvelope &env, qsizetype size);
+    void handleSystemMessage(const QString &fromId, const QVariantMap &msg);
     void sendRosterTo(const QString &peerId);
-    void hostBroadcastSystem(const QJsonObject &msg, const QString &exceptPeer = QString());
+    void hostBroadcastSystem(const QVariantMap &msg, const QString &exceptPeer = QString());
     void forgetSender(const QString &nodeId);
     void cleanupPeer(const QString &peerId);
     QString generateNetworkCode() const;
@@ -232,5 +289,16 @@ private:
     QHash<QString, qint64> stateLastMs_;
     QHash<QString, qint64> stateRecvCount_;
     QHash<QString, qint64> stateDropCount_;
+    QHash<QString, qint64> stateBytesIn_;
+    QHash<QString, qint64> stateDeltaCount_;
+    QHash<QString, qint64> stateBaselineMiss_;
     QElapsedTimer clock_;
+
+    // Delta compression for broadcastState (see state_schema.h)
+    QVariantList stateSchemaSpec_;
+    StateSchema stateSchema_;
+
+    // Per-tick send batching (opt-in)
+    bool batching_ = false;
+    bool flushPending_ = false;
 };
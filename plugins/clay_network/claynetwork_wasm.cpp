@@ -905,6 +905,22 @@ void ClayNetwork::setVerbose(bool v) {
     }
 }
 
+QVariantList ClayNetwork::stateSchema() const { return stateSchema_; }
+void ClayNetwork::setStateSchema(const QVariantList &schema) {
+    if (stateSchema_ != schema) {
+        stateSchema_ = schema;
+        emit stateSchemaChanged();
+    }
+}
+
+bool ClayNetwork::batching() const { return batching_; }
+void ClayNetwork::setBatching(bool batching) {
+    if (batching_ != batching) {
+        batching_ = batching;
+        emit batchingChanged();
+    }
+}
+
 QString ClayNetwork::connectionPhase() const { return connectionPhase_; }
 QVariantMap ClayNetwork::phaseTiming() const { return phaseTiming_; }
 int ClayNetwork::latency() const { return latency_; }
@@ -1288,3 +1304,8 @@ void ClayNetwork::ping()
     }
 #endif
 }
+
+void ClayNetwork::flush()
+{
+    // Nothing is ever queued (see batching_)
+}
@@ -45,6 +45,8 @@ class ClayNetwork : public QObject
     Q_PROPERTY(int latency READ latency NOTIFY latencyChanged)
     Q_PROPERTY(QVariantMap peerStats READ peerStats NOTIFY peerStatsChanged)
     Q_PROPERTY(QVariantMap syncStats READ syncStats NOTIFY syncStatsChanged)
+    Q_PROPERTY(QVariantList stateSchema READ stateSchema WRITE setStateSchema NOTIFY stateSchemaChanged)
+    Q_PROPERTY(bool batching READ batching WRITE setBatching NOTIFY batchingChanged)
 
 public:
     enum Topology {
@@ -96,6 +98,10 @@ public:
     int latency() const;
     QVariantMap peerStats() const;
     QVariantMap syncStats() const;
+    QVariantList stateSchema() const;
+    void setStateSchema(const QVariantList &schema);
+    bool batching() const;
+    void setBatching(bool batching);
 
 public slots:
     void createRoom();
@@ -105,6 +111,7 @@ public slots:
     void broadcastState(const QVariant &data);
     void sendTo(const QString &nodeId, const QVariant &data);
     void ping();
+    void flush();
     int stateAgeMs(const QString &nodeId) const;
 
 signals:
@@ -133,6 +140,8 @@ signals:
     void connectionPhaseChanged();
     void phaseTimingChanged();
     void latencyChanged();
+    void stateSchemaChanged();
+    void batchingChanged();
     void peerStatsChanged();
     void syncStatsChanged();
 
@@ -172,6 +181,12 @@ private:
     // ICE configuration
     QVariantList iceServers_;
 
+    // Kept for API parity: browser peers exchange JSON, so state always
+    // goes out in full here
+    QVariantList stateSchema_;
+    // Likewise: PeerJS sends every message on its own
+    bool batching_ = false;
+
     // Diagnostics
     bool verbose_ = false;
     QString connectionPhase_;
@@ -0,0 +1,347 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "state_schema.h"
+#include <QSet>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+// LSB-first bit stream.
+class BitWriter
+{
+public:
+    void write(quint64 v, int n)
+    {
+        while (n > 0) {
+            if (used_ == 0)
+                bytes_.append('\0');
+            const int take = std::min(n, 8 - used_);
+            const auto chunk = static_cast<quint8>(v & ((1u << take) - 1));
+            bytes_.data()[bytes_.size() - 1] |= static_cast<char>(chunk << used_);
+            used_ = (used_ + take) & 7;
+            v >>= take;
+            n -= take;
+        }
+    }
+
+    // 7 bits per group plus a continuation bit.
+    void writeVar(quint64 v)
+    {
+        do {
+            write(v & 0x7F, 7);
+            v >>= 7;
+            write(v ? 1 : 0, 1);
+        } while (v);
+    }
+
+    QByteArray take() { return std::move(bytes_); }
+
+private:
+    QByteArray bytes_;
+    int used_ = 0;
+};
+
+class BitReader
+{
+public:
+    explicit BitReader(const QByteArray &bytes) : bytes_(bytes) {}
+
+    bool read(int n, quint64 &v)
+    {
+        if (pos_ + n > static_cast<qint64>(bytes_.size()) * 8)
+            return false;
+        v = 0;
+        for (int got = 0; got < n;) {
+            const int bit = static_cast<int>(pos_ & 7);
+            const int take = std::min(n - got, 8 - bit);
+            const auto byte = static_cast<quint8>(bytes_.at(static_cast<qsizetype>(pos_ >> 3)));
+            v |= static_cast<quint64>((byte >> bit) & ((1u << take) - 1)) << got;
+            got += take;
+            pos_ += take;
+        }
+        return true;
+    }
+
+    bool readVar(quint64 &v)
+    {
+        v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            quint64 group, more;
+            if (!read(7, group) || !read(1, more))
+                return false;
+            v |= group << shift;
+            if (!more)
+                return true;
+        }
+        return false;
+    }
+
+    // Everything consumed except the zero padding of the last byte.
+    bool atEnd() const { return (pos_ + 7) / 8 == bytes_.size(); }
+
+private:
+    const QByteArray &bytes_;
+    qint64 pos_ = 0;
+};
+
+quint64 zigzag(qint64 v)
+{
+    return (static_cast<quint64>(v) << 1) ^ static_cast<quint64>(v >> 63);
+}
+
+qint64 unzigzag(quint64 z)
+{
+    return static_cast<qint64>((z >> 1) ^ (~(z & 1) + 1));
+}
+
+quint64 steps(const StateSchema::Field &f)
+{
+    return (quint64(1) << f.bits) - 1;
+}
+
+void writeValue(BitWriter &w, const StateSchema::Field &f, const StateSchema::Value &v)
+{
+    switch (f.type) {
+    case StateSchema::Float:
+        w.write(v.q, f.ranged ? f.bits : 32);
+        break;
+    case StateSchema::Int:
+        if (f.ranged)
+            w.write(v.q, f.bits);
+        else
+            w.writeVar(v.q);
+        break;
+    case StateSchema::Bool:
+        w.write(v.q, 1);
+        break;
+    case StateSchema::String: {
+        const QByteArray utf8 = v.text.toUtf8();
+        w.writeVar(static_cast<quint64>(utf8.size()));
+        for (char c : utf8)
+            w.write(static_cast<quint8>(c), 8);
+        break;
+    }
+    }
+}
+
+bool readValue(BitReader &r, const StateSchema::Field &f, StateSchema::Value &v)
+{
+    switch (f.type) {
+    case StateSchema::Float:
+        return r.read(f.ranged ? f.bits : 32, v.q);
+    case StateSchema::Int:
+        return f.ranged ? r.read(f.bits, v.q) : r.readVar(v.q);
+    case StateSchema::Bool:
+        return r.read(1, v.q);
+    case StateSchema::String: {
+        quint64 len;
+        if (!r.readVar(len) || len > 0xFFFF)
+            return false;
+        QByteArray utf8(static_cast<qsizetype>(len), Qt::Uninitialized);
+        for (char &c : utf8) {
+            quint64 byte;
+            if (!r.read(8, byte))
+                return false;
+            c = static_cast<char>(byte);
+        }
+        v.text = QString::fromUtf8(utf8);
+        return true;
+    }
+    }
+    return false;
+}
+
+} // namespace
+
+StateSchema StateSchema::fromVariant(const QVariantList &spec, QString *error)
+{
+    auto fail = [error](const QString &why) {
+        if (error)
+            *error = why;
+        return StateSchema();
+    };
+
+    StateSchema schema;
+    QSet<QString> names;
+    QString canonical;
+    for (const QVariant &entry : spec) {
+        const QVariantMap m = entry.toMap();
+        Field f;
+        f.name = m.value("name").toString();
+        if (f.name.isEmpty() || names.contains(f.name))
+            return fail(QString("state schema: missing or duplicate field name '%1'").arg(f.name));
+        names.insert(f.name);
+
+        const QString type = m.value("type", "float").toString();
+        if (type == "float") f.type = Float;
+        else if (type == "int") f.type = Int;
+        else if (type == "bool") f.type = Bool;
+        else if (type == "string") f.type = String;
+        else return fail(QString("state schema: unknown type '%1' for '%2'").arg(type, f.name));
+
+        if ((f.type == Float || f.type == Int) && m.contains("min") && m.contains("max")) {
+            f.ranged = true;
+            f.min = m.value("min").toDouble();
+            f.max = m.value("max").toDouble();
+            if (f.type == Int) {
+                f.min = std::round(f.min);
+                f.max = std::round(f.max);
+            }
+            if (!(f.max > f.min) || f.max - f.min >= 9007199254740992.0)   // 2^53
+                return fail(QString("state schema: bad range for '%1'").arg(f.name));
+            if (f.type == Float) {
+                f.bits = m.value("bits", 16).toInt();
+                if (f.bits < 1 || f.bits > 32)
+                    return fail(QString("state schema: bits of '%1' must be 1-32").arg(f.name));
+            } else {
+                const auto span = static_cast<quint64>(f.max - f.min);
+                f.bits = 1;
+                while (f.bits < 64 && (span >> f.bits) != 0)
+                    ++f.bits;
+            }
+        }
+        canonical += QString("%1:%2:%3:%4:%5;").arg(f.name, type)
+                         .arg(f.ranged ? f.min : 0.0, 0, 'g', 17)
+                         .arg(f.ranged ? f.max : 0.0, 0, 'g', 17)
+                         .arg(f.bits);
+        schema.fields_.append(f);
+    }
+
+    // FNV-1a; 0 stands for "no schema" on the wire.
+    quint32 h = 2166136261u;
+    for (char c : canonical.toUtf8()) {
+        h ^= static_cast<quint8>(c);
+        h *= 16777619u;
+    }
+    schema.hash_ = schema.fields_.isEmpty() ? 0 : std::max(h, 1u);
+    return schema;
+}
+
+StateSchema::Snapshot StateSchema::quantize(const QVariantMap &state) const
+{
+    Snapshot s;
+    s.values.resize(fields_.size());
+    s.extra = state;
+    for (int i = 0; i < fields_.size(); ++i) {
+        const Field &f = fields_[i];
+        const QVariant v = s.extra.take(f.name);
+        Value &out = s.values[i];
+        out.present = v.isValid() && !v.isNull();
+        if (!out.present)
+            continue;
+        switch (f.type) {
+        case Float: {
+            const double d = v.toDouble();
+            if (!std::isfinite(d)) {
+                out.present = false;
+            } else if (f.ranged) {
+                const double t = (std::clamp(d, f.min, f.max) - f.min) / (f.max - f.min);
+                out.q = static_cast<quint64>(std::llround(t * static_cast<double>(steps(f))));
+            } else {
+                const auto fl = static_cast<float>(d);
+                quint32 bits;
+                std::memcpy(&bits, &fl, sizeof bits);
+                out.q = bits;
+            }
+            break;
+        }
+        case Int:
+            if (f.ranged) {
+                const double d = std::clamp(std::round(v.toDouble()), f.min, f.max);
+                out.q = static_cast<quint64>(d - f.min);
+            } else {
+                out.q = zigzag(v.toLongLong());
+            }
+            break;
+        case Bool:
+            out.q = v.toBool() ? 1 : 0;
+            break;
+        case String:
+            out.text = v.toString();
+            break;
+        }
+    }
+    return s;
+}
+
+QVariantMap StateSchema::toVariantMap(const Snapshot &snapshot) const
+{
+    QVariantMap map = snapshot.extra;
+    for (int i = 0; i < fields_.size() && i < snapshot.values.size(); ++i) {
+        const Field &f = fields_[i];
+        const Value &v = snapshot.values[i];
+        if (!v.present)
+            continue;
+        switch (f.type) {
+        case Float:
+            if (f.ranged) {
+                map.insert(f.name, f.min + static_cast<double>(v.q) * (f.max - f.min)
+                                       / static_cast<double>(steps(f)));
+            } else {
+                const auto bits = static_cast<quint32>(v.q);
+                float fl;
+                std::memcpy(&fl, &bits, sizeof fl);
+                map.insert(f.name, static_cast<double>(fl));
+            }
+            break;
+        case Int:
+            map.insert(f.name, f.ranged ? static_cast<qlonglong>(f.min) + static_cast<qlonglong>(v.q)
+                                        : static_cast<qlonglong>(unzigzag(v.q)));
+            break;
+        case Bool:
+            map.insert(f.name, v.q != 0);
+            break;
+        case String:
+            map.insert(f.name, v.text);
+            break;
+        }
+    }
+    return map;
+}
+
+QByteArray StateSchema::pack(const Snapshot &snapshot, const Snapshot *baseline) const
+{
+    BitWriter w;
+    for (int i = 0; i < fields_.size(); ++i) {
+        const Value &v = snapshot.values[i];
+        if (baseline) {
+            const bool changed = v != baseline->values[i];
+            w.write(changed ? 1 : 0, 1);
+            if (!changed)
+                continue;
+        }
+        w.write(v.present ? 1 : 0, 1);
+        if (v.present)
+            writeValue(w, fields_[i], v);
+    }
+    return w.take();
+}
+
+bool StateSchema::unpack(const QByteArray &packed, const Snapshot *baseline, Snapshot &snapshot) const
+{
+    if (baseline && baseline->values.size() != fields_.size())
+        return false;
+    snapshot.values.resize(fields_.size());
+    BitReader r(packed);
+    for (int i = 0; i < fields_.size(); ++i) {
+        Value &v = snapshot.values[i];
+        quint64 bit;
+        if (baseline) {
+            if (!r.read(1, bit))
+                return false;
+            if (!bit) {
+                v = baseline->values[i];
+                continue;
+            }
+        }
+        if (!r.read(1, bit))
+            return false;
+        v = Value();
+        v.present = bit != 0;
+        if (v.present && !readValue(r, fields_[i], v))
+            return false;
+    }
+    return r.atEnd();
+}
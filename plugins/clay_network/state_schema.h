@@ -0,0 +1,112 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVariantList>
+#include <QVariantMap>
+#include <QVector>
+#include <array>
+
+/*
+ * Registered layout of broadcastState() payloads, for delta compression.
+ *
+ * A schema lists state fields in a fixed order with a type and, for
+ * numbers, an optional range:
+ *
+ *   [{name: "x", type: "float", min: 0, max: 2048, bits: 16},
+ *    {name: "hp", type: "int", min: 0, max: 100},
+ *    {name: "alive", type: "bool"}, {name: "anim", type: "string"}]
+ *
+ * Floats with a range are quantized to `bits` (1-32, default 16), ints
+ * with a range take just enough bits for it; without a range floats go
+ * as float32 and ints as zigzag varints. A state is quantized into a
+ * Snapshot and packed either whole (keyframe) or against a baseline the
+ * receiver acknowledged: one bit per unchanged field, the value only for
+ * changed ones. Keys outside the schema ride along unpacked in `extra`.
+ *
+ * Both ends must register the same schema; hash() identifies it.
+ */
+class StateSchema
+{
+public:
+    enum FieldType { Float, Int, Bool, String };
+
+    struct Field
+    {
+        QString name;
+        FieldType type = Float;
+        bool ranged = false;
+        double min = 0.0;
+        double max = 0.0;
+        int bits = 0;           // packed width of ranged values
+    };
+
+    struct Value
+    {
+        bool present = false;
+        quint64 q = 0;          // quantized number / bool
+        QString text;           // String fields
+
+        bool operator==(const Value &o) const
+        {
+            return present == o.present && q == o.q && text == o.text;
+        }
+        bool operator!=(const Value &o) const { return !(*this == o); }
+    };
+
+    struct Snapshot
+    {
+        QVector<Value> values;  // one per schema field, in schema order
+        QVariantMap extra;      // keys the schema does not cover
+    };
+
+    // Empty (no delta compression) when `spec` is empty or invalid; the
+    // reason for the latter goes to `error`.
+    static StateSchema fromVariant(const QVariantList &spec, QString *error = nullptr);
+
+    bool isEmpty() const { return fields_.isEmpty(); }
+    const QVector<Field> &fields() const { return fields_; }
+    quint32 hash() const { return hash_; }
+
+    Snapshot quantize(const QVariantMap &state) const;
+    QVariantMap toVariantMap(const Snapshot &snapshot) const;
+
+    // Schema fields of `snapshot`, relative to `baseline` when given.
+    QByteArray pack(const Snapshot &snapshot, const Snapshot *baseline) const;
+    // Fills snapshot.values; false on malformed input.
+    bool unpack(const QByteArray &packed, const Snapshot *baseline, Snapshot &snapshot) const;
+
+private:
+    QVector<Field> fields_;
+    quint32 hash_ = 0;
+};
+
+// The last kSize snapshots of one sender, by state sequence number
+// (0 is never a valid sequence number).
+class StateHistory
+{
+public:
+    static constexpr int kSize = 32;
+
+    void put(quint32 seq, const StateSchema::Snapshot &snapshot)
+    {
+        Slot &slot = slots_[seq % kSize];
+        slot.seq = seq;
+        slot.snapshot = snapshot;
+    }
+
+    const StateSchema::Snapshot *find(quint32 seq) const
+    {
+        const Slot &slot = slots_[seq % kSize];
+        return seq != 0 && slot.seq == seq ? &slot.snapshot : nullptr;
+    }
+
+private:
+    struct Slot
+    {
+        quint32 seq = 0;
+        StateSchema::Snapshot snapshot;
+    };
+    std::array<Slot, kSize> slots_;
+};
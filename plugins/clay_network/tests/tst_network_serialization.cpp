@@ -4,13 +4,23 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QUuid>
 #include <QVariant>
 #include <QVariantMap>
+#include "state_schema.h"
+#include "wire_format.h"
+#include <cmath>
+#include <limits>
+
+Q_DECLARE_METATYPE(WireEnvelope)
 
 /**
  * @brief Unit tests for ClayNetwork message serialization.
  *
- * Tests the QVariant <-> JSON conversion used for network messages.
+ * Tests the QVariant <-> JSON conversion used for network messages and
+ * the binary envelope of wire_format.h, including size and speed against
+ * JSON, the schema-based delta compression of state_schema.h and the
+ * batching of several envelopes into one datagram.
  * These tests run without network dependencies and can be used in CI.
  */
 class TestNetworkSerialization : public QObject
@@ -28,8 +38,67 @@ private slots:
     void testStaleStateDetection();
     void testRelayPreservesStatePayload();
     void testRosterSystemMessage();
+
+    void testBinaryEnvelopeRoundTrip();
+    void testBinaryValueTypes();
+    void testJsonEnvelopeMatchesLegacyLayout();
+    void testEncodingsDecodeAlike();
+    void testRejectsMalformedBinary();
+    void testWireSize_data();
+    void testWireSize();
+    void benchmarkEncode_data();
+    void benchmarkEncode();
+    void benchmarkDecode_data();
+    void benchmarkDecode();
+
+    void testSchemaQuantization();
+    void testSchemaDeltaPacking();
+    void testSchemaValidation();
+    void testDeltaEnvelopeRoundTrip();
+    void testDeltaStateBandwidth();
+
+    void testBatchRoundTrip();
+    void testBatchEdgeCases();
 };
 
+namespace {
+
+// A typical entity sync update at 30 Hz.
+QVariantMap positionState()
+{
+    return {{"x", 412.375}, {"y", 188.62}, {"vx", 3.5}, {"vy", -1.25},
+            {"angle", -90}, {"anim", "run"}, {"hp", 87}};
+}
+
+QVariantMap chatMessage()
+{
+    return {{"type", "chat"}, {"text", "gg, one more round?"}, {"team", 2}};
+}
+
+QVariantList entitySchema()
+{
+    return {
+        QVariantMap{{"name", "x"}, {"min", 0}, {"max", 4096}, {"bits", 16}},
+        QVariantMap{{"name", "y"}, {"min", 0}, {"max", 4096}, {"bits", 16}},
+        QVariantMap{{"name", "vx"}, {"min", -32}, {"max", 32}, {"bits", 10}},
+        QVariantMap{{"name", "vy"}, {"min", -32}, {"max", 32}, {"bits", 10}},
+        QVariantMap{{"name", "angle"}, {"type", "int"}, {"min", -180}, {"max", 180}},
+        QVariantMap{{"name", "anim"}, {"type", "string"}},
+        QVariantMap{{"name", "hp"}, {"type", "int"}, {"min", 0}, {"max", 100}}};
+}
+
+WireEnvelope stateEnvelope()
+{
+    WireEnvelope env;
+    env.type = 's';
+    env.hasSeq = true;
+    env.seq = 123456;
+    env.payload = positionState();
+    return env;
+}
+
+} // namespace
+
 void TestNetworkSerialization::testVariantMapToJson()
 {
     // Simulate what broadcast() does
@@ -242,5 +311,451 @@ void TestNetworkSerialization::testRosterSystemMessage()
     QCOMPARE(reparsed["nodeId"].toString(), "nodeC");
 }
 
+void TestNetworkSerialization::testBinaryEnvelopeRoundTrip()
+{
+    WireEnvelope env = stateEnvelope();
+    env.from = "node-été";
+    const QByteArray bytes = WireFormat::encode(env, WireFormat::Binary);
+    QCOMPARE(bytes.at(0), WireFormat::kMagic);
+
+    WireEnvelope decoded;
+    QVERIFY(WireFormat::decode(bytes.constData(), bytes.size(), decoded));
+    QCOMPARE(decoded.type, 's');
+    QVERIFY(decoded.hasSeq);
+    QCOMPARE(decoded.seq, 123456u);
+    QCOMPARE(decoded.from, env.from);
+    QCOMPARE(decoded.payload["x"].toDouble(), 412.375);
+    QCOMPARE(decoded.payload["y"].toDouble(), 188.62);
+    QCOMPARE(decoded.payload["angle"].toInt(), -90);
+    QCOMPARE(decoded.payload["anim"].toString(), "run");
+
+    // Messages carry neither seq nor origin
+    WireEnvelope msg;
+    msg.payload = chatMessage();
+    const QByteArray msgBytes = WireFormat::encode(msg, WireFormat::Binary);
+    QVERIFY(WireFormat::decode(msgBytes.constData(), msgBytes.size(), decoded));
+    QCOMPARE(decoded.type, 'm');
+    QVERIFY(!decoded.hasSeq);
+    QVERIFY(decoded.from.isEmpty());
+    QCOMPARE(decoded.payload, msg.payload);
+}
+
+void TestNetworkSerialization::testBinaryValueTypes()
+{
+    QVariantMap nested{{"list", QVariantList{1, "two", 3.25, QVariantList{}}},
+                       {"empty", QVariantMap{}}};
+    QVariantMap original{
+        {"zero", 0}, {"neg", -1}, {"big", qint64(1) << 40}, {"min", std::numeric_limits<qint64>::min()},
+        {"whole", 100.0}, {"half", 0.5}, {"third", 1.0 / 3.0},
+        {"yes", true}, {"no", false}, {"none", QVariant::fromValue(nullptr)},
+        {"nan", std::nan("")}, {"text", QString::fromUtf8("\xc3\xa4\xf0\x9f\x8e\xae")},
+        {"names", QStringList{"a", "b"}}, {"nested", nested}};
+
+    QByteArray bytes;
+    WireFormat::writeValue(bytes, original);
+    const char *p = bytes.constData();
+    QVariant value;
+    QVERIFY(WireFormat::readValue(p, bytes.constData() + bytes.size(), value));
+    QCOMPARE(p, bytes.constData() + bytes.size());
+
+    const QVariantMap decoded = value.toMap();
+    QCOMPARE(decoded["zero"].toLongLong(), 0LL);
+    QCOMPARE(decoded["neg"].toLongLong(), -1LL);
+    QCOMPARE(decoded["big"].toLongLong(), qint64(1) << 40);
+    QCOMPARE(decoded["min"].toLongLong(), std::numeric_limits<qint64>::min());
+    // Whole doubles travel as integers, like they come out of JSON
+    QCOMPARE(decoded["whole"].typeId(), QMetaType::LongLong);
+    QCOMPARE(decoded["whole"].toInt(), 100);
+    QCOMPARE(decoded["half"].toDouble(), 0.5);
+    QCOMPARE(decoded["third"].toDouble(), 1.0 / 3.0);
+    QCOMPARE(decoded["yes"].toBool(), true);
+    QCOMPARE(decoded["no"].toBool(), false);
+    QVERIFY(decoded["none"].isNull());
+    QVERIFY(decoded["nan"].isNull());
+    QCOMPARE(decoded["text"].toString(), original["text"].toString());
+    QCOMPARE(decoded["names"].toStringList(), QStringList({"a", "b"}));
+    const QVariantList list = decoded["nested"].toMap()["list"].toList();
+    QCOMPARE(list.size(), 4);
+    QCOMPARE(list[1].toString(), "two");
+    QCOMPARE(list[2].toDouble(), 3.25);
+    QVERIFY(decoded["nested"].toMap()["empty"].toMap().isEmpty());
+}
+
+void TestNetworkSerialization::testJsonEnvelopeMatchesLegacyLayout()
+{
+    // Peers that never negotiated (PeerJS, older builds) keep getting the
+    // exact JSON they always got...
+    WireEnvelope env = stateEnvelope();
+    env.from = "node123";
+    QJsonObject parsed = QJsonDocument::fromJson(WireFormat::encode(env, WireFormat::Json)).object();
+    QCOMPARE(parsed["t"].toString(), "s");
+    QCOMPARE(parsed["q"].toInt(), 123456);
+    QCOMPARE(parsed["from"].toString(), "node123");
+    QCOMPARE(parsed["d"].toObject()["x"].toDouble(), 412.375);
+
+    WireEnvelope roster;
+    roster.type = 'y';
+    roster.payload = {{"sys", "roster"}, {"nodes", QStringList{"nodeA", "nodeB"}}};
+    parsed = QJsonDocument::fromJson(WireFormat::encode(roster, WireFormat::Json)).object();
+    QCOMPARE(parsed["t"].toString(), "y");
+    QCOMPARE(parsed["sys"].toString(), "roster");
+    QCOMPARE(parsed["nodes"].toArray().size(), 2);
+    QVERIFY(!parsed.contains("d"));
+
+    // ...and what they send decodes into the same envelope
+    const QByteArray legacy = R"({"t":"p","ts":1700000000000})";
+    WireEnvelope ping;
+    QVERIFY(WireFormat::decode(legacy.constData(), legacy.size(), ping));
+    QCOMPARE(ping.type, 'p');
+    QVERIFY(!ping.hasSeq);
+    QCOMPARE(ping.payload["ts"].toDouble(), 1700000000000.0);
+}
+
+void TestNetworkSerialization::testEncodingsDecodeAlike()
+{
+    WireEnvelope env = stateEnvelope();
+    env.payload["tags"] = QVariantList{"a", 2, 2.5, true};
+    env.payload["at"] = QVariantMap{{"x", 1}, {"y", 0.1}};
+
+    WireEnvelope fromJson, fromBinary;
+    const QByteArray json = WireFormat::encode(env, WireFormat::Json);
+    const QByteArray binary = WireFormat::encode(env, WireFormat::Binary);
+    QVERIFY(WireFormat::decode(json.constData(), json.size(), fromJson));
+    QVERIFY(WireFormat::decode(binary.constData(), binary.size(), fromBinary));
+    QCOMPARE(fromBinary.type, fromJson.type);
+    QCOMPARE(fromBinary.seq, fromJson.seq);
+    QCOMPARE(fromBinary.payload, fromJson.payload);
+}
+
+void TestNetworkSerialization::testRejectsMalformedBinary()
+{
+    const QByteArray bytes = WireFormat::encode(stateEnvelope(), WireFormat::Binary);
+    WireEnvelope env;
+    for (qsizetype n = 1; n < bytes.size(); ++n)
+        QVERIFY2(!WireFormat::decode(bytes.constData(), n, env), qPrintable(QString::number(n)));
+
+    QByteArray trailing = bytes + '\0';
+    QVERIFY(!WireFormat::decode(trailing.constData(), trailing.size(), env));
+
+    // A list claiming more elements than there are bytes
+    const QByteArray hostile("\x07\xff\xff\xff\xff\x0f", 6);
+    const char *p = hostile.constData();
+    QVariant value;
+    QVERIFY(!WireFormat::readValue(p, hostile.constData() + hostile.size(), value));
+}
+
+void TestNetworkSerialization::testWireSize_data()
+{
+    QTest::addColumn<WireEnvelope>("env");
+    QTest::newRow("state") << stateEnvelope();
+    WireEnvelope chat;
+    chat.payload = chatMessage();
+    QTest::newRow("chat") << chat;
+    WireEnvelope relayed = stateEnvelope();
+    relayed.from = "6f1c9a52-2b1e-4d1a-9d0e-3c8f7a1b2c3d";
+    QTest::newRow("relayed state") << relayed;
+}
+
+void TestNetworkSerialization::testWireSize()
+{
+    QFETCH(WireEnvelope, env);
+    const qsizetype json = WireFormat::encode(env, WireFormat::Json).size();
+    const qsizetype binary = WireFormat::encode(env, WireFormat::Binary).size();
+    qInfo("%s: json %lld bytes, binary %lld bytes (%.0f%%)", QTest::currentDataTag(),
+          static_cast<long long>(json), static_cast<long long>(binary), 100.0 * binary / json);
+    QVERIFY(binary < json);
+}
+
+void TestNetworkSerialization::benchmarkEncode_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::newRow("json") << int(WireFormat::Json);
+    QTest::newRow("binary") << int(WireFormat::Binary);
+}
+
+void TestNetworkSerialization::benchmarkEncode()
+{
+    QFETCH(int, format);
+    const WireEnvelope env = stateEnvelope();
+    QBENCHMARK {
+        const QByteArray bytes = WireFormat::encode(env, WireFormat::Format(format));
+        QVERIFY(!bytes.isEmpty());
+    }
+}
+
+void TestNetworkSerialization::benchmarkDecode_data()
+{
+    benchmarkEncode_data();
+}
+
+void TestNetworkSerialization::benchmarkDecode()
+{
+    QFETCH(int, format);
+    const QByteArray bytes = WireFormat::encode(stateEnvelope(), WireFormat::Format(format));
+    WireEnvelope env;
+    QBENCHMARK {
+        QVERIFY(WireFormat::decode(bytes.constData(), bytes.size(), env));
+    }
+    QCOMPARE(env.payload.size(), positionState().size());
+}
+
+void TestNetworkSerialization::testSchemaQuantization()
+{
+    QString error;
+    const StateSchema schema = StateSchema::fromVariant(entitySchema(), &error);
+    QVERIFY2(!schema.isEmpty(), qPrintable(error));
+
+    QVariantMap state = positionState();
+    state["team"] = "red";   // not in the schema
+    state.remove("hp");      // absent schema field
+    const QVariantMap decoded = schema.toVariantMap(schema.quantize(state));
+
+    QVERIFY(qAbs(decoded["x"].toDouble() - 412.375) <= 4096.0 / 65535 / 2);
+    QVERIFY(qAbs(decoded["y"].toDouble() - 188.62) <= 4096.0 / 65535 / 2);
+    QVERIFY(qAbs(decoded["vy"].toDouble() - -1.25) <= 64.0 / 1023 / 2);
+    QCOMPARE(decoded["angle"].toInt(), -90);
+    QCOMPARE(decoded["anim"].toString(), "run");
+    QCOMPARE(decoded["team"].toString(), "red");
+    QVERIFY(!decoded.contains("hp"));
+
+    // Out of range values clamp; unranged numbers pass as float32 / varint
+    const StateSchema loose = StateSchema::fromVariant({
+        QVariantMap{{"name", "x"}, {"min", 0}, {"max", 1}},
+        QVariantMap{{"name", "f"}},
+        QVariantMap{{"name", "n"}, {"type", "int"}},
+        QVariantMap{{"name", "on"}, {"type", "bool"}}});
+    const QVariantMap looseState{{"x", 7.0}, {"f", 0.1}, {"n", -123456789}, {"on", true}};
+    StateSchema::Snapshot snap;
+    QVERIFY(loose.unpack(loose.pack(loose.quantize(looseState), nullptr), nullptr, snap));
+    const QVariantMap out = loose.toVariantMap(snap);
+    QCOMPARE(out["x"].toDouble(), 1.0);
+    QCOMPARE(out["f"].toDouble(), double(0.1f));
+    QCOMPARE(out["n"].toLongLong(), -123456789LL);
+    QCOMPARE(out["on"].toBool(), true);
+}
+
+void TestNetworkSerialization::testSchemaDeltaPacking()
+{
+    const StateSchema schema = StateSchema::fromVariant(entitySchema());
+    const StateSchema::Snapshot base = schema.quantize(positionState());
+
+    QVariantMap moved = positionState();
+    moved["x"] = 415.0;
+    moved["anim"] = "jump";
+    const StateSchema::Snapshot next = schema.quantize(moved);
+
+    const QByteArray keyframe = schema.pack(next, nullptr);
+    const QByteArray delta = schema.pack(next, &base);
+    QVERIFY(delta.size() < keyframe.size());
+    // 7 change bits, x (1 + 16 bits), anim (1 + 8 + 4 * 8 bits)
+    QCOMPARE(delta.size(), (7 + 17 + 41 + 7) / 8);
+
+    StateSchema::Snapshot fromKeyframe, fromDelta;
+    QVERIFY(schema.unpack(keyframe, nullptr, fromKeyframe));
+    QVERIFY(schema.unpack(delta, &base, fromDelta));
+    QCOMPARE(schema.toVariantMap(fromDelta), schema.toVariantMap(next));
+    QCOMPARE(schema.toVariantMap(fromKeyframe), schema.toVariantMap(next));
+
+    // Nothing changed: one bit per field
+    QCOMPARE(schema.pack(base, &base).size(), 1);
+
+    // Truncated input is rejected, not misread
+    StateSchema::Snapshot broken;
+    QVERIFY(!schema.unpack(keyframe.left(keyframe.size() - 1), nullptr, broken));
+}
+
+void TestNetworkSerialization::testSchemaValidation()
+{
+    QString error;
+    QVERIFY(StateSchema::fromVariant({QVariantMap{{"name", "x"}, {"type", "vec3"}}}, &error).isEmpty());
+    QVERIFY(!error.isEmpty());
+    QVERIFY(StateSchema::fromVariant({QVariantMap{{"name", "x"}}, QVariantMap{{"name", "x"}}}).isEmpty());
+    QVERIFY(StateSchema::fromVariant({QVariantMap{{"name", "x"}, {"min", 1}, {"max", 1}}}).isEmpty());
+    QVERIFY(StateSchema::fromVariant(
+        {QVariantMap{{"name", "x"}, {"min", 0}, {"max", 1}, {"bits", 40}}}).isEmpty());
+    QCOMPARE(StateSchema::fromVariant({}).hash(), 0u);
+
+    // Peers compare schemas by hash
+    const quint32 h = StateSchema::fromVariant(entitySchema()).hash();
+    QVERIFY(h != 0);
+    QCOMPARE(StateSchema::fromVariant(entitySchema()).hash(), h);
+    QVariantList other = entitySchema();
+    other[0] = QVariantMap{{"name", "x"}, {"min", 0}, {"max", 4096}, {"bits", 12}};
+    QVERIFY(StateSchema::fromVariant(other).hash() != h);
+}
+
+void TestNetworkSerialization::testDeltaEnvelopeRoundTrip()
+{
+    const StateSchema schema = StateSchema::fromVariant(entitySchema());
+    const StateSchema::Snapshot base = schema.quantize(positionState());
+    QVariantMap moved = positionState();
+    moved["y"] = 190.0;
+    moved["team"] = 2;
+
+    WireEnvelope env;
+    env.type = 'd';
+    env.hasSeq = true;
+    env.seq = 42;
+    env.from = "nodeA";
+    env.baseline = 40;
+    const StateSchema::Snapshot next = schema.quantize(moved);
+    env.packed = schema.pack(next, &base);
+    env.payload = next.extra;
+
+    for (WireFormat::Format format : {WireFormat::Binary, WireFormat::Json}) {
+        const QByteArray bytes = WireFormat::encode(env, format);
+        WireEnvelope decoded;
+        QVERIFY(WireFormat::decode(bytes.constData(), bytes.size(), decoded));
+        QCOMPARE(decoded.type, 'd');
+        QCOMPARE(decoded.seq, 42u);
+        QCOMPARE(decoded.baseline, 40u);
+        QCOMPARE(decoded.from, "nodeA");
+        QCOMPARE(decoded.packed, env.packed);
+        QCOMPARE(decoded.payload["team"].toInt(), 2);
+    }
+
+    // Acks are plain envelopes
+    WireEnvelope ack;
+    ack.type = 'a';
+    ack.hasSeq = true;
+    ack.seq = 42;
+    const QByteArray ackBytes = WireFormat::encode(ack, WireFormat::Binary);
+    QVERIFY(ackBytes.size() <= 8);
+}
+
+void TestNetworkSerialization::testDeltaStateBandwidth()
+{
+    // A walking entity at 30 Hz for 10 s: position every tick, velocity
+    // now and then, animation and hp rarely; one keyframe per second and
+    // acks arriving two ticks late.
+    const StateSchema schema = StateSchema::fromVariant(entitySchema());
+    StateHistory sent;
+    qint64 jsonBytes = 0, binaryBytes = 0, deltaBytes = 0, keyframes = 0;
+    QVariantMap state = positionState();
+
+    for (quint32 seq = 1; seq <= 300; ++seq) {
+        state["x"] = state["x"].toDouble() + state["vx"].toDouble() / 30.0;
+        state["y"] = state["y"].toDouble() + state["vy"].toDouble() / 30.0;
+        if (seq % 45 == 0)
+            state["vx"] = -state["vx"].toDouble();
+        if (seq % 90 == 0)
+            state["anim"] = state["anim"] == "run" ? "idle" : "run";
+        if (seq % 120 == 0)
+            state["hp"] = state["hp"].toInt() - 10;
+
+        WireEnvelope full;
+        full.type = 's';
+        full.hasSeq = true;
+        full.seq = seq;
+        full.payload = state;
+        jsonBytes += WireFormat::encode(full, WireFormat::Json).size();
+        binaryBytes += WireFormat::encode(full, WireFormat::Binary).size();
+
+        const StateSchema::Snapshot snap = schema.quantize(state);
+        const quint32 acked = seq > 2 ? seq - 2 : 0;
+        const StateSchema::Snapshot *baseline = seq % 30 == 1 ? nullptr : sent.find(acked);
+        keyframes += baseline ? 0 : 1;
+
+        WireEnvelope delta;
+        delta.type = 'd';
+        delta.hasSeq = true;
+        delta.seq = seq;
+        delta.baseline = baseline ? acked : 0;
+        delta.packed = schema.pack(snap, baseline);
+        delta.payload = snap.extra;
+        const QByteArray bytes = WireFormat::encode(delta, WireFormat::Binary);
+        deltaBytes += bytes.size();
+        sent.put(seq, snap);
+
+        // What the receiver reconstructs matches the quantized state
+        WireEnvelope received;
+        QVERIFY(WireFormat::decode(bytes.constData(), bytes.size(), received));
+        StateSchema::Snapshot decoded;
+        QVERIFY(schema.unpack(received.packed, baseline, decoded));
+        QCOMPARE(schema.toVariantMap(decoded), schema.toVariantMap(snap));
+    }
+
+    qInfo("300 states: json %lld B, binary %lld B, delta %lld B (%lld keyframes) "
+          "-> %.1fx smaller than json, %.1fx than binary",
+          jsonBytes, binaryBytes, deltaBytes, keyframes,
+          double(jsonBytes) / deltaBytes, double(binaryBytes) / deltaBytes);
+    QVERIFY(jsonBytes >= 5 * deltaBytes);
+}
+
+void TestNetworkSerialization::testBatchRoundTrip()
+{
+    // A host relaying one tick of 50 nodes' states to a joiner
+    QVector<WireEnvelope> envs;
+    QVector<QByteArray> messages;
+    for (int i = 0; i < 50; ++i) {
+        WireEnvelope env = stateEnvelope();
+        env.seq += i;
+        env.from = QUuid::createUuid().toString(QUuid::WithoutBraces);
+        env.payload["x"] = 10.5 * i;
+        envs.append(env);
+        messages.append(WireFormat::encode(env, WireFormat::Binary));
+    }
+
+    const QVector<WireFormat::Datagram> datagrams = WireFormat::packBatches(messages);
+    int index = 0;
+    for (const WireFormat::Datagram &datagram : datagrams) {
+        QVERIFY(datagram.bytes.size() <= WireFormat::kBatchMtu);
+        QVERIFY(WireFormat::isBatch(datagram.bytes.constData(), datagram.bytes.size()));
+        QVector<QByteArrayView> parts;
+        QVERIFY(WireFormat::splitBatch(datagram.bytes.constData(), datagram.bytes.size(), parts));
+        QCOMPARE(parts.size(), datagram.messages);
+        for (QByteArrayView part : parts) {
+            WireEnvelope env;
+            QVERIFY(WireFormat::decode(part.data(), part.size(), env));
+            QCOMPARE(env.seq, envs[index].seq);
+            QCOMPARE(env.from, envs[index].from);
+            QCOMPARE(env.payload, envs[index].payload);
+            ++index;
+        }
+    }
+    QCOMPARE(index, messages.size());
+
+    const double perPacket = double(messages.size()) / datagrams.size();
+    qInfo("50 relayed states: %lld datagrams, %.1f messages per packet",
+          static_cast<long long>(datagrams.size()), perPacket);
+    QVERIFY(perPacket >= 8);
+}
+
+void TestNetworkSerialization::testBatchEdgeCases()
+{
+    const QByteArray state = WireFormat::encode(stateEnvelope(), WireFormat::Binary);
+
+    // A message alone goes out unframed
+    QVector<WireFormat::Datagram> datagrams = WireFormat::packBatches({state});
+    QCOMPARE(datagrams.size(), 1);
+    QCOMPARE(datagrams[0].bytes, state);
+    QVERIFY(WireFormat::packBatches({}).isEmpty());
+
+    // So does one too big to share, without holding up its neighbours
+    WireEnvelope big = stateEnvelope();
+    big.payload["blob"] = QString(2000, u'x');
+    const QByteArray bigBytes = WireFormat::encode(big, WireFormat::Binary);
+    datagrams = WireFormat::packBatches({state, bigBytes, state, state});
+    QCOMPARE(datagrams.size(), 3);
+    QCOMPARE(datagrams[0].bytes, state);
+    QCOMPARE(datagrams[1].bytes, bigBytes);
+    QCOMPARE(datagrams[2].messages, 2);
+
+    // Truncated, empty or zero-length entries are rejected
+    const QByteArray batch = WireFormat::packBatches({state, state})[0].bytes;
+    const qsizetype firstEnd = 2 + state.size();   // magic, length, message
+    QVector<QByteArrayView> parts;
+    for (qsizetype n = 1; n < batch.size(); ++n) {
+        if (n == firstEnd)
+            continue;   // a complete batch of one
+        parts.clear();
+        QVERIFY2(!WireFormat::splitBatch(batch.constData(), n, parts), qPrintable(QString::number(n)));
+    }
+    const QByteArray zero("\xC0\x00", 2);
+    QVERIFY(!WireFormat::splitBatch(zero.constData(), zero.size(), parts));
+    WireEnvelope env;
+    QVERIFY(!WireFormat::decode(batch.constData(), batch.size(), env));
+}
+
 QTEST_MAIN(TestNetworkSerialization)
 #include "tst_network_serialization.moc"
@@ -0,0 +1,475 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "wire_format.h"
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QStringList>
+#include <QtEndian>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+enum Tag : quint8 {
+    TagNull, TagFalse, TagTrue, TagInt, TagFloat32, TagFloat64,
+    TagString, TagList, TagMap
+};
+
+enum Flag : quint8 { HasSeq = 0x01, HasFrom = 0x02 };
+
+// Deeper nesting than this is rejected rather than recursed into.
+constexpr int kMaxDepth = 64;
+
+void writeVarint(QByteArray &out, quint64 v)
+{
+    while (v >= 0x80) {
+        out.append(static_cast<char>(v | 0x80));
+        v >>= 7;
+    }
+    out.append(static_cast<char>(v));
+}
+
+void writeInt(QByteArray &out, qint64 v)
+{
+    out.append(static_cast<char>(TagInt));
+    writeVarint(out, (static_cast<quint64>(v) << 1) ^ static_cast<quint64>(v >> 63));
+}
+
+void writeString(QByteArray &out, QStringView s)
+{
+    // Keys and most values are ASCII: copy those without a UTF-8 pass.
+    const QChar *c = s.data();
+    const qsizetype n = s.size();
+    qsizetype ascii = 0;
+    while (ascii < n && c[ascii].unicode() < 0x80)
+        ++ascii;
+    if (ascii == n) {
+        writeVarint(out, static_cast<quint64>(n));
+        const qsizetype at = out.size();
+        out.resize(at + n);
+        char *dst = out.data() + at;
+        for (qsizetype i = 0; i < n; ++i)
+            dst[i] = static_cast<char>(c[i].unicode());
+        return;
+    }
+    const QByteArray utf8 = s.toUtf8();
+    writeVarint(out, static_cast<quint64>(utf8.size()));
+    out.append(utf8);
+}
+
+void writeDouble(QByteArray &out, double d)
+{
+    if (!std::isfinite(d)) {
+        out.append(static_cast<char>(TagNull));   // as JSON does
+        return;
+    }
+    if (d == std::trunc(d) && std::abs(d) < 9007199254740992.0) {   // 2^53
+        writeInt(out, static_cast<qint64>(d));
+        return;
+    }
+    const auto f = static_cast<float>(d);
+    if (static_cast<double>(f) == d) {
+        quint32 bits;
+        std::memcpy(&bits, &f, sizeof bits);
+        bits = qToLittleEndian(bits);
+        out.append(static_cast<char>(TagFloat32));
+        out.append(reinterpret_cast<const char *>(&bits), sizeof bits);
+        return;
+    }
+    quint64 bits;
+    std::memcpy(&bits, &d, sizeof bits);
+    bits = qToLittleEndian(bits);
+    out.append(static_cast<char>(TagFloat64));
+    out.append(reinterpret_cast<const char *>(&bits), sizeof bits);
+}
+
+void writeMap(QByteArray &out, const QVariantMap &map)
+{
+    out.append(static_cast<char>(TagMap));
+    writeVarint(out, static_cast<quint64>(map.size()));
+    for (auto it = map.constBegin(); it != map.constEnd(); ++it) {
+        writeString(out, it.key());
+        WireFormat::writeValue(out, it.value());
+    }
+}
+
+qsizetype varintSize(quint64 v)
+{
+    qsizetype n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        ++n;
+    }
+    return n;
+}
+
+bool readVarint(const char *&p, const char *end, quint64 &v)
+{
+    v = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        const auto byte = static_cast<quint8>(*p++);
+        v |= static_cast<quint64>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+bool readString(const char *&p, const char *end, QString &s)
+{
+    quint64 len;
+    if (!readVarint(p, end, len) || len > static_cast<quint64>(end - p))
+        return false;
+    s = QString::fromUtf8(p, static_cast<qsizetype>(len));
+    p += len;
+    return true;
+}
+
+template <typename T>
+bool readFixed(const char *&p, const char *end, T &v)
+{
+    if (end - p < static_cast<qsizetype>(sizeof v))
+        return false;
+    std::memcpy(&v, p, sizeof v);
+    v = qFromLittleEndian(v);
+    p += sizeof v;
+    return true;
+}
+
+bool readValueAt(const char *&p, const char *end, QVariant &value, int depth)
+{
+    if (p >= end || depth > kMaxDepth)
+        return false;
+    switch (static_cast<quint8>(*p++)) {
+    case TagNull:
+        value = QVariant::fromValue(nullptr);
+        return true;
+    case TagFalse:
+        value = false;
+        return true;
+    case TagTrue:
+        value = true;
+        return true;
+    case TagInt: {
+        quint64 z;
+        if (!readVarint(p, end, z))
+            return false;
+        value = static_cast<qlonglong>((z >> 1) ^ (~(z & 1) + 1));
+        return true;
+    }
+    case TagFloat32: {
+        quint32 bits;
+        if (!readFixed(p, end, bits))
+            return false;
+        float f;
+        std::memcpy(&f, &bits, sizeof f);
+        value = static_cast<double>(f);
+        return true;
+    }
+    case TagFloat64: {
+        quint64 bits;
+        if (!readFixed(p, end, bits))
+            return false;
+        double d;
+        std::memcpy(&d, &bits, sizeof d);
+        value = d;
+        return true;
+    }
+    case TagString: {
+        QString s;
+        if (!readString(p, end, s))
+            return false;
+        value = s;
+        return true;
+    }
+    case TagList: {
+        quint64 count;
+        // Every element takes at least one byte.
+        if (!readVarint(p, end, count) || count > static_cast<quint64>(end - p))
+            return false;
+        QVariantList list;
+        list.reserve(static_cast<qsizetype>(count));
+        for (quint64 i = 0; i < count; ++i) {
+            QVariant item;
+            if (!readValueAt(p, end, item, depth + 1))
+                return false;
+            list.append(std::move(item));
+        }
+        value = std::move(list);
+        return true;
+    }
+    case TagMap: {
+        quint64 count;
+        if (!readVarint(p, end, count) || count > static_cast<quint64>(end - p))
+            return false;
+        QVariantMap map;
+        for (quint64 i = 0; i < count; ++i) {
+            QString key;
+            QVariant item;
+            if (!readString(p, end, key) || !readValueAt(p, end, item, depth + 1))
+                return false;
+            map.insert(key, std::move(item));
+        }
+        value = std::move(map);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+bool carriesData(char type)
+{
+    return type == 'm' || type == 's' || type == 'd';
+}
+
+QByteArray encodeJson(const WireEnvelope &env)
+{
+    QJsonObject msg;
+    if (carriesData(env.type))
+        msg["d"] = QJsonObject::fromVariantMap(env.payload);
+    else
+        msg = QJsonObject::fromVariantMap(env.payload);
+    msg["t"] = QString(QChar::fromLatin1(env.type));
+    if (env.hasSeq)
+        msg["q"] = static_cast<qint64>(env.seq);
+    if (!env.from.isEmpty())
+        msg["from"] = env.from;
+    if (env.type == 'd') {
+        msg["b"] = static_cast<qint64>(env.baseline);
+        msg["k"] = QString::fromLatin1(env.packed.toBase64());
+    }
+    return QJsonDocument(msg).toJson(QJsonDocument::Compact);
+}
+
+bool decodeJson(const char *data, qsizetype size, WireEnvelope &env)
+{
+    const QJsonDocument doc = QJsonDocument::fromJson(QByteArray::fromRawData(data, size));
+    if (!doc.isObject())
+        return false;
+
+    QJsonObject obj = doc.object();
+    const QString type = obj.take("t").toString();
+    env.type = type.isEmpty() ? '\0' : type.at(0).toLatin1();
+    const QJsonValue seq = obj.take("q");
+    env.hasSeq = !seq.isUndefined();
+    env.seq = static_cast<quint32>(seq.toDouble());
+    env.from = obj.take("from").toString();
+    env.baseline = static_cast<quint32>(obj.value("b").toDouble());
+    env.packed = QByteArray::fromBase64(obj.value("k").toString().toLatin1());
+    if (carriesData(env.type))
+        env.payload = obj.value("d").toObject().toVariantMap();
+    else
+        env.payload = obj.toVariantMap();
+    return true;
+}
+
+QByteArray encodeBinary(const WireEnvelope &env)
+{
+    QByteArray out;
+    out.reserve(64);
+    out.append(WireFormat::kMagic);
+    out.append(env.type);
+    out.append(static_cast<char>((env.hasSeq ? HasSeq : 0)
+                                 | (env.from.isEmpty() ? 0 : HasFrom)));
+    if (env.hasSeq)
+        writeVarint(out, env.seq);
+    if (!env.from.isEmpty())
+        writeString(out, env.from);
+    if (env.type == 'd') {
+        writeVarint(out, env.baseline);
+        writeVarint(out, static_cast<quint64>(env.packed.size()));
+        out.append(env.packed);
+    }
+    writeMap(out, env.payload);
+    return out;
+}
+
+bool decodeBinary(const char *data, qsizetype size, WireEnvelope &env)
+{
+    const char *p = data + 1;
+    const char *end = data + size;
+    if (end - p < 2)
+        return false;
+    env.type = *p++;
+    const auto flags = static_cast<quint8>(*p++);
+
+    env.hasSeq = flags & HasSeq;
+    env.seq = 0;
+    if (env.hasSeq) {
+        quint64 seq;
+        if (!readVarint(p, end, seq))
+            return false;
+        env.seq = static_cast<quint32>(seq);
+    }
+    env.from.clear();
+    if ((flags & HasFrom) && !readString(p, end, env.from))
+        return false;
+    env.baseline = 0;
+    env.packed.clear();
+    if (env.type == 'd') {
+        quint64 baseline, len;
+        if (!readVarint(p, end, baseline) || !readVarint(p, end, len)
+            || len > static_cast<quint64>(end - p))
+            return false;
+        env.baseline = static_cast<quint32>(baseline);
+        env.packed = QByteArray(p, static_cast<qsizetype>(len));
+        p += len;
+    }
+
+    if (p >= end || static_cast<quint8>(*p) != TagMap)
+        return false;
+    QVariant payload;
+    if (!readValueAt(p, end, payload, 0))
+        return false;
+    env.payload = payload.toMap();
+    return p == end;
+}
+
+} // namespace
+
+namespace WireFormat {
+
+QByteArray encode(const WireEnvelope &env, Format format)
+{
+    return format == Binary ? encodeBinary(env) : encodeJson(env);
+}
+
+bool decode(const char *data, qsizetype size, WireEnvelope &env)
+{
+    if (size > 0 && data[0] == kMagic)
+        return decodeBinary(data, size, env);
+    return decodeJson(data, size, env);
+}
+
+QVector<Datagram> packBatches(const QVector<QByteArray> &messages, qsizetype mtu)
+{
+    QVector<Datagram> datagrams;
+    qsizetype first = 0;    // current run is [first, i)
+    qsizetype size = 1;     // its size as a batch
+    auto close = [&](qsizetype end) {
+        if (end - first == 1) {
+            datagrams.append({messages[first], 1});
+        } else if (end > first) {
+            QByteArray batch;
+            batch.reserve(size);
+            batch.append(kBatchMagic);
+            for (qsizetype i = first; i < end; ++i) {
+                writeVarint(batch, static_cast<quint64>(messages[i].size()));
+                batch.append(messages[i]);
+            }
+            datagrams.append({std::move(batch), static_cast<int>(end - first)});
+        }
+        first = end;
+        size = 1;
+    };
+    for (qsizetype i = 0; i < messages.size(); ++i) {
+        const qsizetype entry = varintSize(static_cast<quint64>(messages[i].size()))
+                                + messages[i].size();
+        if (i > first && size + entry > mtu)
+            close(i);
+        size += entry;
+    }
+    close(messages.size());
+    return datagrams;
+}
+
+bool splitBatch(const char *data, qsizetype size, QVector<QByteArrayView> &messages)
+{
+    if (!isBatch(data, size))
+        return false;
+    const char *p = data + 1;
+    const char *end = data + size;
+    while (p < end) {
+        quint64 len;
+        if (!readVarint(p, end, len) || len == 0 || len > static_cast<quint64>(end - p))
+            return false;
+        messages.append(QByteArrayView(p, static_cast<qsizetype>(len)));
+        p += len;
+    }
+    return !messages.isEmpty();
+}
+
+void writeValue(QByteArray &out, const QVariant &value)
+{
+    switch (value.typeId()) {
+    case QMetaType::UnknownType:
+    case QMetaType::Nullptr:
+        out.append(static_cast<char>(TagNull));
+        break;
+    case QMetaType::Bool:
+        out.append(static_cast<char>(value.toBool() ? TagTrue : TagFalse));
+        break;
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::Long:
+    case QMetaType::LongLong:
+    case QMetaType::Short:
+    case QMetaType::UShort:
+    case QMetaType::Char:
+    case QMetaType::SChar:
+    case QMetaType::UChar:
+        writeInt(out, value.toLongLong());
+        break;
+    case QMetaType::ULong:
+    case QMetaType::ULongLong: {
+        const qulonglong u = value.toULongLong();
+        if (u <= static_cast<qulonglong>(std::numeric_limits<qint64>::max()))
+            writeInt(out, static_cast<qint64>(u));
+        else
+            writeDouble(out, static_cast<double>(u));
+        break;
+    }
+    case QMetaType::Double:
+    case QMetaType::Float:
+        writeDouble(out, value.toDouble());
+        break;
+    case QMetaType::QString:
+        out.append(static_cast<char>(TagString));
+        writeString(out, value.toString());
+        break;
+    case QMetaType::QStringList: {
+        const QStringList list = value.toStringList();
+        out.append(static_cast<char>(TagList));
+        writeVarint(out, static_cast<quint64>(list.size()));
+        for (const QString &s : list) {
+            out.append(static_cast<char>(TagString));
+            writeString(out, s);
+        }
+        break;
+    }
+    case QMetaType::QVariantList: {
+        const QVariantList list = value.toList();
+        out.append(static_cast<char>(TagList));
+        writeVarint(out, static_cast<quint64>(list.size()));
+        for (const QVariant &item : list)
+            writeValue(out, item);
+        break;
+    }
+    case QMetaType::QVariantMap:
+    case QMetaType::QVariantHash:
+        writeMap(out, value.toMap());
+        break;
+    default:
+        // Everything else travels the way the JSON encoding sends it.
+        writeValue(out, QJsonValue::fromVariant(value).toVariant());
+        break;
+    }
+}
+
+bool readValue(const char *&p, const char *end, QVariant &value)
+{
+    return readValueAt(p, end, value, 0);
+}
+
+} // namespace WireFormat
+
+const QByteArray &WireMessage::bytes(WireFormat::Format format) const
+{
+    QByteArray &encoded = encoded_[format];
+    if (encoded.isEmpty())
+        encoded = WireFormat::encode(env_, format);
+    return encoded;
+}
@@ -0,0 +1,119 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+#pragma once
+
+#include <QByteArray>
+#include <QString>
+#include <QVariant>
+#include <QVariantMap>
+#include <QVector>
+#include <utility>
+
+/*
+ * Wire format of ClayNetwork data channel messages.
+ *
+ * Every message is an envelope (type, optional state sequence number,
+ * relaying origin, payload) that travels in one of two encodings:
+ *
+ *   Json    {"t":"s","q":7,"from":"...","d":{...}} - what PeerJS peers in
+ *           JSON serialization mode (the browser build) speak, and what
+ *           every node speaks until both ends agreed on something else.
+ *   Binary  kMagic, type, flags, [varint seq], [string from], payload as
+ *           a tagged value (see below). Peers announce support with a
+ *           {"t":"y","sys":"wire","formats":["b1"]} hello when the data
+ *           channel opens and switch to it once the other side did too.
+ *
+ * Receivers accept both at any time: kMagic can never start UTF-8 text.
+ *
+ * Schema-compressed state ('d', see state_schema.h) additionally carries
+ * the sequence number of the baseline it is relative to (0 for a
+ * keyframe) and the bit-packed schema fields, after `from`:
+ * varint baseline, varint length + packed bytes. Receivers acknowledge
+ * baselines with 'a' envelopes: seq is the state received, from its
+ * origin as the state named it. Both only go to peers that announced the
+ * same schema over the binary encoding.
+ *
+ * Peers that also list kBatchName in their hello accept batches: several
+ * binary envelopes in one datagram, as kBatchMagic followed by varint
+ * length + envelope per message (see packBatches()).
+ *
+ * Tagged values: one tag byte, then
+ *   Null, False, True         nothing
+ *   Int                       zigzag LEB128 varint
+ *   Float32 / Float64         little-endian IEEE 754 (float when exact)
+ *   String                    varint byte length + UTF-8
+ *   List                      varint count + values
+ *   Map                       varint count + (varint length + UTF-8 key,
+ *                             value) pairs
+ * Whole-number doubles go out as Int and non-finite ones as Null, so a
+ * payload decodes to the same QVariants whichever encoding carried it.
+ */
+
+struct WireEnvelope
+{
+    char type = 'm';        // m message, s state, d delta state, a ack,
+                            // p/P ping/pong, R reject, y system
+    bool hasSeq = false;
+    quint32 seq = 0;        // per-sender state sequence ("q")
+    QString from;           // origin node, set when the host relays
+    QVariantMap payload;    // "d" of m/s/d; the remaining fields otherwise
+    quint32 baseline = 0;   // d only: state this one is relative to
+    QByteArray packed;      // d only: schema fields
+};
+
+namespace WireFormat {
+
+enum Format { Json, Binary };
+
+constexpr char kMagic = '\xC1';
+constexpr char kBinaryName[] = "b1";   // name in the hello's "formats"
+
+constexpr char kBatchMagic = '\xC0';   // like kMagic, never valid UTF-8
+constexpr char kBatchName[] = "batch1";
+// Batches fit one SCTP packet at the 1280-byte IPv6 minimum MTU, after
+// the IP, UDP, DTLS and SCTP headers.
+constexpr qsizetype kBatchMtu = 1150;
+
+QByteArray encode(const WireEnvelope &env, Format format);
+
+// Either encoding; false when the bytes are neither.
+bool decode(const char *data, qsizetype size, WireEnvelope &env);
+
+struct Datagram
+{
+    QByteArray bytes;
+    int messages = 0;
+};
+
+// Packs encoded messages, in order, into as few datagrams of at most `mtu`
+// bytes as possible. A message that shares its datagram with no other goes
+// out alone and unframed - also when it is bigger than `mtu` by itself.
+QVector<Datagram> packBatches(const QVector<QByteArray> &messages, qsizetype mtu = kBatchMtu);
+
+inline bool isBatch(const char *data, qsizetype size)
+{
+    return size > 0 && data[0] == kBatchMagic;
+}
+
+// The messages of a batch, pointing into `data`; false when malformed.
+bool splitBatch(const char *data, qsizetype size, QVector<QByteArrayView> &messages);
+
+// The tagged value encoding alone.
+void writeValue(QByteArray &out, const QVariant &value);
+bool readValue(const char *&p, const char *end, QVariant &value);
+
+} // namespace WireFormat
+
+// One outgoing message, encoded at most once per format however many
+// peers it goes to.
+class WireMessage
+{
+public:
+    explicit WireMessage(WireEnvelope env) : env_(std::move(env)) {}
+
+    const WireEnvelope &envelope() const { return env_; }
+    const QByteArray &bytes(WireFormat::Format format) const;
+
+private:
+    WireEnvelope env_;
+    mutable QByteArray encoded_[2];
+};
@@ -0,0 +1,290 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "audio_bounce.h"
+
+#include "chipmood.h"
+#include "engine/bounce.h"
+#include "note_target.h"
+#include "song/song_schedule.h"
+#include "song_player.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QThreadPool>
+#include <QUrl>
+#include <QtConcurrent/QtConcurrentRun>
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace cs = clay::sound;
+
+struct AudioBounce::Job
+{
+    std::vector<cs::BounceStem> stems;
+    cs::BounceOptions options;
+    std::vector<std::unique_ptr<cs::BounceProgress>> progress;   // one per stem
+    QVector<QString> errors;                   // one per stem, written by its task
+    int64_t totalFrames = 0;
+};
+
+namespace {
+
+QString localPath(const QString &path)
+{
+    const QUrl url(path);
+    return url.isLocalFile() ? url.toLocalFile() : path;
+}
+
+// level1.wav + "lead" -> level1-lead.wav
+QString stemPath(const QString &path, const QString &track)
+{
+    static const QRegularExpression unsafe(QStringLiteral("[^A-Za-z0-9_.-]"));
+    const QFileInfo info(path);
+    QString name = track;
+    name.replace(unsafe, QStringLiteral("_"));
+    const QString suffix = info.suffix().isEmpty() ? QStringLiteral("wav") : info.suffix();
+    return info.dir().filePath(QStringLiteral("%1-%2.%3").arg(info.completeBaseName(), name, suffix));
+}
+
+} // namespace
+
+AudioBounce::AudioBounce(QObject *parent)
+    : QObject(parent)
+{
+    pollTimer_.setInterval(50);
+    connect(&pollTimer_, &QTimer::timeout, this, &AudioBounce::poll);
+}
+
+AudioBounce::~AudioBounce()
+{
+    if (!job_) return;
+    for (auto &p : job_->progress) p->cancel.store(true, std::memory_order_relaxed);
+    for (auto &f : futures_) f.waitForFinished();
+}
+
+void AudioBounce::setSampleFormat(const QString &f)
+{
+    if (sampleFormat_ == f) return;
+    sampleFormat_ = f;
+    emit sampleFormatChanged();
+}
+
+void AudioBounce::setChannels(int c)
+{
+    c = std::clamp(c, 1, 2);
+    if (channels_ == c) return;
+    channels_ = c;
+    emit channelsChanged();
+}
+
+void AudioBounce::setSampleRate(int r)
+{
+    r = std::clamp(r, 8000, 192000);
+    if (sampleRate_ == r) return;
+    sampleRate_ = r;
+    emit sampleRateChanged();
+}
+
+void AudioBounce::setTail(qreal seconds)
+{
+    seconds = std::max<qreal>(0.0, seconds);
+    if (tail_ == seconds) return;
+    tail_ = seconds;
+    emit tailChanged();
+}
+
+void AudioBounce::setStems(bool s)
+{
+    if (stems_ == s) return;
+    stems_ = s;
+    emit stemsChanged();
+}
+
+void AudioBounce::setLimiter(bool l)
+{
+    if (limiter_ == l) return;
+    limiter_ = l;
+    emit limiterChanged();
+}
+
+bool AudioBounce::bounceSong(SongPlayer *player, const QString &path)
+{
+    if (running()) { setError(QStringLiteral("bounce already running")); return false; }
+    if (!player || !player->loaded()) { setError(QStringLiteral("no song loaded")); return false; }
+    if (path.isEmpty()) { setError(QStringLiteral("no output path")); return false; }
+
+    const cs::SongModel &model = player->model();
+    QVector<cs::SongNote> notes;
+    const double totalBeats = cs::flattenSong(model, notes);
+    const double framesPerBeat = 60.0 / model.tempo * sampleRate_;
+
+    auto job = std::make_unique<Job>();
+    const QString out = localPath(path);
+    const QStringList trackNames = model.tracks.keys();
+
+    // Instrument copies, per track; -1 for tracks that cannot be bounced.
+    std::vector<cs::BounceInstrument> instruments;
+    std::vector<int> trackInstrument(static_cast<size_t>(trackNames.size()), -1);
+    for (int t = 0; t < trackNames.size(); ++t) {
+        auto *target = qobject_cast<NoteTarget *>(player->trackInstrument(t));
+        cs::BounceInstrument bi;
+        if (!target || !target->bounceSnapshot(&bi)) {
+            qWarning() << "AudioBounce: skipping track" << trackNames[t]
+                       << "(no SynthInstrument or loaded SampleInstrument bound)";
+            continue;
+        }
+        trackInstrument[static_cast<size_t>(t)] = static_cast<int>(instruments.size());
+        instruments.push_back(std::move(bi));
+    }
+    if (instruments.empty()) { setError(QStringLiteral("no track can be bounced")); return false; }
+
+    const int64_t frames = std::llround(totalBeats * framesPerBeat + tail_ * sampleRate_);
+    auto noteFor = [&](const cs::SongNote &sn, int instrument) {
+        cs::BounceNote n;
+        n.frame          = std::llround(sn.beat * framesPerBeat);
+        n.durationFrames = std::llround(sn.durBeats * framesPerBeat);
+        n.freqHz         = 440.0 * std::pow(2.0, (sn.midi - 69) / 12.0);
+        n.velocity       = static_cast<float>(std::clamp(sn.vel, 0.0, 1.0));
+        n.instrument     = instrument;
+        return n;
+    };
+
+    if (stems_) {
+        for (int t = 0; t < trackNames.size(); ++t) {
+            const int inst = trackInstrument[static_cast<size_t>(t)];
+            if (inst < 0) continue;
+            cs::BounceStem stem;
+            stem.path = stemPath(out, trackNames[t]).toStdString();
+            stem.instruments = { instruments[static_cast<size_t>(inst)] };
+            stem.frames = frames;
+            for (const auto &sn : std::as_const(notes))
+                if (sn.track == t) stem.notes.push_back(noteFor(sn, 0));
+            job->stems.push_back(std::move(stem));
+        }
+    } else {
+        cs::BounceStem stem;
+        stem.path = out.toStdString();
+        stem.instruments = std::move(instruments);
+        stem.frames = frames;
+        for (const auto &sn : std::as_const(notes)) {
+            if (sn.track < 0 || sn.track >= trackNames.size()) continue;
+            const int inst = trackInstrument[static_cast<size_t>(sn.track)];
+            if (inst >= 0) stem.notes.push_back(noteFor(sn, inst));
+        }
+        job->stems.push_back(std::move(stem));
+    }
+    return start(std::move(job));
+}
+
+bool AudioBounce::bounceMood(ChipMood *mood, const QString &path)
+{
+    if (running()) { setError(QStringLiteral("bounce already running")); return false; }
+    if (!mood) { setError(QStringLiteral("no ChipMood")); return false; }
+    if (path.isEmpty()) { setError(QStringLiteral("no output path")); return false; }
+
+    auto job = std::make_unique<Job>();
+    cs::BounceStem stem;
+    if (!mood->bounceStem(&stem, sampleRate_, tail_)) {
+        setError(QStringLiteral("ChipMood has no composition (preset not set?)"));
+        return false;
+    }
+    stem.path = localPath(path).toStdString();
+    job->stems.push_back(std::move(stem));
+    return start(std::move(job));
+}
+
+void AudioBounce::cancel()
+{
+    if (!job_) return;
+    for (auto &p : job_->progress) p->cancel.store(true, std::memory_order_relaxed);
+}
+
+bool AudioBounce::start(std::unique_ptr<Job> job)
+{
+    job->options.sampleRate = sampleRate_;
+    job->options.channels = channels_;
+    job->options.encoding = sampleFormat_ == QLatin1String("float32")
+                                ? cs::WavWriter::Encoding::Float32
+                                : cs::WavWriter::Encoding::Int16;
+    job->options.limiter = limiter_;
+    for (size_t i = 0; i < job->stems.size(); ++i)
+        job->progress.push_back(std::make_unique<cs::BounceProgress>());
+    job->errors.resize(static_cast<int>(job->stems.size()));
+    for (const auto &stem : job->stems) job->totalFrames += stem.frames;
+
+    job_ = std::move(job);
+    futures_.clear();
+    outputs_.clear();
+    setError(QString());
+    progress_ = 0.0;
+    emit progressChanged();
+    emit runningChanged();
+
+    Job *j = job_.get();
+    for (size_t i = 0; i < j->stems.size(); ++i) {
+        auto task = [j, i] {
+            std::string err;
+            if (!cs::renderStem(j->stems[i], j->options, *j->progress[i], &err))
+                j->errors[static_cast<int>(i)] = QString::fromStdString(err);
+        };
+#if QT_CONFIG(thread) && !defined(Q_OS_WASM)
+        futures_.append(QtConcurrent::run(QThreadPool::globalInstance(), task));
+#else
+        task();
+#endif
+    }
+    // Report through the event loop even when the stems rendered inline.
+    pollTimer_.start();
+    return true;
+}
+
+void AudioBounce::poll()
+{
+    if (!job_) return;
+
+    int64_t done = 0;
+    for (const auto &p : job_->progress) done += p->frames.load(std::memory_order_relaxed);
+    const qreal progress = job_->totalFrames > 0
+                               ? static_cast<qreal>(done) / static_cast<qreal>(job_->totalFrames)
+                               : 1.0;
+    if (progress != progress_) {
+        progress_ = progress;
+        emit progressChanged();
+    }
+
+    for (const auto &f : std::as_const(futures_))
+        if (!f.isFinished()) return;
+
+    pollTimer_.stop();
+    QString failure;
+    QStringList paths;
+    for (size_t i = 0; i < job_->stems.size(); ++i) {
+        const QString &err = job_->errors[static_cast<int>(i)];
+        const QString path = QString::fromStdString(job_->stems[i].path);
+        if (err.isEmpty()) paths.append(path);
+        else if (failure.isEmpty()) failure = QStringLiteral("%1: %2").arg(path, err);
+    }
+    job_.reset();
+    futures_.clear();
+    emit runningChanged();
+
+    if (!failure.isEmpty()) {
+        setError(failure);
+        emit failed(failure);
+        return;
+    }
+    outputs_ = paths;
+    emit finished(paths);
+}
+
+void AudioBounce::setError(const QString &err)
+{
+    if (error_ == err) return;
+    error_ = err;
+    emit errorChanged();
+}
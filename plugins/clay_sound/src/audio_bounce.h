@@ -0,0 +1,123 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// AudioBounce — renders a song or a ChipMood composition to WAV files
+// offline, much faster than real time, without touching the live
+// output. What to play is copied on the GUI thread (the SongPlayer's
+// notes and a bounceSnapshot() of each track's instrument); the
+// rendering itself runs on private engines in the global thread pool
+// (see clay::sound::renderStem()). With `stems` set, every song track
+// is written to its own file and the tracks render in parallel, one
+// per core; otherwise the song is mixed into one file.
+//
+//   AudioBounce {
+//       id: bounce
+//       stems: true
+//       onFinished: (paths) => console.log("baked", paths)
+//   }
+//   Button { onClicked: bounce.bounceSong(player, "/tmp/level1.wav") }
+//
+// Stems are named after the output file: level1-lead.wav, level1-bass.wav.
+// Without thread support (WASM) the bounce runs on the calling thread.
+
+#ifndef CLAY_SOUND_AUDIO_BOUNCE_H
+#define CLAY_SOUND_AUDIO_BOUNCE_H
+
+#include <QFuture>
+#include <QObject>
+#include <QQmlEngine>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+#include <memory>
+
+class ChipMood;
+class SongPlayer;
+
+class AudioBounce : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+
+    // "int16" or "float32" samples.
+    Q_PROPERTY(QString     sampleFormat READ sampleFormat WRITE setSampleFormat NOTIFY sampleFormatChanged)
+    Q_PROPERTY(int         channels     READ channels     WRITE setChannels     NOTIFY channelsChanged)
+    Q_PROPERTY(int         sampleRate   READ sampleRate   WRITE setSampleRate   NOTIFY sampleRateChanged)
+    // Seconds rendered after the last note ends, for releases and echoes.
+    Q_PROPERTY(qreal       tail         READ tail         WRITE setTail         NOTIFY tailChanged)
+    Q_PROPERTY(bool        stems        READ stems        WRITE setStems        NOTIFY stemsChanged)
+    Q_PROPERTY(bool        limiter      READ limiter      WRITE setLimiter      NOTIFY limiterChanged)
+    Q_PROPERTY(bool        running      READ running      NOTIFY runningChanged)
+    Q_PROPERTY(qreal       progress     READ progress     NOTIFY progressChanged)   // 0..1
+    Q_PROPERTY(QString     error        READ error        NOTIFY errorChanged)
+    Q_PROPERTY(QStringList outputs      READ outputs      NOTIFY finished)
+
+public:
+    explicit AudioBounce(QObject *parent = nullptr);
+    ~AudioBounce() override;
+
+    QString     sampleFormat() const { return sampleFormat_; }
+    void        setSampleFormat(const QString &f);
+    int         channels() const { return channels_; }
+    void        setChannels(int c);
+    int         sampleRate() const { return sampleRate_; }
+    void        setSampleRate(int r);
+    qreal       tail() const { return tail_; }
+    void        setTail(qreal seconds);
+    bool        stems() const { return stems_; }
+    void        setStems(bool s);
+    bool        limiter() const { return limiter_; }
+    void        setLimiter(bool l);
+    bool        running() const { return job_ != nullptr; }
+    qreal       progress() const { return progress_; }
+    QString     error() const { return error_; }
+    QStringList outputs() const { return outputs_; }
+
+    // Render the song loaded in `player`, through the instruments bound
+    // to its tracks, into `path`. Returns false (and sets `error`) if a
+    // bounce is already running or there is nothing to render.
+    Q_INVOKABLE bool bounceSong(SongPlayer *player, const QString &path);
+
+    // Render one loop of `mood`'s current composition into `path`.
+    Q_INVOKABLE bool bounceMood(ChipMood *mood, const QString &path);
+
+    // Stop a running bounce; partial files are removed.
+    Q_INVOKABLE void cancel();
+
+signals:
+    void sampleFormatChanged();
+    void channelsChanged();
+    void sampleRateChanged();
+    void tailChanged();
+    void stemsChanged();
+    void limiterChanged();
+    void runningChanged();
+    void progressChanged();
+    void errorChanged();
+    void finished(const QStringList &paths);
+    void failed(const QString &message);
+
+private:
+    struct Job;
+
+    bool start(std::unique_ptr<Job> job);
+    void poll();
+    void setError(const QString &err);
+
+    QString sampleFormat_ = QStringLiteral("int16");
+    int     channels_ = 2;
+    int     sampleRate_ = 44100;
+    qreal   tail_ = 2.0;
+    bool    stems_ = false;
+    bool    limiter_ = true;
+
+    std::unique_ptr<Job> job_;
+    QVector<QFuture<void>> futures_;      // one per stem
+    QTimer  pollTimer_;
+    qreal   progress_ = 0.0;
+    QString error_;
+    QStringList outputs_;
+};
+
+#endif // CLAY_SOUND_AUDIO_BOUNCE_H
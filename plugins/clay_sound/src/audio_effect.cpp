@@ -0,0 +1,247 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "audio_effect.h"
+
+#include "audio_output.h"
+#include "engine/biquad_filter.h"
+#include "engine/feedback_delay.h"
+#include "engine/fdn_reverb.h"
+
+#include <algorithm>
+
+namespace cs = clay::sound;
+
+namespace {
+
+cs::BiquadFilter::Type mapFilterType(const QString &name)
+{
+    using T = cs::BiquadFilter::Type;
+    if (name == "highpass") return T::HighPass;
+    if (name == "bandpass") return T::BandPass;
+    if (name == "notch") return T::Notch;
+    if (name == "peak") return T::Peak;
+    if (name == "lowshelf") return T::LowShelf;
+    if (name == "highshelf") return T::HighShelf;
+    if (name == "onepole") return T::OnePoleLowPass;
+    return T::LowPass;
+}
+
+} // namespace
+
+// --- AudioEffect -------------------------------------------------------
+
+AudioEffect::AudioEffect(QObject *parent)
+    : QObject(parent)
+{
+    connect(&cs::AudioOutput::instance(), &cs::AudioOutput::statsChanged,
+            this, &AudioEffect::onStatsChanged);
+}
+
+AudioEffect::~AudioEffect()
+{
+    cs::AudioOutput::instance().unregisterEffect(id_);
+}
+
+bool AudioEffect::attach(std::unique_ptr<cs::IEffect> effect)
+{
+    cs::IEffect *core = effect.get();
+    id_ = cs::AudioOutput::instance().registerEffect(std::move(effect), bus_);
+    if (id_ < 0) {
+        qWarning("AudioEffect: out of effect slots; effect is inactive");
+        return false;
+    }
+    core_ = core;
+    return true;
+}
+
+void AudioEffect::setBus(int b)
+{
+    b = std::clamp(b, cs::Engine::kMasterBus, cs::Engine::kMaxBuses - 1);
+    if (bus_ == b) return;
+    bus_ = b;
+    cs::AudioOutput::instance().setEffectBus(id_, b);
+    emit busChanged();
+}
+
+void AudioEffect::setEnabled(bool e)
+{
+    if (enabled_ == e) return;
+    enabled_ = e;
+    if (core_) core_->setBypassed(!e);
+    emit enabledChanged();
+}
+
+void AudioEffect::onStatsChanged()
+{
+    const qreal l = cs::AudioOutput::instance().effectLoad(id_);
+    if (l == load_) return;
+    load_ = l;
+    emit loadChanged();
+}
+
+// --- FilterEffect ------------------------------------------------------
+
+FilterEffect::FilterEffect(QObject *parent)
+    : AudioEffect(parent)
+{
+    auto filter = std::make_unique<cs::BiquadFilter>(cs::AudioOutput::instance().sampleRate());
+    filter->setType(mapFilterType(type_));
+    filter->setFrequency(static_cast<float>(frequency_));
+    filter->setQ(static_cast<float>(q_));
+    filter->setGainDb(static_cast<float>(gain_));
+    filter->setStages(stages_);
+    cs::BiquadFilter *raw = filter.get();
+    if (attach(std::move(filter))) filter_ = raw;
+}
+
+void FilterEffect::setType(const QString &t)
+{
+    if (type_ == t) return;
+    type_ = t;
+    if (filter_) filter_->setType(mapFilterType(t));
+    emit typeChanged();
+}
+
+void FilterEffect::setFrequency(qreal hz)
+{
+    hz = std::max(10.0, hz);
+    if (frequency_ == hz) return;
+    frequency_ = hz;
+    if (filter_) filter_->setFrequency(static_cast<float>(hz));
+    emit frequencyChanged();
+}
+
+void FilterEffect::setQ(qreal q)
+{
+    q = std::max(0.05, q);
+    if (q_ == q) return;
+    q_ = q;
+    if (filter_) filter_->setQ(static_cast<float>(q));
+    emit qChanged();
+}
+
+void FilterEffect::setGain(qreal db)
+{
+    if (gain_ == db) return;
+    gain_ = db;
+    if (filter_) filter_->setGainDb(static_cast<float>(db));
+    emit gainChanged();
+}
+
+void FilterEffect::setStages(int n)
+{
+    n = std::clamp(n, 1, cs::BiquadFilter::kMaxStages);
+    if (stages_ == n) return;
+    stages_ = n;
+    if (filter_) filter_->setStages(n);
+    emit stagesChanged();
+}
+
+// --- DelayEffect -------------------------------------------------------
+
+DelayEffect::DelayEffect(QObject *parent)
+    : AudioEffect(parent)
+{
+    auto delay = std::make_unique<cs::FeedbackDelay>(cs::AudioOutput::instance().sampleRate());
+    delay->setTime(static_cast<float>(time_));
+    delay->setFeedback(static_cast<float>(feedback_));
+    delay->setMix(static_cast<float>(mix_));
+    delay->setDamping(static_cast<float>(damping_));
+    delay->setPingPong(pingPong_);
+    cs::FeedbackDelay *raw = delay.get();
+    if (attach(std::move(delay))) delay_ = raw;
+}
+
+void DelayEffect::setTime(qreal seconds)
+{
+    seconds = std::clamp(seconds, 0.001, 2.0);
+    if (time_ == seconds) return;
+    time_ = seconds;
+    if (delay_) delay_->setTime(static_cast<float>(seconds));
+    emit timeChanged();
+}
+
+void DelayEffect::setFeedback(qreal f)
+{
+    f = std::clamp(f, 0.0, 0.95);
+    if (feedback_ == f) return;
+    feedback_ = f;
+    if (delay_) delay_->setFeedback(static_cast<float>(f));
+    emit feedbackChanged();
+}
+
+void DelayEffect::setMix(qreal m)
+{
+    m = std::clamp(m, 0.0, 1.0);
+    if (mix_ == m) return;
+    mix_ = m;
+    if (delay_) delay_->setMix(static_cast<float>(m));
+    emit mixChanged();
+}
+
+void DelayEffect::setDamping(qreal d)
+{
+    d = std::clamp(d, 0.0, 1.0);
+    if (damping_ == d) return;
+    damping_ = d;
+    if (delay_) delay_->setDamping(static_cast<float>(d));
+    emit dampingChanged();
+}
+
+void DelayEffect::setPingPong(bool p)
+{
+    if (pingPong_ == p) return;
+    pingPong_ = p;
+    if (delay_) delay_->setPingPong(p);
+    emit pingPongChanged();
+}
+
+// --- ReverbEffect ------------------------------------------------------
+
+ReverbEffect::ReverbEffect(QObject *parent)
+    : AudioEffect(parent)
+{
+    auto reverb = std::make_unique<cs::FdnReverb>(cs::AudioOutput::instance().sampleRate());
+    reverb->setDecay(static_cast<float>(decay_));
+    reverb->setSize(static_cast<float>(size_));
+    reverb->setDamping(static_cast<float>(damping_));
+    reverb->setMix(static_cast<float>(mix_));
+    cs::FdnReverb *raw = reverb.get();
+    if (attach(std::move(reverb))) reverb_ = raw;
+}
+
+void ReverbEffect::setDecay(qreal seconds)
+{
+    seconds = std::clamp(seconds, 0.1, 20.0);
+    if (decay_ == seconds) return;
+    decay_ = seconds;
+    if (reverb_) reverb_->setDecay(static_cast<float>(seconds));
+    emit decayChanged();
+}
+
+void ReverbEffect::setSize(qreal s)
+{
+    s = std::clamp(s, 0.25, 1.0);
+    if (size_ == s) return;
+    size_ = s;
+    if (reverb_) reverb_->setSize(static_cast<float>(s));
+    emit sizeChanged();
+}
+
+void ReverbEffect::setDamping(qreal d)
+{
+    d = std::clamp(d, 0.0, 1.0);
+    if (damping_ == d) return;
+    damping_ = d;
+    if (reverb_) reverb_->setDamping(static_cast<float>(d));
+    emit dampingChanged();
+}
+
+void ReverbEffect::setMix(qreal m)
+{
+    m = std::clamp(m, 0.0, 1.0);
+    if (mix_ == m) return;
+    mix_ = m;
+    if (reverb_) reverb_->setMix(static_cast<float>(m));
+    emit mixChanged();
+}
@@ -0,0 +1,195 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// AudioEffect — QML-facing insert effect on a mix bus of the shared
+// engine (see clay::sound::Engine). Each subclass registers its engine
+// effect with AudioOutput on construction and keeps a raw pointer to it
+// for the atomic parameters, like the instruments do with their cores.
+// Effects on one bus run in the order they were created; `bus: -1`
+// places an effect on the master, ahead of the limiter.
+//
+//   FilterEffect { bus: 1; type: "lowpass"; frequency: 800 }
+//   ReverbEffect { bus: 2; mix: 1.0 }
+//   Component.onCompleted: AudioMixer.setBusSend(1, 2, 0.3)
+
+#ifndef CLAY_SOUND_AUDIO_EFFECT_H
+#define CLAY_SOUND_AUDIO_EFFECT_H
+
+#include <QObject>
+#include <QQmlEngine>
+#include <QString>
+
+#include <memory>
+
+namespace clay::sound {
+class IEffect;
+class BiquadFilter;
+class FeedbackDelay;
+class FdnReverb;
+}
+
+class AudioEffect : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+    QML_UNCREATABLE("AudioEffect is the base type of FilterEffect, DelayEffect and ReverbEffect")
+
+    Q_PROPERTY(int   bus     READ bus     WRITE setBus     NOTIFY busChanged)
+    Q_PROPERTY(bool  enabled READ enabled WRITE setEnabled NOTIFY enabledChanged)
+    // Fraction of real time the render thread spends in this effect.
+    Q_PROPERTY(qreal load    READ load    NOTIFY loadChanged)
+
+public:
+    ~AudioEffect() override;
+
+    int   bus() const { return bus_; }
+    void  setBus(int b);
+    bool  enabled() const { return enabled_; }
+    void  setEnabled(bool e);
+    qreal load() const { return load_; }
+
+signals:
+    void busChanged();
+    void enabledChanged();
+    void loadChanged();
+
+protected:
+    explicit AudioEffect(QObject *parent = nullptr);
+
+    // Hand the engine effect to AudioOutput. Called once by subclasses;
+    // false (and the effect is gone) when no effect slot was free.
+    bool attach(std::unique_ptr<clay::sound::IEffect> effect);
+
+private:
+    void onStatsChanged();
+
+    clay::sound::IEffect *core_ = nullptr;
+    int   id_ = -1;
+    int   bus_ = 0;
+    bool  enabled_ = true;
+    qreal load_ = 0.0;
+};
+
+// Biquad filter: "lowpass", "highpass", "bandpass", "notch", "peak",
+// "lowshelf", "highshelf" or "onepole" (a gentle 6 dB/octave low-pass);
+// `stages` cascades up to four sections.
+class FilterEffect : public AudioEffect
+{
+    Q_OBJECT
+    QML_ELEMENT
+
+    Q_PROPERTY(QString type      READ type      WRITE setType      NOTIFY typeChanged)
+    Q_PROPERTY(qreal   frequency READ frequency WRITE setFrequency NOTIFY frequencyChanged)
+    Q_PROPERTY(qreal   q         READ q         WRITE setQ         NOTIFY qChanged)
+    Q_PROPERTY(qreal   gain      READ gain      WRITE setGain      NOTIFY gainChanged)
+    Q_PROPERTY(int     stages    READ stages    WRITE setStages    NOTIFY stagesChanged)
+
+public:
+    explicit FilterEffect(QObject *parent = nullptr);
+
+    QString type() const { return type_; }
+    void    setType(const QString &t);
+    qreal   frequency() const { return frequency_; }
+    void    setFrequency(qreal hz);
+    qreal   q() const { return q_; }
+    void    setQ(qreal q);
+    qreal   gain() const { return gain_; }       // dB, peak and shelves
+    void    setGain(qreal db);
+    int     stages() const { return stages_; }
+    void    setStages(int n);
+
+signals:
+    void typeChanged();
+    void frequencyChanged();
+    void qChanged();
+    void gainChanged();
+    void stagesChanged();
+
+private:
+    clay::sound::BiquadFilter *filter_ = nullptr;
+    QString type_ = QStringLiteral("lowpass");
+    qreal   frequency_ = 1000.0;
+    qreal   q_ = 0.7071;
+    qreal   gain_ = 0.0;
+    int     stages_ = 1;
+};
+
+// Feedback echo, up to two seconds.
+class DelayEffect : public AudioEffect
+{
+    Q_OBJECT
+    QML_ELEMENT
+
+    Q_PROPERTY(qreal time     READ time     WRITE setTime     NOTIFY timeChanged)
+    Q_PROPERTY(qreal feedback READ feedback WRITE setFeedback NOTIFY feedbackChanged)
+    Q_PROPERTY(qreal mix      READ mix      WRITE setMix      NOTIFY mixChanged)
+    Q_PROPERTY(qreal damping  READ damping  WRITE setDamping  NOTIFY dampingChanged)
+    Q_PROPERTY(bool  pingPong READ pingPong WRITE setPingPong NOTIFY pingPongChanged)
+
+public:
+    explicit DelayEffect(QObject *parent = nullptr);
+
+    qreal time() const { return time_; }
+    void  setTime(qreal seconds);
+    qreal feedback() const { return feedback_; }
+    void  setFeedback(qreal f);
+    qreal mix() const { return mix_; }
+    void  setMix(qreal m);
+    qreal damping() const { return damping_; }
+    void  setDamping(qreal d);
+    bool  pingPong() const { return pingPong_; }
+    void  setPingPong(bool p);
+
+signals:
+    void timeChanged();
+    void feedbackChanged();
+    void mixChanged();
+    void dampingChanged();
+    void pingPongChanged();
+
+private:
+    clay::sound::FeedbackDelay *delay_ = nullptr;
+    qreal time_ = 0.25;
+    qreal feedback_ = 0.35;
+    qreal mix_ = 0.3;
+    qreal damping_ = 0.2;
+    bool  pingPong_ = false;
+};
+
+// Feedback delay network reverb. On a send bus set `mix` to 1.
+class ReverbEffect : public AudioEffect
+{
+    Q_OBJECT
+    QML_ELEMENT
+
+    Q_PROPERTY(qreal decay   READ decay   WRITE setDecay   NOTIFY decayChanged)
+    Q_PROPERTY(qreal size    READ size    WRITE setSize    NOTIFY sizeChanged)
+    Q_PROPERTY(qreal damping READ damping WRITE setDamping NOTIFY dampingChanged)
+    Q_PROPERTY(qreal mix     READ mix     WRITE setMix     NOTIFY mixChanged)
+
+public:
+    explicit ReverbEffect(QObject *parent = nullptr);
+
+    qreal decay() const { return decay_; }       // RT60 in seconds
+    void  setDecay(qreal seconds);
+    qreal size() const { return size_; }
+    void  setSize(qreal s);
+    qreal damping() const { return damping_; }
+    void  setDamping(qreal d);
+    qreal mix() const { return mix_; }
+    void  setMix(qreal m);
+
+signals:
+    void decayChanged();
+    void sizeChanged();
+    void dampingChanged();
+    void mixChanged();
+
+private:
+    clay::sound::FdnReverb *reverb_ = nullptr;
+    qreal decay_ = 1.5;
+    qreal size_ = 0.7;
+    qreal damping_ = 0.4;
+    qreal mix_ = 0.25;
+};
+
+#endif // CLAY_SOUND_AUDIO_EFFECT_H
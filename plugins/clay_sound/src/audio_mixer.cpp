@@ -0,0 +1,126 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "audio_mixer.h"
+
+#include "audio_output.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace cs = clay::sound;
+
+namespace {
+
+cs::Vec3 toVec3(const QVector3D &v) { return { v.x(), v.y(), v.z() }; }
+
+} // namespace
+
+AudioMixer::AudioMixer(QObject *parent)
+    : QObject(parent)
+{
+    connect(&cs::AudioOutput::instance(), &cs::AudioOutput::statsChanged, this, [this] {
+        const qreal r = limiterReduction();
+        if (r == reduction_) return;
+        reduction_ = r;
+        emit limiterReductionChanged();
+    });
+}
+
+int AudioMixer::channels() const
+{
+    return cs::AudioOutput::instance().channels();
+}
+
+int AudioMixer::busCount() const
+{
+    return cs::Engine::kMaxBuses;
+}
+
+int AudioMixer::masterBus() const
+{
+    return cs::Engine::kMasterBus;
+}
+
+void AudioMixer::setListenerPosition(const QVector3D &p)
+{
+    if (position_ == p) return;
+    position_ = p;
+    pushListener();
+}
+
+void AudioMixer::setListenerForward(const QVector3D &f)
+{
+    if (forward_ == f) return;
+    forward_ = f;
+    pushListener();
+}
+
+void AudioMixer::setListenerUp(const QVector3D &u)
+{
+    if (up_ == u) return;
+    up_ = u;
+    pushListener();
+}
+
+void AudioMixer::setBusGain(int bus, qreal gain)
+{
+    cs::AudioOutput::instance().setBusGain(bus, static_cast<float>(gain));
+}
+
+qreal AudioMixer::busGain(int bus) const
+{
+    return cs::AudioOutput::instance().busGain(bus);
+}
+
+void AudioMixer::setBusSend(int bus, int target, qreal level)
+{
+    cs::AudioOutput::instance().setBusSend(bus, target, static_cast<float>(level));
+}
+
+qreal AudioMixer::busSend(int bus, int target) const
+{
+    return cs::AudioOutput::instance().busSend(bus, target);
+}
+
+qreal AudioMixer::limiterCeiling() const
+{
+    return 20.0 * std::log10(cs::AudioOutput::instance().limiter().ceiling());
+}
+
+void AudioMixer::setLimiterCeiling(qreal db)
+{
+    auto &limiter = cs::AudioOutput::instance().limiter();
+    const float ceiling = static_cast<float>(std::pow(10.0, std::clamp(db, -40.0, 0.0) / 20.0));
+    if (limiter.ceiling() == ceiling) return;
+    limiter.setCeiling(ceiling);
+    emit limiterChanged();
+}
+
+qreal AudioMixer::limiterRelease() const
+{
+    return cs::AudioOutput::instance().limiter().release();
+}
+
+void AudioMixer::setLimiterRelease(qreal seconds)
+{
+    auto &limiter = cs::AudioOutput::instance().limiter();
+    const float release = static_cast<float>(std::clamp(seconds, 0.001, 2.0));
+    if (limiter.release() == release) return;
+    limiter.setRelease(release);
+    emit limiterChanged();
+}
+
+qreal AudioMixer::limiterReduction() const
+{
+    return cs::AudioOutput::instance().stats().limiterReductionDb;
+}
+
+void AudioMixer::pushListener()
+{
+    cs::Listener l;
+    l.position = toVec3(position_);
+    l.forward  = toVec3(forward_);
+    l.up       = toVec3(up_);
+    cs::AudioOutput::instance().setListener(l);
+    emit listenerChanged();
+}
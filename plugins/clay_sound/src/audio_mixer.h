@@ -0,0 +1,81 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// AudioMixer — QML singleton for the shared engine's mix: the listener
+// that SoundEmitters are heard from, per-bus gains and sends, and the
+// master limiter. Instruments pick a bus with their `bus` property (0 by
+// default), so e.g. music on bus 1 and SFX on bus 0 can be faded
+// independently; effects (see AudioEffect) sit on buses the same way.
+//
+//   SynthInstrument { bus: 1 }
+//   Slider { onMoved: AudioMixer.setBusGain(1, value) }
+//   Binding { target: AudioMixer; property: "listenerPosition"; value: player.position }
+
+#ifndef CLAY_SOUND_AUDIO_MIXER_H
+#define CLAY_SOUND_AUDIO_MIXER_H
+
+#include <QObject>
+#include <QQmlEngine>
+#include <QVector3D>
+
+class AudioMixer : public QObject
+{
+    Q_OBJECT
+    QML_NAMED_ELEMENT(AudioMixer)
+    QML_SINGLETON
+
+    Q_PROPERTY(int       channels         READ channels CONSTANT)
+    Q_PROPERTY(int       busCount         READ busCount CONSTANT)
+    Q_PROPERTY(int       masterBus        READ masterBus CONSTANT)
+    Q_PROPERTY(QVector3D listenerPosition READ listenerPosition WRITE setListenerPosition NOTIFY listenerChanged)
+    Q_PROPERTY(QVector3D listenerForward  READ listenerForward  WRITE setListenerForward  NOTIFY listenerChanged)
+    Q_PROPERTY(QVector3D listenerUp       READ listenerUp       WRITE setListenerUp       NOTIFY listenerChanged)
+    // Master limiter: output ceiling in dBFS (<= 0), release time in
+    // seconds, and the gain reduction it currently applies (dB, <= 0).
+    Q_PROPERTY(qreal     limiterCeiling   READ limiterCeiling   WRITE setLimiterCeiling   NOTIFY limiterChanged)
+    Q_PROPERTY(qreal     limiterRelease   READ limiterRelease   WRITE setLimiterRelease   NOTIFY limiterChanged)
+    Q_PROPERTY(qreal     limiterReduction READ limiterReduction NOTIFY limiterReductionChanged)
+
+public:
+    explicit AudioMixer(QObject *parent = nullptr);
+
+    int channels() const;
+    int busCount() const;
+    int masterBus() const;
+
+    QVector3D listenerPosition() const { return position_; }
+    void      setListenerPosition(const QVector3D &p);
+    QVector3D listenerForward() const { return forward_; }
+    void      setListenerForward(const QVector3D &f);
+    QVector3D listenerUp() const { return up_; }
+    void      setListenerUp(const QVector3D &u);
+
+    qreal limiterCeiling() const;
+    void  setLimiterCeiling(qreal db);
+    qreal limiterRelease() const;
+    void  setLimiterRelease(qreal seconds);
+    qreal limiterReduction() const;
+
+    // Linear gain (>= 0) of mix bus `bus` in [0, busCount).
+    Q_INVOKABLE void  setBusGain(int bus, qreal gain);
+    Q_INVOKABLE qreal busGain(int bus) const;
+
+    // Post-gain send level from `bus` into a higher-numbered `target`
+    // bus, e.g. into a bus carrying a ReverbEffect.
+    Q_INVOKABLE void  setBusSend(int bus, int target, qreal level);
+    Q_INVOKABLE qreal busSend(int bus, int target) const;
+
+signals:
+    void listenerChanged();
+    void limiterChanged();
+    void limiterReductionChanged();
+
+private:
+    void pushListener();
+
+    qreal     reduction_ = 0.0;
+    QVector3D position_;
+    QVector3D forward_{0.0f, 0.0f, -1.0f};
+    QVector3D up_{0.0f, 1.0f, 0.0f};
+};
+
+#endif // CLAY_SOUND_AUDIO_MIXER_H
@@ -2,8 +2,6 @@
 
 #include "audio_output.h"
 
-#include "engine/instrument.h"
-
 #include <QAudioDevice>
 #include <QAudioFormat>
 #include <QAudioSink>
@@ -11,12 +9,116 @@
 #include <QDebug>
 #include <QIODevice>
 #include <QMediaDevices>
+#include <QThread>
 
 #include <algorithm>
+#include <chrono>
 #include <vector>
 
 namespace clay::sound {
 
+// Owns the sink, its pull timer and the preallocated mix buffer. Lives
+// on the render thread when there is one, otherwise on the GUI thread.
+class RenderWorker : public QObject
+{
+public:
+    explicit RenderWorker(AudioOutput& output) : output_(output)
+    {
+        timer_.setTimerType(Qt::PreciseTimer);
+        connect(&timer_, &QTimer::timeout, this, &RenderWorker::pull);
+    }
+
+    // Both run on the worker's thread.
+    bool open(int sampleRate, int pullMs);
+    void close();
+
+    void pull();
+
+private:
+    AudioOutput& output_;
+    QTimer       timer_{this};
+    QAudioSink*  sink_   = nullptr;
+    QIODevice*   device_ = nullptr;
+    std::vector<float> mix_;
+    bool         primed_ = false;   // something was written since open()
+};
+
+bool RenderWorker::open(int sampleRate, int pullMs)
+{
+    QAudioFormat fmt;
+    fmt.setSampleRate(sampleRate);
+    fmt.setChannelCount(output_.channels());
+    fmt.setSampleFormat(QAudioFormat::Float);
+
+    const QAudioDevice outputDevice = QMediaDevices::defaultAudioOutput();
+    if (outputDevice.isNull()) {
+        qWarning() << "clay::sound::AudioOutput: no default audio output device";
+        return false;
+    }
+
+    sink_ = new QAudioSink(outputDevice, fmt, this);
+    const int frameBytes = output_.channels() * static_cast<int>(sizeof(float));
+    sink_->setBufferSize(sampleRate * frameBytes / 5); // ~200ms
+    device_ = sink_->start();
+    if (!device_) {
+        qWarning() << "clay::sound::AudioOutput: failed to start audio sink";
+        delete sink_;
+        sink_ = nullptr;
+        return false;
+    }
+
+    mix_.assign(static_cast<size_t>(AudioOutput::MAX_BLOCK_FRAMES)
+                    * static_cast<size_t>(output_.channels()), 0.0f);
+    primed_ = false;
+    timer_.start(pullMs);
+    return true;
+}
+
+void RenderWorker::close()
+{
+    timer_.stop();
+    if (sink_) {
+        sink_->stop();
+        delete sink_;
+        sink_ = nullptr;
+        device_ = nullptr;
+    }
+}
+
+void RenderWorker::pull()
+{
+    if (!sink_ || !device_) return;
+
+    const int bytesFree = static_cast<int>(sink_->bytesFree());
+    // A completely empty sink buffer means the device ran dry since the
+    // last pull: that is an audible gap.
+    if (primed_ && bytesFree >= sink_->bufferSize())
+        output_.noteUnderrun();
+
+    const int channels = output_.channels();
+    int frames = bytesFree / (channels * static_cast<int>(sizeof(float)));
+    frames = std::min(frames, AudioOutput::MAX_BLOCK_FRAMES);
+    if (frames <= 0) {
+        // Keep the command queue short even when the sink is full.
+        output_.drainCommands();
+        return;
+    }
+
+    output_.renderBlock(mix_.data(), frames);
+
+    const char* data = reinterpret_cast<const char*>(mix_.data());
+    const qint64 bytesToWrite = frames * static_cast<qint64>(channels * sizeof(float));
+    qint64 written = 0;
+    while (written < bytesToWrite) {
+        const qint64 c = device_->write(data + written, bytesToWrite - written);
+        if (c <= 0) break;
+        written += c;
+    }
+    primed_ = true;
+}
+
+// ---------------------------------------------------------------------
+
 AudioOutput& AudioOutput::instance()
 {
     // Process-lifetime singleton. Constructed on first use; never
@@ -29,8 +131,11 @@ AudioOutput& AudioOutput::instance()
 AudioOutput::AudioOutput()
     : QObject(nullptr)
 {
-    pullTimer_.setTimerType(Qt::PreciseTimer);
-    connect(&pullTimer_, &QTimer::timeout, this, &AudioOutput::onPull);
+    engine_.prepare(MAX_INSTRUMENTS, MAX_VOICES, MAX_EVENTS, MAX_EMITTERS);
+    engine_.setVoiceEventCallback(&AudioOutput::onVoiceEvent, this);
+    engine_.setRetireCallback(&AudioOutput::onRetire, this);
+    engine_.setLimiterEnabled(true);
+    connect(&notifyTimer_, &QTimer::timeout, this, &AudioOutput::onNotifyTimer);
 }
 
 AudioOutput::~AudioOutput()
@@ -40,90 +145,524 @@ AudioOutput::~AudioOutput()
 
 int AudioOutput::registerInstrument(std::unique_ptr<IInstrument> inst)
 {
-    return engine_.addInstrument(std::move(inst));
+    if (!inst) return -1;
+    int id = -1;
+    if (!freeInstruments_.isEmpty())
+        id = freeInstruments_.last();
+    else if (nextInstrumentId_ < MAX_INSTRUMENTS)
+        id = nextInstrumentId_;
+    if (id < 0) return -1;
+    Command* cmd = beginCommand();
+    if (!cmd) return -1;   // instrument is dropped with the unique_ptr
+    if (!freeInstruments_.isEmpty()) freeInstruments_.removeLast();
+    else ++nextInstrumentId_;
+    cmd->kind = Command::Kind::AddInstrument;
+    cmd->instrumentId = id;
+    cmd->instrument = inst.release();
+    commitCommand();
+    return id;
 }
 
 void AudioOutput::unregisterInstrument(int id)
 {
-    engine_.removeInstrument(id);
+    if (id < 0) return;
+    if (Command* cmd = beginCommand()) {
+        cmd->kind = Command::Kind::RemoveInstrument;
+        cmd->instrumentId = id;
+        commitCommand();
+    }
+    if (!freeInstruments_.contains(id)) freeInstruments_.append(id);
 }
 
-void AudioOutput::start()
+EventId AudioOutput::schedule(const NoteEvent& ev)
 {
-    if (sinkRunning_) return;
-    if (!QCoreApplication::instance()) {
-        // QtMultimedia requires a QCoreApplication; fail quietly so unit
-        // tests that just exercise the offline engine can construct
-        // instruments without spinning up Qt's event loop.
-        return;
+    Command* cmd = beginCommand();
+    if (!cmd) return 0;
+    cmd->kind = Command::Kind::Schedule;
+    cmd->instrumentId = ev.instrumentId;
+    cmd->id = engine_.reserveEventId();
+    cmd->ev = ev;
+    const EventId id = cmd->id;
+    commitCommand();
+    return id;
+}
+
+int AudioOutput::registerEmitter()
+{
+    int id = -1;
+    if (!freeEmitters_.isEmpty())
+        id = freeEmitters_.takeLast();
+    else if (nextEmitterId_ < MAX_EMITTERS)
+        id = nextEmitterId_++;
+    return id;
+}
+
+void AudioOutput::updateEmitter(int id, const Emitter& emitter)
+{
+    if (id < 0) return;
+    if (Command* cmd = beginCommand()) {
+        cmd->kind = Command::Kind::SetEmitter;
+        cmd->instrumentId = id;
+        setValue(*cmd, emitter);
+        commitCommand();
     }
+}
 
-    QAudioFormat fmt;
-    fmt.setSampleRate(SAMPLE_RATE);
-    fmt.setChannelCount(1);
-    fmt.setSampleFormat(QAudioFormat::Float);
+void AudioOutput::unregisterEmitter(int id)
+{
+    if (id < 0) return;
+    if (Command* cmd = beginCommand()) {
+        cmd->kind = Command::Kind::RemoveEmitter;
+        cmd->instrumentId = id;
+        commitCommand();
+    }
+    freeEmitters_.append(id);
+}
 
-    const QAudioDevice outputDevice = QMediaDevices::defaultAudioOutput();
-    if (outputDevice.isNull()) {
-        qWarning() << "clay::sound::AudioOutput: no default audio output device";
-        return;
+int AudioOutput::registerEffect(std::unique_ptr<IEffect> effect, int bus)
+{
+    if (!effect) return -1;
+    int id = -1;
+    if (!freeEffects_.isEmpty())
+        id = freeEffects_.last();
+    else if (nextEffectId_ < Engine::kMaxEffects)
+        id = nextEffectId_;
+    if (id < 0) return -1;
+    Command* cmd = beginCommand();
+    if (!cmd) return -1;   // effect is dropped with the unique_ptr
+    if (!freeEffects_.isEmpty()) freeEffects_.removeLast();
+    else ++nextEffectId_;
+    cmd->kind = Command::Kind::AddEffect;
+    cmd->instrumentId = id;
+    cmd->bus = bus;
+    cmd->effect = effect.release();
+    commitCommand();
+    return id;
+}
+
+void AudioOutput::setEffectBus(int id, int bus)
+{
+    if (id < 0) return;
+    if (Command* cmd = beginCommand()) {
+        cmd->kind = Command::Kind::SetEffectBus;
+        cmd->instrumentId = id;
+        cmd->bus = bus;
+        commitCommand();
     }
+}
 
-    delete sink_;
-    sink_ = new QAudioSink(outputDevice, fmt, this);
-    sink_->setBufferSize(SAMPLE_RATE * sizeof(float) / 5); // ~200ms
-    device_ = sink_->start();
-    if (!device_) {
-        qWarning() << "clay::sound::AudioOutput: failed to start audio sink";
-        delete sink_;
-        sink_ = nullptr;
+void AudioOutput::unregisterEffect(int id)
+{
+    if (id < 0) return;
+    if (Command* cmd = beginCommand()) {
+        cmd->kind = Command::Kind::RemoveEffect;
+        cmd->instrumentId = id;
+        commitCommand();
+    }
+    freeEffects_.append(id);
+}
+
+void AudioOutput::setListener(const Listener& listener)
+{
+    if (Command* cmd = beginCommand()) {
+        cmd->kind = Command::Kind::SetListener;
+        setValue(*cmd, listener);
+        commitCommand();
+    }
+}
+
+void AudioOutput::cancel(EventId id)
+{
+    if (Command* cmd = beginCommand()) {
+        cmd->kind = Command::Kind::Cancel;
+        cmd->id = id;
+        commitCommand();
+    }
+}
+
+void AudioOutput::clearSchedule()
+{
+    if (Command* cmd = beginCommand()) {
+        cmd->kind = Command::Kind::ClearSchedule;
+        commitCommand();
+    }
+}
+
+void AudioOutput::resetVoices()
+{
+    if (Command* cmd = beginCommand()) {
+        cmd->kind = Command::Kind::ResetVoices;
+        commitCommand();
+    }
+}
+
+AudioOutput::Command* AudioOutput::beginCommand()
+{
+    Command* cmd = nullptr;
+    stagedCommand_ = false;
+    if (!threaded_) {
+        cmd = &immediate_;
+    } else {
+        // The render thread drains the ring every pull; only a burst of
+        // more than COMMAND_CAPACITY commands within one period is
+        // staged, behind anything staged before it.
+        flushStaged();
+        if (staged_.empty()) cmd = commands_.beginPush();
+        if (!cmd) {
+            if (staged_.size() >= size_t{MAX_STAGED_COMMANDS}) {
+                droppedCommands_.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            stagedCommand_ = true;
+            cmd = &staged_.emplace_back();
+        }
+    }
+    cmd->call = nullptr;
+    cmd->relocate = nullptr;
+    cmd->instrument = nullptr;
+    cmd->effect = nullptr;
+    return cmd;
+}
+
+void AudioOutput::commitCommand()
+{
+    if (threaded_) {
+        if (!stagedCommand_) commands_.commitPush();
         return;
     }
+    apply(immediate_);
+    drainNotifications();
+}
 
-    sinkRunning_ = true;
-    pullTimer_.start(BUFFER_MS);
+void AudioOutput::flushStaged()
+{
+    while (!staged_.empty()) {
+        Command* slot = commands_.beginPush();
+        if (!slot) break;
+        moveCommand(*slot, staged_.front());
+        commands_.commitPush();
+        staged_.pop_front();
+    }
 }
 
-void AudioOutput::stop()
+void AudioOutput::moveCommand(Command& to, Command& from)
 {
-    if (!sinkRunning_) return;
-    sinkRunning_ = false;
-    pullTimer_.stop();
-    if (sink_) {
-        sink_->stop();
-        delete sink_;
-        sink_ = nullptr;
-        device_ = nullptr;
+    // The plain fields and value payloads copy; a typed call's payload
+    // is then constructed over the copied bytes by its relocate thunk.
+    to = from;
+    if (from.relocate) from.relocate(to.payload, from.payload);
+    from.call = nullptr;
+    from.relocate = nullptr;
+}
+
+void AudioOutput::apply(Command& cmd)
+{
+    switch (cmd.kind) {
+    case Command::Kind::Schedule:
+        if (cmd.call) cmd.call(engine_.instrumentAt(cmd.instrumentId), cmd.id, cmd.payload);
+        engine_.schedule(cmd.ev, cmd.id);
+        break;
+    case Command::Kind::Cancel:
+        engine_.cancel(cmd.id);
+        break;
+    case Command::Kind::ClearSchedule:
+        engine_.clearSchedule();
+        break;
+    case Command::Kind::ResetVoices:
+        engine_.resetVoices();
+        break;
+    case Command::Kind::AddInstrument:
+        if (engine_.instrumentAt(cmd.instrumentId)) {
+            // Slot still taken (its removal was dropped): retire the old
+            // instrument the usual way before reusing the id.
+            Notification n;
+            n.kind = Notification::Kind::ReleaseInstrument;
+            n.instrumentId = cmd.instrumentId;
+            n.instrument = engine_.releaseInstrument(cmd.instrumentId).release();
+            pushNotification(n);
+        }
+        engine_.insertInstrument(cmd.instrumentId, std::unique_ptr<IInstrument>(cmd.instrument));
+        break;
+    case Command::Kind::RemoveInstrument:
+        if (auto inst = engine_.releaseInstrument(cmd.instrumentId)) {
+            Notification n;
+            n.kind = Notification::Kind::ReleaseInstrument;
+            n.instrumentId = cmd.instrumentId;
+            n.instrument = inst.release();
+            pushNotification(n);
+        }
+        break;
+    case Command::Kind::Call:
+        if (cmd.call) cmd.call(engine_.instrumentAt(cmd.instrumentId), 0, cmd.payload);
+        break;
+    case Command::Kind::SetListener:
+        engine_.setListener(value<Listener>(cmd));
+        break;
+    case Command::Kind::SetEmitter:
+        engine_.setEmitter(cmd.instrumentId, value<Emitter>(cmd));
+        break;
+    case Command::Kind::RemoveEmitter:
+        engine_.removeEmitter(cmd.instrumentId);
+        break;
+    case Command::Kind::AddEffect:
+        if (engine_.effectAt(cmd.instrumentId)) {
+            // Slot still taken (its removal was dropped): hand the
+            // effect back for destruction rather than freeing it here.
+            Notification n;
+            n.kind = Notification::Kind::ReleaseEffect;
+            n.effect = cmd.effect;
+            pushNotification(n);
+        } else {
+            engine_.insertEffect(cmd.instrumentId, cmd.bus, std::unique_ptr<IEffect>(cmd.effect));
+        }
+        break;
+    case Command::Kind::SetEffectBus:
+        engine_.setEffectBus(cmd.instrumentId, cmd.bus);
+        break;
+    case Command::Kind::RemoveEffect:
+        if (auto effect = engine_.releaseEffect(cmd.instrumentId)) {
+            Notification n;
+            n.kind = Notification::Kind::ReleaseEffect;
+            n.effect = effect.release();
+            pushNotification(n);
+        }
+        break;
     }
+    cmd.call = nullptr;
+    cmd.relocate = nullptr;
+    cmd.instrument = nullptr;
+    cmd.effect = nullptr;
 }
 
-void AudioOutput::onPull()
+void AudioOutput::drainCommands()
 {
-    if (!sinkRunning_ || !sink_ || !device_) return;
+    while (Command* cmd = commands_.front()) {
+        apply(*cmd);
+        commands_.pop();
+    }
+}
 
-    const int bytesFree = sink_->bytesFree();
-    int frames = bytesFree / static_cast<int>(sizeof(float));
-    if (frames <= 0) return;
-    frames = std::min(frames, SAMPLE_RATE); // cap 1s
+void AudioOutput::renderBlock(float* out, int frames)
+{
+    using Clock = std::chrono::steady_clock;
+    const auto t0 = Clock::now();
 
-    std::vector<float> buf(static_cast<size_t>(frames), 0.0f);
-    engine_.renderOffline(buf.data(), frames);
+    drainCommands();
+    // Gains, effects and the master limiter are applied inside the
+    // engine; the limiter keeps sums of several loud instruments from
+    // clipping in the sink's float-to-int conversion.
+    engine_.renderOffline(out, frames);
 
-    // Per-instrument gain is applied inside the engine. Final master
-    // clamp here protects the output from sums of multiple loud
-    // instruments saturating the float-to-int conversion in the sink.
-    for (auto& s : buf) s = std::clamp(s, -1.0f, 1.0f);
+    renderedFrames_.store(engine_.currentFrame(), std::memory_order_release);
 
-    const char* data = reinterpret_cast<const char*>(buf.data());
-    qint64 bytesToWrite = frames * static_cast<qint64>(sizeof(float));
-    qint64 written = 0;
-    while (written < bytesToWrite) {
-        qint64 c = device_->write(data + written, bytesToWrite - written);
-        if (c <= 0) break;
-        written += c;
+    const int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                           Clock::now() - t0).count();
+    blockNs_.store(ns, std::memory_order_relaxed);
+    blockFrames_.store(frames, std::memory_order_relaxed);
+    if (ns > maxBlockNs_.load(std::memory_order_relaxed))
+        maxBlockNs_.store(ns, std::memory_order_relaxed);
+    blocks_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AudioOutput::noteUnderrun()
+{
+    underruns_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void AudioOutput::pushNotification(Notification n)
+{
+    if (notifications_.push(std::move(n))) return;
+    // Ring full (GUI thread stalled for a long time). Voice counts will
+    // self-correct as voices finish; a released instrument must not
+    // leak, so destroy it here as a last resort (shared data goes with
+    // `n`).
+    if (n.kind == Notification::Kind::ReleaseInstrument)
+        delete n.instrument;
+    else if (n.kind == Notification::Kind::ReleaseEffect)
+        delete n.effect;
+}
+
+void AudioOutput::onVoiceEvent(void* context, const VoiceEvent& ev)
+{
+    auto* self = static_cast<AudioOutput*>(context);
+    Notification n;
+    n.kind = ev.kind == VoiceEvent::Kind::Started ? Notification::Kind::VoiceStarted
+                                                  : Notification::Kind::VoiceFinished;
+    n.instrumentId = ev.instrumentId;
+    self->pushNotification(n);
+}
+
+void AudioOutput::onRetire(void* context, std::shared_ptr<const void> object)
+{
+    Notification n;
+    n.kind = Notification::Kind::ReleaseShared;
+    n.shared = std::move(object);
+    static_cast<AudioOutput*>(context)->pushNotification(std::move(n));
+}
+
+void AudioOutput::drainNotifications()
+{
+    Notification n;
+    while (notifications_.pop(n)) {
+        switch (n.kind) {
+        case Notification::Kind::VoiceStarted:
+            ++voiceCounts_[n.instrumentId];
+            ++totalVoices_;
+            break;
+        case Notification::Kind::VoiceFinished: {
+            auto it = voiceCounts_.find(n.instrumentId);
+            if (it != voiceCounts_.end() && --it.value() <= 0)
+                voiceCounts_.erase(it);
+            totalVoices_ = std::max(0, totalVoices_ - 1);
+            break;
+        }
+        case Notification::Kind::ReleaseInstrument:
+            delete n.instrument;
+            break;
+        case Notification::Kind::ReleaseEffect:
+            delete n.effect;
+            break;
+        case Notification::Kind::ReleaseShared:
+            n.shared.reset();
+            break;
+        }
     }
+}
 
+void AudioOutput::onNotifyTimer()
+{
+    flushStaged();
+    drainNotifications();
     emit afterPull();
+    const uint64_t blocks = blocks_.load(std::memory_order_relaxed);
+    if (blocks != lastPublishedBlocks_) {
+        lastPublishedBlocks_ = blocks;
+        emit statsChanged();
+    }
+}
+
+void AudioOutput::renderOffline(float* out, int frames, int channels)
+{
+    if (frames <= 0) return;
+    const int engineChannels = engine_.channels();
+    Q_ASSERT(channels == 1 || channels == engineChannels);
+
+    // Folding down needs the full mix first; allocate it here, on the
+    // caller's thread, not on the render thread.
+    std::vector<float> mix;
+    float* target = out;
+    if (channels != engineChannels) {
+        mix.resize(static_cast<size_t>(frames) * static_cast<size_t>(engineChannels));
+        target = mix.data();
+    }
+
+    if (threaded_) {
+        flushStaged();
+        QMetaObject::invokeMethod(worker_, [this, target, frames] { renderBlock(target, frames); },
+                                  Qt::BlockingQueuedConnection);
+    } else {
+        renderBlock(target, frames);
+    }
+
+    if (target != out) {
+        // Equal-power fold-down: a centred voice keeps its mono level.
+        constexpr float kFold = 0.70710678f;
+        for (int i = 0; i < frames; ++i) {
+            float sum = 0.0f;
+            for (int c = 0; c < engineChannels; ++c) sum += target[i * engineChannels + c];
+            out[i] = std::clamp(sum * kFold, -1.0f, 1.0f);
+        }
+    }
+    drainNotifications();
+}
+
+AudioOutput::Stats AudioOutput::stats() const
+{
+    Stats s;
+    s.blocks = blocks_.load(std::memory_order_relaxed);
+    s.underruns = underruns_.load(std::memory_order_relaxed);
+    s.droppedCommands = droppedCommands_.load(std::memory_order_relaxed);
+    s.blockFrames = blockFrames_.load(std::memory_order_relaxed);
+    s.blockMs = blockNs_.load(std::memory_order_relaxed) / 1e6;
+    s.maxBlockMs = maxBlockNs_.load(std::memory_order_relaxed) / 1e6;
+    const double blockDurationMs = s.blockFrames * 1000.0 / SAMPLE_RATE;
+    s.load = blockDurationMs > 0.0 ? s.blockMs / blockDurationMs : 0.0;
+    s.activeStreams = streamer_.activeStreams();
+    s.streamUnderruns = streamer_.underruns();
+    s.effectsLoad = engine_.effectsLoad();
+    s.limiterReductionDb = engine_.limiter().reductionDb();
+    return s;
+}
+
+void AudioOutput::resetStats()
+{
+    underruns_.store(0, std::memory_order_relaxed);
+    droppedCommands_.store(0, std::memory_order_relaxed);
+    maxBlockNs_.store(0, std::memory_order_relaxed);
+    streamer_.resetUnderruns();
+    emit statsChanged();
+}
+
+void AudioOutput::start()
+{
+    if (sinkRunning_) return;
+    if (!QCoreApplication::instance()) {
+        // QtMultimedia requires a QCoreApplication; fail quietly so unit
+        // tests that just exercise the offline engine can construct
+        // instruments without spinning up Qt's event loop.
+        return;
+    }
+
+    worker_ = new RenderWorker(*this);
+#if QT_CONFIG(thread) && !defined(Q_OS_WASM)
+    streamer_.start();
+    thread_ = new QThread();
+    thread_->setObjectName(QStringLiteral("clay-sound-render"));
+    worker_->moveToThread(thread_);
+    thread_->start(QThread::TimeCriticalPriority);
+    bool ok = false;
+    QMetaObject::invokeMethod(worker_, [this, &ok] { ok = worker_->open(SAMPLE_RATE, BUFFER_MS); },
+                              Qt::BlockingQueuedConnection);
+#else
+    const bool ok = worker_->open(SAMPLE_RATE, BUFFER_MS);
+#endif
+    if (!ok) {
+        stop();
+        return;
+    }
+
+    threaded_ = thread_ != nullptr;
+    sinkRunning_ = true;
+    notifyTimer_.start(BUFFER_MS);
+}
+
+void AudioOutput::stop()
+{
+    notifyTimer_.stop();
+    if (worker_) {
+        if (thread_) {
+            QMetaObject::invokeMethod(worker_, [this] { worker_->close(); },
+                                      Qt::BlockingQueuedConnection);
+            thread_->quit();
+            thread_->wait();
+        } else {
+            worker_->close();
+        }
+        delete worker_;
+        worker_ = nullptr;
+    }
+    delete thread_;
+    thread_ = nullptr;
+    streamer_.stop();
+
+    // The render thread is gone; apply whatever it did not get to and
+    // switch back to immediate commands.
+    threaded_ = false;
+    drainCommands();
+    for (Command& cmd : staged_) apply(cmd);
+    staged_.clear();
+    drainNotifications();
+    sinkRunning_ = false;
 }
 
 } // namespace clay::sound
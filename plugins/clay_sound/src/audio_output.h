@@ -3,9 +3,8 @@
 // AudioOutput — process-wide owner of the single QAudioSink and the
 // shared clay::sound::Engine. Every QML-facing instrument (SynthInstrument,
 // SampleInstrument) registers a clay::sound::IInstrument with this
-// singleton; the singleton owns the sink and the pull-timer, and on each
-// pull renders the engine (which mixes all registered instruments'
-// voices) into the sink.
+// singleton; the singleton owns the sink and renders the engine (which
+// mixes all registered instruments' voices) into it.
 //
 // On desktop this just removes per-instrument duplication. On WASM it is
 // load-bearing: Qt's WebAudio backend effectively allows only one active
@@ -13,6 +12,24 @@
 // "Invalid Operation" the moment a second instrument is alive. A single
 // shared sink avoids that limit.
 //
+// Threading: where threads are available (not WASM) the sink, its pull
+// timer and the engine live on a dedicated render thread, so GUI stalls
+// (QML loading, JS GC, heavy scene work) do not starve the sink. The
+// GUI thread never touches the engine while that thread runs; it talks
+// to it through two lock-free SPSC rings:
+//   * commands (GUI -> render): schedule, cancel, instrument and effect
+//     add/remove and typed instrument calls such as pushing a patch,
+//   * notifications (render -> GUI): voice started/finished and
+//     instruments, effects and shared data (sample buffers,
+//     compositions) to destroy, drained by a GUI-side timer which then
+//     emits afterPull().
+// The render side mixes into a preallocated buffer and never blocks.
+// The sink is interleaved stereo; listener/emitter updates and bus
+// gains place and balance the voices (see Engine). The engine's master
+// limiter is always on and keeps the sink's input within full scale.
+// While stopped, or on WASM, commands apply immediately on the caller's
+// thread instead.
+//
 // User-gesture gating: in WASM the AudioContext is created suspended
 // until a user-initiated event resumes it. registerInstrument() does
 // NOT start the sink; the sink is started lazily on the first triggered
@@ -23,18 +40,34 @@
 #ifndef CLAY_SOUND_AUDIO_OUTPUT_H
 #define CLAY_SOUND_AUDIO_OUTPUT_H
 
+#include "engine/effect.h"
 #include "engine/engine.h"
+#include "engine/instrument.h"
+#include "engine/note_event.h"
+#include "engine/pcm_streamer.h"
+#include "engine/spatial.h"
+#include "engine/spsc_ring.h"
 
+#include <QHash>
 #include <QObject>
 #include <QTimer>
+#include <QVector>
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
 #include <memory>
+#include <new>
+#include <type_traits>
 
-class QAudioSink;
-class QIODevice;
+class QThread;
 
 namespace clay::sound {
 
+class RenderWorker;
+
 class AudioOutput : public QObject
 {
     Q_OBJECT
@@ -42,57 +75,328 @@ public:
     static AudioOutput& instance();
 
     // Register an IInstrument with the shared engine. Takes ownership.
-    // Returns the engine instrument id; the caller can keep a non-owning
-    // pointer to the instrument via engine().instrumentAt(id) if it needs
-    // to call type-specific methods (e.g. pushPatch).
+    // Returns the engine instrument id, or -1 once MAX_INSTRUMENTS are
+    // registered. The caller may keep a raw pointer for thread-safe
+    // state (gain()); anything else goes through post()/schedule().
     // Does NOT start the audio sink — that happens lazily on first
     // trigger or explicit start().
     int registerInstrument(std::unique_ptr<IInstrument> inst);
 
     // Drop an instrument and any of its still-active voices. Idempotent.
+    // The instrument is destroyed on the GUI thread once the render
+    // thread has let go of it; its id may then be handed out again.
     void unregisterInstrument(int id);
 
-    // Direct access to the shared engine. Used by instrument adapters
-    // to schedule events and push patches.
-    Engine& engine() { return engine_; }
-    const Engine& engine() const { return engine_; }
+    // Enqueue a note. Returns its scheduler ticket.
+    EventId schedule(const NoteEvent& ev);
+
+    // Enqueue a note and run `fn(inst, id, payload)` on the render
+    // thread right before it, with `inst` the event's instrument cast to
+    // `Inst`. Typically used to queue the note's patch:
+    //   out.schedule<OscillatorInstrument>(ev, patch,
+    //       [](OscillatorInstrument& i, EventId id, const Patch& p) { i.pushPatch(id, p); });
+    // `fn` must be captureless; `Payload` is copied into the command and
+    // may own resources (it is moved, never byte-copied, while queued).
+    template <typename Inst, typename Payload, typename Fn>
+    EventId schedule(const NoteEvent& ev, const Payload& payload, Fn fn);
+
+    // Run `fn(inst, 0, payload)` on the render thread, e.g. to change an
+    // instrument's default patch or source. Same rules as above.
+    template <typename Inst, typename Payload, typename Fn>
+    void post(int instrumentId, const Payload& payload, Fn fn);
+
+    void cancel(EventId id);
+    void clearSchedule();
+    void resetVoices();
+
+    // Spatial mixing. Emitter ids are handed out on the GUI thread and
+    // recycled after unregisterEmitter(); -1 once MAX_EMITTERS are in
+    // use. Notes follow an emitter via NoteEvent::emitterId.
+    int  registerEmitter();
+    void updateEmitter(int id, const Emitter& emitter);
+    void unregisterEmitter(int id);
+    void setListener(const Listener& listener);
+
+    // Mix bus gains and sends (see Engine::setBusGain() and
+    // Engine::setBusSend()). Safe from any thread.
+    void  setBusGain(int bus, float gain) { engine_.setBusGain(bus, gain); }
+    float busGain(int bus) const { return engine_.busGain(bus); }
+    void  setBusSend(int bus, int target, float level) { engine_.setBusSend(bus, target, level); }
+    float busSend(int bus, int target) const { return engine_.busSend(bus, target); }
+
+    // Insert an effect at the end of `bus`'s chain (Engine::kMasterBus
+    // for the master). Takes ownership; like instruments, the caller
+    // may keep a raw pointer to set the effect's atomic parameters.
+    // Returns the effect id, or -1 once Engine::kMaxEffects are in use.
+    int  registerEffect(std::unique_ptr<IEffect> effect, int bus);
+    void setEffectBus(int id, int bus);
+    // The effect is destroyed on the GUI thread once the render thread
+    // has let go of it.
+    void unregisterEffect(int id);
+    // Fraction of real time spent in the effect. Safe from any thread.
+    double effectLoad(int id) const { return engine_.effectLoad(id); }
+
+    // Master limiter; its parameters are atomics. Safe from any thread.
+    Limiter& limiter() { return engine_.limiter(); }
 
     int sampleRate() const { return engine_.sampleRate(); }
+    int channels() const { return engine_.channels(); }
+    // Frames by which the master limiter delays the output.
+    int latencyFrames() const { return engine_.latencyFrames(); }
     bool isRunning() const { return sinkRunning_; }
 
-    // Open the audio sink and start the pull timer. Safe to call from a
+    // Engine time (frames rendered so far). Safe from any thread.
+    int64_t currentFrame() const { return renderedFrames_.load(std::memory_order_acquire); }
+
+    // Voices currently active, as last reported by the render side.
+    int activeVoices(int instrumentId) const { return voiceCounts_.value(instrumentId, 0); }
+    int activeVoices() const { return totalVoices_; }
+
+    // Render `frames` frames of the shared engine into `out` (master
+    // limiter applied), interleaved with `channels` channels: either
+    // channels(), or 1 for an equal-power mono fold-down. Destructive:
+    // advances engine time and consumes events. While the render thread
+    // runs this executes on it and blocks the caller, so it never races
+    // the live mix. Intended for tests and headless preview.
+    void renderOffline(float* out, int frames, int channels = 1);
+
+    struct Stats
+    {
+        uint64_t blocks = 0;           // blocks rendered for the sink
+        uint64_t underruns = 0;        // pulls that found the sink drained
+        uint64_t droppedCommands = 0;  // commands lost to a full ring and stage
+        int      blockFrames = 0;      // size of the last block
+        double   blockMs = 0.0;        // render time of the last block
+        double   maxBlockMs = 0.0;     // worst render time since resetStats()
+        double   load = 0.0;           // last render time / block duration
+        int      activeStreams = 0;    // voices streaming from disk
+        uint64_t streamUnderruns = 0;  // renders that found a stream behind
+        double   effectsLoad = 0.0;    // effects + limiter time / block duration
+        double   limiterReductionDb = 0.0;  // deepest reduction in the last chunk
+    };
+    Stats stats() const;
+    void resetStats();
+
+    // Disk reader for streamed samples, handed to every SamplerInstrument.
+    // Its reader thread runs alongside the render thread; while that is
+    // stopped (offline renders) or on WASM, streams are read on the
+    // render side instead.
+    PcmStreamer& streamer() { return streamer_; }
+
+    // Open the audio sink and start rendering. Safe to call from a
     // user-gesture handler in QML (e.g. a Play button) so subsequent
     // triggers play immediately. Idempotent.
     Q_INVOKABLE void start();
 
-    // Close the sink and stop the pull timer. Active scheduled notes
-    // are not cancelled; calling start() again resumes mixing.
+    // Close the sink and stop rendering. Active scheduled notes are not
+    // cancelled; calling start() again resumes mixing.
     Q_INVOKABLE void stop();
 
 signals:
-    // Emitted at the end of every pull cycle. Used by instrument
+    // Emitted on the GUI thread after render-side notifications were
+    // drained (every pull period while running). Used by instrument
     // adapters to update QML-visible derived state (activeVoices,
     // playbackFinished) without each owning its own timer.
     void afterPull();
 
+    // Emitted alongside afterPull() when stats() changed.
+    void statsChanged();
+
 private:
+    friend class RenderWorker;
+
     AudioOutput();
     ~AudioOutput() override;
     AudioOutput(const AudioOutput&) = delete;
     AudioOutput& operator=(const AudioOutput&) = delete;
 
-    void onPull();
-
     static constexpr int SAMPLE_RATE = 44100;
+    static constexpr int CHANNELS    = 2;                   // interleaved stereo
     static constexpr int BUFFER_MS   = 20;
+    static constexpr int MAX_BLOCK_FRAMES = SAMPLE_RATE;   // cap 1s per pull
+    static constexpr int MAX_INSTRUMENTS  = 256;           // preallocated slots
+    static constexpr int MAX_VOICES       = 1024;          // across all instruments
+    static constexpr int MAX_EVENTS       = 16384;         // pending, before the scheduler grows
+    static constexpr int MAX_EMITTERS     = 256;
+    static constexpr size_t COMMAND_CAPACITY      = 1024;
+    static constexpr int    MAX_STAGED_COMMANDS   = 16 * static_cast<int>(COMMAND_CAPACITY);
+    static constexpr size_t NOTIFICATION_CAPACITY = 4096;
+    static constexpr size_t PAYLOAD_BYTES         = 160;
+
+    // Runs a typed instrument call stored in Command::payload, then
+    // destroys the payload. `inst` is nullptr when the instrument is
+    // gone; the payload is still destroyed.
+    using CallFn = void (*)(IInstrument* inst, EventId id, void* payload);
+    // Move-constructs a typed call's payload into `to` and destroys the
+    // one at `from`. Payloads may own resources (shared_ptr), so a
+    // command is never moved by copying its bytes alone.
+    using RelocateFn = void (*)(void* to, void* from);
 
-    Engine      engine_{SAMPLE_RATE};
-    QAudioSink* sink_     = nullptr;
-    QIODevice*  device_   = nullptr;
-    QTimer      pullTimer_;
-    bool        sinkRunning_ = false;
+    struct Command
+    {
+        enum class Kind : uint8_t {
+            Schedule, Cancel, ClearSchedule, ResetVoices,
+            AddInstrument, RemoveInstrument, Call,
+            SetListener, SetEmitter, RemoveEmitter,
+            AddEffect, SetEffectBus, RemoveEffect
+        };
+        Kind         kind = Kind::Call;
+        int          instrumentId = -1;      // emitter / effect id for those kinds
+        int          bus = 0;                // AddEffect, SetEffectBus
+        EventId      id = 0;
+        NoteEvent    ev{};
+        IInstrument* instrument = nullptr;   // AddInstrument (ownership passes)
+        IEffect*     effect = nullptr;       // AddEffect (ownership passes)
+        CallFn       call = nullptr;
+        RelocateFn   relocate = nullptr;     // set with `call`
+        alignas(std::max_align_t) unsigned char payload[PAYLOAD_BYTES];
+    };
+
+    struct Notification
+    {
+        enum class Kind : uint8_t {
+            VoiceStarted, VoiceFinished, ReleaseInstrument, ReleaseEffect, ReleaseShared
+        };
+        Kind         kind = Kind::VoiceStarted;
+        int          instrumentId = -1;
+        IInstrument* instrument = nullptr;   // ReleaseInstrument
+        IEffect*     effect = nullptr;       // ReleaseEffect
+        std::shared_ptr<const void> shared;  // ReleaseShared
+    };
+
+    template <typename Inst, typename Payload>
+    struct CallBundle
+    {
+        void (*fn)(Inst&, EventId, const Payload&);
+        Payload payload;
+    };
+
+    template <typename Inst, typename Payload>
+    static void runCall(IInstrument* inst, EventId id, void* storage)
+    {
+        auto* bundle = static_cast<CallBundle<Inst, Payload>*>(storage);
+        if (inst) bundle->fn(static_cast<Inst&>(*inst), id, bundle->payload);
+        bundle->~CallBundle();
+    }
+
+    template <typename Inst, typename Payload>
+    static void relocateCall(void* to, void* from)
+    {
+        auto* bundle = static_cast<CallBundle<Inst, Payload>*>(from);
+        new (to) CallBundle<Inst, Payload>(std::move(*bundle));
+        bundle->~CallBundle();
+    }
+
+    template <typename Inst, typename Payload, typename Fn>
+    static void setCall(Command& cmd, const Payload& payload, Fn fn)
+    {
+        using Bundle = CallBundle<Inst, Payload>;
+        static_assert(sizeof(Bundle) <= PAYLOAD_BYTES, "payload too large for a command");
+        static_assert(alignof(Bundle) <= alignof(std::max_align_t), "over-aligned payload");
+        new (cmd.payload) Bundle{ static_cast<void (*)(Inst&, EventId, const Payload&)>(fn),
+                                  payload };
+        cmd.call = &runCall<Inst, Payload>;
+        cmd.relocate = &relocateCall<Inst, Payload>;
+    }
+
+    // Plain values (Listener, Emitter) travel in Command::payload.
+    template <typename T>
+    static void setValue(Command& cmd, const T& v)
+    {
+        static_assert(std::is_trivially_copyable_v<T> && sizeof(T) <= PAYLOAD_BYTES,
+                      "value not storable in a command");
+        std::memcpy(cmd.payload, &v, sizeof(T));
+    }
+    template <typename T>
+    static T value(const Command& cmd)
+    {
+        T v;
+        std::memcpy(&v, cmd.payload, sizeof(T));
+        return v;
+    }
+
+    // GUI side: a command slot to fill, then commit. Never waits: while
+    // the ring is full, commands are staged in order on the GUI side and
+    // moved over by flushStaged() on later commands and every notify
+    // tick. Returns nullptr (and counts a drop) once the stage is full.
+    Command* beginCommand();
+    void commitCommand();
+    void flushStaged();
+    static void moveCommand(Command& to, Command& from);
+
+    // Render side.
+    void apply(Command& cmd);
+    void drainCommands();
+    void renderBlock(float* out, int frames);
+    void noteUnderrun();
+    void pushNotification(Notification n);
+    static void onVoiceEvent(void* context, const VoiceEvent& ev);
+    static void onRetire(void* context, std::shared_ptr<const void> object);
+
+    // GUI side.
+    void drainNotifications();
+    void onNotifyTimer();
+
+    PcmStreamer streamer_;       // outlives the engine's voices
+    Engine engine_{SAMPLE_RATE, CHANNELS};
+    SpscRing<Command> commands_{COMMAND_CAPACITY};
+    SpscRing<Notification> notifications_{NOTIFICATION_CAPACITY};
+    Command immediate_;          // slot used while commands apply directly
+    std::deque<Command> staged_; // GUI side, waiting for ring space; never reallocates
+    bool stagedCommand_ = false; // the open command is in staged_
+    bool threaded_ = false;      // render thread owns the engine
+    int nextInstrumentId_ = 0;
+    QVector<int> freeInstruments_;
+    int nextEmitterId_ = 0;
+    QVector<int> freeEmitters_;
+    int nextEffectId_ = 0;
+    QVector<int> freeEffects_;
+
+    RenderWorker* worker_ = nullptr;
+    QThread*      thread_ = nullptr;
+    QTimer        notifyTimer_;
+    bool          sinkRunning_ = false;
+
+    QHash<int, int> voiceCounts_;
+    int totalVoices_ = 0;
+
+    std::atomic<int64_t>  renderedFrames_{0};
+    std::atomic<uint64_t> blocks_{0};
+    std::atomic<uint64_t> underruns_{0};
+    std::atomic<uint64_t> droppedCommands_{0};
+    std::atomic<int>      blockFrames_{0};
+    std::atomic<int64_t>  blockNs_{0};
+    std::atomic<int64_t>  maxBlockNs_{0};
+    uint64_t lastPublishedBlocks_ = 0;
 };
 
+template <typename Inst, typename Payload, typename Fn>
+EventId AudioOutput::schedule(const NoteEvent& ev, const Payload& payload, Fn fn)
+{
+    Command* cmd = beginCommand();
+    if (!cmd) return 0;
+    cmd->kind = Command::Kind::Schedule;
+    cmd->instrumentId = ev.instrumentId;
+    cmd->id = engine_.reserveEventId();
+    cmd->ev = ev;
+    setCall<Inst>(*cmd, payload, fn);
+    const EventId id = cmd->id;
+    commitCommand();
+    return id;
+}
+
+template <typename Inst, typename Payload, typename Fn>
+void AudioOutput::post(int instrumentId, const Payload& payload, Fn fn)
+{
+    Command* cmd = beginCommand();
+    if (!cmd) return;
+    cmd->kind = Command::Kind::Call;
+    cmd->instrumentId = instrumentId;
+    cmd->id = 0;
+    setCall<Inst>(*cmd, payload, fn);
+    commitCommand();
+}
+
 } // namespace clay::sound
 
 #endif // CLAY_SOUND_AUDIO_OUTPUT_H
@@ -0,0 +1,111 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "audio_stats.h"
+
+#include "audio_output.h"
+#include "engine/pcm_cache.h"
+
+namespace cs = clay::sound;
+
+AudioStats::AudioStats(QObject *parent)
+    : QObject(parent)
+{
+    connect(&cs::AudioOutput::instance(), &cs::AudioOutput::statsChanged,
+            this, &AudioStats::statsChanged);
+}
+
+bool AudioStats::running() const
+{
+    return cs::AudioOutput::instance().isRunning();
+}
+
+qint64 AudioStats::blocks() const
+{
+    return static_cast<qint64>(cs::AudioOutput::instance().stats().blocks);
+}
+
+qint64 AudioStats::underruns() const
+{
+    return static_cast<qint64>(cs::AudioOutput::instance().stats().underruns);
+}
+
+qint64 AudioStats::droppedCommands() const
+{
+    return static_cast<qint64>(cs::AudioOutput::instance().stats().droppedCommands);
+}
+
+qreal AudioStats::blockMs() const
+{
+    return cs::AudioOutput::instance().stats().blockMs;
+}
+
+qreal AudioStats::maxBlockMs() const
+{
+    return cs::AudioOutput::instance().stats().maxBlockMs;
+}
+
+qreal AudioStats::load() const
+{
+    return cs::AudioOutput::instance().stats().load;
+}
+
+int AudioStats::activeVoices() const
+{
+    return cs::AudioOutput::instance().activeVoices();
+}
+
+qreal AudioStats::effectsLoad() const
+{
+    return cs::AudioOutput::instance().stats().effectsLoad;
+}
+
+qreal AudioStats::limiterReduction() const
+{
+    return cs::AudioOutput::instance().stats().limiterReductionDb;
+}
+
+int AudioStats::activeStreams() const
+{
+    return cs::AudioOutput::instance().stats().activeStreams;
+}
+
+qint64 AudioStats::streamUnderruns() const
+{
+    return static_cast<qint64>(cs::AudioOutput::instance().stats().streamUnderruns);
+}
+
+int AudioStats::samplesCached() const
+{
+    return cs::PcmCache::instance().stats().entries;
+}
+
+qint64 AudioStats::sampleBytes() const
+{
+    return static_cast<qint64>(cs::PcmCache::instance().stats().residentBytes);
+}
+
+qint64 AudioStats::sampleCacheHits() const
+{
+    return static_cast<qint64>(cs::PcmCache::instance().stats().hits);
+}
+
+qint64 AudioStats::sampleLoads() const
+{
+    return static_cast<qint64>(cs::PcmCache::instance().stats().misses);
+}
+
+qreal AudioStats::sampleLoadMs() const
+{
+    return cs::PcmCache::instance().stats().lastLoadMs;
+}
+
+qreal AudioStats::maxSampleLoadMs() const
+{
+    return cs::PcmCache::instance().stats().maxLoadMs;
+}
+
+void AudioStats::resetStats()
+{
+    cs::PcmCache::instance().resetStats();
+    cs::AudioOutput::instance().resetStats();
+}
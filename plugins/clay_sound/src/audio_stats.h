@@ -0,0 +1,73 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// AudioStats — QML singleton exposing the shared AudioOutput's render
+// statistics: blocks rendered, sink underruns, commands dropped to a
+// full queue, and per-block render time / CPU load of the render
+// thread. Values refresh with AudioOutput::statsChanged (at most once
+// per pull period), so binding a debug overlay to them is cheap.
+// The sample* properties describe the shared PCM cache (decoded sample
+// memory, cache hits, load latency) and disk streaming; effectsLoad and
+// limiterReduction the bus / master effects.
+
+#ifndef CLAY_SOUND_AUDIO_STATS_H
+#define CLAY_SOUND_AUDIO_STATS_H
+
+#include <QObject>
+#include <QQmlEngine>
+
+class AudioStats : public QObject
+{
+    Q_OBJECT
+    QML_NAMED_ELEMENT(AudioStats)
+    QML_SINGLETON
+
+    Q_PROPERTY(bool   running         READ running         NOTIFY statsChanged)
+    Q_PROPERTY(qint64 blocks          READ blocks          NOTIFY statsChanged)
+    Q_PROPERTY(qint64 underruns       READ underruns       NOTIFY statsChanged)
+    Q_PROPERTY(qint64 droppedCommands READ droppedCommands NOTIFY statsChanged)
+    Q_PROPERTY(qreal  blockMs         READ blockMs         NOTIFY statsChanged)
+    Q_PROPERTY(qreal  maxBlockMs      READ maxBlockMs      NOTIFY statsChanged)
+    Q_PROPERTY(qreal  load            READ load            NOTIFY statsChanged)
+    Q_PROPERTY(int    activeVoices    READ activeVoices    NOTIFY statsChanged)
+    Q_PROPERTY(int    activeStreams   READ activeStreams   NOTIFY statsChanged)
+    Q_PROPERTY(qint64 streamUnderruns READ streamUnderruns NOTIFY statsChanged)
+    Q_PROPERTY(int    samplesCached   READ samplesCached   NOTIFY statsChanged)
+    Q_PROPERTY(qint64 sampleBytes     READ sampleBytes     NOTIFY statsChanged)
+    Q_PROPERTY(qint64 sampleCacheHits READ sampleCacheHits NOTIFY statsChanged)
+    Q_PROPERTY(qint64 sampleLoads     READ sampleLoads     NOTIFY statsChanged)
+    Q_PROPERTY(qreal  sampleLoadMs    READ sampleLoadMs    NOTIFY statsChanged)
+    Q_PROPERTY(qreal  maxSampleLoadMs READ maxSampleLoadMs NOTIFY statsChanged)
+    Q_PROPERTY(qreal  effectsLoad     READ effectsLoad     NOTIFY statsChanged)
+    Q_PROPERTY(qreal  limiterReduction READ limiterReduction NOTIFY statsChanged)
+
+public:
+    explicit AudioStats(QObject *parent = nullptr);
+
+    bool   running() const;
+    qint64 blocks() const;
+    qint64 underruns() const;
+    qint64 droppedCommands() const;
+    qreal  blockMs() const;
+    qreal  maxBlockMs() const;
+    qreal  load() const;
+    int    activeVoices() const;
+    int    activeStreams() const;
+    qint64 streamUnderruns() const;
+    int    samplesCached() const;
+    qint64 sampleBytes() const;
+    qint64 sampleCacheHits() const;
+    qint64 sampleLoads() const;
+    qreal  sampleLoadMs() const;
+    qreal  maxSampleLoadMs() const;
+    qreal  effectsLoad() const;
+    qreal  limiterReduction() const;   // dB, <= 0
+
+    // Zero underruns, dropped commands, cache hits / loads and the
+    // maxima.
+    Q_INVOKABLE void resetStats();
+
+signals:
+    void statsChanged();
+};
+
+#endif // CLAY_SOUND_AUDIO_STATS_H
@@ -1,13 +1,25 @@
 // (c) Clayground Contributors - MIT License, see "LICENSE" file
 #include "chipmood.h"
+#include "audio_output.h"
 #include "softsynth.h"
+#include "engine/bounce.h"
 #include "engine/pcm_buffer.h"
+#include <QCoreApplication>
 #include <QDebug>
-#include <QJsonDocument>
-#include <QJsonObject>
 #include <QRandomGenerator>
+#include <algorithm>
 #include <cmath>
+#include <memory>
 
+namespace {
+
+// Compositions are prepared at the rate of the engine they will play on.
+int outputRate()
+{
+    return clay::sound::AudioOutput::instance().sampleRate();
+}
+
+} // namespace
 
 int ChipMood::nextInstanceId_ = 0;
 
@@ -19,6 +31,12 @@ ChipMood::ChipMood(QObject *parent)
 
     connect(&sectionTimer_, &QTimer::timeout, this, &ChipMood::updateSectionInfo);
     sectionTimer_.setInterval(100);
+
+    connect(&generateWatcher_, &QFutureWatcher<ChipMoodResult>::finished, this, [this] {
+        const ChipMoodResult result = generateWatcher_.result();
+        // Settings may have moved on while this was generated.
+        if (result && result->key == pendingKey_) applyComposition(result);
+    });
 }
 
 ChipMood::~ChipMood()
@@ -39,10 +57,8 @@ void ChipMood::applyConfiguration()
     totalSections_ = 4;
     emit totalSectionsChanged();
     emit shareCodeChanged();
-    if (synth_) {
-        buildComposition();
-        // Composition is swapped in-place; if already playing, continues seamlessly
-    }
+    // Composition is swapped in-place; if already playing, continues seamlessly
+    requestComposition();
 }
 
 void ChipMood::setPreset(const QVariantMap &preset)
@@ -95,6 +111,19 @@ void ChipMood::setVolume(qreal volume)
     if (synth_) synth_->setVolume(volume);
 }
 
+int ChipMood::bus() const
+{
+    return synth_ ? synth_->bus() : SoftSynth::DEFAULT_BUS;
+}
+
+void ChipMood::setBus(int bus)
+{
+    if (!synth_) return;
+    const int before = synth_->bus();
+    synth_->setBus(bus);
+    if (synth_->bus() != before) emit busChanged();
+}
+
 void ChipMood::setIntensity(qreal intensity)
 {
     intensity = qBound(0.0, intensity, 1.0);
@@ -102,7 +131,7 @@ void ChipMood::setIntensity(qreal intensity)
     intensity_ = intensity;
     emit intensityChanged();
     emit shareCodeChanged();
-    if (synth_ && !preset_.isEmpty()) buildComposition();
+    requestComposition();
 }
 
 void ChipMood::setTempo(int tempo)
@@ -112,7 +141,7 @@ void ChipMood::setTempo(int tempo)
     tempo_ = tempo;
     emit tempoChanged();
     emit shareCodeChanged();
-    if (synth_ && !preset_.isEmpty()) buildComposition();
+    requestComposition();
 }
 
 void ChipMood::setSwing(qreal swing)
@@ -122,7 +151,7 @@ void ChipMood::setSwing(qreal swing)
     swing_ = swing;
     emit swingChanged();
     emit shareCodeChanged();
-    if (synth_ && !preset_.isEmpty()) buildComposition();
+    requestComposition();
 }
 
 void ChipMood::setVariation(qreal variation)
@@ -132,7 +161,7 @@ void ChipMood::setVariation(qreal variation)
     variation_ = variation;
     emit variationChanged();
     emit shareCodeChanged();
-    if (synth_ && !preset_.isEmpty()) buildComposition();
+    requestComposition();
 }
 
 void ChipMood::setOctaveShift(int shift)
@@ -142,7 +171,7 @@ void ChipMood::setOctaveShift(int shift)
     octaveShift_ = shift;
     emit octaveShiftChanged();
     emit shareCodeChanged();
-    if (synth_ && !preset_.isEmpty()) buildComposition();
+    requestComposition();
 }
 
 void ChipMood::setBrightness(qreal brightness)
@@ -276,8 +305,10 @@ QStringList ChipMood::availableLayers() const
 void ChipMood::play()
 {
     if (synth_) {
-        buildComposition();
-        synth_->play();
+        requestComposition();
+        // A composition still being generated starts when it arrives.
+        if (generating_) playWhenReady_ = true;
+        else synth_->play();
     }
     playing_ = true;
     emit playingChanged();
@@ -286,6 +317,7 @@ void ChipMood::play()
 
 void ChipMood::stop()
 {
+    playWhenReady_ = false;
     if (synth_) synth_->stop();
     sectionTimer_.stop();
     playing_ = false;
@@ -294,6 +326,7 @@ void ChipMood::stop()
 
 void ChipMood::pause()
 {
+    playWhenReady_ = false;
     if (synth_) synth_->pause();
     playing_ = false;
     emit playingChanged();
@@ -312,7 +345,7 @@ void ChipMood::randomize()
     seed_ = static_cast<int>(QRandomGenerator::global()->generate());
     emit seedChanged();
     emit shareCodeChanged();
-    if (synth_ && !preset_.isEmpty()) buildComposition();
+    requestComposition();
 }
 
 QString ChipMood::sectionName() const
@@ -349,9 +382,9 @@ void ChipMood::exportWav(const QString &path)
 {
     if (!synth_ || preset_.isEmpty() || path.isEmpty()) return;
 
-    // Rebuild the composition and render it offline via a scratch
-    // SoftSynth (live synth state is preserved).
-    buildComposition();
+    // Render the composition offline via a scratch SoftSynth (live synth
+    // state is preserved); one still being generated is built here.
+    if (!ensureComposition()) return;
     const int sampleRate = 44100;
     const int totalSamples = static_cast<int>(synth_->loopDuration() * sampleRate);
     if (totalSamples <= 0) return;
@@ -362,7 +395,7 @@ void ChipMood::exportWav(const QString &path)
     renderer.setFilterCutoff(filterHz);
     renderer.setEchoMix(preset_.value("echo", 0.3).toDouble());
     renderer.setVolume(volume_);
-    renderer.loadComposition(synth_->compositionData(), synth_->loopDuration());
+    renderer.loadComposition(synth_->composition());
 
     std::vector<float> samples(totalSamples);
     renderer.renderOffline(samples.data(), totalSamples);
@@ -379,171 +412,161 @@ void ChipMood::exportWav(const QString &path)
     emit exportFinished(path);
 }
 
-// Scale definitions (semitone offsets from root)
-static const QMap<QString, QList<int>> kScales = {
-    {"major",      {0, 2, 4, 5, 7, 9, 11}},
-    {"minor",      {0, 2, 3, 5, 7, 8, 10}},
-    {"dorian",     {0, 2, 3, 5, 7, 9, 10}},
-    {"phrygian",   {0, 1, 3, 5, 7, 8, 10}},
-    {"lydian",     {0, 2, 4, 6, 7, 9, 11}},
-    {"mixolydian", {0, 2, 4, 5, 7, 9, 10}},
-    {"pentatonic", {0, 2, 4, 7, 9}},
-    {"blues",      {0, 3, 5, 6, 7, 10}}
-};
-
-static double midiToFreq(int midi) {
-    return 440.0 * std::pow(2.0, (midi - 69) / 12.0);
-}
-
-static double scaleNote(const QList<int> &scale, int degree, int root, int octaveOff) {
-    int oct = degree / scale.size();
-    int idx = ((degree % scale.size()) + scale.size()) % scale.size();
-    return midiToFreq(root + scale[idx] + oct * 12 + octaveOff * 12);
+bool ChipMood::bounceStem(clay::sound::BounceStem *stem, int sampleRate, double tailSeconds)
+{
+    namespace cs = clay::sound;
+    if (!ensureComposition()) return false;
+    if (synth_->loopDuration() <= 0.0) return false;
+
+    // One instrument; every note carries its own patch, as in SoftSynth.
+    cs::BounceInstrument inst;
+    inst.gain = static_cast<float>(synth_->volume());
+    stem->instruments = { inst };
+    stem->patches.clear();
+    stem->notes.clear();
+    for (const NoteEvent &note : synth_->compositionData()) {
+        cs::BounceNote n;
+        n.frame          = static_cast<int64_t>(std::ceil(note.time * sampleRate - 1e-9));
+        n.durationFrames = std::llround(note.duration * sampleRate);
+        n.freqHz         = note.frequency;
+        n.velocity       = static_cast<float>(note.gain);
+        n.patch          = static_cast<int>(stem->patches.size());
+        stem->patches.push_back(SoftSynth::patchFor(note));
+        stem->notes.push_back(n);
+    }
+    stem->frames = std::llround((synth_->loopDuration() + std::max(0.0, tailSeconds)) * sampleRate);
+
+    // SoftSynth's bus effects, on the master of the bounce engine.
+    const double cutoff = synth_->filterCutoff();
+    const double echoMix = synth_->echoMix();
+    const double echoDelay = synth_->echoDelay();
+    stem->effects.clear();
+    stem->effects.push_back([cutoff](int rate) {
+        return std::unique_ptr<cs::IEffect>(SoftSynth::makeFilter(cutoff, rate));
+    });
+    stem->effects.push_back([echoMix, echoDelay](int rate) {
+        return std::unique_ptr<cs::IEffect>(SoftSynth::makeEcho(echoMix, echoDelay, rate));
+    });
+    return true;
+}
+
+void ChipMood::setAsynchronous(bool async)
+{
+    if (asynchronous_ == async) return;
+    asynchronous_ = async;
+    emit asynchronousChanged();
 }
 
-// Simple seeded PRNG (mulberry32)
-static uint32_t mulberry32(uint32_t &state) {
-    state += 0x6D2B79F5;
-    uint32_t t = state;
-    t = (t ^ (t >> 15)) * (t | 1);
-    t ^= t + (t ^ (t >> 7)) * (t | 61);
-    return t ^ (t >> 14);
-}
+ChipMoodParams ChipMood::params() const
+{
+    ChipMoodParams p;
+    p.preset = preset_;
+    p.presetName = presetName_;
+    p.scale = scale_;
+    p.layers = layers_;
+    p.seed = seed_;
+    p.intensity = intensity_;
+    p.variation = variation_;
+    p.swing = swing_;
+    p.octaveShift = octaveShift_;
+    return p;
+}
+
+void ChipMood::requestComposition()
+{
+    if (!synth_ || preset_.isEmpty()) return;
+    const ChipMoodParams p = params();
+    const QString key = p.key(outputRate());
+    if (current_ && current_->key == key) {
+        // Nothing the notes depend on changed (tempo follows the seed).
+        pendingKey_.clear();
+        applyComposition(current_);
+        return;
+    }
+    if (ChipMoodResult hit = ChipMoodGenerator::cached(key)) {
+        applyComposition(hit);
+        return;
+    }
 
-static double rngFloat(uint32_t &state) {
-    return mulberry32(state) / 4294967296.0;
+#if QT_CONFIG(thread) && !defined(Q_OS_WASM)
+    // Without an application object there is no event loop to deliver
+    // the result; generate in place like the synchronous path.
+    if (asynchronous_ && QCoreApplication::instance()) {
+        if (key == pendingKey_) return;
+        pendingKey_ = key;
+        generateWatcher_.setFuture(ChipMoodGenerator::request(p, outputRate()));
+        setGenerating(true);
+        return;
+    }
+#endif
+    applyComposition(ChipMoodGenerator::obtain(p, outputRate()));
 }
 
-// Map arpStyle to a base pattern
-static QList<int> arpPattern(const QString &style) {
-    if (style == "flowing")     return {0,2,4,6, 0,2,4,7, 0,2,5,6, 0,2,4,6};
-    if (style == "pulsing")     return {0,0,1,0, 0,0,1,0, 0,0,1,0, 0,0,2,0};
-    if (style == "bright")      return {0,2,4,2, 0,2,4,5, 0,2,4,2, 0,4,2,0};
-    if (style == "sparse")      return {0,-1,-1,-1, 2,-1,-1,-1, 4,-1,-1,-1, 2,-1,-1,-1};
-    if (style == "majestic")    return {0,-1,4,-1, 0,-1,7,-1, 0,-1,4,-1, 0,-1,5,-1};
-    if (style == "wave")        return {0,1,2,3, 4,3,2,1, 0,1,2,3, 4,5,4,3};
-    if (style == "exotic")      return {0,1,4,1, 0,1,5,1, 0,1,4,1, 0,3,1,0};
-    if (style == "crystalline") return {0,-1,4,-1, 7,-1,4,-1, 0,-1,5,-1, 7,-1,5,-1};
-    return {0,2,4,6, 0,2,4,7};
+bool ChipMood::ensureComposition()
+{
+    if (!synth_ || preset_.isEmpty()) return false;
+    const ChipMoodParams p = params();
+    if (!current_ || current_->key != p.key(outputRate()))
+        applyComposition(ChipMoodGenerator::obtain(p, outputRate()));
+    return true;
 }
 
-static QList<int> melodyPattern(const QString &style) {
-    if (style == "flowing")     return {4,3,2,1, 2,-1,-1,-1, 4,5,4,3, 2,-1,-1,-1};
-    if (style == "pulsing")     return {0,-1,1,-1, 0,-1,-1,-1, -1,-1,2,-1, 1,-1,-1,-1};
-    if (style == "bright")      return {4,2,0,2, 4,4,4,-1, 5,4,2,4, 5,5,5,-1};
-    if (style == "sparse")      return {2,-1,-1,-1, -1,-1,-1,-1, 4,-1,-1,-1, -1,-1,-1,-1};
-    if (style == "majestic")    return {4,-1,5,-1, 7,-1,-1,-1, 5,-1,4,-1, 2,-1,-1,-1};
-    if (style == "wave")        return {2,3,4,5, 4,3,2,-1, 3,4,5,6, 5,4,3,-1};
-    if (style == "exotic")      return {0,1,3,-1, 5,-1,-1,-1, 3,1,0,-1, -1,-1,-1,-1};
-    if (style == "crystalline") return {7,-1,-1,-1, 5,-1,-1,-1, 4,-1,-1,-1, -1,-1,-1,-1};
-    return {4,3,2,1, 2,-1,-1,-1};
+void ChipMood::applyComposition(const ChipMoodResult &composition)
+{
+    pendingKey_.clear();
+    setGenerating(false);
+    current_ = composition;
+
+    if (tempo_ != composition->tempo) {
+        tempo_ = composition->tempo;
+        emit tempoChanged();
+        emit shareCodeChanged();
+    }
+    applySynthSettings();
+    if (synth_->composition() != composition->music)
+        synth_->loadComposition(composition->music);
+    if (playWhenReady_) {
+        playWhenReady_ = false;
+        synth_->play();
+    }
 }
 
-void ChipMood::buildComposition()
+void ChipMood::applySynthSettings()
 {
-    if (!synth_ || preset_.isEmpty()) return;
-
-    const auto scale = kScales.value(scale_, kScales["dorian"]);
-    const auto tempoRange = preset_["tempoRange"].toList();
-    const auto rootRange = preset_["rootRange"].toList();
-    const double echo = preset_.value("echo", 0.3).toDouble();
     const double warmth = preset_.value("warmth", 0.5).toDouble();
-    const QString arpStyle = preset_.value("arpStyle", "flowing").toString();
-    const auto sectionPat = preset_.value("sectionPattern", QVariantList{16,16,16,8}).toList();
-
-    uint32_t rng = static_cast<uint32_t>(seed_);
-
-    // Derive tempo and root from seed within ranges
-    int tLo = tempoRange.size() >= 2 ? tempoRange[0].toInt() : 80;
-    int tHi = tempoRange.size() >= 2 ? tempoRange[1].toInt() : 100;
-    tempo_ = tLo + static_cast<int>(rngFloat(rng) * (tHi - tLo));
-    int rLo = rootRange.size() >= 2 ? rootRange[0].toInt() : 48;
-    int rHi = rootRange.size() >= 2 ? rootRange[1].toInt() : 55;
-    int root = rLo + static_cast<int>(rngFloat(rng) * (rHi - rLo));
-
-    const double secPerBeat = 60.0 / tempo_;
-    const double stepDur = 0.25 * secPerBeat; // 16th note
-
-    // Calculate total beats across all sections
-    int totalBeats = 0;
-    for (const auto &s : sectionPat) totalBeats += s.toInt();
-    int totalSteps = totalBeats * 4; // 16th notes
-    double loopDuration = totalSteps * stepDur;
-
-    // Get patterns
-    auto arp = arpPattern(arpStyle);
-    auto mel = melodyPattern(arpStyle); // use same style for melody
-
-    std::vector<NoteEvent> notes;
-
-    for (int step = 0; step < totalSteps; ++step) {
-        double t = step * stepDur;
-
-        // Swing: offset every other 16th note for shuffle feel
-        if (step % 2 == 1)
-            t += swing_ * stepDur * 0.33;
-
-        // Per-step variation RNG (deterministic, independent of composition seed)
-        uint32_t varRng = static_cast<uint32_t>(seed_ * 7 + step);
-
-        // Arpeggio layer
-        if (layers_.contains("arp") && !arp.isEmpty()) {
-            int deg = arp[step % arp.size()];
-            if (deg >= 0) {
-                if (variation_ > 0 && rngFloat(varRng) < variation_ * 0.15)
-                    deg += (rngFloat(varRng) < 0.5) ? 1 : -1;
-                double noteT = t;
-                if (variation_ > 0)
-                    noteT += (rngFloat(varRng) - 0.5) * variation_ * stepDur * 0.1;
-                double freq = scaleNote(scale, deg, root, 1 + octaveShift_);
-                double vol = 0.3 * (0.5 + intensity_ * 0.5);
-                notes.push_back({noteT, freq, stepDur * 0.9, vol, Voice::Triangle});
-            }
-        }
-
-        // Melody layer (half-note resolution)
-        if (layers_.contains("melody") && (step % 2 == 0) && !mel.isEmpty()) {
-            int deg = mel[(step / 2) % mel.size()];
-            if (deg >= 0) {
-                if (variation_ > 0 && rngFloat(varRng) < variation_ * 0.1)
-                    deg += (rngFloat(varRng) < 0.5) ? 1 : -1;
-                double noteT = t;
-                if (variation_ > 0)
-                    noteT += (rngFloat(varRng) - 0.5) * variation_ * stepDur * 0.05;
-                double freq = scaleNote(scale, deg, root, 0 + octaveShift_);
-                double vol = 0.25 * (0.5 + intensity_ * 0.5);
-                notes.push_back({noteT, freq, stepDur * 1.8, vol, Voice::Sine});
-            }
-        }
-
-        // Pad layer (whole-note resolution)
-        if (layers_.contains("pad") && (step % 16 == 0)) {
-            double freq = scaleNote(scale, 0, root, -1 + octaveShift_);
-            double vol = 0.15 * (0.5 + intensity_ * 0.5);
-            notes.push_back({t, freq, stepDur * 16, vol, Voice::Sine});
-        }
-
-        // Bass layer (half-note resolution)
-        if (layers_.contains("bass") && (step % 2 == 0)) {
-            int bassPattern[] = {0, -1, 0, -1, 2, -1, 0, -1};
-            int deg = bassPattern[(step / 2) % 8];
-            if (deg >= 0) {
-                double noteT = t;
-                if (variation_ > 0)
-                    noteT += (rngFloat(varRng) - 0.5) * variation_ * stepDur * 0.08;
-                double freq = scaleNote(scale, deg, root, -2 + octaveShift_);
-                double vol = 0.2 * (0.5 + intensity_ * 0.5);
-                notes.push_back({noteT, freq, stepDur * 1.8, vol, Voice::Triangle});
-            }
-        }
-    }
-
-    // Configure synth effects
     double filterHz = 4000.0 + (1.0 - warmth) * 12000.0;
     filterHz *= (0.5 + brightness_ * 0.5);
     synth_->setFilterCutoff(filterHz);
-    synth_->setEchoMix(echo);
+    synth_->setEchoMix(preset_.value("echo", 0.3).toDouble());
     synth_->setVolume(volume_);
+}
 
-    synth_->loadComposition(notes, loopDuration);
+void ChipMood::setGenerating(bool generating)
+{
+    if (generating_ == generating) return;
+    generating_ = generating;
+    emit generatingChanged();
+}
+
+void ChipMood::precompute(const QVariantMap &changes)
+{
+    ChipMoodParams p = params();
+    p.preset = changes.value("preset", p.preset).toMap();
+    p.presetName = changes.value("presetName", p.presetName).toString();
+    p.scale = changes.value("scale", p.scale).toString();
+    p.layers = changes.value("layers", p.layers).toStringList();
+    p.seed = changes.value("seed", p.seed).toInt();
+    p.intensity = qBound(0.0, changes.value("intensity", p.intensity).toDouble(), 1.0);
+    p.variation = qBound(0.0, changes.value("variation", p.variation).toDouble(), 1.0);
+    p.swing = qBound(0.0, changes.value("swing", p.swing).toDouble(), 1.0);
+    p.octaveShift = qBound(-2, changes.value("octaveShift", p.octaveShift).toInt(), 2);
+    if (p.preset.isEmpty()) return;
+
+#if QT_CONFIG(thread) && !defined(Q_OS_WASM)
+    if (asynchronous_ && QCoreApplication::instance()) {
+        ChipMoodGenerator::request(p, outputRate());
+        return;
+    }
+#endif
+    ChipMoodGenerator::obtain(p, outputRate());
 }
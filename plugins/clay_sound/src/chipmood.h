@@ -2,6 +2,9 @@
 #ifndef CHIPMOOD_H
 #define CHIPMOOD_H
 
+#include "chipmood_generator.h"
+
+#include <QFutureWatcher>
 #include <QObject>
 #include <QQmlEngine>
 #include <QString>
@@ -9,7 +12,7 @@
 #include <QTimer>
 #include <QVariantMap>
 
-class SoftSynth;
+namespace clay::sound { struct BounceStem; }
 
 /*!
     \class ChipMood
@@ -47,6 +50,17 @@ class SoftSynth;
     }
     \endqml
 
+    Compositions are generated on a worker thread and kept in a small
+    process-wide cache, so changing \c intensity or \c presetName does not
+    stall the GUI: the current music plays on until the new one is ready
+    and then crossfades. Moods likely to come next can be prepared ahead
+    with precompute(), after which switching to them is instant:
+    \code
+    // Warm up the next intensity step and the boss theme
+    music.precompute({intensity: music.intensity + 0.25})
+    music.precompute({presetName: "boss", preset: bossPreset})
+    \endcode
+
     Share compositions using the shareCode property:
     \code
     // Get shareable code
@@ -77,12 +91,23 @@ class ChipMood : public QObject
     Q_PROPERTY(int octaveShift READ octaveShift WRITE setOctaveShift NOTIFY octaveShiftChanged)
     Q_PROPERTY(qreal brightness READ brightness WRITE setBrightness NOTIFY brightnessChanged)
 
+    // Mix bus on the shared audio output (not part of the share code).
+    // Moods on the same bus share its filter and echo.
+    Q_PROPERTY(int bus READ bus WRITE setBus NOTIFY busChanged)
+
     // Share code (encodes full state)
     Q_PROPERTY(QString shareCode READ shareCode WRITE setShareCode NOTIFY shareCodeChanged)
 
+    // Generate on a worker thread (default). When false, changes rebuild
+    // the composition in place, as exports always do.
+    Q_PROPERTY(bool asynchronous READ asynchronous WRITE setAsynchronous NOTIFY asynchronousChanged)
+
     // Status properties (read-only)
     Q_PROPERTY(bool playing READ playing NOTIFY playingChanged)
     Q_PROPERTY(bool ready READ ready NOTIFY readyChanged)
+    // A composition for the current settings is being generated; the
+    // previous one keeps playing meanwhile.
+    Q_PROPERTY(bool generating READ generating NOTIFY generatingChanged)
     Q_PROPERTY(int currentSection READ currentSection NOTIFY currentSectionChanged)
     Q_PROPERTY(int totalSections READ totalSections NOTIFY totalSectionsChanged)
     Q_PROPERTY(qreal sectionProgress READ sectionProgress NOTIFY sectionProgressChanged)
@@ -116,6 +141,9 @@ public:
     qreal volume() const { return volume_; }
     void setVolume(qreal volume);
 
+    int bus() const;
+    void setBus(int bus);
+
     qreal intensity() const { return intensity_; }
     void setIntensity(qreal intensity);
 
@@ -138,9 +166,13 @@ public:
     QString shareCode() const;
     void setShareCode(const QString &code);
 
+    bool asynchronous() const { return asynchronous_; }
+    void setAsynchronous(bool async);
+
     // Status
     bool playing() const { return playing_; }
     bool ready() const { return ready_; }
+    bool generating() const { return generating_; }
     int currentSection() const { return currentSection_; }
     int totalSections() const { return totalSections_; }
     qreal sectionProgress() const { return sectionProgress_; }
@@ -150,6 +182,11 @@ public:
     QStringList availableScales() const;
     QStringList availableLayers() const;
 
+    // Fill `stem` with one loop of the current composition plus
+    // `tailSeconds` for the echo to ring out, for AudioBounce. Rebuilds
+    // the composition like exportWav(). False without a preset.
+    bool bounceStem(clay::sound::BounceStem *stem, int sampleRate, double tailSeconds);
+
 public slots:
     void play();
     void stop();
@@ -158,6 +195,12 @@ public slots:
     void randomize();
     Q_INVOKABLE void exportWav(const QString &path = QString());
 
+    // Generate the composition for the current settings with `changes`
+    // applied (keys: preset, presetName, scale, layers, seed, intensity,
+    // variation, swing, octaveShift) into the cache, without switching
+    // to it. Setting those values later swaps it in at once.
+    Q_INVOKABLE void precompute(const QVariantMap &changes = QVariantMap());
+
 signals:
     void presetChanged();
     void presetNameChanged();
@@ -165,6 +208,7 @@ signals:
     void layersChanged();
     void seedChanged();
     void volumeChanged();
+    void busChanged();
     void intensityChanged();
     void tempoChanged();
     void swingChanged();
@@ -174,6 +218,8 @@ signals:
     void shareCodeChanged();
     void playingChanged();
     void readyChanged();
+    void asynchronousChanged();
+    void generatingChanged();
     void currentSectionChanged();
     void totalSectionsChanged();
     void sectionProgressChanged();
@@ -186,7 +232,15 @@ private slots:
 private:
     void initAudio();
     void applyConfiguration();
-    void buildComposition();
+    ChipMoodParams params() const;
+    // Switch to the composition for the current settings: from the cache,
+    // else generated (asynchronously if enabled) and applied when done.
+    void requestComposition();
+    // Same, but always in place; for exports. False without a preset.
+    bool ensureComposition();
+    void applyComposition(const ChipMoodResult &composition);
+    void applySynthSettings();
+    void setGenerating(bool generating);
 
     // Core identity
     QVariantMap preset_;
@@ -204,9 +258,13 @@ private:
     int octaveShift_ = 0;
     qreal brightness_ = 0.5;
 
+    bool asynchronous_ = true;
+
     // Status
     bool playing_ = false;
     bool ready_ = false;
+    bool generating_ = false;
+    bool playWhenReady_ = false;
     int currentSection_ = 0;
     int totalSections_ = 4;
     qreal sectionProgress_ = 0.0;
@@ -217,6 +275,9 @@ private:
     static int nextInstanceId_;
 
     SoftSynth *synth_ = nullptr;
+    ChipMoodResult current_;          // what synth_ holds
+    QString pendingKey_;              // being generated for the current settings
+    QFutureWatcher<ChipMoodResult> generateWatcher_;
 };
 
 #endif // CHIPMOOD_H
@@ -0,0 +1,314 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+#include "chipmood_generator.h"
+
+#include <QCryptographicHash>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QtFuture>
+#include <algorithm>
+#include <cmath>
+#include <list>
+
+namespace {
+
+// Scale definitions (semitone offsets from root)
+const QMap<QString, QList<int>> kScales = {
+    {"major",      {0, 2, 4, 5, 7, 9, 11}},
+    {"minor",      {0, 2, 3, 5, 7, 8, 10}},
+    {"dorian",     {0, 2, 3, 5, 7, 9, 10}},
+    {"phrygian",   {0, 1, 3, 5, 7, 8, 10}},
+    {"lydian",     {0, 2, 4, 6, 7, 9, 11}},
+    {"mixolydian", {0, 2, 4, 5, 7, 9, 10}},
+    {"pentatonic", {0, 2, 4, 7, 9}},
+    {"blues",      {0, 3, 5, 6, 7, 10}}
+};
+
+double midiToFreq(int midi) {
+    return 440.0 * std::pow(2.0, (midi - 69) / 12.0);
+}
+
+double scaleNote(const QList<int> &scale, int degree, int root, int octaveOff) {
+    int oct = degree / scale.size();
+    int idx = ((degree % scale.size()) + scale.size()) % scale.size();
+    return midiToFreq(root + scale[idx] + oct * 12 + octaveOff * 12);
+}
+
+// Simple seeded PRNG (mulberry32)
+uint32_t mulberry32(uint32_t &state) {
+    state += 0x6D2B79F5;
+    uint32_t t = state;
+    t = (t ^ (t >> 15)) * (t | 1);
+    t ^= t + (t ^ (t >> 7)) * (t | 61);
+    return t ^ (t >> 14);
+}
+
+double rngFloat(uint32_t &state) {
+    return mulberry32(state) / 4294967296.0;
+}
+
+// Map arpStyle to a base pattern
+QList<int> arpPattern(const QString &style) {
+    if (style == "flowing")     return {0,2,4,6, 0,2,4,7, 0,2,5,6, 0,2,4,6};
+    if (style == "pulsing")     return {0,0,1,0, 0,0,1,0, 0,0,1,0, 0,0,2,0};
+    if (style == "bright")      return {0,2,4,2, 0,2,4,5, 0,2,4,2, 0,4,2,0};
+    if (style == "sparse")      return {0,-1,-1,-1, 2,-1,-1,-1, 4,-1,-1,-1, 2,-1,-1,-1};
+    if (style == "majestic")    return {0,-1,4,-1, 0,-1,7,-1, 0,-1,4,-1, 0,-1,5,-1};
+    if (style == "wave")        return {0,1,2,3, 4,3,2,1, 0,1,2,3, 4,5,4,3};
+    if (style == "exotic")      return {0,1,4,1, 0,1,5,1, 0,1,4,1, 0,3,1,0};
+    if (style == "crystalline") return {0,-1,4,-1, 7,-1,4,-1, 0,-1,5,-1, 7,-1,5,-1};
+    return {0,2,4,6, 0,2,4,7};
+}
+
+QList<int> melodyPattern(const QString &style) {
+    if (style == "flowing")     return {4,3,2,1, 2,-1,-1,-1, 4,5,4,3, 2,-1,-1,-1};
+    if (style == "pulsing")     return {0,-1,1,-1, 0,-1,-1,-1, -1,-1,2,-1, 1,-1,-1,-1};
+    if (style == "bright")      return {4,2,0,2, 4,4,4,-1, 5,4,2,4, 5,5,5,-1};
+    if (style == "sparse")      return {2,-1,-1,-1, -1,-1,-1,-1, 4,-1,-1,-1, -1,-1,-1,-1};
+    if (style == "majestic")    return {4,-1,5,-1, 7,-1,-1,-1, 5,-1,4,-1, 2,-1,-1,-1};
+    if (style == "wave")        return {2,3,4,5, 4,3,2,-1, 3,4,5,6, 5,4,3,-1};
+    if (style == "exotic")      return {0,1,3,-1, 5,-1,-1,-1, 3,1,0,-1, -1,-1,-1,-1};
+    if (style == "crystalline") return {7,-1,-1,-1, 5,-1,-1,-1, 4,-1,-1,-1, -1,-1,-1,-1};
+    return {4,3,2,1, 2,-1,-1,-1};
+}
+
+struct State
+{
+    QMutex mutex;
+    std::list<ChipMoodResult> lru;                      // most recent first
+    QHash<QString, QFuture<ChipMoodResult>> running;    // key -> job
+    int capacity = 8;
+};
+
+State &state()
+{
+    static State s;
+    return s;
+}
+
+// Callers hold the mutex.
+ChipMoodResult touch(State &s, const QString &key)
+{
+    for (auto it = s.lru.begin(); it != s.lru.end(); ++it) {
+        if ((*it)->key == key) {
+            s.lru.splice(s.lru.begin(), s.lru, it);
+            return s.lru.front();
+        }
+    }
+    return {};
+}
+
+void insert(State &s, const ChipMoodResult &result)
+{
+    if (touch(s, result->key)) return;
+    s.lru.push_front(result);
+    while (static_cast<int>(s.lru.size()) > s.capacity)
+        s.lru.pop_back();
+}
+
+} // namespace
+
+QString ChipMoodParams::key(int sampleRate) const
+{
+    // QJsonObject sorts its keys, so equal presets hash the same.
+    const QByteArray presetJson =
+        QJsonDocument(QJsonObject::fromVariantMap(preset)).toJson(QJsonDocument::Compact);
+    const QByteArray presetHash =
+        QCryptographicHash::hash(presetJson, QCryptographicHash::Sha1).toHex().left(16);
+    return QStringLiteral("%1-%2-%3-%4-%5-%6-%7-%8-%9@%10")
+        .arg(presetName.isEmpty() ? QStringLiteral("custom") : presetName, scale,
+             layers.join(u'+'),
+             QString::number(intensity, 'g', 17), QString::number(variation, 'g', 17),
+             QString::number(swing, 'g', 17), QString::number(octaveShift),
+             QString::number(seed), QString::fromLatin1(presetHash))
+        .arg(sampleRate);
+}
+
+namespace ChipMoodGenerator {
+
+ChipMoodResult generate(const ChipMoodParams &params, int sampleRate)
+{
+    const auto scale = kScales.value(params.scale, kScales["dorian"]);
+    const auto tempoRange = params.preset["tempoRange"].toList();
+    const auto rootRange = params.preset["rootRange"].toList();
+    const QString arpStyle = params.preset.value("arpStyle", "flowing").toString();
+    const auto sectionPat = params.preset.value("sectionPattern", QVariantList{16,16,16,8}).toList();
+
+    uint32_t rng = static_cast<uint32_t>(params.seed);
+
+    // Derive tempo and root from seed within ranges
+    int tLo = tempoRange.size() >= 2 ? tempoRange[0].toInt() : 80;
+    int tHi = tempoRange.size() >= 2 ? tempoRange[1].toInt() : 100;
+    const int tempo = tLo + static_cast<int>(rngFloat(rng) * (tHi - tLo));
+    int rLo = rootRange.size() >= 2 ? rootRange[0].toInt() : 48;
+    int rHi = rootRange.size() >= 2 ? rootRange[1].toInt() : 55;
+    int root = rLo + static_cast<int>(rngFloat(rng) * (rHi - rLo));
+
+    const double secPerBeat = 60.0 / tempo;
+    const double stepDur = 0.25 * secPerBeat; // 16th note
+
+    // Calculate total beats across all sections
+    int totalBeats = 0;
+    for (const auto &s : sectionPat) totalBeats += s.toInt();
+    int totalSteps = totalBeats * 4; // 16th notes
+    double loopDuration = totalSteps * stepDur;
+
+    // Get patterns
+    auto arp = arpPattern(arpStyle);
+    auto mel = melodyPattern(arpStyle); // use same style for melody
+
+    std::vector<NoteEvent> notes;
+
+    for (int step = 0; step < totalSteps; ++step) {
+        double t = step * stepDur;
+
+        // Swing: offset every other 16th note for shuffle feel
+        if (step % 2 == 1)
+            t += params.swing * stepDur * 0.33;
+
+        // Per-step variation RNG (deterministic, independent of composition seed)
+        uint32_t varRng = static_cast<uint32_t>(params.seed * 7 + step);
+
+        // Arpeggio layer
+        if (params.layers.contains("arp") && !arp.isEmpty()) {
+            int deg = arp[step % arp.size()];
+            if (deg >= 0) {
+                if (params.variation > 0 && rngFloat(varRng) < params.variation * 0.15)
+                    deg += (rngFloat(varRng) < 0.5) ? 1 : -1;
+                double noteT = t;
+                if (params.variation > 0)
+                    noteT += (rngFloat(varRng) - 0.5) * params.variation * stepDur * 0.1;
+                double freq = scaleNote(scale, deg, root, 1 + params.octaveShift);
+                double vol = 0.3 * (0.5 + params.intensity * 0.5);
+                notes.push_back({noteT, freq, stepDur * 0.9, vol, Voice::Triangle});
+            }
+        }
+
+        // Melody layer (half-note resolution)
+        if (params.layers.contains("melody") && (step % 2 == 0) && !mel.isEmpty()) {
+            int deg = mel[(step / 2) % mel.size()];
+            if (deg >= 0) {
+                if (params.variation > 0 && rngFloat(varRng) < params.variation * 0.1)
+                    deg += (rngFloat(varRng) < 0.5) ? 1 : -1;
+                double noteT = t;
+                if (params.variation > 0)
+                    noteT += (rngFloat(varRng) - 0.5) * params.variation * stepDur * 0.05;
+                double freq = scaleNote(scale, deg, root, 0 + params.octaveShift);
+                double vol = 0.25 * (0.5 + params.intensity * 0.5);
+                notes.push_back({noteT, freq, stepDur * 1.8, vol, Voice::Sine});
+            }
+        }
+
+        // Pad layer (whole-note resolution)
+        if (params.layers.contains("pad") && (step % 16 == 0)) {
+            double freq = scaleNote(scale, 0, root, -1 + params.octaveShift);
+            double vol = 0.15 * (0.5 + params.intensity * 0.5);
+            notes.push_back({t, freq, stepDur * 16, vol, Voice::Sine});
+        }
+
+        // Bass layer (half-note resolution)
+        if (params.layers.contains("bass") && (step % 2 == 0)) {
+            int bassPattern[] = {0, -1, 0, -1, 2, -1, 0, -1};
+            int deg = bassPattern[(step / 2) % 8];
+            if (deg >= 0) {
+                double noteT = t;
+                if (params.variation > 0)
+                    noteT += (rngFloat(varRng) - 0.5) * params.variation * stepDur * 0.08;
+                double freq = scaleNote(scale, deg, root, -2 + params.octaveShift);
+                double vol = 0.2 * (0.5 + params.intensity * 0.5);
+                notes.push_back({noteT, freq, stepDur * 1.8, vol, Voice::Triangle});
+            }
+        }
+    }
+
+    auto result = std::make_shared<ChipMoodComposition>();
+    result->key = params.key(sampleRate);
+    result->tempo = tempo;
+    result->music = SoftSynth::prepare(std::move(notes), loopDuration, sampleRate);
+    return result;
+}
+
+ChipMoodResult cached(const QString &key)
+{
+    State &s = state();
+    QMutexLocker lock(&s.mutex);
+    return touch(s, key);
+}
+
+ChipMoodResult obtain(const ChipMoodParams &params, int sampleRate)
+{
+    if (ChipMoodResult hit = cached(params.key(sampleRate)))
+        return hit;
+    ChipMoodResult result = generate(params, sampleRate);
+    State &s = state();
+    QMutexLocker lock(&s.mutex);
+    insert(s, result);
+    return result;
+}
+
+QFuture<ChipMoodResult> request(const ChipMoodParams &params, int sampleRate)
+{
+#if QT_CONFIG(thread) && !defined(Q_OS_WASM)
+    const QString key = params.key(sampleRate);
+    State &s = state();
+    QMutexLocker lock(&s.mutex);
+    if (ChipMoodResult hit = touch(s, key))
+        return QtFuture::makeReadyValueFuture(hit);
+    const auto running = s.running.constFind(key);
+    if (running != s.running.constEnd())
+        return *running;
+
+    // The job takes the mutex to publish its result, so it cannot finish
+    // before it is registered as running.
+    QFuture<ChipMoodResult> job = QtConcurrent::run(QThreadPool::globalInstance(),
+                                                    [params, sampleRate] {
+        ChipMoodResult result = generate(params, sampleRate);
+        State &s = state();
+        QMutexLocker lock(&s.mutex);
+        s.running.remove(result->key);
+        insert(s, result);
+        return result;
+    });
+    s.running.insert(key, job);
+    return job;
+#else
+    return QtFuture::makeReadyValueFuture(obtain(params, sampleRate));
+#endif
+}
+
+void setCacheCapacity(int n)
+{
+    State &s = state();
+    QMutexLocker lock(&s.mutex);
+    s.capacity = std::max(1, n);
+    while (static_cast<int>(s.lru.size()) > s.capacity)
+        s.lru.pop_back();
+}
+
+int cacheCapacity()
+{
+    State &s = state();
+    QMutexLocker lock(&s.mutex);
+    return s.capacity;
+}
+
+int cacheSize()
+{
+    State &s = state();
+    QMutexLocker lock(&s.mutex);
+    return static_cast<int>(s.lru.size());
+}
+
+void clearCache()
+{
+    State &s = state();
+    QMutexLocker lock(&s.mutex);
+    s.lru.clear();
+}
+
+} // namespace ChipMoodGenerator
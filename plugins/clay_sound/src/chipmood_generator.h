@@ -0,0 +1,79 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// ChipMoodGenerator — builds ChipMood compositions off the GUI thread.
+// A composition is a pure function of its ChipMoodParams, so results are
+// kept in a small process-wide LRU keyed by ChipMoodParams::key(): a mood
+// that comes back (explore -> combat -> explore) or was precomputed
+// swaps in without generating again, and requests for a key that is
+// already being generated share the running job.
+//
+// Results come prepared for SoftSynth (notes sorted, engine form at the
+// output rate), so applying one on the GUI thread is a pointer swap.
+// All functions are thread-safe.
+
+#ifndef CHIPMOOD_GENERATOR_H
+#define CHIPMOOD_GENERATOR_H
+
+#include "softsynth.h"
+
+#include <QFuture>
+#include <QString>
+#include <QStringList>
+#include <QVariantMap>
+#include <memory>
+
+// Everything the notes of a ChipMood depend on. Volume, brightness and
+// bus only shape playback and are left out.
+struct ChipMoodParams
+{
+    QVariantMap preset;
+    QString presetName;
+    QString scale = "dorian";
+    QStringList layers;
+    int seed = 0;
+    double intensity = 0.5;
+    double variation = 0.0;
+    double swing = 0.0;
+    int octaveShift = 0;
+
+    // The share code's fields at full precision, plus what the share
+    // code leaves out: swing, octave shift, the preset's contents and
+    // the sample rate the engine form is prepared for.
+    QString key(int sampleRate) const;
+};
+
+struct ChipMoodComposition
+{
+    QString key;
+    int tempo = 0;      // picked from the preset's range by the seed
+    std::shared_ptr<const SoftSynth::Prepared> music;
+};
+
+using ChipMoodResult = std::shared_ptr<const ChipMoodComposition>;
+
+namespace ChipMoodGenerator {
+
+// Build without the cache. sampleRate 0 leaves out the engine form.
+ChipMoodResult generate(const ChipMoodParams &params, int sampleRate);
+
+// The cached result for `key`, or null. A hit becomes the most recent.
+ChipMoodResult cached(const QString &key);
+
+// Cached, else generated here and cached.
+ChipMoodResult obtain(const ChipMoodParams &params, int sampleRate);
+
+// Cached, else generated on a worker thread (or joined if already
+// running) and cached once done. Without thread support the result is
+// generated before this returns.
+QFuture<ChipMoodResult> request(const ChipMoodParams &params, int sampleRate);
+
+// Compositions kept (default 8); lowering it evicts the least recently
+// used.
+void setCacheCapacity(int n);
+int cacheCapacity();
+int cacheSize();
+void clearCache();
+
+} // namespace ChipMoodGenerator
+
+#endif // CHIPMOOD_GENERATOR_H
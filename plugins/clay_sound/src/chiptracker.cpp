@@ -127,6 +127,19 @@ void ChipTracker::setVolume(qreal volume)
     if (synth_) synth_->setVolume(volume);
 }
 
+int ChipTracker::bus() const
+{
+    return synth_ ? synth_->bus() : SoftSynth::DEFAULT_BUS;
+}
+
+void ChipTracker::setBus(int bus)
+{
+    if (!synth_) return;
+    const int before = synth_->bus();
+    synth_->setBus(bus);
+    if (synth_->bus() != before) emit busChanged();
+}
+
 void ChipTracker::setSwing(qreal swing)
 {
     swing = qBound(0.0, swing, 1.0);
@@ -58,6 +58,9 @@ class ChipTracker : public QObject
     Q_PROPERTY(qreal swing READ swing WRITE setSwing NOTIFY swingChanged)
     Q_PROPERTY(qreal brightness READ brightness WRITE setBrightness NOTIFY brightnessChanged)
     Q_PROPERTY(qreal echoMix READ echoMix WRITE setEchoMix NOTIFY echoMixChanged)
+    // Mix bus on the shared audio output; its filter and echo are shared
+    // with a ChipMood on the same bus.
+    Q_PROPERTY(int bus READ bus WRITE setBus NOTIFY busChanged)
 
     // Playback state
     Q_PROPERTY(bool playing READ playing NOTIFY playingChanged)
@@ -95,6 +98,8 @@ public:
     void setBrightness(qreal brightness);
     qreal echoMix() const { return echoMix_; }
     void setEchoMix(qreal mix);
+    int bus() const;
+    void setBus(int bus);
 
     // Playback state
     bool playing() const { return playing_; }
@@ -138,6 +143,7 @@ signals:
     void swingChanged();
     void brightnessChanged();
     void echoMixChanged();
+    void busChanged();
     void playingChanged();
     void readyChanged();
     void playbackStepChanged();
@@ -0,0 +1,177 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "biquad_filter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace clay::sound {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Below this a filter state is treated as silence. Keeps decaying tails
+// out of the denormal range, which is slow on x86.
+constexpr float kDenormal = 1e-15f;
+
+} // namespace
+
+BiquadFilter::BiquadFilter(int sampleRate)
+    : sampleRate_(sampleRate)
+{
+}
+
+void BiquadFilter::setType(Type t)
+{
+    type_.store(static_cast<int>(t), std::memory_order_relaxed);
+    markDirty();
+}
+
+void BiquadFilter::setFrequency(float hz)
+{
+    frequency_.store(hz, std::memory_order_relaxed);
+    markDirty();
+}
+
+void BiquadFilter::setQ(float q)
+{
+    q_.store(q, std::memory_order_relaxed);
+    markDirty();
+}
+
+void BiquadFilter::setGainDb(float db)
+{
+    gainDb_.store(db, std::memory_order_relaxed);
+    markDirty();
+}
+
+void BiquadFilter::setStages(int n)
+{
+    stages_.store(std::clamp(n, 1, kMaxStages), std::memory_order_relaxed);
+    markDirty();
+}
+
+BiquadFilter::Coeffs BiquadFilter::design(Type type, double sampleRate, double frequency,
+                                          double q, double gainDb)
+{
+    const double f = std::clamp(frequency, 10.0, sampleRate * 0.49);
+    const double w0 = 2.0 * kPi * f / sampleRate;
+    const double cosw = std::cos(w0);
+    const double alpha = std::sin(w0) / (2.0 * std::max(q, 0.05));
+    const double A = std::pow(10.0, gainDb / 40.0);
+    const double beta = 2.0 * std::sqrt(A) * alpha;
+
+    double b0 = 1.0, b1 = 0.0, b2 = 0.0, a0 = 1.0, a1 = 0.0, a2 = 0.0;
+    switch (type) {
+    case Type::LowPass:
+        b0 = (1.0 - cosw) / 2.0; b1 = 1.0 - cosw; b2 = b0;
+        a0 = 1.0 + alpha; a1 = -2.0 * cosw; a2 = 1.0 - alpha;
+        break;
+    case Type::HighPass:
+        b0 = (1.0 + cosw) / 2.0; b1 = -(1.0 + cosw); b2 = b0;
+        a0 = 1.0 + alpha; a1 = -2.0 * cosw; a2 = 1.0 - alpha;
+        break;
+    case Type::BandPass:
+        b0 = alpha; b1 = 0.0; b2 = -alpha;
+        a0 = 1.0 + alpha; a1 = -2.0 * cosw; a2 = 1.0 - alpha;
+        break;
+    case Type::Notch:
+        b0 = 1.0; b1 = -2.0 * cosw; b2 = 1.0;
+        a0 = 1.0 + alpha; a1 = -2.0 * cosw; a2 = 1.0 - alpha;
+        break;
+    case Type::Peak:
+        b0 = 1.0 + alpha * A; b1 = -2.0 * cosw; b2 = 1.0 - alpha * A;
+        a0 = 1.0 + alpha / A; a1 = -2.0 * cosw; a2 = 1.0 - alpha / A;
+        break;
+    case Type::LowShelf:
+        b0 = A * ((A + 1.0) - (A - 1.0) * cosw + beta);
+        b1 = 2.0 * A * ((A - 1.0) - (A + 1.0) * cosw);
+        b2 = A * ((A + 1.0) - (A - 1.0) * cosw - beta);
+        a0 = (A + 1.0) + (A - 1.0) * cosw + beta;
+        a1 = -2.0 * ((A - 1.0) + (A + 1.0) * cosw);
+        a2 = (A + 1.0) + (A - 1.0) * cosw - beta;
+        break;
+    case Type::HighShelf:
+        b0 = A * ((A + 1.0) + (A - 1.0) * cosw + beta);
+        b1 = -2.0 * A * ((A - 1.0) + (A + 1.0) * cosw);
+        b2 = A * ((A + 1.0) + (A - 1.0) * cosw - beta);
+        a0 = (A + 1.0) - (A - 1.0) * cosw + beta;
+        a1 = 2.0 * ((A - 1.0) - (A + 1.0) * cosw);
+        a2 = (A + 1.0) - (A - 1.0) * cosw - beta;
+        break;
+    case Type::OnePoleLowPass: {
+        // y += alpha * (x - y), alpha = dt / (RC + dt).
+        const double rc = 1.0 / (2.0 * kPi * f);
+        const double dt = 1.0 / sampleRate;
+        b0 = dt / (rc + dt);
+        a1 = b0 - 1.0;
+        break;
+    }
+    }
+
+    Coeffs c;
+    c.b0 = static_cast<float>(b0 / a0);
+    c.b1 = static_cast<float>(b1 / a0);
+    c.b2 = static_cast<float>(b2 / a0);
+    c.a1 = static_cast<float>(a1 / a0);
+    c.a2 = static_cast<float>(a2 / a0);
+    return c;
+}
+
+void BiquadFilter::reset()
+{
+    for (auto& s : z1_) s.fill(0.0f);
+    for (auto& s : z2_) s.fill(0.0f);
+}
+
+template <int Lanes>
+void BiquadFilter::run(float* const* planes, int frames)
+{
+    const Coeffs c = coeffs_;
+    const int stages = activeStages_;
+    for (int i = 0; i < frames; ++i) {
+        float x[Lanes];
+        for (int l = 0; l < Lanes; ++l) x[l] = planes[l][i];
+        for (int s = 0; s < stages; ++s) {
+            float* z1 = z1_[static_cast<size_t>(s)].data();
+            float* z2 = z2_[static_cast<size_t>(s)].data();
+            for (int l = 0; l < Lanes; ++l) {
+                const float y = c.b0 * x[l] + z1[l];
+                z1[l] = c.b1 * x[l] - c.a1 * y + z2[l];
+                z2[l] = c.b2 * x[l] - c.a2 * y;
+                x[l] = y;
+            }
+        }
+        for (int l = 0; l < Lanes; ++l) planes[l][i] = x[l];
+    }
+}
+
+void BiquadFilter::process(float* const* planes, int channels, int frames)
+{
+    if (dirty_.exchange(false, std::memory_order_acquire)) {
+        coeffs_ = design(type(), sampleRate_, frequency(), q(), gainDb());
+        const int stages = this->stages();
+        // Sections switched on join with a clean state.
+        for (int s = activeStages_; s < stages; ++s) {
+            z1_[static_cast<size_t>(s)].fill(0.0f);
+            z2_[static_cast<size_t>(s)].fill(0.0f);
+        }
+        activeStages_ = stages;
+    }
+
+    if (channels >= 2)
+        run<2>(planes, frames);
+    else
+        run<1>(planes, frames);
+
+    for (int s = 0; s < activeStages_; ++s)
+        for (int l = 0; l < kLanes; ++l) {
+            float& a = z1_[static_cast<size_t>(s)][static_cast<size_t>(l)];
+            float& b = z2_[static_cast<size_t>(s)][static_cast<size_t>(l)];
+            if (std::abs(a) < kDenormal) a = 0.0f;
+            if (std::abs(b) < kDenormal) b = 0.0f;
+        }
+}
+
+} // namespace clay::sound
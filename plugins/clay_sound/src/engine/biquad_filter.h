@@ -0,0 +1,84 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// BiquadFilter — RBJ-cookbook second-order filter as an IEffect, with
+// up to kMaxStages identical sections in series for steeper slopes.
+// OnePoleLowPass is the gentle 6 dB/octave RC low-pass SoftSynth has
+// always used, run as a degenerate section (b1 = b2 = a2 = 0).
+//
+// The channels of a bus run through the bank in lockstep: state and
+// coefficients live in per-lane arrays and the inner loop over lanes
+// has a constant trip count, so the compiler packs the channels into
+// one SIMD register per state variable (the same auto-vectorization
+// approach as mix.h, no intrinsics). Coefficients are recomputed on
+// the render thread at the start of a chunk after a parameter changed.
+
+#pragma once
+
+#include "effect.h"
+
+#include <array>
+#include <atomic>
+
+namespace clay::sound {
+
+class BiquadFilter : public IEffect
+{
+public:
+    enum class Type : int {
+        LowPass, HighPass, BandPass, Notch, Peak, LowShelf, HighShelf,
+        OnePoleLowPass
+    };
+
+    static constexpr int kMaxStages = 4;
+
+    explicit BiquadFilter(int sampleRate);
+
+    // Thread-safe. `frequency` is clamped below Nyquist; `gainDb` only
+    // affects Peak and the shelves, `q` is ignored by OnePoleLowPass.
+    void setType(Type t);
+    void setFrequency(float hz);
+    void setQ(float q);
+    void setGainDb(float db);
+    void setStages(int n);       // 1..kMaxStages
+
+    Type  type() const { return static_cast<Type>(type_.load(std::memory_order_relaxed)); }
+    float frequency() const { return frequency_.load(std::memory_order_relaxed); }
+    float q() const { return q_.load(std::memory_order_relaxed); }
+    float gainDb() const { return gainDb_.load(std::memory_order_relaxed); }
+    int   stages() const { return stages_.load(std::memory_order_relaxed); }
+
+    void process(float* const* planes, int channels, int frames) override;
+    void reset() override;
+
+    // Normalised coefficients (a0 == 1) of one section.
+    struct Coeffs
+    {
+        float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+    };
+    static Coeffs design(Type type, double sampleRate, double frequency,
+                         double q, double gainDb);
+
+private:
+    static constexpr int kLanes = kMaxChannels;
+
+    template <int Lanes>
+    void run(float* const* planes, int frames);
+    void markDirty() { dirty_.store(true, std::memory_order_release); }
+
+    const int sampleRate_;
+    std::atomic<int>   type_{static_cast<int>(Type::LowPass)};
+    std::atomic<float> frequency_{1000.0f};
+    std::atomic<float> q_{0.70710678f};
+    std::atomic<float> gainDb_{0.0f};
+    std::atomic<int>   stages_{1};
+    std::atomic<bool>  dirty_{true};
+
+    // Render thread only.
+    Coeffs coeffs_;
+    int    activeStages_ = 1;
+    // Transposed direct form II state, [stage][lane].
+    std::array<std::array<float, kLanes>, kMaxStages> z1_{};
+    std::array<std::array<float, kLanes>, kMaxStages> z2_{};
+};
+
+} // namespace clay::sound
@@ -0,0 +1,131 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "bounce.h"
+
+#include "engine.h"
+#include "note_event.h"
+#include "oscillator_instrument.h"
+#include "pcm_buffer.h"
+#include "pcm_cache.h"
+#include "sampler_instrument.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace clay::sound {
+
+namespace {
+
+bool setError(std::string* err, const std::string& msg)
+{
+    if (err) *err = msg;
+    return false;
+}
+
+} // namespace
+
+bool renderStem(const BounceStem& stem, const BounceOptions& options,
+                BounceProgress& progress, std::string* error)
+{
+    const int channels = options.channels == 1 ? 1 : 2;
+    const int block = std::max(options.blockFrames, 1);
+    Engine engine(options.sampleRate, channels);
+
+    // Instruments. Streamed samples are read in full up front.
+    std::vector<int> ids;
+    std::vector<OscillatorInstrument*> oscillators;
+    ids.reserve(stem.instruments.size());
+    oscillators.reserve(stem.instruments.size());
+    for (const BounceInstrument& bi : stem.instruments) {
+        std::unique_ptr<IInstrument> inst;
+        OscillatorInstrument* osc = nullptr;
+        if (bi.kind == BounceInstrument::Kind::Sampler) {
+            std::shared_ptr<const PcmBuffer> pcm = bi.pcm;
+            if (pcm && pcm->streamed()) {
+                std::string err;
+                pcm = PcmCache::instance().acquireFile(pcm->stream->path, PcmCache::Options{}, &err);
+                if (!pcm) return setError(error, "cannot load sample: " + err);
+            }
+            auto sampler = std::make_unique<SamplerInstrument>();
+            sampler->setSource(std::move(pcm));
+            sampler->setRootMidiNote(bi.rootMidiNote);
+            sampler->setDefaultPatch(bi.sample);
+            inst = std::move(sampler);
+        } else {
+            auto o = std::make_unique<OscillatorInstrument>();
+            o->setDefaultPatch(bi.oscillator);
+            osc = o.get();
+            inst = std::move(o);
+        }
+        inst->setGain(bi.gain);
+        inst->setMaxPolyphony(bi.maxPolyphony);
+        inst->setStealPolicy(bi.stealPolicy);
+        ids.push_back(engine.addInstrument(std::move(inst)));
+        oscillators.push_back(osc);
+    }
+
+    for (const auto& make : stem.effects)
+        if (auto effect = make(options.sampleRate))
+            engine.addEffect(Engine::kMasterBus, std::move(effect));
+    engine.setLimiterEnabled(options.limiter);
+    const int64_t latency = engine.latencyFrames();
+
+    WavWriter out;
+    std::string err;
+    if (!out.open(stem.path, options.sampleRate, channels, options.encoding, &err))
+        return setError(error, err);
+
+    std::vector<const BounceNote*> notes;
+    notes.reserve(stem.notes.size());
+    for (const BounceNote& n : stem.notes)
+        if (n.instrument >= 0 && n.instrument < static_cast<int>(ids.size()))
+            notes.push_back(&n);
+    std::stable_sort(notes.begin(), notes.end(),
+                     [](const BounceNote* a, const BounceNote* b) { return a->frame < b->frame; });
+
+    std::vector<float> buf(static_cast<size_t>(block) * static_cast<size_t>(channels));
+    size_t next = 0;
+    int64_t skip = latency;                     // leading frames of limiter delay
+    const int64_t end = stem.frames + latency;
+    for (int64_t pos = 0; pos < end; ) {
+        if (progress.cancel.load(std::memory_order_relaxed)) {
+            out.close();
+            std::remove(stem.path.c_str());
+            return setError(error, "cancelled");
+        }
+
+        // Queue the notes that start within the next block.
+        const int n = static_cast<int>(std::min<int64_t>(block, end - pos));
+        for (; next < notes.size() && notes[next]->frame < pos + n; ++next) {
+            const BounceNote& note = *notes[next];
+            const BounceInstrument& bi = stem.instruments[static_cast<size_t>(note.instrument)];
+            NoteEvent ev;
+            ev.timeFrames     = std::max(note.frame, pos);
+            ev.durationFrames = note.durationFrames;
+            ev.freqHz         = note.freqHz;
+            ev.velocity       = note.velocity;
+            ev.instrumentId   = ids[static_cast<size_t>(note.instrument)];
+            ev.pan            = bi.pan;
+            ev.priority       = bi.priority;
+            const EventId id = engine.schedule(ev);
+            OscillatorInstrument* osc = oscillators[static_cast<size_t>(note.instrument)];
+            if (osc && note.patch >= 0 && note.patch < static_cast<int>(stem.patches.size()))
+                osc->pushPatch(id, stem.patches[static_cast<size_t>(note.patch)]);
+        }
+
+        engine.renderOffline(buf.data(), n);
+        const int64_t drop = std::min<int64_t>(skip, n);
+        skip -= drop;
+        if (!out.write(buf.data() + drop * channels, static_cast<size_t>(n - drop))) {
+            out.close();
+            std::remove(stem.path.c_str());
+            return setError(error, "write failed");
+        }
+        pos += n;
+        progress.frames.store(static_cast<int64_t>(out.framesWritten()), std::memory_order_relaxed);
+    }
+
+    return out.close(error);
+}
+
+} // namespace clay::sound
@@ -0,0 +1,98 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// Bounce — offline rendering of a note list through a private Engine,
+// as fast as the CPU allows. A BounceStem is a self-contained copy of
+// what to play: instrument settings (patches, shared PCM), the notes
+// with their frames, and the master effects. renderStem() builds the
+// engine, queues the notes a block ahead of the render position like
+// SongPlayer does against the live clock, and streams each block into
+// a WavWriter. Stems share nothing mutable, so independent stems can
+// render on separate threads at the same time.
+//
+// Streamed samples are decoded in full (through PcmCache) before the
+// stem renders; a bounce never waits on disk mid-block.
+
+#pragma once
+
+#include "effect.h"
+#include "instrument.h"
+#include "oscillator_voice.h"
+#include "sample_voice.h"
+#include "wav_writer.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace clay::sound {
+
+struct PcmBuffer;
+
+// Settings of one instrument, copied when the bounce is set up.
+struct BounceInstrument
+{
+    enum class Kind { Oscillator, Sampler };
+    Kind kind = Kind::Oscillator;
+
+    OscillatorVoice::Patch oscillator;       // Kind::Oscillator
+    SampleVoice::Patch     sample;           // Kind::Sampler
+    std::shared_ptr<const PcmBuffer> pcm;    // Kind::Sampler
+    int   rootMidiNote = 60;
+
+    float gain = 1.0f;
+    float pan = 0.0f;
+    int   priority = 0;
+    int   maxPolyphony = IInstrument::kDefaultPolyphony;
+    IInstrument::StealPolicy stealPolicy = IInstrument::StealPolicy::Oldest;
+};
+
+struct BounceNote
+{
+    int64_t frame = 0;
+    int64_t durationFrames = 0;
+    double  freqHz = 440.0;
+    float   velocity = 1.0f;
+    int     instrument = 0;     // index into BounceStem::instruments
+    int     patch = -1;         // index into BounceStem::patches: an
+                                // oscillator note with its own patch
+};
+
+struct BounceStem
+{
+    std::string path;                                 // output file
+    std::vector<BounceInstrument> instruments;
+    std::vector<OscillatorVoice::Patch> patches;
+    std::vector<BounceNote> notes;                    // any order
+    int64_t frames = 0;                               // length, tail included
+
+    // Master effects, created on the rendering thread in this order.
+    using EffectFactory = std::function<std::unique_ptr<IEffect>(int sampleRate)>;
+    std::vector<EffectFactory> effects;
+};
+
+struct BounceOptions
+{
+    int  sampleRate = 44100;
+    int  channels = 2;
+    WavWriter::Encoding encoding = WavWriter::Encoding::Int16;
+    bool limiter = true;            // master limiter; its latency is trimmed off
+    int  blockFrames = 4096;
+};
+
+// Shared with the thread that watches a running stem.
+struct BounceProgress
+{
+    std::atomic<int64_t> frames{0};       // frames written so far
+    std::atomic<bool>    cancel{false};   // stop at the next block
+};
+
+// Render `stem` into stem.path. Returns false with `error` set when the
+// file cannot be written, a sample fails to load, or the bounce was
+// cancelled (the partial file is removed).
+bool renderStem(const BounceStem& stem, const BounceOptions& options,
+                BounceProgress& progress, std::string* error = nullptr);
+
+} // namespace clay::sound
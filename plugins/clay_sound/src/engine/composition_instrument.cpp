@@ -0,0 +1,249 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "composition_instrument.h"
+#include "note_event.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace clay::sound {
+
+namespace {
+
+// Largest stretch rendered at once; segments also end at note starts,
+// the loop end and the end of a fade.
+constexpr int kSegmentFrames = 256;
+
+} // namespace
+
+// The loop as one engine voice. The sequencing lives in the instrument,
+// which the voice forwards to; it only tracks its own start and end.
+class CompositionInstrument::LoopVoice : public IVoice
+{
+public:
+    explicit LoopVoice(CompositionInstrument& owner) : owner_(owner) {}
+
+    void onNoteOn(const NoteEvent& ev, int /*sampleRate*/) override
+    {
+        start_ = ev.timeFrames;
+        end_ = ev.durationFrames > 0 ? ev.timeFrames + ev.durationFrames
+                                     : std::numeric_limits<int64_t>::max();
+        velocity_ = ev.velocity;
+        owner_.restart();
+    }
+
+    void onNoteOff(int64_t atFrame) override { end_ = std::min(end_, atFrame); }
+
+    void render(float* buffer, int frames, int64_t bufferStartFrame) override
+    {
+        const int64_t from = std::max(start_, bufferStartFrame);
+        const int64_t to = std::min(end_, bufferStartFrame + frames);
+        if (to <= from) return;
+        float* out = buffer + (from - bufferStartFrame);
+        const int n = static_cast<int>(to - from);
+        owner_.render(out, n, velocity_);
+    }
+
+    bool isFinished(int64_t currentFrame) const override { return currentFrame >= end_; }
+
+    void stop() { end_ = std::numeric_limits<int64_t>::min(); }
+
+private:
+    CompositionInstrument& owner_;
+    int64_t start_ = 0;
+    int64_t end_ = 0;
+    float   velocity_ = 1.0f;
+};
+
+CompositionInstrument::CompositionInstrument(int sampleRate)
+    : sampleRate_(sampleRate)
+    , fadeFrames_(std::max<int64_t>(1, std::llround(kFadeSeconds * sampleRate)))
+    , voice_(std::make_unique<LoopVoice>(*this))
+{
+}
+
+CompositionInstrument::~CompositionInstrument() = default;
+
+void CompositionInstrument::setComposition(std::shared_ptr<const Composition> composition,
+                                           bool crossfade)
+{
+    if (voiceBusy_ && crossfade) {
+        replace(pending_, std::move(composition));
+        if (fade_ == Fade::None) {
+            fade_ = Fade::Out;
+            fadePos_ = 0;
+        }
+        return;
+    }
+    replace(composition_, std::move(composition));
+    replace(pending_, nullptr);
+    seek();
+}
+
+void CompositionInstrument::setPaused(bool paused)
+{
+    paused_ = paused;
+}
+
+void CompositionInstrument::stop()
+{
+    voice_->stop();
+    cutNotes();
+}
+
+IVoice* CompositionInstrument::acquireVoice(const NoteEvent& /*ev*/, EventId /*id*/,
+                                            int /*sampleRate*/)
+{
+    if (voiceBusy_) return nullptr;
+    voiceBusy_ = true;
+    return voice_.get();
+}
+
+void CompositionInstrument::releaseVoice(IVoice* /*voice*/)
+{
+    voiceBusy_ = false;
+    cutNotes();
+}
+
+void CompositionInstrument::restart()
+{
+    if (pending_) replace(composition_, std::move(pending_));
+    loopPos_ = 0;
+    clock_ = 0;
+    nextNote_ = 0;
+    paused_ = false;
+    fade_ = Fade::None;
+    fadePos_ = 0;
+    cutNotes();
+    position_.store(0, std::memory_order_relaxed);
+}
+
+void CompositionInstrument::seek()
+{
+    nextNote_ = 0;
+    if (!composition_) return;
+    const auto& notes = composition_->notes;
+    while (nextNote_ < notes.size() && notes[nextNote_].frame < loopPos_)
+        ++nextNote_;
+}
+
+void CompositionInstrument::replace(std::shared_ptr<const Composition>& slot,
+                                    std::shared_ptr<const Composition> next)
+{
+    slot.swap(next);
+    retire(std::move(next));
+}
+
+void CompositionInstrument::swapPending()
+{
+    replace(composition_, std::move(pending_));
+    cutNotes();
+    seek();
+}
+
+void CompositionInstrument::startNotes()
+{
+    if (!composition_) return;
+    const auto& notes = composition_->notes;
+    for (; nextNote_ < notes.size() && notes[nextNote_].frame <= loopPos_; ++nextNote_) {
+        const CompositionNote& note = notes[nextNote_];
+
+        // Free slot, or steal the oldest note.
+        int slot = -1;
+        if (activeCount_ < kMaxVoices) {
+            std::array<bool, kMaxVoices> used{};
+            for (int i = 0; i < activeCount_; ++i)
+                used[static_cast<size_t>(active_[static_cast<size_t>(i)])] = true;
+            for (int i = 0; i < kMaxVoices && slot < 0; ++i)
+                if (!used[static_cast<size_t>(i)]) slot = i;
+        } else {
+            slot = active_[0];
+            std::copy(active_.begin() + 1, active_.begin() + activeCount_, active_.begin());
+            --activeCount_;
+        }
+
+        OscillatorVoice& v = notes_[static_cast<size_t>(slot)];
+        v.setPatch(note.patch);
+        NoteEvent ev;
+        ev.timeFrames     = clock_;
+        ev.durationFrames = note.durationFrames;
+        ev.freqHz         = note.freqHz;
+        ev.velocity       = note.velocity;
+        v.onNoteOn(ev, sampleRate_);
+        active_[static_cast<size_t>(activeCount_++)] = slot;
+    }
+}
+
+void CompositionInstrument::pruneNotes()
+{
+    int kept = 0;
+    for (int i = 0; i < activeCount_; ++i) {
+        const int slot = active_[static_cast<size_t>(i)];
+        if (!notes_[static_cast<size_t>(slot)].isFinished(clock_))
+            active_[static_cast<size_t>(kept++)] = slot;
+    }
+    activeCount_ = kept;
+}
+
+void CompositionInstrument::render(float* buffer, int frames, float velocity)
+{
+    if (paused_) return;
+
+    float scratch[kSegmentFrames];
+    for (int done = 0; done < frames; ) {
+        startNotes();
+        const int64_t loopFrames = composition_ ? composition_->loopFrames : 0;
+
+        // Render up to whatever changes the mix next.
+        int64_t n = std::min(frames - done, kSegmentFrames);
+        if (composition_ && nextNote_ < composition_->notes.size())
+            n = std::min(n, composition_->notes[nextNote_].frame - loopPos_);
+        if (loopFrames > 0)
+            n = std::min(n, loopFrames - loopPos_);
+        if (fade_ != Fade::None)
+            n = std::min(n, fadeFrames_ - fadePos_);
+        n = std::max<int64_t>(n, 1);
+        const int count = static_cast<int>(n);
+
+        std::fill(scratch, scratch + count, 0.0f);
+        for (int i = 0; i < activeCount_; ++i)
+            notes_[static_cast<size_t>(active_[static_cast<size_t>(i)])].render(scratch, count, clock_);
+
+        float* out = buffer + done;
+        if (fade_ == Fade::None) {
+            for (int i = 0; i < count; ++i) out[i] += scratch[i] * velocity;
+        } else {
+            const double step = 1.0 / static_cast<double>(fadeFrames_);
+            for (int i = 0; i < count; ++i) {
+                double g = static_cast<double>(fadePos_ + i) * step;
+                if (fade_ == Fade::Out) g = 1.0 - g;
+                out[i] += scratch[i] * static_cast<float>(g) * velocity;
+            }
+            fadePos_ += count;
+        }
+
+        clock_ += count;
+        loopPos_ += count;
+        done += count;
+        pruneNotes();
+
+        if (fade_ != Fade::None && fadePos_ >= fadeFrames_) {
+            if (fade_ == Fade::Out) {
+                swapPending();
+                fade_ = Fade::In;
+            } else {
+                fade_ = Fade::None;
+            }
+            fadePos_ = 0;
+        }
+        if (composition_ && composition_->loopFrames > 0 && loopPos_ >= composition_->loopFrames) {
+            loopPos_ = 0;
+            nextNote_ = 0;
+            cutNotes();
+        }
+    }
+    position_.store(loopPos_, std::memory_order_relaxed);
+}
+
+} // namespace clay::sound
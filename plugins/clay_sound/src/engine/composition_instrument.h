@@ -0,0 +1,115 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// CompositionInstrument — SoftSynth's looping sequencer as an engine
+// instrument. A Composition is a loop of oscillator notes, each with its
+// own patch; scheduling one note on the instrument starts the loop at
+// that frame, and it then plays until stop(). The whole loop renders as
+// one engine voice, so it follows the engine clock sample-accurately and
+// takes the instrument's gain and bus like any other voice.
+//
+// Inside that voice up to kMaxVoices oscillator voices are kept, the
+// oldest stolen when a note finds none free. At the loop end the notes
+// still sounding are cut and the loop starts over. A composition swapped
+// in while playing fades the old one out over kFadeSeconds, cuts it, and
+// fades the new one in from the same loop position.
+//
+// Everything below except position() is render-thread state: call it
+// through AudioOutput::post() once the instrument is registered.
+// Compositions it lets go of are retired (see IInstrument::retire()).
+
+#pragma once
+
+#include "instrument.h"
+#include "oscillator_voice.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace clay::sound {
+
+struct CompositionNote
+{
+    int64_t frame = 0;            // start, in frames from the loop start
+    int64_t durationFrames = 0;
+    double  freqHz = 440.0;
+    float   velocity = 1.0f;
+    OscillatorVoice::Patch patch{};
+};
+
+struct Composition
+{
+    std::vector<CompositionNote> notes;   // sorted by frame
+    int64_t loopFrames = 0;               // 0 = play once, never loop
+};
+
+class CompositionInstrument : public IInstrument
+{
+public:
+    static constexpr int kMaxVoices = 32;
+    static constexpr double kFadeSeconds = 0.15;
+
+    explicit CompositionInstrument(int sampleRate);
+    ~CompositionInstrument() override;
+
+    // Replace the composition. While the loop plays and `crossfade` is
+    // set, the swap happens after a fade-out; otherwise at once, seeking
+    // to the current loop position.
+    void setComposition(std::shared_ptr<const Composition> composition, bool crossfade);
+
+    // Hold the loop (silent, position kept) or let it run on.
+    void setPaused(bool paused);
+
+    // End the loop voice; the engine then drops it.
+    void stop();
+
+    // Loop position in frames as of the last render. Thread-safe.
+    int64_t position() const { return position_.load(std::memory_order_relaxed); }
+
+    // Oscillator voices sounding inside the loop voice.
+    int activeNotes() const { return activeCount_; }
+
+    IVoice* acquireVoice(const NoteEvent& ev, EventId id, int sampleRate) override;
+    void releaseVoice(IVoice* voice) override;
+    int voiceCapacity() const override { return 1; }
+
+private:
+    class LoopVoice;
+    friend class LoopVoice;
+
+    enum class Fade { None, Out, In };
+
+    void restart();
+    void render(float* buffer, int frames, float velocity);
+    void startNotes();
+    void swapPending();
+    void seek();
+    void cutNotes() { activeCount_ = 0; }
+    void pruneNotes();
+    // Point `slot` at `next`, retiring what it held.
+    void replace(std::shared_ptr<const Composition>& slot,
+                 std::shared_ptr<const Composition> next);
+
+    const int sampleRate_;
+    const int64_t fadeFrames_;
+    std::unique_ptr<LoopVoice> voice_;
+    bool voiceBusy_ = false;
+
+    std::shared_ptr<const Composition> composition_;
+    std::shared_ptr<const Composition> pending_;
+    size_t  nextNote_ = 0;
+    int64_t loopPos_ = 0;          // frames into the loop
+    int64_t clock_ = 0;            // frames rendered since the loop started
+    bool    paused_ = false;
+    Fade    fade_ = Fade::None;
+    int64_t fadePos_ = 0;
+    std::atomic<int64_t> position_{0};
+
+    std::array<OscillatorVoice, kMaxVoices> notes_;
+    std::array<int, kMaxVoices> active_{};   // indices into notes_, oldest first
+    int activeCount_ = 0;
+};
+
+} // namespace clay::sound
@@ -0,0 +1,45 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// IEffect — in-place processor on a mix bus or on the master (see
+// Engine::addEffect()). The engine hands it one control-rate chunk of
+// planar audio at a time. Effects allocate everything they need when
+// constructed (they know the sample rate then), so process() runs on
+// the render thread without allocating or locking.
+//
+// Like IInstrument's gain, parameters are atomics: QML adapters keep a
+// raw pointer and set them from the GUI thread while the render thread
+// processes. Effects pick up changes at the start of the next chunk.
+
+#pragma once
+
+#include <atomic>
+
+namespace clay::sound {
+
+class IEffect
+{
+public:
+    static constexpr int kMaxChannels = 2;
+    static constexpr int kMaxFrames = 256;    // largest chunk process() sees
+
+    virtual ~IEffect() = default;
+
+    // Process `frames` (<= kMaxFrames) frames in place. planes[c] holds
+    // channel c for c < channels (1 or 2).
+    virtual void process(float* const* planes, int channels, int frames) = 0;
+
+    // Forget all signal history (filter memory, delay lines, tails).
+    virtual void reset() = 0;
+
+    // Frames by which process() delays its input.
+    virtual int latencyFrames() const { return 0; }
+
+    // A bypassed effect is skipped; its state is reset on re-enable.
+    void setBypassed(bool b) { bypassed_.store(b, std::memory_order_relaxed); }
+    bool bypassed() const { return bypassed_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<bool> bypassed_{false};
+};
+
+} // namespace clay::sound
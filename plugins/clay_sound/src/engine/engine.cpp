@@ -1,31 +1,129 @@
 // (c) Clayground Contributors - MIT License, see "LICENSE" file
 
 #include "engine.h"
+#include "effect.h"
 #include "instrument.h"
+#include "mix.h"
 #include "voice.h"
 #include <algorithm>
+#include <chrono>
+#include <cstddef>
 #include <cstring>
 
 namespace clay::sound {
 
-Engine::Engine(int sampleRate) : sampleRate_(sampleRate) {}
-Engine::~Engine() = default;
+static_assert(Engine::kMixFrames <= IEffect::kMaxFrames, "effects see whole mix chunks");
+static_assert(Engine::kMaxBuses < 32, "chain masks hold one bit per bus plus the master");
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+int64_t nanosSince(Clock::time_point t0)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - t0).count();
+}
+
+} // namespace
+
+Engine::Engine(int sampleRate, int channels)
+    : sampleRate_(sampleRate)
+    , channels_(channels == 2 ? 2 : 1)
+    , scratch_(kMixFrames, 0.0f)
+    , busMix_(static_cast<size_t>(kMaxBuses) * 2 * kMixFrames, 0.0f)
+    , masterMix_(2 * kMixFrames, 0.0f)
+    , limiter_(sampleRate)
+{
+    for (auto& g : busGains_) g.store(1.0f, std::memory_order_relaxed);
+    for (auto& sends : busSends_)
+        for (auto& s : sends) s.store(0.0f, std::memory_order_relaxed);
+}
+
+Engine::~Engine()
+{
+    // Voices belong to their instruments' pools; give them back first.
+    for (const auto& av : voices_)
+        if (IInstrument* inst = instrumentAt(av.instrumentId))
+            inst->releaseVoice(av.voice);
+}
 
 int Engine::addInstrument(std::unique_ptr<IInstrument> inst)
 {
-    instruments_.push_back(std::move(inst));
-    return static_cast<int>(instruments_.size()) - 1;
+    int id = 0;
+    while (static_cast<size_t>(id) < instruments_.size() && instruments_[id]) ++id;
+    insertInstrument(id, std::move(inst));
+    return id;
+}
+
+bool Engine::insertInstrument(int id, std::unique_ptr<IInstrument> inst)
+{
+    if (id < 0) return false;
+    if (static_cast<size_t>(id) >= instruments_.size()) {
+        instruments_.resize(static_cast<size_t>(id) + 1);
+        activeCounts_.resize(static_cast<size_t>(id) + 1, 0);
+    }
+    if (instruments_[id]) return false;
+    if (inst) inst->setRetireCallback(retireFn_, retireContext_);
+    instruments_[id] = std::move(inst);
+    activeCounts_[static_cast<size_t>(id)] = 0;
+    return true;
 }
 
 void Engine::removeInstrument(int id)
 {
-    if (id < 0 || static_cast<size_t>(id) >= instruments_.size()) return;
-    instruments_[id].reset(); // tombstone — keeps subsequent ids stable
-    // Drop any active voices that belonged to it; their factory is gone.
-    voices_.erase(
-        std::remove_if(voices_.begin(), voices_.end(),
-                       [id](const ActiveVoice& av) { return av.instrumentId == id; }),
-        voices_.end());
+    releaseInstrument(id);
+}
+
+std::unique_ptr<IInstrument> Engine::releaseInstrument(int id)
+{
+    if (id < 0 || static_cast<size_t>(id) >= instruments_.size()) return nullptr;
+    // Drop any active voices that belonged to it while it can still take
+    // them back.
+    dropVoicesOf(id);
+    scheduler_.cancelInstrument(id);
+    // Tombstone; addInstrument() hands the slot out again.
+    return std::move(instruments_[id]);
+}
+
+void Engine::dropVoicesOf(int instrumentId)
+{
+    for (size_t i = voices_.size(); i-- > 0;)
+        if (voices_[i].instrumentId == instrumentId) retireVoice(i);
+}
+
+void Engine::retireVoice(size_t index)
+{
+    const ActiveVoice av = voices_[index];
+    voices_.erase(voices_.begin() + static_cast<std::ptrdiff_t>(index));
+    if (IInstrument* inst = instrumentAt(av.instrumentId)) {
+        inst->releaseVoice(av.voice);
+        --activeCounts_[static_cast<size_t>(av.instrumentId)];
+    }
+    notify(VoiceEvent::Kind::Finished, av);
+}
+
+void Engine::setVoiceEventCallback(VoiceEventFn fn, void* context)
+{
+    voiceEventFn_ = fn;
+    voiceEventContext_ = context;
+}
+
+void Engine::setRetireCallback(RetireFn fn, void* context)
+{
+    retireFn_ = fn;
+    retireContext_ = context;
+    for (const auto& inst : instruments_)
+        if (inst) inst->setRetireCallback(fn, context);
+}
+
+void Engine::notify(VoiceEvent::Kind kind, const ActiveVoice& av)
+{
+    if (!voiceEventFn_) return;
+    VoiceEvent ev;
+    ev.kind = kind;
+    ev.instrumentId = av.instrumentId;
+    ev.id = av.id;
+    voiceEventFn_(voiceEventContext_, ev);
 }
 
 IInstrument* Engine::instrumentAt(int id) const
@@ -34,81 +132,406 @@ IInstrument* Engine::instrumentAt(int id) const
     return instruments_[id].get();
 }
 
-EventId Engine::schedule(const NoteEvent& ev)
+EventId Engine::schedule(const NoteEvent& ev, EventId id)
 {
-    return scheduler_.schedule(ev);
+    return scheduler_.schedule(ev, id);
 }
 
 bool Engine::cancel(EventId id)
 {
-    return scheduler_.cancel(id);
+    NoteEvent ev;
+    if (!scheduler_.cancel(id, &ev)) return false;
+    // Let the instrument drop anything it queued for the note (patches).
+    if (IInstrument* inst = instrumentAt(ev.instrumentId))
+        inst->discardEvent(id);
+    return true;
 }
 
 void Engine::clearSchedule()
 {
-    scheduler_.clear();
+    // As in cancel(): per-note state must not outlive its event.
+    scheduler_.clear([this](EventId id, const NoteEvent& ev) {
+        if (IInstrument* inst = instrumentAt(ev.instrumentId))
+            inst->discardEvent(id);
+    });
 }
 
 void Engine::resetVoices()
 {
-    voices_.clear();
+    while (!voices_.empty())
+        retireVoice(voices_.size() - 1);
 }
 
 size_t Engine::activeVoices(int instrumentId) const
 {
-    size_t n = 0;
-    for (const auto& av : voices_)
-        if (av.instrumentId == instrumentId) ++n;
-    return n;
+    if (instrumentId < 0 || static_cast<size_t>(instrumentId) >= activeCounts_.size())
+        return 0;
+    return static_cast<size_t>(activeCounts_[static_cast<size_t>(instrumentId)]);
+}
+
+void Engine::prepare(int maxInstruments, int maxVoices, int maxEvents, int maxEmitters)
+{
+    if (maxInstruments > 0) {
+        instruments_.reserve(static_cast<size_t>(maxInstruments));
+        activeCounts_.reserve(static_cast<size_t>(maxInstruments));
+    }
+    if (maxVoices > 0)
+        voices_.reserve(static_cast<size_t>(maxVoices));
+    if (maxEvents > 0) {
+        scheduler_.reserve(static_cast<size_t>(maxEvents));
+        fired_.reserve(static_cast<size_t>(maxEvents));
+    }
+    if (maxEmitters > 0 && emitters_.size() < static_cast<size_t>(maxEmitters))
+        emitters_.resize(static_cast<size_t>(maxEmitters));
+}
+
+void Engine::setBusGain(int bus, float gain)
+{
+    if (bus < 0 || bus >= kMaxBuses) return;
+    busGains_[static_cast<size_t>(bus)].store(std::max(gain, 0.0f), std::memory_order_relaxed);
+}
+
+float Engine::busGain(int bus) const
+{
+    if (bus < 0 || bus >= kMaxBuses) return 0.0f;
+    return busGains_[static_cast<size_t>(bus)].load(std::memory_order_relaxed);
+}
+
+void Engine::setEmitter(int id, const Emitter& emitter)
+{
+    if (id < 0) return;
+    // Grows only past prepare()'s maxEmitters.
+    if (static_cast<size_t>(id) >= emitters_.size())
+        emitters_.resize(static_cast<size_t>(id) + 1);
+    emitters_[static_cast<size_t>(id)] = emitter;
+    emitters_[static_cast<size_t>(id)].active = true;
+}
+
+void Engine::removeEmitter(int id)
+{
+    if (id < 0 || static_cast<size_t>(id) >= emitters_.size()) return;
+    emitters_[static_cast<size_t>(id)].active = false;
+}
+
+bool Engine::stealFor(IInstrument& inst, const NoteEvent& ev)
+{
+    const int instId = ev.instrumentId;
+    const auto policy = inst.stealPolicy();
+    size_t victim = voices_.size();
+    for (size_t i = 0; i < voices_.size(); ++i) {
+        const ActiveVoice& av = voices_[i];
+        if (av.instrumentId != instId) continue;
+        if (victim == voices_.size()) { victim = i; continue; }
+        const ActiveVoice& best = voices_[victim];
+        bool better = false;
+        switch (policy) {
+        case IInstrument::StealPolicy::Oldest:
+            better = av.startFrame < best.startFrame;
+            break;
+        case IInstrument::StealPolicy::Quietest:
+            better = av.voice->level() < best.voice->level();
+            break;
+        case IInstrument::StealPolicy::LowestPriority:
+            better = av.priority < best.priority
+                     || (av.priority == best.priority && av.startFrame < best.startFrame);
+            break;
+        }
+        if (better) victim = i;
+    }
+    if (victim == voices_.size()) return false;
+    if (policy == IInstrument::StealPolicy::LowestPriority
+        && voices_[victim].priority > ev.priority)
+        return false;
+    retireVoice(victim);
+    inst.countSteal();
+    return true;
+}
+
+void Engine::startVoice(EventId id, const NoteEvent& ev)
+{
+    const int instId = ev.instrumentId;
+    IInstrument* inst = instrumentAt(instId);
+    if (!inst) return;
+    if (activeCounts_[static_cast<size_t>(instId)] >= inst->maxPolyphony()
+        && !stealFor(*inst, ev)) {
+        inst->discardEvent(id);
+        inst->countDroppedNote();
+        return;
+    }
+    IVoice* voice = inst->acquireVoice(ev, id, sampleRate_);
+    if (!voice) {
+        // The instrument is out of voices below the cap (e.g. a pool
+        // shared differently); count it like a dropped note.
+        inst->countDroppedNote();
+        return;
+    }
+    voice->onNoteOn(ev, sampleRate_);
+    ActiveVoice av;
+    av.instrumentId = instId;
+    av.id = id;
+    av.startFrame = ev.timeFrames;
+    av.priority = ev.priority;
+    av.voice = voice;
+    av.pan = ev.pan;
+    av.emitterId = ev.emitterId;
+    voices_.push_back(av);
+    ++activeCounts_[static_cast<size_t>(instId)];
+    notify(VoiceEvent::Kind::Started, voices_.back());
+}
+
+std::array<float, 2> Engine::targetGains(const ActiveVoice& av, const IInstrument& inst) const
+{
+    float gain = inst.gain();
+    float pan = av.pan;
+    if (av.emitterId >= 0 && static_cast<size_t>(av.emitterId) < emitters_.size()) {
+        const Emitter& e = emitters_[static_cast<size_t>(av.emitterId)];
+        if (e.active) {
+            const Placement p = place(listener_, e);
+            gain *= p.gain;
+            pan = std::clamp(pan + p.pan, -1.0f, 1.0f);
+        }
+    }
+    if (channels_ == 1) return { gain, 0.0f };
+    const PanGains pg = constantPowerPan(pan);
+    return { gain * pg.left, gain * pg.right };
+}
+
+void Engine::setBusSend(int bus, int target, float level)
+{
+    if (bus < 0 || target <= bus || target >= kMaxBuses) return;
+    busSends_[static_cast<size_t>(bus)][static_cast<size_t>(target)]
+        .store(std::max(0.0f, level), std::memory_order_relaxed);
+}
+
+float Engine::busSend(int bus, int target) const
+{
+    if (bus < 0 || target <= bus || target >= kMaxBuses) return 0.0f;
+    return busSends_[static_cast<size_t>(bus)][static_cast<size_t>(target)]
+        .load(std::memory_order_relaxed);
+}
+
+int Engine::addEffect(int bus, std::unique_ptr<IEffect> effect)
+{
+    for (int id = 0; id < kMaxEffects; ++id)
+        if (!effects_[static_cast<size_t>(id)].effect)
+            return insertEffect(id, bus, std::move(effect)) ? id : -1;
+    return -1;
+}
+
+bool Engine::insertEffect(int id, int bus, std::unique_ptr<IEffect> effect)
+{
+    if (id < 0 || id >= kMaxEffects || !effect) return false;
+    EffectSlot& slot = effects_[static_cast<size_t>(id)];
+    if (slot.effect) return false;
+    slot.effect = std::move(effect);
+    slot.bus = chainOf(std::clamp(bus, kMasterBus, kMaxBuses - 1));
+    slot.bypassed = false;
+    slot.ns = 0;
+    slot.load.store(0.0, std::memory_order_relaxed);
+    effectOrder_[static_cast<size_t>(effectCount_++)] = id;
+    updateEffectBuses();
+    return true;
+}
+
+void Engine::setEffectBus(int id, int bus)
+{
+    if (!effectAt(id)) return;
+    // Re-append so the effect runs last in its new chain.
+    auto* order = effectOrder_.data();
+    auto* end = std::remove(order, order + effectCount_, id);
+    *end = id;
+    effects_[static_cast<size_t>(id)].bus = chainOf(std::clamp(bus, kMasterBus, kMaxBuses - 1));
+    updateEffectBuses();
+}
+
+std::unique_ptr<IEffect> Engine::releaseEffect(int id)
+{
+    if (!effectAt(id)) return nullptr;
+    auto* order = effectOrder_.data();
+    std::remove(order, order + effectCount_, id);
+    --effectCount_;
+    EffectSlot& slot = effects_[static_cast<size_t>(id)];
+    slot.load.store(0.0, std::memory_order_relaxed);
+    updateEffectBuses();
+    return std::move(slot.effect);
+}
+
+IEffect* Engine::effectAt(int id) const
+{
+    if (id < 0 || id >= kMaxEffects) return nullptr;
+    return effects_[static_cast<size_t>(id)].effect.get();
+}
+
+double Engine::effectLoad(int id) const
+{
+    if (id < 0 || id >= kMaxEffects) return 0.0;
+    return effects_[static_cast<size_t>(id)].load.load(std::memory_order_relaxed);
+}
+
+void Engine::setLimiterEnabled(bool enabled)
+{
+    limiterEnabled_.store(enabled, std::memory_order_relaxed);
+}
+
+void Engine::updateEffectBuses()
+{
+    effectBuses_ = 0;
+    for (int k = 0; k < effectCount_; ++k)
+        effectBuses_ |= 1u << effects_[static_cast<size_t>(effectOrder_[static_cast<size_t>(k)])].bus;
+}
+
+void Engine::runEffects(int chain, float* const* planes, int n)
+{
+    for (int k = 0; k < effectCount_; ++k) {
+        EffectSlot& slot = effects_[static_cast<size_t>(effectOrder_[static_cast<size_t>(k)])];
+        if (slot.bus != chain) continue;
+        if (slot.effect->bypassed()) {
+            slot.bypassed = true;
+            continue;
+        }
+        if (slot.bypassed) {
+            slot.effect->reset();
+            slot.bypassed = false;
+        }
+        const auto t0 = Clock::now();
+        slot.effect->process(planes, channels_, n);
+        slot.ns += nanosSince(t0);
+    }
+}
+
+void Engine::mixChunk(float* out, int n, int64_t chunkStart)
+{
+    // Render each voice into the scratch chunk, then add it to its bus
+    // with a gain per channel. Kernels always run over the whole chunk
+    // (constant trip count, see mix.h); past `n` the scratch is silent.
+    unsigned busesUsed = 0;
+    for (auto& av : voices_) {
+        IInstrument* inst = instrumentAt(av.instrumentId);
+        if (!inst) continue;
+        std::fill(scratch_.begin(), scratch_.end(), 0.0f);
+        av.voice->render(scratch_.data(), n, chunkStart);
+
+        const int bus = std::min(inst->bus(), kMaxBuses - 1);
+        if (!(busesUsed & (1u << bus))) {
+            for (int c = 0; c < channels_; ++c) std::fill_n(busPlane(bus, c), kMixFrames, 0.0f);
+            busesUsed |= 1u << bus;
+        }
+
+        const std::array<float, 2> target = targetGains(av, *inst);
+        for (int c = 0; c < channels_; ++c) {
+            const size_t ch = static_cast<size_t>(c);
+            const float from = av.placed ? av.gains[ch] : target[ch];
+            if (from == target[ch])
+                mix::addScaled(busPlane(bus, c), scratch_.data(), kMixFrames, from);
+            else
+                mix::addRamped(busPlane(bus, c), scratch_.data(), kMixFrames, from, target[ch]);
+        }
+        av.gains = target;
+        av.placed = true;
+    }
+
+    // Buses with effects run even when silent, so their tails ring out.
+    for (int bus = 0; bus < kMaxBuses; ++bus) {
+        const unsigned bit = 1u << bus;
+        if (!(effectBuses_ & bit) || (busesUsed & bit)) continue;
+        for (int c = 0; c < channels_; ++c) std::fill_n(busPlane(bus, c), kMixFrames, 0.0f);
+        busesUsed |= bit;
+    }
+
+    // In bus order: run each bus's effects, sum it with its gain, and
+    // feed its sends to the higher buses still to come. Then run the
+    // master chain and limiter, and copy (mono) or interleave (stereo)
+    // the first `n` frames into `out`.
+    float* left = masterMix_.data();
+    float* right = masterMix_.data() + kMixFrames;
+    std::fill(masterMix_.begin(), masterMix_.end(), 0.0f);
+    for (int bus = 0; bus < kMaxBuses; ++bus) {
+        if (!(busesUsed & (1u << bus))) continue;
+        float* planes[2] = { busPlane(bus, 0), busPlane(bus, 1) };
+        if (effectBuses_ & (1u << bus)) runEffects(bus, planes, n);
+
+        const float g = busGain(bus);
+        mix::addScaled(left, planes[0], kMixFrames, g);
+        if (channels_ == 2) mix::addScaled(right, planes[1], kMixFrames, g);
+
+        for (int target = bus + 1; target < kMaxBuses; ++target) {
+            const float send = g * busSend(bus, target);
+            if (send <= 0.0f) continue;
+            if (!(busesUsed & (1u << target))) {
+                for (int c = 0; c < channels_; ++c) std::fill_n(busPlane(target, c), kMixFrames, 0.0f);
+                busesUsed |= 1u << target;
+            }
+            for (int c = 0; c < channels_; ++c)
+                mix::addScaled(busPlane(target, c), planes[c], kMixFrames, send);
+        }
+    }
+
+    float* master[2] = { left, right };
+    if (effectBuses_ & (1u << kMaxBuses)) runEffects(kMaxBuses, master, n);
+    const bool limit = limiterEnabled();
+    if (limit) {
+        // Start from a clean look-ahead after the limiter was off.
+        if (!limiterWasEnabled_) limiter_.reset();
+        const auto t0 = Clock::now();
+        limiter_.process(master, channels_, n);
+        limiterNs_ += nanosSince(t0);
+    }
+    limiterWasEnabled_ = limit;
+
+    if (channels_ == 2)
+        mix::interleave2(out, left, right, n);
+    else
+        std::copy_n(left, n, out);
 }
 
 void Engine::renderOffline(float* out, int frames)
 {
     if (frames <= 0) return;
-    std::memset(out, 0, sizeof(float) * static_cast<size_t>(frames));
+    std::memset(out, 0, sizeof(float) * static_cast<size_t>(frames) * static_cast<size_t>(channels_));
 
     const int64_t bufStart = currentFrame_;
     const int64_t bufEnd = currentFrame_ + frames;
 
     // Fire any events that fall within this buffer's frame window.
-    auto fired = scheduler_.popDue(bufEnd - 1);
-    for (const auto& f : fired) {
-        const int instId = f.ev.instrumentId;
-        IInstrument* inst = instrumentAt(instId);
-        if (!inst) continue;
-        auto voice = inst->createVoice(f.ev, f.id, sampleRate_);
-        if (!voice) continue;
-        voice->onNoteOn(f.ev, sampleRate_);
-        voices_.push_back({instId, std::move(voice)});
+    scheduler_.popDue(bufEnd - 1, fired_);
+    for (const auto& f : fired_)
+        startVoice(f.id, f.ev);
+
+    for (int done = 0; done < frames; done += kMixFrames) {
+        const int n = std::min(kMixFrames, frames - done);
+        mixChunk(out + static_cast<size_t>(done) * static_cast<size_t>(channels_), n, bufStart + done);
     }
 
-    // Render each voice into a per-pass scratch buffer so we can apply
-    // the source instrument's gain before summing into `out`. The
-    // scratch is reused across voices in this pass.
-    if (static_cast<int>(scratch_.size()) < frames)
-        scratch_.assign(static_cast<size_t>(frames), 0.0f);
+    currentFrame_ = bufEnd;
 
-    for (auto& av : voices_) {
-        IInstrument* inst = instrumentAt(av.instrumentId);
-        if (!inst) continue; // tombstoned; will be reaped below
-        std::fill_n(scratch_.begin(), frames, 0.0f);
-        av.voice->render(scratch_.data(), frames, bufStart);
-        const float g = inst->gain();
-        if (g == 1.0f) {
-            for (int i = 0; i < frames; ++i) out[i] += scratch_[i];
-        } else {
-            for (int i = 0; i < frames; ++i) out[i] += scratch_[i] * g;
+    // Publish effect loads for this call.
+    if (effectCount_ > 0 || limiterNs_ > 0) {
+        const double renderedNs = static_cast<double>(frames) * 1e9 / sampleRate_;
+        int64_t total = limiterNs_;
+        for (int k = 0; k < effectCount_; ++k) {
+            EffectSlot& slot = effects_[static_cast<size_t>(effectOrder_[static_cast<size_t>(k)])];
+            slot.load.store(static_cast<double>(slot.ns) / renderedNs, std::memory_order_relaxed);
+            total += slot.ns;
+            slot.ns = 0;
         }
+        effectsLoad_.store(static_cast<double>(total) / renderedNs, std::memory_order_relaxed);
+        limiterNs_ = 0;
+    } else {
+        effectsLoad_.store(0.0, std::memory_order_relaxed);
     }
 
-    currentFrame_ = bufEnd;
-
-    // Reap finished voices, plus any whose instrument was removed.
+    // Reap finished voices.
     voices_.erase(
         std::remove_if(voices_.begin(), voices_.end(),
                        [this](const ActiveVoice& av) {
-                           return !instrumentAt(av.instrumentId)
-                               || av.voice->isFinished(currentFrame_);
+                           if (!av.voice->isFinished(currentFrame_))
+                               return false;
+                           if (IInstrument* inst = instrumentAt(av.instrumentId)) {
+                               inst->releaseVoice(av.voice);
+                               --activeCounts_[static_cast<size_t>(av.instrumentId)];
+                           }
+                           notify(VoiceEvent::Kind::Finished, av);
+                           return true;
                        }),
         voices_.end());
 }
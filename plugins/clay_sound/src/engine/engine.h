@@ -1,81 +1,275 @@
 // (c) Clayground Contributors - MIT License, see "LICENSE" file
 //
-// Engine — hosts instruments + scheduler + voice pool. The single
+// Engine — hosts instruments + scheduler + active voices. The single
 // offline renderer entrypoint used both by tests and (at later stages)
 // by platform sinks that pull sample buffers.
+//
+// Voices are borrowed from their instrument (see IInstrument::
+// acquireVoice()) and returned when finished; pooled instruments make
+// that allocation-free. Per-instrument polyphony caps and voice
+// stealing are enforced when an event fires.
+//
+// Mixing: voices render mono. The engine mixes them, in chunks of
+// kMixFrames, into per-bus planar buffers with a per-voice gain per
+// output channel (instrument gain x distance attenuation x constant-power
+// pan), then sums the buses with their bus gain into the interleaved
+// output. Gains are re-evaluated per chunk (control rate) and ramped
+// across it. A mono engine (channels == 1) ignores pan.
+//
+// Effects: every bus and the master carry an insert chain of IEffects,
+// run in insertion order on the planar chunk before the bus is summed.
+// A bus can also send a post-gain copy of itself to any higher-numbered
+// bus (e.g. several buses into one reverb bus), so the routing has no
+// cycles and one pass in bus order resolves it. After the master chain
+// an optional look-ahead Limiter keeps the output within its ceiling.
+// Buses with effects are processed even when no voice plays on them,
+// so tails ring out. The time spent in each effect is measured per
+// render call and published as a load (fraction of real time).
 
 #pragma once
 
+#include "instrument.h"
+#include "limiter.h"
 #include "scheduler.h"
+#include "spatial.h"
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <memory>
 #include <vector>
 
 namespace clay::sound {
 
-class IInstrument;
+class IEffect;
 class IVoice;
 
+// Voice lifecycle notification, reported from whichever thread renders.
+struct VoiceEvent
+{
+    enum class Kind { Started, Finished };
+    Kind    kind = Kind::Started;
+    int     instrumentId = -1;
+    EventId id = 0;
+};
+
 class Engine
 {
 public:
-    explicit Engine(int sampleRate);
+    // Plain function + context so the hook stays allocation-free and can
+    // run on a real-time thread.
+    using VoiceEventFn = void (*)(void* context, const VoiceEvent& ev);
+
+    static constexpr int kMaxBuses = 8;       // bus 0 is the default
+    static constexpr int kMixFrames = 256;    // control-rate chunk
+    static constexpr int kMasterBus = -1;     // effect chain after the bus sum
+    static constexpr int kMaxEffects = 32;    // effect ids 0..kMaxEffects-1
+
+    // `channels` is 1 (mono) or 2 (interleaved stereo).
+    explicit Engine(int sampleRate, int channels = 1);
     ~Engine();
 
     Engine(const Engine&) = delete;
     Engine& operator=(const Engine&) = delete;
 
-    // Register an instrument. Takes ownership. Returns its id (>= 0).
-    // Ids are stable for the lifetime of the engine — removeInstrument()
-    // tombstones the slot rather than reindexing, so existing ids never
-    // change meaning.
+    // Register an instrument. Takes ownership. Returns its id (>= 0):
+    // the lowest slot freed by removeInstrument(), else a new one, so
+    // add/remove churn stays within prepare()'s reserve. Ids of live
+    // instruments never change meaning.
     int addInstrument(std::unique_ptr<IInstrument> inst);
 
-    // Drop an instrument and any of its still-active voices. Idempotent.
+    // Same with a caller-chosen id, for callers that hand out ids
+    // themselves (AudioOutput). Returns false if `id` is invalid or taken.
+    bool insertInstrument(int id, std::unique_ptr<IInstrument> inst);
+
+    // Drop an instrument, any of its still-active voices and its pending
+    // events, so a later instrument reusing the id starts clean.
+    // Idempotent.
     void removeInstrument(int id);
 
+    // Like removeInstrument(), but hands the instrument back instead of
+    // destroying it, so a real-time caller can defer the deallocation.
+    std::unique_ptr<IInstrument> releaseInstrument(int id);
+
     // Non-owning lookup; returns nullptr for unknown or removed ids.
     IInstrument* instrumentAt(int id) const;
 
     // Enqueue an event on the scheduler. Returns the scheduler ticket.
-    EventId schedule(const NoteEvent& ev);
+    // `id` may come from reserveEventId(); 0 draws a fresh one.
+    EventId schedule(const NoteEvent& ev, EventId id = 0);
+
+    // Draw a scheduler ticket ahead of schedule(). Thread-safe.
+    EventId reserveEventId() { return scheduler_.reserveId(); }
 
-    // Cancel a pending event (before it fires).
+    // Cancel a pending event (before it fires). Its instrument gets a
+    // discardEvent() so per-note state queued with it is released.
     bool cancel(EventId id);
 
-    // Remove all pending events; active voices keep ringing until they
-    // self-finish. Use resetVoices() to also silence the voice pool.
+    // Remove all pending events, discarding them like cancel(); active
+    // voices keep ringing until they self-finish. Use resetVoices() to
+    // also silence the voice pool.
     void clearSchedule();
 
     // Drop all active voices immediately (hard cut).
     void resetVoices();
 
-    // Render `frames` mono samples into `out`. Additive: `out` is
-    // overwritten, not accumulated. Advances currentFrame by `frames`.
-    // Each voice's contribution is scaled by its source instrument's
-    // current `gain()` before being summed.
+    // Preallocate for `maxInstruments` registrations, `maxVoices`
+    // simultaneous voices, `maxEvents` pending events and emitter ids
+    // below `maxEmitters`, so a real-time caller's first blocks do not
+    // grow the internal buffers. Mix buffers are fixed-size.
+    void prepare(int maxInstruments, int maxVoices = 256, int maxEvents = 4096,
+                 int maxEmitters = 256);
+
+    // Render `frames` frames of channels() interleaved samples into
+    // `out`. Additive: `out` is overwritten, not accumulated. Advances
+    // currentFrame by `frames`. Each voice's contribution is scaled by
+    // its source instrument's current `gain()`, its placement and its
+    // bus gain before being summed.
     void renderOffline(float* out, int frames);
 
+    // Bus gain (linear, >= 0), applied when the bus is summed into the
+    // output. Instruments pick their bus via IInstrument::setBus().
+    // Thread-safe, like IInstrument::gain().
+    void  setBusGain(int bus, float gain);
+    float busGain(int bus) const;
+
+    // Send level (linear, >= 0) from `bus` into `target`, taken after
+    // the bus gain. Only sends to a higher-numbered bus are honoured.
+    // Thread-safe.
+    void  setBusSend(int bus, int target, float level);
+    float busSend(int bus, int target) const;
+
+    // Append `effect` to the chain of `bus` (or kMasterBus) under the
+    // lowest free id, which is returned; -1 (and the effect is dropped)
+    // when all kMaxEffects ids are taken.
+    int addEffect(int bus, std::unique_ptr<IEffect> effect);
+
+    // Same with a caller-chosen id, for callers that hand out ids
+    // themselves (AudioOutput). Returns false if `id` is invalid or taken.
+    bool insertEffect(int id, int bus, std::unique_ptr<IEffect> effect);
+
+    // Move an effect to the end of another bus's chain.
+    void setEffectBus(int id, int bus);
+
+    // Take an effect out of its chain and hand it back, so a real-time
+    // caller can defer the deallocation. nullptr for unknown ids.
+    std::unique_ptr<IEffect> releaseEffect(int id);
+    void removeEffect(int id) { releaseEffect(id); }
+
+    // Non-owning lookup; nullptr for unknown ids.
+    IEffect* effectAt(int id) const;
+
+    // Master limiter (off by default). While enabled the output is
+    // delayed by latencyFrames().
+    void setLimiterEnabled(bool enabled);
+    bool limiterEnabled() const { return limiterEnabled_.load(std::memory_order_relaxed); }
+    Limiter& limiter() { return limiter_; }
+    const Limiter& limiter() const { return limiter_; }
+    int latencyFrames() const { return limiterEnabled() ? limiter_.latencyFrames() : 0; }
+
+    // Processing time of one effect (or all effects plus the limiter)
+    // over the last render call, as a fraction of the audio duration
+    // rendered. Thread-safe.
+    double effectLoad(int id) const;
+    double effectsLoad() const { return effectsLoad_.load(std::memory_order_relaxed); }
+
+    // Listener and emitters for spatial voices (NoteEvent::emitterId).
+    // Voices re-read them every mix chunk. setEmitter() activates id.
+    void setListener(const Listener& listener) { listener_ = listener; }
+    const Listener& listener() const { return listener_; }
+    void setEmitter(int id, const Emitter& emitter);
+    void removeEmitter(int id);
+
     int sampleRate() const { return sampleRate_; }
+    int channels() const { return channels_; }
     int64_t currentFrame() const { return currentFrame_; }
     size_t activeVoices() const { return voices_.size(); }
     // Voices currently active for a specific instrument id.
     size_t activeVoices(int instrumentId) const;
     size_t pendingEvents() const { return scheduler_.pending(); }
 
+    // Called for every voice started and finished (including voices cut
+    // by removeInstrument()/resetVoices()). nullptr disables.
+    void setVoiceEventCallback(VoiceEventFn fn, void* context);
+
+    // Receives shared data the instruments let go of on the render
+    // thread (see IInstrument::retire()). nullptr releases it in place.
+    void setRetireCallback(RetireFn fn, void* context);
+
 private:
     struct ActiveVoice {
-        int instrumentId = -1;          // owner; -1 means tombstoned
-        std::unique_ptr<IVoice> voice;
+        int instrumentId = -1;          // owner
+        EventId id = 0;
+        int64_t startFrame = 0;
+        int priority = 0;
+        IVoice* voice = nullptr;        // lent by the owner, see IInstrument::acquireVoice()
+        float pan = 0.0f;               // NoteEvent::pan
+        int emitterId = -1;
+        bool placed = false;            // gains hold the last chunk's values
+        std::array<float, 2> gains{};   // per output channel
     };
 
+    void notify(VoiceEvent::Kind kind, const ActiveVoice& av);
+    void dropVoicesOf(int instrumentId);
+    void startVoice(EventId id, const NoteEvent& ev);
+    // Make room for `ev` on an instrument at its polyphony cap. Returns
+    // false if the note must be dropped instead.
+    bool stealFor(IInstrument& inst, const NoteEvent& ev);
+    // Hand a voice back to its instrument and forget it. Keeps the order
+    // of the remaining voices.
+    void retireVoice(size_t index);
+    // Gains of `av` for the current chunk, per output channel.
+    std::array<float, 2> targetGains(const ActiveVoice& av, const IInstrument& inst) const;
+    struct EffectSlot {
+        std::unique_ptr<IEffect> effect;
+        int bus = 0;                        // chain index, see chainOf()
+        bool bypassed = false;              // as of the last chunk
+        int64_t ns = 0;                     // time spent this render call
+        std::atomic<double> load{0.0};
+    };
+
+    // Chain index of a bus: 0..kMaxBuses-1, kMaxBuses for the master.
+    static int chainOf(int bus) { return bus == kMasterBus ? kMaxBuses : bus; }
+    // Run the chain `chain` over `n` frames of its planes.
+    void runEffects(int chain, float* const* planes, int n);
+    // Recompute effectBuses_ after the chains changed.
+    void updateEffectBuses();
+
+    // Mix one chunk of `n` frames starting at `chunkStart` into `out`.
+    void mixChunk(float* out, int n, int64_t chunkStart);
+    float* busPlane(int bus, int channel)
+    {
+        return busMix_.data() + (static_cast<size_t>(bus) * 2 + static_cast<size_t>(channel)) * kMixFrames;
+    }
+
     int sampleRate_;
+    int channels_;
     int64_t currentFrame_ = 0;
 
     Scheduler scheduler_;
     std::vector<std::unique_ptr<IInstrument>> instruments_; // sparse: nullptr after remove
     std::vector<ActiveVoice> voices_;
-    std::vector<float> scratch_;        // reused per render pass
+    std::vector<int> activeCounts_;     // per instrument id
+    std::vector<float> scratch_;        // one voice, one chunk
+    std::vector<float> busMix_;         // kMaxBuses x 2 planes x kMixFrames
+    std::vector<float> masterMix_;      // 2 planes x kMixFrames
+    std::vector<Scheduler::Fired> fired_; // reused per render pass
+    std::array<std::atomic<float>, kMaxBuses> busGains_;
+    std::array<std::array<std::atomic<float>, kMaxBuses>, kMaxBuses> busSends_;
+    std::array<EffectSlot, kMaxEffects> effects_;
+    std::array<int, kMaxEffects> effectOrder_{};    // ids in insertion order
+    int effectCount_ = 0;
+    unsigned effectBuses_ = 0;          // bit per chain with effects
+    int64_t limiterNs_ = 0;
+    Limiter limiter_;
+    std::atomic<bool> limiterEnabled_{false};
+    bool limiterWasEnabled_ = false;
+    std::atomic<double> effectsLoad_{0.0};
+    Listener listener_;
+    std::vector<Emitter> emitters_;     // by emitter id
+    VoiceEventFn voiceEventFn_ = nullptr;
+    void* voiceEventContext_ = nullptr;
+    RetireFn retireFn_ = nullptr;
+    void* retireContext_ = nullptr;
 };
 
 } // namespace clay::sound
@@ -0,0 +1,110 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "fdn_reverb.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace clay::sound {
+
+namespace {
+
+// Line lengths in frames at 44.1 kHz and size 1; mutually prime so the
+// echo densities do not line up.
+constexpr std::array<double, FdnReverb::kLines> kBaseLengths = { 1777.0, 2113.0, 2503.0, 2927.0 };
+
+size_t nextPowerOfTwo(size_t n)
+{
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+} // namespace
+
+FdnReverb::FdnReverb(int sampleRate)
+    : sampleRate_(sampleRate)
+{
+    const double scale = sampleRate / 44100.0;
+    const size_t longest = static_cast<size_t>(std::ceil(kBaseLengths.back() * scale));
+    const size_t size = nextPowerOfTwo(longest + 1);
+    for (auto& l : lines_) l.assign(size, 0.0f);
+    mask_ = size - 1;
+}
+
+void FdnReverb::setDecay(float seconds) { decay_.store(seconds, std::memory_order_relaxed); }
+void FdnReverb::setSize(float s) { size_.store(s, std::memory_order_relaxed); }
+void FdnReverb::setDamping(float d) { damping_.store(d, std::memory_order_relaxed); }
+void FdnReverb::setMix(float m) { mix_.store(m, std::memory_order_relaxed); }
+
+void FdnReverb::reset()
+{
+    for (auto& l : lines_) std::fill(l.begin(), l.end(), 0.0f);
+    lowpass_.fill(0.0f);
+    write_ = 0;
+}
+
+void FdnReverb::configure()
+{
+    const float decay = std::clamp(this->decay(), 0.1f, 20.0f);
+    const float size = std::clamp(this->size(), 0.25f, 1.0f);
+    const float damping = std::clamp(this->damping(), 0.0f, 1.0f);
+    if (decay == lastDecay_ && size == lastSize_ && damping == lastDamping_) return;
+    lastDecay_ = decay;
+    lastSize_ = size;
+    lastDamping_ = damping;
+
+    const double scale = sampleRate_ / 44100.0 * size;
+    for (size_t k = 0; k < kLines; ++k) {
+        length_[k] = std::clamp<size_t>(static_cast<size_t>(std::lround(kBaseLengths[k] * scale)),
+                                        1, mask_);
+        // -60 dB after `decay` seconds of round trips through this line.
+        gain_[k] = static_cast<float>(std::pow(10.0, -3.0 * static_cast<double>(length_[k])
+                                                   / (decay * sampleRate_)));
+    }
+    lowpassCoeff_ = 1.0f - 0.9f * damping;
+}
+
+void FdnReverb::process(float* const* planes, int channels, int frames)
+{
+    configure();
+    const float wet = std::clamp(mix(), 0.0f, 1.0f);
+    const float dry = 1.0f - wet;
+    const float inScale = channels == 2 ? 0.5f : 1.0f;
+    const float a = lowpassCoeff_;
+    constexpr float kHouseholder = 2.0f / kLines;
+
+    const size_t size = mask_ + 1;
+    for (int i = 0; i < frames; ++i) {
+        const size_t w = (write_ + static_cast<size_t>(i)) & mask_;
+        float in = planes[0][i];
+        if (channels == 2) in += planes[1][i];
+        in *= inScale;
+
+        float d[kLines];
+        float sum = 0.0f;
+        for (size_t k = 0; k < kLines; ++k) {
+            const float o = lines_[k][(w + size - length_[k]) & mask_] * gain_[k];
+            lowpass_[k] += (o - lowpass_[k]) * a;
+            d[k] = lowpass_[k];
+            sum += d[k];
+        }
+        for (size_t k = 0; k < kLines; ++k)
+            lines_[k][w] = in + d[k] - kHouseholder * sum;
+
+        const float left = 0.5f * (d[0] + d[2]);
+        const float right = 0.5f * (d[1] + d[3]);
+        if (channels == 2) {
+            planes[0][i] = planes[0][i] * dry + left * wet;
+            planes[1][i] = planes[1][i] * dry + right * wet;
+        } else {
+            planes[0][i] = planes[0][i] * dry + 0.5f * (left + right) * wet;
+        }
+    }
+    write_ = (write_ + static_cast<size_t>(frames)) & mask_;
+
+    for (auto& lp : lowpass_)
+        if (std::abs(lp) < 1e-15f) lp = 0.0f;
+}
+
+} // namespace clay::sound
@@ -0,0 +1,70 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// FdnReverb — small feedback delay network reverb: kLines delay lines
+// of mutually prime lengths, mixed back into each other through a
+// Householder matrix (lossless, one add and one multiply per line) and
+// damped by a one-pole low-pass per line. Line gains follow from the
+// requested decay time (RT60), so the tail length does not depend on
+// `size`. Meant as a send effect: feed it from a bus send and keep
+// `mix` at 1 there, or use it as an insert with a lower mix.
+//
+// The lines are power-of-two rings like FeedbackDelay's; the per-line
+// work runs in fixed-width loops over kLines lanes, which the compiler
+// maps onto one SIMD register.
+
+#pragma once
+
+#include "effect.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace clay::sound {
+
+class FdnReverb : public IEffect
+{
+public:
+    static constexpr int kLines = 4;
+
+    explicit FdnReverb(int sampleRate);
+
+    // Thread-safe.
+    void setDecay(float seconds);       // RT60, 0.1..20 s
+    void setSize(float s);              // room scale 0.25..1, applies on the next chunk
+    void setDamping(float d);           // 0 (bright) .. 1 (dark)
+    void setMix(float m);               // wet level 0..1; dry is 1 - mix
+
+    float decay() const { return decay_.load(std::memory_order_relaxed); }
+    float size() const { return size_.load(std::memory_order_relaxed); }
+    float damping() const { return damping_.load(std::memory_order_relaxed); }
+    float mix() const { return mix_.load(std::memory_order_relaxed); }
+
+    void process(float* const* planes, int channels, int frames) override;
+    void reset() override;
+
+private:
+    // Recompute line lengths and gains from the parameters.
+    void configure();
+
+    const int sampleRate_;
+    std::atomic<float> decay_{1.5f};
+    std::atomic<float> size_{0.7f};
+    std::atomic<float> damping_{0.4f};
+    std::atomic<float> mix_{0.25f};
+
+    // Render thread only.
+    std::array<std::vector<float>, kLines> lines_;
+    size_t mask_ = 0;
+    size_t write_ = 0;
+    std::array<size_t, kLines> length_{};
+    std::array<float, kLines> gain_{};
+    std::array<float, kLines> lowpass_{};
+    float lowpassCoeff_ = 1.0f;
+    float lastDecay_ = -1.0f;
+    float lastSize_ = -1.0f;
+    float lastDamping_ = -1.0f;
+};
+
+} // namespace clay::sound
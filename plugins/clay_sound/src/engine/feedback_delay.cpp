@@ -0,0 +1,91 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "feedback_delay.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace clay::sound {
+
+namespace {
+
+size_t nextPowerOfTwo(size_t n)
+{
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+} // namespace
+
+FeedbackDelay::FeedbackDelay(int sampleRate, float maxSeconds)
+    : sampleRate_(sampleRate)
+    , maxSeconds_(std::max(maxSeconds, 0.001f))
+{
+    const size_t frames = static_cast<size_t>(std::ceil(maxSeconds_ * static_cast<float>(sampleRate)));
+    const size_t size = nextPowerOfTwo(frames + kMaxFrames + 1);
+    for (auto& r : ring_) r.assign(size, 0.0f);
+    mask_ = size - 1;
+}
+
+void FeedbackDelay::setTime(float seconds) { time_.store(seconds, std::memory_order_relaxed); }
+void FeedbackDelay::setFeedback(float f) { feedback_.store(f, std::memory_order_relaxed); }
+void FeedbackDelay::setMix(float m) { mix_.store(m, std::memory_order_relaxed); }
+void FeedbackDelay::setDamping(float d) { damping_.store(d, std::memory_order_relaxed); }
+void FeedbackDelay::setPingPong(bool p) { pingPong_.store(p, std::memory_order_relaxed); }
+
+void FeedbackDelay::reset()
+{
+    for (auto& r : ring_) std::fill(r.begin(), r.end(), 0.0f);
+    lowpass_.fill(0.0f);
+    write_ = 0;
+    primed_ = false;
+}
+
+void FeedbackDelay::process(float* const* planes, int channels, int frames)
+{
+    const size_t maxDelay = static_cast<size_t>(maxSeconds_ * static_cast<float>(sampleRate_));
+    const size_t delay = std::clamp<size_t>(
+        static_cast<size_t>(std::lround(std::max(time(), 0.0f) * static_cast<float>(sampleRate_))),
+        1, std::max<size_t>(maxDelay, 1));
+    const float fb = std::clamp(feedback(), 0.0f, 0.95f);
+    const float wet = std::clamp(mix(), 0.0f, 1.0f);
+    // One-pole coefficient: 1 passes the repeats unfiltered.
+    const float a = 1.0f - 0.95f * std::clamp(damping(), 0.0f, 1.0f);
+    const bool cross = channels == 2 && pingPong();
+
+    if (!primed_) {
+        lastFeedback_ = fb;
+        lastMix_ = wet;
+        primed_ = true;
+    }
+    const float fbStep = (fb - lastFeedback_) / static_cast<float>(frames);
+    const float wetStep = (wet - lastMix_) / static_cast<float>(frames);
+
+    const size_t size = mask_ + 1;
+    float* ring[kMaxChannels] = { ring_[0].data(), ring_[1].data() };
+    for (int i = 0; i < frames; ++i) {
+        const size_t w = (write_ + static_cast<size_t>(i)) & mask_;
+        const size_t r = (w + size - delay) & mask_;
+        const float g = lastFeedback_ + fbStep * static_cast<float>(i + 1);
+        const float m = lastMix_ + wetStep * static_cast<float>(i + 1);
+
+        float y[kMaxChannels] = { ring[0][r], ring[1][r] };
+        for (int c = 0; c < channels; ++c) {
+            const float back = cross ? y[1 - c] : y[c];
+            float& lp = lowpass_[static_cast<size_t>(c)];
+            lp += (back - lp) * a;
+            const float x = planes[c][i];
+            ring[c][w] = x + lp * g;
+            planes[c][i] = x + y[c] * m;
+        }
+    }
+    write_ = (write_ + static_cast<size_t>(frames)) & mask_;
+    lastFeedback_ = fb;
+    lastMix_ = wet;
+
+    for (auto& lp : lowpass_)
+        if (std::abs(lp) < 1e-15f) lp = 0.0f;
+}
+
+} // namespace clay::sound
@@ -0,0 +1,64 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// FeedbackDelay — echo effect. Each channel writes into a power-of-two
+// ring sized for maxSeconds at construction, so reads and writes wrap
+// with a mask instead of a branch or modulo. A one-pole low-pass in
+// the feedback path darkens successive repeats; `pingPong` crosses the
+// feedback between channels on a stereo bus.
+//
+// Delay time changes apply at the next chunk, moving the read head by
+// the difference; the feedback and mix levels ramp across the chunk.
+
+#pragma once
+
+#include "effect.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace clay::sound {
+
+class FeedbackDelay : public IEffect
+{
+public:
+    explicit FeedbackDelay(int sampleRate, float maxSeconds = 2.0f);
+
+    // Thread-safe; values are clamped when the render thread reads them.
+    void setTime(float seconds);        // (0, maxSeconds]
+    void setFeedback(float f);          // 0..0.95
+    void setMix(float m);               // wet level 0..1; dry stays at 1
+    void setDamping(float d);           // 0 (bright) .. 1 (dark)
+    void setPingPong(bool p);
+
+    float time() const { return time_.load(std::memory_order_relaxed); }
+    float feedback() const { return feedback_.load(std::memory_order_relaxed); }
+    float mix() const { return mix_.load(std::memory_order_relaxed); }
+    float damping() const { return damping_.load(std::memory_order_relaxed); }
+    bool  pingPong() const { return pingPong_.load(std::memory_order_relaxed); }
+    float maxSeconds() const { return maxSeconds_; }
+
+    void process(float* const* planes, int channels, int frames) override;
+    void reset() override;
+
+private:
+    const int   sampleRate_;
+    const float maxSeconds_;
+    std::atomic<float> time_{0.25f};
+    std::atomic<float> feedback_{0.35f};
+    std::atomic<float> mix_{0.3f};
+    std::atomic<float> damping_{0.2f};
+    std::atomic<bool>  pingPong_{false};
+
+    // Render thread only.
+    std::array<std::vector<float>, kMaxChannels> ring_;
+    size_t mask_ = 0;
+    size_t write_ = 0;
+    std::array<float, kMaxChannels> lowpass_{};
+    float lastFeedback_ = 0.0f;
+    float lastMix_ = 0.0f;
+    bool  primed_ = false;
+};
+
+} // namespace clay::sound
@@ -9,30 +9,77 @@
 // the source instrument's current gain to that voice's contribution,
 // so multiple instruments sharing one engine + sink can each have
 // independent volume.
+//
+// Polyphony: the engine keeps at most maxPolyphony() voices of an
+// instrument alive. A note fired at the cap steals a voice chosen by
+// stealPolicy(), or is dropped when the policy finds nothing it may
+// take. Like gain, the cap, policy and counters are atomics so the QML
+// thread can read and tune them while the audio thread renders.
+//
+// Shared data an instrument lets go of while rendering (a replaced
+// sample buffer, say) may hold the last reference. It goes through
+// retire() to the engine's retire callback, which hands it to a thread
+// that may free it (AudioOutput: the GUI thread).
 
 #pragma once
 
 #include "scheduler.h"
+#include "voice.h"
+#include <algorithm>
 #include <atomic>
+#include <climits>
+#include <cstdint>
 #include <memory>
 
 namespace clay::sound {
 
 struct NoteEvent;
-class IVoice;
+
+// Takes over `object`, which the render thread must not destroy.
+using RetireFn = void (*)(void* context, std::shared_ptr<const void> object);
 
 class IInstrument
 {
 public:
+    enum class StealPolicy : int {
+        Oldest,          // earliest-started voice
+        Quietest,        // lowest IVoice::level()
+        LowestPriority   // lowest NoteEvent::priority, oldest on ties; the
+                         // new note is dropped if it ranks below them all
+    };
+
+    static constexpr int kDefaultPolyphony = 32;
+
     virtual ~IInstrument() = default;
 
-    // Build a fully-configured voice for this event. The engine owns
-    // the returned voice for its lifetime. `id` is the scheduler ticket
-    // returned by Engine::schedule(); instruments that keep per-event
-    // side state (e.g. patches queued before scheduling) key on it.
-    virtual std::unique_ptr<IVoice> createVoice(const NoteEvent& ev,
-                                                EventId id,
-                                                int sampleRate) = 0;
+    // Build a fully-configured voice for this event. `id` is the
+    // scheduler ticket returned by Engine::schedule(); instruments that
+    // keep per-event side state (e.g. patches queued before scheduling)
+    // key on it. Only used by the default acquireVoice().
+    virtual std::unique_ptr<IVoice> createVoice(const NoteEvent& /*ev*/,
+                                                EventId /*id*/,
+                                                int /*sampleRate*/)
+    {
+        return nullptr;
+    }
+
+    // Hand the engine a configured voice, which it gives back through
+    // releaseVoice() once finished. The default heap-allocates through
+    // createVoice(); pooled instruments override both (see VoicePool)
+    // and return nullptr when out of voices.
+    virtual IVoice* acquireVoice(const NoteEvent& ev, EventId id, int sampleRate)
+    {
+        return createVoice(ev, id, sampleRate).release();
+    }
+    virtual void releaseVoice(IVoice* voice);
+
+    // Called instead of acquireVoice() for an event dropped at the
+    // polyphony cap or cancelled before it fired, so per-event state
+    // keyed on `id` can be freed.
+    virtual void discardEvent(EventId /*id*/) {}
+
+    // Hard upper bound on simultaneous voices (pool size).
+    virtual int voiceCapacity() const { return INT_MAX; }
 
     // Per-instrument linear gain in [0, 1]. Read by the engine on every
     // mix pass; safe to update from the QML thread while the audio
@@ -40,9 +87,57 @@ public:
     void  setGain(float g) { gain_.store(clampGain(g), std::memory_order_relaxed); }
     float gain() const     { return gain_.load(std::memory_order_relaxed); }
 
+    // Mix bus the instrument's voices are summed into (see
+    // Engine::setBusGain()). Same threading rules as gain().
+    void setBus(int bus) { bus_.store(bus < 0 ? 0 : bus, std::memory_order_relaxed); }
+    int  bus() const     { return bus_.load(std::memory_order_relaxed); }
+
+    // Voice cap, clamped to [1, voiceCapacity()].
+    void setMaxPolyphony(int n) { maxPolyphony_.store(std::max(1, n), std::memory_order_relaxed); }
+    int  maxPolyphony() const
+    {
+        return std::min(maxPolyphony_.load(std::memory_order_relaxed), voiceCapacity());
+    }
+
+    void        setStealPolicy(StealPolicy p) { stealPolicy_.store(p, std::memory_order_relaxed); }
+    StealPolicy stealPolicy() const           { return stealPolicy_.load(std::memory_order_relaxed); }
+
+    // Voices cut to make room, and notes dropped at the cap. Counted by
+    // the engine.
+    uint64_t voiceSteals() const  { return voiceSteals_.load(std::memory_order_relaxed); }
+    uint64_t droppedNotes() const { return droppedNotes_.load(std::memory_order_relaxed); }
+    void countSteal()       { voiceSteals_.fetch_add(1, std::memory_order_relaxed); }
+    void countDroppedNote() { droppedNotes_.fetch_add(1, std::memory_order_relaxed); }
+
+    // Set by the engine the instrument is registered with.
+    void setRetireCallback(RetireFn fn, void* context)
+    {
+        retireFn_ = fn;
+        retireContext_ = context;
+    }
+
+protected:
+    // Drop shared data; without a retire callback it is released here.
+    void retire(std::shared_ptr<const void> object)
+    {
+        if (object && retireFn_) retireFn_(retireContext_, std::move(object));
+    }
+
 private:
     static float clampGain(float g) { return g < 0.0f ? 0.0f : (g > 1.0f ? 1.0f : g); }
     std::atomic<float> gain_{1.0f};
+    std::atomic<int> bus_{0};
+    std::atomic<int> maxPolyphony_{kDefaultPolyphony};
+    std::atomic<StealPolicy> stealPolicy_{StealPolicy::Oldest};
+    std::atomic<uint64_t> voiceSteals_{0};
+    std::atomic<uint64_t> droppedNotes_{0};
+    RetireFn retireFn_ = nullptr;
+    void* retireContext_ = nullptr;
 };
 
+inline void IInstrument::releaseVoice(IVoice* voice)
+{
+    delete voice;
+}
+
 } // namespace clay::sound
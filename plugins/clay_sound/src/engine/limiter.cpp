@@ -0,0 +1,72 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "limiter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace clay::sound {
+
+Limiter::Limiter(int sampleRate)
+    : sampleRate_(sampleRate)
+{
+    reset();
+}
+
+void Limiter::setCeiling(float linear) { ceiling_.store(linear, std::memory_order_relaxed); }
+void Limiter::setRelease(float seconds) { release_.store(seconds, std::memory_order_relaxed); }
+
+void Limiter::reset()
+{
+    for (auto& d : delay_) d.fill(0.0f);
+    avg_.fill(1.0f);
+    avgSum_ = kLookahead;
+    pos_ = 0;
+    minHead_ = minTail_ = 0;
+    held_ = 1.0f;
+    reductionDb_.store(0.0f, std::memory_order_relaxed);
+}
+
+void Limiter::process(float* const* planes, int channels, int frames)
+{
+    const float ceiling = std::clamp(this->ceiling(), 1e-4f, 1.0f);
+    const float releaseCoeff = 1.0f - std::exp(-1.0f / (std::max(release(), 1e-3f)
+                                                        * static_cast<float>(sampleRate_)));
+    constexpr float kAverage = 1.0f / kLookahead;
+    float deepest = 1.0f;
+
+    for (int i = 0; i < frames; ++i) {
+        float peak = 0.0f;
+        for (int c = 0; c < channels; ++c) peak = std::max(peak, std::abs(planes[c][i]));
+        const float need = peak > ceiling ? ceiling / peak : 1.0f;
+
+        // Minimum over the current frame and the kLookahead before it.
+        while (minTail_ != minHead_ && minGain_[(minTail_ - 1) & kMask] >= need) --minTail_;
+        minFrame_[minTail_ & kMask] = pos_;
+        minGain_[minTail_ & kMask] = need;
+        ++minTail_;
+        while (minFrame_[minHead_ & kMask] + kLookahead < pos_) ++minHead_;
+        const float hold = minGain_[minHead_ & kMask];
+
+        held_ = hold < held_ ? hold : held_ + (hold - held_) * releaseCoeff;
+
+        const size_t slot = pos_ & kMask;
+        avgSum_ += held_ - avg_[(pos_ - kLookahead) & kMask];
+        avg_[slot] = held_;
+        const float gain = std::min(1.0f, static_cast<float>(avgSum_) * kAverage);
+        deepest = std::min(deepest, gain);
+
+        for (int c = 0; c < channels; ++c) {
+            auto& line = delay_[static_cast<size_t>(c)];
+            const float x = planes[c][i];
+            const float y = line[(pos_ - kLookahead) & kMask] * gain;
+            line[slot] = x;
+            planes[c][i] = std::clamp(y, -ceiling, ceiling);
+        }
+        ++pos_;
+    }
+
+    reductionDb_.store(20.0f * std::log10(deepest), std::memory_order_relaxed);
+}
+
+} // namespace clay::sound
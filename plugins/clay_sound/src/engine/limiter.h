@@ -0,0 +1,69 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// Limiter — stereo-linked look-ahead peak limiter for the master. The
+// signal is delayed by kLookahead frames; the gain needed to keep each
+// frame under the ceiling is held over the look-ahead window (sliding
+// minimum), released exponentially, and then smoothed by a moving
+// average over the same window. The average starts falling kLookahead
+// frames before a peak leaves the delay, so the gain reaches it in time
+// without the clicks of a hard clip. Anything that still exceeds the
+// ceiling (float rounding) is clipped as a last resort.
+//
+// Unlike the other effects the engine runs it as a dedicated stage
+// after the master chain (Engine::setLimiterEnabled()).
+
+#pragma once
+
+#include "effect.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace clay::sound {
+
+class Limiter : public IEffect
+{
+public:
+    static constexpr int kLookahead = 64;          // ~1.5 ms at 44.1 kHz
+
+    explicit Limiter(int sampleRate);
+
+    // Thread-safe.
+    void  setCeiling(float linear);              // output peak, (0, 1]
+    float ceiling() const { return ceiling_.load(std::memory_order_relaxed); }
+    void  setRelease(float seconds);
+    float release() const { return release_.load(std::memory_order_relaxed); }
+
+    // Deepest gain reduction of the last processed chunk, in dB (<= 0).
+    float reductionDb() const { return reductionDb_.load(std::memory_order_relaxed); }
+
+    void process(float* const* planes, int channels, int frames) override;
+    void reset() override;
+    int  latencyFrames() const override { return kLookahead; }
+
+private:
+    static constexpr size_t kRing = 128;           // > kLookahead, power of two
+    static constexpr size_t kMask = kRing - 1;
+
+    const int sampleRate_;
+    std::atomic<float> ceiling_{1.0f};
+    std::atomic<float> release_{0.05f};
+    std::atomic<float> reductionDb_{0.0f};
+
+    // Render thread only.
+    std::array<std::array<float, kRing>, kMaxChannels> delay_{};
+    size_t pos_ = 0;                              // frames processed
+    // Sliding-window minimum of the required gain: a monotonic queue of
+    // (frame, gain) with increasing gains.
+    std::array<size_t, kRing> minFrame_{};
+    std::array<float, kRing> minGain_{};
+    size_t minHead_ = 0;
+    size_t minTail_ = 0;
+    float  held_ = 1.0f;                          // after release smoothing
+    // Moving average of the last kLookahead smoothed gains.
+    std::array<float, kRing> avg_{};
+    double avgSum_ = kLookahead;
+};
+
+} // namespace clay::sound
@@ -0,0 +1,41 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// Mixing kernels for the engine's bus path. Buffers are planar (one
+// contiguous array per channel) and never overlap, so each kernel is a
+// single unit-stride loop over restrict pointers that compilers
+// auto-vectorize (SSE/AVX/NEON, and WASM SIMD when enabled). The engine
+// calls them with the constant chunk size, which lets even GCC's -O2
+// cost model vectorize without a scalar epilogue. Interleaving for the
+// sink happens once per chunk at the very end.
+
+#pragma once
+
+namespace clay::sound::mix {
+
+// dst[i] += src[i] * g
+inline void addScaled(float* __restrict dst, const float* __restrict src, int n, float g)
+{
+    for (int i = 0; i < n; ++i) dst[i] += src[i] * g;
+}
+
+// dst[i] += src[i] * gain, gain ramping linearly from g0 towards g1 so
+// the last frame uses g1. Avoids zipper noise on control-rate changes.
+inline void addRamped(float* __restrict dst, const float* __restrict src, int n,
+                      float g0, float g1)
+{
+    const float step = (g1 - g0) / static_cast<float>(n);
+    for (int i = 0; i < n; ++i)
+        dst[i] += src[i] * (g0 + step * static_cast<float>(i + 1));
+}
+
+// out[i * 2 + c] = plane c [i]
+inline void interleave2(float* __restrict out, const float* __restrict left,
+                        const float* __restrict right, int n)
+{
+    for (int i = 0; i < n; ++i) {
+        out[2 * i]     = left[i];
+        out[2 * i + 1] = right[i];
+    }
+}
+
+} // namespace clay::sound::mix
@@ -17,8 +17,10 @@ struct NoteEvent
     double   freqHz         = 440.0;  // Pitch. MIDI-note helpers live at a higher layer.
     float    velocity       = 1.0f;   // 0..1
     int      instrumentId   = -1;     // -1 = unbound; engine ignores
-    float    pan            = 0.0f;   // -1 left .. +1 right (mono engine ignores for now)
+    float    pan            = 0.0f;   // -1 left .. +1 right (ignored by mono engines)
     uint32_t effectPayload  = 0;      // Reserved for tracker effects; opaque in Stage 0
+    int      priority       = 0;      // Higher survives StealPolicy::LowestPriority
+    int      emitterId      = -1;     // Engine emitter to follow; -1 = not spatial
 };
 
 } // namespace clay::sound
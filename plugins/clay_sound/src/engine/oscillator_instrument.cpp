@@ -5,18 +5,14 @@
 
 namespace clay::sound {
 
-std::unique_ptr<IVoice> OscillatorInstrument::createVoice(const NoteEvent& /*ev*/,
-                                                          EventId id,
-                                                          int /*sampleRate*/)
+IVoice* OscillatorInstrument::acquireVoice(const NoteEvent& /*ev*/,
+                                           EventId id,
+                                           int /*sampleRate*/)
 {
-    auto voice = std::make_unique<OscillatorVoice>();
-    auto it = patches_.find(id);
-    if (it != patches_.end()) {
-        voice->setPatch(it->second);
-        patches_.erase(it);
-    } else {
-        voice->setPatch(defaultPatch_);
-    }
+    OscillatorVoice* voice = pool_.acquire();
+    if (!voice) return nullptr;
+    OscillatorVoice::Patch patch;
+    voice->setPatch(patches_.take(id, patch) ? patch : defaultPatch_);
     return voice;
 }
 
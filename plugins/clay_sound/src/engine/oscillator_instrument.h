@@ -3,14 +3,15 @@
 // OscillatorInstrument — spawns OscillatorVoice instances configured
 // from a per-event patch queue. Callers push a patch via pushPatch()
 // keyed on the EventId returned by Engine::schedule(); when that event
-// fires, createVoice() pops the patch and stamps it onto the new voice.
+// fires, acquireVoice() pops the patch and stamps it onto a pooled voice.
 
 #pragma once
 
 #include "instrument.h"
 #include "oscillator_voice.h"
+#include "patch_table.h"
+#include "voice_pool.h"
 #include <memory>
-#include <unordered_map>
 
 namespace clay::sound {
 
@@ -18,10 +19,11 @@ class OscillatorInstrument : public IInstrument
 {
 public:
     // Associate a patch with a scheduled event. The patch is consumed
-    // (removed) when the event fires.
-    void pushPatch(EventId id, const OscillatorVoice::Patch& patch)
+    // (removed) when the event fires. False when the queue is full; the
+    // note then plays the default patch.
+    bool pushPatch(EventId id, const OscillatorVoice::Patch& patch)
     {
-        patches_[id] = patch;
+        return patches_.put(id, patch);
     }
 
     // Default patch applied when no event-specific patch was queued.
@@ -30,16 +32,22 @@ public:
         defaultPatch_ = patch;
     }
 
-    std::unique_ptr<IVoice> createVoice(const NoteEvent& ev,
-                                        EventId id,
-                                        int sampleRate) override;
+    IVoice* acquireVoice(const NoteEvent& ev, EventId id, int sampleRate) override;
+    void releaseVoice(IVoice* voice) override { pool_.release(voice); }
+    void discardEvent(EventId id) override { patches_.erase(id); }
+    int voiceCapacity() const override { return pool_.capacity(); }
+
+    // Voices preallocated per instrument; the polyphony cap can be set
+    // anywhere up to this.
+    static constexpr int kPoolVoices = 64;
 
     size_t queuedPatches() const { return patches_.size(); }
     void clearPatches() { patches_.clear(); }
 
 private:
+    VoicePool<OscillatorVoice> pool_{kPoolVoices};
     OscillatorVoice::Patch defaultPatch_{};
-    std::unordered_map<EventId, OscillatorVoice::Patch> patches_;
+    PatchTable<OscillatorVoice::Patch> patches_;
 };
 
 } // namespace clay::sound
@@ -12,6 +12,27 @@ namespace clay::sound {
 // file stays portable across compilers.
 static constexpr double kPi = 3.14159265358979323846;
 
+// Width of the square wave's linear edges, as a fraction of a cycle.
+static constexpr double kSquareEdge = 0.02;
+
+namespace {
+
+// sin(2*pi*x) for x in [0, 1). Branch-free so the per-segment loop
+// vectorises: fold onto [-1/4, 1/4] cycles and use the odd Taylor series
+// up to x^11 (error < 1e-7 on that interval).
+inline float sineOfCycle(float x)
+{
+    float y = 0.5f - x;                           // sin(2pi x) = sin(2pi y)
+    y = (y > 0.25f) ? 0.5f - y : y;
+    y = (y < -0.25f) ? -0.5f - y : y;
+    const float z = static_cast<float>(2.0 * kPi) * y;
+    const float z2 = z * z;
+    return z * (1.0f + z2 * (-1.0f / 6.0f + z2 * (1.0f / 120.0f + z2 * (-1.0f / 5040.0f
+             + z2 * (1.0f / 362880.0f + z2 * (-1.0f / 39916800.0f))))));
+}
+
+} // namespace
+
 void OscillatorVoice::onNoteOn(const NoteEvent& ev, int sampleRate)
 {
     sampleRate_ = sampleRate;
@@ -20,6 +41,7 @@ void OscillatorVoice::onNoteOn(const NoteEvent& ev, int sampleRate)
     freqHz_     = ev.freqHz;
     gain_       = ev.velocity;
     phase_      = 0.0;
+    level_      = static_cast<float>(gain_);
     // Deterministic-per-voice noise seed. Derived from start frame so
     // two noise notes at different times produce different sequences.
     noiseSeed_ = 12345u + static_cast<uint32_t>(ev.timeFrames & 0xffffffff);
@@ -37,23 +59,33 @@ bool OscillatorVoice::isFinished(int64_t currentFrame) const
     return currentFrame >= endFrame_;
 }
 
-double OscillatorVoice::renderSample(int64_t frame)
+double OscillatorVoice::nextNoise()
 {
-    // Time since noteOn, in seconds.
-    const double t        = static_cast<double>(frame - startFrame_) / sampleRate_;
-    const double duration = static_cast<double>(endFrame_ - startFrame_) / sampleRate_;
+    noiseSeed_ ^= noiseSeed_ << 13;
+    noiseSeed_ ^= noiseSeed_ >> 17;
+    noiseSeed_ ^= noiseSeed_ << 5;
+    return static_cast<double>(noiseSeed_) /
+               static_cast<double>(0xFFFFFFFFu) *
+               2.0 -
+           1.0;
+}
 
-    // --- Envelope -----------------------------------------------------
+double OscillatorVoice::envelopeAt(double t, double* slopePerSecond) const
+{
+    const double duration = static_cast<double>(endFrame_ - startFrame_) / sampleRate_;
     double env = 0.0;
+    double slope = 0.0;
     if (t >= 0.0) {
         const double releaseStart = duration - patch_.release;
         if (t < patch_.attack) {
             env = (patch_.attack > 0.0) ? (t / patch_.attack) : 1.0;
+            slope = (patch_.attack > 0.0) ? 1.0 / patch_.attack : 0.0;
         } else if (t < patch_.attack + patch_.decay) {
             const double p = (patch_.decay > 0.0)
                                  ? (t - patch_.attack) / patch_.decay
                                  : 1.0;
             env = 1.0 - (1.0 - patch_.sustain) * p;
+            slope = (patch_.decay > 0.0) ? -(1.0 - patch_.sustain) / patch_.decay : 0.0;
         } else if (t < releaseStart) {
             env = patch_.sustain;
         } else if (t < duration) {
@@ -61,14 +93,45 @@ double OscillatorVoice::renderSample(int64_t frame)
                                  ? (t - releaseStart) / patch_.release
                                  : 1.0;
             env = patch_.sustain * (1.0 - p);
+            slope = (patch_.release > 0.0) ? -patch_.sustain / patch_.release : 0.0;
         }
     }
+    if (slopePerSecond) *slopePerSecond = slope;
+    return env;
+}
 
-    // Volume LFO shaping of envelope.
+double OscillatorVoice::volumeLfoAt(double t) const
+{
     if (patch_.lfoTarget == 2 && patch_.lfoRate > 0.0) {
         const double lfo = std::sin(2.0 * kPi * t * patch_.lfoRate);
-        env *= 1.0 - patch_.lfoDepth * 0.5 * (1.0 - lfo);
+        return 1.0 - patch_.lfoDepth * 0.5 * (1.0 - lfo);
     }
+    return 1.0;
+}
+
+double OscillatorVoice::phaseIncrementAt(double t) const
+{
+    double effFreq = freqHz_;
+    if (patch_.pitchTime > 0.0) {
+        const double p = std::min(t / patch_.pitchTime, 1.0);
+        const double semis =
+            patch_.pitchStart + (patch_.pitchEnd - patch_.pitchStart) * p;
+        effFreq *= std::pow(2.0, semis / 12.0);
+    }
+    if (patch_.lfoRate > 0.0 && patch_.lfoDepth > 0.0 && patch_.lfoTarget == 1) {
+        const double lfo = std::sin(2.0 * kPi * t * patch_.lfoRate);
+        effFreq *= std::pow(2.0, lfo * patch_.lfoDepth / 12.0);
+    }
+    return effFreq / static_cast<double>(sampleRate_);
+}
+
+double OscillatorVoice::renderSample(int64_t frame)
+{
+    // Time since noteOn, in seconds.
+    const double t = static_cast<double>(frame - startFrame_) / sampleRate_;
+
+    // --- Envelope (with volume LFO shaping) ----------------------------
+    const double env = envelopeAt(t, nullptr) * volumeLfoAt(t);
 
     // --- Waveform (uses current phase) ---------------------------------
     double wave = 0.0;
@@ -77,7 +140,7 @@ double OscillatorVoice::renderSample(int64_t frame)
         wave = std::sin(2.0 * kPi * phase_);
         break;
     case Waveform::Square: {
-        const double edge = 0.02;
+        const double edge = kSquareEdge;
         if (phase_ < edge)
             wave = phase_ / edge;
         else if (phase_ < 0.5 - edge)
@@ -97,36 +160,18 @@ double OscillatorVoice::renderSample(int64_t frame)
         wave = 2.0 * phase_ - 1.0;
         break;
     case Waveform::Noise:
-        noiseSeed_ ^= noiseSeed_ << 13;
-        noiseSeed_ ^= noiseSeed_ >> 17;
-        noiseSeed_ ^= noiseSeed_ << 5;
-        wave = static_cast<double>(noiseSeed_) /
-                   static_cast<double>(0xFFFFFFFFu) *
-                   2.0 -
-               1.0;
+        wave = nextNoise();
         break;
     }
 
     // --- Advance phase (with pitch env + LFO pitch mod) ---------------
-    double effFreq = freqHz_;
-    if (patch_.pitchTime > 0.0) {
-        const double p = std::min(t / patch_.pitchTime, 1.0);
-        const double semis =
-            patch_.pitchStart + (patch_.pitchEnd - patch_.pitchStart) * p;
-        effFreq *= std::pow(2.0, semis / 12.0);
-    }
-    if (patch_.lfoRate > 0.0 && patch_.lfoDepth > 0.0 && patch_.lfoTarget == 1) {
-        const double lfo = std::sin(2.0 * kPi * t * patch_.lfoRate);
-        effFreq *= std::pow(2.0, lfo * patch_.lfoDepth / 12.0);
-    }
-
-    phase_ += effFreq / static_cast<double>(sampleRate_);
+    phase_ += phaseIncrementAt(t);
     if (phase_ >= 1.0) phase_ -= 1.0;
 
     return wave * env * gain_;
 }
 
-void OscillatorVoice::render(float* buffer, int frames, int64_t bufferStartFrame)
+void OscillatorVoice::renderReference(float* buffer, int frames, int64_t bufferStartFrame)
 {
     const int64_t bufEnd = bufferStartFrame + frames;
     const int64_t lo     = std::max(startFrame_, bufferStartFrame);
@@ -137,4 +182,117 @@ void OscillatorVoice::render(float* buffer, int frames, int64_t bufferStartFrame
     }
 }
 
+int64_t OscillatorVoice::nextEnvelopeCorner(int64_t frame) const
+{
+    const double duration = static_cast<double>(endFrame_ - startFrame_) / sampleRate_;
+    const double corners[] = { patch_.attack, patch_.attack + patch_.decay,
+                               duration - patch_.release };
+    int64_t next = endFrame_;
+    for (double c : corners) {
+        // First frame whose time is >= the corner, i.e. the first frame
+        // renderSample() would put on the next envelope stage.
+        const int64_t f = startFrame_ + static_cast<int64_t>(std::ceil(c * sampleRate_));
+        if (f > frame && f < next) next = f;
+    }
+    return next;
+}
+
+void OscillatorVoice::render(float* buffer, int frames, int64_t bufferStartFrame)
+{
+    const int64_t bufEnd = bufferStartFrame + frames;
+    const int64_t lo     = std::max(startFrame_, bufferStartFrame);
+    const int64_t hi     = std::min(endFrame_, bufEnd);
+    int64_t f = lo;
+    while (f < hi) {
+        // Segment grid is anchored at the note start, so control points
+        // do not move with the host's buffer size.
+        int64_t end = startFrame_
+                      + ((f - startFrame_) / kControlFrames + 1) * kControlFrames;
+        end = std::min({ end, hi, nextEnvelopeCorner(f) });
+        renderSegment(buffer + (f - bufferStartFrame), static_cast<int>(end - f), f);
+        f = end;
+    }
+}
+
+void OscillatorVoice::renderSegment(float* buffer, int n, int64_t frame)
+{
+    const double sr = static_cast<double>(sampleRate_);
+    const double t0 = static_cast<double>(frame - startFrame_) / sr;
+    const double t1 = static_cast<double>(frame + n - startFrame_) / sr;
+
+    // Control values at both segment ends. Within a segment the envelope
+    // is one linear ADSR stage, so its ramp is exact.
+    double envSlope = 0.0;
+    const double env0 = envelopeAt(t0, &envSlope);
+    const double vol0 = volumeLfoAt(t0);
+    const double vol1 = volumeLfoAt(t1);
+    const double inc0 = phaseIncrementAt(t0);
+    const double incStep = (phaseIncrementAt(t1) - inc0) / n;
+
+    // Phase before sample i is phase_ + sum of the i preceding
+    // (linearly ramped) increments. Offsets stay small, so float keeps
+    // them precise; the running phase itself stays in double.
+    const float p0 = static_cast<float>(phase_);
+    const float fInc = static_cast<float>(inc0);
+    const float fStep = static_cast<float>(incStep);
+    const float a0 = static_cast<float>(env0 * gain_);
+    const float aStep = static_cast<float>(envSlope / sr * gain_);
+    const float v0 = static_cast<float>(vol0);
+    const float vStep = static_cast<float>((vol1 - vol0) / n);
+
+    float ph[kControlFrames];
+    float amp[kControlFrames];
+    float wave[kControlFrames];
+    for (int i = 0; i < n; ++i) {
+        const float fi = static_cast<float>(i);
+        const float x = p0 + fi * fInc + 0.5f * fStep * fi * (fi - 1.0f);
+        ph[i] = x - static_cast<float>(static_cast<int>(x));   // x >= 0
+        amp[i] = (a0 + aStep * fi) * (v0 + vStep * fi);
+    }
+
+    switch (patch_.waveform) {
+    case Waveform::Sine:
+        for (int i = 0; i < n; ++i) wave[i] = sineOfCycle(ph[i]);
+        break;
+    case Waveform::Square: {
+        // The trapezoid equals a triangle (0 at phase 0, peak at 0.25)
+        // steepened to the edge slope and clipped.
+        const float gainToEdge = static_cast<float>(0.25 / kSquareEdge);
+        for (int i = 0; i < n; ++i) {
+            float y = ph[i] + 0.75f;
+            y -= (y >= 1.0f) ? 1.0f : 0.0f;
+            const float tri = 4.0f * std::abs(y - 0.5f) - 1.0f;
+            wave[i] = std::clamp(tri * gainToEdge, -1.0f, 1.0f);
+        }
+        break;
+    }
+    case Waveform::Triangle:
+        for (int i = 0; i < n; ++i) wave[i] = 4.0f * std::abs(ph[i] - 0.5f) - 1.0f;
+        break;
+    case Waveform::Sawtooth:
+        // PolyBLEP: the naive ramp minus a two-sample polynomial residual
+        // around the wrap, which removes most of the aliasing.
+        for (int i = 0; i < n; ++i) {
+            const float p = ph[i];
+            const float dt = std::max(fInc + fStep * static_cast<float>(i), 1e-9f);
+            const float a = p / dt;
+            const float b = (p - 1.0f) / dt;
+            const float blep = (p < dt)         ? (2.0f * a - a * a - 1.0f)
+                             : (p > 1.0f - dt) ? (b * b + 2.0f * b + 1.0f)
+                                                : 0.0f;
+            wave[i] = 2.0f * p - 1.0f - blep;
+        }
+        break;
+    case Waveform::Noise:
+        for (int i = 0; i < n; ++i) wave[i] = static_cast<float>(nextNoise());
+        break;
+    }
+
+    for (int i = 0; i < n; ++i) buffer[i] += wave[i] * amp[i];
+    level_ = std::abs(amp[n - 1]);
+
+    phase_ += inc0 * n + 0.5 * incStep * n * (n - 1.0);
+    phase_ -= std::floor(phase_);
+}
+
 } // namespace clay::sound
@@ -4,9 +4,16 @@
 // envelope + LFO + pitch-envelope DSP lifted out of SoftSynth.
 //
 // The voice is patch-configurable; a sibling OscillatorInstrument owns
-// the patches and stamps them onto voices at createVoice() time. For
+// the patches and stamps them onto voices at acquireVoice() time. For
 // legacy callers (existing SoftSynth) the patch may also be set
 // directly via setPatch() before onNoteOn().
+//
+// render() works in control segments of at most kControlFrames samples:
+// envelope, pitch envelope and LFOs are evaluated once per segment and
+// ramped linearly across it, then the oscillator runs over the segment
+// as a branch-free float loop the compiler can vectorise. Segments never
+// straddle an ADSR corner, so the (piecewise-linear) envelope is exact;
+// only the LFOs and the exponential pitch sweep are approximated.
 
 #pragma once
 
@@ -47,9 +54,24 @@ public:
     void onNoteOff(int64_t atFrame) override;
     void render(float* buffer, int frames, int64_t bufferStartFrame) override;
     bool isFinished(int64_t currentFrame) const override;
+    float level() const override { return level_; }
+
+    // The original per-sample, double-precision renderer. Not used for
+    // playback; kept as the accuracy reference render() is tested
+    // against. Same contract as render(), shares the voice's state.
+    void renderReference(float* buffer, int frames, int64_t bufferStartFrame);
+
+    // Upper bound of a control segment, in samples.
+    static constexpr int kControlFrames = 32;
 
 private:
     double renderSample(int64_t frame);
+    double nextNoise();
+    double envelopeAt(double t, double* slopePerSecond) const;
+    double volumeLfoAt(double t) const;
+    double phaseIncrementAt(double t) const;
+    int64_t nextEnvelopeCorner(int64_t frame) const;
+    void renderSegment(float* buffer, int n, int64_t frame);
 
     Patch    patch_{};
     int      sampleRate_   = 44100;
@@ -59,6 +81,7 @@ private:
     double   gain_         = 1.0;        // velocity at onNoteOn
     double   phase_        = 0.0;        // 0..1
     uint32_t noiseSeed_    = 12345;
+    float    level_        = 0.0f;       // |amplitude| at the last rendered sample
 };
 
 } // namespace clay::sound
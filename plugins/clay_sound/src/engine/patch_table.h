@@ -0,0 +1,118 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// PatchTable — fixed-capacity map from EventId to a per-event patch,
+// the queue behind the instruments' pushPatch(). pushPatch() runs on
+// the render thread (AudioOutput::schedule carries the patch there), so
+// the table is sized once at construction, like VoicePool, and never
+// allocates afterwards.
+//
+// Open addressing with linear probing; EventId 0 is never issued by the
+// scheduler and marks an empty slot. put() refuses once kMaxEntries
+// patches are queued and the note then plays the default patch.
+
+#pragma once
+
+#include "scheduler.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace clay::sound {
+
+template <typename Patch>
+class PatchTable
+{
+public:
+    static constexpr size_t kSlots = 512;                 // power of two
+    static constexpr size_t kMaxEntries = kSlots * 3 / 4; // keeps probes short
+
+    PatchTable() : slots_(kSlots) {}
+
+    PatchTable(const PatchTable&) = delete;
+    PatchTable& operator=(const PatchTable&) = delete;
+
+    // Queues or replaces the patch for `id`. False when the table is full.
+    bool put(EventId id, const Patch& patch)
+    {
+        if (id == 0) return false;
+        size_t i = home(id);
+        for (; slots_[i].id != 0; i = next(i)) {
+            if (slots_[i].id == id) {
+                slots_[i].patch = patch;
+                return true;
+            }
+        }
+        if (size_ >= kMaxEntries) return false;
+        slots_[i].id = id;
+        slots_[i].patch = patch;
+        ++size_;
+        return true;
+    }
+
+    // Moves the patch for `id` into `out` and removes it.
+    bool take(EventId id, Patch& out)
+    {
+        const size_t i = find(id);
+        if (i == kSlots) return false;
+        out = slots_[i].patch;
+        removeAt(i);
+        return true;
+    }
+
+    void erase(EventId id)
+    {
+        const size_t i = find(id);
+        if (i != kSlots) removeAt(i);
+    }
+
+    void clear()
+    {
+        for (Slot& s : slots_) s.id = 0;
+        size_ = 0;
+    }
+
+    size_t size() const { return size_; }
+
+private:
+    struct Slot
+    {
+        EventId id = 0;
+        Patch patch{};
+    };
+
+    static size_t home(EventId id)
+    {
+        return static_cast<size_t>((static_cast<uint64_t>(id) * 0x9E3779B97F4A7C15ull) >> 32)
+               & (kSlots - 1);
+    }
+    static size_t next(size_t i) { return (i + 1) & (kSlots - 1); }
+
+    size_t find(EventId id) const
+    {
+        if (id == 0) return kSlots;
+        for (size_t i = home(id); slots_[i].id != 0; i = next(i))
+            if (slots_[i].id == id) return i;
+        return kSlots;
+    }
+
+    // Backward-shift deletion: pull later entries of the probe run into
+    // the hole so lookups never need tombstones.
+    void removeAt(size_t hole)
+    {
+        for (size_t i = next(hole); slots_[i].id != 0; i = next(i)) {
+            const size_t h = home(slots_[i].id);
+            // Move the entry unless its home lies cyclically in (hole, i].
+            const bool stays = hole < i ? (h > hole && h <= i) : (h > hole || h <= i);
+            if (stays) continue;
+            slots_[hole] = slots_[i];
+            hole = i;
+        }
+        slots_[hole].id = 0;
+        --size_;
+    }
+
+    std::vector<Slot> slots_;
+    size_t size_ = 0;
+};
+
+} // namespace clay::sound
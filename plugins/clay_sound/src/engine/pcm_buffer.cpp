@@ -11,26 +11,8 @@
 
 namespace clay::sound {
 
-PcmBuffer PcmBuffer::fromFloats(std::vector<float> mono, int sampleRate)
-{
-    PcmBuffer b;
-    b.samples = std::move(mono);
-    b.sampleRate = sampleRate;
-    return b;
-}
-
 namespace {
 
-struct FmtChunk
-{
-    uint16_t audioFormat = 0;   // 1 = PCM, 3 = IEEE float
-    uint16_t channels    = 0;
-    uint32_t sampleRate  = 0;
-    uint32_t byteRate    = 0;
-    uint16_t blockAlign  = 0;
-    uint16_t bitsPerSample = 0;
-};
-
 static uint32_t read_u32(const uint8_t* p) { return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24); }
 static uint16_t read_u16(const uint8_t* p) { return static_cast<uint16_t>(p[0]) | (static_cast<uint16_t>(p[1]) << 8); }
 static int16_t  read_i16(const uint8_t* p) { return static_cast<int16_t>(read_u16(p)); }
@@ -48,40 +30,53 @@ static bool setError(std::string* err, const char* msg)
     return false;
 }
 
-} // namespace
+// Bytes read up front when opening a stream; the header of any WAV we
+// write or ship fits well within this.
+constexpr size_t kHeaderProbeBytes = 64 * 1024;
 
-std::optional<PcmBuffer> PcmBuffer::loadWav(const std::string& path, std::string* error)
+struct File
 {
-    std::FILE* f = std::fopen(path.c_str(), "rb");
-    if (!f) { setError(error, "open failed"); return std::nullopt; }
+    std::FILE* f = nullptr;
+    explicit File(const std::string& path) : f(std::fopen(path.c_str(), "rb")) {}
+    ~File() { if (f) std::fclose(f); }
+    File(const File&) = delete;
+    File& operator=(const File&) = delete;
+
+    uint64_t size() const
+    {
+        std::fseek(f, 0, SEEK_END);
+        const long n = std::ftell(f);
+        std::fseek(f, 0, SEEK_SET);
+        return n > 0 ? static_cast<uint64_t>(n) : 0;
+    }
+};
 
-    std::fseek(f, 0, SEEK_END);
-    long fileSize = std::ftell(f);
-    std::fseek(f, 0, SEEK_SET);
-    if (fileSize < 44) { std::fclose(f); setError(error, "file too small"); return std::nullopt; }
+} // namespace
 
-    std::vector<uint8_t> data(static_cast<size_t>(fileSize));
-    if (std::fread(data.data(), 1, data.size(), f) != data.size()) {
-        std::fclose(f); setError(error, "read failed"); return std::nullopt;
-    }
-    std::fclose(f);
+int16_t PcmBuffer::quantize(float v)
+{
+    const long q = std::lround(static_cast<double>(v) * 32768.0);
+    return static_cast<int16_t>(std::clamp(q, -32768L, 32767L));
+}
 
-    return PcmBuffer::loadWavFromBytes(data.data(), data.size(), error);
+PcmBuffer PcmBuffer::fromFloats(const std::vector<float>& mono, int sampleRate)
+{
+    PcmBuffer b;
+    b.samples.resize(mono.size());
+    std::transform(mono.begin(), mono.end(), b.samples.begin(), &PcmBuffer::quantize);
+    b.sampleRate = sampleRate;
+    return b;
 }
 
-std::optional<PcmBuffer> PcmBuffer::loadWavFromBytes(const std::uint8_t* data,
-                                                    std::size_t size,
-                                                    std::string* error)
+bool WavFormat::parse(const uint8_t* data, size_t size, uint64_t fileSize, std::string* error)
 {
-    if (size < 44) { setError(error, "buffer too small"); return std::nullopt; }
+    *this = WavFormat{};
+    if (size < 44) return setError(error, "buffer too small");
     const uint8_t* p = data;
-    if (std::memcmp(p, "RIFF", 4) != 0) { setError(error, "not RIFF"); return std::nullopt; }
-    if (std::memcmp(p + 8, "WAVE", 4) != 0) { setError(error, "not WAVE"); return std::nullopt; }
-
-    FmtChunk fmt;
-    const uint8_t* dataPtr = nullptr;
-    uint32_t dataBytes = 0;
+    if (std::memcmp(p, "RIFF", 4) != 0) return setError(error, "not RIFF");
+    if (std::memcmp(p + 8, "WAVE", 4) != 0) return setError(error, "not WAVE");
 
+    bool haveData = false;
     size_t pos = 12;
     while (pos + 8 <= size) {
         const uint8_t* chunk = p + pos;
@@ -89,66 +84,122 @@ std::optional<PcmBuffer> PcmBuffer::loadWavFromBytes(const std::uint8_t* data,
         const uint32_t sz = read_u32(chunk + 4);
         const uint8_t* body = chunk + 8;
         if (std::memcmp(id, "fmt ", 4) == 0) {
-            if (sz < 16) { setError(error, "fmt too small"); return std::nullopt; }
-            fmt.audioFormat   = read_u16(body + 0);
-            fmt.channels      = read_u16(body + 2);
-            fmt.sampleRate    = read_u32(body + 4);
-            fmt.byteRate      = read_u32(body + 8);
-            fmt.blockAlign    = read_u16(body + 12);
-            fmt.bitsPerSample = read_u16(body + 14);
+            if (sz < 16 || pos + 8 + 16 > size) return setError(error, "fmt too small");
+            audioFormat   = read_u16(body + 0);
+            channels      = read_u16(body + 2);
+            sampleRate    = read_u32(body + 4);
+            bitsPerSample = read_u16(body + 14);
         } else if (std::memcmp(id, "data", 4) == 0) {
-            dataPtr = body;
-            dataBytes = sz;
+            haveData   = true;
+            dataOffset = pos + 8;
+            dataBytes  = std::min<uint64_t>(sz, fileSize > dataOffset ? fileSize - dataOffset : 0);
+            if (channels != 0) break;  // the rest may not have been read
         }
-        pos += 8 + sz + (sz & 1); // chunks padded to even size
+        pos += 8 + static_cast<size_t>(sz) + (sz & 1); // chunks padded to even size
     }
 
-    if (!dataPtr) { setError(error, "no data chunk"); return std::nullopt; }
-    if (fmt.channels == 0) { setError(error, "no fmt chunk"); return std::nullopt; }
+    if (!haveData) return setError(error, "no data chunk");
+    if (channels == 0) return setError(error, "no fmt chunk");
+    if (frameBytes() == 0) return setError(error, "bad block align");
 
-    const int channels = fmt.channels;
-    const int bps      = fmt.bitsPerSample;
-    const int fmtCode  = fmt.audioFormat;
+    const int bps = bitsPerSample;
+    const bool formatOk =
+        (audioFormat == 3 && bps == 32) ||
+        (audioFormat == 1 && (bps == 8 || bps == 16 || bps == 24 || bps == 32));
+    if (!formatOk) return setError(error, "unsupported PCM format");
+    return true;
+}
 
-    const int bytesPerSample = bps / 8;
-    const size_t frameBytes  = static_cast<size_t>(bytesPerSample) * channels;
-    if (frameBytes == 0) { setError(error, "bad block align"); return std::nullopt; }
-    const size_t frameCount  = dataBytes / frameBytes;
+void WavFormat::decode(const uint8_t* src, size_t frames, int16_t* out) const
+{
+    const int bps = bitsPerSample;
+    const size_t bytesPerSample = static_cast<size_t>(bps / 8);
+    const size_t fb = frameBytes();
 
-    std::vector<float> mono;
-    mono.reserve(frameCount);
+    if (audioFormat == 1 && bps == 16 && channels == 1) {
+        for (size_t i = 0; i < frames; ++i) out[i] = read_i16(src + 2 * i);
+        return;
+    }
 
     auto decodeSample = [&](const uint8_t* sp) -> float {
-        if (fmtCode == 3 && bps == 32)     return read_f32(sp);
-        if (fmtCode == 1 && bps == 16)     return static_cast<float>(read_i16(sp)) / 32768.0f;
-        if (fmtCode == 1 && bps == 24)     return static_cast<float>(read_i24(sp)) / 8388608.0f;
-        if (fmtCode == 1 && bps == 32)     return static_cast<float>(read_i32(sp)) / 2147483648.0f;
-        if (fmtCode == 1 && bps == 8) {
-            // unsigned 8-bit PCM, centered at 128
-            return (static_cast<float>(sp[0]) - 128.0f) / 128.0f;
-        }
-        return 0.0f;
+        if (audioFormat == 3)  return read_f32(sp);
+        if (bps == 16)         return static_cast<float>(read_i16(sp)) / 32768.0f;
+        if (bps == 24)         return static_cast<float>(read_i24(sp)) / 8388608.0f;
+        if (bps == 32)         return static_cast<float>(read_i32(sp)) / 2147483648.0f;
+        // unsigned 8-bit PCM, centered at 128
+        return (static_cast<float>(sp[0]) - 128.0f) / 128.0f;
     };
 
-    const bool formatOk =
-        (fmtCode == 3 && bps == 32) ||
-        (fmtCode == 1 && (bps == 8 || bps == 16 || bps == 24 || bps == 32));
-    if (!formatOk) {
-        setError(error, "unsupported PCM format");
-        return std::nullopt;
-    }
-
-    for (size_t i = 0; i < frameCount; ++i) {
-        const uint8_t* framePtr = dataPtr + i * frameBytes;
+    for (size_t i = 0; i < frames; ++i) {
+        const uint8_t* framePtr = src + i * fb;
         float sum = 0.0f;
         for (int c = 0; c < channels; ++c)
             sum += decodeSample(framePtr + static_cast<size_t>(c) * bytesPerSample);
-        mono.push_back(sum / static_cast<float>(channels));
+        out[i] = PcmBuffer::quantize(sum / static_cast<float>(channels));
+    }
+}
+
+std::optional<PcmBuffer> PcmBuffer::loadWav(const std::string& path, std::string* error)
+{
+    File file(path);
+    if (!file.f) { setError(error, "open failed"); return std::nullopt; }
+
+    const uint64_t fileSize = file.size();
+    if (fileSize < 44) { setError(error, "file too small"); return std::nullopt; }
+
+    std::vector<uint8_t> data(static_cast<size_t>(fileSize));
+    if (std::fread(data.data(), 1, data.size(), file.f) != data.size()) {
+        setError(error, "read failed");
+        return std::nullopt;
+    }
+
+    return PcmBuffer::loadWavFromBytes(data.data(), data.size(), error);
+}
+
+std::optional<PcmBuffer> PcmBuffer::loadWavFromBytes(const std::uint8_t* data,
+                                                    std::size_t size,
+                                                    std::string* error)
+{
+    WavFormat fmt;
+    if (!fmt.parse(data, size, size, error)) return std::nullopt;
+
+    PcmBuffer out;
+    out.samples.resize(static_cast<size_t>(fmt.frames()));
+    fmt.decode(data + fmt.dataOffset, out.samples.size(), out.samples.data());
+    out.sampleRate = static_cast<int>(fmt.sampleRate);
+    return out;
+}
+
+std::optional<PcmBuffer> PcmBuffer::openWavStream(const std::string& path,
+                                                  size_t headFrames,
+                                                  std::string* error)
+{
+    File file(path);
+    if (!file.f) { setError(error, "open failed"); return std::nullopt; }
+    const uint64_t fileSize = file.size();
+
+    std::vector<uint8_t> probe(static_cast<size_t>(std::min<uint64_t>(fileSize, kHeaderProbeBytes)));
+    if (std::fread(probe.data(), 1, probe.size(), file.f) != probe.size()) {
+        setError(error, "read failed");
+        return std::nullopt;
+    }
+
+    WavFormat fmt;
+    if (!fmt.parse(probe.data(), probe.size(), fileSize, error)) return std::nullopt;
+
+    const size_t head = std::min(headFrames, static_cast<size_t>(fmt.frames()));
+    std::vector<uint8_t> raw(head * fmt.frameBytes());
+    if (std::fseek(file.f, static_cast<long>(fmt.dataOffset), SEEK_SET) != 0
+        || std::fread(raw.data(), 1, raw.size(), file.f) != raw.size()) {
+        setError(error, "read failed");
+        return std::nullopt;
     }
 
     PcmBuffer out;
-    out.samples = std::move(mono);
+    out.samples.resize(head);
+    fmt.decode(raw.data(), head, out.samples.data());
     out.sampleRate = static_cast<int>(fmt.sampleRate);
+    out.stream = Stream{path, fmt};
     return out;
 }
 
@@ -176,6 +227,7 @@ static void write_u16_le(std::FILE *f, uint16_t v)
 bool PcmBuffer::saveWav(const std::string& path, std::string* error) const
 {
     if (sampleRate <= 0) return setError(error, "invalid sample rate");
+    if (streamed()) return setError(error, "streamed buffer");
     if (samples.empty()) return setError(error, "empty buffer");
 
     std::FILE* f = std::fopen(path.c_str(), "wb");
@@ -203,9 +255,7 @@ bool PcmBuffer::saveWav(const std::string& path, std::string* error) const
     std::fwrite("data", 1, 4, f);
     write_u32_le(f, dataBytes);
 
-    for (float s : samples) {
-        const int q = static_cast<int>(std::lround(std::clamp(s, -1.0f, 1.0f) * 32767.0f));
-        const int16_t v = static_cast<int16_t>(std::clamp(q, -32768, 32767));
+    for (int16_t v : samples) {
         uint8_t b[2] = { static_cast<uint8_t>(v & 0xff),
                          static_cast<uint8_t>((v >> 8) & 0xff) };
         std::fwrite(b, 1, 2, f);
@@ -1,8 +1,15 @@
 // (c) Clayground Contributors - MIT License, see "LICENSE" file
 //
-// PcmBuffer — mono float PCM held in memory, plus a minimal WAV loader
+// PcmBuffer — mono PCM held in memory as int16, plus a minimal WAV loader
 // covering the formats we actually see for game SFX: 8/16/24/32-bit
 // signed PCM and 32-bit float, 1..N channels (downmixed to mono on load).
+// Voices convert to float as they read, which halves the footprint of
+// a float buffer; full scale is 32768.
+//
+// A buffer can also describe a WAV file that is streamed from disk
+// (see PcmStreamer): then `samples` only holds the first frames of the
+// file, so a voice can start playing before the stream has caught up,
+// and frames() is the length of the whole file.
 
 #pragma once
 
@@ -14,13 +21,60 @@
 
 namespace clay::sound {
 
+// Layout of a WAV file's sample data.
+struct WavFormat
+{
+    uint16_t audioFormat   = 0;   // 1 = PCM, 3 = IEEE float
+    uint16_t channels      = 0;
+    uint32_t sampleRate    = 0;
+    uint16_t bitsPerSample = 0;
+    uint64_t dataOffset    = 0;   // byte offset of the data chunk body
+    uint64_t dataBytes     = 0;   // clamped to what the file holds
+
+    size_t frameBytes() const { return static_cast<size_t>(bitsPerSample / 8) * channels; }
+    int64_t frames() const
+    {
+        const size_t fb = frameBytes();
+        return fb ? static_cast<int64_t>(dataBytes / fb) : 0;
+    }
+
+    // Parse the RIFF header at the start of a file. `size` is the number
+    // of bytes available at `data`, `fileSize` the length of the whole
+    // file (which may be larger when only its head was read). Returns
+    // false with `error` set for files we cannot decode.
+    bool parse(const uint8_t* data, size_t size, uint64_t fileSize,
+               std::string* error = nullptr);
+
+    // Downmix `frames` frames in this layout to mono int16.
+    void decode(const uint8_t* src, size_t frames, int16_t* out) const;
+};
+
 struct PcmBuffer
 {
-    std::vector<float> samples;   // mono float, range ~[-1,1]
+    static constexpr float kScale = 1.0f / 32768.0f;
+
+    std::vector<int16_t> samples;   // mono; the head of the file when streamed
     int sampleRate = 0;
 
-    bool empty() const { return samples.empty(); }
-    size_t frames() const { return samples.size(); }
+    // Set for buffers played from disk through a PcmStreamer.
+    struct Stream
+    {
+        std::string path;
+        WavFormat   format;
+    };
+    std::optional<Stream> stream;
+
+    bool streamed() const { return stream.has_value(); }
+    bool empty() const { return frames() == 0; }
+    size_t frames() const
+    {
+        return stream ? static_cast<size_t>(stream->format.frames()) : samples.size();
+    }
+    // Bytes held in memory.
+    size_t residentBytes() const { return samples.size() * sizeof(int16_t); }
+    float sample(size_t i) const { return samples[i] * kScale; }
+
+    static int16_t quantize(float v);
 
     // Load a WAV file into a PcmBuffer. Returns nullopt on I/O or
     // format errors; `error` (if non-null) is populated with a short
@@ -35,11 +89,18 @@ struct PcmBuffer
                                                      std::size_t size,
                                                      std::string* error = nullptr);
 
+    // Open a WAV file for streaming: parses its header and decodes only
+    // the first `headFrames` frames. Same return semantics as loadWav().
+    static std::optional<PcmBuffer> openWavStream(const std::string& path,
+                                                  size_t headFrames,
+                                                  std::string* error = nullptr);
+
     // Construct in-memory (for tests and synth-to-sample baking).
-    static PcmBuffer fromFloats(std::vector<float> mono, int sampleRate);
+    static PcmBuffer fromFloats(const std::vector<float>& mono, int sampleRate);
 
     // Write this buffer to a 16-bit signed PCM mono WAV file. Returns
     // true on success; `error` (if non-null) carries the failure reason.
+    // Streamed buffers cannot be saved.
     bool saveWav(const std::string& path, std::string* error = nullptr) const;
 };
 
@@ -0,0 +1,208 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "pcm_cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <vector>
+
+namespace clay::sound {
+
+namespace {
+
+// Bytes hashed at each end of a streamed file (see acquireFile()).
+constexpr size_t kStreamProbeBytes = 64 * 1024;
+
+bool setError(std::string* err, const char* msg)
+{
+    if (err) *err = msg;
+    return false;
+}
+
+// Read `size` bytes at `offset` into `out`.
+bool readAt(std::FILE* f, uint64_t offset, size_t size, std::vector<uint8_t>& out)
+{
+    out.resize(size);
+    return std::fseek(f, static_cast<long>(offset), SEEK_SET) == 0
+        && std::fread(out.data(), 1, size, f) == size;
+}
+
+double msSince(std::chrono::steady_clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+}
+
+} // namespace
+
+PcmCache& PcmCache::instance()
+{
+    static PcmCache cache;
+    return cache;
+}
+
+uint64_t PcmCache::hash(const uint8_t* data, size_t size, uint64_t seed)
+{
+    uint64_t h = seed;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= data[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+std::shared_ptr<const PcmBuffer> PcmCache::acquireFile(const std::string& path,
+                                                       const Options& options,
+                                                       std::string* error)
+{
+    const auto t0 = std::chrono::steady_clock::now();
+
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) { setError(error, "open failed"); return nullptr; }
+    std::fseek(f, 0, SEEK_END);
+    const long end = std::ftell(f);
+    const uint64_t fileSize = end > 0 ? static_cast<uint64_t>(end) : 0;
+
+    // The header decides whether the file is streamed.
+    std::vector<uint8_t> head;
+    WavFormat fmt;
+    if (!readAt(f, 0, static_cast<size_t>(std::min<uint64_t>(fileSize, kStreamProbeBytes)), head)
+        || !fmt.parse(head.data(), head.size(), fileSize, error)) {
+        std::fclose(f);
+        if (error && error->empty()) *error = "read failed";
+        return nullptr;
+    }
+    const bool stream = options.streamAboveSeconds > 0.0
+        && fmt.frames() > options.streamAboveSeconds * fmt.sampleRate;
+
+    if (stream) {
+        std::vector<uint8_t> tail;
+        const size_t tailBytes = static_cast<size_t>(std::min<uint64_t>(fileSize, kStreamProbeBytes));
+        const bool ok = readAt(f, fileSize - tailBytes, tailBytes, tail);
+        std::fclose(f);
+        if (!ok) { setError(error, "read failed"); return nullptr; }
+
+        uint64_t h = hash(head.data(), head.size());
+        h = hash(tail.data(), tail.size(), h);
+        h = hash(reinterpret_cast<const uint8_t*>(&fileSize), sizeof(fileSize), h);
+        // The probe only validates this path's entry: another file of the
+        // same length can share head and tail (silent padding) and differ
+        // in between.
+        const std::string key = path + "#stream";
+        if (auto hit = lookup(key, h, false)) return hit;
+
+        auto buf = PcmBuffer::openWavStream(path, options.streamHeadFrames, error);
+        if (!buf) return nullptr;
+        return insert(key, h, std::make_shared<const PcmBuffer>(std::move(*buf)), msSince(t0),
+                      false);
+    }
+
+    std::vector<uint8_t> bytes;
+    const bool ok = readAt(f, 0, static_cast<size_t>(fileSize), bytes);
+    std::fclose(f);
+    if (!ok) { setError(error, "read failed"); return nullptr; }
+
+    const uint64_t h = hash(bytes.data(), bytes.size());
+    if (auto hit = lookup(path, h, true)) return hit;
+    auto buf = PcmBuffer::loadWavFromBytes(bytes.data(), bytes.size(), error);
+    if (!buf) return nullptr;
+    return insert(path, h, std::make_shared<const PcmBuffer>(std::move(*buf)), msSince(t0),
+                  true);
+}
+
+std::shared_ptr<const PcmBuffer> PcmCache::acquireBytes(const std::string& key,
+                                                        const uint8_t* data, size_t size,
+                                                        std::string* error)
+{
+    const auto t0 = std::chrono::steady_clock::now();
+    const uint64_t h = hash(data, size);
+    if (auto hit = lookup(key, h, true)) return hit;
+    auto buf = PcmBuffer::loadWavFromBytes(data, size, error);
+    if (!buf) return nullptr;
+    return insert(key, h, std::make_shared<const PcmBuffer>(std::move(*buf)), msSince(t0),
+                  true);
+}
+
+std::shared_ptr<const PcmBuffer> PcmCache::lookup(const std::string& key, uint64_t contentHash,
+                                                  bool shareContent)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    std::shared_ptr<const PcmBuffer> buf;
+    auto it = byKey_.find(key);
+    if (it != byKey_.end() && it->second.contentHash == contentHash)
+        buf = it->second.buffer.lock();
+    if (!buf && shareContent) {
+        auto c = byContent_.find(contentHash);
+        if (c != byContent_.end()) buf = c->second.lock();
+        if (buf) byKey_[key] = Entry{contentHash, buf};
+    }
+    if (buf) ++hits_;
+    return buf;
+}
+
+std::shared_ptr<const PcmBuffer> PcmCache::insert(const std::string& key, uint64_t contentHash,
+                                                  std::shared_ptr<const PcmBuffer> buffer,
+                                                  double loadMs, bool shareContent)
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    ++misses_;
+    lastLoadMs_ = loadMs;
+    maxLoadMs_ = std::max(maxLoadMs_, loadMs);
+
+    // Forget entries whose buffers are gone.
+    for (auto it = byKey_.begin(); it != byKey_.end();)
+        it = it->second.buffer.expired() ? byKey_.erase(it) : std::next(it);
+    for (auto it = byContent_.begin(); it != byContent_.end();)
+        it = it->second.expired() ? byContent_.erase(it) : std::next(it);
+
+    // Another thread may have loaded the same content meanwhile; keep
+    // the first copy so there is only ever one.
+    Entry& entry = byKey_[key];
+    if (shareContent) {
+        auto& weak = byContent_[contentHash];
+        if (auto existing = weak.lock())
+            buffer = std::move(existing);
+        else
+            weak = buffer;
+    } else if (auto existing = entry.buffer.lock();
+               existing && entry.contentHash == contentHash) {
+        buffer = std::move(existing);
+    }
+    entry = Entry{contentHash, buffer};
+    return buffer;
+}
+
+PcmCache::Stats PcmCache::stats() const
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    Stats s;
+    for (const auto& [h, weak] : byContent_) {
+        const auto buf = weak.lock();
+        if (!buf) continue;
+        ++s.entries;
+        s.residentBytes += buf->residentBytes();
+    }
+    // Streamed buffers are only listed under their "#stream" key.
+    for (const auto& [key, entry] : byKey_) {
+        const auto buf = entry.buffer.lock();
+        if (!buf || !buf->streamed()) continue;
+        ++s.entries;
+        ++s.streamed;
+        s.residentBytes += buf->residentBytes();
+    }
+    s.hits = hits_;
+    s.misses = misses_;
+    s.lastLoadMs = lastLoadMs_;
+    s.maxLoadMs = maxLoadMs_;
+    return s;
+}
+
+void PcmCache::resetStats()
+{
+    std::lock_guard<std::mutex> guard(lock_);
+    hits_ = misses_ = 0;
+    maxLoadMs_ = 0.0;
+}
+
+} // namespace clay::sound
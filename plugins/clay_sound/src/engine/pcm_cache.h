@@ -0,0 +1,101 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// PcmCache — process-wide cache of decoded PcmBuffers, so every
+// instrument playing the same file shares one copy. Entries are keyed
+// by path and validated by a hash of the file's content: an edited file
+// is decoded again, and identical content under another path is shared.
+// Buffers are refcounted through shared_ptr; the cache only holds weak
+// references, so a buffer goes away with its last instrument.
+//
+// Files longer than Options::streamAboveSeconds are not decoded, but
+// opened for streaming (PcmBuffer::openWavStream()). Their content hash
+// covers the head, tail and size only, so opening them stays cheap; it
+// can tell an edit of the same file apart but not two different files,
+// so streamed entries are found by path alone and never shared across
+// paths.
+//
+// Thread-safe; loads run outside the lock, so callers on worker threads
+// decode in parallel. Not for the render thread.
+
+#pragma once
+
+#include "pcm_buffer.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace clay::sound {
+
+class PcmCache
+{
+public:
+    static PcmCache& instance();
+
+    struct Options
+    {
+        double streamAboveSeconds = 0.0;  // 0: always decode into memory
+        size_t streamHeadFrames = 32768;  // kept in memory for streamed files
+    };
+
+    // Buffer for the WAV file at `path`, from the cache if its content
+    // is unchanged. nullptr with `error` set on failure.
+    std::shared_ptr<const PcmBuffer> acquireFile(const std::string& path,
+                                                 const Options& options,
+                                                 std::string* error = nullptr);
+
+    // Same for WAV bytes the caller already holds (resources, network
+    // fetches); `key` names them like a path. Never streamed.
+    std::shared_ptr<const PcmBuffer> acquireBytes(const std::string& key,
+                                                  const uint8_t* data, size_t size,
+                                                  std::string* error = nullptr);
+
+    struct Stats
+    {
+        int      entries = 0;           // live buffers
+        int      streamed = 0;          // of which streamed from disk
+        uint64_t residentBytes = 0;     // PCM held in memory by live buffers
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        double   lastLoadMs = 0.0;      // read + decode time of the last miss
+        double   maxLoadMs = 0.0;
+    };
+    Stats stats() const;
+    // Zero hits, misses and maxLoadMs.
+    void resetStats();
+
+    // FNV-1a over `size` bytes, chained from `seed`.
+    static uint64_t hash(const uint8_t* data, size_t size,
+                         uint64_t seed = 0xcbf29ce484222325ULL);
+
+private:
+    PcmCache() = default;
+
+    // Cached buffer for `key` with content `contentHash`, or nullptr.
+    // `shareContent` also accepts a buffer loaded under another key; only
+    // for hashes that cover every byte.
+    std::shared_ptr<const PcmBuffer> lookup(const std::string& key, uint64_t contentHash,
+                                            bool shareContent);
+    std::shared_ptr<const PcmBuffer> insert(const std::string& key, uint64_t contentHash,
+                                            std::shared_ptr<const PcmBuffer> buffer,
+                                            double loadMs, bool shareContent);
+
+    struct Entry
+    {
+        uint64_t contentHash = 0;
+        std::weak_ptr<const PcmBuffer> buffer;
+    };
+
+    mutable std::mutex lock_;
+    std::unordered_map<std::string, Entry> byKey_;
+    std::unordered_map<uint64_t, std::weak_ptr<const PcmBuffer>> byContent_;  // fully read only
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    double   lastLoadMs_ = 0.0;
+    double   maxLoadMs_ = 0.0;
+};
+
+} // namespace clay::sound
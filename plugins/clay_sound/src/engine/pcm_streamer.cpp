@@ -0,0 +1,213 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "pcm_streamer.h"
+#include "pcm_buffer.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace clay::sound {
+
+namespace {
+
+// How long the reader sleeps when no ring needed topping up. Far below
+// the ring's and the head's duration, so a fresh stream is filled long
+// before its voice runs out of head frames.
+constexpr auto kIdleWait = std::chrono::milliseconds(5);
+
+} // namespace
+
+PcmStreamer::PcmStreamer()
+{
+    for (auto& s : slots_)
+        s.ring = std::make_unique<int16_t[]>(kRingFrames);
+}
+
+PcmStreamer::~PcmStreamer()
+{
+    stop();
+    for (auto& s : slots_)
+        if (s.state.load(std::memory_order_acquire) != Free)
+            recycle(s);
+}
+
+void PcmStreamer::start()
+{
+    if (running()) return;
+    {
+        std::lock_guard<std::mutex> lock(wakeLock_);
+        quit_ = false;
+    }
+    thread_ = std::thread([this] { run(); });
+    threaded_.store(true, std::memory_order_release);
+}
+
+void PcmStreamer::stop()
+{
+    if (!running()) return;
+    {
+        std::lock_guard<std::mutex> lock(wakeLock_);
+        quit_ = true;
+    }
+    wake_.notify_all();
+    thread_.join();
+    threaded_.store(false, std::memory_order_release);
+    for (auto& s : slots_)
+        if (s.state.load(std::memory_order_acquire) == Closing)
+            recycle(s);
+}
+
+int PcmStreamer::open(const std::shared_ptr<const PcmBuffer>& source,
+                      int64_t first, int64_t loopStart, int64_t loopEnd)
+{
+    if (!source || !source->streamed()) return -1;
+    for (int i = 0; i < kSlots; ++i) {
+        Slot& s = slots_[static_cast<size_t>(i)];
+        int expected = Free;
+        if (!s.state.compare_exchange_strong(expected, Claimed, std::memory_order_acquire))
+            continue;
+        const int64_t total = static_cast<int64_t>(source->frames());
+        s.source    = source;
+        s.first     = std::max<int64_t>(first, 0);
+        s.loopStart = std::clamp<int64_t>(loopStart, 0, total);
+        s.loopEnd   = std::clamp<int64_t>(loopEnd, 0, total);
+        s.next      = s.first;
+        s.state.store(Open, std::memory_order_release);
+        active_.fetch_add(1, std::memory_order_relaxed);
+        return i;
+    }
+    return -1;
+}
+
+size_t PcmStreamer::read(int slot, int16_t* out, size_t frames)
+{
+    if (slot < 0 || slot >= kSlots) return 0;
+    Slot& s = slots_[static_cast<size_t>(slot)];
+
+    if (!running()) {
+        // No reader thread: fill on the caller until the request is met.
+        while (s.head.load(std::memory_order_relaxed) - s.tail.load(std::memory_order_relaxed) < frames
+               && fill(s)) {}
+    }
+
+    const size_t tail = s.tail.load(std::memory_order_relaxed);
+    const size_t avail = s.head.load(std::memory_order_acquire) - tail;
+    const size_t n = std::min(frames, avail);
+    const size_t at = tail & (kRingFrames - 1);
+    const size_t first = std::min(n, kRingFrames - at);
+    std::copy_n(s.ring.get() + at, first, out);
+    std::copy_n(s.ring.get(), n - first, out + first);
+    s.tail.store(tail + n, std::memory_order_release);
+    return n;
+}
+
+bool PcmStreamer::ended(int slot) const
+{
+    if (slot < 0 || slot >= kSlots) return true;
+    const Slot& s = slots_[static_cast<size_t>(slot)];
+    return s.done.load(std::memory_order_acquire)
+        && s.head.load(std::memory_order_acquire) == s.tail.load(std::memory_order_relaxed);
+}
+
+void PcmStreamer::close(int slot)
+{
+    if (slot < 0 || slot >= kSlots) return;
+    Slot& s = slots_[static_cast<size_t>(slot)];
+    if (running())
+        s.state.store(Closing, std::memory_order_release);
+    else
+        recycle(s);
+}
+
+bool PcmStreamer::fill(Slot& s)
+{
+    if (s.done.load(std::memory_order_relaxed)) return false;
+    const PcmBuffer& src = *s.source;
+    const WavFormat& fmt = src.stream->format;
+
+    if (!s.file) {
+        s.file = std::fopen(src.stream->path.c_str(), "rb");
+        if (!s.file) {
+            s.done.store(true, std::memory_order_release);
+            return false;
+        }
+    }
+
+    const size_t head = s.head.load(std::memory_order_relaxed);
+    const size_t space = kRingFrames - (head - s.tail.load(std::memory_order_acquire));
+    if (space == 0) return false;
+
+    // Map the playback position onto the file, wrapping into the loop.
+    const int64_t total = fmt.frames();
+    const bool loop = s.loopEnd > s.loopStart;
+    int64_t frame = s.next;
+    if (loop && frame >= s.loopEnd)
+        frame = s.loopStart + (frame - s.loopStart) % (s.loopEnd - s.loopStart);
+    const int64_t runEnd = loop && frame < s.loopEnd ? s.loopEnd : total;
+    if (frame >= runEnd) {
+        s.done.store(true, std::memory_order_release);
+        return false;
+    }
+
+    const size_t want = static_cast<size_t>(std::min<int64_t>(
+        runEnd - frame, static_cast<int64_t>(std::min(space, kReadFrames))));
+    const size_t fb = fmt.frameBytes();
+    raw_.resize(kReadFrames * fb);
+    decoded_.resize(kReadFrames);
+
+    const long offset = static_cast<long>(fmt.dataOffset + static_cast<uint64_t>(frame) * fb);
+    size_t got = 0;
+    if (std::fseek(s.file, offset, SEEK_SET) == 0)
+        got = std::fread(raw_.data(), 1, want * fb, s.file) / fb;
+    if (got == 0) {
+        s.done.store(true, std::memory_order_release);
+        return false;
+    }
+    fmt.decode(raw_.data(), got, decoded_.data());
+
+    const size_t at = head & (kRingFrames - 1);
+    const size_t first = std::min(got, kRingFrames - at);
+    std::copy_n(decoded_.data(), first, s.ring.get() + at);
+    std::copy_n(decoded_.data() + first, got - first, s.ring.get());
+    s.head.store(head + got, std::memory_order_release);
+
+    s.next += static_cast<int64_t>(got);
+    if (!loop && s.next >= total)
+        s.done.store(true, std::memory_order_release);
+    return true;
+}
+
+void PcmStreamer::recycle(Slot& s)
+{
+    if (s.file) {
+        std::fclose(s.file);
+        s.file = nullptr;
+    }
+    s.source.reset();
+    s.head.store(0, std::memory_order_relaxed);
+    s.tail.store(0, std::memory_order_relaxed);
+    s.done.store(false, std::memory_order_relaxed);
+    s.state.store(Free, std::memory_order_release);
+    active_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void PcmStreamer::run()
+{
+    for (;;) {
+        bool busy = false;
+        for (auto& s : slots_) {
+            const int state = s.state.load(std::memory_order_acquire);
+            if (state == Open)
+                busy |= fill(s);
+            else if (state == Closing)
+                recycle(s);
+        }
+
+        std::unique_lock<std::mutex> lock(wakeLock_);
+        if (quit_) return;
+        if (!busy)
+            wake_.wait_for(lock, kIdleWait, [this] { return quit_; });
+    }
+}
+
+} // namespace clay::sound
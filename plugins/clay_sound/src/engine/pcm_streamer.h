@@ -0,0 +1,126 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// PcmStreamer — feeds SampleVoices playing a streamed PcmBuffer from
+// disk. It owns a fixed set of stream slots, each with a preallocated
+// int16 ring. A voice claims a slot at note-on, and a background reader
+// thread opens the file, decodes it to mono and keeps the ring topped
+// up. The voice pops frames from the ring on the render thread.
+//
+// Frames arrive in playback order: with a loop segment the reader wraps
+// from loopEnd back to loopStart itself, so the voice only ever reads
+// forward. The voice plays the buffer's in-memory head while the first
+// reads are in flight.
+//
+// Render-thread calls (open(), read(), close()) are lock-free and never
+// touch the file. Without start() there is no reader thread and read()
+// pulls from the file on the caller instead, which keeps offline
+// renders (tests, bakes) deterministic.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace clay::sound {
+
+struct PcmBuffer;
+
+class PcmStreamer
+{
+public:
+    static constexpr int kSlots = 32;
+    static constexpr size_t kRingFrames = size_t{1} << 16;  // ~1.5 s at 44.1 kHz
+    static constexpr size_t kReadFrames = 4096;             // per file read
+
+    PcmStreamer();
+    ~PcmStreamer();
+
+    PcmStreamer(const PcmStreamer&) = delete;
+    PcmStreamer& operator=(const PcmStreamer&) = delete;
+
+    // Start / stop the reader thread. Idempotent. Call start() before
+    // streamed buffers reach a live engine.
+    void start();
+    void stop();
+    bool running() const { return threaded_.load(std::memory_order_acquire); }
+
+    // --- render thread ---------------------------------------------------
+
+    // Claim a slot streaming `source` from playback position `first` on.
+    // loopEnd > loopStart wraps the stream there. Returns the slot, or
+    // -1 when all slots are busy (the voice then plays its head only).
+    int open(const std::shared_ptr<const PcmBuffer>& source,
+             int64_t first, int64_t loopStart, int64_t loopEnd);
+
+    // Pop up to `frames` frames; fewer when the reader has fallen behind
+    // or the stream ended.
+    size_t read(int slot, int16_t* out, size_t frames);
+
+    // True once every frame of a non-looping stream was delivered.
+    bool ended(int slot) const;
+
+    // Give the slot back. Its file is closed on the reader thread.
+    void close(int slot);
+
+    // Called by voices that had to output silence for a missing frame.
+    void noteUnderrun() { underruns_.fetch_add(1, std::memory_order_relaxed); }
+
+    // --- any thread ------------------------------------------------------
+
+    int activeStreams() const { return active_.load(std::memory_order_relaxed); }
+    uint64_t underruns() const { return underruns_.load(std::memory_order_relaxed); }
+    void resetUnderruns() { underruns_.store(0, std::memory_order_relaxed); }
+
+private:
+    enum State : int { Free, Claimed, Open, Closing };
+
+    struct Slot
+    {
+        std::atomic<int> state{Free};
+
+        // Written by open() while the slot is claimed, then read-only.
+        std::shared_ptr<const PcmBuffer> source;
+        int64_t first = 0;
+        int64_t loopStart = 0;
+        int64_t loopEnd = 0;
+
+        // Reader side.
+        std::FILE* file = nullptr;
+        int64_t next = 0;                       // next playback position to fill
+
+        // The ring: head is written by the filler, tail by the voice.
+        std::unique_ptr<int16_t[]> ring;
+        std::atomic<size_t> head{0};
+        std::atomic<size_t> tail{0};
+        std::atomic<bool> done{false};
+    };
+
+    void run();
+    // Top up one slot's ring by up to kReadFrames; returns true if it
+    // made progress.
+    bool fill(Slot& slot);
+    // Close the slot's file, drop its source and mark it Free.
+    void recycle(Slot& slot);
+
+    std::array<Slot, kSlots> slots_;
+    std::vector<uint8_t> raw_;                  // filler scratch
+    std::vector<int16_t> decoded_;
+    std::atomic<int> active_{0};
+    std::atomic<uint64_t> underruns_{0};
+
+    std::thread thread_;
+    std::atomic<bool> threaded_{false};
+    std::mutex wakeLock_;
+    std::condition_variable wake_;
+    bool quit_ = false;
+};
+
+} // namespace clay::sound
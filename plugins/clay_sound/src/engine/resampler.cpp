@@ -0,0 +1,141 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace clay::sound {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Zeroth-order modified Bessel function of the first kind, by its power
+// series; converges to double precision well within 30 terms for the
+// betas used here.
+double besselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    const double q = x * x * 0.25;
+    for (int k = 1; k < 30; ++k) {
+        term *= q / (static_cast<double>(k) * k);
+        sum += term;
+    }
+    return sum;
+}
+
+// Half of a Kaiser-windowed sinc with `zeroCrossings` lobes per side,
+// sampled at Resampler::kPhases points per unit. Padded with zeros past
+// the last lobe so stretched kernels can index it without a bounds check.
+struct SincTable
+{
+    SincTable(int zeroCrossings, double beta, double rolloff)
+        : zeroCrossings(zeroCrossings), rolloff(rolloff)
+    {
+        const int len = zeroCrossings * Resampler::kPhases;
+        values.assign(static_cast<size_t>(len + Resampler::kPhases + 2), 0.0f);
+        const double norm = besselI0(beta);
+        for (int i = 0; i <= len; ++i) {
+            const double x = static_cast<double>(i) / Resampler::kPhases;
+            const double sinc = i == 0 ? 1.0 : std::sin(kPi * x) / (kPi * x);
+            const double t = x / zeroCrossings;
+            const double w = besselI0(beta * std::sqrt(std::max(0.0, 1.0 - t * t))) / norm;
+            values[static_cast<size_t>(i)] = static_cast<float>(sinc * w);
+        }
+    }
+
+    int zeroCrossings;
+    double rolloff;   // cutoff relative to Nyquist at unity pitch
+    std::vector<float> values;
+};
+
+// Built at load time so the render thread never does.
+const SincTable kSinc8(4, 6.0, 0.84);
+const SincTable kSinc16(8, 8.0, 0.92);
+
+} // namespace
+
+void Resampler::configure(Interpolation mode, double step)
+{
+    mode_ = mode;
+    table_ = nullptr;
+    switch (mode) {
+    case Interpolation::Linear: halfWidth_ = 1; return;
+    case Interpolation::Cubic:  halfWidth_ = 2; return;
+    case Interpolation::Sinc8:
+    case Interpolation::Sinc16:
+        break;
+    }
+
+    const SincTable& t = mode == Interpolation::Sinc8 ? kSinc8 : kSinc16;
+    // Cutoff in units of the source Nyquist, rounded so the kernel steps
+    // through the table by a whole number of entries per tap.
+    const double stretch = std::clamp(step, 1.0, static_cast<double>(kMaxStretch));
+    stride_ = std::max(1, static_cast<int>(std::lround(t.rolloff / stretch * kPhases)));
+    table_ = t.values.data();
+    gain_ = static_cast<float>(stride_) / kPhases;
+    halfWidth_ = (t.zeroCrossings * kPhases + stride_ - 1) / stride_;
+}
+
+float Resampler::sincAt(const float* taps, float frac) const
+{
+    // Tap k sits at distance |k - frac| from the read position, which is
+    // table entry |k - frac| * stride_. With an integer stride all taps
+    // on one side share the same fraction between two entries, so each
+    // side is two strided dot products and one blend.
+    const float u = frac * static_cast<float>(stride_);
+    const int iu = std::min(static_cast<int>(u), stride_ - 1);
+    const float t = u - static_cast<float>(iu);
+
+    float a = 0.0f, b = 0.0f, c = 0.0f, d = 0.0f;
+    for (int m = 0, i = iu; m < halfWidth_; ++m, i += stride_) {
+        a += taps[-m] * table_[i];
+        b += taps[-m] * table_[i + 1];
+    }
+    for (int k = 1, i = stride_ - iu - 1; k <= halfWidth_; ++k, i += stride_) {
+        c += taps[k] * table_[i];
+        d += taps[k] * table_[i + 1];
+    }
+    return gain_ * (a + (b - a) * t + d + (c - d) * t);
+}
+
+void Resampler::process(const float* window, int64_t windowStart, double& pos, double step,
+                        float* out, int count) const
+{
+    switch (mode_) {
+    case Interpolation::Linear:
+        for (int i = 0; i < count; ++i) {
+            const auto i0 = static_cast<int64_t>(pos);
+            const float* t = window + (i0 - windowStart);
+            const auto frac = static_cast<float>(pos - static_cast<double>(i0));
+            out[i] = t[0] + (t[1] - t[0]) * frac;
+            pos += step;
+        }
+        break;
+    case Interpolation::Cubic:
+        for (int i = 0; i < count; ++i) {
+            const auto i0 = static_cast<int64_t>(pos);
+            const float* t = window + (i0 - windowStart);
+            const auto x = static_cast<float>(pos - static_cast<double>(i0));
+            const float c1 = 0.5f * (t[1] - t[-1]);
+            const float c2 = t[-1] - 2.5f * t[0] + 2.0f * t[1] - 0.5f * t[2];
+            const float c3 = 0.5f * (t[2] - t[-1]) + 1.5f * (t[0] - t[1]);
+            out[i] = ((c3 * x + c2) * x + c1) * x + t[0];
+            pos += step;
+        }
+        break;
+    case Interpolation::Sinc8:
+    case Interpolation::Sinc16:
+        for (int i = 0; i < count; ++i) {
+            const auto i0 = static_cast<int64_t>(pos);
+            const auto frac = static_cast<float>(pos - static_cast<double>(i0));
+            out[i] = sincAt(window + (i0 - windowStart), frac);
+            pos += step;
+        }
+        break;
+    }
+}
+
+} // namespace clay::sound
@@ -3,12 +3,35 @@
 #include "sample_voice.h"
 #include "note_event.h"
 #include "pcm_buffer.h"
+#include "pcm_streamer.h"
 
 #include <algorithm>
 #include <cmath>
+#include <utility>
 
 namespace clay::sound {
 
+SampleVoice::StreamSlot::StreamSlot(StreamSlot&& o) noexcept
+    : streamer(o.streamer), slot(std::exchange(o.slot, -1))
+{
+}
+
+SampleVoice::StreamSlot& SampleVoice::StreamSlot::operator=(StreamSlot&& o) noexcept
+{
+    if (this != &o) {
+        reset();
+        streamer = o.streamer;
+        slot = std::exchange(o.slot, -1);
+    }
+    return *this;
+}
+
+void SampleVoice::StreamSlot::reset()
+{
+    if (slot >= 0 && streamer) streamer->close(slot);
+    slot = -1;
+}
+
 void SampleVoice::setSource(std::shared_ptr<const PcmBuffer> source, int rootMidiNote)
 {
     source_ = std::move(source);
@@ -21,21 +44,45 @@ void SampleVoice::onNoteOn(const NoteEvent& ev, int sampleRate)
     startFrame_ = ev.timeFrames;
     endFrame_   = ev.timeFrames + ev.durationFrames;
     velocity_   = ev.velocity;
+    level_      = ev.velocity;
     srcPos_     = 0.0;
     exhausted_  = false;
+    winStart_   = 0;
+    winLen_     = 0;
+    stream_.reset();
 
     if (!source_ || source_->sampleRate <= 0) {
         srcStep_ = 1.0;
+        loopStart_ = loopEnd_ = 0;
+        resampler_.configure(patch_.interpolation, srcStep_);
         return;
     }
 
+    // Loop segment in source frames, truncated to whole frames.
+    const auto n = static_cast<int64_t>(source_->frames());
+    loopStart_ = patch_.looping ? static_cast<int64_t>(std::clamp(patch_.loopStartFrac, 0.0, 1.0) * n) : 0;
+    loopEnd_   = patch_.looping ? static_cast<int64_t>(std::clamp(patch_.loopEndFrac,   0.0, 1.0) * n) : 0;
+    if (loopEnd_ <= loopStart_) loopStart_ = loopEnd_ = 0;
+
+    if (source_->streamed()) {
+        // The streamer picks up where the in-memory head ends; only
+        // needed if playback can get past the head at all.
+        const auto head = static_cast<int64_t>(source_->samples.size());
+        const bool pastHead = loopEnd_ > loopStart_ ? loopEnd_ > head : n > head;
+        if (pastHead && stream_.streamer)
+            stream_.slot = stream_.streamer->open(source_, head, loopStart_, loopEnd_);
+        chunkSeq_ = head;
+        chunkLen_ = 0;
+    }
+
     // Playback rate combines (a) source-vs-engine sample rate and
     // (b) pitch shift from root note to played note.
     const double rootFreq = 440.0 * std::pow(2.0, (rootMidiNote_ - 69) / 12.0);
     const double pitchRatio = (rootFreq > 0.0) ? (ev.freqHz / rootFreq) : 1.0;
     const double srcOverEngine =
         static_cast<double>(source_->sampleRate) / static_cast<double>(sampleRate_);
-    srcStep_ = srcOverEngine * pitchRatio;
+    srcStep_ = std::max(0.0, srcOverEngine * pitchRatio);
+    resampler_.configure(patch_.interpolation, srcStep_);
 }
 
 void SampleVoice::onNoteOff(int64_t atFrame)
@@ -53,33 +100,57 @@ bool SampleVoice::isFinished(int64_t currentFrame) const
     return currentFrame >= endFrame_;
 }
 
-double SampleVoice::sampleAtPos(double pos) const
+int16_t SampleVoice::streamFrame(int64_t seq)
 {
-    if (!source_ || source_->samples.empty()) return 0.0;
-    const auto& s = source_->samples;
-    const size_t n = s.size();
-
-    // Clamp to buffer bounds. Looping (if any) wraps into
-    // [loopStart, loopEnd).
-    if (patch_.looping) {
-        const double ls = std::clamp(patch_.loopStartFrac, 0.0, 1.0) * n;
-        const double le = std::clamp(patch_.loopEndFrac,   0.0, 1.0) * n;
-        if (le > ls && pos >= le) {
-            const double span = le - ls;
-            pos = ls + std::fmod(pos - ls, span);
-            if (pos < ls) pos += span;
+    const auto head = static_cast<int64_t>(source_->samples.size());
+    const bool looping = loopEnd_ > loopStart_;
+    if (seq < head || (looping && loopEnd_ <= head)) {
+        int64_t frame = seq;
+        if (looping && frame >= loopEnd_)
+            frame = loopStart_ + (frame - loopStart_) % (loopEnd_ - loopStart_);
+        return source_->samples[static_cast<size_t>(frame)];
+    }
+    // Past the head, frames come from the stream in order. Frames that
+    // arrive late are skipped here so the voice stays in time.
+    while (seq >= chunkSeq_ + chunkLen_) {
+        chunkSeq_ += chunkLen_;
+        chunkLen_ = stream_.slot >= 0
+            ? static_cast<int>(stream_.streamer->read(stream_.slot, chunk_.data(), chunk_.size()))
+            : 0;
+        if (chunkLen_ == 0) {
+            starved_ = true;
+            return 0;
         }
-    } else if (pos >= static_cast<double>(n - 1)) {
-        return 0.0;
     }
+    return chunk_[static_cast<size_t>(seq - chunkSeq_)];
+}
+
+float SampleVoice::sourceFrame(int64_t seq)
+{
+    const bool looping = loopEnd_ > loopStart_;
+    if (seq < 0 || (!looping && seq >= static_cast<int64_t>(source_->frames())))
+        return 0.0f;
+    if (source_->streamed())
+        return streamFrame(seq) * PcmBuffer::kScale;
+    if (looping && seq >= loopEnd_)
+        seq = loopStart_ + (seq - loopStart_) % (loopEnd_ - loopStart_);
+    return source_->sample(static_cast<size_t>(seq));
+}
 
-    const size_t i0 = static_cast<size_t>(pos);
-    const size_t i1 = i0 + 1;
-    if (i0 >= n) return 0.0;
-    const double frac = pos - static_cast<double>(i0);
-    const double a = s[i0];
-    const double b = (i1 < n) ? s[i1] : 0.0;
-    return a + (b - a) * frac;
+void SampleVoice::fillWindow(int64_t first, int64_t last)
+{
+    const int64_t drop = first - winStart_;
+    if (drop < 0 || drop >= winLen_) {
+        // First block, or the read position skipped past the window.
+        winStart_ = first;
+        winLen_ = 0;
+    } else if (drop > 0) {
+        std::copy(window_.begin() + drop, window_.begin() + winLen_, window_.begin());
+        winStart_ = first;
+        winLen_ -= static_cast<int>(drop);
+    }
+    for (int64_t seq = winStart_ + winLen_; seq <= last; ++seq)
+        window_[static_cast<size_t>(winLen_++)] = sourceFrame(seq);
 }
 
 double SampleVoice::envelopeAt(int64_t frame) const
@@ -108,30 +179,65 @@ double SampleVoice::envelopeAt(int64_t frame) const
 
 void SampleVoice::render(float* buffer, int frames, int64_t bufferStartFrame)
 {
-    if (!source_ || source_->samples.empty() || exhausted_) return;
+    if (!source_ || source_->empty() || exhausted_) return;
 
     const int64_t bufEnd = bufferStartFrame + frames;
     const int64_t lo     = std::max(startFrame_, bufferStartFrame);
     const int64_t hi     = std::min(endFrame_, bufEnd);
 
-    const size_t n = source_->samples.size();
+    const double end = static_cast<double>(source_->frames()) - 1.0;
     const bool hasEnvelope =
         patch_.attack > 0.0 || patch_.decay > 0.0 || patch_.release > 0.0;
 
-    for (int64_t f = lo; f < hi; ++f) {
-        const int idx = static_cast<int>(f - bufferStartFrame);
-        const double s = sampleAtPos(srcPos_);
-        const double envGate = hasEnvelope ? envelopeAt(f) : 1.0;
-        buffer[idx] += static_cast<float>(s * velocity_ * envGate);
+    // Reads per block, bounded so the source span they cover (plus the
+    // kernel on either side and one frame of rounding slack) fits the
+    // window.
+    const int halfWidth = resampler_.halfWidth();
+    const double span = kWindowFrames - 2 * halfWidth - 2;
+    const int maxBlock = srcStep_ * (kBlockFrames - 1) <= span
+        ? kBlockFrames
+        : 1 + static_cast<int>(span / srcStep_);
+
+    for (int64_t f = lo; f < hi;) {
+        int count = static_cast<int>(std::min<int64_t>(hi - f, maxBlock));
+        if (!patch_.looping) {
+            // Stop where the sample runs out.
+            const double left = std::ceil((end - srcPos_) / srcStep_);
+            if (left < count) count = std::max(1, static_cast<int>(left));
+        }
+
+        const auto first = static_cast<int64_t>(srcPos_) - halfWidth + 1;
+        const auto last  = static_cast<int64_t>(srcPos_ + srcStep_ * (count - 1)) + halfWidth + 1;
+        fillWindow(first, last);
+        resampler_.process(window_.data(), winStart_, srcPos_, srcStep_, block_.data(), count);
+
+        float* out = buffer + (f - bufferStartFrame);
+        if (hasEnvelope) {
+            for (int i = 0; i < count; ++i) {
+                const double envGate = envelopeAt(f + i);
+                out[i] += static_cast<float>(block_[i] * velocity_ * envGate);
+                level_ = static_cast<float>(velocity_ * envGate);
+            }
+        } else {
+            const auto gain = static_cast<float>(velocity_);
+            for (int i = 0; i < count; ++i)
+                out[i] += block_[i] * gain;
+            level_ = gain;
+        }
+        f += count;
 
-        srcPos_ += srcStep_;
-        if (!patch_.looping && srcPos_ >= static_cast<double>(n - 1)) {
+        if (!patch_.looping && srcPos_ >= end) {
             exhausted_ = true;
             // Finish the voice at this frame so the engine drops it.
-            if (endFrame_ > f + 1) endFrame_ = f + 1;
+            if (endFrame_ > f) endFrame_ = f;
             break;
         }
     }
+
+    if (starved_) {
+        if (stream_.streamer) stream_.streamer->noteUnderrun();
+        starved_ = false;
+    }
 }
 
 } // namespace clay::sound
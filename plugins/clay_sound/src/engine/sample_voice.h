@@ -1,18 +1,32 @@
 // (c) Clayground Contributors - MIT License, see "LICENSE" file
 //
 // SampleVoice — IVoice reading from a shared PcmBuffer. Pitch shift is
-// via playback-rate (linear-interp between source samples). Supports an
-// optional loop segment and a lightweight envelope overlay.
+// via playback-rate, interpolating between source samples with the
+// patch's Resampler quality. Supports an optional loop segment and a
+// lightweight envelope overlay.
+//
+// Source frames are converted to float into a small per-voice window in
+// playback order (loop applied), which the resampler then reads a block
+// at a time; resident and streamed buffers share that path, so both
+// sound exactly the same.
+//
+// A streamed buffer is played from its in-memory head first and then
+// from a PcmStreamer slot, which delivers the rest of the file in
+// playback order (loop already applied). Frames the streamer has not
+// delivered yet play as silence and are counted as underruns.
 
 #pragma once
 
+#include "resampler.h"
 #include "voice.h"
+#include <array>
 #include <cstdint>
 #include <memory>
 
 namespace clay::sound {
 
 struct PcmBuffer;
+class  PcmStreamer;
 
 class SampleVoice : public IVoice
 {
@@ -29,21 +43,56 @@ public:
         double decay   = 0.0;
         double sustain = 1.0;
         double release = 0.0;
+
+        // Quality of the pitch shift; see Resampler.
+        Interpolation interpolation = Interpolation::Linear;
     };
 
     // Configure before onNoteOn(). Shared ownership of the source
     // buffer keeps this cheap across many voices.
     void setSource(std::shared_ptr<const PcmBuffer> source, int rootMidiNote);
     void setPatch(const Patch& p) { patch_ = p; }
+    // Needed for streamed sources; without it they play their head only.
+    void setStreamer(PcmStreamer* streamer) { stream_.streamer = streamer; }
+
+    // Hand the stream slot (if any) back; the owner calls this when the
+    // voice is returned to its pool.
+    void endStream() { stream_.reset(); }
+    // Let go of the source buffer, handing the reference to the caller.
+    std::shared_ptr<const PcmBuffer> takeSource() { return std::move(source_); }
 
     void onNoteOn(const NoteEvent& ev, int sampleRate) override;
     void onNoteOff(int64_t atFrame) override;
     void render(float* buffer, int frames, int64_t bufferStartFrame) override;
     bool isFinished(int64_t currentFrame) const override;
+    float level() const override { return level_; }
 
 private:
+    // A claimed PcmStreamer slot, closed when dropped. Move-only, so a
+    // slot has exactly one owner as voices are reset in their pool.
+    struct StreamSlot
+    {
+        PcmStreamer* streamer = nullptr;
+        int slot = -1;
+
+        StreamSlot() = default;
+        StreamSlot(StreamSlot&& o) noexcept;
+        StreamSlot& operator=(StreamSlot&& o) noexcept;
+        ~StreamSlot() { reset(); }
+        void reset();
+    };
+
+    static constexpr int kWindowFrames = 512;
+    static constexpr int kBlockFrames  = 256;
+
     double envelopeAt(int64_t frame) const;
-    double sampleAtPos(double pos) const;
+    // Slide the window to start at `first` and fill it up to `last`.
+    void fillWindow(int64_t first, int64_t last);
+    // Source frame at playback position `seq`, looped; 0 outside the
+    // sample. Calls must not go backwards.
+    float sourceFrame(int64_t seq);
+    // Frame at playback position `seq`; calls must not go backwards.
+    int16_t streamFrame(int64_t seq);
 
     std::shared_ptr<const PcmBuffer> source_;
     int     rootMidiNote_ = 60;
@@ -56,6 +105,22 @@ private:
     double  srcPos_     = 0.0;         // current position in source samples
     double  srcStep_    = 1.0;         // per engine sample
     bool    exhausted_  = false;       // non-looping sample reached end
+    float   level_      = 0.0f;        // velocity x envelope at the last rendered sample
+    int64_t loopStart_  = 0;           // loop segment in source frames; empty = no loop
+    int64_t loopEnd_    = 0;
+
+    Resampler resampler_;
+    int64_t winStart_   = 0;           // playback position of window_[0]
+    int     winLen_     = 0;
+    std::array<float, kWindowFrames> window_{};
+    std::array<float, kBlockFrames>  block_{};
+
+    // Streaming state (source_->streamed() only).
+    StreamSlot stream_;
+    int64_t chunkSeq_   = 0;           // position of chunk_[0]
+    int     chunkLen_   = 0;
+    bool    starved_    = false;
+    std::array<int16_t, 64> chunk_{};
 };
 
 } // namespace clay::sound
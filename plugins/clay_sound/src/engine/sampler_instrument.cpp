@@ -5,20 +5,29 @@
 
 namespace clay::sound {
 
-std::unique_ptr<IVoice> SamplerInstrument::createVoice(const NoteEvent& /*ev*/,
-                                                      EventId id,
-                                                      int /*sampleRate*/)
+IVoice* SamplerInstrument::acquireVoice(const NoteEvent& /*ev*/,
+                                       EventId id,
+                                       int /*sampleRate*/)
 {
-    auto voice = std::make_unique<SampleVoice>();
+    SampleVoice* voice = pool_.acquire();
+    if (!voice) return nullptr;
     voice->setSource(source_, rootMidiNote_);
-    auto it = patches_.find(id);
-    if (it != patches_.end()) {
-        voice->setPatch(it->second);
-        patches_.erase(it);
-    } else {
-        voice->setPatch(defaultPatch_);
-    }
+    voice->setStreamer(streamer_);
+    SampleVoice::Patch patch;
+    voice->setPatch(patches_.take(id, patch) ? patch : defaultPatch_);
     return voice;
 }
 
+void SamplerInstrument::releaseVoice(IVoice* voice)
+{
+    if (auto* v = static_cast<SampleVoice*>(voice)) {
+        v->endStream();
+        // A pooled voice would keep its buffer until reused; one that is
+        // no longer the instrument's source may be the last reference.
+        std::shared_ptr<const PcmBuffer> source = v->takeSource();
+        if (source != source_) retire(std::move(source));
+    }
+    pool_.release(voice);
+}
+
 } // namespace clay::sound
@@ -2,40 +2,60 @@
 //
 // SamplerInstrument — IInstrument that spawns SampleVoice instances
 // backed by a shared PcmBuffer. Parallels OscillatorInstrument.
+// Streamed buffers additionally need a PcmStreamer (setStreamer()).
 
 #pragma once
 
 #include "instrument.h"
+#include "patch_table.h"
 #include "sample_voice.h"
+#include "voice_pool.h"
 #include <memory>
-#include <unordered_map>
 
 namespace clay::sound {
 
 struct PcmBuffer;
+class  PcmStreamer;
 
 class SamplerInstrument : public IInstrument
 {
 public:
-    void setSource(std::shared_ptr<const PcmBuffer> source) { source_ = std::move(source); }
+    // The previous buffer is retired, not released on the render thread.
+    void setSource(std::shared_ptr<const PcmBuffer> source)
+    {
+        source_.swap(source);
+        retire(std::move(source));
+    }
     const std::shared_ptr<const PcmBuffer>& source() const { return source_; }
 
     void setRootMidiNote(int midiNote) { rootMidiNote_ = midiNote; }
     int  rootMidiNote() const { return rootMidiNote_; }
 
+    // Set before the instrument is added to an engine.
+    void setStreamer(PcmStreamer* streamer) { streamer_ = streamer; }
+
     void setDefaultPatch(const SampleVoice::Patch& p) { defaultPatch_ = p; }
-    void pushPatch(EventId id, const SampleVoice::Patch& p) { patches_[id] = p; }
+    // Queues a patch for a scheduled event; false when the queue is full
+    // and the note will play the default patch.
+    bool pushPatch(EventId id, const SampleVoice::Patch& p) { return patches_.put(id, p); }
     void clearPatches() { patches_.clear(); }
 
-    std::unique_ptr<IVoice> createVoice(const NoteEvent& ev,
-                                        EventId id,
-                                        int sampleRate) override;
+    IVoice* acquireVoice(const NoteEvent& ev, EventId id, int sampleRate) override;
+    void releaseVoice(IVoice* voice) override;
+    void discardEvent(EventId id) override { patches_.erase(id); }
+    int voiceCapacity() const override { return pool_.capacity(); }
+
+    // Voices preallocated per instrument; the polyphony cap can be set
+    // anywhere up to this.
+    static constexpr int kPoolVoices = 64;
 
 private:
+    VoicePool<SampleVoice> pool_{kPoolVoices};
     std::shared_ptr<const PcmBuffer> source_;
+    PcmStreamer* streamer_ = nullptr;
     int rootMidiNote_ = 60;
     SampleVoice::Patch defaultPatch_{};
-    std::unordered_map<EventId, SampleVoice::Patch> patches_;
+    PatchTable<SampleVoice::Patch> patches_;
 };
 
 } // namespace clay::sound
@@ -2,47 +2,219 @@
 
 #include "scheduler.h"
 #include <algorithm>
+#include <limits>
 
 namespace clay::sound {
 
-EventId Scheduler::schedule(const NoteEvent& ev)
+EventId Scheduler::schedule(const NoteEvent& ev, EventId id)
 {
-    const EventId id = nextId_++;
-    const Entry e{ id, ev };
-    // Keep the queue ordered by event time; ties preserve insertion order
-    // via upper_bound on timeFrames.
-    auto it = std::upper_bound(
-        pending_.begin(), pending_.end(), ev.timeFrames,
-        [](int64_t t, const Entry& x) { return t < x.ev.timeFrames; });
-    pending_.insert(it, e);
+    if (id == 0) id = reserveId();
+    cancel(id);
+
+    uint32_t slot;
+    if (!freeSlots_.empty()) {
+        slot = freeSlots_.back();
+        freeSlots_.pop_back();
+    } else {
+        slot = static_cast<uint32_t>(slots_.size());
+        slots_.emplace_back();
+    }
+    Slot& s = slots_[slot];
+    s.id = id;
+    s.ev = ev;
+    s.seq = nextSeq_++;
+
+    if ((heap_.size() + 1) * 2 > index_.size())
+        indexRehash(std::max<size_t>(16, index_.size() * 2));
+    indexInsert(id, slot);
+
+    heap_.push_back(slot);
+    s.heapPos = static_cast<uint32_t>(heap_.size() - 1);
+    siftUp(heap_.size() - 1);
     return id;
 }
 
-bool Scheduler::cancel(EventId id)
+bool Scheduler::cancel(EventId id, NoteEvent* removed)
 {
-    auto it = std::find_if(pending_.begin(), pending_.end(),
-                           [id](const Entry& x) { return x.id == id; });
-    if (it == pending_.end()) return false;
-    pending_.erase(it);
+    const size_t at = find(id);
+    if (at == npos) return false;
+    if (removed) *removed = slots_[index_[at].slot].ev;
+    removeAt(slots_[index_[at].slot].heapPos);
     return true;
 }
 
+size_t Scheduler::cancelInstrument(int instrumentId)
+{
+    // Compact the heap, then restore the heap order bottom-up.
+    size_t kept = 0;
+    for (size_t i = 0; i < heap_.size(); ++i) {
+        const uint32_t slot = heap_[i];
+        if (slots_[slot].ev.instrumentId == instrumentId) {
+            indexErase(find(slots_[slot].id));
+            freeSlots_.push_back(slot);
+        } else {
+            heap_[kept++] = slot;
+        }
+    }
+    const size_t removed = heap_.size() - kept;
+    if (removed == 0) return 0;
+    heap_.resize(kept);
+    for (size_t i = 0; i < kept; ++i) slots_[heap_[i]].heapPos = static_cast<uint32_t>(i);
+    for (size_t i = kept / 2; i-- > 0;) siftDown(i);
+    return removed;
+}
+
 void Scheduler::clear()
 {
-    pending_.clear();
+    for (uint32_t slot : heap_) freeSlots_.push_back(slot);
+    heap_.clear();
+    std::fill(index_.begin(), index_.end(), IndexEntry{});
+}
+
+void Scheduler::popDue(int64_t maxFrame, std::vector<Fired>& out)
+{
+    out.clear();
+    while (!heap_.empty()) {
+        const Slot& s = slots_[heap_.front()];
+        if (s.ev.timeFrames > maxFrame) break;
+        out.push_back({ s.id, s.ev });
+        removeAt(0);
+    }
 }
 
 std::vector<Scheduler::Fired> Scheduler::popDue(int64_t maxFrame)
 {
     std::vector<Fired> out;
-    auto cut = std::upper_bound(
-        pending_.begin(), pending_.end(), maxFrame,
-        [](int64_t t, const Entry& x) { return t < x.ev.timeFrames; });
-    out.reserve(static_cast<size_t>(cut - pending_.begin()));
-    for (auto it = pending_.begin(); it != cut; ++it)
-        out.push_back({ it->id, it->ev });
-    pending_.erase(pending_.begin(), cut);
+    popDue(maxFrame, out);
     return out;
 }
 
+void Scheduler::reserve(size_t events)
+{
+    slots_.reserve(events);
+    freeSlots_.reserve(events);
+    heap_.reserve(events);
+    size_t capacity = 16;
+    while (capacity < events * 2) capacity <<= 1;
+    if (capacity > index_.size()) indexRehash(capacity);
+}
+
+int64_t Scheduler::nextFrame() const
+{
+    if (heap_.empty()) return std::numeric_limits<int64_t>::max();
+    return slots_[heap_.front()].ev.timeFrames;
+}
+
+// --- heap ---------------------------------------------------------------
+
+bool Scheduler::earlier(uint32_t a, uint32_t b) const
+{
+    const Slot& x = slots_[a];
+    const Slot& y = slots_[b];
+    if (x.ev.timeFrames != y.ev.timeFrames) return x.ev.timeFrames < y.ev.timeFrames;
+    return x.seq < y.seq;
+}
+
+void Scheduler::place(size_t pos, uint32_t slot)
+{
+    heap_[pos] = slot;
+    slots_[slot].heapPos = static_cast<uint32_t>(pos);
+}
+
+void Scheduler::siftUp(size_t pos)
+{
+    const uint32_t slot = heap_[pos];
+    while (pos > 0) {
+        const size_t parent = (pos - 1) / 2;
+        if (!earlier(slot, heap_[parent])) break;
+        place(pos, heap_[parent]);
+        pos = parent;
+    }
+    place(pos, slot);
+}
+
+void Scheduler::siftDown(size_t pos)
+{
+    const uint32_t slot = heap_[pos];
+    const size_t n = heap_.size();
+    for (;;) {
+        size_t child = 2 * pos + 1;
+        if (child >= n) break;
+        if (child + 1 < n && earlier(heap_[child + 1], heap_[child])) ++child;
+        if (!earlier(heap_[child], slot)) break;
+        place(pos, heap_[child]);
+        pos = child;
+    }
+    place(pos, slot);
+}
+
+void Scheduler::removeAt(size_t pos)
+{
+    const uint32_t slot = heap_[pos];
+    indexErase(find(slots_[slot].id));
+    freeSlots_.push_back(slot);
+
+    const uint32_t last = heap_.back();
+    heap_.pop_back();
+    if (pos == heap_.size()) return;
+    place(pos, last);
+    if (pos > 0 && earlier(last, heap_[(pos - 1) / 2]))
+        siftUp(pos);
+    else
+        siftDown(pos);
+}
+
+// --- id index (linear probing, backward-shift deletion) -------------------
+
+size_t Scheduler::home(EventId id) const
+{
+    uint64_t h = id * 0x9E3779B97F4A7C15ull;
+    h ^= h >> 29;
+    return static_cast<size_t>(h) & (index_.size() - 1);
+}
+
+size_t Scheduler::find(EventId id) const
+{
+    if (id == 0 || index_.empty()) return npos;
+    const size_t mask = index_.size() - 1;
+    for (size_t i = home(id);; i = (i + 1) & mask) {
+        if (index_[i].id == id) return i;
+        if (index_[i].id == 0) return npos;
+    }
+}
+
+void Scheduler::indexInsert(EventId id, uint32_t slot)
+{
+    const size_t mask = index_.size() - 1;
+    size_t i = home(id);
+    while (index_[i].id != 0) i = (i + 1) & mask;
+    index_[i] = { id, slot };
+}
+
+void Scheduler::indexErase(size_t pos)
+{
+    const size_t mask = index_.size() - 1;
+    size_t hole = pos;
+    for (size_t j = (pos + 1) & mask; index_[j].id != 0; j = (j + 1) & mask) {
+        // Move the entry back into the hole unless its home position lies
+        // cyclically within (hole, j], where it is still reachable.
+        const size_t h = home(index_[j].id);
+        const bool reachable = hole <= j ? (hole < h && h <= j) : (hole < h || h <= j);
+        if (!reachable) {
+            index_[hole] = index_[j];
+            hole = j;
+        }
+    }
+    index_[hole] = IndexEntry{};
+}
+
+void Scheduler::indexRehash(size_t capacity)
+{
+    std::vector<IndexEntry> old;
+    old.swap(index_);
+    index_.assign(capacity, IndexEntry{});
+    for (const IndexEntry& e : old)
+        if (e.id != 0) indexInsert(e.id, e.slot);
+}
+
 } // namespace clay::sound
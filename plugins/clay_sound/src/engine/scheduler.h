@@ -11,6 +11,8 @@
 #pragma once
 
 #include "note_event.h"
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -21,36 +23,96 @@ using EventId = uint64_t;
 class Scheduler
 {
 public:
-    // Enqueue an event. Returns a ticket usable with cancel().
-    EventId schedule(const NoteEvent& ev);
+    // Enqueue an event. Returns a ticket usable with cancel(). `id` may
+    // be a ticket obtained earlier from reserveId(); 0 draws a new one.
+    // Scheduling an id that is still pending replaces that event.
+    // O(log n); allocates only when growing past reserve().
+    EventId schedule(const NoteEvent& ev, EventId id = 0);
+
+    // Draw a ticket without enqueuing anything. Thread-safe, so a control
+    // thread can hand out tickets for events the render thread will
+    // schedule later.
+    EventId reserveId() { return nextId_.fetch_add(1, std::memory_order_relaxed); }
 
     // Remove a pending event. No-op if already fired or not found.
-    // Returns true if the event was cancelled.
-    bool cancel(EventId id);
+    // Returns true if the event was cancelled, copying it to `removed`
+    // when given. O(log n).
+    bool cancel(EventId id, NoteEvent* removed = nullptr);
+
+    // Remove every pending event of one instrument. Returns how many
+    // were dropped. O(n); allocation-free.
+    size_t cancelInstrument(int instrumentId);
 
-    // Drop all pending events.
+    // Drop all pending events. Keeps the preallocated storage.
     void clear();
 
-    // Pop all events with timeFrames <= maxFrame, in ascending time order.
-    // Returned events carry their original EventId so the caller can correlate.
+    // Same, calling `dropped(id, ev)` for each pending event first, in no
+    // particular order. Allocation-free.
+    template <typename Fn>
+    void clear(Fn&& dropped)
+    {
+        for (uint32_t slot : heap_) dropped(slots_[slot].id, slots_[slot].ev);
+        clear();
+    }
+
+    // Pop all events with timeFrames <= maxFrame, in ascending time order
+    // (ties in scheduling order), replacing the contents of `out`.
+    // Returned events carry their original EventId so the caller can
+    // correlate. Allocation-free while `out` has the capacity.
     struct Fired { EventId id; NoteEvent ev; };
+    void popDue(int64_t maxFrame, std::vector<Fired>& out);
+
+    // Convenience overload returning a fresh vector. Allocates; not for
+    // the audio thread.
     std::vector<Fired> popDue(int64_t maxFrame);
 
+    // Preallocate for `events` simultaneously pending events.
+    void reserve(size_t events);
+
     // Introspection helpers.
-    size_t pending() const { return pending_.size(); }
-    bool hasPending() const { return !pending_.empty(); }
+    size_t pending() const { return heap_.size(); }
+    bool hasPending() const { return !heap_.empty(); }
+    // Frame of the earliest pending event; INT64_MAX when empty.
+    int64_t nextFrame() const;
 
 private:
-    struct Entry
+    // Events live in stable slots; the binary min-heap orders slot
+    // indices by (timeFrames, seq) and each slot remembers its heap
+    // position, so cancel() can remove from the middle. An open-addressed
+    // id -> slot table makes the lookup O(1).
+    struct Slot
     {
-        EventId id;
+        EventId   id = 0;
         NoteEvent ev;
+        uint64_t  seq = 0;        // scheduling order, breaks time ties
+        uint32_t  heapPos = 0;
     };
+    struct IndexEntry
+    {
+        EventId  id = 0;          // 0 = empty (0 is never a ticket)
+        uint32_t slot = 0;
+    };
+
+    bool earlier(uint32_t a, uint32_t b) const;
+    void place(size_t pos, uint32_t slot);
+    void siftUp(size_t pos);
+    void siftDown(size_t pos);
+    void removeAt(size_t pos);
+
+    size_t home(EventId id) const;
+    size_t find(EventId id) const;          // index_ position or npos
+    void indexInsert(EventId id, uint32_t slot);
+    void indexErase(size_t pos);
+    void indexRehash(size_t capacity);
+
+    static constexpr size_t npos = static_cast<size_t>(-1);
 
-    // Sorted ascending by ev.timeFrames. Linear-scan operations are fine
-    // for Stage 0; a heap can replace this when profiling demands it.
-    std::vector<Entry> pending_;
-    EventId nextId_ = 1;
+    std::vector<Slot>       slots_;
+    std::vector<uint32_t>   freeSlots_;
+    std::vector<uint32_t>   heap_;
+    std::vector<IndexEntry> index_;         // power-of-two size, <= 50% full
+    uint64_t nextSeq_ = 0;
+    std::atomic<EventId> nextId_{1};
 };
 
 } // namespace clay::sound
@@ -0,0 +1,51 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "spatial.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace clay::sound {
+
+namespace {
+
+constexpr float kQuarterPi = 0.78539816f;
+
+Vec3 sub(const Vec3& a, const Vec3& b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+float dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+Vec3 cross(const Vec3& a, const Vec3& b)
+{
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+
+} // namespace
+
+PanGains constantPowerPan(float pan)
+{
+    const float angle = (std::clamp(pan, -1.0f, 1.0f) + 1.0f) * kQuarterPi;
+    return { std::cos(angle), std::sin(angle) };
+}
+
+float distanceGain(const Emitter& e, float distance)
+{
+    const float ref = std::max(e.refDistance, 1e-4f);
+    const float d = std::clamp(distance, ref, std::max(e.maxDistance, ref));
+    return ref / (ref + std::max(e.rolloff, 0.0f) * (d - ref));
+}
+
+Placement place(const Listener& l, const Emitter& e)
+{
+    const Vec3 dir = sub(e.position, l.position);
+    const float distance = std::sqrt(dot(dir, dir));
+
+    Placement p;
+    p.gain = distanceGain(e, distance);
+
+    const Vec3 right = cross(l.forward, l.up);
+    const float rightLen = std::sqrt(dot(right, right));
+    if (distance > 1e-6f && rightLen > 1e-6f)
+        p.pan = std::clamp(dot(dir, right) / (distance * rightLen), -1.0f, 1.0f);
+    return p;
+}
+
+} // namespace clay::sound
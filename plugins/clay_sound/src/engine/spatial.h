@@ -0,0 +1,61 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// Spatial helpers — pan law, distance attenuation and the listener /
+// emitter model the engine uses to place voices in the stereo field.
+//
+// A voice bound to an emitter (NoteEvent::emitterId) is re-evaluated
+// at control rate (every mix chunk): its pan follows the emitter's
+// direction relative to the listener's right axis and its gain the
+// emitter's distance, using the inverse-distance-clamped model known
+// from OpenAL / WebAudio. Positions are in arbitrary world units.
+
+#pragma once
+
+namespace clay::sound {
+
+struct Vec3
+{
+    float x = 0.0f;
+    float y = 0.0f;
+    float z = 0.0f;
+};
+
+struct Listener
+{
+    Vec3 position;
+    Vec3 forward{0.0f, 0.0f, -1.0f};
+    Vec3 up{0.0f, 1.0f, 0.0f};
+};
+
+struct Emitter
+{
+    Vec3  position;
+    float refDistance = 1.0f;    // full gain up to here
+    float maxDistance = 100.0f;  // no further attenuation beyond
+    float rolloff     = 1.0f;    // 0 = no distance attenuation
+    bool  active      = false;
+};
+
+struct PanGains
+{
+    float left  = 1.0f;
+    float right = 1.0f;
+};
+
+// Constant-power pan law: pan -1 (left) .. +1 (right); left² + right² = 1.
+PanGains constantPowerPan(float pan);
+
+// Inverse-distance-clamped attenuation of `e` at `distance`.
+float distanceGain(const Emitter& e, float distance);
+
+struct Placement
+{
+    float pan  = 0.0f;   // -1 .. +1
+    float gain = 1.0f;   // distance attenuation
+};
+
+// Where `e` sits for `l`: pan from the direction's projection onto the
+// listener's right axis, gain from the distance.
+Placement place(const Listener& l, const Emitter& e);
+
+} // namespace clay::sound
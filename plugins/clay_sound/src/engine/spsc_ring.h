@@ -0,0 +1,115 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// SpscRing — bounded, lock-free single-producer / single-consumer queue.
+// Used to hand commands from the GUI thread to the audio render thread
+// and notifications back, without locks or allocation on either side.
+//
+// Slots are preallocated at construction. Producers either push() a
+// copy or construct in place via beginPush()/commitPush(); consumers
+// read front() and pop() it. Exactly one thread may produce and one
+// (other or same) thread may consume at any time.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace clay::sound {
+
+template <typename T>
+class SpscRing
+{
+public:
+    // `capacity` is rounded up to a power of two.
+    explicit SpscRing(size_t capacity)
+    {
+        size_t cap = 2;
+        while (cap < capacity) cap <<= 1;
+        slots_ = std::make_unique<T[]>(cap);
+        mask_ = cap - 1;
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // --- producer ------------------------------------------------------
+
+    // Slot to fill in place, or nullptr when full. The slot becomes
+    // visible to the consumer only after commitPush().
+    T* beginPush()
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) > mask_) return nullptr;
+        return &slots_[tail & mask_];
+    }
+
+    void commitPush()
+    {
+        tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool push(const T& value)
+    {
+        T* slot = beginPush();
+        if (!slot) return false;
+        *slot = value;
+        commitPush();
+        return true;
+    }
+
+    bool push(T&& value)
+    {
+        T* slot = beginPush();
+        if (!slot) return false;
+        *slot = std::move(value);
+        commitPush();
+        return true;
+    }
+
+    // --- consumer ------------------------------------------------------
+
+    // Oldest committed element, or nullptr when empty.
+    T* front()
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return nullptr;
+        return &slots_[head & mask_];
+    }
+
+    void pop()
+    {
+        head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Moves the element out, so the slot holds no resources until it is
+    // reused by the producer.
+    bool pop(T& out)
+    {
+        T* slot = front();
+        if (!slot) return false;
+        out = std::move(*slot);
+        pop();
+        return true;
+    }
+
+    // Approximate when called concurrently with the other side.
+    size_t size() const
+    {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+
+private:
+    std::unique_ptr<T[]> slots_;
+    size_t mask_ = 0;
+    // Producer and consumer indices on separate cache lines so the two
+    // threads do not false-share.
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+} // namespace clay::sound
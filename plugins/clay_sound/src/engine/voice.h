@@ -1,8 +1,8 @@
 // (c) Clayground Contributors - MIT License, see "LICENSE" file
 //
 // IVoice — per-note renderer. Owns its own DSP state. Produced by an
-// IInstrument in response to a NoteEvent; recycled by the engine when
-// finished.
+// IInstrument in response to a NoteEvent; handed back to it by the
+// engine when finished.
 
 #pragma once
 
@@ -32,6 +32,10 @@ public:
 
     // Once true, the engine can drop this voice.
     virtual bool isFinished(int64_t currentFrame) const = 0;
+
+    // Rough current amplitude (envelope x velocity) as of the last
+    // render; used to pick the quietest voice to steal.
+    virtual float level() const { return 1.0f; }
 };
 
 } // namespace clay::sound
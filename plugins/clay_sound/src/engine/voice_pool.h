@@ -0,0 +1,58 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// VoicePool — fixed-capacity store of preallocated voices of one
+// concrete type. An instrument owns one and hands its voices to the
+// engine through IInstrument::acquireVoice()/releaseVoice(), so firing
+// a note on the render thread reuses storage instead of allocating.
+//
+// acquire() resets the slot in place to a default-constructed voice;
+// the instrument then configures it (patch, source) as it would a fresh
+// one. Returns nullptr when every voice is in use.
+
+#pragma once
+
+#include "voice.h"
+#include <cstddef>
+#include <vector>
+
+namespace clay::sound {
+
+template <typename Voice>
+class VoicePool
+{
+public:
+    explicit VoicePool(int capacity)
+        : voices_(static_cast<size_t>(capacity > 0 ? capacity : 1))
+    {
+        free_.reserve(voices_.size());
+        for (size_t i = voices_.size(); i-- > 0;)
+            free_.push_back(&voices_[i]);
+    }
+
+    VoicePool(const VoicePool&) = delete;
+    VoicePool& operator=(const VoicePool&) = delete;
+
+    Voice* acquire()
+    {
+        if (free_.empty()) return nullptr;
+        Voice* v = free_.back();
+        free_.pop_back();
+        *v = Voice{};
+        return v;
+    }
+
+    // `voice` must have come from acquire() on this pool.
+    void release(IVoice* voice)
+    {
+        if (voice) free_.push_back(static_cast<Voice*>(voice));
+    }
+
+    int capacity() const { return static_cast<int>(voices_.size()); }
+    int inUse() const { return static_cast<int>(voices_.size() - free_.size()); }
+
+private:
+    std::vector<Voice>  voices_;
+    std::vector<Voice*> free_;   // never grows past capacity
+};
+
+} // namespace clay::sound
@@ -0,0 +1,120 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "wav_writer.h"
+
+#include "pcm_buffer.h"
+
+#include <cstring>
+#include <limits>
+
+namespace clay::sound {
+
+namespace {
+
+bool setError(std::string* err, const char* msg)
+{
+    if (err) *err = msg;
+    return false;
+}
+
+void putU16(uint8_t* p, uint16_t v)
+{
+    p[0] = static_cast<uint8_t>(v & 0xff);
+    p[1] = static_cast<uint8_t>((v >> 8) & 0xff);
+}
+
+void putU32(uint8_t* p, uint32_t v)
+{
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>((v >> (8 * i)) & 0xff);
+}
+
+constexpr size_t kHeaderBytes = 44;
+
+} // namespace
+
+WavWriter::~WavWriter()
+{
+    close();
+}
+
+bool WavWriter::open(const std::string& path, int sampleRate, int channels,
+                     Encoding encoding, std::string* error)
+{
+    close();
+    if (sampleRate <= 0) return setError(error, "invalid sample rate");
+    if (channels < 1 || channels > 2) return setError(error, "unsupported channel count");
+
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_) return setError(error, "open for write failed");
+    channels_ = channels;
+    encoding_ = encoding;
+    frames_ = 0;
+    failed_ = false;
+
+    const uint16_t bits = encoding == Encoding::Float32 ? 32 : 16;
+    const uint16_t blockAlign = static_cast<uint16_t>(channels * bits / 8);
+
+    // Sizes are written as 0 and patched in close().
+    uint8_t h[kHeaderBytes] = {};
+    std::memcpy(h, "RIFF", 4);
+    std::memcpy(h + 8, "WAVE", 4);
+    std::memcpy(h + 12, "fmt ", 4);
+    putU32(h + 16, 16);
+    putU16(h + 20, encoding == Encoding::Float32 ? 3 : 1);   // IEEE float / PCM
+    putU16(h + 22, static_cast<uint16_t>(channels));
+    putU32(h + 24, static_cast<uint32_t>(sampleRate));
+    putU32(h + 28, static_cast<uint32_t>(sampleRate) * blockAlign);
+    putU16(h + 32, blockAlign);
+    putU16(h + 34, bits);
+    std::memcpy(h + 36, "data", 4);
+    if (std::fwrite(h, 1, kHeaderBytes, file_) != kHeaderBytes) {
+        std::fclose(file_);
+        file_ = nullptr;
+        return setError(error, "write failed");
+    }
+    return true;
+}
+
+bool WavWriter::write(const float* interleaved, size_t frames)
+{
+    if (!file_ || failed_) return false;
+    const size_t samples = frames * static_cast<size_t>(channels_);
+    if (encoding_ == Encoding::Float32) {
+        // WAV is little-endian, like every platform we build for.
+        failed_ = std::fwrite(interleaved, sizeof(float), samples, file_) != samples;
+    } else {
+        scratch_.resize(samples * 2);
+        for (size_t i = 0; i < samples; ++i)
+            putU16(scratch_.data() + 2 * i, static_cast<uint16_t>(PcmBuffer::quantize(interleaved[i])));
+        failed_ = std::fwrite(scratch_.data(), 1, scratch_.size(), file_) != scratch_.size();
+    }
+    if (!failed_) frames_ += frames;
+    return !failed_;
+}
+
+bool WavWriter::close(std::string* error)
+{
+    if (!file_) return true;
+
+    const uint64_t bytesPerFrame = static_cast<uint64_t>(channels_)
+                                   * (encoding_ == Encoding::Float32 ? 4 : 2);
+    const uint64_t dataBytes = frames_ * bytesPerFrame;
+    const char* reason = nullptr;
+    if (failed_) {
+        reason = "write failed";
+    } else if (dataBytes + kHeaderBytes - 8 > std::numeric_limits<uint32_t>::max()) {
+        reason = "file too large for WAV";
+    } else {
+        uint8_t size[4];
+        putU32(size, static_cast<uint32_t>(dataBytes + kHeaderBytes - 8));
+        bool ok = std::fseek(file_, 4, SEEK_SET) == 0 && std::fwrite(size, 1, 4, file_) == 4;
+        putU32(size, static_cast<uint32_t>(dataBytes));
+        ok = ok && std::fseek(file_, 40, SEEK_SET) == 0 && std::fwrite(size, 1, 4, file_) == 4;
+        if (!ok) reason = "header update failed";
+    }
+    if (std::fclose(file_) != 0 && !reason) reason = "write failed";
+    file_ = nullptr;
+    return reason ? setError(error, reason) : true;
+}
+
+} // namespace clay::sound
@@ -0,0 +1,56 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// WavWriter — streams interleaved float frames into a WAV file as they
+// are rendered, so a long bounce never holds the whole result in
+// memory. Samples are stored as 16-bit PCM or as 32-bit float (lossless
+// for the engine's output); the RIFF and data sizes are patched in when
+// the file is closed.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace clay::sound {
+
+class WavWriter
+{
+public:
+    enum class Encoding { Int16, Float32 };
+
+    WavWriter() = default;
+    ~WavWriter();
+
+    WavWriter(const WavWriter&) = delete;
+    WavWriter& operator=(const WavWriter&) = delete;
+
+    // Create `path` and write a header. Returns false with `error` set
+    // when the file cannot be created.
+    bool open(const std::string& path, int sampleRate, int channels,
+              Encoding encoding, std::string* error = nullptr);
+
+    // Append `frames` frames of channels() interleaved samples. Returns
+    // false once a write failed (disk full); the file stays open.
+    bool write(const float* interleaved, size_t frames);
+
+    // Patch the header sizes and close the file. Returns false if any
+    // write failed or the header could not be updated.
+    bool close(std::string* error = nullptr);
+
+    bool     isOpen() const { return file_ != nullptr; }
+    int      channels() const { return channels_; }
+    uint64_t framesWritten() const { return frames_; }
+
+private:
+    std::FILE* file_ = nullptr;
+    int        channels_ = 0;
+    Encoding   encoding_ = Encoding::Int16;
+    uint64_t   frames_ = 0;
+    bool       failed_ = false;
+    std::vector<uint8_t> scratch_;     // encoded bytes of one write()
+};
+
+} // namespace clay::sound
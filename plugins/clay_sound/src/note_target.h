@@ -0,0 +1,51 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// NoteTarget — implemented by QML instruments that can queue a note on
+// the shared clay::sound::Engine at an exact engine frame
+// (SynthInstrument, SampleInstrument). SongPlayer resolves each track to
+// a NoteTarget once and schedules notes ahead of the audio clock, so
+// their onsets are sample-accurate regardless of GUI-thread load.
+// Instruments that do not implement it are still driven through their
+// triggerNote() slot.
+//
+// AudioBounce renders songs offline on private engines; it asks each
+// NoteTarget for a copy of its current sound via bounceSnapshot().
+
+#ifndef CLAY_SOUND_NOTE_TARGET_H
+#define CLAY_SOUND_NOTE_TARGET_H
+
+#include "engine/scheduler.h"
+
+#include <QtGlobal>
+#include <QtPlugin>
+
+#include <cstdint>
+
+namespace clay::sound { struct BounceInstrument; }
+
+class NoteTarget
+{
+public:
+    virtual ~NoteTarget() = default;
+
+    // Queue `midiNote` to start at engine frame `frame` (see
+    // AudioOutput::currentFrame()). Returns the scheduler ticket, usable
+    // with AudioOutput::cancel(), or 0 if the note was not queued.
+    virtual clay::sound::EventId scheduleNote(int64_t frame, int midiNote,
+                                              qreal velocity, qreal durationSeconds) = 0;
+
+    // Copy the instrument's settings (patch, PCM, gain, pan, polyphony)
+    // into `out` for an offline render. Called on the GUI thread; the
+    // copy is then used on a worker. Returns false if the instrument has
+    // nothing to play (e.g. no sample loaded) or cannot be bounced.
+    virtual bool bounceSnapshot(clay::sound::BounceInstrument *out) const
+    {
+        Q_UNUSED(out);
+        return false;
+    }
+};
+
+#define NoteTarget_iid "org.clayground.sound.NoteTarget"
+Q_DECLARE_INTERFACE(NoteTarget, NoteTarget_iid)
+
+#endif // CLAY_SOUND_NOTE_TARGET_H
@@ -3,11 +3,15 @@
 #include "sample_instrument.h"
 
 #include "audio_output.h"
+#include "engine/bounce.h"
 #include "engine/engine.h"
 #include "engine/note_event.h"
 #include "engine/pcm_buffer.h"
+#include "engine/pcm_cache.h"
 #include "engine/sampler_instrument.h"
+#include "sound_emitter.h"
 
+#include <QCoreApplication>
 #include <QDebug>
 #include <QFile>
 #include <QNetworkAccessManager>
@@ -15,6 +19,7 @@
 #include <QNetworkRequest>
 #include <QQmlContext>
 #include <QQmlEngine>
+#include <QtConcurrent/QtConcurrentRun>
 
 #include <algorithm>
 #include <cmath>
@@ -41,23 +46,53 @@ QString urlToLocalPath(const QUrl &url)
     return url.toString();
 }
 
+cs::IInstrument::StealPolicy mapStealPolicy(const QString &name)
+{
+    using P = cs::IInstrument::StealPolicy;
+    if (name == "quietest") return P::Quietest;
+    if (name == "priority") return P::LowestPriority;
+    return P::Oldest;
+}
+
+cs::Interpolation mapInterpolation(const QString &name)
+{
+    using I = cs::Interpolation;
+    if (name == "cubic")  return I::Cubic;
+    if (name == "sinc8")  return I::Sinc8;
+    if (name == "sinc16") return I::Sinc16;
+    return I::Linear;
+}
+
+QString decodeError(const std::string &err)
+{
+    return QString::fromStdString(err.empty() ? "load failed" : err);
+}
+
 } // namespace
 
 SampleInstrument::SampleInstrument(QObject *parent)
     : QObject(parent)
 {
     auto core = std::make_unique<cs::SamplerInstrument>();
+    core->setStreamer(&cs::AudioOutput::instance().streamer());
     core_ = core.get();
     coreId_ = cs::AudioOutput::instance().registerInstrument(std::move(core));
+    if (coreId_ < 0) core_ = nullptr;
     if (core_) core_->setGain(static_cast<float>(volume_));
+    applyVoiceLimitsToCore();
 
     connect(&cs::AudioOutput::instance(), &cs::AudioOutput::afterPull,
             this, &SampleInstrument::onAfterPull);
+    connect(&decodeWatcher_, &QFutureWatcher<Decoded>::finished, this, [this] {
+        if (decodeWatcher_.isCanceled()) return;
+        applyDecoded(decodeWatcher_.result());
+    });
 }
 
 SampleInstrument::~SampleInstrument()
 {
     cancelInFlightReply();
+    decodeWatcher_.disconnect(this);
     if (coreId_ >= 0) {
         cs::AudioOutput::instance().unregisterInstrument(coreId_);
         core_ = nullptr;
@@ -89,7 +124,7 @@ void SampleInstrument::setRootNote(int n)
     n = std::clamp(n, 0, 127);
     if (rootMidiNote_ == n) return;
     rootMidiNote_ = n;
-    if (core_) core_->setRootMidiNote(n);
+    applySourceToCore();
     emit rootNoteChanged();
 }
 
@@ -146,11 +181,95 @@ void SampleInstrument::setVolume(qreal v)
     emit volumeChanged();
 }
 
+void SampleInstrument::setInterpolation(const QString &mode)
+{
+    if (mode == interpolationName_) return;
+    interpolationName_ = mode;
+    patch_.interpolation = mapInterpolation(mode);
+    applyPatchToCore();
+    emit interpolationChanged();
+}
+
+void SampleInstrument::setMaxVoices(int n)
+{
+    n = std::clamp(n, 1, cs::SamplerInstrument::kPoolVoices);
+    if (maxVoices_ == n) return;
+    maxVoices_ = n;
+    applyVoiceLimitsToCore();
+    emit maxVoicesChanged();
+}
+
+void SampleInstrument::setStealPolicy(const QString &p)
+{
+    if (p == stealPolicyName_) return;
+    stealPolicyName_ = p;
+    applyVoiceLimitsToCore();
+    emit stealPolicyChanged();
+}
+
+void SampleInstrument::setPriority(int p)
+{
+    if (priority_ == p) return;
+    priority_ = p;
+    emit priorityChanged();
+}
+
+void SampleInstrument::setPan(qreal p)
+{
+    p = std::clamp(p, -1.0, 1.0);
+    if (pan_ == p) return;
+    pan_ = p;
+    emit panChanged();
+}
+
+void SampleInstrument::setBus(int b)
+{
+    b = std::clamp(b, 0, cs::Engine::kMaxBuses - 1);
+    if (bus_ == b) return;
+    bus_ = b;
+    applyVoiceLimitsToCore();
+    emit busChanged();
+}
+
+void SampleInstrument::setEmitter(SoundEmitter *e)
+{
+    if (emitter_ == e) return;
+    emitter_ = e;
+    emit emitterChanged();
+}
+
+void SampleInstrument::setAsynchronous(bool v)
+{
+    if (asynchronous_ == v) return;
+    asynchronous_ = v;
+    emit asynchronousChanged();
+}
+
+void SampleInstrument::setStreamThreshold(qreal seconds)
+{
+    seconds = std::max(0.0, seconds);
+    if (streamThreshold_ == seconds) return;
+    streamThreshold_ = seconds;
+    emit streamThresholdChanged();
+}
+
+bool SampleInstrument::streaming() const
+{
+    return buffer_ && buffer_->streamed();
+}
+
+void SampleInstrument::applyVoiceLimitsToCore()
+{
+    if (!core_) return;
+    core_->setMaxPolyphony(maxVoices_);
+    core_->setStealPolicy(mapStealPolicy(stealPolicyName_));
+    core_->setBus(bus_);
+}
+
 int SampleInstrument::activeVoices() const
 {
     if (coreId_ < 0) return 0;
-    return static_cast<int>(
-        cs::AudioOutput::instance().engine().activeVoices(coreId_));
+    return cs::AudioOutput::instance().activeVoices(coreId_);
 }
 
 void SampleInstrument::onAfterPull()
@@ -162,72 +281,127 @@ void SampleInstrument::onAfterPull()
         lastActive_ = av;
         emit activeVoicesChanged();
     }
+    if (core_) {
+        const int steals = stealsCarried_ + static_cast<int>(core_->voiceSteals());
+        const int dropped = droppedCarried_ + static_cast<int>(core_->droppedNotes());
+        if (steals != lastSteals_ || dropped != lastDropped_) {
+            lastSteals_ = steals;
+            lastDropped_ = dropped;
+            emit voiceStatsChanged();
+        }
+    }
 }
 
 void SampleInstrument::applyPatchToCore()
 {
-    if (core_) core_->setDefaultPatch(patch_);
+    if (coreId_ < 0) return;
+    cs::AudioOutput::instance().post<cs::SamplerInstrument>(
+        coreId_, patch_,
+        [](cs::SamplerInstrument &inst, cs::EventId, const cs::SampleVoice::Patch &p) {
+            inst.setDefaultPatch(p);
+        });
+}
+
+void SampleInstrument::applySourceToCore()
+{
+    if (coreId_ < 0) return;
+    // The shared_ptr is copied into the command, so the render thread
+    // holds its own reference while buffer_ may be replaced here.
+    struct Source { std::shared_ptr<const cs::PcmBuffer> buffer; int rootMidiNote; };
+    cs::AudioOutput::instance().post<cs::SamplerInstrument>(
+        coreId_, Source{buffer_, rootMidiNote_},
+        [](cs::SamplerInstrument &inst, cs::EventId, const Source &src) {
+            inst.setSource(src.buffer);
+            inst.setRootMidiNote(src.rootMidiNote);
+        });
 }
 
 void SampleInstrument::loadSource()
 {
     cancelInFlightReply();
+    // Drop the result of any decode still running for the previous source.
+    decodeWatcher_.cancel();
 
     if (source_.isEmpty()) {
         buffer_.reset();
-        if (core_) core_->setSource(nullptr);
+        applySourceToCore();
         if (loaded_) { loaded_ = false; emit loadedChanged(); }
         return;
     }
 
-    if (isLocalScheme(source_)) {
-        // Synchronous file/qrc read keeps prior desktop semantics —
-        // load completes before this function returns.
-        const QString path = urlToLocalPath(source_);
-        QFile f(path);
-        if (!f.open(QIODevice::ReadOnly)) {
-            buffer_.reset();
-            if (core_) core_->setSource(nullptr);
-            error_ = QStringLiteral("cannot open %1").arg(path);
-            emit errorStringChanged();
-            if (loaded_) { loaded_ = false; emit loadedChanged(); }
-            return;
-        }
-        applyLoadedBytes(f.readAll());
-    } else {
+    if (!isLocalScheme(source_)) {
         // http(s) (or any non-local) — fetch via QNetworkAccessManager.
         // Required on WASM where the source URL points at the dev/CDN
         // origin and QFile can't open it. While the fetch is in flight
         // `loaded_` stays false, mirroring lazyLoading semantics.
         beginRemoteFetch(source_);
+        return;
+    }
+
+    const QString path = urlToLocalPath(source_);
+    if (path.startsWith(QLatin1Char(':'))) {
+        // Resources live in memory already; hand their bytes to the cache.
+        decode([path] {
+            QFile f(path);
+            if (!f.open(QIODevice::ReadOnly))
+                return Decoded{nullptr, QStringLiteral("cannot open %1").arg(path)};
+            const QByteArray bytes = f.readAll();
+            std::string err;
+            auto buf = cs::PcmCache::instance().acquireBytes(
+                path.toStdString(),
+                reinterpret_cast<const std::uint8_t *>(bytes.constData()),
+                static_cast<std::size_t>(bytes.size()), &err);
+            return Decoded{buf, buf ? QString() : decodeError(err)};
+        });
+        return;
     }
+
+    cs::PcmCache::Options options;
+    options.streamAboveSeconds = streamThreshold_;
+    decode([path, options] {
+        if (!QFile::exists(path))
+            return Decoded{nullptr, QStringLiteral("cannot open %1").arg(path)};
+        std::string err;
+        auto buf = cs::PcmCache::instance().acquireFile(path.toStdString(), options, &err);
+        return Decoded{buf, buf ? QString() : decodeError(err)};
+    });
 }
 
-bool SampleInstrument::applyLoadedBytes(const QByteArray &bytes)
+void SampleInstrument::decode(std::function<Decoded()> job)
 {
-    std::string err;
-    auto buf = cs::PcmBuffer::loadWavFromBytes(
-        reinterpret_cast<const std::uint8_t *>(bytes.constData()),
-        static_cast<std::size_t>(bytes.size()),
-        &err);
-    if (!buf) {
+#if QT_CONFIG(thread) && !defined(Q_OS_WASM)
+    // Without an application object there is no event loop to deliver
+    // the result; decode inline like the synchronous path.
+    if (asynchronous_ && QCoreApplication::instance()) {
+        decodeWatcher_.setFuture(QtConcurrent::run(std::move(job)));
+        return;
+    }
+#endif
+    applyDecoded(job());
+}
+
+void SampleInstrument::applyDecoded(const Decoded &d)
+{
+    if (!d.buffer) {
         buffer_.reset();
-        if (core_) core_->setSource(nullptr);
-        error_ = QString::fromStdString(err.empty() ? "load failed" : err);
+        applySourceToCore();
+        error_ = d.error;
         emit errorStringChanged();
         if (loaded_) { loaded_ = false; emit loadedChanged(); }
-        return false;
+        return;
     }
 
-    buffer_ = std::make_shared<cs::PcmBuffer>(std::move(*buf));
-    if (core_) {
-        core_->setSource(buffer_);
-        core_->setRootMidiNote(rootMidiNote_);
-    }
+    const bool wasStreaming = streaming();
+    buffer_ = d.buffer;
+    applySourceToCore();
     applyPatchToCore();
-    if (!loaded_) { loaded_ = true; emit loadedChanged(); }
+    if (!loaded_) {
+        loaded_ = true;
+        emit loadedChanged();
+    } else if (wasStreaming != streaming()) {
+        emit loadedChanged();
+    }
     if (!error_.isEmpty()) { error_.clear(); emit errorStringChanged(); }
-    return true;
 }
 
 void SampleInstrument::beginRemoteFetch(const QUrl &url)
@@ -238,14 +412,14 @@ void SampleInstrument::beginRemoteFetch(const QUrl &url)
                      QNetworkRequest::NoLessSafeRedirectPolicy);
     QNetworkReply *reply = nam_->get(req);
     activeReply_ = reply;
-    connect(reply, &QNetworkReply::finished, this, [this, reply] {
+    connect(reply, &QNetworkReply::finished, this, [this, reply, url] {
         // A newer fetch (e.g. setSource() called again) may have superseded
         // this one — drop the stale reply silently.
         if (activeReply_.data() != reply) { reply->deleteLater(); return; }
         activeReply_.clear();
         if (reply->error() != QNetworkReply::NoError) {
             buffer_.reset();
-            if (core_) core_->setSource(nullptr);
+            applySourceToCore();
             error_ = QStringLiteral("network error: %1").arg(reply->errorString());
             emit errorStringChanged();
             if (loaded_) { loaded_ = false; emit loadedChanged(); }
@@ -254,7 +428,14 @@ void SampleInstrument::beginRemoteFetch(const QUrl &url)
         }
         const QByteArray bytes = reply->readAll();
         reply->deleteLater();
-        applyLoadedBytes(bytes);
+        const std::string key = url.toString().toStdString();
+        decode([key, bytes] {
+            std::string err;
+            auto buf = cs::PcmCache::instance().acquireBytes(
+                key, reinterpret_cast<const std::uint8_t *>(bytes.constData()),
+                static_cast<std::size_t>(bytes.size()), &err);
+            return Decoded{buf, buf ? QString() : decodeError(err)};
+        });
     });
 }
 
@@ -272,8 +453,38 @@ void SampleInstrument::cancelInFlightReply()
 
 bool SampleInstrument::trigger(qreal freqHz, qreal velocity, qreal durationSeconds)
 {
-    if (!loaded_ || !buffer_ || freqHz <= 0.0) return false;
-    if (!core_ || coreId_ < 0) return false;
+    const int64_t frame = cs::AudioOutput::instance().currentFrame();
+    return scheduleAt(frame, freqHz, velocity, durationSeconds) != 0;
+}
+
+cs::EventId SampleInstrument::scheduleNote(int64_t frame, int midiNote,
+                                           qreal velocity, qreal durationSeconds)
+{
+    if (midiNote < 0 || midiNote > 127) return 0;
+    const qreal freq = 440.0 * std::pow(2.0, (midiNote - 69) / 12.0);
+    return scheduleAt(frame, freq, velocity, durationSeconds);
+}
+
+bool SampleInstrument::bounceSnapshot(cs::BounceInstrument *out) const
+{
+    if (!loaded_ || !buffer_) return false;
+    out->kind         = cs::BounceInstrument::Kind::Sampler;
+    out->sample       = patch_;
+    out->pcm          = buffer_;
+    out->rootMidiNote = rootMidiNote_;
+    out->gain         = static_cast<float>(volume_);
+    out->pan          = static_cast<float>(pan_);
+    out->priority     = priority_;
+    out->maxPolyphony = maxVoices_;
+    out->stealPolicy  = mapStealPolicy(stealPolicyName_);
+    return true;
+}
+
+cs::EventId SampleInstrument::scheduleAt(int64_t frame, qreal freqHz,
+                                         qreal velocity, qreal durationSeconds)
+{
+    if (!loaded_ || !buffer_ || freqHz <= 0.0) return 0;
+    if (!core_ || coreId_ < 0) return 0;
 
     auto& output = cs::AudioOutput::instance();
     output.start(); // idempotent; opens sink on first triggered note
@@ -295,17 +506,21 @@ bool SampleInstrument::trigger(qreal freqHz, qreal velocity, qreal durationSecon
         }
     }
 
-    auto& eng = output.engine();
     cs::NoteEvent ev;
-    ev.timeFrames     = eng.currentFrame();
+    ev.timeFrames     = frame;
     ev.durationFrames = static_cast<int64_t>(std::llround(dur * SAMPLE_RATE));
     ev.freqHz         = freqHz;
     ev.velocity       = static_cast<float>(std::clamp(velocity, 0.0, 1.0));
     ev.instrumentId   = coreId_;
-
-    const cs::EventId id = eng.schedule(ev);
-    core_->pushPatch(id, patch_);
-    return true;
+    ev.priority       = priority_;
+    ev.pan            = static_cast<float>(pan_);
+    ev.emitterId      = emitter_ ? emitter_->emitterId() : -1;
+
+    return output.schedule<cs::SamplerInstrument>(
+        ev, patch_,
+        [](cs::SamplerInstrument &inst, cs::EventId eventId, const cs::SampleVoice::Patch &p) {
+            inst.pushPatch(eventId, p);
+        });
 }
 
 bool SampleInstrument::triggerNote(int midiNote, qreal velocity, qreal durationSeconds)
@@ -324,24 +539,26 @@ void SampleInstrument::stopAll()
 {
     // Clear schedule + drop voices for THIS instrument only. The shared
     // engine's schedule is global, but voices are reaped if their owning
-    // instrument is unregistered/re-registered. Cheaper here: just drop
-    // the patches we still have queued and re-register the SamplerInstrument
-    // to drop active voices.
-    if (core_) core_->clearPatches();
+    // instrument is unregistered/re-registered, and its queued patches go
+    // with it.
     if (coreId_ >= 0) {
+        if (core_) {
+            stealsCarried_ += static_cast<int>(core_->voiceSteals());
+            droppedCarried_ += static_cast<int>(core_->droppedNotes());
+        }
         // unregister/register cycle drops active voices for this instrument
         // without disturbing the shared engine clock.
         cs::AudioOutput::instance().unregisterInstrument(coreId_);
         auto core = std::make_unique<cs::SamplerInstrument>();
+        core->setStreamer(&cs::AudioOutput::instance().streamer());
         core_ = core.get();
         coreId_ = cs::AudioOutput::instance().registerInstrument(std::move(core));
+        if (coreId_ < 0) core_ = nullptr;
         if (core_) {
             core_->setGain(static_cast<float>(volume_));
-            if (buffer_) {
-                core_->setSource(buffer_);
-                core_->setRootMidiNote(rootMidiNote_);
-            }
-            core_->setDefaultPatch(patch_);
+            applyVoiceLimitsToCore();
+            if (buffer_) applySourceToCore();
+            applyPatchToCore();
         }
     }
 }
@@ -351,10 +568,8 @@ QVector<float> SampleInstrument::renderOffline(qreal durationSeconds)
     const int frames = std::max(0, static_cast<int>(std::llround(durationSeconds * SAMPLE_RATE)));
     QVector<float> out(frames, 0.0f);
     if (frames == 0) return out;
-    // Per-instrument gain is applied inside the engine; we only need a
-    // final master clamp. See note in SynthInstrument::renderOffline.
-    cs::AudioOutput::instance().engine().renderOffline(out.data(), frames);
-    for (auto &s : out) s = std::clamp(s, -1.0f, 1.0f);
+    // Master clamp included. See note in SynthInstrument::renderOffline.
+    cs::AudioOutput::instance().renderOffline(out.data(), frames);
     return out;
 }
 
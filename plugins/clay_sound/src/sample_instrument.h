@@ -3,14 +3,22 @@
 // SampleInstrument — public QML-facing PCM sample player.
 // Mirrors SynthInstrument: registers a SamplerInstrument with the
 // shared clay::sound::AudioOutput singleton; WAV loaded on source
-// change; one-shot triggers via trigger()/triggerNote()/triggerOneShot().
+// change; one-shot triggers via trigger()/triggerNote()/triggerOneShot(),
+// frame-exact ones through NoteTarget (used by SongPlayer).
+//
+// Decoded PCM comes from clay::sound::PcmCache, so instruments playing
+// the same file share one int16 copy. Decoding runs on a worker thread
+// unless `asynchronous` is off or there is no application object (unit
+// tests); long local files are streamed from disk instead.
 
 #ifndef SAMPLE_INSTRUMENT_H
 #define SAMPLE_INSTRUMENT_H
 
 #include "engine/sample_voice.h"
+#include "note_target.h"
 
 #include <QByteArray>
+#include <QFutureWatcher>
 #include <QObject>
 #include <QPointer>
 #include <QQmlEngine>
@@ -18,6 +26,7 @@
 #include <QUrl>
 #include <QVector>
 
+#include <functional>
 #include <memory>
 
 QT_BEGIN_NAMESPACE
@@ -29,10 +38,12 @@ namespace clay::sound {
 struct PcmBuffer;
 class  SamplerInstrument;
 }
+class SoundEmitter;
 
-class SampleInstrument : public QObject
+class SampleInstrument : public QObject, public NoteTarget
 {
     Q_OBJECT
+    Q_INTERFACES(NoteTarget)
     QML_ELEMENT
 
     Q_PROPERTY(QUrl    source     READ source     WRITE setSource     NOTIFY sourceChanged)
@@ -43,10 +54,35 @@ class SampleInstrument : public QObject
     Q_PROPERTY(qreal   attack     READ attack     WRITE setAttack     NOTIFY attackChanged)
     Q_PROPERTY(qreal   release    READ release    WRITE setRelease    NOTIFY releaseChanged)
     Q_PROPERTY(qreal   volume     READ volume     WRITE setVolume     NOTIFY volumeChanged)
+    // Pitch-shift quality: "linear" (cheapest), "cubic", "sinc8" or
+    // "sinc16" (band-limited, no aliasing when transposing up). Applies
+    // to notes started afterwards.
+    Q_PROPERTY(QString interpolation READ interpolation WRITE setInterpolation NOTIFY interpolationChanged)
     Q_PROPERTY(bool    loaded     READ loaded     NOTIFY loadedChanged)
     Q_PROPERTY(int     activeVoices READ activeVoices NOTIFY activeVoicesChanged)
     Q_PROPERTY(QString errorString READ errorString NOTIFY errorStringChanged)
 
+    // Load off the GUI thread; `loaded` turns true once decoding is done.
+    Q_PROPERTY(bool    asynchronous    READ asynchronous    WRITE setAsynchronous    NOTIFY asynchronousChanged)
+    // Local files longer than this many seconds are streamed from disk
+    // rather than decoded into memory; 0 never streams. Applies to the
+    // next load.
+    Q_PROPERTY(qreal   streamThreshold READ streamThreshold WRITE setStreamThreshold NOTIFY streamThresholdChanged)
+    Q_PROPERTY(bool    streaming       READ streaming       NOTIFY loadedChanged)
+
+    // Polyphony limits, as on SynthInstrument. voiceSteals and
+    // droppedNotes keep counting across stopAll().
+    Q_PROPERTY(int     maxVoices    READ maxVoices    WRITE setMaxVoices    NOTIFY maxVoicesChanged)
+    Q_PROPERTY(QString stealPolicy  READ stealPolicy  WRITE setStealPolicy  NOTIFY stealPolicyChanged)
+    Q_PROPERTY(int     priority     READ priority     WRITE setPriority     NOTIFY priorityChanged)
+    Q_PROPERTY(int     voiceSteals  READ voiceSteals  NOTIFY voiceStatsChanged)
+    Q_PROPERTY(int     droppedNotes READ droppedNotes NOTIFY voiceStatsChanged)
+
+    // Stereo placement and mix bus, as on SynthInstrument.
+    Q_PROPERTY(qreal         pan     READ pan     WRITE setPan     NOTIFY panChanged)
+    Q_PROPERTY(int           bus     READ bus     WRITE setBus     NOTIFY busChanged)
+    Q_PROPERTY(SoundEmitter *emitter READ emitter WRITE setEmitter NOTIFY emitterChanged)
+
 public:
     explicit SampleInstrument(QObject *parent = nullptr);
     ~SampleInstrument() override;
@@ -71,10 +107,35 @@ public:
     qreal volume() const { return volume_; }
     void  setVolume(qreal v);
 
+    QString interpolation() const { return interpolationName_; }
+    void    setInterpolation(const QString &mode);
+
     bool   loaded() const { return loaded_; }
     int    activeVoices() const;
     QString errorString() const { return error_; }
 
+    bool  asynchronous() const { return asynchronous_; }
+    void  setAsynchronous(bool v);
+    qreal streamThreshold() const { return streamThreshold_; }
+    void  setStreamThreshold(qreal seconds);
+    bool  streaming() const;
+
+    int     maxVoices() const { return maxVoices_; }
+    void    setMaxVoices(int n);
+    QString stealPolicy() const { return stealPolicyName_; }
+    void    setStealPolicy(const QString &p);
+    int     priority() const { return priority_; }
+    void    setPriority(int p);
+    int     voiceSteals() const { return lastSteals_; }
+    int     droppedNotes() const { return lastDropped_; }
+
+    qreal         pan() const { return pan_; }
+    void          setPan(qreal p);
+    int           bus() const { return bus_; }
+    void          setBus(int b);
+    SoundEmitter *emitter() const { return emitter_; }
+    void          setEmitter(SoundEmitter *e);
+
     // Trigger by frequency (Hz); dur 0 = play until sample / loop ends.
     Q_INVOKABLE bool trigger(qreal freqHz,
                              qreal velocity = 1.0,
@@ -88,6 +149,12 @@ public:
     // Trigger at root pitch; used by Sound's play() path.
     Q_INVOKABLE bool triggerOneShot(qreal velocity = 1.0);
 
+    // NoteTarget: like triggerNote(), but starting at engine frame `frame`.
+    clay::sound::EventId scheduleNote(int64_t frame, int midiNote,
+                                      qreal velocity, qreal durationSeconds) override;
+    // NoteTarget: copy of the current sound for AudioBounce.
+    bool bounceSnapshot(clay::sound::BounceInstrument *out) const override;
+
     // Stop all currently playing voices at their next render step.
     Q_INVOKABLE void stopAll();
 
@@ -103,9 +170,19 @@ signals:
     void attackChanged();
     void releaseChanged();
     void volumeChanged();
+    void interpolationChanged();
     void loadedChanged();
     void activeVoicesChanged();
     void errorStringChanged();
+    void asynchronousChanged();
+    void streamThresholdChanged();
+    void maxVoicesChanged();
+    void stealPolicyChanged();
+    void priorityChanged();
+    void voiceStatsChanged();
+    void panChanged();
+    void busChanged();
+    void emitterChanged();
     // Emitted once all voices from a trigger() call have ended (used
     // by Sound's `finished` facade).
     void playbackFinished();
@@ -116,14 +193,30 @@ private slots:
 private:
     static constexpr int SAMPLE_RATE = 44100;
 
+    // Outcome of a decode job; buffer is null on failure.
+    struct Decoded
+    {
+        std::shared_ptr<const clay::sound::PcmBuffer> buffer;
+        QString error;
+    };
+
     void loadSource();
-    bool applyLoadedBytes(const QByteArray &bytes);
+    // Run `job` on a worker thread (or inline, see `asynchronous`) and
+    // hand its result to applyDecoded().
+    void decode(std::function<Decoded()> job);
+    void applyDecoded(const Decoded &d);
     void beginRemoteFetch(const QUrl &url);
     void cancelInFlightReply();
+    // Queue a note with the current patch at engine frame `frame`.
+    clay::sound::EventId scheduleAt(int64_t frame, qreal freqHz,
+                                    qreal velocity, qreal durationSeconds);
     void applyPatchToCore();
+    void applySourceToCore();
+    void applyVoiceLimitsToCore();
 
     // Raw ptr to the SamplerInstrument we registered with the shared
-    // AudioOutput's engine. Owned by the engine.
+    // AudioOutput's engine. Owned by the engine. Only its gain may be
+    // touched directly; everything else goes through AudioOutput::post().
     clay::sound::SamplerInstrument *core_ = nullptr;
     int  coreId_ = -1;
 
@@ -134,9 +227,26 @@ private:
     int     rootMidiNote_ = 60;
     QString error_;
     bool    loaded_ = false;
+    bool    asynchronous_ = true;
+    qreal   streamThreshold_ = 10.0;
+    QFutureWatcher<Decoded> decodeWatcher_;
 
     qreal volume_     = 1.0;
     int   lastActive_ = 0;
+    QString interpolationName_ = "linear";
+
+    int     maxVoices_ = 32;
+    QString stealPolicyName_ = "oldest";
+    int     priority_ = 0;
+    int     lastSteals_ = 0;
+    int     lastDropped_ = 0;
+    // Counts of cores retired by stopAll().
+    int     stealsCarried_ = 0;
+    int     droppedCarried_ = 0;
+
+    qreal                  pan_ = 0.0;
+    int                    bus_ = 0;
+    QPointer<SoundEmitter> emitter_;
 
     // Async fetch path for http/https sources (WASM, hot-reload servers).
     // Local file:/qrc: sources keep the synchronous QFile path.
@@ -2,16 +2,13 @@
 
 #include "softsynth.h"
 
+#include "audio_output.h"
 #include "engine/note_event.h"
-#include "engine/oscillator_voice.h"
 
-#include <QAudioSink>
-#include <QMediaDevices>
-#include <QAudioDevice>
 #include <QDebug>
+#include <QHash>
 #include <algorithm>
 #include <cmath>
-#include <cstring>
 
 namespace cs = clay::sound;
 
@@ -30,362 +27,350 @@ static cs::OscillatorVoice::Waveform mapWaveform(Voice::Waveform w)
     return W::Triangle;
 }
 
+namespace {
+
+void configureFilter(cs::BiquadFilter &filter, double cutoffHz)
+{
+    filter.setType(cs::BiquadFilter::Type::OnePoleLowPass);
+    filter.setFrequency(static_cast<float>(cutoffHz));
+}
+
+// The echo feeds half its wet level back, with undamped repeats. Delays
+// shorter than a frame switch it off.
+void configureEcho(cs::FeedbackDelay &delay, double mix, double seconds, int sampleRate)
+{
+    delay.setTime(static_cast<float>(seconds));
+    delay.setFeedback(static_cast<float>(mix * 0.5));
+    delay.setMix(static_cast<float>(mix));
+    delay.setDamping(0.0f);
+    delay.setBypassed(seconds * sampleRate < 1.0);
+}
+
+// Filter and echo per bus, shared by the SoftSynths mixed into it.
+struct BusEffects
+{
+    int filterId = -1;
+    int echoId = -1;
+    cs::BiquadFilter *filter = nullptr;
+    cs::FeedbackDelay *echo = nullptr;
+    int users = 0;
+};
+
+QHash<int, BusEffects> &busEffects()
+{
+    static QHash<int, BusEffects> effects;
+    return effects;
+}
+
+} // namespace
+
 SoftSynth::SoftSynth(QObject *parent)
     : QObject(parent)
 {
-    delayBuffer_.resize(SAMPLE_RATE, 0.0f);
-    connect(&renderTimer_, &QTimer::timeout, this, &SoftSynth::generateSamples);
 }
 
 SoftSynth::~SoftSynth()
 {
     stop();
+    detachBus();
+    if (instId_ >= 0) {
+        cs::AudioOutput::instance().unregisterInstrument(instId_);
+        inst_ = nullptr;
+        instId_ = -1;
+    }
+}
+
+bool SoftSynth::ensureRegistered()
+{
+    if (instId_ >= 0) return true;
+    auto &out = cs::AudioOutput::instance();
+    auto inst = std::make_unique<cs::CompositionInstrument>(out.sampleRate());
+    inst->setGain(static_cast<float>(volume_));
+    inst->setBus(bus_);
+    cs::CompositionInstrument *raw = inst.get();
+    instId_ = out.registerInstrument(std::move(inst));
+    if (instId_ < 0) {
+        qWarning() << "SoftSynth: cannot register with the audio output";
+        return false;
+    }
+    inst_ = raw;
+    attachBus();
+    return true;
+}
+
+void SoftSynth::attachBus()
+{
+    if (busAttached_ || instId_ < 0) return;
+    auto &out = cs::AudioOutput::instance();
+    BusEffects &fx = busEffects()[bus_];
+    if (fx.users == 0) {
+        auto filter = makeFilter(filterCutoff_, out.sampleRate());
+        auto echo = makeEcho(echoMix_, echoDelay_, out.sampleRate());
+        cs::BiquadFilter *filterRaw = filter.get();
+        cs::FeedbackDelay *echoRaw = echo.get();
+        fx.filterId = out.registerEffect(std::move(filter), bus_);
+        fx.echoId = out.registerEffect(std::move(echo), bus_);
+        fx.filter = fx.filterId >= 0 ? filterRaw : nullptr;
+        fx.echo = fx.echoId >= 0 ? echoRaw : nullptr;
+        if (!fx.filter || !fx.echo)
+            qWarning() << "SoftSynth: no free effect slot for the filter/echo of bus" << bus_;
+    }
+    ++fx.users;
+    busAttached_ = true;
+    applyEffects();
+}
+
+void SoftSynth::detachBus()
+{
+    if (!busAttached_) return;
+    busAttached_ = false;
+    auto it = busEffects().find(bus_);
+    if (it == busEffects().end() || --it->users > 0) return;
+    auto &out = cs::AudioOutput::instance();
+    if (it->filterId >= 0) out.unregisterEffect(it->filterId);
+    if (it->echoId >= 0) out.unregisterEffect(it->echoId);
+    busEffects().erase(it);
+}
+
+void SoftSynth::applyEffects()
+{
+    if (!busAttached_) return;
+    const BusEffects fx = busEffects().value(bus_);
+    const int rate = cs::AudioOutput::instance().sampleRate();
+    if (fx.filter) configureFilter(*fx.filter, filterCutoff_);
+    if (fx.echo) configureEcho(*fx.echo, echoMix_, echoDelay_, rate);
+}
+
+std::unique_ptr<cs::BiquadFilter> SoftSynth::makeFilter(double cutoffHz, int sampleRate)
+{
+    auto filter = std::make_unique<cs::BiquadFilter>(sampleRate);
+    configureFilter(*filter, cutoffHz);
+    return filter;
+}
+
+std::unique_ptr<cs::FeedbackDelay> SoftSynth::makeEcho(double mix, double delay, int sampleRate)
+{
+    auto echo = std::make_unique<cs::FeedbackDelay>(sampleRate, 1.0f);
+    configureEcho(*echo, mix, delay, sampleRate);
+    return echo;
 }
 
 void SoftSynth::setVolume(double volume)
 {
     volume_ = std::clamp(volume, 0.0, 1.0);
+    if (inst_) inst_->setGain(static_cast<float>(volume_));
 }
 
 void SoftSynth::setFilterCutoff(double hz)
 {
     filterCutoff_ = std::clamp(hz, 20.0, 20000.0);
+    applyEffects();
 }
 
 void SoftSynth::setEchoMix(double mix)
 {
     echoMix_ = std::clamp(mix, 0.0, 1.0);
+    applyEffects();
 }
 
 void SoftSynth::setEchoDelay(double seconds)
 {
     echoDelay_ = std::clamp(seconds, 0.0, 1.0);
+    applyEffects();
+}
+
+void SoftSynth::setBus(int bus)
+{
+    bus = std::clamp(bus, 0, cs::Engine::kMaxBuses - 1);
+    if (bus_ == bus) return;
+    const bool attached = busAttached_;
+    detachBus();
+    bus_ = bus;
+    if (inst_) inst_->setBus(bus_);
+    if (attached) attachBus();
+}
+
+std::shared_ptr<const SoftSynth::Prepared>
+SoftSynth::prepare(std::vector<NoteEvent> notes, double loopDuration, int sampleRate)
+{
+    auto p = std::make_shared<Prepared>();
+    std::sort(notes.begin(), notes.end(),
+              [](const NoteEvent &a, const NoteEvent &b) { return a.time < b.time; });
+    p->notes = std::move(notes);
+    p->loopDuration = loopDuration;
+    if (sampleRate > 0) {
+        p->sampleRate = sampleRate;
+        p->engine = makeComposition(p->notes, loopDuration, sampleRate);
+    }
+    return p;
 }
 
 void SoftSynth::scheduleNote(const NoteEvent &note)
 {
+    auto notes = composition_->notes;
     auto it = std::lower_bound(
-        composition_.begin(), composition_.end(), note,
+        notes.begin(), notes.end(), note,
         [](const NoteEvent &a, const NoteEvent &b) { return a.time < b.time; });
-    composition_.insert(it, note);
+    notes.insert(it, note);
+    auto p = std::make_shared<Prepared>();
+    p->notes = std::move(notes);
+    p->loopDuration = composition_->loopDuration;
+    composition_ = std::move(p);
+    if (playing_) postComposition(false);
 }
 
 void SoftSynth::loadComposition(const std::vector<NoteEvent> &notes, double loopDuration)
 {
-    auto sorted = notes;
-    std::sort(sorted.begin(), sorted.end(),
-              [](const NoteEvent &a, const NoteEvent &b) { return a.time < b.time; });
-
-    if (playing_) {
-        pendingComposition_ = std::move(sorted);
-        pendingLoopDuration_ = loopDuration;
-        if (fadeState_ == FadeNone) {
-            fadeState_ = FadingOut;
-            fadeProgress_ = 0.0;
-        }
-    } else {
-        composition_ = std::move(sorted);
-        loopDuration_ = loopDuration;
-        nextNoteIndex_ = 0;
-    }
+    loadComposition(prepare(notes, loopDuration, 0));
 }
 
-void SoftSynth::applyPendingComposition(int64_t currentFrame)
+void SoftSynth::loadComposition(std::shared_ptr<const Prepared> composition)
 {
-    composition_ = std::move(pendingComposition_);
-    loopDuration_ = pendingLoopDuration_;
-    pendingComposition_.clear();
+    if (!composition) return;
+    composition_ = std::move(composition);
 
-    // Seek nextNoteIndex_ to the first unfired note relative to the
-    // current frame.
-    const double currentTime = static_cast<double>(currentFrame) / SAMPLE_RATE;
-    nextNoteIndex_ = 0;
-    while (nextNoteIndex_ < composition_.size()
-           && composition_[nextNoteIndex_].time < currentTime)
-        ++nextNoteIndex_;
+    // While playing the render side fades the old loop out first.
+    if (playing_) postComposition(true);
+}
 
-    voices_.clear();
+std::shared_ptr<const cs::Composition> SoftSynth::engineComposition(int sampleRate) const
+{
+    if (composition_->engine && composition_->sampleRate == sampleRate)
+        return composition_->engine;
+    return makeComposition(composition_->notes, composition_->loopDuration, sampleRate);
+}
+
+void SoftSynth::postComposition(bool crossfade)
+{
+    if (instId_ < 0) return;
+    auto &out = cs::AudioOutput::instance();
+    // The shared_ptr is copied into the command; the render thread keeps
+    // its own reference until the next swap.
+    struct Swap { std::shared_ptr<const cs::Composition> composition; bool crossfade; };
+    out.post<cs::CompositionInstrument>(
+        instId_, Swap{engineComposition(out.sampleRate()), crossfade},
+        [](cs::CompositionInstrument &inst, cs::EventId, const Swap &s) {
+            inst.setComposition(s.composition, s.crossfade);
+        });
 }
 
 void SoftSynth::play()
 {
     if (playing_ && !paused_) return;
+    if (!ensureRegistered()) return;
 
-    currentFrame_ = 0;
-    nextNoteIndex_ = 0;
-    paused_ = false;
-    filterState_ = 0.0;
-    delayWritePos_ = 0;
-    std::fill(delayBuffer_.begin(), delayBuffer_.end(), 0.0f);
-    voices_.clear();
-
-    QAudioFormat format;
-    format.setSampleRate(SAMPLE_RATE);
-    format.setChannelCount(CHANNELS);
-    format.setSampleFormat(QAudioFormat::Float);
-
-    QAudioDevice outputDevice = QMediaDevices::defaultAudioOutput();
-    if (outputDevice.isNull()) {
-        qWarning() << "SoftSynth: No audio output device available";
-        return;
-    }
-
-    if (!outputDevice.isFormatSupported(format))
-        qWarning() << "SoftSynth: Default audio format not supported, trying closest match";
+    auto &out = cs::AudioOutput::instance();
+    // A paused loop restarts from the top, as before. The new loop note
+    // takes over the instrument's only voice.
+    if (loopEvent_) out.cancel(loopEvent_);
+    postComposition(false);
 
-    delete audioSink_;
-    audioSink_ = new QAudioSink(outputDevice, format, this);
-    audioDevice_ = audioSink_->start();
-
-    if (!audioDevice_) {
-        qWarning() << "SoftSynth: Failed to start audio sink";
-        delete audioSink_;
-        audioSink_ = nullptr;
-        return;
-    }
-
-    audioSink_->setBufferSize(SAMPLE_RATE * sizeof(float) / 5); // 200ms
+    cs::NoteEvent ev;
+    ev.timeFrames     = out.currentFrame();
+    ev.durationFrames = 0;          // until stop()
+    ev.instrumentId   = instId_;
+    loopEvent_ = out.schedule(ev);
+    out.start();
 
     playing_ = true;
-    renderTimer_.start(BUFFER_MS);
+    paused_ = false;
 }
 
 void SoftSynth::stop()
 {
+    if (playing_ && instId_ >= 0) {
+        auto &out = cs::AudioOutput::instance();
+        out.cancel(loopEvent_);
+        out.post<cs::CompositionInstrument>(
+            instId_, 0, [](cs::CompositionInstrument &inst, cs::EventId, const int &) {
+                inst.stop();
+            });
+    }
+    loopEvent_ = 0;
     playing_ = false;
     paused_ = false;
-    renderTimer_.stop();
-
-    if (audioSink_) {
-        audioSink_->stop();
-        delete audioSink_;
-        audioSink_ = nullptr;
-        audioDevice_ = nullptr;
-    }
-
-    voices_.clear();
 }
 
 void SoftSynth::pause()
 {
     if (!playing_ || paused_) return;
     paused_ = true;
-    renderTimer_.stop();
-    if (audioSink_) audioSink_->suspend();
+    cs::AudioOutput::instance().post<cs::CompositionInstrument>(
+        instId_, true, [](cs::CompositionInstrument &inst, cs::EventId, const bool &p) {
+            inst.setPaused(p);
+        });
 }
 
 void SoftSynth::resume()
 {
     if (!playing_ || !paused_) return;
     paused_ = false;
-    if (audioSink_) audioSink_->resume();
-    renderTimer_.start(BUFFER_MS);
+    cs::AudioOutput::instance().post<cs::CompositionInstrument>(
+        instId_, false, [](cs::CompositionInstrument &inst, cs::EventId, const bool &p) {
+            inst.setPaused(p);
+        });
 }
 
 double SoftSynth::position() const
 {
-    return static_cast<double>(currentFrame_) / SAMPLE_RATE;
+    if (!inst_) return 0.0;
+    return static_cast<double>(inst_->position()) / cs::AudioOutput::instance().sampleRate();
 }
 
-void SoftSynth::activateScheduledNotes(int64_t currentFrame)
-{
-    const double currentTime = static_cast<double>(currentFrame) / SAMPLE_RATE;
-
-    while (nextNoteIndex_ < composition_.size()
-           && composition_[nextNoteIndex_].time <= currentTime) {
-        const NoteEvent &note = composition_[nextNoteIndex_];
-
-        if (voices_.size() >= MAX_VOICES) {
-            // Steal the voice with the earliest isFinished() window —
-            // approximated by the front of the deque (oldest insertion).
-            voices_.erase(voices_.begin());
-        }
-
-        auto voice = std::make_unique<cs::OscillatorVoice>();
-
-        cs::OscillatorVoice::Patch p;
-        p.waveform   = mapWaveform(note.waveform);
-        p.attack     = note.attack;
-        p.decay      = note.decay;
-        p.sustain    = note.sustain;
-        p.release    = note.release;
-        p.pitchStart = note.pitchStart;
-        p.pitchEnd   = note.pitchEnd;
-        p.pitchTime  = note.pitchTime;
-        p.lfoRate    = note.lfoRate;
-        p.lfoDepth   = note.lfoDepth;
-        p.lfoTarget  = note.lfoTarget;
-        voice->setPatch(p);
-
-        cs::NoteEvent ev;
-        ev.timeFrames     = currentFrame;
-        ev.durationFrames = static_cast<int64_t>(std::llround(note.duration * SAMPLE_RATE));
-        ev.freqHz         = note.frequency;
-        ev.velocity       = static_cast<float>(note.gain);
-        voice->onNoteOn(ev, SAMPLE_RATE);
-
-        voices_.push_back(std::move(voice));
-        ++nextNoteIndex_;
-    }
-}
-
-void SoftSynth::pruneFinishedVoices(int64_t currentFrame)
-{
-    voices_.erase(
-        std::remove_if(voices_.begin(), voices_.end(),
-                       [currentFrame](const std::unique_ptr<cs::OscillatorVoice>& v) {
-                           return v->isFinished(currentFrame);
-                       }),
-        voices_.end());
-}
-
-void SoftSynth::mixActiveVoices(float *out, int frames, int64_t startFrame)
-{
-    // Per-sample activation keeps sample-accurate trigger timing;
-    // voices then render one sample into `out[i]` each.
-    for (int i = 0; i < frames; ++i) {
-        const int64_t f = startFrame + i;
-        activateScheduledNotes(f);
-        for (auto &v : voices_) {
-            float s = 0.0f;
-            v->render(&s, 1, f);
-            out[i] += s;
-        }
-        // Master volume applied after mix.
-        out[i] = static_cast<float>(out[i] * volume_);
-
-        // Reap finished voices one per frame (bounded work).
-        if (!voices_.empty() && voices_.front()->isFinished(f + 1))
-            pruneFinishedVoices(f + 1);
-    }
-}
-
-void SoftSynth::processFilter(float *buffer, int count)
+cs::OscillatorVoice::Patch SoftSynth::patchFor(const NoteEvent &note)
 {
-    constexpr double kPi = 3.14159265358979323846;
-    double rc = 1.0 / (2.0 * kPi * filterCutoff_);
-    double dt = 1.0 / static_cast<double>(SAMPLE_RATE);
-    double alpha = dt / (rc + dt);
-
-    for (int i = 0; i < count; ++i) {
-        filterState_ += alpha * (static_cast<double>(buffer[i]) - filterState_);
-        buffer[i] = static_cast<float>(filterState_);
-    }
+    cs::OscillatorVoice::Patch p;
+    p.waveform   = mapWaveform(note.waveform);
+    p.attack     = note.attack;
+    p.decay      = note.decay;
+    p.sustain    = note.sustain;
+    p.release    = note.release;
+    p.pitchStart = note.pitchStart;
+    p.pitchEnd   = note.pitchEnd;
+    p.pitchTime  = note.pitchTime;
+    p.lfoRate    = note.lfoRate;
+    p.lfoDepth   = note.lfoDepth;
+    p.lfoTarget  = note.lfoTarget;
+    return p;
 }
 
-void SoftSynth::processDelay(float *buffer, int count)
+std::shared_ptr<const cs::Composition>
+SoftSynth::makeComposition(const std::vector<NoteEvent> &notes, double loopDuration, int sampleRate)
 {
-    int delaySamples = static_cast<int>(echoDelay_ * SAMPLE_RATE);
-    if (delaySamples <= 0 || delaySamples >= static_cast<int>(delayBuffer_.size()))
-        return;
-
-    int bufSize = static_cast<int>(delayBuffer_.size());
-
-    for (int i = 0; i < count; ++i) {
-        int readPos = (delayWritePos_ - delaySamples + bufSize) % bufSize;
-        float delayed = delayBuffer_[readPos];
-        float output = buffer[i] + delayed * static_cast<float>(echoMix_);
-
-        delayBuffer_[delayWritePos_] = buffer[i] + delayed * static_cast<float>(echoMix_) * 0.5f;
-        delayWritePos_ = (delayWritePos_ + 1) % bufSize;
-
-        buffer[i] = output;
-    }
-}
-
-void SoftSynth::generateSamples()
-{
-    if (!playing_ || !audioDevice_ || !audioSink_)
-        return;
-
-    int bytesFree = audioSink_->bytesFree();
-    int samplesToWrite = bytesFree / static_cast<int>(sizeof(float));
-    if (samplesToWrite <= 0) return;
-    samplesToWrite = std::min(samplesToWrite, SAMPLE_RATE);
-
-    std::vector<float> buffer(samplesToWrite, 0.0f);
-
-    const int64_t loopFrames =
-        static_cast<int64_t>(std::llround(loopDuration_ * SAMPLE_RATE));
-
-    int written = 0;
-    while (written < samplesToWrite) {
-        // Respect the loop boundary: render up to it, then roll over.
-        int chunk = samplesToWrite - written;
-        if (loopFrames > 0) {
-            const int64_t untilLoop = loopFrames - currentFrame_;
-            if (untilLoop > 0 && untilLoop < chunk)
-                chunk = static_cast<int>(untilLoop);
-        }
-
-        mixActiveVoices(buffer.data() + written, chunk, currentFrame_);
-
-        // Per-sample crossfade pass (operates on what mixActiveVoices
-        // just wrote).
-        for (int i = 0; i < chunk; ++i) {
-            double fadeMul = 1.0;
-            if (fadeState_ == FadingOut) {
-                fadeMul = 1.0 - fadeProgress_;
-                fadeProgress_ += 1.0 / (FADE_DURATION * SAMPLE_RATE);
-                if (fadeProgress_ >= 1.0) {
-                    applyPendingComposition(currentFrame_ + i);
-                    fadeState_ = FadingIn;
-                    fadeProgress_ = 0.0;
-                    fadeMul = 0.0;
-                }
-            } else if (fadeState_ == FadingIn) {
-                fadeMul = fadeProgress_;
-                fadeProgress_ += 1.0 / (FADE_DURATION * SAMPLE_RATE);
-                if (fadeProgress_ >= 1.0) {
-                    fadeState_ = FadeNone;
-                    fadeMul = 1.0;
-                }
-            }
-            float s = buffer[written + i] * static_cast<float>(fadeMul);
-            buffer[written + i] = std::clamp(s, -1.0f, 1.0f);
-        }
-
-        currentFrame_ += chunk;
-        written += chunk;
-
-        // Loop rollover.
-        if (loopFrames > 0 && currentFrame_ >= loopFrames) {
-            currentFrame_ = 0;
-            nextNoteIndex_ = 0;
-            voices_.clear();
-        }
-    }
-
-    processFilter(buffer.data(), samplesToWrite);
-    processDelay(buffer.data(), samplesToWrite);
-    for (int i = 0; i < samplesToWrite; ++i)
-        buffer[i] = std::clamp(buffer[i], -1.0f, 1.0f);
-
-    const char *data = reinterpret_cast<const char *>(buffer.data());
-    qint64 bytesToWrite = samplesToWrite * static_cast<qint64>(sizeof(float));
-    qint64 writtenBytes = 0;
-    while (writtenBytes < bytesToWrite) {
-        qint64 c = audioDevice_->write(data + writtenBytes, bytesToWrite - writtenBytes);
-        if (c <= 0) break;
-        writtenBytes += c;
+    auto c = std::make_shared<cs::Composition>();
+    c->notes.reserve(notes.size());
+    for (const NoteEvent &note : notes) {
+        cs::CompositionNote n;
+        // A note sounds from the first frame at or after its time.
+        n.frame          = static_cast<int64_t>(std::ceil(note.time * sampleRate - 1e-9));
+        n.durationFrames = std::llround(note.duration * sampleRate);
+        n.freqHz         = note.frequency;
+        n.velocity       = static_cast<float>(note.gain);
+        n.patch          = patchFor(note);
+        c->notes.push_back(n);
     }
+    std::stable_sort(c->notes.begin(), c->notes.end(),
+                     [](const cs::CompositionNote &a, const cs::CompositionNote &b) {
+                         return a.frame < b.frame;
+                     });
+    c->loopFrames = std::llround(loopDuration * sampleRate);
+    return c;
 }
 
 void SoftSynth::renderOffline(float *output, int sampleCount)
 {
-    currentFrame_ = 0;
-    nextNoteIndex_ = 0;
-    filterState_ = 0.0;
-    delayWritePos_ = 0;
-    std::fill(delayBuffer_.begin(), delayBuffer_.end(), 0.0f);
-    voices_.clear();
-
-    std::memset(output, 0, sizeof(float) * static_cast<size_t>(sampleCount));
-    mixActiveVoices(output, sampleCount, currentFrame_);
-    currentFrame_ += sampleCount;
-
-    processFilter(output, sampleCount);
-    processDelay(output, sampleCount);
+    cs::Engine engine(SAMPLE_RATE, 1);
+    auto inst = std::make_unique<cs::CompositionInstrument>(SAMPLE_RATE);
+    inst->setComposition(engineComposition(SAMPLE_RATE), false);
+    inst->setGain(static_cast<float>(volume_));
+    const int id = engine.addInstrument(std::move(inst));
+    engine.addEffect(0, makeFilter(filterCutoff_, SAMPLE_RATE));
+    engine.addEffect(0, makeEcho(echoMix_, echoDelay_, SAMPLE_RATE));
+
+    cs::NoteEvent ev;
+    ev.instrumentId = id;
+    engine.schedule(ev);
+    engine.renderOffline(output, sampleCount);
     for (int i = 0; i < sampleCount; ++i)
         output[i] = std::clamp(output[i], -1.0f, 1.0f);
 }
@@ -1,24 +1,33 @@
 // (c) Clayground Contributors - MIT License, see "LICENSE" file
 //
-// SoftSynth — lightweight software synthesizer used by ChipMood.
-// As of Stage 1, the per-note DSP lives in clay::sound::OscillatorVoice
-// under src/engine/; SoftSynth is now the timing/mixer/filter/delay host
-// that drives those voices. The public API is unchanged.
+// SoftSynth — lightweight software synthesizer used by ChipMood and
+// ChipTracker. It plays a looping composition of patch-carrying notes
+// on the shared engine (see AudioOutput): the sequencing, voice
+// stealing and crossfade run on the render thread in a
+// clay::sound::CompositionInstrument, and the low-pass and echo are
+// effects on the SoftSynth's mix bus. So procedural music, instruments
+// and sounds share one sink and one clock.
+//
+// The filter and echo belong to the bus, not to one SoftSynth: synths
+// mixed into the same bus share them, the last setting made wins.
+// Nothing is registered with AudioOutput until the first play(), so a
+// SoftSynth used only for renderOffline() stays off the live engine.
 
 #ifndef SOFTSYNTH_H
 #define SOFTSYNTH_H
 
+#include "engine/biquad_filter.h"
+#include "engine/composition_instrument.h"
+#include "engine/engine.h"
+#include "engine/feedback_delay.h"
+#include "engine/oscillator_voice.h"
+#include "engine/scheduler.h"
 #include "voice_waveform.h"
 
 #include <QObject>
-#include <QAudioFormat>
-#include <QIODevice>
-#include <QTimer>
 #include <memory>
 #include <vector>
 
-class QAudioSink;
-
 // Per-note input format. Time/duration in seconds.
 struct NoteEvent
 {
@@ -45,8 +54,6 @@ struct NoteEvent
     int    lfoTarget = 0;
 };
 
-namespace clay::sound { class OscillatorVoice; struct NoteEvent; }
-
 class SoftSynth : public QObject
 {
     Q_OBJECT
@@ -60,8 +67,26 @@ public:
     void setEchoMix(double mix);
     void setEchoDelay(double seconds);
 
+    // A composition in both forms: the notes sorted by time and, if
+    // sampleRate > 0, the engine's version at that rate. Immutable, so it
+    // can be built on a worker thread and shared between synths.
+    struct Prepared
+    {
+        std::vector<NoteEvent> notes;
+        double loopDuration = 0.0;
+        int sampleRate = 0;
+        std::shared_ptr<const clay::sound::Composition> engine;
+    };
+
+    // Thread-safe; sampleRate 0 skips the engine form.
+    static std::shared_ptr<const Prepared>
+    prepare(std::vector<NoteEvent> notes, double loopDuration, int sampleRate);
+
     void scheduleNote(const NoteEvent &note);
     void loadComposition(const std::vector<NoteEvent> &notes, double loopDuration);
+    // Swap in a prepared composition. Prepared at the output's rate, this
+    // is a pointer swap: no sorting or conversion on the calling thread.
+    void loadComposition(std::shared_ptr<const Prepared> composition);
 
     void play();
     void stop();
@@ -70,62 +95,64 @@ public:
     bool isPlaying() const { return playing_; }
 
     double position() const;
-    double loopDuration() const { return loopDuration_; }
-    const std::vector<NoteEvent> &compositionData() const { return composition_; }
+    double loopDuration() const { return composition_->loopDuration; }
+    const std::vector<NoteEvent> &compositionData() const { return composition_->notes; }
+    const std::shared_ptr<const Prepared> &composition() const { return composition_; }
+
+    // Mix bus on the shared engine; the filter and echo sit on it.
+    static constexpr int DEFAULT_BUS = clay::sound::Engine::kMaxBuses - 1;
+    void setBus(int bus);
+    int bus() const { return bus_; }
 
+    // Render the composition from its start on a private engine, mono
+    // at 44.1 kHz. The live loop is not affected.
     void renderOffline(float *buffer, int sampleCount);
 
-private slots:
-    void generateSamples();
+    // Engine patch for a note's waveform, envelopes and LFO.
+    static clay::sound::OscillatorVoice::Patch patchFor(const NoteEvent &note);
+
+    // `notes` as an engine composition at `sampleRate`.
+    static std::shared_ptr<const clay::sound::Composition>
+    makeComposition(const std::vector<NoteEvent> &notes, double loopDuration, int sampleRate);
+
+    // The bus effects for these settings, for private engines.
+    static std::unique_ptr<clay::sound::BiquadFilter> makeFilter(double cutoffHz, int sampleRate);
+    static std::unique_ptr<clay::sound::FeedbackDelay> makeEcho(double mix, double delay, int sampleRate);
+
+    // Echo and filter settings, for rendering a composition elsewhere
+    // (AudioBounce).
+    double volume() const { return volume_; }
+    double filterCutoff() const { return filterCutoff_; }
+    double echoMix() const { return echoMix_; }
+    double echoDelay() const { return echoDelay_; }
 
 private:
-    static constexpr int SAMPLE_RATE = 44100;
-    static constexpr int CHANNELS = 1;
-    static constexpr int BUFFER_MS = 20;
-    static constexpr int BUFFER_SAMPLES = SAMPLE_RATE * BUFFER_MS / 1000;
-    static constexpr int MAX_VOICES = 32;
-
-    void activateScheduledNotes(int64_t currentFrame);
-    void pruneFinishedVoices(int64_t currentFrame);
-    void mixActiveVoices(float *out, int frames, int64_t startFrame);
-    void processFilter(float *buffer, int count);
-    void processDelay(float *buffer, int count);
-    void applyPendingComposition(int64_t currentFrame);
-
-    // Audio output
-    QAudioSink *audioSink_ = nullptr;
-    QIODevice *audioDevice_ = nullptr;
-    QTimer renderTimer_;
-
-    // Synth state
-    std::vector<std::unique_ptr<clay::sound::OscillatorVoice>> voices_;
-    int64_t currentFrame_ = 0;
-    double  volume_ = 0.7;
-    bool    playing_ = false;
-    bool    paused_ = false;
-
-    // Lowpass filter state (simple one-pole)
-    double filterCutoff_ = 8000.0;
-    double filterState_ = 0.0;
+    static constexpr int SAMPLE_RATE = 44100;    // renderOffline()
+
+    bool ensureRegistered();
+    void attachBus();
+    void detachBus();
+    void applyEffects();
+    void postComposition(bool crossfade);
+    // The engine form of composition_ at `sampleRate`, reused if prepared.
+    std::shared_ptr<const clay::sound::Composition> engineComposition(int sampleRate) const;
+
+    // Shared engine registration, made on the first play().
+    clay::sound::CompositionInstrument *inst_ = nullptr;
+    int instId_ = -1;
+    clay::sound::EventId loopEvent_ = 0;
+    int bus_ = DEFAULT_BUS;
+    bool busAttached_ = false;
+
+    double volume_ = 0.7;
+    bool   playing_ = false;
+    bool   paused_ = false;
 
-    // Echo delay line
-    std::vector<float> delayBuffer_;
-    int    delayWritePos_ = 0;
+    double filterCutoff_ = 8000.0;
     double echoDelay_ = 0.15;
     double echoMix_ = 0.3;
 
-    // Composition / scheduling
-    std::vector<NoteEvent> composition_;
-    double loopDuration_ = 0.0;
-    size_t nextNoteIndex_ = 0;
-
-    // Crossfade on composition swap
-    enum FadeState { FadeNone, FadingOut, FadingIn };
-    static constexpr double FADE_DURATION = 0.15; // 150ms
-    FadeState fadeState_ = FadeNone;
-    double fadeProgress_ = 0.0;
-    std::vector<NoteEvent> pendingComposition_;
-    double pendingLoopDuration_ = 0.0;
+    std::shared_ptr<const Prepared> composition_ = std::make_shared<const Prepared>();
 };
 
 #endif // SOFTSYNTH_H
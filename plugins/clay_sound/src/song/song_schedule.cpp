@@ -0,0 +1,58 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "song_schedule.h"
+
+#include <QHash>
+
+#include <algorithm>
+#include <cmath>
+
+namespace clay::sound {
+
+double flattenSong(const SongModel &model, QVector<SongNote> &out)
+{
+    out.clear();
+
+    QHash<QString, int> trackIndex;
+    for (auto it = model.tracks.begin(); it != model.tracks.end(); ++it)
+        trackIndex.insert(it.key(), static_cast<int>(trackIndex.size()));
+
+    // Compute pattern lengths (rounded up to next full beat).
+    QHash<QString, double> patternLength;
+    for (auto it = model.patterns.begin(); it != model.patterns.end(); ++it) {
+        double endBeat = 0.0;
+        for (auto tit = it->trackEvents.begin(); tit != it->trackEvents.end(); ++tit) {
+            for (const auto &n : tit.value())
+                endBeat = std::max(endBeat, n.t + n.dur);
+        }
+        patternLength.insert(it.key(), std::ceil(endBeat));
+    }
+
+    double cursor = 0.0;
+    for (const auto &sec : model.sections) {
+        if (!model.patterns.contains(sec.patternName)) continue;
+        const auto pattern = model.patterns.value(sec.patternName);
+        const double len = patternLength.value(sec.patternName, 1.0);
+        for (int rep = 0; rep < sec.repeat; ++rep) {
+            for (auto tit = pattern.trackEvents.begin(); tit != pattern.trackEvents.end(); ++tit) {
+                const int track = trackIndex.value(tit.key(), -1);
+                for (const auto &n : tit.value()) {
+                    SongNote sn;
+                    sn.beat     = cursor + n.t;
+                    sn.durBeats = n.dur;
+                    sn.vel      = n.vel;
+                    sn.midi     = n.midi;
+                    sn.track    = track;
+                    out.append(sn);
+                }
+            }
+            cursor += len;
+        }
+    }
+
+    std::sort(out.begin(), out.end(),
+              [](const SongNote &a, const SongNote &b) { return a.beat < b.beat; });
+    return cursor;
+}
+
+} // namespace clay::sound
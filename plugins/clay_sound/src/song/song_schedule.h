@@ -0,0 +1,33 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// SongSchedule — flattens a SongModel's sections into one list of notes
+// on an absolute beat axis, sorted by start. Shared by SongPlayer (live
+// playback) and AudioBounce (offline rendering), so both agree on
+// pattern lengths: a pattern lasts until its last note ends, rounded up
+// to a full beat.
+
+#ifndef CLAY_SOUND_SONG_SCHEDULE_H
+#define CLAY_SOUND_SONG_SCHEDULE_H
+
+#include "song_model.h"
+
+#include <QVector>
+
+namespace clay::sound {
+
+struct SongNote
+{
+    double beat = 0.0;      // absolute start in beats
+    double durBeats = 0.0;
+    double vel = 0.8;
+    int    midi = 60;
+    int    track = -1;      // index into SongModel::tracks (key order); -1 if unknown
+};
+
+// Notes of all sections in playback order, sorted by `beat`. Returns the
+// total song length in beats.
+double flattenSong(const SongModel &model, QVector<SongNote> &out);
+
+} // namespace clay::sound
+
+#endif // CLAY_SOUND_SONG_SCHEDULE_H
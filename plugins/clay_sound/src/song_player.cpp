@@ -2,6 +2,8 @@
 
 #include "song_player.h"
 
+#include "audio_output.h"
+#include "note_target.h"
 #include "song/song_parser.h"
 
 #include <QDebug>
@@ -19,7 +21,18 @@
 
 namespace {
 
+namespace cs = clay::sound;
+
 constexpr int kTickMs = 10;
+// How far ahead of the audio clock NoteTarget notes are queued. Must
+// cover the tick interval plus worst-case GUI stalls; notes beyond it
+// can still be cancelled when pausing or seeking.
+constexpr int kLookaheadMs = 150;
+// Song start offset on play(), so the first notes are not already late
+// when their commands reach the render thread.
+constexpr int kLeadInMs = 20;
+// Wall-clock fallback runs at the engine rate so frames stay comparable.
+constexpr int kWallSampleRate = 44100;
 
 QUrl resolveUrl(QObject *ctx, const QUrl &url)
 {
@@ -58,7 +71,10 @@ SongPlayer::SongPlayer(QObject *parent)
             this, &SongPlayer::onWatchedFileChanged);
 }
 
-SongPlayer::~SongPlayer() = default;
+SongPlayer::~SongPlayer()
+{
+    cancelQueuedNotes();
+}
 
 void SongPlayer::setSource(const QUrl &url)
 {
@@ -71,7 +87,14 @@ void SongPlayer::setSource(const QUrl &url)
 void SongPlayer::setInstruments(const QVariantList &list)
 {
     instrumentsVar_ = list;
+    const bool hadTargets = hasTargets_;
     rebuildInstrumentMap();
+    rebuildBindings();
+    if (playing_ && hasTargets_ != hadTargets) {
+        // The clock source depends on the targets; pick it again.
+        pause();
+        play();
+    }
     emit instrumentsChanged();
 }
 
@@ -79,6 +102,8 @@ void SongPlayer::setLoop(bool v)
 {
     if (loop_ == v) return;
     loop_ = v;
+    // Queued notes may belong to the next iteration.
+    if (playing_) resync(currentPosition());
     emit loopChanged();
 }
 
@@ -89,19 +114,37 @@ void SongPlayer::play()
         return;
     }
     if (playing_) return;
-    playing_ = true;
+
+    engineClock_ = false;
+    sampleRate_ = kWallSampleRate;
+    wallBaseFrame_ = 0;
+    if (hasTargets_) {
+        auto &output = cs::AudioOutput::instance();
+        output.start(); // idempotent; follows the engine once the sink runs
+        engineClock_ = output.isRunning();
+        sampleRate_ = output.sampleRate();
+        wallBaseFrame_ = output.currentFrame();
+    }
     wallClock_.start();
-    lastWallMs_ = 0;
+
+    playing_ = true;
+    const int64_t leadIn = hasTargets_ ? int64_t{sampleRate_} * kLeadInMs / 1000 : 0;
+    anchorAt(clockFrame() + leadIn);
     tickTimer_.start();
     emit playingChanged();
+    tick();
 }
 
 void SongPlayer::pause()
 {
     if (!playing_) return;
+    position_ = currentPosition();
+    cancelQueuedNotes();
     playing_ = false;
     tickTimer_.stop();
+    seekCursors(position_);
     emit playingChanged();
+    emit positionChanged();
 }
 
 void SongPlayer::stop()
@@ -109,8 +152,9 @@ void SongPlayer::stop()
     const bool wasPlaying = playing_;
     playing_ = false;
     tickTimer_.stop();
+    cancelQueuedNotes();
     position_ = 0.0;
-    nextIdx_ = 0;
+    seekCursors(0.0);
     if (wasPlaying) emit playingChanged();
     emit positionChanged();
 }
@@ -119,12 +163,7 @@ void SongPlayer::seek(qreal beats)
 {
     if (beats < 0.0) beats = 0.0;
     if (beats > totalBeats_) beats = totalBeats_;
-    position_ = beats;
-    // Find next scheduled event at or after this beat.
-    auto it = std::lower_bound(
-        schedule_.begin(), schedule_.end(), beats,
-        [](const ScheduledEvent &e, double b) { return e.beat < b; });
-    nextIdx_ = static_cast<int>(it - schedule_.begin());
+    resync(beats);
     emit positionChanged();
 }
 
@@ -132,45 +171,152 @@ void SongPlayer::tick()
 {
     if (!playing_) return;
 
-    const qint64 nowMs  = wallClock_.elapsed();
-    const qint64 dtMs   = nowMs - lastWallMs_;
-    lastWallMs_ = nowMs;
-    if (dtMs <= 0) return;
-
     const double bpm = model_.tempo > 0.0 ? model_.tempo : 120.0;
-    const double beatsPerMs = bpm / 60000.0;
-    const double newPos = position_ + static_cast<double>(dtMs) * beatsPerMs;
-
-    while (nextIdx_ < schedule_.size() && schedule_[nextIdx_].beat < newPos) {
-        const ScheduledEvent &ev = schedule_[nextIdx_];
-        QObject *inst = resolveInstrument(model_.tracks.value(ev.track).instrument);
-        if (inst) {
-            const double durSeconds = ev.durBeats * 60.0 / bpm;
-            QMetaObject::invokeMethod(inst, "triggerNote",
-                                      Q_ARG(int,   ev.midi),
-                                      Q_ARG(qreal, ev.vel),
-                                      Q_ARG(qreal, durSeconds));
+    const int64_t now = std::max(clockFrame(), anchorFrame_);
+    const double pos = beatAtFrame(now);
+
+    // NoteTarget tracks: queue every note that starts before the horizon
+    // at its exact frame.
+    if (hasTargets_) {
+        const double horizon = beatAtFrame(now + int64_t{sampleRate_} * kLookaheadMs / 1000);
+        for (; queueIdx_ < schedule_.size(); advanceCursor(queueIdx_, queueLoop_)) {
+            const double beat = cursorBeat(queueIdx_, queueLoop_);
+            if (beat >= horizon) break;
+            const ScheduledEvent &ev = schedule_[queueIdx_];
+            const TrackBinding b = bindingFor(ev);
+            if (!b.target) continue;
+            const int64_t frame = std::max(frameAtBeat(beat), now);
+            const cs::EventId id = b.target->scheduleNote(frame, ev.midi, ev.vel,
+                                                          ev.durBeats * 60.0 / bpm);
+            if (id != 0) queued_.append({ frame, id });
         }
-        ++nextIdx_;
+        // Notes that have started can no longer be cancelled.
+        queued_.erase(std::remove_if(queued_.begin(), queued_.end(),
+                                     [now](const QueuedNote &q) { return q.frame < now; }),
+                      queued_.end());
+    }
+
+    // Other instruments: trigger notes as the position passes them.
+    for (; triggerIdx_ < schedule_.size(); advanceCursor(triggerIdx_, triggerLoop_)) {
+        if (cursorBeat(triggerIdx_, triggerLoop_) >= pos) break;
+        const ScheduledEvent &ev = schedule_[triggerIdx_];
+        const TrackBinding b = bindingFor(ev);
+        if (!b.object || b.target) continue;
+        const double durSeconds = ev.durBeats * 60.0 / bpm;
+        QMetaObject::invokeMethod(b.object.data(), "triggerNote",
+                                  Q_ARG(int,   ev.midi),
+                                  Q_ARG(qreal, ev.vel),
+                                  Q_ARG(qreal, durSeconds));
     }
 
-    position_ = newPos;
+    position_ = currentPosition();
     emit positionChanged();
 
-    if (position_ >= totalBeats_) {
-        if (loop_) {
-            position_ = std::fmod(position_, totalBeats_);
-            nextIdx_ = 0;
-            emit positionChanged();
-        } else {
-            playing_ = false;
-            tickTimer_.stop();
-            emit playingChanged();
-            emit finished();
-        }
+    if (!loop_ && pos >= totalBeats_) {
+        playing_ = false;
+        tickTimer_.stop();
+        emit playingChanged();
+        emit finished();
+    }
+}
+
+// --- song clock --------------------------------------------------------
+
+int64_t SongPlayer::clockFrame() const
+{
+    if (engineClock_) return cs::AudioOutput::instance().currentFrame();
+    return wallBaseFrame_ + wallClock_.nsecsElapsed() * sampleRate_ / 1000000000;
+}
+
+double SongPlayer::framesPerBeat() const
+{
+    const double bpm = model_.tempo > 0.0 ? model_.tempo : 120.0;
+    return sampleRate_ * 60.0 / bpm;
+}
+
+double SongPlayer::beatAtFrame(int64_t frame) const
+{
+    return anchorBeat_ + static_cast<double>(frame - anchorFrame_) / framesPerBeat();
+}
+
+int64_t SongPlayer::frameAtBeat(double beat) const
+{
+    return anchorFrame_ + std::llround((beat - anchorBeat_) * framesPerBeat());
+}
+
+double SongPlayer::currentPosition() const
+{
+    if (!playing_) return position_;
+    const double pos = beatAtFrame(std::max(clockFrame(), anchorFrame_));
+    if (loop_ && totalBeats_ > 0.0) return std::fmod(pos, totalBeats_);
+    return std::min(pos, totalBeats_);
+}
+
+void SongPlayer::anchorAt(int64_t frame)
+{
+    anchorFrame_ = frame;
+    anchorBeat_ = position_;
+    seekCursors(position_);
+}
+
+void SongPlayer::resync(double beats)
+{
+    cancelQueuedNotes();
+    position_ = beats;
+    if (playing_)
+        anchorAt(clockFrame());
+    else
+        seekCursors(beats);
+}
+
+void SongPlayer::seekCursors(double beats)
+{
+    // Find next scheduled event at or after this beat.
+    auto it = std::lower_bound(
+        schedule_.begin(), schedule_.end(), beats,
+        [](const ScheduledEvent &e, double b) { return e.beat < b; });
+    queueIdx_ = triggerIdx_ = static_cast<int>(it - schedule_.begin());
+    queueLoop_ = triggerLoop_ = 0;
+}
+
+void SongPlayer::cancelQueuedNotes()
+{
+    if (queued_.isEmpty()) return;
+    // Cancelling a note that already fired is a no-op.
+    auto &output = cs::AudioOutput::instance();
+    for (const QueuedNote &q : std::as_const(queued_))
+        output.cancel(q.id);
+    queued_.clear();
+}
+
+double SongPlayer::cursorBeat(int idx, int loop) const
+{
+    return loop * totalBeats_ + schedule_[idx].beat;
+}
+
+void SongPlayer::advanceCursor(int &idx, int &loop) const
+{
+    if (++idx < schedule_.size()) return;
+    if (loop_ && totalBeats_ > 0.0) {
+        idx = 0;
+        ++loop;
     }
 }
 
+QObject *SongPlayer::trackInstrument(int track) const
+{
+    if (track < 0 || track >= bindings_.size()) return nullptr;
+    return bindings_[track].object.data();
+}
+
+SongPlayer::TrackBinding SongPlayer::bindingFor(const ScheduledEvent &ev) const
+{
+    if (ev.track < 0 || ev.track >= bindings_.size()) return {};
+    TrackBinding b = bindings_[ev.track];
+    if (!b.object) b.target = nullptr;   // instrument went away
+    return b;
+}
+
 void SongPlayer::reload()
 {
     cancelInFlightReply();
@@ -178,10 +324,10 @@ void SongPlayer::reload()
     loaded_ = false;
     schedule_.clear();
     totalBeats_ = 0.0;
-    position_ = 0.0;
-    nextIdx_ = 0;
+    resync(0.0);
     const double prevTempo = model_.tempo;
     model_ = {};
+    rebuildBindings();
 
     const QUrl url = resolveUrl(this, source_);
     if (url.isEmpty()) {
@@ -249,17 +395,15 @@ bool SongPlayer::applyParsedBytes(const QByteArray &bytes, const QString &watchP
     }
 
     const double prevTempo = model_.tempo;
+    const double pos = currentPosition();   // under the old tempo and length
     model_ = res.model;
     rebuildSchedule();
+    rebuildBindings();
 
-    if (hot) {
-        // Clamp position to the new range; re-seek the cursor.
-        if (position_ > totalBeats_) position_ = totalBeats_;
-        auto it = std::lower_bound(
-            schedule_.begin(), schedule_.end(), position_,
-            [](const ScheduledEvent &e, double b) { return e.beat < b; });
-        nextIdx_ = static_cast<int>(it - schedule_.begin());
-    }
+    // Clamp position to the new range and restart the song clock there
+    // (the tempo may have changed). Notes queued from the previous
+    // version are cancelled and re-queued from the new schedule.
+    resync(std::min(pos, totalBeats_));
 
     setError(QString());
     if (!hot) updateWatchedFile(watchPath);
@@ -332,48 +476,8 @@ void SongPlayer::updateWatchedFile(const QString &path)
 
 void SongPlayer::rebuildSchedule()
 {
-    schedule_.clear();
-    totalBeats_ = 0.0;
-    nextIdx_ = 0;
-
-    // Compute pattern lengths (rounded up to next full beat).
-    QHash<QString, double> patternLength;
-    for (auto it = model_.patterns.begin(); it != model_.patterns.end(); ++it) {
-        double endBeat = 0.0;
-        for (auto tit = it->trackEvents.begin(); tit != it->trackEvents.end(); ++tit) {
-            for (const auto &n : tit.value())
-                endBeat = std::max(endBeat, n.t + n.dur);
-        }
-        patternLength.insert(it.key(), std::ceil(endBeat));
-    }
-
-    double cursor = 0.0;
-    for (const auto &sec : std::as_const(model_.sections)) {
-        if (!model_.patterns.contains(sec.patternName)) continue;
-        const auto pattern = model_.patterns.value(sec.patternName);
-        const double len = patternLength.value(sec.patternName, 1.0);
-        for (int rep = 0; rep < sec.repeat; ++rep) {
-            for (auto tit = pattern.trackEvents.begin(); tit != pattern.trackEvents.end(); ++tit) {
-                const QString &track = tit.key();
-                for (const auto &n : tit.value()) {
-                    ScheduledEvent se;
-                    se.beat     = cursor + n.t;
-                    se.durBeats = n.dur;
-                    se.vel      = n.vel;
-                    se.midi     = n.midi;
-                    se.track    = track;
-                    schedule_.append(se);
-                }
-            }
-            cursor += len;
-        }
-    }
-
-    std::sort(schedule_.begin(), schedule_.end(),
-              [](const ScheduledEvent &a, const ScheduledEvent &b) {
-                  return a.beat < b.beat;
-              });
-    totalBeats_ = cursor;
+    // Tracks are numbered in key order, like bindings_; see rebuildBindings().
+    totalBeats_ = cs::flattenSong(model_, schedule_);
 }
 
 void SongPlayer::rebuildInstrumentMap()
@@ -388,6 +492,19 @@ void SongPlayer::rebuildInstrumentMap()
     }
 }
 
+void SongPlayer::rebuildBindings()
+{
+    bindings_.clear();
+    hasTargets_ = false;
+    for (const auto &track : std::as_const(model_.tracks)) {
+        TrackBinding b;
+        b.object = resolveInstrument(track.instrument);
+        b.target = qobject_cast<NoteTarget *>(b.object.data());
+        hasTargets_ = hasTargets_ || b.target;
+        bindings_.append(b);
+    }
+}
+
 void SongPlayer::setError(const QString &err)
 {
     if (error_ == err) return;
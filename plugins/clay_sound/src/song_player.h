@@ -12,14 +12,26 @@
 //   }
 //
 // The player resolves each track's `instrument` field against the
-// `objectName` of the provided instruments, then advances playback
-// position in beats on an internal timer, firing `triggerNote()` on
-// the matching instrument.
+// `objectName` of the provided instruments once, when the song or the
+// instrument list changes.
+//
+// Timing: tracks bound to a NoteTarget (SynthInstrument,
+// SampleInstrument) are pre-scheduled on the shared engine as NoteEvents
+// with exact frames, up to a short lookahead ahead of the audio clock
+// (AudioOutput::currentFrame()). Onsets are therefore sample-accurate
+// and independent of GUI-thread load; the internal timer only has to
+// come around once per lookahead window. Pausing, seeking and hot
+// reloads cancel the notes queued beyond the current position. Other
+// instruments get `triggerNote()` invoked as the position passes each
+// note. Without any NoteTarget, or if the sink cannot be opened, the
+// position follows a wall clock instead.
 
 #ifndef CLAY_SOUND_SONG_PLAYER_H
 #define CLAY_SOUND_SONG_PLAYER_H
 
+#include "engine/scheduler.h"
 #include "song/song_model.h"
+#include "song/song_schedule.h"
 
 #include <QElapsedTimer>
 #include <QFileSystemWatcher>
@@ -33,11 +45,15 @@
 #include <QVariantList>
 #include <QVector>
 
+#include <cstdint>
+
 QT_BEGIN_NAMESPACE
 class QNetworkAccessManager;
 class QNetworkReply;
 QT_END_NAMESPACE
 
+class NoteTarget;
+
 class SongPlayer : public QObject
 {
     Q_OBJECT
@@ -77,6 +93,12 @@ public:
     Q_INVOKABLE void stop();
     Q_INVOKABLE void seek(qreal beats);
 
+    // The parsed song and the instrument bound to each of its tracks
+    // (SongModel::tracks key order); nullptr for unresolved tracks.
+    // Used by AudioBounce.
+    const clay::sound::SongModel &model() const { return model_; }
+    QObject *trackInstrument(int track) const;
+
 signals:
     void sourceChanged();
     void instrumentsChanged();
@@ -95,20 +117,47 @@ private slots:
     void onWatchedFileChanged(const QString &path);
 
 private:
-    struct ScheduledEvent
+    // `track` indexes bindings_ (track order).
+    using ScheduledEvent = clay::sound::SongNote;
+
+    // A track's instrument, resolved once per song / instrument change.
+    struct TrackBinding
     {
-        double  beat = 0.0;
-        double  durBeats = 0.0;
-        double  vel = 0.8;
-        int     midi = 60;
-        QString track;
+        QPointer<QObject> object;
+        NoteTarget       *target = nullptr;   // set if `object` implements it
+    };
+
+    // A note queued on the engine that may still be cancelled.
+    struct QueuedNote
+    {
+        int64_t              frame = 0;
+        clay::sound::EventId id = 0;
     };
 
     void reload();      // full load: drops schedule, resets position
     void hotReload();   // re-parse; keep position, rebuild schedule
     void rebuildSchedule();
     void rebuildInstrumentMap();
+    void rebuildBindings();
     void setError(const QString &err);
+
+    // Song clock. Frames are engine frames when following the engine,
+    // wall-clock time at the engine rate otherwise. Beats are unwrapped:
+    // they keep growing across loop iterations.
+    int64_t clockFrame() const;
+    double  framesPerBeat() const;
+    double  beatAtFrame(int64_t frame) const;
+    int64_t frameAtBeat(double beat) const;
+    double  currentPosition() const;          // wrapped into [0, totalBeats]
+    // Restart the song clock at `frame` = position_ and re-seek cursors.
+    void    anchorAt(int64_t frame);
+    // Jump to `beats`: cancels queued notes, keeps playing if playing.
+    void    resync(double beats);
+    void    seekCursors(double beats);
+    void    cancelQueuedNotes();
+    double  cursorBeat(int idx, int loop) const;
+    void    advanceCursor(int &idx, int &loop) const;
+    TrackBinding bindingFor(const ScheduledEvent &ev) const;
     void updateWatchedFile(const QString &path);
     QObject *resolveInstrument(const QString &name) const;
 
@@ -128,8 +177,18 @@ private:
 
     clay::sound::SongModel model_;
     QVector<ScheduledEvent> schedule_;
+    QVector<TrackBinding>   bindings_;
+    bool              hasTargets_ = false;    // some track is a NoteTarget
     double            totalBeats_ = 0.0;
-    int               nextIdx_ = 0;
+
+    // Two cursors into schedule_ (index + loop iteration): NoteTarget
+    // notes are queued up to the lookahead horizon, the rest are
+    // triggered when the position reaches them.
+    int               queueIdx_ = 0;
+    int               queueLoop_ = 0;
+    int               triggerIdx_ = 0;
+    int               triggerLoop_ = 0;
+    QVector<QueuedNote> queued_;
 
     bool              loaded_  = false;
     bool              playing_ = false;
@@ -139,7 +198,11 @@ private:
 
     QTimer             tickTimer_;
     QElapsedTimer      wallClock_;
-    qint64             lastWallMs_ = 0;
+    bool               engineClock_ = false;  // following AudioOutput::currentFrame()
+    int64_t            wallBaseFrame_ = 0;    // clockFrame() when wallClock_ started
+    int                sampleRate_ = 44100;
+    int64_t            anchorFrame_ = 0;      // clock frame at which the song...
+    double             anchorBeat_ = 0.0;     // ...was at this (unwrapped) beat
 
     QFileSystemWatcher watcher_;
     QString            watchedPath_;
@@ -0,0 +1,64 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "sound_emitter.h"
+
+#include "audio_output.h"
+
+namespace cs = clay::sound;
+
+SoundEmitter::SoundEmitter(QObject *parent)
+    : QObject(parent)
+{
+    id_ = cs::AudioOutput::instance().registerEmitter();
+    if (id_ < 0)
+        qWarning("SoundEmitter: out of emitters; notes will play unplaced");
+    push();
+}
+
+SoundEmitter::~SoundEmitter()
+{
+    cs::AudioOutput::instance().unregisterEmitter(id_);
+}
+
+void SoundEmitter::setPosition(const QVector3D &p)
+{
+    if (position_ == p) return;
+    position_ = p;
+    push();
+    emit positionChanged();
+}
+
+void SoundEmitter::setRefDistance(qreal d)
+{
+    if (refDistance_ == d) return;
+    refDistance_ = d;
+    push();
+    emit refDistanceChanged();
+}
+
+void SoundEmitter::setMaxDistance(qreal d)
+{
+    if (maxDistance_ == d) return;
+    maxDistance_ = d;
+    push();
+    emit maxDistanceChanged();
+}
+
+void SoundEmitter::setRolloff(qreal r)
+{
+    if (rolloff_ == r) return;
+    rolloff_ = r;
+    push();
+    emit rolloffChanged();
+}
+
+void SoundEmitter::push()
+{
+    if (id_ < 0) return;
+    cs::Emitter e;
+    e.position    = { position_.x(), position_.y(), position_.z() };
+    e.refDistance = static_cast<float>(refDistance_);
+    e.maxDistance = static_cast<float>(maxDistance_);
+    e.rolloff     = static_cast<float>(rolloff_);
+    cs::AudioOutput::instance().updateEmitter(id_, e);
+}
@@ -0,0 +1,64 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// SoundEmitter — a positional sound source in world space. Instruments
+// (SynthInstrument, SampleInstrument, Sound) with `emitter` set play
+// their notes from it: the engine re-derives each such voice's pan and
+// distance attenuation from the emitter and AudioMixer's listener at
+// control rate, so moving the emitter moves notes that are already
+// ringing. Units are arbitrary but must match the listener's.
+//
+//   SoundEmitter { id: engineHum; position: car.position; refDistance: 2 }
+//   SynthInstrument { emitter: engineHum }
+
+#ifndef CLAY_SOUND_SOUND_EMITTER_H
+#define CLAY_SOUND_SOUND_EMITTER_H
+
+#include <QObject>
+#include <QQmlEngine>
+#include <QVector3D>
+
+class SoundEmitter : public QObject
+{
+    Q_OBJECT
+    QML_ELEMENT
+
+    Q_PROPERTY(QVector3D position    READ position    WRITE setPosition    NOTIFY positionChanged)
+    // Full volume up to refDistance, inverse-distance falloff scaled by
+    // rolloff (0 disables it) and no further attenuation past maxDistance.
+    Q_PROPERTY(qreal     refDistance READ refDistance WRITE setRefDistance NOTIFY refDistanceChanged)
+    Q_PROPERTY(qreal     maxDistance READ maxDistance WRITE setMaxDistance NOTIFY maxDistanceChanged)
+    Q_PROPERTY(qreal     rolloff     READ rolloff     WRITE setRolloff     NOTIFY rolloffChanged)
+
+public:
+    explicit SoundEmitter(QObject *parent = nullptr);
+    ~SoundEmitter() override;
+
+    QVector3D position() const { return position_; }
+    void      setPosition(const QVector3D &p);
+    qreal     refDistance() const { return refDistance_; }
+    void      setRefDistance(qreal d);
+    qreal     maxDistance() const { return maxDistance_; }
+    void      setMaxDistance(qreal d);
+    qreal     rolloff() const { return rolloff_; }
+    void      setRolloff(qreal r);
+
+    // Engine emitter id for NoteEvent::emitterId; -1 if none was free.
+    int emitterId() const { return id_; }
+
+signals:
+    void positionChanged();
+    void refDistanceChanged();
+    void maxDistanceChanged();
+    void rolloffChanged();
+
+private:
+    void push();
+
+    int       id_ = -1;
+    QVector3D position_;
+    qreal     refDistance_ = 1.0;
+    qreal     maxDistance_ = 100.0;
+    qreal     rolloff_ = 1.0;
+};
+
+#endif // CLAY_SOUND_SOUND_EMITTER_H
@@ -3,10 +3,12 @@
 #include "synth_instrument.h"
 
 #include "audio_output.h"
+#include "engine/bounce.h"
 #include "engine/engine.h"
 #include "engine/note_event.h"
 #include "engine/oscillator_instrument.h"
 #include "engine/pcm_buffer.h"
+#include "sound_emitter.h"
 
 #include <QCryptographicHash>
 #include <QDebug>
@@ -31,6 +33,14 @@ static cs::OscillatorVoice::Waveform mapWaveform(const QString &name)
     return W::Sine;
 }
 
+static cs::IInstrument::StealPolicy mapStealPolicy(const QString &name)
+{
+    using P = cs::IInstrument::StealPolicy;
+    if (name == "quietest") return P::Quietest;
+    if (name == "priority") return P::LowestPriority;
+    return P::Oldest;
+}
+
 static int mapLfoTarget(const QString &name)
 {
     if (name == "pitch")  return 1;
@@ -42,12 +52,14 @@ SynthInstrument::SynthInstrument(QObject *parent)
     : QObject(parent)
 {
     // Register an OscillatorInstrument with the shared AudioOutput;
-    // keep a raw pointer so we can push per-event patches. The engine
-    // owns the instrument and will drop it (plus any active voices)
-    // when we unregister in the destructor.
+    // keep a raw pointer for its (atomic) gain. Patches travel to the
+    // render thread through AudioOutput commands. The engine owns the
+    // instrument and will drop it (plus any active voices) when we
+    // unregister in the destructor.
     auto osc = std::make_unique<cs::OscillatorInstrument>();
     oscInst_ = osc.get();
     oscInstId_ = cs::AudioOutput::instance().registerInstrument(std::move(osc));
+    if (oscInstId_ < 0) oscInst_ = nullptr;
 
     // Sensible default patch: short organ-like ping.
     patch_.waveform = cs::OscillatorVoice::Waveform::Sine;
@@ -55,8 +67,12 @@ SynthInstrument::SynthInstrument(QObject *parent)
     patch_.decay    = 0.05;
     patch_.sustain  = 0.6;
     patch_.release  = 0.1;
-    oscInst_->setDefaultPatch(patch_);
-    oscInst_->setGain(static_cast<float>(volume_));
+    applyPatchToCore();
+    if (oscInst_) {
+        oscInst_->setGain(static_cast<float>(volume_));
+        oscInst_->setMaxPolyphony(maxVoices_);
+        oscInst_->setBus(bus_);
+    }
 
     connect(&cs::AudioOutput::instance(), &cs::AudioOutput::afterPull,
             this, &SynthInstrument::onAfterPull);
@@ -78,7 +94,7 @@ void SynthInstrument::setWaveform(const QString &w)
     if (w == waveformName_) return;
     waveformName_ = w;
     patch_.waveform = mapWaveform(w);
-    oscInst_->setDefaultPatch(patch_);
+    applyPatchToCore();
     emit waveformChanged();
 }
 
@@ -87,7 +103,7 @@ void SynthInstrument::setAttack(qreal v)
     v = std::max(0.0, v);
     if (patch_.attack == v) return;
     patch_.attack = v;
-    oscInst_->setDefaultPatch(patch_);
+    applyPatchToCore();
     emit attackChanged();
 }
 
@@ -96,7 +112,7 @@ void SynthInstrument::setDecay(qreal v)
     v = std::max(0.0, v);
     if (patch_.decay == v) return;
     patch_.decay = v;
-    oscInst_->setDefaultPatch(patch_);
+    applyPatchToCore();
     emit decayChanged();
 }
 
@@ -105,7 +121,7 @@ void SynthInstrument::setSustain(qreal v)
     v = std::clamp(v, 0.0, 1.0);
     if (patch_.sustain == v) return;
     patch_.sustain = v;
-    oscInst_->setDefaultPatch(patch_);
+    applyPatchToCore();
     emit sustainChanged();
 }
 
@@ -114,7 +130,7 @@ void SynthInstrument::setRelease(qreal v)
     v = std::max(0.0, v);
     if (patch_.release == v) return;
     patch_.release = v;
-    oscInst_->setDefaultPatch(patch_);
+    applyPatchToCore();
     emit releaseChanged();
 }
 
@@ -122,7 +138,7 @@ void SynthInstrument::setPitchStart(qreal v)
 {
     if (patch_.pitchStart == v) return;
     patch_.pitchStart = v;
-    oscInst_->setDefaultPatch(patch_);
+    applyPatchToCore();
     emit pitchStartChanged();
 }
 
@@ -130,7 +146,7 @@ void SynthInstrument::setPitchEnd(qreal v)
 {
     if (patch_.pitchEnd == v) return;
     patch_.pitchEnd = v;
-    oscInst_->setDefaultPatch(patch_);
+    applyPatchToCore();
     emit pitchEndChanged();
 }
 
@@ -139,7 +155,7 @@ void SynthInstrument::setPitchTime(qreal v)
     v = std::max(0.0, v);
     if (patch_.pitchTime == v) return;
     patch_.pitchTime = v;
-    oscInst_->setDefaultPatch(patch_);
+    applyPatchToCore();
     emit pitchTimeChanged();
 }
 
@@ -148,7 +164,7 @@ void SynthInstrument::setLfoRate(qreal v)
     v = std::max(0.0, v);
     if (patch_.lfoRate == v) return;
     patch_.lfoRate = v;
-    oscInst_->setDefaultPatch(patch_);
+    applyPatchToCore();
     emit lfoRateChanged();
 }
 
@@ -157,7 +173,7 @@ void SynthInstrument::setLfoDepth(qreal v)
     v = std::max(0.0, v);
     if (patch_.lfoDepth == v) return;
     patch_.lfoDepth = v;
-    oscInst_->setDefaultPatch(patch_);
+    applyPatchToCore();
     emit lfoDepthChanged();
 }
 
@@ -166,7 +182,7 @@ void SynthInstrument::setLfoTarget(const QString &t)
     if (t == lfoTargetName_) return;
     lfoTargetName_ = t;
     patch_.lfoTarget = mapLfoTarget(t);
-    oscInst_->setDefaultPatch(patch_);
+    applyPatchToCore();
     emit lfoTargetChanged();
 }
 
@@ -179,11 +195,68 @@ void SynthInstrument::setVolume(qreal v)
     emit volumeChanged();
 }
 
+void SynthInstrument::setMaxVoices(int n)
+{
+    n = std::clamp(n, 1, cs::OscillatorInstrument::kPoolVoices);
+    if (maxVoices_ == n) return;
+    maxVoices_ = n;
+    if (oscInst_) oscInst_->setMaxPolyphony(n);
+    emit maxVoicesChanged();
+}
+
+void SynthInstrument::setStealPolicy(const QString &p)
+{
+    if (p == stealPolicyName_) return;
+    stealPolicyName_ = p;
+    if (oscInst_) oscInst_->setStealPolicy(mapStealPolicy(p));
+    emit stealPolicyChanged();
+}
+
+void SynthInstrument::setPriority(int p)
+{
+    if (priority_ == p) return;
+    priority_ = p;
+    emit priorityChanged();
+}
+
+void SynthInstrument::setPan(qreal p)
+{
+    p = std::clamp(p, -1.0, 1.0);
+    if (pan_ == p) return;
+    pan_ = p;
+    emit panChanged();
+}
+
+void SynthInstrument::setBus(int b)
+{
+    b = std::clamp(b, 0, cs::Engine::kMaxBuses - 1);
+    if (bus_ == b) return;
+    bus_ = b;
+    if (oscInst_) oscInst_->setBus(b);
+    emit busChanged();
+}
+
+void SynthInstrument::setEmitter(SoundEmitter *e)
+{
+    if (emitter_ == e) return;
+    emitter_ = e;
+    emit emitterChanged();
+}
+
 int SynthInstrument::activeVoices() const
 {
     if (oscInstId_ < 0) return 0;
-    return static_cast<int>(
-        cs::AudioOutput::instance().engine().activeVoices(oscInstId_));
+    return cs::AudioOutput::instance().activeVoices(oscInstId_);
+}
+
+void SynthInstrument::applyPatchToCore()
+{
+    if (oscInstId_ < 0) return;
+    cs::AudioOutput::instance().post<cs::OscillatorInstrument>(
+        oscInstId_, patch_,
+        [](cs::OscillatorInstrument &inst, cs::EventId, const cs::OscillatorVoice::Patch &p) {
+            inst.setDefaultPatch(p);
+        });
 }
 
 void SynthInstrument::onAfterPull()
@@ -193,6 +266,15 @@ void SynthInstrument::onAfterPull()
         lastActive_ = av;
         emit activeVoicesChanged();
     }
+    if (oscInst_) {
+        const int steals = static_cast<int>(oscInst_->voiceSteals());
+        const int dropped = static_cast<int>(oscInst_->droppedNotes());
+        if (steals != lastSteals_ || dropped != lastDropped_) {
+            lastSteals_ = steals;
+            lastDropped_ = dropped;
+            emit voiceStatsChanged();
+        }
+    }
 }
 
 // --- triggering --------------------------------------------------------
@@ -200,28 +282,62 @@ void SynthInstrument::onAfterPull()
 bool SynthInstrument::trigger(qreal freqHz, qreal velocity, qreal durationSeconds)
 {
     if (freqHz <= 0.0 || durationSeconds <= 0.0) return false;
-    if (!oscInst_ || oscInstId_ < 0) return false;
+    // Fire on the next render pass.
+    const int64_t frame = cs::AudioOutput::instance().currentFrame();
+    return scheduleAt(frame, freqHz, velocity, durationSeconds) != 0;
+}
+
+bool SynthInstrument::triggerNote(int midiNote, qreal velocity, qreal durationSeconds)
+{
+    const qreal freq = 440.0 * std::pow(2.0, (midiNote - 69) / 12.0);
+    return trigger(freq, velocity, durationSeconds);
+}
+
+cs::EventId SynthInstrument::scheduleNote(int64_t frame, int midiNote,
+                                          qreal velocity, qreal durationSeconds)
+{
+    if (midiNote < 0 || midiNote > 127 || durationSeconds <= 0.0) return 0;
+    const qreal freq = 440.0 * std::pow(2.0, (midiNote - 69) / 12.0);
+    return scheduleAt(frame, freq, velocity, durationSeconds);
+}
+
+bool SynthInstrument::bounceSnapshot(cs::BounceInstrument *out) const
+{
+    out->kind         = cs::BounceInstrument::Kind::Oscillator;
+    out->oscillator   = patch_;
+    out->gain         = static_cast<float>(volume_);
+    out->pan          = static_cast<float>(pan_);
+    out->priority     = priority_;
+    out->maxPolyphony = maxVoices_;
+    out->stealPolicy  = mapStealPolicy(stealPolicyName_);
+    return true;
+}
+
+cs::EventId SynthInstrument::scheduleAt(int64_t frame, qreal freqHz,
+                                        qreal velocity, qreal durationSeconds)
+{
+    if (!oscInst_ || oscInstId_ < 0) return 0;
 
     auto& output = cs::AudioOutput::instance();
     output.start(); // idempotent; opens the sink on first triggered note
 
-    auto& eng = output.engine();
     cs::NoteEvent ev;
-    ev.timeFrames     = eng.currentFrame();  // fire on the next render pass
+    ev.timeFrames     = frame;
     ev.durationFrames = static_cast<int64_t>(std::llround(durationSeconds * SAMPLE_RATE));
     ev.freqHz         = freqHz;
     ev.velocity       = static_cast<float>(std::clamp(velocity, 0.0, 1.0));
     ev.instrumentId   = oscInstId_;
-
-    const cs::EventId id = eng.schedule(ev);
-    oscInst_->pushPatch(id, patch_);
-    return true;
-}
-
-bool SynthInstrument::triggerNote(int midiNote, qreal velocity, qreal durationSeconds)
-{
-    const qreal freq = 440.0 * std::pow(2.0, (midiNote - 69) / 12.0);
-    return trigger(freq, velocity, durationSeconds);
+    ev.priority       = priority_;
+    ev.pan            = static_cast<float>(pan_);
+    ev.emitterId      = emitter_ ? emitter_->emitterId() : -1;
+
+    // The patch rides along with the note, so it is queued on the render
+    // thread right before the scheduler can spawn the voice.
+    return output.schedule<cs::OscillatorInstrument>(
+        ev, patch_,
+        [](cs::OscillatorInstrument &inst, cs::EventId eventId, const cs::OscillatorVoice::Patch &p) {
+            inst.pushPatch(eventId, p);
+        });
 }
 
 QVector<float> SynthInstrument::renderOffline(qreal durationSeconds)
@@ -229,14 +345,12 @@ QVector<float> SynthInstrument::renderOffline(qreal durationSeconds)
     const int frames = std::max(0, static_cast<int>(std::llround(durationSeconds * SAMPLE_RATE)));
     QVector<float> out(frames, 0.0f);
     if (frames == 0) return out;
-    // Render the shared engine. Per-instrument gain is already applied
-    // inside the engine; we only need a final master clamp to mirror
-    // what the live sink does. Note: this is destructive — it advances
-    // the shared engine's clock and consumes scheduled events. Intended
-    // for tests and headless preview; production playback goes through
-    // AudioOutput's pull timer, which is the only other caller.
-    cs::AudioOutput::instance().engine().renderOffline(out.data(), frames);
-    for (auto &s : out) s = std::clamp(s, -1.0f, 1.0f);
+    // Render the shared engine, master clamp included, exactly as the
+    // live sink would. Note: this is destructive — it advances the
+    // shared engine's clock and consumes scheduled events. Intended for
+    // tests and headless preview; production playback goes through
+    // AudioOutput's render thread, which is the only other caller.
+    cs::AudioOutput::instance().renderOffline(out.data(), frames);
     return out;
 }
 
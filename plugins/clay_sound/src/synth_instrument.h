@@ -3,7 +3,8 @@
 // SynthInstrument — public QML-facing oscillator instrument.
 // Registers a clay::sound::OscillatorInstrument with the shared
 // clay::sound::AudioOutput singleton, exposes a patch via QProperties,
-// and fires one-shot notes via trigger()/triggerNote(). Used for SFX
+// and fires one-shot notes via trigger()/triggerNote(), or at an exact
+// engine frame through NoteTarget (used by SongPlayer). Used for SFX
 // (jumps, pickups, explosions) and simple procedural music beds.
 //
 // Multiple SynthInstruments coexist by sharing the same Engine + sink;
@@ -14,17 +15,21 @@
 #define SYNTH_INSTRUMENT_H
 
 #include "engine/oscillator_voice.h"
+#include "note_target.h"
 
 #include <QObject>
+#include <QPointer>
 #include <QQmlEngine>
 #include <QString>
 #include <QVector>
 
 namespace clay::sound { class OscillatorInstrument; }
+class SoundEmitter;
 
-class SynthInstrument : public QObject
+class SynthInstrument : public QObject, public NoteTarget
 {
     Q_OBJECT
+    Q_INTERFACES(NoteTarget)
     QML_ELEMENT
 
     Q_PROPERTY(QString waveform    READ waveform    WRITE setWaveform    NOTIFY waveformChanged)
@@ -42,6 +47,23 @@ class SynthInstrument : public QObject
 
     Q_PROPERTY(int activeVoices READ activeVoices NOTIFY activeVoicesChanged)
 
+    // Polyphony: at most maxVoices notes ring at once; a note beyond
+    // that steals a voice picked by stealPolicy ("oldest", "quietest",
+    // "priority") or is dropped. With "priority" a note only takes the
+    // place of one whose priority is not higher.
+    Q_PROPERTY(int     maxVoices    READ maxVoices    WRITE setMaxVoices    NOTIFY maxVoicesChanged)
+    Q_PROPERTY(QString stealPolicy  READ stealPolicy  WRITE setStealPolicy  NOTIFY stealPolicyChanged)
+    Q_PROPERTY(int     priority     READ priority     WRITE setPriority     NOTIFY priorityChanged)
+    Q_PROPERTY(int     voiceSteals  READ voiceSteals  NOTIFY voiceStatsChanged)
+    Q_PROPERTY(int     droppedNotes READ droppedNotes NOTIFY voiceStatsChanged)
+
+    // Stereo placement: pan -1 (left) .. 1 (right) applies to notes
+    // triggered afterwards; with an emitter set, notes follow it instead.
+    // bus selects the AudioMixer bus the instrument is mixed into.
+    Q_PROPERTY(qreal         pan     READ pan     WRITE setPan     NOTIFY panChanged)
+    Q_PROPERTY(int           bus     READ bus     WRITE setBus     NOTIFY busChanged)
+    Q_PROPERTY(SoundEmitter *emitter READ emitter WRITE setEmitter NOTIFY emitterChanged)
+
 public:
     explicit SynthInstrument(QObject *parent = nullptr);
     ~SynthInstrument() override;
@@ -74,6 +96,22 @@ public:
 
     int activeVoices() const;
 
+    int     maxVoices() const { return maxVoices_; }
+    void    setMaxVoices(int n);
+    QString stealPolicy() const { return stealPolicyName_; }
+    void    setStealPolicy(const QString &p);
+    int     priority() const { return priority_; }
+    void    setPriority(int p);
+    int     voiceSteals() const { return lastSteals_; }
+    int     droppedNotes() const { return lastDropped_; }
+
+    qreal         pan() const { return pan_; }
+    void          setPan(qreal p);
+    int           bus() const { return bus_; }
+    void          setBus(int b);
+    SoundEmitter *emitter() const { return emitter_; }
+    void          setEmitter(SoundEmitter *e);
+
     // Fire-and-forget oneshot. freq in Hz, velocity 0..1,
     // duration in seconds. Returns true on success.
     Q_INVOKABLE bool trigger(qreal freqHz,
@@ -85,6 +123,12 @@ public:
                                  qreal velocity = 1.0,
                                  qreal durationSeconds = 0.2);
 
+    // NoteTarget: like triggerNote(), but starting at engine frame `frame`.
+    clay::sound::EventId scheduleNote(int64_t frame, int midiNote,
+                                      qreal velocity, qreal durationSeconds) override;
+    // NoteTarget: copy of the current sound for AudioBounce.
+    bool bounceSnapshot(clay::sound::BounceInstrument *out) const override;
+
     // Offline render of `durationSeconds` seconds of audio from the
     // current engine state. Produces a mono float buffer at the engine
     // sample rate. Destructive: advances engine time and consumes
@@ -124,6 +168,13 @@ signals:
     void lfoTargetChanged();
     void volumeChanged();
     void activeVoicesChanged();
+    void maxVoicesChanged();
+    void stealPolicyChanged();
+    void priorityChanged();
+    void voiceStatsChanged();
+    void panChanged();
+    void busChanged();
+    void emitterChanged();
 
 private slots:
     void onAfterPull();
@@ -138,9 +189,17 @@ private:
                                      qreal durationSeconds,
                                      qreal velocity) const;
 
+    // Queue a note with the current patch at engine frame `frame`.
+    clay::sound::EventId scheduleAt(int64_t frame, qreal freqHz,
+                                    qreal velocity, qreal durationSeconds);
+
+    // Send patch_ to the render thread as the instrument's default patch.
+    void applyPatchToCore();
+
     // Raw ptr to the OscillatorInstrument we registered with the
     // shared AudioOutput's engine. Owned by the engine; not deleted
-    // here.
+    // here. Only its gain may be touched directly; everything else goes
+    // through AudioOutput::post()/schedule().
     clay::sound::OscillatorInstrument *oscInst_ = nullptr;
     int oscInstId_ = -1;
 
@@ -152,6 +211,16 @@ private:
 
     qreal volume_ = 0.8;
     int   lastActive_ = 0;
+
+    int     maxVoices_ = 32;
+    QString stealPolicyName_ = "oldest";
+    int     priority_ = 0;
+    int     lastSteals_ = 0;
+    int     lastDropped_ = 0;
+
+    qreal                  pan_ = 0.0;
+    int                    bus_ = 0;
+    QPointer<SoundEmitter> emitter_;
 };
 
 #endif // SYNTH_INSTRUMENT_H
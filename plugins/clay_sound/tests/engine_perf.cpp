@@ -0,0 +1,810 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// clay_sound_engine_perf — deterministic load scenarios for the audio
+// engine. Each scenario drives clay::sound::Engine::renderOffline() the
+// way AudioOutput does (stereo, 44.1 kHz, prepare() with the live
+// limits, 512-frame blocks) and reports per scenario:
+//
+//   render.voice_sample_ns  render time / (frames x active voices)
+//   block.mean_us/p99_us/max_us  time per renderOffline() call
+//   allocs.per_block        heap allocations inside renderOffline() and
+//                           the commands applied on the render thread
+//   allocs.frees_per_block  heap releases in the same span
+//   voices.mean             active voices, averaged over the blocks
+//
+// Scenarios:
+//   osc.<waveform>.<n>   n sustained oscillator voices of one waveform
+//   sampler.<interp>.<n> n looping sample voices, each at its own pitch,
+//                        with linear/cubic/sinc8/sinc16 interpolation
+//                        (adds quality.snr_db and quality.alias_db, see
+//                        samplerQuality())
+//   sampler.swap         a sampler's source replaced every block while
+//                        its voices still play the earlier ones; old
+//                        buffers must be retired, not freed in the block
+//   schedule.storm       256 events scheduled, half cancelled, per block
+//                        (adds schedule.call_ns per schedule/cancel call)
+//   patch.storm          256 notes per block each with a queued patch,
+//                        half cancelled, issued from the render thread
+//                        the way AudioOutput applies schedule<Inst>()
+//   instrument.churn     one instrument added and one removed per block
+//                        (adds churn.add_remove_us, churn.allocs_per_block)
+//
+// Inputs come from a fixed LCG and seed (1337) and the first blocks of
+// every scenario are skipped as warm-up, so the allocation counts are
+// exact and the timings comparable between runs on one machine.
+//
+//   clay_sound_engine_perf [--quick] [--out run.json] [--no-timing]
+//                          [--baseline base.json [--update-baseline]]
+//                          [--threshold 0.25] [scenario-prefix...]
+//
+// With --baseline the run is compared against a recorded one: timing
+// metrics (keys ending in _us or _ns, tail latencies aside) regress when
+// they exceed it by more than the threshold, allocs.* on any increase.
+// --no-timing compares the allocation counts only, which do not depend
+// on the machine; that is what ctest runs. Exit code 1 on a regression.
+
+#include "engine/engine.h"
+#include "engine/note_event.h"
+#include "engine/oscillator_instrument.h"
+#include "engine/pcm_buffer.h"
+#include "engine/sampler_instrument.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ----------------------------------------------------------------------
+// Allocation counting: every operator new in the process goes through
+// here; scenarios read the counter around the calls they measure.
+// ----------------------------------------------------------------------
+
+namespace {
+std::atomic<uint64_t> gAllocations{0};
+std::atomic<uint64_t> gFrees{0};
+}
+
+void* operator new(std::size_t size)
+{
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size) { return operator new(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    gAllocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return operator new(size, tag);
+}
+void operator delete(void* p) noexcept
+{
+    if (p) gFrees.fetch_add(1, std::memory_order_relaxed);
+    std::free(p);
+}
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { operator delete(p); }
+
+using namespace clay::sound;
+
+namespace {
+
+constexpr std::uint32_t kSeed = 1337;
+constexpr int kSampleRate = 44100;
+constexpr int kChannels = 2;
+constexpr int kBlockFrames = 512;
+constexpr int kWarmupBlocks = 8;
+
+// The limits AudioOutput prepares the live engine with.
+constexpr int kMaxInstruments = 256;
+constexpr int kMaxVoices = 1024;
+constexpr int kMaxEvents = 16384;
+constexpr int kMaxEmitters = 256;
+
+class Lcg
+{
+public:
+    explicit Lcg(std::uint32_t seed) : state_(seed) {}
+    std::uint32_t next()
+    {
+        state_ = state_ * 1664525u + 1013904223u;
+        return state_;
+    }
+    // Uniform in [0, n).
+    std::uint32_t below(std::uint32_t n) { return std::uint32_t((std::uint64_t(next()) * n) >> 32); }
+    // Uniform in [lo, hi).
+    double range(double lo, double hi) { return lo + (hi - lo) * (next() / 4294967296.0); }
+
+private:
+    std::uint32_t state_;
+};
+
+using Clock = std::chrono::steady_clock;
+using Metrics = std::map<std::string, double>;
+
+double elapsedNs(Clock::time_point from, Clock::time_point to)
+{
+    return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+}
+
+// What every scenario drives: a prepared engine and its block loop. The
+// scenario sets up instruments and notes, then calls run() with a hook
+// that runs before each block (outside the measurement) and optionally
+// one standing in for the commands AudioOutput applies on the render
+// thread ahead of a block, whose allocations count towards the block.
+struct Harness
+{
+    Engine engine{kSampleRate, kChannels};
+    std::vector<float> out = std::vector<float>(static_cast<size_t>(kBlockFrames * kChannels));
+    Lcg lcg{kSeed};
+
+    Harness() { engine.prepare(kMaxInstruments, kMaxVoices, kMaxEvents, kMaxEmitters); }
+
+    Metrics run(int blocks, const std::function<void(int block)>& beforeBlock = {},
+                const std::function<void(int block)>& onRenderThread = {})
+    {
+        std::vector<double> blockNs;
+        blockNs.reserve(static_cast<size_t>(blocks));
+        double voiceSamples = 0.0;
+        double voices = 0.0;
+        uint64_t allocs = 0;
+        uint64_t frees = 0;
+
+        for (int b = 0; b < kWarmupBlocks + blocks; ++b) {
+            if (beforeBlock) beforeBlock(b);
+            const double active = static_cast<double>(engine.activeVoices());
+            const uint64_t allocsBefore = gAllocations.load(std::memory_order_relaxed);
+            const uint64_t freesBefore = gFrees.load(std::memory_order_relaxed);
+            if (onRenderThread) onRenderThread(b);
+            const auto t0 = Clock::now();
+            engine.renderOffline(out.data(), kBlockFrames);
+            const auto t1 = Clock::now();
+            if (b < kWarmupBlocks) continue;
+            allocs += gAllocations.load(std::memory_order_relaxed) - allocsBefore;
+            frees += gFrees.load(std::memory_order_relaxed) - freesBefore;
+            blockNs.push_back(elapsedNs(t0, t1));
+            voiceSamples += active * kBlockFrames;
+            voices += active;
+        }
+
+        double total = 0.0;
+        for (double ns : blockNs) total += ns;
+        std::vector<double> sorted = blockNs;
+        std::sort(sorted.begin(), sorted.end());
+        const size_t p99 = std::min(sorted.size() - 1, sorted.size() * 99 / 100);
+
+        Metrics m;
+        m["render.voice_sample_ns"] = voiceSamples > 0.0 ? total / voiceSamples : 0.0;
+        m["block.mean_us"] = total / static_cast<double>(blocks) / 1000.0;
+        m["block.p99_us"] = sorted[p99] / 1000.0;
+        m["block.max_us"] = sorted.back() / 1000.0;
+        m["allocs.per_block"] = static_cast<double>(allocs) / static_cast<double>(blocks);
+        m["allocs.frees_per_block"] = static_cast<double>(frees) / static_cast<double>(blocks);
+        m["voices.mean"] = voices / static_cast<double>(blocks);
+        return m;
+    }
+};
+
+const char* waveformName(OscillatorVoice::Waveform w)
+{
+    switch (w) {
+    case OscillatorVoice::Waveform::Sine:     return "sine";
+    case OscillatorVoice::Waveform::Square:   return "square";
+    case OscillatorVoice::Waveform::Triangle: return "triangle";
+    case OscillatorVoice::Waveform::Sawtooth: return "sawtooth";
+    case OscillatorVoice::Waveform::Noise:    return "noise";
+    }
+    return "?";
+}
+
+// Instruments hold up to kPoolVoices each, so n voices are spread over
+// as many instruments as that takes.
+std::vector<int> addOscillators(Engine& engine, int voices, const OscillatorVoice::Patch& patch)
+{
+    std::vector<int> ids;
+    for (int left = voices; left > 0; left -= OscillatorInstrument::kPoolVoices) {
+        auto inst = std::make_unique<OscillatorInstrument>();
+        inst->setDefaultPatch(patch);
+        inst->setMaxPolyphony(OscillatorInstrument::kPoolVoices);
+        inst->setGain(0.05f);
+        ids.push_back(engine.addInstrument(std::move(inst)));
+    }
+    return ids;
+}
+
+Metrics oscillators(OscillatorVoice::Waveform waveform, int voices, int blocks)
+{
+    Harness h;
+    OscillatorVoice::Patch patch;
+    patch.waveform = waveform;
+    const std::vector<int> ids = addOscillators(h.engine, voices, patch);
+    for (int v = 0; v < voices; ++v) {
+        NoteEvent ev;
+        ev.timeFrames = 0;
+        ev.durationFrames = int64_t(kWarmupBlocks + blocks + 1) * kBlockFrames;
+        ev.freqHz = h.lcg.range(110.0, 1760.0);
+        ev.pan = static_cast<float>(h.lcg.range(-1.0, 1.0));
+        ev.instrumentId = ids[static_cast<size_t>(v / OscillatorInstrument::kPoolVoices)];
+        h.engine.schedule(ev);
+    }
+    return h.run(blocks);
+}
+
+const char* interpolationName(Interpolation i)
+{
+    switch (i) {
+    case Interpolation::Linear: return "linear";
+    case Interpolation::Cubic:  return "cubic";
+    case Interpolation::Sinc8:  return "sinc8";
+    case Interpolation::Sinc16: return "sinc16";
+    }
+    return "?";
+}
+
+// One note rendered offline through a sampler (root A4) holding `pcm`.
+std::vector<float> renderNote(std::shared_ptr<const PcmBuffer> pcm, Interpolation interpolation,
+                              double freqHz, int frames)
+{
+    Engine engine(kSampleRate);
+    auto inst = std::make_unique<SamplerInstrument>();
+    inst->setSource(std::move(pcm));
+    inst->setRootMidiNote(69);
+    SampleVoice::Patch patch;
+    patch.interpolation = interpolation;
+    inst->setDefaultPatch(patch);
+    NoteEvent ev;
+    ev.durationFrames = frames;
+    ev.freqHz = freqHz;
+    ev.instrumentId = engine.addInstrument(std::move(inst));
+    engine.schedule(ev);
+    std::vector<float> out(static_cast<size_t>(frames));
+    engine.renderOffline(out.data(), frames);
+    return out;
+}
+
+std::shared_ptr<const PcmBuffer> sineBuffer(double freqHz, int frames)
+{
+    std::vector<float> s(static_cast<size_t>(frames));
+    for (int i = 0; i < frames; ++i)
+        s[static_cast<size_t>(i)] = static_cast<float>(0.5 * std::sin(2.0 * M_PI * freqHz * i / kSampleRate));
+    return std::make_shared<const PcmBuffer>(PcmBuffer::fromFloats(std::move(s), kSampleRate));
+}
+
+// The quality side of the trade-off, in dB relative to the signal:
+//   snr_db    a 5 kHz tone transposed up by 1.37 against the ideal sine
+//   alias_db  a 15 kHz tone played an octave up; it belongs above
+//             Nyquist, so whatever is left has folded back
+// Not gated; tracked alongside the timings.
+void samplerQuality(Interpolation interpolation, Metrics& m)
+{
+    constexpr int kFrames = 8192;
+    constexpr int kSkip = 256;   // kernel start-up
+    constexpr double kRatio = 1.37;
+
+    const auto tone = renderNote(sineBuffer(5000.0, kSampleRate), interpolation, 440.0 * kRatio, kFrames);
+    double sig = 0.0, err = 0.0;
+    for (int i = kSkip; i < kFrames; ++i) {
+        const double ideal = 0.5 * std::sin(2.0 * M_PI * 5000.0 * kRatio * i / kSampleRate);
+        sig += ideal * ideal;
+        err += (tone[static_cast<size_t>(i)] - ideal) * (tone[static_cast<size_t>(i)] - ideal);
+    }
+    m["quality.snr_db"] = 10.0 * std::log10(sig / std::max(err, 1e-30));
+
+    const auto high = renderNote(sineBuffer(15000.0, kSampleRate), interpolation, 880.0, kFrames);
+    double alias = 0.0;
+    for (int i = kSkip; i < kFrames; ++i)
+        alias += double(high[static_cast<size_t>(i)]) * high[static_cast<size_t>(i)];
+    const double full = 0.125 * (kFrames - kSkip);   // a 0.5 amplitude sine
+    m["quality.alias_db"] = 10.0 * std::log10(std::max(alias, 1e-30) / full);
+}
+
+Metrics samplerPitch(Interpolation interpolation, int voices, int blocks)
+{
+    Harness h;
+
+    // One second of a 220 Hz tone with some noise on top, at a rate other
+    // than the engine's so every voice resamples.
+    auto pcm = std::make_shared<PcmBuffer>();
+    pcm->sampleRate = 32000;
+    pcm->samples.resize(32000);
+    for (size_t i = 0; i < pcm->samples.size(); ++i) {
+        const double s = 0.6 * std::sin(2.0 * M_PI * 220.0 * double(i) / 32000.0)
+                         + h.lcg.range(-0.1, 0.1);
+        pcm->samples[i] = static_cast<int16_t>(std::lround(s * 32767.0));
+    }
+
+    SampleVoice::Patch patch;
+    patch.looping = true;
+    patch.interpolation = interpolation;
+    std::vector<int> ids;
+    for (int left = voices; left > 0; left -= SamplerInstrument::kPoolVoices) {
+        auto inst = std::make_unique<SamplerInstrument>();
+        inst->setSource(pcm);
+        inst->setRootMidiNote(57);
+        inst->setDefaultPatch(patch);
+        inst->setMaxPolyphony(SamplerInstrument::kPoolVoices);
+        inst->setGain(0.05f);
+        ids.push_back(h.engine.addInstrument(std::move(inst)));
+    }
+    for (int v = 0; v < voices; ++v) {
+        NoteEvent ev;
+        ev.timeFrames = 0;
+        ev.durationFrames = int64_t(kWarmupBlocks + blocks + 1) * kBlockFrames;
+        ev.freqHz = 220.0 * h.lcg.range(0.5, 2.0);   // pitch ratio 0.5 .. 2
+        ev.pan = static_cast<float>(h.lcg.range(-1.0, 1.0));
+        ev.instrumentId = ids[static_cast<size_t>(v / SamplerInstrument::kPoolVoices)];
+        h.engine.schedule(ev);
+    }
+    Metrics m = h.run(blocks);
+    samplerQuality(interpolation, m);
+    return m;
+}
+
+// SampleInstrument::applySourceToCore() on every block: a fresh buffer
+// is decoded on the GUI side, then set on the render thread while the
+// instrument's voices still play the ones before it. Replaced buffers
+// and those of finished voices reach the retire callback, which keeps
+// them for the GUI side to drop before the next block.
+Metrics samplerSwap(int blocks)
+{
+    constexpr int kVoices = 48;
+    constexpr int kBufferFrames = 8192;
+
+    Harness h;
+    std::vector<std::shared_ptr<const void>> retired;
+    retired.reserve(4 * kVoices);
+    h.engine.setRetireCallback([](void* context, std::shared_ptr<const void> object) {
+        auto* list = static_cast<std::vector<std::shared_ptr<const void>>*>(context);
+        if (list->size() < list->capacity()) list->push_back(std::move(object));
+    }, &retired);
+
+    auto inst = std::make_unique<SamplerInstrument>();
+    SamplerInstrument* sampler = inst.get();
+    sampler->setRootMidiNote(57);
+    sampler->setMaxPolyphony(SamplerInstrument::kPoolVoices);
+    sampler->setGain(0.05f);
+    const int id = h.engine.addInstrument(std::move(inst));
+
+    std::shared_ptr<const PcmBuffer> next;
+    Metrics m = h.run(blocks, [&](int) {
+        retired.clear();
+        auto pcm = std::make_shared<PcmBuffer>();
+        pcm->sampleRate = kSampleRate;
+        pcm->samples.resize(kBufferFrames);
+        for (size_t i = 0; i < pcm->samples.size(); ++i)
+            pcm->samples[i] = static_cast<int16_t>(h.lcg.below(16384)) - 8192;
+        next = std::move(pcm);
+    }, [&](int) {
+        sampler->setSource(std::move(next));
+        for (int i = 0; i < kVoices / 8; ++i) {
+            NoteEvent ev;
+            ev.timeFrames = h.engine.currentFrame() + h.lcg.below(kBlockFrames);
+            ev.durationFrames = int64_t(8) * kBlockFrames;
+            ev.freqHz = 220.0 * h.lcg.range(0.5, 2.0);
+            ev.instrumentId = id;
+            h.engine.schedule(ev);
+        }
+    });
+    h.engine.setRetireCallback(nullptr, nullptr);
+    return m;
+}
+
+// Many short notes scheduled a few blocks ahead and half of them
+// cancelled again before they fire, onto instruments kept at their
+// polyphony cap so notes also steal.
+Metrics scheduleStorm(int blocks)
+{
+    constexpr int kEventsPerBlock = 256;
+    constexpr int kLookaheadBlocks = 8;
+
+    Harness h;
+    OscillatorVoice::Patch patch;
+    patch.waveform = OscillatorVoice::Waveform::Square;
+    patch.attack = 0.002;
+    patch.release = 0.02;
+    const std::vector<int> ids = addOscillators(h.engine, 4 * OscillatorInstrument::kPoolVoices, patch);
+
+    double scheduleNs = 0.0;
+    int64_t calls = 0;
+    std::vector<EventId> scheduled(kEventsPerBlock);
+    Metrics m = h.run(blocks, [&](int block) {
+        const int64_t now = h.engine.currentFrame();
+        const auto t0 = Clock::now();
+        for (int i = 0; i < kEventsPerBlock; ++i) {
+            NoteEvent ev;
+            ev.timeFrames = now + h.lcg.below(kLookaheadBlocks * kBlockFrames);
+            ev.durationFrames = 256 + h.lcg.below(4096);
+            ev.freqHz = 110.0 * std::pow(2.0, h.lcg.below(48) / 12.0);
+            ev.instrumentId = ids[h.lcg.below(static_cast<std::uint32_t>(ids.size()))];
+            scheduled[static_cast<size_t>(i)] = h.engine.schedule(ev);
+        }
+        for (int i = 0; i < kEventsPerBlock; i += 2)
+            h.engine.cancel(scheduled[static_cast<size_t>(i)]);
+        const auto t1 = Clock::now();
+        if (block >= kWarmupBlocks) {
+            scheduleNs += elapsedNs(t0, t1);
+            calls += kEventsPerBlock + kEventsPerBlock / 2;
+        }
+    });
+    m["schedule.call_ns"] = scheduleNs / static_cast<double>(calls);
+    return m;
+}
+
+// The per-note patch path: every note queues its own patch through
+// pushPatch() next to the schedule() call, and half are cancelled so
+// their patches are discarded rather than consumed.
+Metrics patchStorm(int blocks)
+{
+    constexpr int kEventsPerBlock = 256;
+    constexpr int kLookaheadBlocks = 8;
+
+    Harness h;
+    OscillatorVoice::Patch patch;
+    patch.waveform = OscillatorVoice::Waveform::Sawtooth;
+    patch.attack = 0.002;
+    patch.release = 0.02;
+    std::vector<OscillatorInstrument*> insts;
+    std::vector<int> ids;
+    for (int i = 0; i < 4; ++i) {
+        auto inst = std::make_unique<OscillatorInstrument>();
+        inst->setDefaultPatch(patch);
+        inst->setGain(0.05f);
+        insts.push_back(inst.get());
+        ids.push_back(h.engine.addInstrument(std::move(inst)));
+    }
+
+    std::vector<EventId> scheduled(kEventsPerBlock);
+    return h.run(blocks, {}, [&](int) {
+        const int64_t now = h.engine.currentFrame();
+        for (int i = 0; i < kEventsPerBlock; ++i) {
+            const size_t k = h.lcg.below(static_cast<std::uint32_t>(ids.size()));
+            NoteEvent ev;
+            ev.timeFrames = now + h.lcg.below(kLookaheadBlocks * kBlockFrames);
+            ev.durationFrames = 256 + h.lcg.below(4096);
+            ev.freqHz = 110.0 * std::pow(2.0, h.lcg.below(48) / 12.0);
+            ev.instrumentId = ids[k];
+            OscillatorVoice::Patch p = patch;
+            p.sustain = h.lcg.range(0.3, 0.9);
+            scheduled[static_cast<size_t>(i)] = h.engine.schedule(ev);
+            insts[k]->pushPatch(scheduled[static_cast<size_t>(i)], p);
+        }
+        for (int i = 0; i < kEventsPerBlock; i += 2)
+            h.engine.cancel(scheduled[static_cast<size_t>(i)]);
+    });
+}
+
+// An instrument added with a few notes every block and the one added
+// kLifetimeBlocks earlier removed, voices still sounding.
+Metrics instrumentChurn(int blocks)
+{
+    constexpr int kLifetimeBlocks = 16;
+    constexpr int kNotesPerInstrument = 8;
+
+    Harness h;
+    OscillatorVoice::Patch patch;
+    patch.waveform = OscillatorVoice::Waveform::Triangle;
+
+    std::vector<int> live;
+    double churnNs = 0.0;
+    uint64_t churnAllocs = 0;
+    Metrics m = h.run(blocks, [&](int block) {
+        const uint64_t allocsBefore = gAllocations.load(std::memory_order_relaxed);
+        const auto t0 = Clock::now();
+        auto inst = std::make_unique<OscillatorInstrument>();
+        inst->setDefaultPatch(patch);
+        inst->setGain(0.05f);
+        const int id = h.engine.addInstrument(std::move(inst));
+        for (int i = 0; i < kNotesPerInstrument; ++i) {
+            NoteEvent ev;
+            ev.timeFrames = h.engine.currentFrame() + h.lcg.below(kBlockFrames);
+            ev.durationFrames = kLifetimeBlocks * kBlockFrames;
+            ev.freqHz = h.lcg.range(110.0, 880.0);
+            ev.instrumentId = id;
+            h.engine.schedule(ev);
+        }
+        live.push_back(id);
+        if (live.size() > kLifetimeBlocks) {
+            h.engine.removeInstrument(live.front());
+            live.erase(live.begin());
+        }
+        const auto t1 = Clock::now();
+        if (block >= kWarmupBlocks) {
+            churnNs += elapsedNs(t0, t1);
+            churnAllocs += gAllocations.load(std::memory_order_relaxed) - allocsBefore;
+        }
+    });
+    m["churn.add_remove_us"] = churnNs / static_cast<double>(blocks) / 1000.0;
+    // Allocations of the add/remove calls themselves, for information:
+    // the instrument, its pools and the engine's tables growing.
+    m["churn.allocs_per_block"] = static_cast<double>(churnAllocs) / static_cast<double>(blocks);
+    return m;
+}
+
+// ----------------------------------------------------------------------
+// Run files: { "meta": {...}, "scenarios": { name: { metric: value } } },
+// the layout clay_bench uses.
+// ----------------------------------------------------------------------
+
+using Run = std::map<std::string, Metrics>;
+
+std::string toJson(const Run& run, bool quick)
+{
+    std::ostringstream s;
+    s.precision(8);
+    s << "{\n  \"meta\": {\n"
+      << "    \"tool\": \"clay_sound_engine_perf\",\n"
+      << "    \"sampleRate\": " << kSampleRate << ",\n"
+      << "    \"channels\": " << kChannels << ",\n"
+      << "    \"blockFrames\": " << kBlockFrames << ",\n"
+      << "    \"seed\": " << kSeed << ",\n"
+      << "    \"quick\": " << (quick ? "true" : "false") << "\n"
+      << "  },\n  \"scenarios\": {";
+    const char* sep = "\n";
+    for (const auto& [name, metrics] : run) {
+        s << sep << "    \"" << name << "\": {";
+        const char* msep = "\n";
+        for (const auto& [key, value] : metrics) {
+            s << msep << "      \"" << key << "\": " << value;
+            msep = ",\n";
+        }
+        s << "\n    }";
+        sep = ",\n";
+    }
+    s << "\n  }\n}\n";
+    return s.str();
+}
+
+// Just enough JSON for the files toJson() writes (and hand edits of
+// them): objects, strings without escapes, numbers and literals.
+class JsonReader
+{
+public:
+    explicit JsonReader(std::string text) : text_(std::move(text)) {}
+
+    bool readRun(Run* run)
+    {
+        if (!expect('{')) return false;
+        if (peek() == '}') return ++pos_, true;
+        do {
+            std::string key;
+            if (!readString(&key) || !expect(':')) return false;
+            if (key == "scenarios") {
+                if (!readScenarios(run)) return false;
+            } else if (!skipValue()) {
+                return false;
+            }
+        } while (accept(','));
+        return expect('}');
+    }
+
+private:
+    bool readScenarios(Run* run)
+    {
+        if (!expect('{')) return false;
+        if (peek() == '}') return ++pos_, true;
+        do {
+            std::string name;
+            if (!readString(&name) || !expect(':') || !expect('{')) return false;
+            Metrics& metrics = (*run)[name];
+            if (peek() == '}') { ++pos_; continue; }
+            do {
+                std::string key;
+                double value = 0.0;
+                if (!readString(&key) || !expect(':') || !readNumber(&value)) return false;
+                metrics[key] = value;
+            } while (accept(','));
+            if (!expect('}')) return false;
+        } while (accept(','));
+        return expect('}');
+    }
+
+    bool skipValue()
+    {
+        const char c = peek();
+        if (c == '"') { std::string s; return readString(&s); }
+        if (c == '{') {
+            ++pos_;
+            if (peek() == '}') return ++pos_, true;
+            do {
+                std::string key;
+                if (!readString(&key) || !expect(':') || !skipValue()) return false;
+            } while (accept(','));
+            return expect('}');
+        }
+        while (pos_ < text_.size() && std::strchr(",}] \t\r\n", text_[pos_]) == nullptr) ++pos_;
+        return true;
+    }
+
+    bool readString(std::string* out)
+    {
+        if (!expect('"')) return false;
+        const size_t end = text_.find('"', pos_);
+        if (end == std::string::npos) return false;
+        *out = text_.substr(pos_, end - pos_);
+        pos_ = end + 1;
+        return true;
+    }
+
+    bool readNumber(double* out)
+    {
+        skipSpace();
+        const char* begin = text_.c_str() + pos_;
+        char* end = nullptr;
+        *out = std::strtod(begin, &end);
+        if (end == begin) return false;
+        pos_ += static_cast<size_t>(end - begin);
+        return true;
+    }
+
+    void skipSpace()
+    {
+        while (pos_ < text_.size() && std::strchr(" \t\r\n", text_[pos_]) != nullptr) ++pos_;
+    }
+    char peek() { skipSpace(); return pos_ < text_.size() ? text_[pos_] : '\0'; }
+    bool accept(char c) { if (peek() != c) return false; ++pos_; return true; }
+    bool expect(char c) { return accept(c); }
+
+    std::string text_;
+    size_t pos_ = 0;
+};
+
+bool isTimingMetric(const std::string& key)
+{
+    auto endsWith = [&](const char* suffix) {
+        const size_t n = std::strlen(suffix);
+        return key.size() >= n && key.compare(key.size() - n, n, suffix) == 0;
+    };
+    return endsWith("_us") || endsWith("_ns");
+}
+
+// Tail latencies (max, p99) are reported but not gated: one preempted
+// block decides them.
+bool isGatedTimingMetric(const std::string& key)
+{
+    return isTimingMetric(key) && key.find("max_") == std::string::npos
+           && key.find("p99_") == std::string::npos;
+}
+
+bool isAllocationMetric(const std::string& key) { return key.rfind("allocs.", 0) == 0; }
+
+// Prints every regression; metrics missing on either side are skipped,
+// so scenarios can be added without re-recording the baseline.
+int compare(const Run& baseline, const Run& current, double threshold, bool timing)
+{
+    int regressions = 0;
+    for (const auto& [name, metrics] : current) {
+        const auto base = baseline.find(name);
+        if (base == baseline.end()) continue;
+        for (const auto& [key, value] : metrics) {
+            const auto b = base->second.find(key);
+            if (b == base->second.end()) continue;
+            bool regressed = false;
+            if (isAllocationMetric(key))
+                regressed = value > b->second + 1e-6 * std::max(1.0, b->second);
+            else if (timing && isGatedTimingMetric(key))
+                regressed = value > b->second * (1.0 + threshold);
+            if (!regressed) continue;
+            std::printf("REGRESSION %s %s: %.4g -> %.4g\n", name.c_str(), key.c_str(),
+                        b->second, value);
+            ++regressions;
+        }
+    }
+    return regressions;
+}
+
+int usage(const char* argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s [--quick] [--out run.json] [--no-timing]\n"
+                 "          [--baseline base.json [--update-baseline]] [--threshold 0.25]\n"
+                 "          [scenario-prefix...]\n",
+                 argv0);
+    return 2;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    bool quick = false;
+    bool timing = true;
+    bool updateBaseline = false;
+    double threshold = 0.25;
+    std::string outPath;
+    std::string baselinePath;
+    std::vector<std::string> filters;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const bool hasValue = i + 1 < argc;
+        if (arg == "--quick") quick = true;
+        else if (arg == "--no-timing") timing = false;
+        else if (arg == "--update-baseline") updateBaseline = true;
+        else if (arg == "--out" && hasValue) outPath = argv[++i];
+        else if (arg == "--baseline" && hasValue) baselinePath = argv[++i];
+        else if (arg == "--threshold" && hasValue) threshold = std::atof(argv[++i]);
+        else if (arg.rfind("--", 0) == 0) return usage(argv[0]);
+        else filters.push_back(arg);
+    }
+    if (updateBaseline && baselinePath.empty()) return usage(argv[0]);
+
+    // Four seconds of audio per scenario; half a second with --quick.
+    const int blocks = (quick ? kSampleRate / 2 : 4 * kSampleRate) / kBlockFrames;
+
+    std::vector<std::pair<std::string, std::function<Metrics()>>> scenarios;
+    for (auto w : {OscillatorVoice::Waveform::Sine, OscillatorVoice::Waveform::Square,
+                   OscillatorVoice::Waveform::Triangle, OscillatorVoice::Waveform::Sawtooth,
+                   OscillatorVoice::Waveform::Noise}) {
+        for (int n : {32, 256})
+            scenarios.emplace_back(std::string("osc.") + waveformName(w) + "." + std::to_string(n),
+                                   [=] { return oscillators(w, n, blocks); });
+    }
+    for (auto i : {Interpolation::Linear, Interpolation::Cubic,
+                   Interpolation::Sinc8, Interpolation::Sinc16}) {
+        for (int n : {32, 256})
+            scenarios.emplace_back(std::string("sampler.") + interpolationName(i) + "." + std::to_string(n),
+                                   [=] { return samplerPitch(i, n, blocks); });
+    }
+    scenarios.emplace_back("sampler.swap", [=] { return samplerSwap(blocks); });
+    scenarios.emplace_back("schedule.storm", [=] { return scheduleStorm(blocks); });
+    scenarios.emplace_back("patch.storm", [=] { return patchStorm(blocks); });
+    scenarios.emplace_back("instrument.churn", [=] { return instrumentChurn(blocks); });
+
+    Run run;
+    std::printf("%-22s %10s %10s %10s %10s %8s\n", "scenario", "ns/v*smp", "mean us",
+                "p99 us", "max us", "allocs");
+    for (const auto& [name, fn] : scenarios) {
+        const bool selected = filters.empty()
+            || std::any_of(filters.begin(), filters.end(),
+                           [&](const std::string& f) { return name.rfind(f, 0) == 0; });
+        if (!selected) continue;
+        Metrics m = fn();
+        std::printf("%-22s %10.2f %10.1f %10.1f %10.1f %8.2f\n", name.c_str(),
+                    m["render.voice_sample_ns"], m["block.mean_us"], m["block.p99_us"],
+                    m["block.max_us"], m["allocs.per_block"]);
+        if (m.count("quality.snr_db"))
+            std::printf("%-22s snr %.1f dB, alias %.1f dB\n", "",
+                        m["quality.snr_db"], m["quality.alias_db"]);
+        run[name] = std::move(m);
+    }
+
+    const std::string json = toJson(run, quick);
+    if (!outPath.empty()) {
+        std::ofstream(outPath) << json;
+    }
+    if (baselinePath.empty()) return 0;
+
+    if (updateBaseline) {
+        std::ofstream(baselinePath) << json;
+        std::printf("baseline written to %s\n", baselinePath.c_str());
+        return 0;
+    }
+
+    std::ifstream in(baselinePath);
+    std::stringstream text;
+    text << in.rdbuf();
+    Run baseline;
+    if (!in || !JsonReader(text.str()).readRun(&baseline)) {
+        std::fprintf(stderr, "cannot read baseline %s\n", baselinePath.c_str());
+        return 2;
+    }
+    const int regressions = compare(baseline, run, threshold, timing);
+    std::printf("%d regression(s) against %s\n", regressions, baselinePath.c_str());
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,105 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// ChipMoodGenerator's composition cache: hits, LRU eviction at
+// capacity, keys per output rate, and requests for a key already being
+// generated joining the running job.
+
+#include "chipmood_generator.h"
+
+#include <QtTest/QtTest>
+
+namespace {
+
+ChipMoodParams moodParams(int seed)
+{
+    ChipMoodParams p;
+    p.presetName = QStringLiteral("test");
+    p.preset = QVariantMap{{"tempoRange", QVariantList{90, 110}},
+                           {"rootRange", QVariantList{48, 55}},
+                           {"sectionPattern", QVariantList{4}}};
+    p.layers = QStringList{"arp", "bass"};
+    p.seed = seed;
+    return p;
+}
+
+} // namespace
+
+class TestChipMoodGenerator : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cacheHit();
+    void keyIncludesSampleRate();
+    void evictsLeastRecentlyUsed();
+    void requestsShareOneJob();
+};
+
+void TestChipMoodGenerator::init()
+{
+    ChipMoodGenerator::clearCache();
+    ChipMoodGenerator::setCacheCapacity(8);
+}
+
+void TestChipMoodGenerator::cacheHit()
+{
+    const ChipMoodParams p = moodParams(1);
+    QVERIFY(!ChipMoodGenerator::cached(p.key(44100)));
+    const ChipMoodResult first = ChipMoodGenerator::obtain(p, 44100);
+    QVERIFY(first);
+    QCOMPARE(first->key, p.key(44100));
+    QCOMPARE(ChipMoodGenerator::obtain(p, 44100), first);
+    QCOMPARE(ChipMoodGenerator::cached(p.key(44100)), first);
+    QCOMPARE(ChipMoodGenerator::cacheSize(), 1);
+}
+
+void TestChipMoodGenerator::keyIncludesSampleRate()
+{
+    // The engine form is prepared at the output rate, so a result made
+    // for one rate must not be served for another.
+    const ChipMoodParams p = moodParams(1);
+    QVERIFY(p.key(44100) != p.key(48000));
+    const ChipMoodResult at44 = ChipMoodGenerator::obtain(p, 44100);
+    const ChipMoodResult at48 = ChipMoodGenerator::obtain(p, 48000);
+    QVERIFY(at44 != at48);
+    QCOMPARE(ChipMoodGenerator::cacheSize(), 2);
+}
+
+void TestChipMoodGenerator::evictsLeastRecentlyUsed()
+{
+    ChipMoodGenerator::setCacheCapacity(2);
+    const ChipMoodParams a = moodParams(1), b = moodParams(2), c = moodParams(3);
+    ChipMoodGenerator::obtain(a, 44100);
+    ChipMoodGenerator::obtain(b, 44100);
+    QVERIFY(ChipMoodGenerator::cached(a.key(44100)));   // a is now the most recent
+    ChipMoodGenerator::obtain(c, 44100);
+
+    QCOMPARE(ChipMoodGenerator::cacheSize(), 2);
+    QVERIFY(!ChipMoodGenerator::cached(b.key(44100)));
+    QVERIFY(ChipMoodGenerator::cached(a.key(44100)));
+    QVERIFY(ChipMoodGenerator::cached(c.key(44100)));
+
+    // Lowering the capacity drops the least recently used first.
+    ChipMoodGenerator::setCacheCapacity(1);
+    QCOMPARE(ChipMoodGenerator::cacheSize(), 1);
+    QVERIFY(ChipMoodGenerator::cached(c.key(44100)));
+}
+
+void TestChipMoodGenerator::requestsShareOneJob()
+{
+    // The second request finds the first one running (or already
+    // cached); either way both see the same result object.
+    const ChipMoodParams p = moodParams(4);
+    QFuture<ChipMoodResult> first = ChipMoodGenerator::request(p, 44100);
+    QFuture<ChipMoodResult> second = ChipMoodGenerator::request(p, 44100);
+    first.waitForFinished();
+    second.waitForFinished();
+    QVERIFY(first.result());
+    QCOMPARE(second.result(), first.result());
+    QCOMPARE(ChipMoodGenerator::cached(p.key(44100)), first.result());
+    QCOMPARE(ChipMoodGenerator::cacheSize(), 1);
+}
+
+QTEST_MAIN(TestChipMoodGenerator)
+#include "tst_chipmood_generator.moc"
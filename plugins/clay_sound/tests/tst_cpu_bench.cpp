@@ -0,0 +1,143 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// CPU-only micro-benchmarks for clay_sound engine data paths (QBENCHMARK).
+// Covers, each at several sizes up to 100k pending events:
+//   * Scheduler::schedule into a growing queue (random times)
+//   * Scheduler::cancel of every other pending event (random order)
+//   * Scheduler::popDue draining the queue in 512-frame audio blocks
+//
+// Inputs come from a fixed LCG and seed (1337), so numbers are
+// comparable across runs. cancel/popDue consume the queue they measure
+// and therefore run once per row. Run with e.g. -tickcounter or -csv for
+// machine-readable output.
+
+#include "engine/note_event.h"
+#include "engine/scheduler.h"
+
+#include <QtTest/QtTest>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+using namespace clay::sound;
+
+namespace {
+
+constexpr std::uint32_t kSeed = 1337;
+constexpr int kBlockFrames = 512;
+
+class Lcg
+{
+public:
+    explicit Lcg(std::uint32_t seed) : state_(seed) {}
+    std::uint32_t next()
+    {
+        state_ = state_ * 1664525u + 1013904223u;
+        return state_;
+    }
+    // Uniform in [0, n).
+    std::uint32_t below(std::uint32_t n) { return std::uint32_t((std::uint64_t(next()) * n) >> 32); }
+
+private:
+    std::uint32_t state_;
+};
+
+// `count` note events spread over roughly one minute at 44.1 kHz, which
+// is the density of a busy song scheduled up front.
+std::vector<NoteEvent> randomEvents(int count)
+{
+    std::vector<NoteEvent> events(static_cast<size_t>(count));
+    Lcg rng(kSeed);
+    for (auto& ev : events) {
+        ev.timeFrames = rng.below(44100u * 60u);
+        ev.durationFrames = 4410;
+        ev.freqHz = 110.0 + rng.below(880);
+    }
+    return events;
+}
+
+std::vector<EventId> fill(Scheduler& s, const std::vector<NoteEvent>& events)
+{
+    std::vector<EventId> ids;
+    ids.reserve(events.size());
+    for (const auto& ev : events) ids.push_back(s.schedule(ev));
+    return ids;
+}
+
+} // namespace
+
+class SoundCpuBench : public QObject
+{
+    Q_OBJECT
+private slots:
+    void schedulerSchedule_data();
+    void schedulerSchedule();
+    void schedulerCancel_data();
+    void schedulerCancel();
+    void schedulerPopDue_data();
+    void schedulerPopDue();
+};
+
+static void addQueueRows()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("10k") << 10000;
+    QTest::newRow("100k") << 100000;
+}
+
+void SoundCpuBench::schedulerSchedule_data() { addQueueRows(); }
+
+void SoundCpuBench::schedulerSchedule()
+{
+    QFETCH(int, count);
+    const auto events = randomEvents(count);
+    QBENCHMARK {
+        Scheduler s;
+        for (const auto& ev : events) s.schedule(ev);
+        QCOMPARE(s.pending(), size_t(count));
+    }
+}
+
+void SoundCpuBench::schedulerCancel_data() { addQueueRows(); }
+
+void SoundCpuBench::schedulerCancel()
+{
+    QFETCH(int, count);
+    const auto events = randomEvents(count);
+    Scheduler s;
+    auto ids = fill(s, events);
+    // Cancel in a shuffled order so no implementation gets a free ride
+    // from cancelling front-to-back.
+    Lcg rng(kSeed + 1);
+    for (size_t i = ids.size(); i > 1; --i)
+        std::swap(ids[i - 1], ids[rng.below(static_cast<std::uint32_t>(i))]);
+    ids.resize(ids.size() / 2);
+    QBENCHMARK_ONCE {
+        for (EventId id : ids) s.cancel(id);
+    }
+    QCOMPARE(s.pending(), size_t(count) - ids.size());
+}
+
+void SoundCpuBench::schedulerPopDue_data() { addQueueRows(); }
+
+void SoundCpuBench::schedulerPopDue()
+{
+    QFETCH(int, count);
+    const auto events = randomEvents(count);
+    Scheduler s;
+    fill(s, events);
+    std::vector<Scheduler::Fired> fired;
+    fired.reserve(static_cast<size_t>(count));
+    size_t popped = 0;
+    QBENCHMARK_ONCE {
+        for (int64_t frame = 0; s.hasPending(); frame += kBlockFrames) {
+            s.popDue(frame + kBlockFrames - 1, fired);
+            popped += fired.size();
+        }
+    }
+    QCOMPARE(popped, size_t(count));
+}
+
+QTEST_APPLESS_MAIN(SoundCpuBench)
+#include "tst_cpu_bench.moc"
@@ -5,25 +5,66 @@
 //   * empty engine renders silence
 //   * scheduler fires events in order, drops past events on pop
 //   * scheduler lets an event be cancelled before it fires
+//   * scheduler keeps ties in scheduling order across cancels, reuses
+//     the caller's popDue buffer and replaces re-scheduled tickets
 //   * sample-accurate spawn: a voice that emits a unit impulse at its
 //     start frame produces an impulse at the exact buffer offset
 //   * golden render: a deterministic note sequence hashes to a known value
+//   * SPSC command ring: FIFO order, full detection, wrap-around
+//   * block-rendered OscillatorVoice stays within tolerance of the
+//     per-sample reference path, for every waveform and modulation
+//   * polyphony caps: oldest / quietest / priority stealing, dropped
+//     notes release their queued patch; so do notes removed by
+//     clearSchedule(), and later notes still get theirs
+//   * voice lifecycle events and AudioOutput's voice counts derived
+//     from them; freed instrument slots are reused without the old
+//     instrument's pending notes; buffers a sampler drops while
+//     rendering go to the retire callback
+//   * stereo mixing: constant-power pan, emitter placement and
+//     distance attenuation, per-bus gain
+//   * streamed samples render exactly like resident ones with every
+//     interpolation; sinc interpolation keeps transposed tones clean
+//     and suppresses aliasing; the PCM cache shares one buffer per file
+//     but never hands one streamed file's buffer to another path
+//   * effects: biquad response, delay echoes, bus insert chains and
+//     sends, effect release; the master limiter holds its ceiling and
+//     passes quiet material unchanged apart from its latency
+//   * an offline bounce writes the same samples as a direct render,
+//     in both WAV encodings and with the limiter's latency trimmed
+//   * the composition loop repeats sample for sample, caps its notes,
+//     pauses, crossfades into a new composition and stops; the
+//     one-pole filter matches the RC low-pass it replaces
 //
 // The golden hash is computed on a quantised integer representation to
 // dodge FP-denormal / platform variance. It should remain stable across
 // compilers as long as the engine math stays pure integer/float ops.
 
+#include "engine/biquad_filter.h"
+#include "engine/bounce.h"
+#include "engine/composition_instrument.h"
+#include "engine/effect.h"
 #include "engine/engine.h"
+#include "engine/fdn_reverb.h"
+#include "engine/feedback_delay.h"
 #include "engine/instrument.h"
+#include "engine/limiter.h"
 #include "engine/note_event.h"
+#include "engine/oscillator_instrument.h"
+#include "engine/oscillator_voice.h"
 #include "engine/pcm_buffer.h"
+#include "engine/pcm_cache.h"
+#include "engine/pcm_streamer.h"
 #include "engine/sample_voice.h"
 #include "engine/sampler_instrument.h"
 #include "engine/scheduler.h"
+#include "engine/spatial.h"
+#include "engine/spsc_ring.h"
 #include "engine/voice.h"
+#include "audio_output.h"
 #include "sample_instrument.h"
 #include "synth_instrument.h"
 
+#include <QTemporaryDir>
 #include <QtTest/QtTest>
 #include <cmath>
 #include <cstdint>
@@ -140,6 +181,7 @@ private slots:
     void emptyEngineRendersSilence();
     void schedulerPopsDueInOrder();
     void schedulerCancelDropsEvent();
+    void schedulerKeepsOrderAcrossCancels();
     void voiceSpawnsAtExactFrame();
     void goldenRender();
     void synthInstrumentOfflineTrigger();
@@ -149,6 +191,26 @@ private slots:
     void sampleVoicePitchShift();
     void sampleVoiceLoops();
     void sampleInstrumentLoadsDemoWav();
+    void streamedVoiceMatchesResident();
+    void sampleVoiceInterpolationQuality();
+    void pcmCacheSharesBuffers();
+    void pcmCacheKeepsStreamedFilesApart();
+    void oscillatorBlockRenderMatchesReference();
+    void polyphonyCapStealsVoices();
+    void clearScheduleReleasesPatches();
+    void spscRingWrapsAndReportsFull();
+    void engineReportsVoiceLifecycle();
+    void engineReusesInstrumentSlots();
+    void samplerRetiresReplacedSource();
+    void audioOutputTracksActiveVoices();
+    void stereoPanIsConstantPower();
+    void emitterPlacesVoices();
+    void busGainScalesInstruments();
+    void biquadAndDelayShapeSignal();
+    void busEffectsAndSends();
+    void limiterHoldsCeiling();
+    void bounceMatchesDirectRender();
+    void compositionLoopsAndCrossfades();
 };
 
 void EngineSpineTest::emptyEngineRendersSilence()
@@ -195,6 +257,44 @@ void EngineSpineTest::schedulerCancelDropsEvent()
     QCOMPARE(due[0].ev.timeFrames, int64_t{200});
 }
 
+void EngineSpineTest::schedulerKeepsOrderAcrossCancels()
+{
+    Scheduler s;
+    s.reserve(64);
+    std::vector<EventId> ids;
+    for (int i = 0; i < 40; ++i) {
+        NoteEvent ev;
+        ev.timeFrames = (i % 4) * 100;        // ten events per frame
+        ev.freqHz = 100.0 + i;                // tags the insertion order
+        ids.push_back(s.schedule(ev));
+    }
+    for (size_t i = 0; i < ids.size(); i += 3) QVERIFY(s.cancel(ids[i]));
+
+    // Re-scheduling a pending ticket moves it instead of duplicating it.
+    NoteEvent moved; moved.timeFrames = 50; moved.freqHz = 1.0;
+    QCOMPARE(s.schedule(moved, ids[1]), ids[1]);
+    QCOMPARE(s.nextFrame(), int64_t{0});
+
+    std::vector<Scheduler::Fired> fired;
+    fired.reserve(64);
+    const auto* storage = fired.data();
+    std::vector<double> order;
+    for (int64_t maxFrame : { int64_t{0}, int64_t{99}, int64_t{400} }) {
+        s.popDue(maxFrame, fired);
+        QCOMPARE(fired.data(), storage);      // no reallocation
+        for (const auto& f : fired) order.push_back(f.ev.freqHz);
+    }
+    QVERIFY(!s.hasPending());
+
+    std::vector<double> expected;
+    for (int frame = 0; frame < 4; ++frame) {
+        for (int i = 0; i < 40; ++i)
+            if (i % 4 == frame && i % 3 != 0 && i != 1) expected.push_back(100.0 + i);
+        if (frame == 0) expected.push_back(1.0);
+    }
+    QCOMPARE(order, expected);
+}
+
 void EngineSpineTest::voiceSpawnsAtExactFrame()
 {
     Engine eng(44100);
@@ -269,10 +369,12 @@ void EngineSpineTest::synthInstrumentOfflineTrigger()
     auto buf = synth.renderOffline(0.2);
     QCOMPARE(buf.size(), 8820);
 
-    // Sum absolute energy: first half non-zero, second half silent.
+    // Sum absolute energy: first half non-zero, second half silent. The
+    // master limiter delays everything by its look-ahead.
+    const int end = 4410 + AudioOutput::instance().latencyFrames();
     double e1 = 0.0, e2 = 0.0;
-    for (int i = 0; i < 4410; ++i)   e1 += std::abs(buf[i]);
-    for (int i = 4410; i < 8820; ++i) e2 += std::abs(buf[i]);
+    for (int i = 0; i < end; ++i)    e1 += std::abs(buf[i]);
+    for (int i = end; i < 8820; ++i) e2 += std::abs(buf[i]);
     QVERIFY2(e1 > 100.0, qPrintable(QString("expected audible note, energy=%1").arg(e1)));
     QVERIFY2(e2 < 1.0,   qPrintable(QString("expected silent tail, energy=%1").arg(e2)));
 }
@@ -490,5 +592,1034 @@ void EngineSpineTest::sampleInstrumentLoadsDemoWav()
 #endif
 }
 
+// Two overlapping notes at different pitches through a sampler holding
+// `buffer`; `streamer` is null for resident buffers.
+static std::vector<float> renderSampler(std::shared_ptr<const PcmBuffer> buffer,
+                                        PcmStreamer *streamer, int frames,
+                                        Interpolation interpolation = Interpolation::Linear)
+{
+    Engine eng(44100);
+    auto core = std::make_unique<SamplerInstrument>();
+    core->setSource(std::move(buffer));
+    core->setRootMidiNote(69);
+    core->setStreamer(streamer);
+    SampleVoice::Patch patch;
+    patch.interpolation = interpolation;
+    core->setDefaultPatch(patch);
+    const int instId = eng.addInstrument(std::move(core));
+
+    NoteEvent ev;
+    ev.durationFrames = frames;
+    ev.freqHz         = 440.0;
+    ev.velocity       = 1.0f;
+    ev.instrumentId   = instId;
+    eng.schedule(ev);
+    ev.timeFrames     = 1000;
+    ev.freqHz         = 660.0;
+    eng.schedule(ev);
+
+    std::vector<float> out(frames, 0.0f);
+    for (int off = 0; off < frames; off += 512)
+        eng.renderOffline(out.data() + off, std::min(512, frames - off));
+    return out;
+}
+
+void EngineSpineTest::streamedVoiceMatchesResident()
+{
+    // A 3 s file with a 4096-frame head: both notes run far past the
+    // head, so most frames come through the streamer. Without start()
+    // it reads synchronously, which makes the output deterministic.
+    QTemporaryDir dir;
+    const std::string path = dir.filePath("long.wav").toStdString();
+    QVERIFY(makeSineBuffer(220.0, 44100, 3 * 44100)->saveWav(path));
+
+    std::string err;
+    auto resident = PcmBuffer::loadWav(path, &err);
+    auto streamed = PcmBuffer::openWavStream(path, 4096, &err);
+    QVERIFY2(resident && streamed, err.c_str());
+    QVERIFY(streamed->streamed());
+    QCOMPARE(streamed->frames(), resident->frames());
+    QCOMPARE(streamed->samples.size(), size_t{4096});
+
+    const auto residentBuffer = std::make_shared<const PcmBuffer>(std::move(*resident));
+    const auto streamedBuffer = std::make_shared<const PcmBuffer>(std::move(*streamed));
+    const int frames = 2 * 44100;
+    for (auto mode : {Interpolation::Linear, Interpolation::Cubic,
+                      Interpolation::Sinc8, Interpolation::Sinc16}) {
+        PcmStreamer streamer;
+        const auto a = renderSampler(residentBuffer, nullptr, frames, mode);
+        const auto b = renderSampler(streamedBuffer, &streamer, frames, mode);
+        for (int i = 0; i < frames; ++i)
+            QCOMPARE(b[i], a[i]);
+        QCOMPARE(streamer.underruns(), uint64_t{0});
+        QCOMPARE(streamer.activeStreams(), 0);
+    }
+}
+
+// One note of `freqHz` from a sampler holding `buffer` (root A4).
+static std::vector<float> renderSamplerNote(std::shared_ptr<const PcmBuffer> buffer,
+                                            Interpolation interpolation,
+                                            double freqHz, int frames)
+{
+    Engine eng(44100);
+    auto core = std::make_unique<SamplerInstrument>();
+    core->setSource(std::move(buffer));
+    core->setRootMidiNote(69);
+    SampleVoice::Patch patch;
+    patch.interpolation = interpolation;
+    core->setDefaultPatch(patch);
+    const int instId = eng.addInstrument(std::move(core));
+
+    NoteEvent ev;
+    ev.durationFrames = frames;
+    ev.freqHz         = freqHz;
+    ev.velocity       = 1.0f;
+    ev.instrumentId   = instId;
+    eng.schedule(ev);
+
+    std::vector<float> out(frames, 0.0f);
+    eng.renderOffline(out.data(), frames);
+    return out;
+}
+
+void EngineSpineTest::sampleVoiceInterpolationQuality()
+{
+    // (a) A 5 kHz tone transposed up by 1.37 should come out as a clean
+    // 6.85 kHz sine. (b) A 15 kHz tone played an octave up lands above
+    // Nyquist: a band-limited resampler keeps it out, linear folds it
+    // back to 14.1 kHz at nearly full level. Both measured past the
+    // kernel's start-up.
+    const int frames = 8192, skip = 256;
+    const auto tone = makeSineBuffer(5000.0, 44100, 44100);
+    const auto high = makeSineBuffer(15000.0, 44100, 44100);
+    const double ratio = 1.37;
+
+    auto snrDb = [&](Interpolation mode) {
+        const auto out = renderSamplerNote(tone, mode, 440.0 * ratio, frames);
+        double sig = 0.0, err = 0.0;
+        for (int i = skip; i < frames; ++i) {
+            const double ideal = std::sin(2.0 * M_PI * 5000.0 * ratio * i / 44100.0);
+            sig += ideal * ideal;
+            err += (out[i] - ideal) * (out[i] - ideal);
+        }
+        return 10.0 * std::log10(sig / err);
+    };
+    auto aliasDb = [&](Interpolation mode) {
+        const auto out = renderSamplerNote(high, mode, 880.0, frames);
+        double e = 0.0;
+        for (int i = skip; i < frames; ++i) e += double(out[i]) * out[i];
+        return 10.0 * std::log10(e / (0.5 * (frames - skip)));
+    };
+
+    const double linearSnr = snrDb(Interpolation::Linear);
+    const double cubicSnr  = snrDb(Interpolation::Cubic);
+    const double sincSnr   = snrDb(Interpolation::Sinc16);
+    QVERIFY2(cubicSnr > linearSnr + 6.0,
+             qPrintable(QString("cubic %1 dB vs linear %2 dB").arg(cubicSnr).arg(linearSnr)));
+    QVERIFY2(sincSnr > linearSnr + 20.0,
+             qPrintable(QString("sinc16 %1 dB vs linear %2 dB").arg(sincSnr).arg(linearSnr)));
+
+    const double linearAlias = aliasDb(Interpolation::Linear);
+    QVERIFY2(linearAlias > -20.0, qPrintable(QString("linear alias %1 dB").arg(linearAlias)));
+    for (auto mode : {Interpolation::Sinc8, Interpolation::Sinc16}) {
+        const double alias = aliasDb(mode);
+        QVERIFY2(alias < -60.0, qPrintable(QString("sinc alias %1 dB").arg(alias)));
+    }
+}
+
+void EngineSpineTest::pcmCacheSharesBuffers()
+{
+    QTemporaryDir dir;
+    const std::string path = dir.filePath("shared.wav").toStdString();
+    QVERIFY(makeSineBuffer(440.0, 44100, 4410)->saveWav(path));
+
+    auto &cache = PcmCache::instance();
+    cache.resetStats();
+    const auto before = cache.stats();
+
+    std::string err;
+    auto a = cache.acquireFile(path, {}, &err);
+    auto b = cache.acquireFile(path, {}, &err);
+    QVERIFY2(a, err.c_str());
+    QCOMPARE(a.get(), b.get());
+    auto s = cache.stats();
+    QCOMPARE(s.entries, before.entries + 1);
+    QCOMPARE(s.misses, uint64_t{1});
+    QCOMPARE(s.hits, uint64_t{1});
+    QCOMPARE(s.residentBytes, before.residentBytes + 4410 * sizeof(int16_t));
+
+    // Above the threshold the file is opened for streaming instead.
+    PcmCache::Options opts;
+    opts.streamAboveSeconds = 0.05;
+    auto streamed = cache.acquireFile(path, opts, &err);
+    QVERIFY(streamed && streamed->streamed());
+    QCOMPARE(cache.stats().streamed, before.streamed + 1);
+
+    a.reset();
+    b.reset();
+    streamed.reset();
+    QCOMPARE(cache.stats().entries, before.entries);
+}
+
+void EngineSpineTest::pcmCacheKeepsStreamedFilesApart()
+{
+    // Two recordings of equal length with a second of silence at each
+    // end: the streamed probe (head, tail, size) hashes them alike.
+    auto padded = [](double freqHz) {
+        std::vector<float> s(3 * 44100, 0.0f);
+        for (int i = 44100; i < 2 * 44100; ++i)
+            s[i] = static_cast<float>(0.5 * std::sin(2.0 * M_PI * freqHz * i / 44100.0));
+        return PcmBuffer::fromFloats(std::move(s), 44100);
+    };
+    QTemporaryDir dir;
+    const std::string first = dir.filePath("first.wav").toStdString();
+    const std::string second = dir.filePath("second.wav").toStdString();
+    QVERIFY(padded(440.0).saveWav(first));
+    QVERIFY(padded(660.0).saveWav(second));
+
+    PcmCache::Options opts;
+    opts.streamAboveSeconds = 1.0;
+    std::string err;
+    auto &cache = PcmCache::instance();
+    auto a = cache.acquireFile(first, opts, &err);
+    auto b = cache.acquireFile(second, opts, &err);
+    QVERIFY2(a && b, err.c_str());
+    QVERIFY(a->streamed() && b->streamed());
+    QVERIFY(a.get() != b.get());
+    QVERIFY(a->stream->path == first);
+    QVERIFY(b->stream->path == second);
+
+    // The same path still hits.
+    QCOMPARE(cache.acquireFile(second, opts, &err).get(), b.get());
+}
+
+void EngineSpineTest::oscillatorBlockRenderMatchesReference()
+{
+    using W = OscillatorVoice::Waveform;
+    OscillatorVoice::Patch plain;
+    OscillatorVoice::Patch sweep = plain;
+    sweep.pitchStart = 12.0; sweep.pitchEnd = -12.0; sweep.pitchTime = 0.2;
+    OscillatorVoice::Patch vibrato = plain;
+    vibrato.lfoRate = 6.0; vibrato.lfoDepth = 0.5; vibrato.lfoTarget = 1;
+    OscillatorVoice::Patch tremolo = plain;
+    tremolo.lfoRate = 8.0; tremolo.lfoDepth = 0.8; tremolo.lfoTarget = 2;
+    OscillatorVoice::Patch gate = plain;
+    gate.attack = 0.0; gate.decay = 0.0; gate.sustain = 1.0; gate.release = 0.0;
+    const OscillatorVoice::Patch patches[] = { plain, sweep, vibrato, tremolo, gate };
+
+    NoteEvent ev;
+    ev.timeFrames = 7;                 // off the control-segment grid
+    ev.durationFrames = 11025;
+    ev.freqHz = 440.0;
+    ev.velocity = 0.9f;
+    const int frames = 12000;
+
+    int patchIndex = 0;
+    for (auto patch : patches) {
+        for (W w : { W::Sine, W::Square, W::Triangle, W::Sawtooth, W::Noise }) {
+            patch.waveform = w;
+            OscillatorVoice block, reference;
+            block.setPatch(patch);
+            reference.setPatch(patch);
+            block.onNoteOn(ev, 44100);
+            reference.onNoteOn(ev, 44100);
+
+            // Odd host buffer size so segments get cut at buffer edges too.
+            std::vector<float> a(frames, 0.0f), b(frames, 0.0f);
+            for (int start = 0; start < frames; start += 100)
+                block.render(a.data() + start, std::min(100, frames - start), start);
+            reference.renderReference(b.data(), frames, 0);
+
+            double maxErr = 0.0, sqErr = 0.0;
+            for (int i = 0; i < frames; ++i) {
+                const double d = std::abs(a[i] - b[i]);
+                maxErr = std::max(maxErr, d);
+                sqErr += d * d;
+            }
+            const double rmsErr = std::sqrt(sqErr / frames);
+            const QString what = QString("patch %1, waveform %2: max %3, rms %4")
+                                     .arg(patchIndex).arg(int(w)).arg(maxErr).arg(rmsErr);
+            if (w == W::Sawtooth) {
+                // PolyBLEP deliberately reshapes the two samples around
+                // each wrap; everything else must line up.
+                QVERIFY2(rmsErr < 0.1, qPrintable(what));
+            } else {
+                QVERIFY2(maxErr < 5e-3, qPrintable(what));
+            }
+        }
+        ++patchIndex;
+    }
+}
+
+void EngineSpineTest::polyphonyCapStealsVoices()
+{
+    struct Log { std::vector<EventId> finished; };
+    auto track = [](void* ctx, const VoiceEvent& ev) {
+        if (ev.kind == VoiceEvent::Kind::Finished)
+            static_cast<Log*>(ctx)->finished.push_back(ev.id);
+    };
+    // Three long notes at frames 0, 8, 16 on an instrument capped at two.
+    auto play = [](Engine& eng, int inst, const float (&velocity)[3], const int (&priority)[3]) {
+        std::vector<EventId> ids;
+        for (int n = 0; n < 3; ++n) {
+            NoteEvent ev;
+            ev.instrumentId = inst;
+            ev.timeFrames = 8 * n;
+            ev.durationFrames = 44100;
+            ev.velocity = velocity[n];
+            ev.priority = priority[n];
+            ids.push_back(eng.schedule(ev));
+        }
+        return ids;
+    };
+    std::vector<float> buf(64);
+
+    {   // Oldest: the first note makes room.
+        Log log;
+        Engine eng(44100);
+        eng.setVoiceEventCallback(track, &log);
+        auto osc = std::make_unique<OscillatorInstrument>();
+        auto* inst = osc.get();
+        inst->setMaxPolyphony(2);
+        const int id = eng.addInstrument(std::move(osc));
+        const auto ids = play(eng, id, {1.0f, 1.0f, 1.0f}, {0, 0, 0});
+        eng.renderOffline(buf.data(), 64);
+        QCOMPARE(eng.activeVoices(id), size_t{2});
+        QCOMPARE(inst->voiceSteals(), uint64_t{1});
+        QCOMPARE(log.finished, std::vector<EventId>{ids[0]});
+    }
+    {   // Quietest: the soft second note goes once both have rendered.
+        Log log;
+        Engine eng(44100);
+        eng.setVoiceEventCallback(track, &log);
+        auto osc = std::make_unique<OscillatorInstrument>();
+        auto* inst = osc.get();
+        inst->setMaxPolyphony(2);
+        inst->setStealPolicy(IInstrument::StealPolicy::Quietest);
+        const int id = eng.addInstrument(std::move(osc));
+        NoteEvent ev;
+        ev.instrumentId = id;
+        ev.durationFrames = 44100;
+        ev.velocity = 0.9f;
+        const EventId loud = eng.schedule(ev);
+        ev.velocity = 0.1f;
+        const EventId soft = eng.schedule(ev);
+        eng.renderOffline(buf.data(), 64);
+        ev.timeFrames = eng.currentFrame();
+        ev.velocity = 0.5f;
+        eng.schedule(ev);
+        eng.renderOffline(buf.data(), 64);
+        QCOMPARE(inst->voiceSteals(), uint64_t{1});
+        QCOMPARE(log.finished, std::vector<EventId>{soft});
+        Q_UNUSED(loud);
+    }
+    {   // Priority: a note ranked below every voice is dropped, and its
+        // queued patch with it.
+        Log log;
+        Engine eng(44100);
+        eng.setVoiceEventCallback(track, &log);
+        auto osc = std::make_unique<OscillatorInstrument>();
+        auto* inst = osc.get();
+        inst->setMaxPolyphony(2);
+        inst->setStealPolicy(IInstrument::StealPolicy::LowestPriority);
+        const int id = eng.addInstrument(std::move(osc));
+        const auto ids = play(eng, id, {1.0f, 1.0f, 1.0f}, {5, 3, 1});
+        inst->pushPatch(ids[2], OscillatorVoice::Patch{});
+        eng.renderOffline(buf.data(), 64);
+        QCOMPARE(eng.activeVoices(id), size_t{2});
+        QCOMPARE(inst->voiceSteals(), uint64_t{0});
+        QCOMPARE(inst->droppedNotes(), uint64_t{1});
+        QCOMPARE(inst->queuedPatches(), size_t{0});
+        QVERIFY(log.finished.empty());
+
+        // An equal-priority note replaces the older of the lowest.
+        NoteEvent ev;
+        ev.instrumentId = id;
+        ev.timeFrames = eng.currentFrame();
+        ev.durationFrames = 44100;
+        ev.priority = 3;
+        eng.schedule(ev);
+        eng.renderOffline(buf.data(), 64);
+        QCOMPARE(inst->voiceSteals(), uint64_t{1});
+        QCOMPARE(log.finished, std::vector<EventId>{ids[1]});
+    }
+    {   // The cap never exceeds the preallocated pool.
+        OscillatorInstrument inst;
+        inst.setMaxPolyphony(100000);
+        QCOMPARE(inst.maxPolyphony(), OscillatorInstrument::kPoolVoices);
+    }
+}
+
+void EngineSpineTest::clearScheduleReleasesPatches()
+{
+    OscillatorVoice::Patch square;
+    square.waveform = OscillatorVoice::Waveform::Square;
+    NoteEvent ev;
+    ev.durationFrames = 2048;
+    ev.freqHz = 440.0;
+    ev.velocity = 0.8f;
+
+    // Reference: the same note with the square patch as the default.
+    std::vector<float> expected(4096, 0.0f);
+    {
+        Engine eng(44100);
+        auto osc = std::make_unique<OscillatorInstrument>();
+        osc->setDefaultPatch(square);
+        ev.instrumentId = eng.addInstrument(std::move(osc));
+        eng.schedule(ev);
+        eng.renderOffline(expected.data(), 4096);
+    }
+
+    Engine eng(44100);
+    auto osc = std::make_unique<OscillatorInstrument>();
+    auto* inst = osc.get();
+    ev.instrumentId = eng.addInstrument(std::move(osc));
+
+    // Clear more patched notes than the table holds, round by round.
+    for (int round = 0; round < 4; ++round) {
+        NoteEvent later = ev;
+        later.timeFrames = 44100;
+        for (size_t i = 0; i < 200; ++i)
+            QVERIFY(inst->pushPatch(eng.schedule(later), square));
+        eng.clearSchedule();
+        QCOMPARE(eng.pendingEvents(), size_t{0});
+        QCOMPARE(inst->queuedPatches(), size_t{0});
+    }
+
+    QVERIFY(inst->pushPatch(eng.schedule(ev), square));
+    std::vector<float> out(4096, 0.0f);
+    eng.renderOffline(out.data(), 4096);
+    QCOMPARE(inst->queuedPatches(), size_t{0});
+    QCOMPARE(out, expected);
+}
+
+void EngineSpineTest::spscRingWrapsAndReportsFull()
+{
+    SpscRing<int> ring(3);               // rounded up to 4
+    QCOMPARE(ring.capacity(), size_t{4});
+    int next = 0, expected = 0;
+    // Several laps so head/tail wrap past the slot count.
+    for (int lap = 0; lap < 5; ++lap) {
+        while (ring.push(next)) ++next;
+        QCOMPARE(ring.size(), size_t{4});
+        QVERIFY(ring.beginPush() == nullptr);
+        int v = -1;
+        QVERIFY(ring.pop(v));
+        QCOMPARE(v, expected++);
+        QVERIFY(ring.pop(v));
+        QCOMPARE(v, expected++);
+    }
+    int v = -1;
+    while (ring.pop(v)) QCOMPARE(v, expected++);
+    QCOMPARE(expected, next);
+    QVERIFY(ring.empty());
+    QVERIFY(ring.front() == nullptr);
+}
+
+void EngineSpineTest::engineReportsVoiceLifecycle()
+{
+    struct Log { int started = 0; int finished = 0; EventId lastId = 0; };
+    Log log;
+    Engine eng(44100);
+    eng.setVoiceEventCallback([](void* ctx, const VoiceEvent& ev) {
+        auto* l = static_cast<Log*>(ctx);
+        if (ev.kind == VoiceEvent::Kind::Started) { ++l->started; l->lastId = ev.id; }
+        else ++l->finished;
+    }, &log);
+    const int inst = eng.addInstrument(std::make_unique<SineInstrument>());
+
+    NoteEvent ev;
+    ev.instrumentId = inst;
+    ev.timeFrames = 10;
+    ev.durationFrames = 100;
+    ev.freqHz = 440.0;
+    const EventId reserved = eng.reserveEventId();
+    QCOMPARE(eng.schedule(ev, reserved), reserved);
+    ev.timeFrames = 20;
+    eng.schedule(ev);
+
+    std::vector<float> buf(64);
+    eng.renderOffline(buf.data(), 64);
+    QCOMPARE(log.started, 2);
+    QCOMPARE(log.finished, 0);
+    eng.renderOffline(buf.data(), 64);     // first note ends at 110
+    QCOMPARE(log.finished, 1);
+
+    // Removing the instrument cuts (and reports) the remaining voice.
+    auto released = eng.releaseInstrument(inst);
+    QVERIFY(released != nullptr);
+    QVERIFY(eng.instrumentAt(inst) == nullptr);
+    QCOMPARE(log.finished, 2);
+    QCOMPARE(eng.activeVoices(), size_t{0});
+}
+
+void EngineSpineTest::engineReusesInstrumentSlots()
+{
+    Engine eng(44100);
+    eng.prepare(4);
+    const int a = eng.addInstrument(std::make_unique<ImpulseInstrument>());
+    const int b = eng.addInstrument(std::make_unique<ImpulseInstrument>());
+    QCOMPARE(a, 0);
+    QCOMPARE(b, 1);
+
+    // A note still pending for `a` goes with it, not to the next
+    // instrument that gets its id.
+    NoteEvent ev;
+    ev.instrumentId = a;
+    ev.timeFrames = 32;
+    eng.schedule(ev);
+    ev.instrumentId = b;
+    eng.schedule(ev);
+    eng.removeInstrument(a);
+    QCOMPARE(eng.pendingEvents(), size_t{1});
+
+    QCOMPARE(eng.addInstrument(std::make_unique<ImpulseInstrument>()), a);
+    QCOMPARE(eng.addInstrument(std::make_unique<ImpulseInstrument>()), 2);
+    QVERIFY(!eng.insertInstrument(b, std::make_unique<ImpulseInstrument>()));
+    QVERIFY(eng.insertInstrument(3, std::make_unique<ImpulseInstrument>()));
+
+    std::vector<float> buf(64);
+    eng.renderOffline(buf.data(), 64);
+    QCOMPARE(buf[32], 1.0f);
+    QCOMPARE(eng.activeVoices(a), size_t{0});
+}
+
+void EngineSpineTest::samplerRetiresReplacedSource()
+{
+    // A replaced source is retired at once, the buffer a voice still
+    // plays once that voice is released; neither is freed in place.
+    using Retired = std::vector<std::shared_ptr<const void>>;
+    Retired retired;
+    Engine eng(44100);
+    eng.setRetireCallback([](void* ctx, std::shared_ptr<const void> object) {
+        static_cast<Retired*>(ctx)->push_back(std::move(object));
+    }, &retired);
+
+    const auto makeBuffer = [] {
+        return std::make_shared<const PcmBuffer>(
+            PcmBuffer::fromFloats(std::vector<float>(4410, 0.25f), 44100));
+    };
+    auto sampler = std::make_unique<SamplerInstrument>();
+    auto* inst = sampler.get();
+    std::shared_ptr<const PcmBuffer> first = makeBuffer();
+    const std::weak_ptr<const PcmBuffer> firstRef = first;
+    inst->setSource(std::move(first));
+    const int id = eng.addInstrument(std::move(sampler));
+
+    NoteEvent ev;
+    ev.instrumentId = id;
+    ev.durationFrames = 1000;
+    ev.freqHz = 261.63;
+    eng.schedule(ev);
+    std::vector<float> buf(256);
+    eng.renderOffline(buf.data(), 256);
+    QCOMPARE(eng.activeVoices(id), size_t{1});
+    QVERIFY(retired.empty());
+
+    inst->setSource(makeBuffer());
+    QCOMPARE(retired.size(), size_t{1});
+    QVERIFY(retired.front() == firstRef.lock());
+    retired.clear();
+    QVERIFY(!firstRef.expired());      // the voice still plays it
+
+    for (int i = 0; i < 16 && eng.activeVoices(id) > 0; ++i)
+        eng.renderOffline(buf.data(), 256);
+    QCOMPARE(eng.activeVoices(id), size_t{0});
+    QCOMPARE(retired.size(), size_t{1});
+    retired.clear();
+    QVERIFY(firstRef.expired());
+
+    // A voice playing the current source has nothing to retire.
+    eng.schedule(ev);
+    for (int i = 0; i < 16; ++i) eng.renderOffline(buf.data(), 256);
+    QVERIFY(retired.empty());
+}
+
+void EngineSpineTest::audioOutputTracksActiveVoices()
+{
+    // No QCoreApplication here, so the sink never starts and commands
+    // apply immediately; the voice counts still come from the engine's
+    // lifecycle notifications.
+    SynthInstrument synth;
+    synth.setAttack(0.0);
+    synth.setRelease(0.0);
+    QCOMPARE(synth.activeVoices(), 0);
+
+    auto& output = AudioOutput::instance();
+    const int before = output.activeVoices();
+    QVERIFY(synth.trigger(440.0, 1.0, 0.05));
+    QVERIFY(synth.trigger(660.0, 1.0, 0.05));
+    std::vector<float> buf(441);
+    output.renderOffline(buf.data(), 441);
+    QCOMPARE(synth.activeVoices(), 2);
+    QCOMPARE(output.activeVoices(), before + 2);
+
+    const auto stats = output.stats();
+    QVERIFY(stats.blocks > 0);
+    QCOMPARE(stats.blockFrames, 441);
+
+    synth.renderOffline(0.1);
+    QCOMPARE(synth.activeVoices(), 0);
+    QCOMPARE(output.activeVoices(), before);
+}
+
+// --- Stereo / spatial mixing -------------------------------------------
+
+namespace {
+
+// Sum of squares over interleaved stereo frames [from, to).
+void channelEnergy(const std::vector<float>& buf, int from, int to,
+                   double& left, double& right)
+{
+    left = right = 0.0;
+    for (int i = from; i < to; ++i) {
+        left  += double(buf[2 * i]) * buf[2 * i];
+        right += double(buf[2 * i + 1]) * buf[2 * i + 1];
+    }
+}
+
+} // namespace
+
+void EngineSpineTest::stereoPanIsConstantPower()
+{
+    // A panned stereo note must equal the mono render scaled by the
+    // constant-power gains, so mono output (and the golden hash) is the
+    // pan-centre reference.
+    for (float pan : {0.0f, -1.0f, 1.0f, 0.5f}) {
+        Engine mono(44100), stereo(44100, 2);
+        for (Engine* e : {&mono, &stereo}) {
+            NoteEvent ev;
+            ev.durationFrames = 1000;
+            ev.freqHz         = 440.0;
+            ev.instrumentId   = e->addInstrument(std::make_unique<SineInstrument>());
+            ev.pan            = pan;
+            e->schedule(ev);
+        }
+        std::vector<float> m(1000), s(2000);
+        mono.renderOffline(m.data(), 1000);
+        stereo.renderOffline(s.data(), 1000);
+
+        const PanGains g = constantPowerPan(pan);
+        QVERIFY(std::abs(g.left * g.left + g.right * g.right - 1.0f) < 1e-5f);
+        for (int i = 0; i < 1000; ++i) {
+            QVERIFY(std::abs(s[2 * i]     - m[i] * g.left)  < 1e-6f);
+            QVERIFY(std::abs(s[2 * i + 1] - m[i] * g.right) < 1e-6f);
+        }
+    }
+}
+
+void EngineSpineTest::emitterPlacesVoices()
+{
+    Engine eng(44100, 2);
+    const int inst = eng.addInstrument(std::make_unique<SineInstrument>());
+
+    Emitter em;
+    em.position = {4.0f, 0.0f, 0.0f};      // listener faces -z: +x is right
+    eng.setEmitter(3, em);
+
+    NoteEvent ev;
+    ev.durationFrames = 44100;
+    ev.freqHz         = 440.0;
+    ev.instrumentId   = inst;
+    ev.emitterId      = 3;
+    eng.schedule(ev);
+
+    std::vector<float> buf(2 * 1024);
+    double l = 0.0, r = 0.0;
+    eng.renderOffline(buf.data(), 1024);
+    channelEnergy(buf, 0, 1024, l, r);
+    QVERIFY(r > 1.0);
+    QVERIFY(l < 1e-6 * r);
+    const double nearEnergy = r;
+
+    // Moving the emitter moves the ringing voice: after one ramp chunk
+    // it is heard on the left only.
+    em.position = {-4.0f, 0.0f, 0.0f};
+    eng.setEmitter(3, em);
+    eng.renderOffline(buf.data(), 1024);
+    channelEnergy(buf, Engine::kMixFrames, 1024, l, r);
+    QVERIFY(l > 1.0);
+    QVERIFY(r < 1e-6 * l);
+
+    // Doubling the distance (rolloff 1, refDistance 1) lowers the gain
+    // from 1/4 to 1/8, i.e. a quarter of the energy.
+    em.position = {8.0f, 0.0f, 0.0f};
+    eng.setEmitter(3, em);
+    eng.renderOffline(buf.data(), 1024);
+    eng.renderOffline(buf.data(), 1024);
+    channelEnergy(buf, 0, 1024, l, r);
+    QVERIFY(std::abs(r / nearEnergy - 0.25) < 0.05);
+    QCOMPARE(distanceGain(em, 8.0f), 0.125f);
+}
+
+void EngineSpineTest::busGainScalesInstruments()
+{
+    Engine eng(44100);
+    auto music = std::make_unique<SineInstrument>();
+    music->setBus(1);
+    const int musicId = eng.addInstrument(std::move(music));
+    const int sfxId   = eng.addInstrument(std::make_unique<SineInstrument>());
+
+    NoteEvent ev;
+    ev.durationFrames = 4096;
+    ev.freqHz         = 440.0;
+    ev.instrumentId   = musicId;
+    eng.schedule(ev);
+
+    std::vector<float> ref(512), buf(512);
+    eng.renderOffline(ref.data(), 512);
+
+    // Gain changes ramp over one mix chunk; afterwards bus 1 is halved.
+    eng.setBusGain(1, 0.5f);
+    QCOMPARE(eng.busGain(1), 0.5f);
+    eng.renderOffline(buf.data(), 512);
+    eng.renderOffline(buf.data(), 512);
+    double a = 0.0, b = 0.0;
+    for (int i = 0; i < 512; ++i) { a += std::abs(ref[i]); b += std::abs(buf[i]); }
+    QVERIFY(std::abs(b / a - 0.5) < 0.05);
+
+    // Muting bus 1 leaves instruments on bus 0 untouched.
+    eng.setBusGain(1, 0.0f);
+    ev.instrumentId = sfxId;
+    ev.timeFrames   = eng.currentFrame();
+    eng.schedule(ev);
+    eng.renderOffline(buf.data(), 512);
+    eng.renderOffline(buf.data(), 512);
+    b = 0.0;
+    for (int i = 0; i < 512; ++i) b += std::abs(buf[i]);
+    QVERIFY(std::abs(b / a - 1.0) < 0.05);
+}
+
+void EngineSpineTest::biquadAndDelayShapeSignal()
+{
+    // Steady-state level of a sine through a 200 Hz low-pass, relative
+    // to the input (both channels carry the same tone).
+    auto level = [](double freq) {
+        BiquadFilter f(44100);
+        f.setFrequency(200.0f);
+        std::vector<float> l(IEffect::kMaxFrames), r(IEffect::kMaxFrames);
+        float* planes[] = { l.data(), r.data() };
+        double in = 0.0, out = 0.0;
+        bool lockstep = true;
+        for (int block = 0; block < 64; ++block) {
+            for (int i = 0; i < IEffect::kMaxFrames; ++i) {
+                const int frame = block * IEffect::kMaxFrames + i;
+                l[i] = r[i] = static_cast<float>(std::sin(2.0 * M_PI * freq * frame / 44100.0));
+                if (block >= 32) in += l[i] * l[i];
+            }
+            f.process(planes, 2, IEffect::kMaxFrames);
+            for (int i = 0; i < IEffect::kMaxFrames; ++i) {
+                lockstep = lockstep && l[i] == r[i];
+                if (block >= 32) out += l[i] * l[i];
+            }
+        }
+        return lockstep ? 10.0 * std::log10(out / in) : 0.0;
+    };
+    QVERIFY(std::abs(level(50.0)) < 1.0);
+    QVERIFY(level(5000.0) < -40.0);       // also fails if the lanes diverge
+
+    // An impulse through the delay comes back after `time` at the mix
+    // level, then once more scaled by the feedback.
+    FeedbackDelay d(44100, 0.1f);
+    d.setTime(100.0f / 44100.0f);
+    d.setFeedback(0.5f);
+    d.setMix(1.0f);
+    d.setDamping(0.0f);
+    std::vector<float> buf(IEffect::kMaxFrames, 0.0f);
+    buf[0] = 1.0f;
+    float* plane[] = { buf.data() };
+    d.process(plane, 1, IEffect::kMaxFrames);
+    QCOMPARE(buf[0], 1.0f);
+    QCOMPARE(buf[100], 1.0f);
+    QVERIFY(std::abs(buf[200] - 0.5f) < 1e-6f);
+    for (int i : {1, 99, 101, 199, 201}) QCOMPARE(buf[i], 0.0f);
+}
+
+void EngineSpineTest::busEffectsAndSends()
+{
+    Engine eng(44100, 2);
+    auto inst = std::make_unique<SineInstrument>();
+    const int sineId = eng.addInstrument(std::move(inst));
+
+    auto reverb = std::make_unique<FdnReverb>(44100);
+    reverb->setMix(1.0f);
+    const int reverbId = eng.addEffect(3, std::move(reverb));
+    auto filter = std::make_unique<BiquadFilter>(44100);
+    filter->setType(BiquadFilter::Type::HighPass);
+    filter->setFrequency(8000.0f);
+    const int filterId = eng.addEffect(0, std::move(filter));
+    QCOMPARE(reverbId, 0);
+    QCOMPARE(filterId, 1);
+
+    NoteEvent ev;
+    ev.durationFrames = 4096;
+    ev.freqHz         = 220.0;
+    ev.instrumentId   = sineId;
+    eng.schedule(ev);
+
+    // The high-pass on bus 0 removes most of the tone; without a send
+    // nothing reaches the reverb, so once the click of the note's hard
+    // cut-off has passed the filter, the output is silent.
+    std::vector<float> buf(2 * 4096);
+    eng.renderOffline(buf.data(), 4096);
+    double energy = 0.0;
+    for (float s : buf) energy += s * s;
+    QVERIFY(energy < 1e-2);
+    eng.renderOffline(buf.data(), 512);
+    eng.renderOffline(buf.data(), 4096);
+    for (float s : buf) QCOMPARE(s, 0.0f);
+
+    // With the filter bypassed and bus 0 sent into bus 3 the reverb tail
+    // outlasts the note.
+    eng.effectAt(filterId)->setBypassed(true);
+    eng.setBusSend(0, 3, 0.5f);
+    QCOMPARE(eng.busSend(0, 3), 0.5f);
+    ev.timeFrames = eng.currentFrame();
+    eng.schedule(ev);
+    eng.renderOffline(buf.data(), 4096);
+    eng.renderOffline(buf.data(), 4096);
+    energy = 0.0;
+    for (float s : buf) energy += s * s;
+    QVERIFY(energy > 1e-3);
+    QVERIFY(eng.effectLoad(reverbId) > 0.0);
+    QVERIFY(eng.effectsLoad() >= eng.effectLoad(reverbId));
+
+    // Released effects hand their id back.
+    auto released = eng.releaseEffect(reverbId);
+    QVERIFY(released);
+    QCOMPARE(eng.effectAt(reverbId), nullptr);
+    QCOMPARE(eng.addEffect(Engine::kMasterBus, std::move(released)), reverbId);
+}
+
+void EngineSpineTest::limiterHoldsCeiling()
+{
+    auto render = [](float velocity, bool limit, std::vector<float>& out) {
+        Engine eng(44100);
+        eng.setLimiterEnabled(limit);
+        eng.limiter().setCeiling(0.5f);
+        NoteEvent ev;
+        ev.durationFrames = 2048;
+        ev.freqHz         = 440.0;
+        ev.velocity       = velocity;
+        ev.instrumentId   = eng.addInstrument(std::make_unique<SineInstrument>());
+        eng.schedule(ev);
+        out.assign(4096, 0.0f);
+        eng.renderOffline(out.data(), 4096);
+        return eng.latencyFrames();
+    };
+
+    std::vector<float> loud, quiet, dry;
+    QCOMPARE(render(3.0f, true, loud), Limiter::kLookahead);
+    for (float s : loud) QVERIFY(std::abs(s) <= 0.5f);
+    float peak = 0.0f;
+    for (float s : loud) peak = std::max(peak, std::abs(s));
+    QVERIFY(peak > 0.4f);
+
+    QCOMPARE(render(0.25f, false, dry), 0);
+    render(0.25f, true, quiet);
+    for (int i = 0; i < Limiter::kLookahead; ++i) QCOMPARE(quiet[i], 0.0f);
+    for (int i = Limiter::kLookahead; i < 4096; ++i)
+        QCOMPARE(quiet[i], dry[i - Limiter::kLookahead]);
+}
+
+void EngineSpineTest::bounceMatchesDirectRender()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    OscillatorVoice::Patch patch;
+    patch.waveform = OscillatorVoice::Waveform::Square;
+    const int64_t frames = 10000;
+
+    // Reference: the same notes rendered straight from an engine.
+    std::vector<float> ref(static_cast<size_t>(frames));
+    {
+        Engine eng(44100);
+        auto osc = std::make_unique<OscillatorInstrument>();
+        osc->setDefaultPatch(patch);
+        osc->setGain(0.5f);
+        const int id = eng.addInstrument(std::move(osc));
+        for (int64_t start : {int64_t{100}, int64_t{4500}}) {
+            NoteEvent ev;
+            ev.timeFrames     = start;
+            ev.durationFrames = 3000;
+            ev.freqHz         = 330.0;
+            ev.velocity       = 0.8f;
+            ev.instrumentId   = id;
+            eng.schedule(ev);
+        }
+        eng.renderOffline(ref.data(), static_cast<int>(frames));
+    }
+
+    BounceStem stem;
+    BounceInstrument inst;
+    inst.oscillator = patch;
+    inst.gain = 0.5f;
+    stem.instruments = { inst };
+    for (int64_t start : {int64_t{4500}, int64_t{100}}) {    // any order
+        BounceNote n;
+        n.frame          = start;
+        n.durationFrames = 3000;
+        n.freqHz         = 330.0;
+        n.velocity       = 0.8f;
+        stem.notes.push_back(n);
+    }
+    stem.frames = frames;
+
+    for (auto encoding : {WavWriter::Encoding::Int16, WavWriter::Encoding::Float32}) {
+        stem.path = dir.filePath(QStringLiteral("stem.wav")).toStdString();
+        BounceOptions options;
+        options.channels = 1;
+        options.encoding = encoding;
+        options.blockFrames = 1000;         // notes straddle block edges
+        BounceProgress progress;
+        std::string err;
+        QVERIFY2(renderStem(stem, options, progress, &err), err.c_str());
+        QCOMPARE(progress.frames.load(), frames);
+
+        // Quiet enough that the limiter only delays, and that delay is
+        // trimmed off. The WAV reads back as int16 either way; other
+        // block sizes move the oscillators' chunk edges, which costs
+        // at most rounding.
+        const auto pcm = PcmBuffer::loadWav(stem.path, &err);
+        QVERIFY2(pcm.has_value(), err.c_str());
+        QCOMPARE(static_cast<int64_t>(pcm->frames()), frames);
+        for (size_t i = 0; i < ref.size(); ++i)
+            QVERIFY(std::abs(pcm->sample(i) - ref[i]) < 1e-4f);
+    }
+
+    // A cancelled bounce leaves no file behind.
+    BounceProgress cancelled;
+    cancelled.cancel = true;
+    stem.path = dir.filePath(QStringLiteral("cancelled.wav")).toStdString();
+    QVERIFY(!renderStem(stem, BounceOptions{}, cancelled));
+    QVERIFY(!QFile::exists(dir.filePath(QStringLiteral("cancelled.wav"))));
+}
+
+void EngineSpineTest::compositionLoopsAndCrossfades()
+{
+    const int64_t loop = 4096;
+    auto make = [](std::initializer_list<int64_t> starts, int64_t loopFrames) {
+        auto c = std::make_shared<Composition>();
+        for (int64_t start : starts) {
+            CompositionNote n;
+            n.frame          = start;
+            n.durationFrames = 1500;
+            n.freqHz         = 440.0;
+            n.velocity       = 0.8f;
+            n.patch.waveform = OscillatorVoice::Waveform::Triangle;
+            c->notes.push_back(n);
+        }
+        c->loopFrames = loopFrames;
+        return c;
+    };
+    auto energy = [](const std::vector<float> &buf, size_t from, size_t to) {
+        double e = 0.0;
+        for (size_t i = from; i < to; ++i) e += double(buf[i]) * buf[i];
+        return e;
+    };
+
+    // Started mid-block, the loop begins at its note's frame and then
+    // repeats every loopFrames.
+    {
+        using Retired = std::vector<std::shared_ptr<const void>>;
+        Retired retired;
+        Engine eng(44100);
+        eng.setRetireCallback([](void* ctx, std::shared_ptr<const void> object) {
+            static_cast<Retired*>(ctx)->push_back(std::move(object));
+        }, &retired);
+        auto owned = std::make_unique<CompositionInstrument>(44100);
+        CompositionInstrument *inst = owned.get();
+        std::shared_ptr<const Composition> first = make({0, 2000}, loop);
+        const std::weak_ptr<const Composition> firstRef = first;
+        inst->setComposition(std::move(first), false);
+        const int id = eng.addInstrument(std::move(owned));
+        NoteEvent ev;
+        ev.timeFrames   = 100;
+        ev.instrumentId = id;
+        eng.schedule(ev);
+
+        std::vector<float> buf(static_cast<size_t>(100 + 3 * loop));
+        eng.renderOffline(buf.data(), static_cast<int>(buf.size()));
+        for (int i = 0; i < 100; ++i) QCOMPARE(buf[static_cast<size_t>(i)], 0.0f);
+        QVERIFY(energy(buf, 100, 1600) > 1.0);
+        for (int64_t i = 0; i < 2 * loop; ++i)
+            QVERIFY(std::abs(buf[static_cast<size_t>(100 + i)] - buf[static_cast<size_t>(100 + i + loop)]) < 1e-6f);
+        QCOMPARE(inst->position(), int64_t{0});
+
+        // Paused: silent, position held.
+        inst->setPaused(true);
+        std::vector<float> held(1024);
+        eng.renderOffline(held.data(), 1024);
+        QCOMPARE(energy(held, 0, held.size()), 0.0);
+        QCOMPARE(inst->position(), int64_t{0});
+        inst->setPaused(false);
+
+        // Crossfade into silence: the old loop fades out, the new one
+        // continues from the same position.
+        const int64_t fade = std::llround(CompositionInstrument::kFadeSeconds * 44100);
+        inst->setComposition(make({}, 2 * loop), true);
+        std::vector<float> out(static_cast<size_t>(fade + 1024));
+        eng.renderOffline(out.data(), static_cast<int>(out.size()));
+        QVERIFY(energy(out, 0, 256) > 0.1);
+        QCOMPARE(inst->activeNotes(), 0);
+        QCOMPARE(energy(out, static_cast<size_t>(fade), out.size()), 0.0);
+        QCOMPARE(inst->position(), fade % loop + 1024);   // old loop wrapped once
+
+        // The old loop went to the retire callback, not away in place.
+        QCOMPARE(retired.size(), size_t{1});
+        QVERIFY(retired.front() == firstRef.lock());
+        retired.clear();
+        QVERIFY(firstRef.expired());
+
+        inst->stop();
+        eng.renderOffline(out.data(), 256);
+        QCOMPARE(eng.activeVoices(id), size_t{0});
+    }
+
+    // More overlapping notes than voices: the oldest are stolen.
+    {
+        Engine eng(44100);
+        auto owned = std::make_unique<CompositionInstrument>(44100);
+        CompositionInstrument *inst = owned.get();
+        auto c = std::make_shared<Composition>();
+        for (int i = 0; i < 40; ++i) {
+            CompositionNote n;
+            n.frame = i * 10;
+            n.durationFrames = 10000;
+            c->notes.push_back(n);
+        }
+        inst->setComposition(c, false);
+        NoteEvent ev;
+        ev.instrumentId = eng.addInstrument(std::move(owned));
+        eng.schedule(ev);
+        std::vector<float> buf(1024);
+        eng.renderOffline(buf.data(), 1024);
+        QCOMPARE(inst->activeNotes(), CompositionInstrument::kMaxVoices);
+    }
+
+    // The one-pole section is SoftSynth's RC low-pass.
+    {
+        BiquadFilter filter(44100);
+        filter.setType(BiquadFilter::Type::OnePoleLowPass);
+        filter.setFrequency(2000.0f);
+        std::vector<float> x(512);
+        for (size_t i = 0; i < x.size(); ++i) x[i] = (i / 20) % 2 ? 0.5f : -0.5f;
+        std::vector<float> y = x;
+        for (size_t off = 0; off < y.size(); off += 256) {
+            float *planes[1] = { y.data() + off };
+            filter.process(planes, 1, 256);
+        }
+        const double rc = 1.0 / (2.0 * 3.14159265358979323846 * 2000.0);
+        const double dt = 1.0 / 44100.0;
+        const double alpha = dt / (rc + dt);
+        double state = 0.0;
+        for (size_t i = 0; i < x.size(); ++i) {
+            state += alpha * (x[i] - state);
+            QVERIFY(std::abs(y[i] - state) < 1e-5);
+        }
+    }
+}
+
 QTEST_APPLESS_MAIN(EngineSpineTest)
 #include "tst_engine.moc"
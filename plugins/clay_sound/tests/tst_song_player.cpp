@@ -2,8 +2,10 @@
 //
 // SongPlayer tests — drive the player against a fake recording
 // instrument and verify correct triggerNote() calls in the correct
-// order.
+// order, and against a fake NoteTarget to verify notes are queued at
+// frame-exact offsets instead.
 
+#include "note_target.h"
 #include "song_player.h"
 
 #include <QtTest/QtTest>
@@ -25,6 +27,27 @@ public:
     }
 };
 
+// Records the frames SongPlayer queues notes at. Also offers
+// triggerNote() to prove the player does not fall back to it.
+class FakeTarget : public QObject, public NoteTarget
+{
+    Q_OBJECT
+    Q_INTERFACES(NoteTarget)
+public:
+    struct Call { int64_t frame; int midi; qreal durSec; };
+    QVector<Call> calls;
+    int triggered = 0;
+
+    clay::sound::EventId scheduleNote(int64_t frame, int midiNote,
+                                      qreal /*velocity*/, qreal durationSeconds) override
+    {
+        calls.push_back({ frame, midiNote, durationSeconds });
+        return 0;   // nothing to cancel
+    }
+
+    Q_INVOKABLE void triggerNote(int, qreal, qreal) { ++triggered; }
+};
+
 class TestSongPlayer : public QObject
 {
     Q_OBJECT
@@ -33,6 +56,7 @@ private slots:
     void playsAllEventsInOrder();
     void loopingRestartsFromBeginning();
     void seekSkipsPastEvents();
+    void noteTargetGetsFrameExactNotes();
     void parseErrorKeepsUnloaded();
     void hotReloadKeepsPositionAndSwapsFutureEvents();
     void hotReloadWithBadSyntaxKeepsPreviousModel();
@@ -157,6 +181,46 @@ void TestSongPlayer::seekSkipsPastEvents()
     QCOMPARE(fake.calls[0].midi, 62);
 }
 
+void TestSongPlayer::noteTargetGetsFrameExactNotes()
+{
+    QTemporaryDir dir;
+    const QString path = writeSong(dir, R"({
+        "tempo": 240,
+        "tracks": { "l": { "instrument": "inst" } },
+        "patterns": {
+          "A": { "l": [
+            { "t": 0,    "note": 60, "dur": 0.25 },
+            { "t": 0.5,  "note": 62, "dur": 0.25 },
+            { "t": 1.75, "note": 64, "dur": 0.25 }
+          ] }
+        },
+        "sections": [ { "pattern": "A", "repeat": 2 } ]
+    })");
+    FakeTarget fake;
+    fake.setObjectName("inst");
+
+    SongPlayer p;
+    p.setInstruments(QVariantList{ QVariant::fromValue<QObject *>(&fake) });
+    p.setSource(QUrl::fromLocalFile(path));
+    QSignalSpy doneSpy(&p, &SongPlayer::finished);
+    p.play();
+    // Whichever clock drives the player (engine or wall fallback), the
+    // first note is queued ahead of time, not when its beat is reached.
+    QVERIFY(!fake.calls.isEmpty());
+    QVERIFY(waitUntil([&] { return doneSpy.count() > 0; }, 5000));
+
+    QCOMPARE(fake.triggered, 0);
+    QCOMPARE(fake.calls.size(), 6);
+    // 240 BPM at 44.1 kHz = 11025 frames per beat; patterns are 2 beats.
+    const int64_t base = fake.calls[0].frame;
+    const int64_t expected[] = { 0, 5513, 19294, 22050, 27563, 41344 };
+    for (int i = 0; i < 6; ++i) {
+        QCOMPARE(fake.calls[i].frame - base, expected[i]);
+        QCOMPARE(fake.calls[i].midi, 60 + 2 * (i % 3));
+    }
+    QVERIFY(qAbs(fake.calls[0].durSec - 0.0625) < 1e-6);
+}
+
 void TestSongPlayer::parseErrorKeepsUnloaded()
 {
     QTemporaryDir dir;
@@ -0,0 +1,260 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+#include "benchreport.h"
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <algorithm>
+#include <cmath>
+
+namespace BenchReport {
+
+namespace {
+
+// Splits one CSV line, honouring BenchLogger's quoting of notes/extras.
+QStringList splitCsvLine(const QString &line)
+{
+    QStringList fields;
+    QString field;
+    bool quoted = false;
+    for (int i = 0; i < line.size(); ++i) {
+        const QChar c = line.at(i);
+        if (quoted) {
+            if (c == QLatin1Char('"')) {
+                if (i + 1 < line.size() && line.at(i + 1) == QLatin1Char('"')) {
+                    field += c;
+                    ++i;
+                } else {
+                    quoted = false;
+                }
+            } else {
+                field += c;
+            }
+        } else if (c == QLatin1Char('"')) {
+            quoted = true;
+        } else if (c == QLatin1Char(',')) {
+            fields.append(field);
+            field.clear();
+        } else {
+            field += c;
+        }
+    }
+    fields.append(field);
+    return fields;
+}
+
+// Sanitizes a step key ("instancelist@5000") for use inside a metric name.
+QString metricKey(QString key)
+{
+    key.replace(QLatin1Char('.'), QLatin1Char('_'));
+    return key.isEmpty() ? QStringLiteral("all") : key;
+}
+
+} // namespace
+
+Stats summarize(QList<double> values)
+{
+    Stats s;
+    s.count = int(values.size());
+    if (values.isEmpty())
+        return s;
+    std::sort(values.begin(), values.end());
+    const qsizetype n = values.size();
+    s.median = n % 2 ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+    s.p95 = values[std::min<qsizetype>(n - 1, qsizetype(std::ceil(0.95 * n)) - 1)];
+    s.max = values.last();
+    double sum = 0.0;
+    for (double v : values)
+        sum += v;
+    s.mean = sum / n;
+    return s;
+}
+
+Metrics reduceBenchCsv(const QString &csvText)
+{
+    const QStringList lines = csvText.split(QLatin1Char('\n'), Qt::SkipEmptyParts);
+    if (lines.isEmpty())
+        return {};
+
+    const QStringList header = splitCsvLine(lines.first().trimmed());
+    const int noteCol = int(header.indexOf(QStringLiteral("note")));
+    const int timeCol = int(header.indexOf(QStringLiteral("t_ms")));
+
+    QString stepKey;
+    bool measuring = false;
+    QStringList stepOrder;
+    QHash<QString, QHash<int, QList<double>>> series;   // step -> column -> values
+
+    for (qsizetype li = 1; li < lines.size(); ++li) {
+        const QStringList row = splitCsvLine(lines[li].trimmed());
+        const QString note = noteCol >= 0 && noteCol < row.size() ? row[noteCol] : QString();
+        for (const QString &part : note.split(QLatin1Char(';'), Qt::SkipEmptyParts)) {
+            const QString key = part.section(QLatin1Char('='), 0, 0);
+            const QString value = part.section(QLatin1Char('='), 1);
+            if (key == QLatin1String("step_start") || key == QLatin1String("backend_start")) {
+                stepKey = value;
+                measuring = false;
+            } else if (key == QLatin1String("measure_start")) {
+                if (stepKey.isEmpty())
+                    stepKey = value;
+                measuring = true;
+            }
+        }
+        // Rows carrying the measure_start note were sampled during warm-up.
+        if (!measuring || note.contains(QLatin1String("measure_start")))
+            continue;
+
+        const QString step = metricKey(stepKey);
+        if (!stepOrder.contains(step))
+            stepOrder.append(step);
+        for (int c = 0; c < row.size() && c < header.size(); ++c) {
+            if (c == noteCol || c == timeCol)
+                continue;
+            bool ok = false;
+            const double v = row[c].toDouble(&ok);
+            if (ok)
+                series[step][c].append(v);
+        }
+    }
+
+    Metrics out;
+    for (const QString &step : std::as_const(stepOrder)) {
+        const auto &cols = series[step];
+        for (auto it = cols.cbegin(); it != cols.cend(); ++it) {
+            const QString prefix = QStringLiteral("steps.%1.%2").arg(step, header[it.key()]);
+            out.insert(prefix + QStringLiteral(".median"), summarize(it.value()).median);
+        }
+    }
+    return out;
+}
+
+Metrics reduceTrace(const QByteArray &traceJson)
+{
+    const QJsonArray events = QJsonDocument::fromJson(traceJson).object()
+                                  .value(QStringLiteral("traceEvents")).toArray();
+    // Per-thread open-zone stacks; zones nest strictly within one thread.
+    QHash<int, QList<QPair<QString, double>>> open;
+    QHash<QString, QList<double>> durations;
+    for (const QJsonValue &v : events) {
+        const QJsonObject e = v.toObject();
+        const QString ph = e.value(QStringLiteral("ph")).toString();
+        const int tid = e.value(QStringLiteral("tid")).toInt();
+        const QString name = e.value(QStringLiteral("name")).toString();
+        const double ts = e.value(QStringLiteral("ts")).toDouble();
+        if (ph == QLatin1String("B")) {
+            open[tid].append({name, ts});
+        } else if (ph == QLatin1String("E")) {
+            auto &stack = open[tid];
+            if (stack.isEmpty() || stack.last().first != name)
+                continue;
+            durations[name].append((ts - stack.last().second) / 1000.0);
+            stack.removeLast();
+        }
+    }
+
+    Metrics out;
+    for (auto it = durations.cbegin(); it != durations.cend(); ++it) {
+        const Stats s = summarize(it.value());
+        const QString prefix = QStringLiteral("zones.") + it.key();
+        out.insert(prefix + QStringLiteral(".count"), s.count);
+        out.insert(prefix + QStringLiteral(".mean_ms"), s.mean);
+        out.insert(prefix + QStringLiteral(".total_ms"), s.mean * s.count);
+        out.insert(prefix + QStringLiteral(".max_ms"), s.max);
+    }
+    return out;
+}
+
+void addFrameMetrics(Metrics &out, const QList<double> &frameMs,
+                     const QList<double> &syncMs, const QList<double> &renderMs)
+{
+    auto add = [&out](const QString &name, const QList<double> &values) {
+        const Stats s = summarize(values);
+        out.insert(QStringLiteral("frames.%1.median").arg(name), s.median);
+        out.insert(QStringLiteral("frames.%1.p95").arg(name), s.p95);
+        out.insert(QStringLiteral("frames.%1.max").arg(name), s.max);
+    };
+    out.insert(QStringLiteral("frames.count"), frameMs.size());
+    add(QStringLiteral("frame_ms"), frameMs);
+    add(QStringLiteral("sync_ms"), syncMs);
+    add(QStringLiteral("render_ms"), renderMs);
+}
+
+QJsonObject toJson(const Metrics &metrics)
+{
+    QJsonObject o;
+    for (auto it = metrics.cbegin(); it != metrics.cend(); ++it)
+        o.insert(it.key(), it.value());
+    return o;
+}
+
+Metrics fromJson(const QJsonObject &json)
+{
+    Metrics m;
+    for (auto it = json.constBegin(); it != json.constEnd(); ++it)
+        m.insert(it.key(), it.value().toDouble());
+    return m;
+}
+
+bool isTimingMetric(const QString &key)
+{
+    return key.contains(QLatin1String("_ms"));
+}
+
+QList<Regression> compare(const QMap<QString, Metrics> &baseline,
+                          const QMap<QString, Metrics> &current,
+                          double relThreshold, double absSlackMs)
+{
+    QList<Regression> out;
+    for (auto sit = current.cbegin(); sit != current.cend(); ++sit) {
+        const auto base = baseline.constFind(sit.key());
+        if (base == baseline.cend())
+            continue;
+        for (auto mit = sit->cbegin(); mit != sit->cend(); ++mit) {
+            if (!isTimingMetric(mit.key()))
+                continue;
+            const auto b = base->constFind(mit.key());
+            if (b == base->cend())
+                continue;
+            const double limit = std::max(*b * (1.0 + relThreshold), *b + absSlackMs);
+            if (mit.value() > limit)
+                out.append({sit.key(), mit.key(), *b, mit.value()});
+        }
+    }
+    return out;
+}
+
+QByteArray runToJson(const QMap<QString, Metrics> &run, const QJsonObject &meta)
+{
+    QJsonObject scenarios;
+    for (auto it = run.cbegin(); it != run.cend(); ++it)
+        scenarios.insert(it.key(), toJson(it.value()));
+    QJsonObject root = meta;
+    root.insert(QStringLiteral("scenarios"), scenarios);
+    return QJsonDocument(root).toJson(QJsonDocument::Indented);
+}
+
+QMap<QString, Metrics> runFromJson(const QByteArray &json)
+{
+    QMap<QString, Metrics> run;
+    const QJsonObject scenarios = QJsonDocument::fromJson(json).object()
+                                      .value(QStringLiteral("scenarios")).toObject();
+    for (auto it = scenarios.constBegin(); it != scenarios.constEnd(); ++it)
+        run.insert(it.key(), fromJson(it.value().toObject()));
+    return run;
+}
+
+QByteArray runToCsv(const QMap<QString, Metrics> &run)
+{
+    QByteArray out = "scenario,metric,value\n";
+    for (auto sit = run.cbegin(); sit != run.cend(); ++sit) {
+        for (auto mit = sit->cbegin(); mit != sit->cend(); ++mit) {
+            QString metric = mit.key();
+            if (metric.contains(QLatin1Char(',')))
+                metric = QLatin1Char('"') + metric + QLatin1Char('"');
+            out += sit.key().toUtf8() + ',' + metric.toUtf8() + ','
+                   + QByteArray::number(mit.value(), 'g', 8) + '\n';
+        }
+    }
+    return out;
+}
+
+}
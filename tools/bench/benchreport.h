@@ -0,0 +1,75 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+#pragma once
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+// Pure data side of clay_bench: folds raw measurements (BenchLogger CSV,
+// per-frame timings, PerfTrace exports) into one flat metric map per
+// scenario and compares it against a stored baseline. No Qt Quick here, so
+// the reduction and regression rules can be unit tested without a GPU.
+namespace BenchReport {
+
+// Flat "group.key.stat" -> value map for one scenario, e.g.
+// "frames.frame_ms.median", "zones.voxel.buildMesh.mean_ms",
+// "steps.5000.render_ms.median".
+using Metrics = QMap<QString, double>;
+
+// Median/p95/max of one series (values need not be sorted).
+struct Stats {
+    int count = 0;
+    double median = 0.0;
+    double p95 = 0.0;
+    double max = 0.0;
+    double mean = 0.0;
+};
+Stats summarize(QList<double> values);
+
+// Groups BenchLogger rows into steps and returns the per-step medians of every
+// numeric column. A step starts at a step_start=<key> or backend_start=<key>
+// note; only rows after the step's measure_start note (the warm-up cut the
+// hand-curated baselines use) are counted. Scenarios without step notes fall
+// back to the measure_start value as the step key.
+Metrics reduceBenchCsv(const QString &csvText);
+
+// Sums the B/E zones of a Chrome trace-event export per zone name into
+// zones.<name>.{count,mean_ms,total_ms,max_ms}.
+Metrics reduceTrace(const QByteArray &traceJson);
+
+// Adds frames.{frame_ms,sync_ms,render_ms}.{median,p95,max} and frames.count.
+void addFrameMetrics(Metrics &out, const QList<double> &frameMs,
+                     const QList<double> &syncMs, const QList<double> &renderMs);
+
+QJsonObject toJson(const Metrics &metrics);
+Metrics fromJson(const QJsonObject &json);
+
+// Lower-is-better metrics are the timing ones (keys containing "_ms").
+bool isTimingMetric(const QString &key);
+
+struct Regression {
+    QString scenario;
+    QString metric;
+    double baseline = 0.0;
+    double current = 0.0;
+};
+
+// A timing metric regresses when it exceeds the baseline by more than both
+// relThreshold (fraction) and absSlackMs; the absolute slack keeps
+// sub-millisecond noise from failing runs. Metrics missing on either side
+// are ignored, so scenarios and zones can be added without a new baseline.
+QList<Regression> compare(const QMap<QString, Metrics> &baseline,
+                          const QMap<QString, Metrics> &current,
+                          double relThreshold, double absSlackMs);
+
+// Serializes a whole run: { "scenarios": { name: { metric: value } } }.
+QByteArray runToJson(const QMap<QString, Metrics> &run, const QJsonObject &meta);
+QMap<QString, Metrics> runFromJson(const QByteArray &json);
+
+// Long-format CSV (scenario,metric,value), convenient for spreadsheets/diffs.
+QByteArray runToCsv(const QMap<QString, Metrics> &run);
+
+}
@@ -0,0 +1,194 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+#include "benchrunner.h"
+#include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QQmlComponent>
+#include <QQmlEngine>
+#include <QQuickItem>
+#include <QQuickWindow>
+#include <QTimer>
+#include <QUrl>
+
+BenchRunner *BenchRunner::s_active = nullptr;
+QtMessageHandler BenchRunner::s_previousHandler = nullptr;
+
+namespace {
+
+// Sets the first of names that the page declares; pages use different
+// names for their step length (stepDurationMs, phaseDurationMs, durationMs).
+void overrideProperty(QObject *obj, const QStringList &names, double value)
+{
+    if (value < 0.0)
+        return;
+    for (const QString &name : names) {
+        if (obj->metaObject()->indexOfProperty(name.toLatin1().constData()) >= 0) {
+            obj->setProperty(name.toLatin1().constData(), value);
+            return;
+        }
+    }
+}
+
+QByteArray readFile(const QString &path)
+{
+    QFile f(path);
+    return f.open(QIODevice::ReadOnly) ? f.readAll() : QByteArray();
+}
+
+} // namespace
+
+BenchRunner::BenchRunner(const Options &options, QObject *parent)
+    : QObject(parent)
+    , m_options(options)
+{
+}
+
+BenchRunner::~BenchRunner()
+{
+    if (s_active == this) {
+        qInstallMessageHandler(s_previousHandler);
+        s_active = nullptr;
+    }
+}
+
+void BenchRunner::messageHandler(QtMsgType type, const QMessageLogContext &ctx, const QString &msg)
+{
+    if (s_active)
+        s_active->onMessage(msg);
+    if (s_previousHandler)
+        s_previousHandler(type, ctx, msg);
+}
+
+void BenchRunner::onMessage(const QString &msg)
+{
+    // The pages' own completion protocol (see benchmarks/Sandbox.qml).
+    if (msg.startsWith(QLatin1String("BENCH DONE")))
+        finish();
+}
+
+void BenchRunner::finish()
+{
+    m_done = true;
+    if (m_loop)
+        QMetaObject::invokeMethod(m_loop, "quit", Qt::QueuedConnection);
+}
+
+BenchReport::Metrics BenchRunner::run(const QString &qmlPath, QString *error)
+{
+    const QString name = QFileInfo(qmlPath).completeBaseName();
+    const QString csvPath = QDir(m_options.outDir).filePath(name + QStringLiteral(".csv"));
+    const QString tracePath = QDir(m_options.outDir).filePath(name + QStringLiteral(".trace.json"));
+    QFile::remove(csvPath);
+
+    m_done = false;
+    m_frames = 0;
+    m_lastSwapNs = -1;
+    m_frameMs.clear();
+    m_syncMs.clear();
+    m_renderMs.clear();
+
+    QQmlEngine engine;
+    for (const QString &dir : std::as_const(m_options.importPaths))
+        engine.addImportPath(dir);
+
+    QQuickWindow window;
+    window.resize(m_options.windowSize);
+
+    // Direct connections: main() forces the basic render loop, so these all
+    // fire on this thread around each frame's sync and render phases.
+    m_frameClock.start();
+    connect(&window, &QQuickWindow::beforeSynchronizing, this,
+            [this]() { m_phaseClock.start(); }, Qt::DirectConnection);
+    connect(&window, &QQuickWindow::afterSynchronizing, this,
+            [this]() { m_syncMs.append(m_phaseClock.nsecsElapsed() / 1.0e6); }, Qt::DirectConnection);
+    connect(&window, &QQuickWindow::beforeRendering, this,
+            [this]() { m_phaseClock.start(); }, Qt::DirectConnection);
+    connect(&window, &QQuickWindow::afterRendering, this,
+            [this]() { m_renderMs.append(m_phaseClock.nsecsElapsed() / 1.0e6); }, Qt::DirectConnection);
+    connect(&window, &QQuickWindow::frameSwapped, this, [this]() {
+        const qint64 now = m_frameClock.nsecsElapsed();
+        if (m_lastSwapNs >= 0)
+            m_frameMs.append((now - m_lastSwapNs) / 1.0e6);
+        m_lastSwapNs = now;
+        if (++m_frames >= m_options.maxFrames)
+            finish();
+    }, Qt::DirectConnection);
+
+    QQmlComponent component(&engine, QUrl::fromLocalFile(qmlPath));
+    if (component.isError()) {
+        *error = component.errorString();
+        return {};
+    }
+
+    // Instantiate in two phases so the BenchLogger output and the step timing
+    // can be redirected before the page's Component.onCompleted starts it.
+    QObject *page = component.beginCreate(engine.rootContext());
+    if (!page) {
+        *error = component.errorString();
+        return {};
+    }
+    overrideProperty(page, {QStringLiteral("warmupMs")}, m_options.warmupMs);
+    overrideProperty(page, {QStringLiteral("stepDurationMs"), QStringLiteral("phaseDurationMs"),
+                            QStringLiteral("durationMs")}, m_options.stepMs);
+    for (QObject *child : page->findChildren<QObject *>()) {
+        if (QByteArray(child->metaObject()->className()).startsWith("BenchLogger"))
+            child->setProperty("outputPath", QUrl::fromLocalFile(csvPath).toString());
+    }
+    if (auto *item = qobject_cast<QQuickItem *>(page)) {
+        item->setParentItem(window.contentItem());
+        item->setSize(QSizeF(m_options.windowSize));
+    }
+
+    QObject *perf = m_options.trace
+        ? engine.singletonInstance<QObject *>("Clayground.Canvas3D", "PerfRegistry")
+        : nullptr;
+    if (perf) {
+        QMetaObject::invokeMethod(perf, "reset");
+        perf->setProperty("tracing", true);
+    }
+
+    component.completeCreate();
+    window.show();
+
+    QEventLoop loop;
+    m_loop = &loop;
+    s_active = this;
+    s_previousHandler = qInstallMessageHandler(&BenchRunner::messageHandler);
+    QTimer::singleShot(m_options.timeoutMs, &loop, &QEventLoop::quit);
+    QElapsedTimer wall;
+    wall.start();
+    loop.exec();
+    const double wallMs = wall.nsecsElapsed() / 1.0e6;
+    qInstallMessageHandler(s_previousHandler);
+    s_active = nullptr;
+    m_loop = nullptr;
+
+    if (perf) {
+        perf->setProperty("tracing", false);
+        bool exported = false;
+        QMetaObject::invokeMethod(perf, "exportTrace", qReturnArg(exported), tracePath);
+        if (!exported)
+            qWarning("clay_bench: could not write %s", qPrintable(tracePath));
+    }
+
+    window.hide();
+    // Destroying the page closes (and flushes) its BenchLogger file.
+    delete page;
+
+    BenchReport::Metrics metrics;
+    metrics.insert(QStringLiteral("run.frames_rendered"), m_frames);
+    metrics.insert(QStringLiteral("run.completed"), m_done && m_frames < m_options.maxFrames ? 1 : 0);
+    metrics.insert(QStringLiteral("run.wall_s"), wallMs / 1000.0);
+    BenchReport::addFrameMetrics(metrics, m_frameMs, m_syncMs, m_renderMs);
+
+    const BenchReport::Metrics steps = BenchReport::reduceBenchCsv(QString::fromUtf8(readFile(csvPath)));
+    for (auto it = steps.cbegin(); it != steps.cend(); ++it)
+        metrics.insert(it.key(), it.value());
+    if (perf) {
+        const BenchReport::Metrics zones = BenchReport::reduceTrace(readFile(tracePath));
+        for (auto it = zones.cbegin(); it != zones.cend(); ++it)
+            metrics.insert(it.key(), it.value());
+    }
+    return metrics;
+}
@@ -0,0 +1,64 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+#pragma once
+
+#include "benchreport.h"
+#include <QElapsedTimer>
+#include <QList>
+#include <QObject>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+
+class QEventLoop;
+
+// Runs one Canvas3D benchmark scenario (a Bench*.qml page) headless in an
+// offscreen QQuickWindow and collects its numbers:
+//  - the BenchLogger CSV the page writes (redirected into the output dir),
+//  - per-frame sync/render/frame timings measured around the scene graph,
+//  - the C++ zone timings (build, upload, mesh) from PerfRegistry tracing.
+// A run ends when the page prints "BENCH DONE", after maxFrames frames or
+// on timeout, whichever comes first.
+class BenchRunner : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options {
+        QStringList importPaths;
+        QString outDir;
+        QSize windowSize{1280, 720};
+        int maxFrames = 600;
+        int timeoutMs = 120000;
+        // Overrides for the page's warm-up/step timing (< 0 keeps the page's).
+        double warmupMs = -1.0;
+        double stepMs = -1.0;
+        bool trace = true;
+    };
+
+    explicit BenchRunner(const Options &options, QObject *parent = nullptr);
+    ~BenchRunner() override;
+
+    // Runs the scenario in qmlPath and returns its flat metrics. On failure
+    // the result is empty and error describes why.
+    BenchReport::Metrics run(const QString &qmlPath, QString *error);
+
+private:
+    static void messageHandler(QtMsgType type, const QMessageLogContext &ctx, const QString &msg);
+    void onMessage(const QString &msg);
+    void finish();
+
+    Options m_options;
+    QEventLoop *m_loop = nullptr;
+    bool m_done = false;
+    int m_frames = 0;
+
+    QElapsedTimer m_frameClock;
+    QElapsedTimer m_phaseClock;
+    qint64 m_lastSwapNs = -1;
+    QList<double> m_frameMs;
+    QList<double> m_syncMs;
+    QList<double> m_renderMs;
+
+    static BenchRunner *s_active;
+    static QtMessageHandler s_previousHandler;
+};
@@ -0,0 +1,202 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// clay_bench - headless runner for the Canvas3D benchmark pages.
+//
+//   clay_bench [options] [scenario...]
+//
+// Scenarios are Bench*.qml pages (by name or path); without arguments every
+// page in the Canvas3D benchmarks directory runs. Per scenario the raw
+// BenchLogger CSV and the PerfRegistry trace land in --out, and a summary of
+// all scenarios is written as clay_bench.json / clay_bench.csv. With
+// --baseline the summary is compared against a stored clay_bench.json and the
+// process exits with 1 if any timing metric regressed.
+
+#include "benchreport.h"
+#include "benchrunner.h"
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QHash>
+#include <QJsonObject>
+#include <QQuickWindow>
+#include <QSGRendererInterface>
+#include <QSurfaceFormat>
+#include <QtQuick3D/qquick3d.h>
+
+namespace {
+
+enum ExitCode { Ok = 0, Regressed = 1, Failed = 2 };
+
+bool applyBackend(const QString &backend)
+{
+    static const QHash<QString, QSGRendererInterface::GraphicsApi> apis = {
+        {QStringLiteral("null"), QSGRendererInterface::Null},
+        {QStringLiteral("opengl"), QSGRendererInterface::OpenGL},
+        {QStringLiteral("vulkan"), QSGRendererInterface::Vulkan},
+        {QStringLiteral("metal"), QSGRendererInterface::Metal},
+        {QStringLiteral("d3d11"), QSGRendererInterface::Direct3D11},
+        {QStringLiteral("d3d12"), QSGRendererInterface::Direct3D12},
+    };
+    if (backend.isEmpty() || backend == QLatin1String("default"))
+        return true;
+    const auto it = apis.constFind(backend);
+    if (it == apis.constEnd())
+        return false;
+    QQuickWindow::setGraphicsApi(*it);
+    return true;
+}
+
+QStringList resolveScenarios(const QStringList &args, const QString &scenarioDir)
+{
+    QStringList paths;
+    if (args.isEmpty()) {
+        const QDir dir(scenarioDir);
+        for (const QString &f : dir.entryList({QStringLiteral("Bench*.qml")}, QDir::Files, QDir::Name))
+            paths.append(dir.filePath(f));
+        return paths;
+    }
+    for (const QString &arg : args) {
+        if (QFileInfo::exists(arg))
+            paths.append(QFileInfo(arg).absoluteFilePath());
+        else
+            paths.append(QDir(scenarioDir).filePath(arg.endsWith(QLatin1String(".qml"))
+                                                    ? arg : arg + QStringLiteral(".qml")));
+    }
+    return paths;
+}
+
+bool writeFile(const QString &path, const QByteArray &data)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+    return f.write(data) == data.size();
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // Headless by default; the basic loop keeps every frame on the GUI thread
+    // so the runner can time sync/render without cross-thread bookkeeping.
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    qputenv("QSG_RENDER_LOOP", "basic");
+    qputenv("QML_DISABLE_DISK_CACHE", "1");
+
+    QSurfaceFormat::setDefaultFormat(QQuick3D::idealSurfaceFormat());
+    QGuiApplication app(argc, argv);
+    QGuiApplication::setApplicationName("clay_bench");
+    QGuiApplication::setApplicationVersion(CLAY_BENCH_VERSION);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Runs Canvas3D benchmark pages headless and "
+                                     "reports/compares their timings.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addPositionalArgument("scenario", "Bench page name or path (default: all).", "[scenario...]");
+    const QCommandLineOption outOpt("out", "Output directory.", "dir",
+                                    QDir::temp().filePath("clay_bench"));
+    const QCommandLineOption backendOpt("backend", "RHI backend: default, null, opengl, vulkan, "
+                                        "metal, d3d11, d3d12.", "api", "default");
+    const QCommandLineOption framesOpt("frames", "Frame budget per scenario.", "n", "600");
+    const QCommandLineOption timeoutOpt("timeout-ms", "Wall-clock limit per scenario.", "ms", "120000");
+    const QCommandLineOption warmupOpt("warmup-ms", "Override the pages' warm-up per step.", "ms");
+    const QCommandLineOption stepOpt("step-ms", "Override the pages' step duration.", "ms");
+    const QCommandLineOption importOpt("import", "Additional QML import directory.", "dir");
+    const QCommandLineOption noTraceOpt("no-trace", "Skip PerfRegistry tracing (no C++ zone timings).");
+    const QCommandLineOption baselineOpt("baseline", "clay_bench.json to compare against.", "file");
+    const QCommandLineOption updateOpt("update-baseline", "Write this run's summary to --baseline "
+                                       "instead of comparing.");
+    const QCommandLineOption thresholdOpt("threshold", "Allowed relative slowdown (0.15 = 15%).",
+                                          "fraction", "0.15");
+    const QCommandLineOption slackOpt("slack-ms", "Allowed absolute slowdown in ms.", "ms", "0.5");
+    parser.addOptions({outOpt, backendOpt, framesOpt, timeoutOpt, warmupOpt, stepOpt, importOpt,
+                       noTraceOpt, baselineOpt, updateOpt, thresholdOpt, slackOpt});
+    parser.process(app);
+
+    if (!applyBackend(parser.value(backendOpt))) {
+        fprintf(stderr, "clay_bench: unknown backend '%s'\n", qPrintable(parser.value(backendOpt)));
+        return Failed;
+    }
+
+    BenchRunner::Options options;
+    options.outDir = parser.value(outOpt);
+    options.maxFrames = parser.value(framesOpt).toInt();
+    options.timeoutMs = parser.value(timeoutOpt).toInt();
+    options.warmupMs = parser.isSet(warmupOpt) ? parser.value(warmupOpt).toDouble() : -1.0;
+    options.stepMs = parser.isSet(stepOpt) ? parser.value(stepOpt).toDouble() : -1.0;
+    options.trace = !parser.isSet(noTraceOpt);
+    options.importPaths = parser.values(importOpt);
+    options.importPaths << QCoreApplication::applicationDirPath() + QStringLiteral("/qml")
+                        << QStringLiteral(CLAY_BENCH_IMPORT_DIR);
+    QDir().mkpath(options.outDir);
+
+    const QStringList scenarios = resolveScenarios(parser.positionalArguments(),
+                                                   QStringLiteral(CLAY_BENCH_SCENARIO_DIR));
+    if (scenarios.isEmpty()) {
+        fprintf(stderr, "clay_bench: no scenarios found\n");
+        return Failed;
+    }
+
+    QMap<QString, BenchReport::Metrics> run;
+    BenchRunner runner(options);
+    int exitCode = Ok;
+    for (const QString &path : scenarios) {
+        const QString name = QFileInfo(path).completeBaseName();
+        fprintf(stderr, "clay_bench: running %s\n", qPrintable(name));
+        QString error;
+        const BenchReport::Metrics metrics = runner.run(path, &error);
+        if (metrics.isEmpty()) {
+            fprintf(stderr, "clay_bench: %s failed: %s\n", qPrintable(name), qPrintable(error));
+            exitCode = Failed;
+            continue;
+        }
+        run.insert(name, metrics);
+    }
+
+    QJsonObject meta;
+    meta.insert(QStringLiteral("version"), QStringLiteral(CLAY_BENCH_VERSION));
+    meta.insert(QStringLiteral("date"), QDateTime::currentDateTimeUtc().toString(Qt::ISODate));
+    meta.insert(QStringLiteral("backend"), parser.value(backendOpt));
+    meta.insert(QStringLiteral("frames"), options.maxFrames);
+    const QByteArray summary = BenchReport::runToJson(run, meta);
+    const QDir outDir(options.outDir);
+    writeFile(outDir.filePath(QStringLiteral("clay_bench.json")), summary);
+    writeFile(outDir.filePath(QStringLiteral("clay_bench.csv")), BenchReport::runToCsv(run));
+    fprintf(stderr, "clay_bench: results in %s\n", qPrintable(outDir.absolutePath()));
+
+    if (!parser.isSet(baselineOpt))
+        return exitCode;
+
+    const QString baselinePath = parser.value(baselineOpt);
+    if (parser.isSet(updateOpt)) {
+        if (!writeFile(baselinePath, summary)) {
+            fprintf(stderr, "clay_bench: could not write %s\n", qPrintable(baselinePath));
+            return Failed;
+        }
+        fprintf(stderr, "clay_bench: baseline updated: %s\n", qPrintable(baselinePath));
+        return exitCode;
+    }
+
+    QFile baselineFile(baselinePath);
+    if (!baselineFile.open(QIODevice::ReadOnly)) {
+        fprintf(stderr, "clay_bench: cannot read baseline %s\n", qPrintable(baselinePath));
+        return Failed;
+    }
+    const auto regressions = BenchReport::compare(BenchReport::runFromJson(baselineFile.readAll()), run,
+                                                  parser.value(thresholdOpt).toDouble(),
+                                                  parser.value(slackOpt).toDouble());
+    for (const auto &r : regressions) {
+        fprintf(stderr, "REGRESSION %s %s: %.3f -> %.3f (%+.0f%%)\n",
+                qPrintable(r.scenario), qPrintable(r.metric), r.baseline, r.current,
+                r.baseline > 0.0 ? 100.0 * (r.current / r.baseline - 1.0) : 0.0);
+    }
+    if (!regressions.isEmpty())
+        return Regressed;
+    fprintf(stderr, "clay_bench: no regressions against %s\n", qPrintable(baselinePath));
+    return exitCode;
+}
@@ -0,0 +1,117 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+
+#include "benchreport.h"
+
+#include <QtTest/QtTest>
+
+/**
+ * @brief Unit tests for clay_bench's result reduction.
+ *
+ * Feeds hand-written BenchLogger CSVs and trace exports through the
+ * reduction and checks the regression rules, no GPU or QML involved.
+ */
+class TestBenchReport : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testSummarize();
+    void testCsvStepsSkipWarmup();
+    void testCsvQuotedNotes();
+    void testTraceZones();
+    void testCompareThresholds();
+    void testRunJsonRoundTrip();
+};
+
+void TestBenchReport::testSummarize()
+{
+    const auto s = BenchReport::summarize({4.0, 1.0, 3.0, 2.0});
+    QCOMPARE(s.count, 4);
+    QCOMPARE(s.median, 2.5);
+    QCOMPARE(s.max, 4.0);
+    QCOMPARE(s.mean, 2.5);
+    QCOMPARE(BenchReport::summarize({}).count, 0);
+}
+
+void TestBenchReport::testCsvStepsSkipWarmup()
+{
+    const QString csv =
+        "t_ms,fps,frame_ms,render_ms,build_ms,note\n"
+        "0,60,16,1,4,step_start=1000\n"
+        "250,60,99,9,4,\n"                       // warm-up, ignored
+        "500,60,15,1,4,measure_start=1000\n"     // still warm-up
+        "750,60,16,2,4,\n"
+        "1000,60,18,4,4,\n"
+        "1250,60,40,9,34,step_start=5000\n"
+        "1500,60,20,3,34,measure_start=5000\n"
+        "1750,60,21,3,34,\n";
+    const auto m = BenchReport::reduceBenchCsv(csv);
+    QCOMPARE(m.value("steps.1000.frame_ms.median"), 17.0);
+    QCOMPARE(m.value("steps.1000.render_ms.median"), 3.0);
+    QCOMPARE(m.value("steps.5000.frame_ms.median"), 21.0);
+    QCOMPARE(m.value("steps.5000.build_ms.median"), 34.0);
+    QVERIFY(!m.contains("steps.1000.t_ms.median"));
+}
+
+void TestBenchReport::testCsvQuotedNotes()
+{
+    // BenchInstances keys steps as backend@N; extras may be quoted.
+    const QString csv =
+        "t_ms,frame_ms,label,note\n"
+        "0,10,\"a,b\",\"step_start=dynamic@5000;measure_start=dynamic@5000\"\n"
+        "250,12,\"a,b\",\n";
+    const auto m = BenchReport::reduceBenchCsv(csv);
+    QCOMPARE(m.value("steps.dynamic@5000.frame_ms.median"), 12.0);
+    QVERIFY(!m.contains("steps.dynamic@5000.label.median"));
+}
+
+void TestBenchReport::testTraceZones()
+{
+    const QByteArray trace = R"({"traceEvents":[
+        {"name":"thread_name","ph":"M","pid":1,"tid":1,"args":{"name":"main"}},
+        {"name":"lines.rebuild","ph":"B","ts":1000,"pid":1,"tid":1},
+        {"name":"lines.rebuild","ph":"E","ts":3000,"pid":1,"tid":1},
+        {"name":"voxel.buildMesh","ph":"B","ts":1000,"pid":1,"tid":2},
+        {"name":"voxel.buildMesh","ph":"B","ts":1500,"pid":1,"tid":3},
+        {"name":"voxel.buildMesh","ph":"E","ts":2000,"pid":1,"tid":2},
+        {"name":"voxel.buildMesh","ph":"E","ts":5500,"pid":1,"tid":3}
+    ]})";
+    const auto m = BenchReport::reduceTrace(trace);
+    QCOMPARE(m.value("zones.lines.rebuild.count"), 1.0);
+    QCOMPARE(m.value("zones.lines.rebuild.mean_ms"), 2.0);
+    QCOMPARE(m.value("zones.voxel.buildMesh.count"), 2.0);
+    QCOMPARE(m.value("zones.voxel.buildMesh.mean_ms"), 2.5);
+    QCOMPARE(m.value("zones.voxel.buildMesh.max_ms"), 4.0);
+}
+
+void TestBenchReport::testCompareThresholds()
+{
+    QMap<QString, BenchReport::Metrics> base;
+    base["S"] = {{"frames.frame_ms.median", 10.0},
+                 {"zones.x.mean_ms", 0.1},
+                 {"frames.count", 600.0}};
+    QMap<QString, BenchReport::Metrics> cur;
+    cur["S"] = {{"frames.frame_ms.median", 11.0},   // +10%: within 15%
+                {"zones.x.mean_ms", 0.5},           // +400% but within 0.5 ms slack
+                {"frames.count", 10.0},             // not a timing metric
+                {"zones.new.mean_ms", 99.0}};       // no baseline yet
+    QVERIFY(BenchReport::compare(base, cur, 0.15, 0.5).isEmpty());
+
+    cur["S"]["frames.frame_ms.median"] = 12.0;
+    const auto regressions = BenchReport::compare(base, cur, 0.15, 0.5);
+    QCOMPARE(regressions.size(), 1);
+    QCOMPARE(regressions[0].metric, QStringLiteral("frames.frame_ms.median"));
+    QCOMPARE(regressions[0].current, 12.0);
+}
+
+void TestBenchReport::testRunJsonRoundTrip()
+{
+    QMap<QString, BenchReport::Metrics> run;
+    run["BenchLinesStatic"] = {{"frames.frame_ms.median", 15.5}, {"steps.1000.fps.median", 60.0}};
+    const QByteArray json = BenchReport::runToJson(run, {{"backend", "null"}});
+    QCOMPARE(BenchReport::runFromJson(json), run);
+    QVERIFY(BenchReport::runToCsv(run).contains("BenchLinesStatic,frames.frame_ms.median,15.5"));
+}
+
+QTEST_MAIN(TestBenchReport)
+#include "tst_benchreport.moc"
@@ -0,0 +1,140 @@
+// (c) Clayground Contributors - MIT License, see "LICENSE" file
+//
+// clay_visemes - bakes lip-sync timelines for recorded dialogue.
+//
+//   clay_visemes [options] <folder|file>...
+//
+// Every audio file found (folders are searched recursively) is decoded
+// and analyzed like Speech::sayAudio() would at runtime, and the result
+// is written next to it as a binary sidecar (intro.wav.visemes, see
+// VisemeCache). Speech picks those up and starts lip-sync without
+// decoding. Files are analyzed in parallel, one per thread; sidecars
+// that still match their audio are skipped unless --force is given.
+// Exits with 1 if any file failed.
+
+#include "viseme_analyzer.h"
+#include "viseme_cache.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrentMap>
+
+namespace {
+
+enum ExitCode { Ok = 0, Failed = 1, Usage = 2 };
+
+struct Result
+{
+    enum Kind { Baked, UpToDate, Error };
+    QString path;
+    Kind kind = Error;
+    QString error;
+    qsizetype keys = 0;
+};
+
+QStringList collectFiles(const QStringList &args, const QStringList &patterns)
+{
+    QStringList files;
+    for (const QString &arg : args) {
+        const QFileInfo info(arg);
+        if (info.isDir()) {
+            QDirIterator it(info.absoluteFilePath(), patterns, QDir::Files,
+                            QDirIterator::Subdirectories);
+            while (it.hasNext())
+                files.append(it.next());
+        } else if (info.isFile()) {
+            files.append(info.absoluteFilePath());
+        } else {
+            fprintf(stderr, "clay_visemes: no such file or folder: %s\n", qPrintable(arg));
+        }
+    }
+    files.sort();
+    files.removeDuplicates();
+    return files;
+}
+
+Result bake(const QString &path, bool force)
+{
+    Result r;
+    r.path = path;
+    if (!force && VisemeCache::sidecarUpToDate(path)) {
+        r.kind = Result::UpToDate;
+        return r;
+    }
+    VisemeTimeline timeline;
+    if (!VisemeAnalyzer::analyzeFile(path, &timeline, &r.error)
+            || !VisemeCache::writeSidecar(path, timeline, &r.error))
+        return r;
+    r.kind = Result::Baked;
+    r.keys = timeline.keys.size();
+    return r;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("clay_visemes");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Analyzes dialogue audio and writes viseme sidecars "
+                                     "for Speech lip-sync.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("path", "Audio file or folder (searched recursively).",
+                                 "<path...>");
+    const QCommandLineOption jobsOpt({"j", "jobs"}, "Files analyzed in parallel "
+                                     "(default: one per core).", "n");
+    const QCommandLineOption forceOpt({"f", "force"}, "Re-analyze files whose sidecar is "
+                                      "up to date.");
+    const QCommandLineOption extOpt("ext", "Comma-separated audio extensions to look for "
+                                    "in folders.", "list", "wav,mp3,ogg,m4a,flac");
+    parser.addOptions({jobsOpt, forceOpt, extOpt});
+    parser.process(app);
+
+    if (parser.positionalArguments().isEmpty())
+        parser.showHelp(Usage);
+
+    QStringList patterns;
+    for (const QString &ext : parser.value(extOpt).split(u',', Qt::SkipEmptyParts))
+        patterns.append(QStringLiteral("*.") + ext.trimmed());
+    const QStringList files = collectFiles(parser.positionalArguments(), patterns);
+    if (files.isEmpty()) {
+        fprintf(stderr, "clay_visemes: no audio files found\n");
+        return Failed;
+    }
+
+    QThreadPool pool;
+    if (parser.isSet(jobsOpt))
+        pool.setMaxThreadCount(qMax(1, parser.value(jobsOpt).toInt()));
+    const bool force = parser.isSet(forceOpt);
+
+    QElapsedTimer timer;
+    timer.start();
+    const QList<Result> results = QtConcurrent::blockingMapped(
+        &pool, files, [force](const QString &path) { return bake(path, force); });
+
+    int baked = 0, upToDate = 0, failed = 0;
+    for (const Result &r : results) {
+        switch (r.kind) {
+        case Result::Baked:
+            ++baked;
+            fprintf(stderr, "baked   %s (%lld keys)\n", qPrintable(r.path), qlonglong(r.keys));
+            break;
+        case Result::UpToDate:
+            ++upToDate;
+            break;
+        case Result::Error:
+            ++failed;
+            fprintf(stderr, "FAILED  %s: %s\n", qPrintable(r.path), qPrintable(r.error));
+            break;
+        }
+    }
+    fprintf(stderr, "clay_visemes: %d baked, %d up to date, %d failed in %.1f s (%d threads)\n",
+            baked, upToDate, failed, timer.elapsed() / 1000.0, pool.maxThreadCount());
+    return failed > 0 ? Failed : Ok;
+}